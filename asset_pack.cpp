@@ -0,0 +1,135 @@
+#include <cstdio>
+#include <cstring>
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#endif
+
+#include "asset_pack.hpp"
+
+namespace {
+
+    /// struct index_entry
+    /*! Pack index table entry
+     */
+    struct index_entry {
+        char name[render::AssetPack::namelen__];
+        unsigned offset;
+        unsigned size;
+    };
+
+    static const ::size_t headerSize = 12;
+
+    // Helper
+    inline unsigned read_u32(const unsigned char* p) {
+        return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned)p[3] << 24);
+    }
+
+    // Helper
+    inline index_entry read_entry(const std::vector<unsigned char>& data, unsigned i)
+    {
+        const unsigned char* p = &data[headerSize + i * sizeof(index_entry)];
+
+        index_entry entry;
+        ::memcpy(entry.name, p, sizeof(entry.name));
+        entry.name[sizeof(entry.name) - 1] = 0;
+
+        entry.offset = read_u32(p + sizeof(entry.name));
+        entry.size = read_u32(p + sizeof(entry.name) + 4);
+        return entry;
+    }
+
+    // The pack loaded by fetch_asset_pack()
+    render::AssetPack& asset_pack()
+    {
+        static render::AssetPack instance;
+        return instance;
+    }
+
+    // Helper
+    void on_pack_loaded(const unsigned char* buffer, int size, const char* url)
+    {
+        std::vector<unsigned char> data(buffer, buffer + size);
+        if (!asset_pack().reset(data)) {
+            ::printf("Invalid asset pack: %s\n", url);
+        }
+    }
+}
+
+bool render::AssetPack::reset(std::vector<unsigned char>& data)
+{
+    if (data.size() < headerSize || ::memcmp(&data[0], "BGLP", 4) != 0) {
+        return false;
+    }
+
+    if (read_u32(&data[4]) != version__) {
+        return false;
+    }
+
+    // Validate index table
+    const unsigned count = read_u32(&data[8]);
+    if ((data.size() - headerSize) / sizeof(index_entry) < count) {
+        return false;
+    }
+
+    // Entry data follows the index table and ends within the pack
+    const ::size_t dataStart = headerSize + count * sizeof(index_entry);
+    for (unsigned i = 0; i != count; ++i)
+    {
+        const index_entry entry = read_entry(data, i);
+        if (entry.offset < dataStart || entry.offset > data.size() || entry.size > data.size() - entry.offset)
+            return false;
+    }
+
+    data_.swap(data);
+    return true;
+}
+
+const unsigned char* render::AssetPack::find(const char* name, int* size) const
+{
+    if (!loaded()) {
+        return nullptr;
+    }
+
+    const unsigned count = read_u32(&data_[8]);
+    for (unsigned i = 0; i != count; ++i)
+    {
+        // Not &data_[offset]; an empty last entry starts at the end
+        const index_entry entry = read_entry(data_, i);
+        if (::strcmp(entry.name, name) == 0)
+            return (*size = entry.size), data_.data() + entry.offset;
+    }
+
+    return nullptr;
+}
+
+bool render::AssetPack::loaded() const {
+    return !data_.empty();
+}
+
+void render::fetch_asset_pack(const char* url)
+{
+#ifdef __EMSCRIPTEN__
+    emscripten_async_wget_data(url, const_cast<char*>(url), [](void* arg, void* buffer, int size) {
+        on_pack_loaded(static_cast<const unsigned char*>(buffer), size, static_cast<const char*>(arg));
+    }, [](void* arg) {
+        ::printf("Could not load asset pack: %s\n", static_cast<const char*>(arg));
+    });
+#else
+    std::vector<unsigned char> mem;
+
+    if (FILE* file = ::fopen(url, "rb"))
+    {
+        unsigned char buff[4096];
+        for (::size_t n; (n = ::fread(buff, 1, sizeof(buff), file)) != 0; )
+            mem.insert(mem.end(), buff, buff + n);
+        ::fclose(file);
+    }
+
+    on_pack_loaded(mem.data(), mem.size(), url);
+#endif
+}
+
+const render::AssetPack& render::get_asset_pack() {
+    return asset_pack();
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#ifndef ASSET_PACK_HPP
+#define ASSET_PACK_HPP
+
+#include <vector>
+
+namespace render {
+
+    //! class AssetPack
+    /*! Read-only view of a packed asset bundle; built by tools/pack_assets.py
+     *!
+     *! Layout (little-endian):
+     *!   header  { char magic[4] = "BGLP"; u32 version; u32 count; }
+     *!   index   { char name[56]; u32 offset; u32 size; } x count
+     *!   data    asset bytes, offsets relative to start of pack
+     */
+    class AssetPack {
+    public:
+
+        static const unsigned version__ = 1;
+        static const unsigned namelen__ = 56;
+
+        /// ctor.
+        AssetPack() {}
+        /// Takes ownership of pack data
+        /// @return false if data is not a valid pack
+        bool reset(std::vector<unsigned char>& data);
+        /// @param name asset name (path relative to images/)
+        /// @param size asset size
+        /// @return asset data or nullptr if not found;
+        ///         valid for the lifetime of the pack
+        const unsigned char* find(const char* name, int* size /* [out] */) const;
+        /// @return true if pack data is loaded
+        bool loaded() const;
+
+    private:
+
+        AssetPack(const AssetPack&);
+        AssetPack& operator=(const AssetPack&);
+
+        // Pack data
+        std::vector<unsigned char> data_;
+    };
+
+    /// Starts loading the asset pack used by register_texture(const char*, ...);
+    /// asynchronous in wasm builds
+    /// @param url pack location, relative to the page
+    void fetch_asset_pack(const char* url);
+    /// @return the asset pack (empty until loaded)
+    const AssetPack& get_asset_pack();
+}
+
+#endif
@@ -4,6 +4,7 @@
 #include <EGL/egl.h>
 
 #include "box.hpp"
+#include "gl_state.hpp"
 #include "texture.hpp"
 
 namespace {
@@ -66,46 +67,31 @@ render::Box::Box(const unsigned* TAOSrc, unsigned TAOCount, unsigned instanceSiz
 
     // Initialize OpenGL buffers
     glGenVertexArrays(1, &VBO_.mesh);
-    glBindVertexArray(VBO_.mesh);
+    render::state::bind_vertex_array(VBO_.mesh);
 
     glGenBuffers(1, &VBO_.vertex);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_.vertex);
+    render::state::bind_array_buffer(VBO_.vertex);
 
     // Add vertices
     glBufferData(GL_ARRAY_BUFFER, sizeof(VERTICES__), VERTICES__, GL_STATIC_DRAW);
 
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(0));
+    glEnableVertexAttribArray(POSITION_ATTRIB);
+    glVertexAttribPointer(POSITION_ATTRIB, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(0));
 
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(TEXCOORD_ATTRIB);
+    glVertexAttribPointer(TEXCOORD_ATTRIB, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
 
     // Instancing
     glGenBuffers(1, &VBO_.instance);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_.instance);
+    render::state::bind_array_buffer(VBO_.instance);
 
     // Null buffer
     glBufferData(GL_ARRAY_BUFFER, instanceSizeMax * 16 * sizeof(float), nullptr, GL_STREAM_DRAW);
 
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, 16 * sizeof(float), (void*)(0));
+    render::enable_instance_matrix();
 
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 16 * sizeof(float), (void*)(4  * sizeof(float)));
-
-    glEnableVertexAttribArray(4);
-    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, 16 * sizeof(float), (void*)(8  * sizeof(float)));
-
-    glEnableVertexAttribArray(5);
-    glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, 16 * sizeof(float), (void*)(12 * sizeof(float)));
-
-    glVertexAttribDivisor(2, 1);
-    glVertexAttribDivisor(3, 1);
-    glVertexAttribDivisor(4, 1);
-    glVertexAttribDivisor(5, 1);
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    render::state::bind_array_buffer(0);
+    render::state::bind_vertex_array(0);
 }
 
 void render::Box::draw() const
@@ -113,20 +99,23 @@ void render::Box::draw() const
     static const unsigned vertexSize = sizeof(VERTICES__) / sizeof(float) / 5;
 
     // Load textures...
-    glBindVertexArray(VBO_.mesh);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    render::state::bind_vertex_array(VBO_.mesh);
 
-    unsigned i = 0;
-    for ( ; i != TAOCount_; ++i)
-    {
-        glActiveTexture(GL_TEXTURE0 + i);
-        glBindTexture(GL_TEXTURE_2D, TAO_[i]);
-    }
+    // Repeated textures are bound once and sampled by single-texture programs
+    render::bind_textures(TAO_, TAOCount_);
 
     // Draw...
     glDrawArraysInstanced(GL_TRIANGLES, 0, vertexSize, VBO_.instanceCount);
 }
 
+unsigned render::Box::get_vertex_array() const {
+    return VBO_.mesh;
+}
+
+unsigned render::Box::get_texture_count() const {
+    return render::count_textures(TAO_, TAOCount_);
+}
+
 void render::Box::modify(const float* mat, unsigned instanceIndex)
 {
     render::modify(VBO_, mat, instanceIndex);
@@ -137,10 +126,19 @@ void render::Box::modify(const float* mat, unsigned* instanceIndices, unsigned c
     render::modify(VBO_, mat, instanceIndices, count);
 }
 
+void render::Box::modify_range(const float* mat, unsigned first, unsigned count)
+{
+    render::modify_range(VBO_, mat, first, count);
+}
+
 void render::Box::reset(const float* mat, unsigned count) {
     render::reset(VBO_, mat, count);
 }
 
+void render::Box::resize(unsigned count) {
+    render::resize(VBO_, count);
+}
+
 void render::Box::push_back(const float* mat) {
     render::push_back(VBO_, mat);
 }
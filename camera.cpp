@@ -15,7 +15,8 @@ Camera::Camera(const calc::vec3f& eye,
                                       , fov_(fov, znear, zfar)
                                       , E_(eye)
                                       , F_(calc::vec3f(0, 0, 1))
-                                      , U_(calc::vec3f(0, 1, 0)) {
+                                      , U_(calc::vec3f(0, 1, 0))
+                                      , sceneBlock_(sizeof(scene_block), render::SCENE_BLOCK) {
     update();
 }
 
@@ -260,6 +261,13 @@ void Camera::update()
 
     scene_.value = projection_.value * lookAt_.value;
     scene_.deviceValue = calc::transpose(scene_.value);
+
+    // Upload once per change, shared by all programs
+    scene_block block;
+    ::memcpy(block.view, calc::data(get_device_look_at()), sizeof(block.view));
+    ::memcpy(block.projection, calc::data(get_device_projection()), sizeof(block.projection));
+    ::memcpy(block.scene, calc::data(get_device_scene()), sizeof(block.scene));
+    sceneBlock_.update(0, &block, sizeof(block));
 }
 
 float Camera::get_screen_width() const {
@@ -279,7 +287,7 @@ const calc::mat4f& Camera::get_scene() const {
 }
 
 const calc::mat4f& Camera::get_device_scene() const {
-    return scene_.value;
+    return scene_.deviceValue;
 }
 
 const calc::mat4f& Camera::get_look_at() const {
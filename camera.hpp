@@ -6,6 +6,7 @@
 #include "matrix.hpp"
 #include "matrix_operation.hpp"
 #include "matrix_transform.hpp"
+#include "uniform_buffer.hpp"
 
 //! @struct ray
 /*! unnormalized ray
@@ -21,7 +22,8 @@ struct ray {
 };
 
 //! @class Camera
-/*! user-modifiable Camera: calculates perspective projection and look-at transformations
+/*! user-modifiable Camera: calculates perspective projection and look-at transformations;
+ *! publishes them to the shared scene uniform block (render::SCENE_BLOCK)
  */
 class Camera {
 public:
@@ -63,7 +65,7 @@ public:
     /// @return ray
     ray unproject(float x, float y, const calc::mat4f& lookAt, const calc::mat4f& projection) const;
 
-    /// Recalculates look-at and projection matrices;
+    /// Recalculates look-at and projection matrices and uploads them to the scene block;
     /// should be alwas called after moving or rotating camera
     void update();
 
@@ -132,6 +134,15 @@ private:
     matrix_pair lookAt_; //> View matrix
     matrix_pair projection_; //> Perspective projection matrix
     matrix_pair scene_; //> Perspective x view
+
+    //! struct scene_block
+    /*! std140 layout of the Scene uniform block
+     */
+    struct scene_block {
+        float view[16], projection[16], scene[16];
+    };
+
+    render::UniformBuffer sceneBlock_; //> Scene uniform block, written by update()
 };
 
 #endif
@@ -0,0 +1,82 @@
+#include "matrix.hpp"
+#include "matrix_operation.hpp"
+
+#include "draw_instanced.hpp"
+#include "uniform_buffer.hpp"
+
+DrawInstanced::DrawInstanced(unsigned features) : features_(features)
+{
+    // Uniforms are resolved by on_link()
+    const uniform unresolved = { -1, -1 };
+    color_ = fogColor_ = fogRange_ = gridSize_ = unresolved;
+
+    // Attribute locations, shared with the drawables' vertex arrays
+    Program::define("POSITION_ATTRIB", render::POSITION_ATTRIB);
+    Program::define("TEXCOORD_ATTRIB", render::TEXCOORD_ATTRIB);
+    Program::define("INSTANCE_ATTRIB", render::INSTANCE_ATTRIB);
+
+    const vertex_shader sh1 = {
+#include "shaders/instanced.vs"
+        , "shaders/instanced.vs"
+    };
+
+    const fragment_shader sh2 = {
+#include "shaders/instanced.fs"
+        , "shaders/instanced.fs"
+    };
+
+    // Select features
+    if (features_ & render::TEXTURED)
+        Program::define("TEXTURED");
+    if (features_ & render::BLENDED)
+        Program::define("BLENDED");
+    if (features_ & render::TILED)
+        Program::define("TILED");
+    if (features_ & render::FOG)
+        Program::define("FOG");
+    if (features_ & render::GRID_INSTANCES)
+        Program::define("GRID_INSTANCES");
+
+    Program::add_shader(sh1, sh2);
+
+    // Submit for linking; finished on first use
+    Program::link();
+}
+
+void DrawInstanced::on_link()
+{
+    // Camera matrices come from the shared scene block
+    Program::bind_uniform_block("Scene", render::SCENE_BLOCK);
+
+    // Resolve uniforms; inactive ones resolve to -1 and are ignored
+    color_ = Program::get_uniform("color");
+    fogColor_ = Program::get_uniform("fogColor");
+    fogRange_ = Program::get_uniform("fogRange");
+    gridSize_ = Program::get_uniform("gridSize");
+
+    // Set textures
+    Program::set_value("texture1", 0);
+    Program::set_value("texture2", 1);
+}
+
+unsigned DrawInstanced::get_features() const {
+    return features_;
+}
+
+void DrawInstanced::set_color(const calc::vec4f& v)
+{
+    Program::set_value_vec4(color_, calc::data(v));
+}
+
+void DrawInstanced::set_grid(unsigned columns, unsigned rows)
+{
+    const int size[] = { int(columns), int(rows) };
+    Program::set_value_ivec2(gridSize_, size);
+}
+
+void DrawInstanced::set_fog(const calc::vec4f& color, float start, float end)
+{
+    const float range[] = { start, end };
+    Program::set_value_vec4(fogColor_, calc::data(color));
+    Program::set_value_vec2(fogRange_, range);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#ifndef DRAW_INSTANCED_HPP
+#define DRAW_INSTANCED_HPP
+
+#include "drawable.hpp"
+#include "program.hpp"
+
+namespace render {
+
+    /// Features of a DrawInstanced variant, combined into its key
+    enum draw_feature {
+        TEXTURED       = 1,  ///> samples texture1; untextured variants use a flat color
+        BLENDED        = 2,  ///> mixes texture2 over texture1 (with TEXTURED)
+        TILED          = 4,  ///> textures repeat once per world unit across scaled instances
+        FOG            = 8,  ///> linear depth fog
+        GRID_INSTANCES = 16  ///> instances are unit squares laid out from gl_InstanceID
+                             ///> (see set_grid()); no instance attribute
+    };
+}
+
+//! class DrawInstanced
+/*! Program for drawing instanced objects to screen; one shared shader
+ *! source, compiled per combination of render::draw_feature
+ */
+class DrawInstanced : public Program {
+public:
+    /// ctor.
+    /// @param features combination of render::draw_feature
+    explicit DrawInstanced(unsigned features);
+    /// @return the features this variant was built with
+    unsigned get_features() const;
+    /// Untextured variants only
+    /// @param v object color
+    void set_color(const calc::vec4f& v);
+    /// GRID_INSTANCES variants only
+    /// @param columns the # of instances along x
+    /// @param rows the # of instances along y
+    void set_grid(unsigned columns, unsigned rows);
+    /// FOG variants only
+    /// @param color fog color
+    /// @param start view depth at which fog starts
+    /// @param end view depth at which fog is opaque
+    void set_fog(const calc::vec4f& color, float start, float end);
+
+protected:
+
+    /// @override
+    void on_link();
+
+private:
+
+    // Combination of render::draw_feature
+    unsigned features_;
+
+    // Uniform handles
+    uniform color_;
+    uniform fogColor_;
+    uniform fogRange_;
+    uniform gridSize_;
+};
+
+/// Linked DrawInstanced variants, by feature set
+typedef ProgramVariants<DrawInstanced> DrawInstancedVariants;
+
+#endif
@@ -2,11 +2,62 @@
 #include <EGL/egl.h>
 
 #include "drawable.hpp"
+#include "gl_state.hpp"
+#include "texture.hpp"
+
+namespace {
+
+    // Helper
+    // @return true if handles[i] repeats an earlier handle
+    inline bool is_repeated(const unsigned* handles, unsigned i)
+    {
+        for (unsigned j = 0; j != i; ++j)
+        {
+            if (handles[j] == handles[i])
+                return true;
+        }
+
+        return false;
+    }
+}
+
+unsigned render::bind_textures(const unsigned* handles, unsigned count)
+{
+    unsigned unit = 0;
+    for (unsigned i = 0; i != count; ++i)
+    {
+        if (!is_repeated(handles, i))
+            render::bind_texture(unit++, handles[i]);
+    }
+
+    return unit;
+}
+
+unsigned render::count_textures(const unsigned* handles, unsigned count)
+{
+    unsigned n = 0;
+    for (unsigned i = 0; i != count; ++i)
+        n += is_repeated(handles, i) ? 0 : 1;
+    return n;
+}
+
+void render::enable_instance_matrix()
+{
+    static const unsigned nbytes = 16 * sizeof(float);
+
+    // One vec4 location per column
+    for (unsigned i = 0; i != 4; ++i)
+    {
+        glEnableVertexAttribArray(INSTANCE_ATTRIB + i);
+        glVertexAttribPointer(INSTANCE_ATTRIB + i, 4, GL_FLOAT, GL_FALSE, nbytes, (void*)(i * 4 * sizeof(float)));
+        glVertexAttribDivisor(INSTANCE_ATTRIB + i, 1);
+    }
+}
 
 void render::modify(vbo& refvbo, const float* mat, unsigned instanceIndex)
 {
     static const unsigned nbytes = 16 * sizeof(float);
-    glBindBuffer(GL_ARRAY_BUFFER, refvbo.instance);
+    render::state::bind_array_buffer(refvbo.instance);
 
     unsigned off = instanceIndex * nbytes;
     glBufferSubData(GL_ARRAY_BUFFER, off, nbytes, mat);
@@ -15,7 +66,7 @@ void render::modify(vbo& refvbo, const float* mat, unsigned instanceIndex)
 void render::modify(vbo& refvbo, const float* mat, unsigned* instanceIndices, unsigned count)
 {
     static const unsigned nbytes = 16 * sizeof(float);
-    glBindBuffer(GL_ARRAY_BUFFER, refvbo.instance);
+    render::state::bind_array_buffer(refvbo.instance);
 
     unsigned i = 0;
     for ( ; i != count; ++i)
@@ -25,19 +76,31 @@ void render::modify(vbo& refvbo, const float* mat, unsigned* instanceIndices, un
     }
 }
 
+void render::modify_range(vbo& refvbo, const float* mat, unsigned first, unsigned count)
+{
+    static const unsigned nbytes = 16 * sizeof(float);
+    render::state::bind_array_buffer(refvbo.instance);
+
+    glBufferSubData(GL_ARRAY_BUFFER, first * nbytes, count * nbytes, mat);
+}
+
 void render::reset(vbo& refvbo, const float* mat, unsigned count)
 {
     static const unsigned nbytes = 16 * sizeof(float);
-    glBindBuffer(GL_ARRAY_BUFFER, refvbo.instance);
+    render::state::bind_array_buffer(refvbo.instance);
 
     refvbo.instanceCount = count;
     glBufferSubData(GL_ARRAY_BUFFER, 0, count * nbytes, mat);
 }
 
+void render::resize(vbo& refvbo, unsigned count) {
+    refvbo.instanceCount = count;
+}
+
 void render::push_back(vbo& refvbo, const float* mat)
 {
     static const unsigned nbytes = 16 * sizeof(float);
-    glBindBuffer(GL_ARRAY_BUFFER, refvbo.instance);
+    render::state::bind_array_buffer(refvbo.instance);
 
     unsigned off = refvbo.instanceCount++ * nbytes;
     glBufferSubData(GL_ARRAY_BUFFER, off, nbytes, mat);
@@ -46,7 +109,7 @@ void render::push_back(vbo& refvbo, const float* mat)
 void render::push_back(vbo& refvbo, const float* mat, unsigned count)
 {
     static const unsigned nbytes = 16 * sizeof(float);
-    glBindBuffer(GL_ARRAY_BUFFER, refvbo.instance);
+    render::state::bind_array_buffer(refvbo.instance);
 
     unsigned offset = refvbo.instanceCount * nbytes;
     glBufferSubData(GL_ARRAY_BUFFER, offset, count * nbytes, mat);
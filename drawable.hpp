@@ -5,8 +5,16 @@
 
 namespace render {
 
+    /// Vertex attribute locations shared by the drawables' vertex arrays
+    /// and the instanced programs (see DrawInstanced)
+    enum vertex_attrib {
+        POSITION_ATTRIB = 0, ///> vec3
+        TEXCOORD_ATTRIB = 1, ///> vec2
+        INSTANCE_ATTRIB = 2  ///> mat4 model matrix, one location per column (2..5)
+    };
+
     /// struct tao
-    /*! OpenGL textures
+    /*! Texture handles (see render::register_texture())
      */
     struct tao { unsigned tao[1024], size; };
     /// struct vbo
@@ -25,14 +33,27 @@ namespace render {
         virtual ~Drawable() {}
         /// Called by renderer to draw all stored object instances
         virtual void draw() const = 0;
+        /// @return the VAO drawn (see Program::expect_vertex_array())
+        virtual unsigned get_vertex_array() const = 0;
+        /// @return the # of distinct textures bound by draw(); repeated
+        /// handles are bound once (see render::BLENDED)
+        virtual unsigned get_texture_count() const = 0;
         /// @param mat model matrix
         virtual void modify(const float* mat, unsigned  instanceIndex) = 0;
         /// @param mat array of model matrices
         /// @param size size of array
         virtual void modify(const float* mat, unsigned* instanceIndices, unsigned size) = 0;
+        /// @param mat array of model matrices, for consecutive instances
+        /// @param first index of the first instance replaced
+        /// @param size size of array
+        virtual void modify_range(const float* mat, unsigned first, unsigned size) = 0;
         /// @param mat array of model matrices
         /// @param size size of array
         virtual void reset(const float* mat, unsigned size) = 0;
+        /// Sets the # of instances drawn, keeping the stored matrices;
+        /// instances past the last stored ones must be modified before drawn
+        /// @param size new # of instances
+        virtual void resize(unsigned size) = 0;
         /// @param mat model matrix
         virtual void push_back(const float* mat) = 0;
         /// @param mat array of model matrices
@@ -40,13 +61,28 @@ namespace render {
         virtual void push_back(const float* mat, unsigned size) = 0;
     };
 
+    /// Sets up the per-instance model matrix at INSTANCE_ATTRIB, sourced
+    /// from the array buffer currently bound; the vertex array must be bound
+    void enable_instance_matrix();
+
+    /// Binds textures to consecutive units, skipping repeated handles
+    /// @param handles texture handles (see render::register_texture())
+    /// @return the # of distinct textures bound
+    unsigned bind_textures(const unsigned* handles, unsigned count);
+    /// @return the # of distinct textures in handles
+    unsigned count_textures(const unsigned* handles, unsigned count);
+
     /// @impl
     void modify(vbo& refvbo, const float* mat, unsigned instanceIndex);
     /// @impl
     void modify(vbo& refvbo, const float* mat, unsigned* instanceIndices, unsigned count);
+    /// @impl
+    void modify_range(vbo& refvbo, const float* mat, unsigned first, unsigned count);
 
     /// @impl
     void reset(vbo& refvbo, const float* mat, unsigned count);
+    /// @impl
+    void resize(vbo& refvbo, unsigned count);
 
     /// @impl
     void push_back(vbo& refvbo, const float* mat);
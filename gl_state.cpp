@@ -0,0 +1,143 @@
+#include <GLES3/gl3.h>
+#include <EGL/egl.h>
+
+#include "gl_state.hpp"
+
+namespace {
+
+    static const unsigned unitCount = 16;
+
+    /// struct shadow
+    /*! Last values set through the cache
+     */
+    struct shadow {
+        unsigned program;
+        unsigned vertexArray;
+        unsigned arrayBuffer;
+        unsigned activeUnit;
+        unsigned textures[unitCount];
+        unsigned samplers[unitCount];
+    };
+
+    // Zero-initialized, matching GL defaults
+    shadow bound;
+
+    // Counters of the current and the last complete frame
+    render::state::counters current = { 0, 0 };
+    render::state::counters last = { 0, 0 };
+}
+
+void render::state::use_program(unsigned handle)
+{
+    if (bound.program == handle) {
+        return record(true);
+    }
+
+    glUseProgram(bound.program = handle);
+    record(false);
+}
+
+void render::state::bind_vertex_array(unsigned vao)
+{
+    if (bound.vertexArray == vao) {
+        return record(true);
+    }
+
+    glBindVertexArray(bound.vertexArray = vao);
+    record(false);
+}
+
+void render::state::bind_array_buffer(unsigned vbo)
+{
+    if (bound.arrayBuffer == vbo) {
+        return record(true);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, bound.arrayBuffer = vbo);
+    record(false);
+}
+
+void render::state::bind_texture(unsigned unit, unsigned tao)
+{
+    if (bound.textures[unit] == tao) {
+        return record(true);
+    }
+
+    if (bound.activeUnit != unit) {
+        glActiveTexture(GL_TEXTURE0 + (bound.activeUnit = unit));
+        record(false);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, bound.textures[unit] = tao);
+    record(false);
+}
+
+void render::state::bind_sampler(unsigned unit, unsigned sampler)
+{
+    if (bound.samplers[unit] == sampler) {
+        return record(true);
+    }
+
+    glBindSampler(unit, bound.samplers[unit] = sampler);
+    record(false);
+}
+
+void render::state::forget_texture(unsigned tao)
+{
+    // Deleting a texture unbinds it from all units
+    for (unsigned i = 0; i != unitCount; ++i)
+    {
+        if (bound.textures[i] == tao)
+            bound.textures[i] = 0;
+    }
+}
+
+void render::state::forget_program(unsigned handle)
+{
+    // The name may be reused by the next program created
+    if (bound.program == handle)
+        bound.program = 0;
+}
+
+void render::state::forget_vertex_array(unsigned vao)
+{
+    // Deleting the bound vertex array binds 0
+    if (bound.vertexArray == vao)
+        bound.vertexArray = 0;
+}
+
+void render::state::forget_buffer(unsigned vbo)
+{
+    // Deleting the bound buffer binds 0
+    if (bound.arrayBuffer == vbo)
+        bound.arrayBuffer = 0;
+}
+
+void render::state::forget_sampler(unsigned sampler)
+{
+    // Deleting a sampler unbinds it from all units
+    for (unsigned i = 0; i != unitCount; ++i)
+    {
+        if (bound.samplers[i] == sampler)
+            bound.samplers[i] = 0;
+    }
+}
+
+void render::state::record(bool elided)
+{
+    if (elided)
+        ++current.elided;
+    else
+        ++current.issued;
+}
+
+void render::state::end_frame()
+{
+    last = current;
+    current.issued = 0;
+    current.elided = 0;
+}
+
+render::state::counters render::state::get_frame_counters() {
+    return last;
+}
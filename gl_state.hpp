@@ -0,0 +1,54 @@
+#pragma once
+
+#ifndef GL_STATE_HPP
+#define GL_STATE_HPP
+
+namespace render {
+
+    //! namespace state
+    /*! Shadows GL binding state and skips calls that would not change it;
+     *! all binds of programs, vertex arrays, array buffers, textures and samplers go through here.
+     *! Owners must call the matching forget_*() before glDelete*(): GL unbinds
+     *! a deleted object, the shadow does not, and glGen*() may hand the name
+     *! out again, whose first bind would then be skipped
+     */
+    namespace state {
+
+        /// struct counters
+        /*! GL calls issued and elided by the cache
+         */
+        struct counters { unsigned issued, elided; };
+
+        /// Binds program unless already bound
+        void use_program(unsigned handle);
+        /// Binds vertex array unless already bound
+        void bind_vertex_array(unsigned vao);
+        /// Binds GL_ARRAY_BUFFER unless already bound
+        void bind_array_buffer(unsigned vbo);
+        /// Binds 2d texture to unit unless already bound;
+        /// the active unit is only switched when a bind is needed
+        void bind_texture(unsigned unit, unsigned tao);
+        /// Binds sampler object to unit unless already bound
+        void bind_sampler(unsigned unit, unsigned sampler);
+        /// Forgets texture; call before deleting it
+        void forget_texture(unsigned tao);
+        /// Forgets program; call before deleting it
+        void forget_program(unsigned handle);
+        /// Forgets vertex array; call before deleting it
+        void forget_vertex_array(unsigned vao);
+        /// Forgets buffer; call before deleting it
+        void forget_buffer(unsigned vbo);
+        /// Forgets sampler; call before deleting it
+        void forget_sampler(unsigned sampler);
+
+        /// Counts a call checked outside the cache (e.g. a uniform write)
+        /// @param elided true if the call was skipped
+        void record(bool elided);
+        /// Closes the current frame's counters
+        void end_frame();
+        /// @return counters of the last complete frame
+        counters get_frame_counters();
+    }
+}
+
+#endif
@@ -1,10 +1,9 @@
-#include <cstring>
-
 #include <GLES3/gl3.h>
 #include <EGL/egl.h>
 
+#include "drawable.hpp"
 #include "grid_square.hpp"
-#include "texture.hpp"
+#include "gl_state.hpp"
 
 namespace {
 
@@ -20,78 +19,48 @@ namespace {
     };
 }
 
-render::GridSquare::GridSquare(unsigned instanceSizeMax)
+render::GridSquare::GridSquare(unsigned columns, unsigned rows) : columns_(columns)
+                                                                , rows_(rows)
 {
-    ::memset(&vbo_, 0, sizeof(vbo_));
-
     // Initialize OpenGL buffers
-    glGenVertexArrays(1, &vbo_.mesh);
-    glBindVertexArray(vbo_.mesh);
+    glGenVertexArrays(1, &mesh_);
+    render::state::bind_vertex_array(mesh_);
 
-    glGenBuffers(1, &vbo_.vertex);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo_.vertex);
+    glGenBuffers(1, &vertex_);
+    render::state::bind_array_buffer(vertex_);
 
     // Add vertices
     glBufferData(GL_ARRAY_BUFFER, sizeof(VERTICES__), VERTICES__, GL_STATIC_DRAW);
 
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)(0));
-
-    // Instancing
-    glGenBuffers(1, &vbo_.instance);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo_.instance);
-
-    // Null buffer
-    glBufferData(GL_ARRAY_BUFFER, instanceSizeMax * 16 * sizeof(float), nullptr, GL_STREAM_DRAW);
-
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 16 * sizeof(float), (void*)(0));
-
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, 16 * sizeof(float), (void*)(4  * sizeof(float)));
+    glEnableVertexAttribArray(POSITION_ATTRIB);
+    glVertexAttribPointer(POSITION_ATTRIB, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)(0));
 
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 16 * sizeof(float), (void*)(8  * sizeof(float)));
-
-    glEnableVertexAttribArray(4);
-    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, 16 * sizeof(float), (void*)(12 * sizeof(float)));
-
-    glVertexAttribDivisor(1, 1);
-    glVertexAttribDivisor(2, 1);
-    glVertexAttribDivisor(3, 1);
-    glVertexAttribDivisor(4, 1);
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    render::state::bind_array_buffer(0);
+    render::state::bind_vertex_array(0);
 }
 
 void render::GridSquare::draw() const
 {
     static const unsigned vertexSize = sizeof(VERTICES__) / sizeof(float) / 3;
-    glBindVertexArray(vbo_.mesh);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    render::state::bind_vertex_array(mesh_);
     // Draw
-    glDrawArraysInstanced(GL_LINE_LOOP, 0, vertexSize, vbo_.instanceCount);
+    glDrawArraysInstanced(GL_LINE_LOOP, 0, vertexSize, columns_ * rows_);
 }
 
-void render::GridSquare::modify(const float* mat, unsigned instanceIndex)
-{
-    render::modify(vbo_, mat, instanceIndex);
+unsigned render::GridSquare::get_vertex_array() const {
+    return mesh_;
 }
 
-void render::GridSquare::modify(const float* mat, unsigned* instanceIndices, unsigned count)
+void render::GridSquare::resize(unsigned columns, unsigned rows)
 {
-    render::modify(vbo_, mat, instanceIndices, count);
-}
-
-void render::GridSquare::reset(const float* mat, unsigned count) {
-    render::reset(vbo_, mat, count);
+    columns_ = columns;
+    rows_ = rows;
 }
 
-void render::GridSquare::push_back(const float* mat) {
-    render::push_back(vbo_, mat);
+unsigned render::GridSquare::get_columns() const {
+    return columns_;
 }
 
-void render::GridSquare::push_back(const float* mat, unsigned count) {
-    render::push_back(vbo_, mat, count);
+unsigned render::GridSquare::get_rows() const {
+    return rows_;
 }
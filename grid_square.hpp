@@ -3,33 +3,38 @@
 #ifndef GRID_SQUARE_HPP
 #define GRID_SQUARE_HPP
 
-#include "drawable.hpp"
-
 namespace render {
 
-    class GridSquare : public Drawable {
+    /// class GridSquare
+    /*! Implements a grid of unit squares, outlined; instances are laid out
+     *! by the program from gl_InstanceID (see render::GRID_INSTANCES),
+     *! so no per-instance data is stored
+     */
+    class GridSquare {
     public:
         GridSquare() {}
         /// ctor.
-        /// @param instanceSizeMax the maximum # of instances to allocate
-        explicit GridSquare(unsigned instanceSizeMax);
-        /// @override
+        /// @param columns the # of squares along x
+        /// @param rows the # of squares along y
+        GridSquare(unsigned columns, unsigned rows);
+        /// Draws columns x rows instances
         void draw() const;
-        /// @override
-        void modify(const float* mat, unsigned  instanceIndex);
-        /// @override
-        void modify(const float* mat, unsigned* instanceIndices, unsigned size);
-        /// @override
-        void reset(const float* mat, unsigned size);
-        /// @override
-        void push_back(const float* mat);
-        /// @override
-        void push_back(const float* mat, unsigned size);
+        /// @return the VAO drawn (see Program::expect_vertex_array())
+        unsigned get_vertex_array() const;
+        /// @param columns the # of squares along x
+        /// @param rows the # of squares along y
+        void resize(unsigned columns, unsigned rows);
+        /// @get
+        unsigned get_columns() const;
+        /// @get
+        unsigned get_rows() const;
 
     private:
 
         // Vertex handles
-        vbo vbo_;
+        unsigned mesh_, vertex_;
+        // Grid size
+        unsigned columns_, rows_;
     };
 }
 
@@ -0,0 +1,315 @@
+#include <algorithm>
+#include <cstring>
+
+#include "stb/stb_image.h"
+
+#include "image_decoder.hpp"
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+#endif
+
+namespace {
+
+    // Helper
+    // @return c * a / 255, rounded
+    inline unsigned char mul255(unsigned c, unsigned a)
+    {
+        const unsigned t = c * a + 128;
+        return (t + (t >> 8)) >> 8;
+    }
+
+    // Helper
+    // Converts a row of pixels to RGBA
+    void convert_row_scalar(const unsigned char* src, unsigned char* dst, int count, int nchannels, unsigned flags)
+    {
+        for (int i = 0; i != count; ++i, src += nchannels, dst += 4)
+        {
+            switch (nchannels)
+            {
+                case 1:
+                    dst[0] = dst[1] = dst[2] = src[0];
+                    dst[3] = 255;
+                    break;
+                case 2:
+                    dst[0] = dst[1] = dst[2] = src[0];
+                    dst[3] = src[1];
+                    break;
+                case 3:
+                    dst[0] = src[0];
+                    dst[1] = src[1];
+                    dst[2] = src[2];
+                    dst[3] = 255;
+                    break;
+                default:
+                    ::memcpy(dst, src, 4);
+                    break;
+            }
+
+            if (flags & render::FORCE_OPAQUE) {
+                dst[3] = 255;
+            }
+
+            else if (flags & render::PREMULTIPLY_ALPHA) {
+                dst[0] = mul255(dst[0], dst[3]);
+                dst[1] = mul255(dst[1], dst[3]);
+                dst[2] = mul255(dst[2], dst[3]);
+            }
+        }
+    }
+
+#if defined(__wasm_simd128__) || defined(__SSE2__)
+
+#if defined(__wasm_simd128__)
+
+    typedef v128_t pixel4;
+
+    inline pixel4 load4(const unsigned char* p) { return wasm_v128_load(p); }
+    inline void store4(unsigned char* p, pixel4 v) { wasm_v128_store(p, v); }
+    inline pixel4 or4(pixel4 a, pixel4 b) { return wasm_v128_or(a, b); }
+    inline pixel4 and4(pixel4 a, pixel4 b) { return wasm_v128_and(a, b); }
+    inline pixel4 splat32(unsigned v) { return wasm_i32x4_splat(v); }
+    inline pixel4 splat64(unsigned long long v) { return wasm_i64x2_splat(v); }
+
+    inline pixel4 widen_lo(pixel4 v) { return wasm_u16x8_extend_low_u8x16(v); }
+    inline pixel4 widen_hi(pixel4 v) { return wasm_u16x8_extend_high_u8x16(v); }
+    inline pixel4 narrow(pixel4 lo, pixel4 hi) { return wasm_u8x16_narrow_i16x8(lo, hi); }
+    inline pixel4 add16(pixel4 a, pixel4 b) { return wasm_i16x8_add(a, b); }
+    inline pixel4 mul16(pixel4 a, pixel4 b) { return wasm_i16x8_mul(a, b); }
+    inline pixel4 shr16_8(pixel4 v) { return wasm_u16x8_shr(v, 8); }
+    inline pixel4 splat16(unsigned short v) { return wasm_i16x8_splat(v); }
+    // Broadcasts each pixel's alpha to its four 16-bit lanes
+    inline pixel4 alpha16(pixel4 v) { return wasm_i16x8_shuffle(v, v, 3, 3, 3, 3, 7, 7, 7, 7); }
+
+#define PIXEL_SHUFFLE
+    inline pixel4 shuffle4(pixel4 v, pixel4 mask) { return wasm_i8x16_swizzle(v, mask); }
+
+#else
+
+    typedef __m128i pixel4;
+
+    inline pixel4 load4(const unsigned char* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+    inline void store4(unsigned char* p, pixel4 v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+    inline pixel4 or4(pixel4 a, pixel4 b) { return _mm_or_si128(a, b); }
+    inline pixel4 and4(pixel4 a, pixel4 b) { return _mm_and_si128(a, b); }
+    inline pixel4 splat32(unsigned v) { return _mm_set1_epi32(v); }
+    inline pixel4 splat64(unsigned long long v) { return _mm_set1_epi64x(v); }
+
+    inline pixel4 widen_lo(pixel4 v) { return _mm_unpacklo_epi8(v, _mm_setzero_si128()); }
+    inline pixel4 widen_hi(pixel4 v) { return _mm_unpackhi_epi8(v, _mm_setzero_si128()); }
+    inline pixel4 narrow(pixel4 lo, pixel4 hi) { return _mm_packus_epi16(lo, hi); }
+    inline pixel4 add16(pixel4 a, pixel4 b) { return _mm_add_epi16(a, b); }
+    inline pixel4 mul16(pixel4 a, pixel4 b) { return _mm_mullo_epi16(a, b); }
+    inline pixel4 shr16_8(pixel4 v) { return _mm_srli_epi16(v, 8); }
+    inline pixel4 splat16(unsigned short v) { return _mm_set1_epi16(v); }
+    // Broadcasts each pixel's alpha to its four 16-bit lanes
+    inline pixel4 alpha16(pixel4 v) { return _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xff), 0xff); }
+
+#if defined(__SSSE3__)
+#define PIXEL_SHUFFLE
+    inline pixel4 shuffle4(pixel4 v, pixel4 mask) { return _mm_shuffle_epi8(v, mask); }
+#endif
+
+#endif
+
+    // Helper
+    // Premultiplies two widened pixels; the alpha lanes are multiplied by 255 and so kept
+    inline pixel4 premultiply2(pixel4 v)
+    {
+        const pixel4 colorLanes = splat64(0x0000ffffffffffffull);
+        const pixel4 alphaLanes = splat64(0x00ff000000000000ull);
+
+        const pixel4 t = add16(mul16(v, or4(and4(alpha16(v), colorLanes), alphaLanes)), splat16(128));
+        return shr16_8(add16(t, shr16_8(t)));
+    }
+
+    // Helper
+    // Converts a row of pixels to RGBA, four at a time
+    // @return the # of pixels converted; the remainder is left to convert_row_scalar()
+    int convert_row_simd(const unsigned char* src, unsigned char* dst, int count, int nchannels, unsigned flags)
+    {
+        const pixel4 alpha = splat32(0xff000000);
+        int i = 0;
+
+#if defined(PIXEL_SHUFFLE)
+        // RGB: 12 bytes in, 16 out; keeps the 16-byte load within the row
+        if (nchannels == 3)
+        {
+            const unsigned char m = 0x80;
+            const unsigned char expand[16] = { 0, 1, 2, m, 3, 4, 5, m, 6, 7, 8, m, 9, 10, 11, m };
+            const pixel4 mask = load4(expand);
+
+            for ( ; i + 6 <= count; i += 4)
+                store4(dst + i * 4, or4(shuffle4(load4(src + i * 3), mask), alpha));
+        }
+#endif
+
+        if (nchannels == 4)
+        {
+            for ( ; i + 4 <= count; i += 4)
+            {
+                pixel4 v = load4(src + i * 4);
+                if (flags & render::FORCE_OPAQUE)
+                    v = or4(v, alpha);
+                else if (flags & render::PREMULTIPLY_ALPHA)
+                    v = narrow(premultiply2(widen_lo(v)), premultiply2(widen_hi(v)));
+                store4(dst + i * 4, v);
+            }
+        }
+
+        return i;
+    }
+
+#else
+
+    // Helper
+    // No SIMD support; convert_row_scalar() does all pixels
+    inline int convert_row_simd(const unsigned char*, unsigned char*, int, int, unsigned) {
+        return 0;
+    }
+
+#endif
+
+    // Helper
+    // Converts decoded pixels to RGBA in one pass, flipping rows if requested
+    // @param simd false leaves all pixels to convert_row_scalar()
+    void convert_image(const unsigned char* src, int width, int height, int nchannels, unsigned flags, bool simd,
+                       unsigned char* dst)
+    {
+        const ::size_t srcStride = width * nchannels;
+        const ::size_t dstStride = width * 4;
+
+        for (int y = 0; y != height; ++y)
+        {
+            const int row = (flags & render::FLIP_VERTICALLY) ? height - 1 - y : y;
+            const unsigned char* srcRow = src + row * srcStride;
+            unsigned char* dstRow = dst + y * dstStride;
+
+            const int n = simd ? convert_row_simd(srcRow, dstRow, width, nchannels, flags) : 0;
+            convert_row_scalar(srcRow + n * nchannels, dstRow + n * 4, width - n, nchannels, flags);
+        }
+    }
+}
+
+void render::convert_pixels(const unsigned char* src, int width, int height, int nchannels, unsigned flags,
+                            unsigned char* dst)
+{
+    convert_image(src, width, height, nchannels, flags, true, dst);
+}
+
+void render::convert_pixels_scalar(const unsigned char* src, int width, int height, int nchannels, unsigned flags,
+                                   unsigned char* dst)
+{
+    convert_image(src, width, height, nchannels, flags, false, dst);
+}
+
+bool render::decode_image(const unsigned char* mem, int memlen, unsigned flags, image& out)
+{
+    out.width = 0;
+    out.height = 0;
+    out.nchannels = 0;
+
+    int nchannels = 0;
+    unsigned char* data = stbi_load_from_memory(mem, memlen, &out.width, &out.height, &nchannels, 0);
+    if (data == nullptr) {
+        return false;
+    }
+
+    out.nchannels = 4;
+    out.pixels.resize(out.width * out.height * 4);
+
+    // stb's own flip is a process-wide flag, which would race between workers
+    convert_pixels(data, out.width, out.height, nchannels, flags, &out.pixels[0]);
+
+    stbi_image_free(data);
+    return true;
+}
+
+render::ImageDecoder::~ImageDecoder()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+
+    cond_.notify_all();
+    for (::size_t i = 0; i != workers_.size(); ++i)
+        workers_[i].join();
+}
+
+render::ImageDecoder::ImageDecoder(unsigned workerCount) : running_(0)
+                                                         , stop_(false)
+                                                         , workerCount_(workerCount)
+{
+    if (workerCount_ == 0) {
+        workerCount_ = std::max(1u, std::min(4u, std::thread::hardware_concurrency()));
+    }
+}
+
+void render::ImageDecoder::push(const job& j)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.push_back(j);
+
+        // Start workers on first use
+        while (workers_.size() != workerCount_)
+            workers_.push_back(std::thread(&ImageDecoder::run, this));
+    }
+
+    cond_.notify_one();
+}
+
+bool render::ImageDecoder::pop(result& out)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (results_.empty()) {
+        return false;
+    }
+
+    std::swap(out, results_.front());
+    results_.pop_front();
+    return true;
+}
+
+unsigned render::ImageDecoder::pending() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return jobs_.size() + running_;
+}
+
+void render::ImageDecoder::run()
+{
+    for (;;)
+    {
+        job j;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (!stop_ && jobs_.empty())
+                cond_.wait(lock);
+
+            if (stop_) {
+                return;
+            }
+
+            j = jobs_.front();
+            jobs_.pop_front();
+            ++running_;
+        }
+
+        // Decode outside the lock
+        result r;
+        r.tag = j.tag;
+        r.ok = decode_image(j.mem, j.memlen, j.flags, r.img);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        results_.push_back(result());
+        std::swap(results_.back(), r);
+        --running_;
+    }
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#ifndef IMAGE_DECODER_HPP
+#define IMAGE_DECODER_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace render {
+
+    /// struct image
+    /*! Decoded pixel buffer, tightly packed
+     */
+    struct image { int width, height, nchannels; std::vector<unsigned char> pixels; };
+
+    /// Pixel conversion flags; see decode_image()
+    enum decode_flags {
+        FLIP_VERTICALLY   = 1,
+        PREMULTIPLY_ALPHA = 2,
+        FORCE_OPAQUE      = 4
+    };
+
+    /// Decodes image data to RGBA; flipping, channel expansion and alpha
+    /// premultiplication (or forcing alpha to 1) are done in one SIMD pass;
+    /// safe to call from any thread
+    /// @param flags combination of decode_flags
+    /// @return false on decoding error
+    bool decode_image(const unsigned char* mem, int memlen, unsigned flags, image& out /* [out] */);
+
+    /// Converts decoded pixels to RGBA as decode_image() does
+    /// @param src width x height pixels of nchannels (1-4) bytes, tightly packed
+    /// @param flags combination of decode_flags
+    /// @param dst [out] width x height RGBA pixels
+    void convert_pixels(const unsigned char* src, int width, int height, int nchannels, unsigned flags,
+                        unsigned char* dst);
+    /// convert_pixels() without the SIMD kernels; its output is the reference
+    /// the kernels match byte for byte (see tools/test_image_decoder.cpp)
+    void convert_pixels_scalar(const unsigned char* src, int width, int height, int nchannels, unsigned flags,
+                               unsigned char* dst);
+
+    //! class ImageDecoder
+    /*! Decodes images on worker threads (pthreads in wasm builds);
+     *! finished pixel buffers are collected by the GL thread for upload
+     */
+    class ImageDecoder {
+    public:
+
+        /// struct job
+        /*! Encoded image; mem must outlive the job
+         */
+        struct job { unsigned tag; const unsigned char* mem; int memlen; unsigned flags; };
+
+        /// struct result
+        /*! Decoded image, tagged with its job's tag
+         */
+        struct result { unsigned tag; bool ok; image img; };
+
+        /// dtor.
+        ~ImageDecoder();
+        /// ctor.
+        /// @param workerCount the # of worker threads; 0 picks one per core (max. 4)
+        explicit ImageDecoder(unsigned workerCount = 0);
+        /// Queues job for decoding; starts the workers on first call
+        void push(const job& j);
+        /// Non-blocking
+        /// @param out the next finished result
+        /// @return false if no result is ready
+        bool pop(result& out /* [out] */);
+        /// @return the # of queued or running jobs
+        unsigned pending() const;
+
+    private:
+
+        // Helper
+        // Worker thread entry point
+        void run();
+
+        ImageDecoder(const ImageDecoder&);
+        ImageDecoder& operator=(const ImageDecoder&);
+
+        // Guards the queues below
+        mutable std::mutex mutex_;
+        // Signalled when a job is queued or on shutdown
+        std::condition_variable cond_;
+        // Jobs waiting for a worker
+        std::deque<job> jobs_;
+        // Results waiting for the GL thread
+        std::deque<result> results_;
+        // Jobs currently being decoded
+        unsigned running_;
+        // Set on destruction
+        bool stop_;
+        // Workers, started lazily
+        unsigned workerCount_;
+        std::vector<std::thread> workers_;
+    };
+}
+
+#endif
@@ -1,4943 +0,0 @@
-unsigned char awesome_face_png[] = {
-  0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d,
-  0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x02, 0x00,
-  0x08, 0x06, 0x00, 0x00, 0x00, 0xf4, 0x78, 0xd4, 0xfa, 0x00, 0x00, 0x00,
-  0x01, 0x73, 0x52, 0x47, 0x42, 0x00, 0xae, 0xce, 0x1c, 0xe9, 0x00, 0x00,
-  0x00, 0x09, 0x70, 0x48, 0x59, 0x73, 0x00, 0x00, 0x0b, 0x13, 0x00, 0x00,
-  0x0b, 0x13, 0x01, 0x00, 0x9a, 0x9c, 0x18, 0x00, 0x00, 0x00, 0x07, 0x74,
-  0x49, 0x4d, 0x45, 0x07, 0xe4, 0x04, 0x17, 0x0a, 0x0c, 0x02, 0x36, 0x63,
-  0x91, 0x24, 0x00, 0x00, 0x00, 0x19, 0x74, 0x45, 0x58, 0x74, 0x46, 0x69,
-  0x6c, 0x65, 0x20, 0x4e, 0x61, 0x6d, 0x65, 0x00, 0x61, 0x77, 0x65, 0x73,
-  0x6f, 0x6d, 0x65, 0x66, 0x61, 0x63, 0x65, 0x2e, 0x70, 0x6e, 0x67, 0x39,
-  0x04, 0x04, 0xa4, 0x00, 0x00, 0x39, 0x88, 0x69, 0x54, 0x58, 0x74, 0x58,
-  0x4d, 0x4c, 0x3a, 0x63, 0x6f, 0x6d, 0x2e, 0x61, 0x64, 0x6f, 0x62, 0x65,
-  0x2e, 0x78, 0x6d, 0x70, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x3f, 0x78,
-  0x70, 0x61, 0x63, 0x6b, 0x65, 0x74, 0x20, 0x62, 0x65, 0x67, 0x69, 0x6e,
-  0x3d, 0x22, 0xef, 0xbb, 0xbf, 0x22, 0x20, 0x69, 0x64, 0x3d, 0x22, 0x57,
-  0x35, 0x4d, 0x30, 0x4d, 0x70, 0x43, 0x65, 0x68, 0x69, 0x48, 0x7a, 0x72,
-  0x65, 0x53, 0x7a, 0x4e, 0x54, 0x63, 0x7a, 0x6b, 0x63, 0x39, 0x64, 0x22,
-  0x3f, 0x3e, 0x0a, 0x3c, 0x78, 0x3a, 0x78, 0x6d, 0x70, 0x6d, 0x65, 0x74,
-  0x61, 0x20, 0x78, 0x6d, 0x6c, 0x6e, 0x73, 0x3a, 0x78, 0x3d, 0x22, 0x61,
-  0x64, 0x6f, 0x62, 0x65, 0x3a, 0x6e, 0x73, 0x3a, 0x6d, 0x65, 0x74, 0x61,
-  0x2f, 0x22, 0x20, 0x78, 0x3a, 0x78, 0x6d, 0x70, 0x74, 0x6b, 0x3d, 0x22,
-  0x41, 0x64, 0x6f, 0x62, 0x65, 0x20, 0x58, 0x4d, 0x50, 0x20, 0x43, 0x6f,
-  0x72, 0x65, 0x20, 0x35, 0x2e, 0x33, 0x2d, 0x63, 0x30, 0x31, 0x31, 0x20,
-  0x36, 0x36, 0x2e, 0x31, 0x34, 0x35, 0x36, 0x36, 0x31, 0x2c, 0x20, 0x32,
-  0x30, 0x31, 0x32, 0x2f, 0x30, 0x32, 0x2f, 0x30, 0x36, 0x2d, 0x31, 0x34,
-  0x3a, 0x35, 0x36, 0x3a, 0x32, 0x37, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x22, 0x3e, 0x0a, 0x20, 0x20, 0x20, 0x3c, 0x72, 0x64, 0x66,
-  0x3a, 0x52, 0x44, 0x46, 0x20, 0x78, 0x6d, 0x6c, 0x6e, 0x73, 0x3a, 0x72,
-  0x64, 0x66, 0x3d, 0x22, 0x68, 0x74, 0x74, 0x70, 0x3a, 0x2f, 0x2f, 0x77,
-  0x77, 0x77, 0x2e, 0x77, 0x33, 0x2e, 0x6f, 0x72, 0x67, 0x2f, 0x31, 0x39,
-  0x39, 0x39, 0x2f, 0x30, 0x32, 0x2f, 0x32, 0x32, 0x2d, 0x72, 0x64, 0x66,
-  0x2d, 0x73, 0x79, 0x6e, 0x74, 0x61, 0x78, 0x2d, 0x6e, 0x73, 0x23, 0x22,
-  0x3e, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x3c, 0x72, 0x64, 0x66,
-  0x3a, 0x44, 0x65, 0x73, 0x63, 0x72, 0x69, 0x70, 0x74, 0x69, 0x6f, 0x6e,
-  0x20, 0x72, 0x64, 0x66, 0x3a, 0x61, 0x62, 0x6f, 0x75, 0x74, 0x3d, 0x22,
-  0x22, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x78, 0x6d, 0x6c, 0x6e, 0x73, 0x3a, 0x78, 0x6d, 0x70, 0x3d,
-  0x22, 0x68, 0x74, 0x74, 0x70, 0x3a, 0x2f, 0x2f, 0x6e, 0x73, 0x2e, 0x61,
-  0x64, 0x6f, 0x62, 0x65, 0x2e, 0x63, 0x6f, 0x6d, 0x2f, 0x78, 0x61, 0x70,
-  0x2f, 0x31, 0x2e, 0x30, 0x2f, 0x22, 0x3e, 0x0a, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x3c, 0x78, 0x6d, 0x70, 0x3a, 0x43, 0x72,
-  0x65, 0x61, 0x74, 0x6f, 0x72, 0x54, 0x6f, 0x6f, 0x6c, 0x3e, 0x41, 0x64,
-  0x6f, 0x62, 0x65, 0x20, 0x50, 0x68, 0x6f, 0x74, 0x6f, 0x73, 0x68, 0x6f,
-  0x70, 0x20, 0x43, 0x53, 0x36, 0x20, 0x28, 0x57, 0x69, 0x6e, 0x64, 0x6f,
-  0x77, 0x73, 0x29, 0x3c, 0x2f, 0x78, 0x6d, 0x70, 0x3a, 0x43, 0x72, 0x65,
-  0x61, 0x74, 0x6f, 0x72, 0x54, 0x6f, 0x6f, 0x6c, 0x3e, 0x0a, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x3c, 0x78, 0x6d, 0x70, 0x3a,
-  0x43, 0x72, 0x65, 0x61, 0x74, 0x65, 0x44, 0x61, 0x74, 0x65, 0x3e, 0x32,
-  0x30, 0x31, 0x38, 0x2d, 0x30, 0x36, 0x2d, 0x31, 0x39, 0x54, 0x32, 0x30,
-  0x3a, 0x32, 0x39, 0x3a, 0x35, 0x34, 0x2b, 0x30, 0x32, 0x3a, 0x30, 0x30,
-  0x3c, 0x2f, 0x78, 0x6d, 0x70, 0x3a, 0x43, 0x72, 0x65, 0x61, 0x74, 0x65,
-  0x44, 0x61, 0x74, 0x65, 0x3e, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x3c, 0x78, 0x6d, 0x70, 0x3a, 0x4d, 0x6f, 0x64, 0x69,
-  0x66, 0x79, 0x44, 0x61, 0x74, 0x65, 0x3e, 0x32, 0x30, 0x32, 0x30, 0x2d,
-  0x30, 0x34, 0x2d, 0x32, 0x33, 0x54, 0x31, 0x32, 0x3a, 0x31, 0x32, 0x3a,
-  0x30, 0x31, 0x2b, 0x30, 0x32, 0x3a, 0x30, 0x30, 0x3c, 0x2f, 0x78, 0x6d,
-  0x70, 0x3a, 0x4d, 0x6f, 0x64, 0x69, 0x66, 0x79, 0x44, 0x61, 0x74, 0x65,
-  0x3e, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x3c,
-  0x78, 0x6d, 0x70, 0x3a, 0x4d, 0x65, 0x74, 0x61, 0x64, 0x61, 0x74, 0x61,
-  0x44, 0x61, 0x74, 0x65, 0x3e, 0x32, 0x30, 0x32, 0x30, 0x2d, 0x30, 0x34,
-  0x2d, 0x32, 0x33, 0x54, 0x31, 0x32, 0x3a, 0x31, 0x32, 0x3a, 0x30, 0x31,
-  0x2b, 0x30, 0x32, 0x3a, 0x30, 0x30, 0x3c, 0x2f, 0x78, 0x6d, 0x70, 0x3a,
-  0x4d, 0x65, 0x74, 0x61, 0x64, 0x61, 0x74, 0x61, 0x44, 0x61, 0x74, 0x65,
-  0x3e, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x3c, 0x2f, 0x72, 0x64,
-  0x66, 0x3a, 0x44, 0x65, 0x73, 0x63, 0x72, 0x69, 0x70, 0x74, 0x69, 0x6f,
-  0x6e, 0x3e, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x3c, 0x72, 0x64,
-  0x66, 0x3a, 0x44, 0x65, 0x73, 0x63, 0x72, 0x69, 0x70, 0x74, 0x69, 0x6f,
-  0x6e, 0x20, 0x72, 0x64, 0x66, 0x3a, 0x61, 0x62, 0x6f, 0x75, 0x74, 0x3d,
-  0x22, 0x22, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x78, 0x6d, 0x6c, 0x6e, 0x73, 0x3a, 0x64, 0x63, 0x3d,
-  0x22, 0x68, 0x74, 0x74, 0x70, 0x3a, 0x2f, 0x2f, 0x70, 0x75, 0x72, 0x6c,
-  0x2e, 0x6f, 0x72, 0x67, 0x2f, 0x64, 0x63, 0x2f, 0x65, 0x6c, 0x65, 0x6d,
-  0x65, 0x6e, 0x74, 0x73, 0x2f, 0x31, 0x2e, 0x31, 0x2f, 0x22, 0x3e, 0x0a,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x3c, 0x64, 0x63,
-  0x3a, 0x66, 0x6f, 0x72, 0x6d, 0x61, 0x74, 0x3e, 0x69, 0x6d, 0x61, 0x67,
-  0x65, 0x2f, 0x70, 0x6e, 0x67, 0x3c, 0x2f, 0x64, 0x63, 0x3a, 0x66, 0x6f,
-  0x72, 0x6d, 0x61, 0x74, 0x3e, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x3c, 0x2f, 0x72, 0x64, 0x66, 0x3a, 0x44, 0x65, 0x73, 0x63, 0x72, 0x69,
-  0x70, 0x74, 0x69, 0x6f, 0x6e, 0x3e, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x3c, 0x72, 0x64, 0x66, 0x3a, 0x44, 0x65, 0x73, 0x63, 0x72, 0x69,
-  0x70, 0x74, 0x69, 0x6f, 0x6e, 0x20, 0x72, 0x64, 0x66, 0x3a, 0x61, 0x62,
-  0x6f, 0x75, 0x74, 0x3d, 0x22, 0x22, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x78, 0x6d, 0x6c, 0x6e, 0x73,
-  0x3a, 0x70, 0x68, 0x6f, 0x74, 0x6f, 0x73, 0x68, 0x6f, 0x70, 0x3d, 0x22,
-  0x68, 0x74, 0x74, 0x70, 0x3a, 0x2f, 0x2f, 0x6e, 0x73, 0x2e, 0x61, 0x64,
-  0x6f, 0x62, 0x65, 0x2e, 0x63, 0x6f, 0x6d, 0x2f, 0x70, 0x68, 0x6f, 0x74,
-  0x6f, 0x73, 0x68, 0x6f, 0x70, 0x2f, 0x31, 0x2e, 0x30, 0x2f, 0x22, 0x3e,
-  0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x3c, 0x70,
-  0x68, 0x6f, 0x74, 0x6f, 0x73, 0x68, 0x6f, 0x70, 0x3a, 0x43, 0x6f, 0x6c,
-  0x6f, 0x72, 0x4d, 0x6f, 0x64, 0x65, 0x3e, 0x33, 0x3c, 0x2f, 0x70, 0x68,
-  0x6f, 0x74, 0x6f, 0x73, 0x68, 0x6f, 0x70, 0x3a, 0x43, 0x6f, 0x6c, 0x6f,
-  0x72, 0x4d, 0x6f, 0x64, 0x65, 0x3e, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x3c, 0x70, 0x68, 0x6f, 0x74, 0x6f, 0x73, 0x68,
-  0x6f, 0x70, 0x3a, 0x49, 0x43, 0x43, 0x50, 0x72, 0x6f, 0x66, 0x69, 0x6c,
-  0x65, 0x3e, 0x73, 0x52, 0x47, 0x42, 0x20, 0x49, 0x45, 0x43, 0x36, 0x31,
-  0x39, 0x36, 0x36, 0x2d, 0x32, 0x2e, 0x31, 0x3c, 0x2f, 0x70, 0x68, 0x6f,
-  0x74, 0x6f, 0x73, 0x68, 0x6f, 0x70, 0x3a, 0x49, 0x43, 0x43, 0x50, 0x72,
-  0x6f, 0x66, 0x69, 0x6c, 0x65, 0x3e, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x3c, 0x2f, 0x72, 0x64, 0x66, 0x3a, 0x44, 0x65, 0x73, 0x63, 0x72,
-  0x69, 0x70, 0x74, 0x69, 0x6f, 0x6e, 0x3e, 0x0a, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x3c, 0x72, 0x64, 0x66, 0x3a, 0x44, 0x65, 0x73, 0x63, 0x72,
-  0x69, 0x70, 0x74, 0x69, 0x6f, 0x6e, 0x20, 0x72, 0x64, 0x66, 0x3a, 0x61,
-  0x62, 0x6f, 0x75, 0x74, 0x3d, 0x22, 0x22, 0x0a, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x78, 0x6d, 0x6c, 0x6e,
-  0x73, 0x3a, 0x78, 0x6d, 0x70, 0x4d, 0x4d, 0x3d, 0x22, 0x68, 0x74, 0x74,
-  0x70, 0x3a, 0x2f, 0x2f, 0x6e, 0x73, 0x2e, 0x61, 0x64, 0x6f, 0x62, 0x65,
-  0x2e, 0x63, 0x6f, 0x6d, 0x2f, 0x78, 0x61, 0x70, 0x2f, 0x31, 0x2e, 0x30,
-  0x2f, 0x6d, 0x6d, 0x2f, 0x22, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x78, 0x6d, 0x6c, 0x6e, 0x73, 0x3a,
-  0x73, 0x74, 0x45, 0x76, 0x74, 0x3d, 0x22, 0x68, 0x74, 0x74, 0x70, 0x3a,
-  0x2f, 0x2f, 0x6e, 0x73, 0x2e, 0x61, 0x64, 0x6f, 0x62, 0x65, 0x2e, 0x63,
-  0x6f, 0x6d, 0x2f, 0x78, 0x61, 0x70, 0x2f, 0x31, 0x2e, 0x30, 0x2f, 0x73,
-  0x54, 0x79, 0x70, 0x65, 0x2f, 0x52, 0x65, 0x73, 0x6f, 0x75, 0x72, 0x63,
-  0x65, 0x45, 0x76, 0x65, 0x6e, 0x74, 0x23, 0x22, 0x3e, 0x0a, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x3c, 0x78, 0x6d, 0x70, 0x4d,
-  0x4d, 0x3a, 0x49, 0x6e, 0x73, 0x74, 0x61, 0x6e, 0x63, 0x65, 0x49, 0x44,
-  0x3e, 0x78, 0x6d, 0x70, 0x2e, 0x69, 0x69, 0x64, 0x3a, 0x31, 0x33, 0x33,
-  0x34, 0x37, 0x37, 0x41, 0x43, 0x34, 0x41, 0x38, 0x35, 0x45, 0x41, 0x31,
-  0x31, 0x42, 0x36, 0x41, 0x45, 0x43, 0x39, 0x43, 0x35, 0x42, 0x38, 0x42,
-  0x35, 0x32, 0x45, 0x45, 0x39, 0x3c, 0x2f, 0x78, 0x6d, 0x70, 0x4d, 0x4d,
-  0x3a, 0x49, 0x6e, 0x73, 0x74, 0x61, 0x6e, 0x63, 0x65, 0x49, 0x44, 0x3e,
-  0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x3c, 0x78,
-  0x6d, 0x70, 0x4d, 0x4d, 0x3a, 0x44, 0x6f, 0x63, 0x75, 0x6d, 0x65, 0x6e,
-  0x74, 0x49, 0x44, 0x3e, 0x78, 0x6d, 0x70, 0x2e, 0x64, 0x69, 0x64, 0x3a,
-  0x31, 0x33, 0x33, 0x34, 0x37, 0x37, 0x41, 0x43, 0x34, 0x41, 0x38, 0x35,
-  0x45, 0x41, 0x31, 0x31, 0x42, 0x36, 0x41, 0x45, 0x43, 0x39, 0x43, 0x35,
-  0x42, 0x38, 0x42, 0x35, 0x32, 0x45, 0x45, 0x39, 0x3c, 0x2f, 0x78, 0x6d,
-  0x70, 0x4d, 0x4d, 0x3a, 0x44, 0x6f, 0x63, 0x75, 0x6d, 0x65, 0x6e, 0x74,
-  0x49, 0x44, 0x3e, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x3c, 0x78, 0x6d, 0x70, 0x4d, 0x4d, 0x3a, 0x4f, 0x72, 0x69, 0x67,
-  0x69, 0x6e, 0x61, 0x6c, 0x44, 0x6f, 0x63, 0x75, 0x6d, 0x65, 0x6e, 0x74,
-  0x49, 0x44, 0x3e, 0x78, 0x6d, 0x70, 0x2e, 0x64, 0x69, 0x64, 0x3a, 0x31,
-  0x33, 0x33, 0x34, 0x37, 0x37, 0x41, 0x43, 0x34, 0x41, 0x38, 0x35, 0x45,
-  0x41, 0x31, 0x31, 0x42, 0x36, 0x41, 0x45, 0x43, 0x39, 0x43, 0x35, 0x42,
-  0x38, 0x42, 0x35, 0x32, 0x45, 0x45, 0x39, 0x3c, 0x2f, 0x78, 0x6d, 0x70,
-  0x4d, 0x4d, 0x3a, 0x4f, 0x72, 0x69, 0x67, 0x69, 0x6e, 0x61, 0x6c, 0x44,
-  0x6f, 0x63, 0x75, 0x6d, 0x65, 0x6e, 0x74, 0x49, 0x44, 0x3e, 0x0a, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x3c, 0x78, 0x6d, 0x70,
-  0x4d, 0x4d, 0x3a, 0x48, 0x69, 0x73, 0x74, 0x6f, 0x72, 0x79, 0x3e, 0x0a,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x3c, 0x72, 0x64, 0x66, 0x3a, 0x53, 0x65, 0x71, 0x3e, 0x0a, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x3c, 0x72, 0x64, 0x66, 0x3a, 0x6c, 0x69, 0x20, 0x72, 0x64, 0x66,
-  0x3a, 0x70, 0x61, 0x72, 0x73, 0x65, 0x54, 0x79, 0x70, 0x65, 0x3d, 0x22,
-  0x52, 0x65, 0x73, 0x6f, 0x75, 0x72, 0x63, 0x65, 0x22, 0x3e, 0x0a, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x3c, 0x73, 0x74, 0x45, 0x76, 0x74, 0x3a,
-  0x61, 0x63, 0x74, 0x69, 0x6f, 0x6e, 0x3e, 0x63, 0x72, 0x65, 0x61, 0x74,
-  0x65, 0x64, 0x3c, 0x2f, 0x73, 0x74, 0x45, 0x76, 0x74, 0x3a, 0x61, 0x63,
-  0x74, 0x69, 0x6f, 0x6e, 0x3e, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x3c, 0x73, 0x74, 0x45, 0x76, 0x74, 0x3a, 0x69, 0x6e, 0x73, 0x74, 0x61,
-  0x6e, 0x63, 0x65, 0x49, 0x44, 0x3e, 0x78, 0x6d, 0x70, 0x2e, 0x69, 0x69,
-  0x64, 0x3a, 0x31, 0x33, 0x33, 0x34, 0x37, 0x37, 0x41, 0x43, 0x34, 0x41,
-  0x38, 0x35, 0x45, 0x41, 0x31, 0x31, 0x42, 0x36, 0x41, 0x45, 0x43, 0x39,
-  0x43, 0x35, 0x42, 0x38, 0x42, 0x35, 0x32, 0x45, 0x45, 0x39, 0x3c, 0x2f,
-  0x73, 0x74, 0x45, 0x76, 0x74, 0x3a, 0x69, 0x6e, 0x73, 0x74, 0x61, 0x6e,
-  0x63, 0x65, 0x49, 0x44, 0x3e, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x3c, 0x73, 0x74, 0x45, 0x76, 0x74, 0x3a, 0x77, 0x68, 0x65, 0x6e, 0x3e,
-  0x32, 0x30, 0x31, 0x38, 0x2d, 0x30, 0x36, 0x2d, 0x31, 0x39, 0x54, 0x32,
-  0x30, 0x3a, 0x32, 0x39, 0x3a, 0x35, 0x34, 0x2b, 0x30, 0x32, 0x3a, 0x30,
-  0x30, 0x3c, 0x2f, 0x73, 0x74, 0x45, 0x76, 0x74, 0x3a, 0x77, 0x68, 0x65,
-  0x6e, 0x3e, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x3c, 0x73, 0x74,
-  0x45, 0x76, 0x74, 0x3a, 0x73, 0x6f, 0x66, 0x74, 0x77, 0x61, 0x72, 0x65,
-  0x41, 0x67, 0x65, 0x6e, 0x74, 0x3e, 0x41, 0x64, 0x6f, 0x62, 0x65, 0x20,
-  0x50, 0x68, 0x6f, 0x74, 0x6f, 0x73, 0x68, 0x6f, 0x70, 0x20, 0x43, 0x53,
-  0x36, 0x20, 0x28, 0x57, 0x69, 0x6e, 0x64, 0x6f, 0x77, 0x73, 0x29, 0x3c,
-  0x2f, 0x73, 0x74, 0x45, 0x76, 0x74, 0x3a, 0x73, 0x6f, 0x66, 0x74, 0x77,
-  0x61, 0x72, 0x65, 0x41, 0x67, 0x65, 0x6e, 0x74, 0x3e, 0x0a, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x3c, 0x2f, 0x72, 0x64, 0x66, 0x3a, 0x6c, 0x69, 0x3e, 0x0a, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x3c,
-  0x2f, 0x72, 0x64, 0x66, 0x3a, 0x53, 0x65, 0x71, 0x3e, 0x0a, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x3c, 0x2f, 0x78, 0x6d, 0x70,
-  0x4d, 0x4d, 0x3a, 0x48, 0x69, 0x73, 0x74, 0x6f, 0x72, 0x79, 0x3e, 0x0a,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x3c, 0x2f, 0x72, 0x64, 0x66, 0x3a,
-  0x44, 0x65, 0x73, 0x63, 0x72, 0x69, 0x70, 0x74, 0x69, 0x6f, 0x6e, 0x3e,
-  0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x3c, 0x72, 0x64, 0x66, 0x3a,
-  0x44, 0x65, 0x73, 0x63, 0x72, 0x69, 0x70, 0x74, 0x69, 0x6f, 0x6e, 0x20,
-  0x72, 0x64, 0x66, 0x3a, 0x61, 0x62, 0x6f, 0x75, 0x74, 0x3d, 0x22, 0x22,
-  0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x78, 0x6d, 0x6c, 0x6e, 0x73, 0x3a, 0x74, 0x69, 0x66, 0x66, 0x3d,
-  0x22, 0x68, 0x74, 0x74, 0x70, 0x3a, 0x2f, 0x2f, 0x6e, 0x73, 0x2e, 0x61,
-  0x64, 0x6f, 0x62, 0x65, 0x2e, 0x63, 0x6f, 0x6d, 0x2f, 0x74, 0x69, 0x66,
-  0x66, 0x2f, 0x31, 0x2e, 0x30, 0x2f, 0x22, 0x3e, 0x0a, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x3c, 0x74, 0x69, 0x66, 0x66, 0x3a,
-  0x4f, 0x72, 0x69, 0x65, 0x6e, 0x74, 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x3e,
-  0x31, 0x3c, 0x2f, 0x74, 0x69, 0x66, 0x66, 0x3a, 0x4f, 0x72, 0x69, 0x65,
-  0x6e, 0x74, 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x3e, 0x0a, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x3c, 0x74, 0x69, 0x66, 0x66, 0x3a,
-  0x58, 0x52, 0x65, 0x73, 0x6f, 0x6c, 0x75, 0x74, 0x69, 0x6f, 0x6e, 0x3e,
-  0x37, 0x32, 0x30, 0x30, 0x30, 0x30, 0x2f, 0x31, 0x30, 0x30, 0x30, 0x30,
-  0x3c, 0x2f, 0x74, 0x69, 0x66, 0x66, 0x3a, 0x58, 0x52, 0x65, 0x73, 0x6f,
-  0x6c, 0x75, 0x74, 0x69, 0x6f, 0x6e, 0x3e, 0x0a, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x3c, 0x74, 0x69, 0x66, 0x66, 0x3a, 0x59,
-  0x52, 0x65, 0x73, 0x6f, 0x6c, 0x75, 0x74, 0x69, 0x6f, 0x6e, 0x3e, 0x37,
-  0x32, 0x30, 0x30, 0x30, 0x30, 0x2f, 0x31, 0x30, 0x30, 0x30, 0x30, 0x3c,
-  0x2f, 0x74, 0x69, 0x66, 0x66, 0x3a, 0x59, 0x52, 0x65, 0x73, 0x6f, 0x6c,
-  0x75, 0x74, 0x69, 0x6f, 0x6e, 0x3e, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x3c, 0x74, 0x69, 0x66, 0x66, 0x3a, 0x52, 0x65,
-  0x73, 0x6f, 0x6c, 0x75, 0x74, 0x69, 0x6f, 0x6e, 0x55, 0x6e, 0x69, 0x74,
-  0x3e, 0x32, 0x3c, 0x2f, 0x74, 0x69, 0x66, 0x66, 0x3a, 0x52, 0x65, 0x73,
-  0x6f, 0x6c, 0x75, 0x74, 0x69, 0x6f, 0x6e, 0x55, 0x6e, 0x69, 0x74, 0x3e,
-  0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x3c, 0x2f, 0x72, 0x64, 0x66,
-  0x3a, 0x44, 0x65, 0x73, 0x63, 0x72, 0x69, 0x70, 0x74, 0x69, 0x6f, 0x6e,
-  0x3e, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x3c, 0x72, 0x64, 0x66,
-  0x3a, 0x44, 0x65, 0x73, 0x63, 0x72, 0x69, 0x70, 0x74, 0x69, 0x6f, 0x6e,
-  0x20, 0x72, 0x64, 0x66, 0x3a, 0x61, 0x62, 0x6f, 0x75, 0x74, 0x3d, 0x22,
-  0x22, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x78, 0x6d, 0x6c, 0x6e, 0x73, 0x3a, 0x65, 0x78, 0x69, 0x66,
-  0x3d, 0x22, 0x68, 0x74, 0x74, 0x70, 0x3a, 0x2f, 0x2f, 0x6e, 0x73, 0x2e,
-  0x61, 0x64, 0x6f, 0x62, 0x65, 0x2e, 0x63, 0x6f, 0x6d, 0x2f, 0x65, 0x78,
-  0x69, 0x66, 0x2f, 0x31, 0x2e, 0x30, 0x2f, 0x22, 0x3e, 0x0a, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x3c, 0x65, 0x78, 0x69, 0x66,
-  0x3a, 0x43, 0x6f, 0x6c, 0x6f, 0x72, 0x53, 0x70, 0x61, 0x63, 0x65, 0x3e,
-  0x31, 0x3c, 0x2f, 0x65, 0x78, 0x69, 0x66, 0x3a, 0x43, 0x6f, 0x6c, 0x6f,
-  0x72, 0x53, 0x70, 0x61, 0x63, 0x65, 0x3e, 0x0a, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x3c, 0x65, 0x78, 0x69, 0x66, 0x3a, 0x50,
-  0x69, 0x78, 0x65, 0x6c, 0x58, 0x44, 0x69, 0x6d, 0x65, 0x6e, 0x73, 0x69,
-  0x6f, 0x6e, 0x3e, 0x35, 0x31, 0x32, 0x3c, 0x2f, 0x65, 0x78, 0x69, 0x66,
-  0x3a, 0x50, 0x69, 0x78, 0x65, 0x6c, 0x58, 0x44, 0x69, 0x6d, 0x65, 0x6e,
-  0x73, 0x69, 0x6f, 0x6e, 0x3e, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x3c, 0x65, 0x78, 0x69, 0x66, 0x3a, 0x50, 0x69, 0x78,
-  0x65, 0x6c, 0x59, 0x44, 0x69, 0x6d, 0x65, 0x6e, 0x73, 0x69, 0x6f, 0x6e,
-  0x3e, 0x35, 0x31, 0x32, 0x3c, 0x2f, 0x65, 0x78, 0x69, 0x66, 0x3a, 0x50,
-  0x69, 0x78, 0x65, 0x6c, 0x59, 0x44, 0x69, 0x6d, 0x65, 0x6e, 0x73, 0x69,
-  0x6f, 0x6e, 0x3e, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x3c, 0x2f,
-  0x72, 0x64, 0x66, 0x3a, 0x44, 0x65, 0x73, 0x63, 0x72, 0x69, 0x70, 0x74,
-  0x69, 0x6f, 0x6e, 0x3e, 0x0a, 0x20, 0x20, 0x20, 0x3c, 0x2f, 0x72, 0x64,
-  0x66, 0x3a, 0x52, 0x44, 0x46, 0x3e, 0x0a, 0x3c, 0x2f, 0x78, 0x3a, 0x78,
-  0x6d, 0x70, 0x6d, 0x65, 0x74, 0x61, 0x3e, 0x0a, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x0a, 0x3c, 0x3f, 0x78, 0x70,
-  0x61, 0x63, 0x6b, 0x65, 0x74, 0x20, 0x65, 0x6e, 0x64, 0x3d, 0x22, 0x77,
-  0x22, 0x3f, 0x3e, 0x89, 0x80, 0x27, 0xcd, 0x00, 0x00, 0x00, 0x18, 0x74,
-  0x45, 0x58, 0x74, 0x53, 0x6f, 0x66, 0x74, 0x77, 0x61, 0x72, 0x65, 0x00,
-  0x41, 0x64, 0x6f, 0x62, 0x65, 0x20, 0x50, 0x68, 0x6f, 0x74, 0x6f, 0x73,
-  0x68, 0x6f, 0x70, 0x34, 0xcb, 0x8e, 0x67, 0x00, 0x00, 0x00, 0x0f, 0x74,
-  0x45, 0x58, 0x74, 0x57, 0x72, 0x69, 0x74, 0x65, 0x72, 0x00, 0x53, 0x75,
-  0x70, 0x65, 0x72, 0x50, 0x4e, 0x47, 0xc5, 0xc4, 0xaf, 0xdd, 0x00, 0x00,
-  0x20, 0x00, 0x49, 0x44, 0x41, 0x54, 0x78, 0xda, 0xec, 0x9d, 0x77, 0x78,
-  0x54, 0x65, 0xf6, 0xc7, 0x3f, 0x77, 0x6a, 0x32, 0xe9, 0x85, 0x74, 0x12,
-  0x02, 0xa1, 0x83, 0x74, 0xe9, 0x20, 0x20, 0x82, 0x02, 0x2a, 0x48, 0xb1,
-  0xbb, 0x96, 0xb5, 0xeb, 0xea, 0xea, 0xda, 0x5d, 0xdd, 0x5d, 0x5d, 0xdd,
-  0xa2, 0xee, 0xcf, 0xb2, 0x6b, 0x5b, 0xc5, 0xb6, 0xea, 0xb2, 0x36, 0x6c,
-  0x28, 0x8a, 0x80, 0x20, 0x02, 0x0a, 0x22, 0xd2, 0x21, 0x21, 0x94, 0x54,
-  0x52, 0x67, 0x92, 0x4c, 0xbf, 0xbf, 0x3f, 0xee, 0x60, 0x47, 0x92, 0x61,
-  0x66, 0x32, 0xe5, 0x7c, 0x9e, 0x87, 0x07, 0x08, 0xdc, 0x7b, 0x67, 0xde,
-  0x72, 0xcf, 0xf7, 0x3d, 0xef, 0x79, 0xcf, 0x01, 0x41, 0x10, 0x04, 0x41,
-  0x10, 0x04, 0x41, 0x10, 0x04, 0x41, 0x10, 0x04, 0x41, 0x10, 0x04, 0x41,
-  0x10, 0x04, 0x41, 0x10, 0x04, 0x41, 0x10, 0x04, 0x41, 0x10, 0x04, 0x41,
-  0x10, 0x04, 0x41, 0x10, 0x04, 0x41, 0x10, 0x04, 0x41, 0x10, 0x04, 0x41,
-  0x10, 0x04, 0x41, 0x10, 0x04, 0x41, 0x10, 0x04, 0x41, 0x10, 0x04, 0x41,
-  0x10, 0x04, 0x41, 0x10, 0x04, 0x41, 0x10, 0x04, 0x41, 0x10, 0x04, 0x41,
-  0x10, 0x04, 0x41, 0x10, 0x04, 0x41, 0x10, 0x04, 0x41, 0x10, 0x04, 0x41,
-  0x10, 0x8e, 0x09, 0x45, 0x9a, 0x40, 0x10, 0x22, 0x0a, 0x03, 0x10, 0x0f,
-  0xa8, 0xbe, 0x3f, 0x5b, 0x7c, 0x3f, 0x8f, 0x07, 0x92, 0x00, 0x6f, 0x3b,
-  0xef, 0xa3, 0x03, 0x1c, 0x40, 0xe3, 0x11, 0xde, 0x03, 0x56, 0xdf, 0xbd,
-  0x74, 0xbe, 0xbf, 0xdb, 0x7d, 0xcf, 0xf4, 0xf8, 0x7e, 0x17, 0x04, 0x41,
-  0x04, 0x80, 0x20, 0x08, 0x01, 0xc2, 0x04, 0x24, 0xf8, 0x8c, 0xb9, 0x09,
-  0xc8, 0x03, 0x26, 0x03, 0x29, 0x40, 0x91, 0xef, 0xe7, 0xb9, 0x80, 0xd1,
-  0x67, 0x84, 0xf5, 0xbe, 0xff, 0x77, 0xd8, 0xa0, 0xeb, 0x3b, 0xf8, 0x3c,
-  0x15, 0x70, 0x1f, 0xe1, 0xe7, 0x0e, 0xdf, 0xef, 0x87, 0xdf, 0x11, 0x2e,
-  0xdf, 0xef, 0x8d, 0x3e, 0x71, 0x50, 0x01, 0xb4, 0x02, 0x7b, 0x80, 0xf5,
-  0xbe, 0xfb, 0xd8, 0x80, 0xda, 0xef, 0x89, 0x05, 0xaf, 0x4f, 0x30, 0x08,
-  0x82, 0x20, 0x02, 0x40, 0x10, 0x62, 0x1e, 0x23, 0xd0, 0xc5, 0x67, 0xc8,
-  0x47, 0xf8, 0x0c, 0x7c, 0x3e, 0x60, 0x06, 0xd2, 0x8f, 0x70, 0x4d, 0x71,
-  0x18, 0x7f, 0x9f, 0xb2, 0x5f, 0xf8, 0x37, 0xab, 0x4f, 0x0c, 0xd8, 0x81,
-  0x5d, 0xc0, 0x6a, 0x60, 0x23, 0x50, 0x0f, 0x1c, 0xf2, 0xfd, 0xdc, 0x2b,
-  0x43, 0x42, 0x10, 0x44, 0x00, 0x08, 0x42, 0x34, 0xcd, 0xab, 0x44, 0x20,
-  0x07, 0x18, 0x07, 0x9c, 0x08, 0x94, 0xf8, 0x56, 0xeb, 0xf1, 0xdf, 0x5b,
-  0xb5, 0x87, 0xbb, 0x71, 0x0f, 0xb6, 0x58, 0x68, 0xf1, 0x79, 0x1a, 0xec,
-  0x40, 0x29, 0xb0, 0x19, 0x58, 0x0a, 0x94, 0xfb, 0xbc, 0x09, 0x2e, 0x19,
-  0x4a, 0x82, 0x20, 0x02, 0x40, 0x10, 0xc2, 0x99, 0x2e, 0x68, 0x2e, 0xfa,
-  0xb3, 0x81, 0x31, 0xbe, 0xd5, 0x7c, 0x4a, 0x8c, 0x1a, 0xf9, 0x40, 0x09,
-  0x04, 0x07, 0xd0, 0x8c, 0xb6, 0xb5, 0xf0, 0x39, 0xf0, 0x12, 0x70, 0x10,
-  0xa8, 0x41, 0x62, 0x10, 0x04, 0x41, 0x04, 0x80, 0x20, 0x74, 0x02, 0x16,
-  0xa0, 0x17, 0x70, 0x3e, 0x30, 0x16, 0x88, 0x43, 0x0b, 0xbe, 0x13, 0x63,
-  0x1f, 0x1a, 0x61, 0xd0, 0xe2, 0xf3, 0x18, 0xd4, 0x02, 0x8b, 0x7d, 0xbf,
-  0x1a, 0x80, 0x36, 0x69, 0x26, 0x41, 0x10, 0x01, 0x20, 0x08, 0x81, 0x24,
-  0xc9, 0x67, 0xf0, 0xff, 0x00, 0x64, 0xfb, 0xfe, 0x6e, 0x12, 0x63, 0x1f,
-  0x56, 0xc2, 0xc0, 0xe9, 0xf3, 0x16, 0xd8, 0x81, 0x27, 0xd1, 0x62, 0x0d,
-  0x0e, 0x20, 0x5b, 0x08, 0x82, 0x20, 0x02, 0x40, 0x10, 0x3a, 0xb8, 0xc2,
-  0x1f, 0x0e, 0xdc, 0x84, 0x16, 0xa8, 0x97, 0x20, 0x06, 0x3f, 0xa2, 0x45,
-  0xc1, 0x76, 0xe0, 0x79, 0xe0, 0x4b, 0xb4, 0x13, 0x0c, 0xb2, 0x7d, 0x20,
-  0x08, 0x22, 0x00, 0x04, 0xe1, 0xdb, 0x39, 0xd0, 0x03, 0xf8, 0x3d, 0xd0,
-  0x07, 0x48, 0x16, 0x83, 0x1f, 0xb5, 0xa2, 0xa0, 0x09, 0xed, 0xe8, 0xe2,
-  0x9f, 0x81, 0x0d, 0x40, 0xa5, 0x34, 0x8d, 0x20, 0x02, 0x40, 0x10, 0x62,
-  0x8b, 0x64, 0xe0, 0x0c, 0xe0, 0x52, 0x34, 0x97, 0xbe, 0x45, 0x0c, 0x7e,
-  0x4c, 0x0a, 0x02, 0xab, 0x4f, 0x14, 0xfc, 0x07, 0x58, 0x04, 0xd4, 0x49,
-  0xd3, 0x08, 0x22, 0x00, 0x04, 0x21, 0xfa, 0xc8, 0x43, 0x8b, 0xd2, 0x9f,
-  0x87, 0x16, 0xa1, 0x6f, 0x12, 0x83, 0x2f, 0x7c, 0x4f, 0x10, 0x38, 0xd1,
-  0x8e, 0x1e, 0xd6, 0x01, 0x77, 0xfa, 0x3c, 0x04, 0x6e, 0x69, 0x1a, 0x41,
-  0x04, 0x80, 0x20, 0x44, 0xae, 0xd1, 0xff, 0x23, 0x30, 0x18, 0xed, 0x5c,
-  0xbe, 0x18, 0x7d, 0xa1, 0xbd, 0xde, 0x01, 0xa7, 0xcf, 0x3b, 0xf0, 0x24,
-  0xf0, 0x3a, 0xda, 0x49, 0x03, 0x41, 0x10, 0x01, 0x20, 0x08, 0x61, 0x4c,
-  0x2e, 0x70, 0x07, 0x70, 0x3c, 0xdf, 0x45, 0xec, 0x8b, 0xd1, 0x17, 0x8e,
-  0xd5, 0x3b, 0xd0, 0x0c, 0xbc, 0x8a, 0x96, 0x8f, 0xa0, 0x4a, 0x9a, 0x45,
-  0x10, 0x01, 0x20, 0x08, 0xe1, 0x41, 0x22, 0xf0, 0x6b, 0xe0, 0x2c, 0xbe,
-  0x0b, 0xe2, 0x13, 0xa3, 0x2f, 0x04, 0x53, 0x0c, 0xbc, 0x0d, 0x3c, 0x8e,
-  0x96, 0x8f, 0x40, 0x10, 0x44, 0x00, 0x08, 0x42, 0x08, 0x31, 0x02, 0x13,
-  0xd0, 0x22, 0xba, 0x65, 0x4f, 0x5f, 0xe8, 0x2c, 0x31, 0x60, 0x45, 0x4b,
-  0x46, 0xf4, 0x10, 0x5a, 0x0c, 0x81, 0x20, 0x88, 0x00, 0x10, 0x84, 0x20,
-  0x51, 0x02, 0x3c, 0xe2, 0x33, 0xf6, 0x62, 0xf4, 0x85, 0x70, 0x12, 0x03,
-  0x4d, 0x68, 0x09, 0xa3, 0x96, 0x22, 0x49, 0x88, 0x04, 0x11, 0x00, 0x82,
-  0x10, 0x10, 0xcc, 0x68, 0x2e, 0xfe, 0xf3, 0x11, 0x17, 0xbf, 0x10, 0x19,
-  0x62, 0x60, 0x37, 0xf0, 0x1b, 0xb4, 0x72, 0xc9, 0x82, 0x20, 0x02, 0x40,
-  0x10, 0x3a, 0x48, 0x6f, 0xe0, 0x5f, 0x68, 0xd1, 0xfc, 0x62, 0xf4, 0x85,
-  0x48, 0x14, 0x02, 0x56, 0xb4, 0xc0, 0xc1, 0x27, 0xd1, 0x92, 0x10, 0x09,
-  0x82, 0x08, 0x00, 0x41, 0x38, 0x02, 0x7a, 0x60, 0x16, 0x70, 0x3b, 0x12,
-  0xc5, 0x2f, 0x44, 0x97, 0x18, 0xa8, 0x00, 0x2e, 0x02, 0xf6, 0x4a, 0x93,
-  0x08, 0x22, 0x00, 0x04, 0xe1, 0x3b, 0xd2, 0x80, 0x47, 0x81, 0x21, 0x68,
-  0x15, 0xf6, 0xc4, 0xe8, 0x0b, 0xd1, 0xec, 0x15, 0xf8, 0x2b, 0xf0, 0x06,
-  0x92, 0x6c, 0x48, 0x10, 0x01, 0x20, 0xc4, 0x30, 0x05, 0x68, 0x2e, 0xd2,
-  0x6c, 0x59, 0xed, 0x0b, 0x31, 0x26, 0x06, 0xec, 0xc0, 0xe7, 0xc0, 0x8d,
-  0x40, 0xbd, 0x34, 0x89, 0x20, 0x02, 0x40, 0x88, 0x15, 0x86, 0x01, 0xff,
-  0x44, 0x8e, 0xf0, 0x09, 0x22, 0x04, 0x9c, 0x3e, 0x01, 0x70, 0x11, 0x5a,
-  0xf5, 0x42, 0x41, 0x10, 0x01, 0x20, 0x44, 0x1d, 0x3a, 0xb4, 0x22, 0x3c,
-  0x37, 0x03, 0xe9, 0xbe, 0x9f, 0x89, 0xe1, 0x6f, 0x07, 0x71, 0x66, 0x3d,
-  0x46, 0x93, 0x8e, 0xd4, 0x24, 0x23, 0x49, 0x09, 0x06, 0x52, 0x93, 0x4d,
-  0x78, 0xbd, 0x2a, 0xa9, 0xc9, 0x26, 0x2c, 0xf1, 0x7a, 0x3c, 0x9e, 0xf6,
-  0x57, 0xb9, 0x35, 0xe8, 0x15, 0x1a, 0x9a, 0x5d, 0xd8, 0x5a, 0x5c, 0x98,
-  0x4c, 0x3a, 0xac, 0x2d, 0x6e, 0x6a, 0x0e, 0xd9, 0xa9, 0xac, 0xb1, 0xff,
-  0xfc, 0x4b, 0x42, 0x01, 0x55, 0x8a, 0xe8, 0x86, 0x4a, 0x08, 0x34, 0xa3,
-  0xe5, 0xb6, 0x78, 0x53, 0x9a, 0x44, 0x10, 0x01, 0x20, 0x44, 0x03, 0xf1,
-  0xc0, 0x4d, 0xc0, 0xe9, 0xbe, 0x15, 0xbf, 0x18, 0xfd, 0xef, 0xd1, 0x25,
-  0xdd, 0x4c, 0xb7, 0xae, 0x09, 0xf4, 0x2e, 0x49, 0xa6, 0x28, 0xd7, 0x42,
-  0x7e, 0x4e, 0x3c, 0x7a, 0x83, 0x9e, 0xec, 0x74, 0x13, 0x85, 0x79, 0x16,
-  0x12, 0x2d, 0x46, 0x92, 0x93, 0x8c, 0xc4, 0x27, 0x18, 0xb0, 0x18, 0x75,
-  0x18, 0xcc, 0x3a, 0x88, 0x33, 0x68, 0x56, 0x39, 0xde, 0x00, 0x46, 0x5d,
-  0xc7, 0x2c, 0xb4, 0xa2, 0x80, 0xdd, 0x0d, 0x0e, 0x2f, 0xe8, 0x15, 0x70,
-  0x7b, 0x69, 0x6b, 0x74, 0x72, 0xb0, 0xaa, 0x0d, 0x55, 0xd5, 0xfe, 0xf9,
-  0xfb, 0xe8, 0xf5, 0x0a, 0xb6, 0x16, 0x37, 0x8d, 0x56, 0x27, 0x46, 0x83,
-  0x0e, 0x97, 0xdb, 0x4b, 0x55, 0xad, 0x9d, 0x86, 0x26, 0xed, 0xa8, 0x7b,
-  0x6d, 0x9d, 0x9d, 0x8a, 0xea, 0x36, 0x54, 0xa0, 0xc9, 0xea, 0x62, 0x7f,
-  0xad, 0x9d, 0xaa, 0x8a, 0x56, 0xca, 0x0f, 0xb6, 0xe0, 0x74, 0x79, 0xa5,
-  0x83, 0xfd, 0x13, 0x03, 0xf5, 0x68, 0x25, 0xaa, 0x97, 0x00, 0xd2, 0x88,
-  0x82, 0x08, 0x00, 0x21, 0xe2, 0xe8, 0x0a, 0x3c, 0x8f, 0x96, 0x9f, 0x3f,
-  0xa6, 0xdd, 0xfc, 0xf1, 0x71, 0x7a, 0x4a, 0x8a, 0x93, 0xe8, 0x5f, 0x92,
-  0x4c, 0x41, 0xbe, 0x85, 0x3e, 0xc5, 0x49, 0xf4, 0xec, 0x96, 0x44, 0x66,
-  0x66, 0x1c, 0x39, 0xe9, 0x66, 0xd2, 0x73, 0x2c, 0x90, 0x6e, 0x02, 0x83,
-  0x0e, 0x74, 0x7a, 0xed, 0x22, 0xd5, 0x03, 0x76, 0x0f, 0x78, 0x54, 0x70,
-  0xab, 0xe0, 0xf1, 0x6a, 0xa6, 0xc0, 0xab, 0x6a, 0x3f, 0x53, 0xd0, 0x7e,
-  0xf7, 0xaa, 0x1d, 0x9b, 0xc9, 0x2a, 0x9a, 0xe1, 0xd7, 0x29, 0xda, 0x9f,
-  0x75, 0x68, 0xcf, 0x8d, 0xd3, 0xff, 0xf2, 0xff, 0x37, 0xf8, 0x84, 0x86,
-  0xa2, 0x80, 0x49, 0xe7, 0xbb, 0x10, 0xcd, 0x3e, 0x39, 0x7d, 0x36, 0xca,
-  0xf7, 0x19, 0x3d, 0xd5, 0xad, 0xec, 0x3b, 0xd8, 0x4a, 0x63, 0xab, 0x9b,
-  0xa6, 0x06, 0x07, 0xa5, 0xfb, 0x5b, 0xa8, 0xac, 0x69, 0x63, 0x5f, 0x55,
-  0x1b, 0x0d, 0xf5, 0x0e, 0x76, 0xee, 0xb5, 0x52, 0x5e, 0xd1, 0x4a, 0x53,
-  0x93, 0x53, 0xbc, 0x0b, 0xbf, 0x2c, 0x04, 0x9a, 0x80, 0x57, 0x80, 0xbf,
-  0x03, 0x1e, 0x69, 0x12, 0x41, 0x04, 0x80, 0x10, 0xce, 0xe8, 0x80, 0xf1,
-  0xc0, 0xdf, 0x88, 0xd1, 0xa4, 0x3d, 0x3d, 0xbb, 0x25, 0xd2, 0xbb, 0x67,
-  0x0a, 0x23, 0x06, 0xa4, 0x51, 0xd2, 0x3d, 0x99, 0x92, 0xae, 0x09, 0x74,
-  0xef, 0x9a, 0x40, 0x66, 0x9e, 0x05, 0x32, 0xe2, 0xc0, 0xa8, 0x07, 0xaf,
-  0x57, 0x33, 0xde, 0x2e, 0x2f, 0x38, 0x3c, 0xd0, 0xe6, 0xd1, 0xfe, 0xac,
-  0x82, 0x1a, 0x61, 0x16, 0x51, 0x51, 0xf8, 0xce, 0x6d, 0x70, 0xf8, 0x8d,
-  0x12, 0xa7, 0x07, 0x8b, 0x41, 0x13, 0x0d, 0x06, 0x9f, 0xd8, 0xd0, 0x29,
-  0xda, 0xf0, 0x70, 0xb8, 0xa0, 0xde, 0x81, 0xad, 0xc9, 0x49, 0x4d, 0x8d,
-  0x9d, 0x9d, 0xe5, 0x56, 0xf6, 0x57, 0xb4, 0x52, 0xb6, 0xcf, 0xc6, 0x17,
-  0x5b, 0x1a, 0x39, 0x74, 0xc8, 0xce, 0xb6, 0x3d, 0xcd, 0xd8, 0xed, 0x62,
-  0xef, 0xbe, 0x27, 0x04, 0xda, 0x7c, 0x42, 0xe0, 0xcf, 0x22, 0x04, 0x04,
-  0x11, 0x00, 0x42, 0xb8, 0x61, 0x06, 0xae, 0x03, 0x16, 0x00, 0xa9, 0xbe,
-  0x9f, 0x45, 0xbd, 0xe1, 0xcf, 0xc9, 0x8a, 0x63, 0xc4, 0x71, 0xe9, 0xf4,
-  0xe9, 0x9d, 0xca, 0x84, 0xa1, 0x99, 0x74, 0x2b, 0x4e, 0xa4, 0x6f, 0x51,
-  0x22, 0xfa, 0x1c, 0x8b, 0x66, 0x00, 0x51, 0xc0, 0xe1, 0x86, 0x56, 0xb7,
-  0x66, 0xe8, 0x1d, 0x5e, 0x54, 0x8f, 0x1a, 0xbb, 0x33, 0x4f, 0x05, 0xc5,
-  0xa0, 0x80, 0x49, 0x0f, 0x46, 0xdf, 0xef, 0x16, 0x03, 0xe8, 0xf5, 0xe0,
-  0xf5, 0x40, 0x9b, 0x1b, 0x6c, 0x6e, 0xca, 0xcb, 0xac, 0x1c, 0x38, 0xd8,
-  0xc2, 0x96, 0x3d, 0x56, 0xbe, 0xd8, 0x58, 0xc7, 0xa6, 0x1d, 0x8d, 0x6c,
-  0xdf, 0xd5, 0x4c, 0xb3, 0x2d, 0xa6, 0x33, 0xec, 0x96, 0x01, 0x2d, 0xc0,
-  0x73, 0xc0, 0x83, 0xc8, 0xd6, 0x80, 0x20, 0x02, 0x40, 0xe8, 0x64, 0x12,
-  0xd0, 0xaa, 0xa2, 0x8d, 0x88, 0x85, 0xd5, 0x7e, 0xbf, 0x9e, 0x29, 0x1c,
-  0x37, 0x20, 0x8d, 0xa9, 0xa3, 0xb2, 0x18, 0x72, 0x5c, 0x3a, 0xfd, 0x7a,
-  0x24, 0x61, 0x2e, 0x48, 0x80, 0x78, 0x13, 0x78, 0x3c, 0xe0, 0xf4, 0x80,
-  0xd5, 0xa5, 0xb9, 0xee, 0xbd, 0xaa, 0xb8, 0xb7, 0x3b, 0xf2, 0x32, 0xd2,
-  0x29, 0xda, 0x1b, 0xc9, 0xa0, 0x83, 0x24, 0xa3, 0xe6, 0x45, 0x30, 0xfa,
-  0xb6, 0x19, 0x0e, 0xd9, 0x69, 0xae, 0x6a, 0x65, 0xcb, 0x1e, 0x2b, 0x9b,
-  0xb7, 0x36, 0xb0, 0x6e, 0x73, 0x03, 0x9b, 0xbe, 0x69, 0x60, 0xf3, 0xce,
-  0x26, 0x1c, 0x8e, 0x98, 0x5b, 0x10, 0x1f, 0x16, 0x02, 0x7f, 0x04, 0x16,
-  0xc9, 0xc8, 0x11, 0x44, 0x00, 0x08, 0xa1, 0x26, 0x05, 0x78, 0x02, 0x18,
-  0x1c, 0xcd, 0x86, 0xbf, 0xa4, 0x7b, 0x12, 0x63, 0x87, 0x64, 0x32, 0x6e,
-  0x74, 0x16, 0x23, 0x06, 0xa6, 0x31, 0xa8, 0x5f, 0x1a, 0x64, 0xc5, 0x83,
-  0xc9, 0x00, 0x76, 0x97, 0xcf, 0xd8, 0xbb, 0x51, 0x5d, 0xaa, 0xcc, 0xa6,
-  0x60, 0x79, 0x0c, 0x74, 0x68, 0x9e, 0x82, 0x38, 0x3d, 0x24, 0x1a, 0xb5,
-  0xb6, 0x77, 0xbb, 0xa1, 0xc1, 0xc1, 0xde, 0x52, 0x2b, 0xdb, 0x77, 0x34,
-  0xb1, 0xec, 0xf3, 0x1a, 0x36, 0x7c, 0xd3, 0xc0, 0xfa, 0x8d, 0x75, 0xb1,
-  0xe4, 0x25, 0x38, 0x1c, 0x2c, 0x78, 0x05, 0xb0, 0x5e, 0x06, 0x8b, 0x20,
-  0x02, 0x40, 0x08, 0x85, 0xe1, 0x7f, 0x83, 0x28, 0xcd, 0xcf, 0x9f, 0x95,
-  0x19, 0xc7, 0xa8, 0x61, 0x99, 0x9c, 0x34, 0x2e, 0x9b, 0x71, 0xa3, 0xb2,
-  0x18, 0xd4, 0x37, 0x15, 0xf2, 0x13, 0xb4, 0x7f, 0xb4, 0x7b, 0xa0, 0xd1,
-  0x09, 0x0e, 0x0f, 0xaa, 0x57, 0x96, 0xf6, 0x9d, 0xee, 0x2d, 0x30, 0xe8,
-  0x20, 0xd9, 0xe8, 0xdb, 0x42, 0xd0, 0x81, 0xcd, 0x49, 0x73, 0x99, 0x95,
-  0x35, 0x5b, 0x1b, 0x58, 0xfd, 0x79, 0x0d, 0xcb, 0xd7, 0x68, 0xa2, 0xa0,
-  0xa5, 0x25, 0xaa, 0x93, 0xed, 0x7d, 0xbf, 0x12, 0xe1, 0x02, 0x24, 0xcd,
-  0xb0, 0x20, 0x02, 0x40, 0x08, 0x02, 0x49, 0x68, 0x11, 0xfd, 0x7d, 0xa3,
-  0xcd, 0xf0, 0x0f, 0x1d, 0x9c, 0xce, 0xd4, 0xf1, 0x39, 0x4c, 0x1b, 0x9b,
-  0xc3, 0xe0, 0x81, 0x69, 0xa4, 0x15, 0x27, 0x69, 0x2e, 0x7d, 0xbb, 0x0b,
-  0x9a, 0x9c, 0xd0, 0xe6, 0x46, 0xf5, 0xca, 0x6c, 0x09, 0x7b, 0x4f, 0x81,
-  0x49, 0xa7, 0x89, 0x81, 0x34, 0x93, 0x16, 0x94, 0xd8, 0xec, 0x64, 0xff,
-  0xae, 0x66, 0xd6, 0x7e, 0x79, 0x88, 0x8f, 0x56, 0x54, 0xb2, 0xf2, 0xcb,
-  0x43, 0x6c, 0xdb, 0xd1, 0x14, 0xed, 0x42, 0xa0, 0x0c, 0x2d, 0xd7, 0x86,
-  0x14, 0x1e, 0x12, 0x44, 0x00, 0x08, 0xc7, 0x8c, 0x19, 0xad, 0x22, 0xdf,
-  0x98, 0x68, 0x31, 0xfc, 0x71, 0x16, 0x03, 0x93, 0x46, 0x65, 0x31, 0x75,
-  0x7c, 0x36, 0x53, 0x27, 0xe6, 0x32, 0x60, 0x50, 0x06, 0xa4, 0xc7, 0x6b,
-  0x7b, 0xf8, 0x4d, 0x4e, 0xb0, 0xb9, 0xb4, 0x40, 0x3d, 0x21, 0xb2, 0x5f,
-  0x6c, 0x06, 0x1d, 0xa4, 0x18, 0x21, 0xc9, 0x27, 0x08, 0xaa, 0x5b, 0x59,
-  0xb3, 0xbe, 0x96, 0x15, 0xab, 0xab, 0xf9, 0x70, 0x45, 0x25, 0x9f, 0x7e,
-  0x71, 0x08, 0x77, 0xf4, 0xe5, 0x29, 0x38, 0x2c, 0x04, 0x1e, 0x07, 0xfe,
-  0x21, 0x23, 0x41, 0x10, 0x01, 0x20, 0xf8, 0x83, 0x1e, 0xb8, 0x03, 0x38,
-  0x2b, 0x1a, 0x0c, 0x7f, 0x52, 0x82, 0x81, 0x93, 0x26, 0xe5, 0x31, 0x73,
-  0x6a, 0x3e, 0x93, 0xc6, 0x65, 0x53, 0xd4, 0x27, 0x15, 0x2c, 0x26, 0x68,
-  0x73, 0x41, 0x83, 0x03, 0xd5, 0xee, 0x91, 0xd9, 0x10, 0xc5, 0xde, 0x01,
-  0x14, 0x50, 0xe2, 0xf5, 0xdf, 0x1d, 0xc3, 0xb4, 0x3a, 0xd9, 0xb3, 0xa5,
-  0x81, 0xa5, 0xab, 0xab, 0x79, 0xf7, 0x83, 0x03, 0x7c, 0xb4, 0xb2, 0x0a,
-  0x7b, 0x74, 0x05, 0x13, 0x1e, 0x8e, 0x0f, 0xb8, 0x18, 0xd8, 0x24, 0x83,
-  0x40, 0x10, 0x01, 0x20, 0xb4, 0x97, 0x71, 0xc0, 0x23, 0x44, 0x78, 0xd6,
-  0xbe, 0x84, 0x44, 0x23, 0x33, 0xa7, 0xe4, 0x71, 0xea, 0x89, 0xf9, 0x4c,
-  0x9f, 0x98, 0x43, 0x7a, 0xff, 0x34, 0xd0, 0xe9, 0xa0, 0xd9, 0x09, 0x8d,
-  0x0e, 0xf0, 0xa8, 0xc8, 0x3a, 0x3f, 0x86, 0xbd, 0x03, 0x69, 0x26, 0x48,
-  0x34, 0x81, 0xd3, 0x4d, 0xed, 0xd6, 0x46, 0x3e, 0x5a, 0x5d, 0xcd, 0x1b,
-  0x4b, 0x0f, 0xf2, 0xe1, 0xf2, 0x4a, 0x9a, 0x9a, 0x9c, 0xd1, 0xe4, 0x0d,
-  0xa8, 0x07, 0xa6, 0xa0, 0xe5, 0x12, 0x10, 0x04, 0x11, 0x00, 0xc2, 0xcf,
-  0x92, 0x8b, 0x96, 0x83, 0x3c, 0xa2, 0x0b, 0xf4, 0x4c, 0x9d, 0x94, 0xcb,
-  0x9c, 0x19, 0x85, 0xcc, 0x9a, 0x92, 0x47, 0x7e, 0xff, 0x34, 0x30, 0x1a,
-  0xa0, 0xd1, 0x0e, 0x8d, 0x4e, 0x54, 0xaf, 0xf7, 0xa7, 0xb9, 0x6e, 0x85,
-  0x18, 0xf6, 0x0e, 0xa8, 0x28, 0x06, 0x1d, 0xa4, 0x98, 0x20, 0xc5, 0x0c,
-  0x2e, 0x0f, 0x55, 0xdb, 0x1a, 0x59, 0xfc, 0xd1, 0x41, 0xde, 0xfe, 0xf0,
-  0x20, 0xef, 0x7d, 0x78, 0x80, 0x28, 0x88, 0xf7, 0x3c, 0x2c, 0x04, 0x1e,
-  0xf3, 0x09, 0x7b, 0x41, 0x10, 0x01, 0x20, 0x7c, 0x8b, 0x01, 0xed, 0x3c,
-  0x71, 0xc4, 0x06, 0xf8, 0xf5, 0xeb, 0x9d, 0xc2, 0x99, 0xb3, 0xbb, 0x31,
-  0x7f, 0x56, 0x21, 0xbd, 0x87, 0x65, 0x82, 0xd9, 0x00, 0x4d, 0x0e, 0xcd,
-  0xe8, 0x7b, 0xe4, 0x88, 0x9e, 0xd0, 0x1e, 0x31, 0x00, 0x8a, 0x5e, 0x81,
-  0x54, 0x9f, 0x18, 0x70, 0x7b, 0x29, 0xdf, 0x78, 0x88, 0x45, 0xef, 0xec,
-  0xe3, 0xb5, 0x77, 0xf6, 0xf3, 0xf9, 0x86, 0x43, 0x91, 0xfe, 0x0d, 0x77,
-  0xa0, 0x15, 0x1b, 0x9a, 0x0d, 0x1c, 0x94, 0x0e, 0x17, 0xe4, 0xb5, 0x28,
-  0x9c, 0x02, 0xfc, 0x05, 0x2d, 0xa1, 0x4f, 0x44, 0x19, 0xfe, 0x94, 0x24,
-  0x23, 0x67, 0xcd, 0xee, 0xc6, 0xdc, 0x99, 0x5d, 0x99, 0x32, 0x3e, 0x17,
-  0x72, 0x12, 0xa0, 0xcd, 0x09, 0xb5, 0x76, 0x54, 0x97, 0xd7, 0x97, 0x7a,
-  0x56, 0x10, 0xfc, 0xf4, 0x0c, 0xe8, 0x75, 0x90, 0x61, 0x86, 0xc4, 0x38,
-  0xa8, 0x6f, 0x65, 0xfd, 0xe7, 0x35, 0xbc, 0xf2, 0x56, 0x39, 0xff, 0x7b,
-  0x67, 0x1f, 0xfb, 0x2a, 0x22, 0x36, 0xc8, 0xfe, 0xb0, 0x37, 0xe0, 0x33,
-  0xe0, 0x12, 0x24, 0x9b, 0xa0, 0x08, 0x00, 0x21, 0x26, 0x49, 0x07, 0xde,
-  0x47, 0x73, 0xf7, 0xf7, 0x8e, 0xa4, 0x0f, 0x7e, 0xe2, 0xb8, 0x1c, 0xce,
-  0x3c, 0xbd, 0x88, 0xd9, 0xd3, 0x0b, 0x48, 0xef, 0x9f, 0xae, 0x2d, 0xdd,
-  0xaa, 0xda, 0xa0, 0xd5, 0x8d, 0x2a, 0x23, 0x5a, 0x08, 0xf4, 0x4b, 0x52,
-  0x45, 0x4b, 0x42, 0x94, 0x15, 0x07, 0x06, 0x3d, 0xee, 0x72, 0x2b, 0xaf,
-  0xbf, 0xbf, 0x9f, 0xe7, 0x16, 0x95, 0xf2, 0xde, 0xb2, 0xca, 0x48, 0x16,
-  0x02, 0x0d, 0xc0, 0x3c, 0xa0, 0x54, 0x7a, 0x59, 0x04, 0x80, 0x10, 0x3b,
-  0xdc, 0x09, 0x9c, 0x43, 0x04, 0xb9, 0xfb, 0xd3, 0x53, 0x8c, 0xcc, 0x3b,
-  0xad, 0x1b, 0x97, 0x9d, 0x5b, 0xc2, 0x90, 0x31, 0xd9, 0x90, 0x60, 0x82,
-  0x26, 0x3b, 0xd4, 0x3b, 0xb4, 0x74, 0xbb, 0x32, 0x92, 0x85, 0xa0, 0x7b,
-  0x05, 0x7c, 0xc3, 0x2c, 0xd9, 0x08, 0x99, 0xf1, 0xd0, 0xe6, 0x62, 0xe3,
-  0xca, 0x2a, 0x5e, 0x78, 0x7d, 0x2f, 0x2f, 0xfc, 0xb7, 0x94, 0x43, 0x8d,
-  0x11, 0x17, 0x38, 0x78, 0xd8, 0x1b, 0xf0, 0x15, 0x70, 0xa6, 0x74, 0xb0,
-  0x08, 0x00, 0x21, 0xba, 0xe9, 0x06, 0xfc, 0xcf, 0xb7, 0xfa, 0x8f, 0x08,
-  0xc3, 0x7f, 0xfc, 0x90, 0x0c, 0x7e, 0x75, 0x56, 0x0f, 0xce, 0x9a, 0x55,
-  0x48, 0x6a, 0x9f, 0x34, 0x70, 0x79, 0xa0, 0xba, 0x0d, 0xd5, 0xe9, 0x95,
-  0xd1, 0x2b, 0x74, 0xae, 0x18, 0x30, 0xea, 0x20, 0x5b, 0x4b, 0x0b, 0xdd,
-  0xb8, 0xbd, 0x9e, 0x57, 0xdf, 0xd9, 0xc7, 0x13, 0x2f, 0xec, 0x66, 0xe3,
-  0xd7, 0xf5, 0x91, 0x28, 0x04, 0xea, 0x7d, 0xde, 0x80, 0x32, 0xe9, 0x5c,
-  0x11, 0x00, 0x42, 0xf4, 0xf1, 0x18, 0xda, 0x51, 0xa0, 0x88, 0x58, 0xf5,
-  0x9f, 0x3e, 0xa3, 0x2b, 0x17, 0x9d, 0xd5, 0x83, 0x59, 0xd3, 0x0b, 0x20,
-  0x23, 0x01, 0x1a, 0xdb, 0xb4, 0xf3, 0xfa, 0xb2, 0xda, 0x17, 0xc2, 0xd1,
-  0x2b, 0x90, 0x6e, 0x86, 0x54, 0x2d, 0x56, 0xe0, 0xb5, 0xb7, 0xf6, 0xf1,
-  0xf4, 0x7f, 0x76, 0xb3, 0xe4, 0xa3, 0x8a, 0x48, 0xf4, 0x06, 0x7c, 0x04,
-  0x5c, 0x2d, 0x1d, 0x2b, 0x02, 0x40, 0x88, 0x0e, 0x8a, 0xd1, 0x22, 0xfc,
-  0xc3, 0x7e, 0xd5, 0x9f, 0x91, 0x66, 0xe6, 0xe2, 0x73, 0x4b, 0xf8, 0xd5,
-  0x99, 0xdd, 0xe9, 0x3b, 0x26, 0x0b, 0xd0, 0x41, 0x65, 0x8b, 0xb6, 0xb7,
-  0x2f, 0x01, 0x7d, 0x42, 0xb8, 0xe3, 0x55, 0x51, 0x2c, 0x06, 0xc8, 0xb5,
-  0x80, 0xdb, 0xcb, 0xd7, 0x6b, 0x6a, 0x78, 0x72, 0xe1, 0x4e, 0xfe, 0xfd,
-  0xe2, 0x6e, 0xec, 0xce, 0x88, 0x89, 0xb5, 0x3b, 0x7c, 0x52, 0xe0, 0x14,
-  0xe0, 0x90, 0x74, 0xaa, 0x08, 0x00, 0x21, 0x72, 0x79, 0x04, 0x98, 0x1a,
-  0xee, 0xab, 0xfe, 0x9c, 0xcc, 0x38, 0x6e, 0xb9, 0xb6, 0x3f, 0xe7, 0xcc,
-  0x2f, 0x26, 0xb3, 0x77, 0xba, 0x96, 0x83, 0xbf, 0xaa, 0x0d, 0xd5, 0x23,
-  0x91, 0xfc, 0x42, 0x84, 0x0a, 0x01, 0xa3, 0x4e, 0x13, 0x02, 0x46, 0x3d,
-  0xe5, 0xeb, 0x6b, 0x78, 0xf2, 0xc5, 0xdd, 0x3c, 0xf5, 0xe2, 0x6e, 0x6a,
-  0xeb, 0x1d, 0x91, 0xe4, 0x0d, 0xb8, 0x05, 0x2d, 0x2f, 0x88, 0x20, 0x02,
-  0x40, 0x88, 0x20, 0xba, 0x00, 0xef, 0x02, 0xc9, 0x84, 0x71, 0x84, 0x7f,
-  0x46, 0xaa, 0x89, 0x2b, 0x2f, 0xed, 0xc3, 0x6f, 0x7f, 0xdd, 0x87, 0xd4,
-  0x92, 0x34, 0x68, 0x6a, 0x83, 0x3a, 0x87, 0x96, 0x9d, 0x4f, 0x46, 0xa6,
-  0x10, 0xe9, 0x1c, 0x2e, 0x65, 0x9c, 0x15, 0x0f, 0x16, 0x13, 0x4d, 0xbb,
-  0x1b, 0x79, 0xe4, 0xd9, 0x1d, 0x3c, 0xb1, 0x70, 0x17, 0x07, 0x22, 0xe3,
-  0x18, 0xe1, 0x0e, 0xb4, 0xd8, 0x80, 0x13, 0x7c, 0x82, 0x40, 0x10, 0x01,
-  0x20, 0x84, 0x39, 0xe7, 0xa2, 0xe5, 0xf0, 0x0f, 0xdb, 0x55, 0xbf, 0x5e,
-  0x81, 0x1b, 0xaf, 0xe9, 0xcf, 0x8d, 0x97, 0xf7, 0x25, 0xb3, 0x6f, 0x06,
-  0x34, 0xb7, 0xa1, 0xd6, 0xda, 0xb5, 0x0c, 0x7d, 0x32, 0x22, 0x85, 0x28,
-  0x14, 0x02, 0xa0, 0xa2, 0x64, 0xc4, 0x41, 0x4a, 0x1c, 0x2d, 0x7b, 0x9b,
-  0x78, 0xe2, 0xc5, 0xdd, 0x3c, 0xf1, 0xef, 0x1d, 0xec, 0xdc, 0x6b, 0x8b,
-  0x04, 0x6f, 0x80, 0x15, 0x38, 0x1d, 0x09, 0x10, 0x14, 0x01, 0x20, 0x84,
-  0x2d, 0x46, 0x60, 0x39, 0x90, 0x11, 0xce, 0xab, 0xfe, 0x4b, 0xce, 0x2d,
-  0xe1, 0x77, 0xd7, 0xf6, 0xa7, 0xd7, 0x88, 0x1c, 0xb0, 0xda, 0xa1, 0xa6,
-  0x0d, 0x55, 0x0c, 0xbf, 0x10, 0x2b, 0x1e, 0x01, 0x54, 0x2d, 0xcb, 0x60,
-  0x86, 0x05, 0xb5, 0xca, 0xca, 0xc3, 0xcf, 0xec, 0xe4, 0xef, 0x8f, 0x6e,
-  0xe5, 0x40, 0x65, 0x58, 0x7b, 0x04, 0x0e, 0x6f, 0x09, 0xbc, 0x01, 0xdc,
-  0x2a, 0x1d, 0x29, 0x02, 0x40, 0x08, 0x2f, 0x4a, 0x80, 0xd7, 0x80, 0xa4,
-  0x70, 0x5d, 0xf5, 0x9f, 0x31, 0xb3, 0x90, 0x3b, 0x6f, 0x1c, 0xc8, 0xa0,
-  0x89, 0x79, 0xe0, 0x70, 0xc3, 0xc1, 0x56, 0x71, 0xf5, 0x0b, 0xb1, 0x8b,
-  0x57, 0x45, 0x49, 0x35, 0x41, 0x86, 0x85, 0x96, 0xf2, 0x66, 0x9e, 0x78,
-  0x6e, 0x17, 0x0f, 0x3c, 0xb6, 0x85, 0x8a, 0x1a, 0x7b, 0x38, 0x7f, 0xea,
-  0x1d, 0x40, 0x23, 0x5a, 0xb1, 0x30, 0xb7, 0x74, 0xa2, 0x08, 0x00, 0xa1,
-  0xf3, 0xb9, 0x17, 0x38, 0x83, 0x30, 0x75, 0xf9, 0x1f, 0x3f, 0x24, 0x83,
-  0x3f, 0xde, 0x7c, 0x1c, 0xd3, 0x16, 0xf4, 0x00, 0x8f, 0x0a, 0xfb, 0x5b,
-  0xa4, 0x20, 0x8f, 0x20, 0x1c, 0xf6, 0x08, 0xa8, 0x2a, 0xa4, 0x99, 0x21,
-  0xdd, 0x42, 0x73, 0x69, 0x23, 0x7f, 0xf9, 0xe7, 0x56, 0x1e, 0xfd, 0xd7,
-  0x36, 0x9a, 0x5b, 0xc3, 0xd6, 0xbe, 0x96, 0x01, 0x2d, 0xc0, 0x34, 0xa0,
-  0x42, 0x3a, 0x51, 0x04, 0x80, 0xd0, 0x39, 0x18, 0x80, 0x55, 0x40, 0x2a,
-  0x61, 0xe8, 0xf2, 0x2f, 0xca, 0xb3, 0x70, 0xeb, 0x0d, 0x03, 0xb9, 0xec,
-  0xa2, 0xde, 0x90, 0x6a, 0x86, 0xfd, 0x56, 0x2d, 0x79, 0x8f, 0x44, 0xf5,
-  0x0b, 0xc2, 0x4f, 0x84, 0x00, 0x5e, 0x15, 0xa5, 0x4b, 0x1c, 0xa4, 0xc4,
-  0x53, 0xb5, 0xa9, 0x86, 0x7b, 0x1f, 0xdd, 0xca, 0xa3, 0x4f, 0xef, 0x08,
-  0x67, 0x11, 0xe0, 0x44, 0xcb, 0x28, 0xba, 0x48, 0x3a, 0x50, 0x04, 0x80,
-  0x10, 0x5a, 0xba, 0x02, 0xef, 0x11, 0x86, 0x05, 0x7c, 0xf4, 0xc0, 0xb5,
-  0x57, 0xf4, 0xe5, 0x9e, 0xdb, 0x06, 0x63, 0x29, 0x48, 0x86, 0x6a, 0x1b,
-  0xaa, 0xcd, 0x25, 0x86, 0x5f, 0x10, 0xda, 0xe3, 0x11, 0x40, 0x85, 0x1c,
-  0x0b, 0x58, 0x4c, 0x7c, 0xf3, 0x59, 0x25, 0xf7, 0xfc, 0x65, 0x13, 0xaf,
-  0x2e, 0xde, 0x17, 0xae, 0x9f, 0x78, 0x07, 0x50, 0xee, 0xf3, 0x06, 0x08,
-  0x22, 0x00, 0x84, 0x10, 0x30, 0x0f, 0xf8, 0x13, 0x61, 0xe8, 0xf2, 0x3f,
-  0x79, 0x52, 0x2e, 0x7f, 0xfb, 0xd3, 0x70, 0xfa, 0x8f, 0xcd, 0x85, 0x26,
-  0xbb, 0x16, 0xd9, 0xaf, 0x97, 0x21, 0x26, 0x08, 0x1d, 0x13, 0x02, 0x2a,
-  0x0a, 0x0a, 0x14, 0x26, 0x82, 0x02, 0x4b, 0xde, 0xd8, 0xcb, 0xdd, 0xf7,
-  0x7e, 0xc5, 0xda, 0xaf, 0xea, 0xc2, 0x55, 0x04, 0x34, 0xa3, 0xc5, 0x05,
-  0xc8, 0x51, 0x41, 0x11, 0x00, 0x42, 0x10, 0xf9, 0x18, 0xc8, 0x27, 0xcc,
-  0x5c, 0xfe, 0x5d, 0xb3, 0xe3, 0xb9, 0xff, 0x4f, 0xc3, 0x38, 0xfb, 0x22,
-  0xdf, 0xc7, 0xda, 0x67, 0x93, 0x94, 0xbd, 0x82, 0x70, 0xac, 0x78, 0x55,
-  0x14, 0x93, 0x1e, 0xba, 0x26, 0x82, 0xcd, 0xc9, 0xbf, 0x9f, 0xd9, 0xc9,
-  0x6d, 0x7f, 0xd8, 0x40, 0x4d, 0xf8, 0x25, 0x13, 0x2a, 0x03, 0xda, 0x80,
-  0xe9, 0xc0, 0x7e, 0xe9, 0xb8, 0xc8, 0x41, 0x2f, 0x4d, 0x10, 0x11, 0x98,
-  0x80, 0x35, 0x68, 0x09, 0x7e, 0xc2, 0xca, 0xf8, 0x5f, 0xfb, 0xeb, 0xde,
-  0xbc, 0xfe, 0xfc, 0x09, 0x0c, 0x9b, 0xdc, 0x15, 0x2a, 0x5b, 0xb4, 0x55,
-  0xbf, 0x4e, 0x8e, 0xf5, 0x09, 0xc2, 0xb1, 0x2f, 0xcf, 0x14, 0xf0, 0xaa,
-  0x50, 0x67, 0x47, 0x51, 0x14, 0x86, 0x4e, 0xe9, 0xca, 0xaf, 0xe7, 0x14,
-  0x62, 0x77, 0x7a, 0x59, 0xfb, 0x65, 0x58, 0x65, 0xe9, 0x4d, 0x03, 0x6c,
-  0x68, 0x15, 0x46, 0xbf, 0x04, 0x0e, 0x48, 0xe7, 0x89, 0x00, 0x10, 0x02,
-  0x43, 0x21, 0xf0, 0x29, 0x90, 0x82, 0x76, 0xdc, 0x2f, 0x2c, 0x18, 0x32,
-  0x20, 0x8d, 0x57, 0x9f, 0x1a, 0xcf, 0xe5, 0x37, 0x0e, 0xc6, 0xa4, 0x47,
-  0x0b, 0xf2, 0x53, 0x55, 0xd9, 0xeb, 0x17, 0x84, 0x40, 0xa3, 0x53, 0xc0,
-  0xe9, 0x45, 0xa9, 0x6b, 0x23, 0x2e, 0xc7, 0xc2, 0xf4, 0x33, 0x7a, 0x30,
-  0x63, 0x6c, 0x16, 0x7b, 0xcb, 0x6d, 0x94, 0x96, 0x87, 0x4d, 0x22, 0xa1,
-  0x34, 0xb4, 0x84, 0x41, 0xb3, 0xd0, 0xb6, 0x26, 0x3f, 0x94, 0x8e, 0x8b,
-  0x00, 0x8d, 0x29, 0x4d, 0x10, 0xd6, 0x9c, 0x08, 0x3c, 0x4a, 0x18, 0xed,
-  0xf7, 0xeb, 0x81, 0x7b, 0xef, 0x1c, 0xc2, 0xcd, 0xd7, 0x0d, 0x80, 0xf4,
-  0x38, 0xd8, 0x6b, 0x95, 0x9c, 0xfd, 0x82, 0x10, 0x2a, 0xbc, 0x2a, 0x8a,
-  0x4e, 0x81, 0xe2, 0x24, 0xb0, 0x7b, 0x78, 0xe2, 0xb1, 0xad, 0xdc, 0xf1,
-  0xa7, 0x8d, 0x1c, 0x6a, 0x0a, 0xab, 0xed, 0xf7, 0x1d, 0x68, 0x47, 0x04,
-  0x27, 0x4b, 0x87, 0x89, 0x00, 0x10, 0xfc, 0xe3, 0x41, 0xb4, 0x8a, 0x5c,
-  0x61, 0xe3, 0xf2, 0x1f, 0x77, 0x7c, 0x17, 0x9e, 0xfc, 0xbf, 0xd1, 0xf4,
-  0x1d, 0x95, 0x07, 0x75, 0x36, 0xd4, 0x06, 0xa7, 0x04, 0xf9, 0x09, 0x42,
-  0x67, 0xe0, 0x51, 0x51, 0x12, 0x0c, 0x90, 0x9b, 0x4c, 0xcd, 0xae, 0x3a,
-  0x6e, 0xbe, 0xe3, 0x0b, 0x16, 0xfe, 0x37, 0xac, 0x32, 0xf5, 0x1e, 0x0e,
-  0x0e, 0x1c, 0x89, 0x2f, 0x19, 0xb2, 0x20, 0x02, 0x40, 0x68, 0x1f, 0xab,
-  0x80, 0xcc, 0x70, 0x31, 0xfe, 0x7a, 0xe0, 0x2f, 0x77, 0x0f, 0xe5, 0x86,
-  0xdf, 0x0e, 0x84, 0x04, 0x03, 0x94, 0x59, 0x25, 0x7d, 0xaf, 0x20, 0x74,
-  0x36, 0x87, 0xf3, 0x07, 0xe4, 0x27, 0x40, 0xbc, 0x9e, 0xb7, 0xfe, 0xb3,
-  0x9b, 0x1b, 0x6f, 0xfd, 0x82, 0xdd, 0xfb, 0xc2, 0x66, 0x5b, 0xa0, 0x0c,
-  0xa8, 0x03, 0x26, 0xa0, 0x05, 0x09, 0x0a, 0x22, 0x00, 0x84, 0x5f, 0xc0,
-  0x00, 0x7c, 0x46, 0x18, 0x55, 0xf1, 0x9b, 0x3c, 0x36, 0x9b, 0xc7, 0x1e,
-  0x18, 0x49, 0x9f, 0x91, 0x79, 0x50, 0x63, 0x43, 0x6d, 0x96, 0x55, 0xbf,
-  0x20, 0x84, 0x15, 0xdf, 0x9e, 0x16, 0x48, 0xc2, 0x59, 0xd5, 0xc2, 0xad,
-  0x77, 0x7d, 0xc9, 0x83, 0x4f, 0x6e, 0x0f, 0x27, 0x11, 0xd0, 0xea, 0x13,
-  0x01, 0xf5, 0xd2, 0x59, 0x22, 0x00, 0x84, 0x9f, 0x27, 0x01, 0x58, 0x89,
-  0x16, 0x4c, 0x13, 0x16, 0xfb, 0xfd, 0x7f, 0xbe, 0x7d, 0x30, 0xb7, 0xde,
-  0x36, 0x18, 0xe2, 0xf5, 0x50, 0x2a, 0xab, 0x7e, 0x41, 0x08, 0x6b, 0x3c,
-  0x87, 0xb3, 0x09, 0xc6, 0xb1, 0xec, 0xed, 0x32, 0xae, 0xbb, 0x71, 0x1d,
-  0x9b, 0x77, 0x36, 0x85, 0x8b, 0x08, 0x70, 0x02, 0x27, 0x23, 0x15, 0x05,
-  0xc3, 0x0a, 0x39, 0x05, 0x10, 0x1e, 0xe4, 0xa0, 0x1d, 0xf3, 0x4b, 0x0c,
-  0x07, 0xe3, 0x7f, 0x5c, 0xef, 0x14, 0xde, 0x7b, 0x65, 0x32, 0xf3, 0x2f,
-  0x19, 0x00, 0x8d, 0x76, 0xd4, 0xca, 0x36, 0x6d, 0xd5, 0x2f, 0xc6, 0x5f,
-  0x10, 0xc2, 0x17, 0x9d, 0x02, 0x2d, 0x6e, 0x94, 0x66, 0x27, 0xc5, 0x23,
-  0x73, 0xb8, 0xe2, 0xdc, 0x1e, 0xd8, 0x9a, 0x9c, 0xac, 0xf9, 0xa2, 0xd3,
-  0x8f, 0x0c, 0x1e, 0x3e, 0x21, 0x70, 0x16, 0xb0, 0x1e, 0x38, 0x28, 0x9d,
-  0x25, 0x02, 0x40, 0xd0, 0xe8, 0x89, 0x76, 0x64, 0x26, 0x2c, 0x22, 0xfd,
-  0xaf, 0xbe, 0xb8, 0x37, 0x6f, 0xbe, 0x34, 0x89, 0xbc, 0x81, 0x19, 0x50,
-  0xda, 0x24, 0xf9, 0xfb, 0x05, 0x21, 0x92, 0x38, 0x5c, 0x64, 0xab, 0xce,
-  0x8e, 0x62, 0x31, 0x70, 0xd2, 0xdc, 0x12, 0x26, 0x0c, 0x4d, 0x67, 0xe3,
-  0x97, 0x87, 0x3a, 0x3b, 0x81, 0xd0, 0x61, 0x11, 0x70, 0x2a, 0xb0, 0x01,
-  0x49, 0x18, 0x24, 0x02, 0x40, 0x60, 0x28, 0x5a, 0x19, 0xdf, 0x4e, 0x37,
-  0xfe, 0x19, 0x89, 0x46, 0x5e, 0x7c, 0x6a, 0x3c, 0x37, 0xdc, 0x39, 0x1c,
-  0xc5, 0xed, 0x41, 0x3d, 0xd0, 0x22, 0x09, 0x7d, 0x04, 0x21, 0x92, 0xbd,
-  0x01, 0xad, 0x6e, 0x14, 0xab, 0x93, 0xe2, 0x91, 0xd9, 0x5c, 0x71, 0x5e,
-  0x09, 0xcd, 0xf5, 0x0e, 0x3e, 0xdf, 0xd0, 0xa9, 0xe9, 0x84, 0x0f, 0x8b,
-  0x80, 0x99, 0x68, 0xe5, 0x84, 0xbf, 0x90, 0x8e, 0x12, 0x01, 0x10, 0xab,
-  0x8c, 0x01, 0x9e, 0x0f, 0x07, 0xe3, 0x3f, 0x7d, 0x7c, 0x36, 0xef, 0xbf,
-  0x35, 0x95, 0x91, 0x27, 0x16, 0xc2, 0xbe, 0x26, 0xad, 0x78, 0x8f, 0x04,
-  0xfa, 0x09, 0x42, 0xe4, 0x7b, 0x03, 0xd4, 0xc3, 0xde, 0x00, 0x23, 0xd3,
-  0xe6, 0x95, 0x30, 0xa4, 0x47, 0x12, 0x9f, 0xae, 0xaa, 0xc2, 0xda, 0x79,
-  0xe5, 0x86, 0xd3, 0xd0, 0x4e, 0x38, 0xf5, 0x04, 0x32, 0x80, 0x15, 0xd2,
-  0x51, 0x22, 0x00, 0x62, 0x8d, 0x0b, 0x81, 0xbf, 0x85, 0x83, 0xf1, 0xff,
-  0xe3, 0xcd, 0x83, 0x78, 0xf2, 0xd9, 0x09, 0x24, 0x67, 0xc6, 0x41, 0x69,
-  0xb3, 0x96, 0xc3, 0x5f, 0x5c, 0xfe, 0x82, 0x10, 0x7d, 0xde, 0x00, 0x9b,
-  0x93, 0x3e, 0x13, 0xf2, 0xb9, 0x78, 0x41, 0x31, 0xfb, 0xca, 0x6d, 0x6c,
-  0xde, 0xde, 0xd8, 0x99, 0x9f, 0x2a, 0x13, 0xc8, 0x05, 0x06, 0x00, 0xef,
-  0x48, 0x27, 0x89, 0x00, 0x88, 0x15, 0x2e, 0x07, 0x6e, 0x44, 0x3b, 0xe6,
-  0x97, 0xd6, 0x59, 0x1f, 0xa2, 0x4b, 0xaa, 0x89, 0x37, 0x5f, 0x9c, 0xc4,
-  0x85, 0xd7, 0x0e, 0x82, 0x7a, 0x3b, 0x6a, 0xb5, 0x04, 0xfa, 0x09, 0x42,
-  0xf4, 0x7b, 0x03, 0xb4, 0x74, 0xc2, 0x67, 0x9c, 0xdb, 0x93, 0xbc, 0x24,
-  0x23, 0x1f, 0x7e, 0x54, 0x81, 0xa7, 0xf3, 0xd2, 0xf4, 0x64, 0x02, 0x49,
-  0x22, 0x02, 0x44, 0x00, 0xc4, 0x0a, 0xd7, 0x01, 0x57, 0xd3, 0xc9, 0x67,
-  0xfc, 0x4f, 0x1a, 0x9f, 0xc3, 0xd2, 0xb7, 0xa6, 0x72, 0xdc, 0x84, 0x7c,
-  0xd8, 0xdb, 0x88, 0xea, 0xf0, 0xc8, 0xaa, 0x5f, 0x10, 0x62, 0xc5, 0x1b,
-  0xd0, 0xe4, 0x44, 0xb1, 0x7b, 0x18, 0x36, 0xad, 0x1b, 0x0b, 0x4e, 0xce,
-  0x67, 0xd3, 0x57, 0x75, 0xec, 0xab, 0x68, 0xed, 0x6c, 0x11, 0x30, 0x1c,
-  0x78, 0x53, 0x3a, 0x48, 0x04, 0x40, 0xb4, 0x72, 0xbd, 0x6f, 0xf5, 0xdf,
-  0xa9, 0xc6, 0xff, 0xd6, 0xdf, 0xf4, 0x67, 0xe1, 0x0b, 0x27, 0x90, 0x98,
-  0x16, 0x87, 0x5a, 0xd6, 0xac, 0xad, 0x0c, 0x14, 0x31, 0xfe, 0x82, 0x10,
-  0x53, 0x22, 0xc0, 0xad, 0x42, 0x7d, 0x1b, 0x99, 0x03, 0xd2, 0xb9, 0xf0,
-  0xec, 0x1e, 0x34, 0x1c, 0xb2, 0xb3, 0xb6, 0xf3, 0x02, 0x04, 0x33, 0x81,
-  0x78, 0xb4, 0xa0, 0xe8, 0xb7, 0xa4, 0x83, 0x44, 0x00, 0x44, 0x1b, 0x97,
-  0x77, 0xf6, 0xca, 0xdf, 0xac, 0x53, 0x78, 0xf9, 0xe9, 0x09, 0x5c, 0x7b,
-  0xeb, 0x70, 0x68, 0xf8, 0x9e, 0xcb, 0x5f, 0x10, 0x84, 0xd8, 0x43, 0x41,
-  0x13, 0xfe, 0x75, 0x0e, 0x14, 0x93, 0x9e, 0x93, 0xe7, 0xf7, 0x64, 0x40,
-  0x71, 0x22, 0xef, 0xbf, 0x7f, 0x00, 0x67, 0xe7, 0xec, 0x09, 0x64, 0x02,
-  0x16, 0x64, 0x3b, 0x40, 0x04, 0x40, 0x14, 0x1a, 0xff, 0xeb, 0x3a, 0xd3,
-  0xf8, 0xf7, 0x2d, 0x4e, 0xe2, 0xa3, 0x77, 0xa7, 0x71, 0xc2, 0xa9, 0xc5,
-  0x5a, 0x94, 0x7f, 0xab, 0x5b, 0x8c, 0xbf, 0x20, 0x08, 0x9a, 0x37, 0xa0,
-  0x4d, 0x0b, 0x10, 0xec, 0x37, 0xb1, 0x2b, 0x67, 0xce, 0x28, 0xe0, 0x8b,
-  0x75, 0xb5, 0xec, 0xaf, 0xea, 0x94, 0xd4, 0xfd, 0x12, 0x13, 0x20, 0x02,
-  0x40, 0x8c, 0x7f, 0x20, 0x99, 0x3f, 0xa3, 0x2b, 0x4b, 0xdf, 0x39, 0x89,
-  0x9c, 0xde, 0xa9, 0xb0, 0xa7, 0x49, 0xa2, 0xfc, 0x05, 0x41, 0xf8, 0x91,
-  0x37, 0x40, 0x01, 0x2f, 0x28, 0x75, 0x6d, 0xa4, 0xf5, 0x49, 0xe5, 0xe2,
-  0xf3, 0x4b, 0xb0, 0xd6, 0x3a, 0x58, 0xb3, 0xa1, 0x53, 0x32, 0x08, 0x8a,
-  0x08, 0x10, 0x01, 0x10, 0x15, 0x9c, 0x08, 0xfc, 0xb1, 0x33, 0x8d, 0xff,
-  0xef, 0x7f, 0x3b, 0x80, 0xc7, 0x9e, 0x3b, 0x01, 0x3d, 0x0a, 0x6a, 0xb9,
-  0x4d, 0xa2, 0xfc, 0x05, 0x41, 0x38, 0x82, 0x08, 0xf0, 0x2d, 0x0c, 0xea,
-  0x1d, 0x28, 0x66, 0x3d, 0xd3, 0xe6, 0x97, 0xd0, 0x2b, 0x3b, 0x8e, 0x37,
-  0xdf, 0xdd, 0xdf, 0x19, 0xb5, 0x7c, 0x0f, 0x8b, 0x80, 0x38, 0xb4, 0xe2,
-  0x68, 0x82, 0x08, 0x80, 0x88, 0x62, 0x0c, 0xf0, 0x44, 0x67, 0x1a, 0xff,
-  0x97, 0x1e, 0x1f, 0xcb, 0xb5, 0xb7, 0x8d, 0x80, 0x9a, 0x16, 0xd4, 0x3a,
-  0x07, 0x18, 0xc4, 0xf2, 0x0b, 0x82, 0x70, 0x14, 0x0e, 0xe7, 0x0c, 0x68,
-  0x75, 0x31, 0x70, 0x4a, 0x57, 0xe6, 0x9e, 0x98, 0xcb, 0xca, 0x95, 0x55,
-  0xd4, 0x34, 0x84, 0x3c, 0x8d, 0x70, 0x26, 0x50, 0x84, 0x64, 0x0c, 0x14,
-  0x01, 0x10, 0x61, 0x8c, 0x06, 0x9e, 0x45, 0x4b, 0xf2, 0x13, 0xf2, 0x73,
-  0xfe, 0xb9, 0xe9, 0x66, 0x3e, 0x7c, 0xf3, 0x24, 0x4e, 0x59, 0xd0, 0x0b,
-  0xf6, 0x37, 0xa1, 0xb6, 0xc9, 0x7e, 0xbf, 0x20, 0x08, 0x1d, 0xf1, 0x06,
-  0x28, 0x5a, 0x65, 0xc1, 0xfa, 0x36, 0xb2, 0x06, 0x67, 0x72, 0xc9, 0xbc,
-  0x62, 0xb6, 0x7d, 0x53, 0xcf, 0xb6, 0x3d, 0xd6, 0xce, 0x10, 0x01, 0x3d,
-  0x81, 0x3d, 0xc0, 0x6e, 0xe9, 0x18, 0x11, 0x00, 0xe1, 0x4e, 0x2f, 0xe0,
-  0x55, 0x3a, 0x29, 0xc3, 0xdf, 0xf0, 0x7e, 0xa9, 0xac, 0x5a, 0x7a, 0x0a,
-  0xbd, 0x8f, 0xcf, 0x81, 0xd2, 0x46, 0x54, 0xaf, 0x2a, 0xfb, 0xfd, 0x82,
-  0x20, 0xf8, 0x21, 0x02, 0x7c, 0x42, 0xe0, 0x90, 0x1d, 0x43, 0x97, 0x38,
-  0xe6, 0x5f, 0xd0, 0x0b, 0xc5, 0xe6, 0x62, 0xf9, 0x9a, 0x9a, 0xce, 0x10,
-  0x01, 0xc3, 0x81, 0xd5, 0x40, 0x95, 0x74, 0x8c, 0x08, 0x80, 0x70, 0x25,
-  0x9b, 0x4e, 0xac, 0xea, 0x77, 0xc6, 0xd4, 0x7c, 0x3e, 0x7c, 0x67, 0x1a,
-  0x89, 0x79, 0x09, 0xa8, 0xa5, 0x4d, 0x52, 0xc8, 0x47, 0x10, 0x84, 0x63,
-  0x47, 0xa7, 0x40, 0xb3, 0x0b, 0xc5, 0x0b, 0x27, 0xcc, 0xee, 0x41, 0xdf,
-  0xbc, 0x78, 0xde, 0x7c, 0x67, 0x1f, 0xde, 0xd0, 0x7e, 0x0a, 0x2b, 0x30,
-  0x1b, 0x78, 0x1b, 0x68, 0x92, 0x4e, 0x09, 0xac, 0xce, 0x13, 0x8e, 0x9d,
-  0x24, 0xb4, 0x3a, 0xd7, 0x9d, 0x62, 0xfc, 0xaf, 0xbf, 0xb8, 0x37, 0x0f,
-  0x3e, 0x39, 0x0e, 0xda, 0x3c, 0xa8, 0x95, 0xad, 0xe2, 0xf2, 0x17, 0x04,
-  0x21, 0xb0, 0x78, 0x55, 0x14, 0x93, 0x1e, 0xba, 0x26, 0xb3, 0xf9, 0xd3,
-  0x83, 0xcc, 0x9c, 0xf7, 0x31, 0xfb, 0xaa, 0x43, 0x7a, 0x54, 0xb0, 0x0c,
-  0x70, 0x02, 0x13, 0x80, 0x1a, 0xe9, 0x10, 0x11, 0x00, 0xe1, 0x82, 0x09,
-  0xf8, 0x12, 0x48, 0xe8, 0x0c, 0xe3, 0x7f, 0xdf, 0x6d, 0x83, 0xb9, 0xe5,
-  0xde, 0xe3, 0xa1, 0xa1, 0x4d, 0x0b, 0xf6, 0x13, 0xe3, 0x2f, 0x08, 0x42,
-  0x30, 0x50, 0x01, 0x55, 0x45, 0xe9, 0x91, 0x46, 0xcd, 0xce, 0x7a, 0xe6,
-  0x9c, 0xb9, 0x8c, 0xd5, 0x1b, 0x43, 0x9a, 0x3d, 0xf0, 0xb0, 0x08, 0x18,
-  0x0a, 0xb4, 0x4a, 0x87, 0x88, 0x00, 0x08, 0x87, 0xf6, 0xfb, 0x02, 0x2d,
-  0xd8, 0x2f, 0xe4, 0xc6, 0x7f, 0xe1, 0xc3, 0xa3, 0xb9, 0xe0, 0x9a, 0x41,
-  0x50, 0x65, 0x95, 0x12, 0xbe, 0x82, 0x20, 0x84, 0x06, 0x8f, 0x8a, 0xd2,
-  0x2d, 0x09, 0xec, 0x6e, 0xce, 0x3d, 0x77, 0x39, 0x2f, 0xbd, 0x55, 0x1e,
-  0x6a, 0x11, 0x60, 0x05, 0x86, 0x40, 0xa8, 0x77, 0x22, 0xa2, 0x0f, 0x89,
-  0x01, 0x38, 0x36, 0xd6, 0xa1, 0xd5, 0xb4, 0x0e, 0xa9, 0xf1, 0x37, 0x2a,
-  0x0a, 0x1f, 0xfe, 0x6f, 0x0a, 0xb3, 0x7f, 0xd5, 0x4f, 0x8b, 0xf4, 0xb7,
-  0x4b, 0xa4, 0xbf, 0x20, 0x08, 0x21, 0xe2, 0x70, 0xbe, 0x80, 0x44, 0x23,
-  0x73, 0x2e, 0xe8, 0x89, 0xa7, 0xc1, 0xc1, 0xca, 0xb5, 0xb5, 0xa1, 0x7a,
-  0x7a, 0x9a, 0x6f, 0xf5, 0x7f, 0x36, 0xf0, 0x94, 0x74, 0x86, 0x08, 0x80,
-  0xce, 0x62, 0x19, 0x5a, 0x84, 0x6a, 0x49, 0x28, 0x1f, 0x9a, 0x62, 0x31,
-  0xb0, 0xec, 0xed, 0x93, 0x18, 0x3f, 0xab, 0x04, 0xf6, 0x36, 0xa0, 0x7a,
-  0x24, 0xd2, 0x5f, 0x10, 0x84, 0x4e, 0x10, 0x01, 0x56, 0x17, 0x8a, 0x47,
-  0x65, 0xf2, 0x19, 0x3d, 0xc9, 0x4f, 0xd4, 0xf3, 0xf6, 0xd2, 0x83, 0xa1,
-  0x14, 0x01, 0x36, 0xe0, 0x3c, 0xe0, 0x69, 0xe9, 0x0c, 0x11, 0x00, 0xa1,
-  0xe6, 0x42, 0xe0, 0x64, 0x42, 0x9c, 0xe8, 0x27, 0x27, 0xcd, 0xcc, 0xea,
-  0x0f, 0x4f, 0x66, 0xd0, 0x09, 0x05, 0xa8, 0xa5, 0x0d, 0xda, 0x9e, 0x9c,
-  0xd8, 0x7e, 0x41, 0x10, 0x3a, 0x4b, 0x04, 0xd8, 0x3d, 0x28, 0x6d, 0x4e,
-  0x86, 0x4d, 0xef, 0x4e, 0xbf, 0x6c, 0x13, 0xff, 0x7b, 0x77, 0x7f, 0xa8,
-  0x9e, 0x9e, 0xe9, 0x13, 0x01, 0x53, 0xd0, 0x8e, 0x5e, 0x0b, 0x22, 0x00,
-  0x42, 0x42, 0x0f, 0xe0, 0x9f, 0xa1, 0x36, 0xfe, 0xbd, 0xbb, 0x26, 0xb0,
-  0x6e, 0xc5, 0x4c, 0x8a, 0x06, 0x67, 0xc2, 0x9e, 0x46, 0x5f, 0x19, 0x5f,
-  0xe9, 0x0c, 0x41, 0x10, 0x3a, 0x11, 0x45, 0x01, 0xb7, 0x17, 0xc5, 0x66,
-  0xa7, 0xff, 0x94, 0x6e, 0x64, 0x1b, 0xe0, 0xdd, 0x4f, 0x2a, 0x42, 0x29,
-  0x02, 0x14, 0x9f, 0x47, 0x60, 0xa5, 0x74, 0x86, 0x08, 0x80, 0x60, 0x63,
-  0x04, 0x56, 0x11, 0xe2, 0x2c, 0x7f, 0x43, 0x7a, 0xa7, 0xb0, 0xfc, 0xa3,
-  0x53, 0xe8, 0x52, 0x92, 0x8c, 0xba, 0xbb, 0x59, 0x72, 0xfa, 0x0b, 0x82,
-  0x10, 0x66, 0x22, 0x40, 0x45, 0xb1, 0xbb, 0x18, 0x31, 0xa3, 0x1b, 0x09,
-  0x76, 0x37, 0x4b, 0x57, 0x57, 0x87, 0x52, 0x04, 0xe4, 0xa1, 0xc5, 0x63,
-  0x1d, 0x94, 0xce, 0x10, 0x01, 0x10, 0x4c, 0xd6, 0xa2, 0x9d, 0xf9, 0x0f,
-  0x59, 0xd0, 0xdf, 0xc8, 0x01, 0x69, 0xac, 0x5a, 0x3e, 0x83, 0xa4, 0xfc,
-  0x04, 0xd4, 0xdd, 0x4d, 0x60, 0xd0, 0x49, 0x2f, 0x08, 0x82, 0x10, 0x7e,
-  0x22, 0xc0, 0xe5, 0x45, 0x71, 0x7a, 0x18, 0x7b, 0x7a, 0x0f, 0x1c, 0x55,
-  0x36, 0x56, 0x7d, 0x19, 0xb2, 0x6a, 0x82, 0x56, 0xe0, 0x54, 0xe0, 0x0d,
-  0xdf, 0x9f, 0x05, 0x11, 0x00, 0x01, 0x27, 0xe4, 0x41, 0x7f, 0x63, 0x06,
-  0xa5, 0xb3, 0x62, 0xe9, 0x29, 0x98, 0x33, 0xcc, 0xa8, 0xa5, 0xcd, 0x62,
-  0xfc, 0x05, 0x41, 0x08, 0x6f, 0x11, 0xe0, 0xf4, 0xa0, 0x78, 0x3c, 0x9c,
-  0xb8, 0xa0, 0x84, 0xba, 0x5d, 0x8d, 0xac, 0xdb, 0xdc, 0x10, 0x8a, 0x27,
-  0xa7, 0xf9, 0x0c, 0xff, 0x39, 0x68, 0x45, 0xd8, 0xe4, 0x78, 0x60, 0x3b,
-  0x11, 0x8b, 0xd2, 0x3e, 0xe6, 0xa2, 0xb9, 0x99, 0x42, 0xb6, 0xef, 0x3f,
-  0xe6, 0xb8, 0x74, 0x56, 0xaf, 0x98, 0x89, 0x29, 0xcd, 0x8c, 0x5a, 0x66,
-  0x15, 0xe3, 0x2f, 0x08, 0x42, 0x04, 0x58, 0x14, 0x05, 0xb5, 0xc9, 0x09,
-  0x0d, 0x6d, 0x3c, 0xf2, 0xd2, 0x64, 0xce, 0x3e, 0xa5, 0x6b, 0xa8, 0x9e,
-  0x5c, 0x0c, 0x98, 0x81, 0x35, 0xd2, 0x09, 0x1d, 0xd0, 0x6c, 0xd2, 0x04,
-  0x47, 0x25, 0x07, 0x58, 0x1e, 0x4a, 0xe3, 0x3f, 0xbc, 0x6f, 0x2a, 0xab,
-  0x3e, 0x99, 0x81, 0x39, 0xcd, 0x84, 0x5a, 0xde, 0x22, 0xa5, 0x7c, 0x05,
-  0x41, 0x88, 0x2c, 0xdc, 0x2a, 0x4a, 0x6e, 0x3c, 0xe8, 0x75, 0x4c, 0x3f,
-  0xf1, 0x3d, 0x3e, 0xf8, 0x2c, 0x64, 0x31, 0x01, 0x3b, 0x80, 0x3a, 0x60,
-  0xac, 0x74, 0x82, 0x78, 0x00, 0x02, 0xd1, 0x3e, 0x1f, 0xa3, 0x05, 0xfd,
-  0x85, 0x84, 0x91, 0xfd, 0xd3, 0x34, 0xe3, 0x9f, 0x61, 0x46, 0x2d, 0xb7,
-  0x89, 0xf1, 0x17, 0x04, 0x21, 0xf2, 0x30, 0x28, 0x5a, 0x5d, 0x12, 0x05,
-  0x96, 0xbc, 0x37, 0x8d, 0xe1, 0x7d, 0x53, 0x43, 0xf5, 0xe4, 0xde, 0x68,
-  0xc9, 0xd9, 0x1e, 0x90, 0x4e, 0x10, 0x01, 0x70, 0xac, 0xac, 0x01, 0xe2,
-  0x09, 0x51, 0xd0, 0xdf, 0xf0, 0xbe, 0xa9, 0xac, 0x5c, 0xe6, 0x33, 0xfe,
-  0xe2, 0xf6, 0x17, 0x04, 0x21, 0xa2, 0x45, 0x80, 0x0e, 0x75, 0xbf, 0x0d,
-  0x12, 0x8d, 0x7c, 0xbc, 0x64, 0x3a, 0xdd, 0x72, 0xe3, 0x43, 0x29, 0x02,
-  0x66, 0x00, 0x83, 0xa4, 0x13, 0x44, 0x00, 0xf8, 0xcb, 0x03, 0x40, 0x4a,
-  0xa8, 0x8c, 0xff, 0x80, 0xee, 0x49, 0xac, 0xfa, 0x64, 0x06, 0xa6, 0x0c,
-  0x93, 0x18, 0x7f, 0x41, 0x10, 0xa2, 0x47, 0x04, 0x94, 0x5a, 0x49, 0x2e,
-  0x4c, 0x64, 0xf5, 0x87, 0xa7, 0x90, 0x9a, 0x68, 0x08, 0xd5, 0x93, 0x4d,
-  0x68, 0x09, 0x82, 0x12, 0xa5, 0x13, 0x44, 0x00, 0x74, 0x94, 0x42, 0x9f,
-  0x82, 0x0c, 0xc9, 0xbe, 0x7f, 0x71, 0xae, 0x85, 0x4f, 0x3e, 0x3c, 0x19,
-  0x73, 0x97, 0x38, 0xd4, 0x52, 0x31, 0xfe, 0x82, 0x20, 0x44, 0x93, 0x08,
-  0x50, 0x50, 0x77, 0x37, 0x93, 0x37, 0x20, 0x93, 0x65, 0xaf, 0x4f, 0x0d,
-  0x55, 0xe6, 0xf2, 0x62, 0x9f, 0x08, 0x90, 0x04, 0x41, 0x22, 0x00, 0x3a,
-  0x84, 0x1e, 0xf8, 0x80, 0x10, 0xed, 0xfb, 0x17, 0xe7, 0x5a, 0x58, 0xbf,
-  0x72, 0x26, 0x99, 0x3d, 0x92, 0x51, 0xf7, 0x88, 0xf1, 0x17, 0x04, 0x21,
-  0x1a, 0xdf, 0xaa, 0x0a, 0x94, 0x36, 0x32, 0x64, 0x6a, 0x11, 0x4b, 0x5e,
-  0x38, 0x21, 0x54, 0x4f, 0x2d, 0x06, 0x2c, 0xc8, 0xc9, 0x80, 0x5f, 0x34,
-  0x76, 0xc2, 0x0f, 0x59, 0x0b, 0x24, 0x13, 0x02, 0xd7, 0x7f, 0xaa, 0xc5,
-  0xc0, 0x9a, 0x8f, 0x4f, 0x21, 0xaf, 0x7f, 0xba, 0x96, 0xe1, 0x4f, 0x02,
-  0xfe, 0x04, 0x41, 0x88, 0x66, 0x9a, 0x1d, 0xf4, 0x18, 0x5f, 0x40, 0xb6,
-  0x41, 0xe5, 0xdd, 0x4f, 0x2a, 0x43, 0xf1, 0xc4, 0x4c, 0xa0, 0xc5, 0xf7,
-  0xfb, 0x72, 0xe9, 0x00, 0x11, 0x00, 0xbf, 0xc4, 0x7d, 0xc0, 0x60, 0x42,
-  0x90, 0xec, 0xc7, 0x6c, 0x50, 0x58, 0xfd, 0xfe, 0x74, 0xfa, 0x8c, 0xce,
-  0x43, 0xdd, 0xdd, 0x28, 0xe5, 0x7c, 0x05, 0x41, 0x88, 0x6e, 0x14, 0xc0,
-  0xab, 0xa2, 0xb4, 0xba, 0x18, 0x31, 0xb3, 0x3b, 0x9e, 0xda, 0x56, 0x56,
-  0xae, 0x0f, 0x49, 0x19, 0xe1, 0x4c, 0x20, 0x17, 0x78, 0x1f, 0x68, 0x90,
-  0x8e, 0xf8, 0x61, 0x97, 0x08, 0x1a, 0x21, 0x3d, 0xef, 0xbf, 0xfa, 0xcd,
-  0xa9, 0x8c, 0x39, 0xad, 0x3b, 0xea, 0x9e, 0x06, 0x29, 0xe7, 0x2b, 0x08,
-  0x42, 0xec, 0xe0, 0x55, 0x51, 0x92, 0x4d, 0xd0, 0x25, 0x9e, 0x05, 0xd3,
-  0xde, 0xe3, 0xbf, 0x1f, 0x86, 0x24, 0x85, 0x7f, 0x19, 0xe0, 0x04, 0x06,
-  0x00, 0x6e, 0xe9, 0x04, 0x0d, 0xd9, 0x70, 0xfe, 0x8e, 0xa5, 0x84, 0x68,
-  0xdf, 0x7f, 0xd1, 0xbf, 0xc6, 0x32, 0xe6, 0xb4, 0x1e, 0x50, 0xe6, 0xab,
-  0xea, 0x27, 0x08, 0x82, 0x10, 0x33, 0x56, 0xc7, 0x97, 0x2d, 0xb0, 0xd9,
-  0xc9, 0xab, 0x6f, 0x4e, 0x65, 0xcc, 0xa0, 0xf4, 0x50, 0x3c, 0xf5, 0x70,
-  0x50, 0xe0, 0x67, 0xd2, 0x01, 0x22, 0x00, 0x7e, 0xcc, 0x0a, 0x20, 0x81,
-  0x10, 0xec, 0xfb, 0x3f, 0x7c, 0xf7, 0x50, 0xe6, 0x5e, 0x3e, 0x00, 0xf6,
-  0x37, 0xa1, 0xaa, 0x88, 0x0f, 0x46, 0x10, 0x84, 0xd8, 0x43, 0xaf, 0xa0,
-  0x56, 0xb7, 0x81, 0x41, 0xc7, 0x92, 0xc5, 0x27, 0x91, 0x9b, 0x61, 0x0e,
-  0x95, 0x08, 0x48, 0x46, 0x92, 0x04, 0x89, 0x00, 0xf8, 0x1e, 0x23, 0x81,
-  0xec, 0x50, 0x18, 0xff, 0x5b, 0x2f, 0xeb, 0xc3, 0x35, 0x77, 0x8d, 0x84,
-  0x0a, 0x2b, 0xaa, 0xd3, 0x23, 0xc6, 0x5f, 0x10, 0x84, 0xd8, 0xc5, 0xa0,
-  0xa0, 0xee, 0xb5, 0x92, 0x54, 0x98, 0xc4, 0x27, 0x8b, 0x4f, 0xc2, 0x14,
-  0x9a, 0x38, 0xa8, 0xc3, 0x49, 0x82, 0x0a, 0xa5, 0x03, 0x44, 0x00, 0x18,
-  0x80, 0xe7, 0x08, 0x81, 0xeb, 0x7f, 0xee, 0x49, 0xf9, 0xfc, 0xf9, 0xf1,
-  0x71, 0x70, 0xc8, 0x8a, 0xda, 0xe6, 0x96, 0x7d, 0x7f, 0x41, 0x10, 0x04,
-  0x83, 0x0e, 0x75, 0x4f, 0x13, 0xbd, 0xc7, 0xe4, 0xf3, 0xd6, 0xb3, 0x13,
-  0x43, 0xf5, 0x54, 0x13, 0xf0, 0xae, 0xd8, 0x3f, 0x39, 0x05, 0xb0, 0x86,
-  0x10, 0x1c, 0xf9, 0x1b, 0x7d, 0x5c, 0x3a, 0x1f, 0x7c, 0x74, 0x0a, 0xd8,
-  0x3d, 0xa8, 0x75, 0x0e, 0x89, 0xf8, 0x17, 0x04, 0x41, 0xf8, 0x16, 0x05,
-  0xa5, 0xd9, 0x41, 0xc9, 0x84, 0x02, 0x52, 0x5c, 0x6e, 0x3e, 0xf8, 0xb4,
-  0x2a, 0xd8, 0x0f, 0x4c, 0x43, 0x3b, 0x1a, 0x78, 0x16, 0xf0, 0xb4, 0x08,
-  0x80, 0xd8, 0xe4, 0x6c, 0x60, 0x1a, 0x41, 0x3e, 0xf2, 0x97, 0xdf, 0x25,
-  0x8e, 0xb5, 0xcb, 0x67, 0x60, 0x4a, 0x31, 0xa1, 0x1e, 0x68, 0x95, 0xb3,
-  0xfe, 0x82, 0x20, 0x08, 0x3f, 0xb4, 0xff, 0xda, 0xc9, 0x00, 0xbb, 0x8b,
-  0xd1, 0xa7, 0x15, 0x73, 0x60, 0x73, 0x1d, 0x1b, 0xb7, 0x35, 0x86, 0x42,
-  0x04, 0xd8, 0x80, 0x1a, 0x60, 0x4b, 0x2c, 0x37, 0x7d, 0x2c, 0x12, 0x0f,
-  0x6c, 0x24, 0x04, 0x47, 0xfe, 0xb6, 0xae, 0x98, 0x41, 0xdf, 0x09, 0x79,
-  0xa8, 0xbb, 0x9b, 0x64, 0xe5, 0x2f, 0x08, 0x82, 0x70, 0x24, 0x3c, 0x2a,
-  0x4a, 0x97, 0x38, 0x88, 0xd3, 0x73, 0xfc, 0xb0, 0x37, 0x59, 0xbf, 0x25,
-  0x24, 0x47, 0xf6, 0x77, 0xa0, 0xc5, 0x81, 0x35, 0xc5, 0x62, 0x93, 0xc7,
-  0xea, 0x1e, 0xc8, 0x0a, 0x42, 0xb0, 0xef, 0xbf, 0xe8, 0xb1, 0xb1, 0xf4,
-  0x9d, 0xd0, 0x15, 0x75, 0x8f, 0x18, 0x7f, 0x41, 0x10, 0x84, 0x5f, 0x44,
-  0xaf, 0xa0, 0xd6, 0xda, 0x41, 0xaf, 0xf0, 0xfe, 0xeb, 0x27, 0x92, 0x96,
-  0x64, 0x0c, 0xc5, 0x53, 0x4d, 0x68, 0x25, 0xdf, 0x63, 0x92, 0x58, 0x14,
-  0x00, 0x97, 0x13, 0x82, 0x7d, 0xff, 0x3b, 0xae, 0xe8, 0xcb, 0xdc, 0x2b,
-  0x07, 0xc2, 0x7e, 0x39, 0xeb, 0x2f, 0x08, 0x82, 0xd0, 0x6e, 0x11, 0xb0,
-  0xd7, 0x46, 0x46, 0xaf, 0x34, 0x3e, 0x7a, 0x75, 0x4a, 0x28, 0x9e, 0x58,
-  0x8c, 0x56, 0x31, 0xf0, 0x85, 0x98, 0x6c, 0xee, 0x18, 0xfb, 0xbe, 0x71,
-  0xc0, 0x42, 0x82, 0xec, 0xfa, 0x3f, 0x69, 0x4c, 0x16, 0xcf, 0xbc, 0x3e,
-  0x15, 0x6a, 0x5b, 0x51, 0x5b, 0x25, 0xe2, 0x5f, 0x10, 0x04, 0xa1, 0xfd,
-  0xcb, 0x52, 0x05, 0x1a, 0x1d, 0xe4, 0x8d, 0xc8, 0x25, 0x27, 0x34, 0x35,
-  0x03, 0x32, 0x01, 0x33, 0xf0, 0x16, 0xd0, 0x2c, 0x02, 0x20, 0x7a, 0xf9,
-  0x0c, 0x48, 0x42, 0x0b, 0x00, 0x09, 0x0a, 0xf9, 0x59, 0x71, 0xac, 0x5b,
-  0x36, 0x13, 0xbd, 0x41, 0xf7, 0xad, 0x3b, 0x4b, 0x10, 0x04, 0x41, 0xe8,
-  0x00, 0x2a, 0x28, 0xad, 0x4e, 0x86, 0xcf, 0xec, 0x4e, 0xfd, 0xee, 0x06,
-  0xd6, 0x6d, 0x0e, 0x7a, 0x3c, 0x80, 0x15, 0x98, 0x0f, 0xfc, 0x2b, 0xa6,
-  0xb4, 0x56, 0x0c, 0x7d, 0xd7, 0x8b, 0x09, 0x81, 0xeb, 0x7f, 0xc9, 0x7f,
-  0x26, 0x61, 0xcc, 0xb5, 0xa0, 0x1e, 0x6c, 0x11, 0xe3, 0x2f, 0x08, 0x82,
-  0xe0, 0x0f, 0x0a, 0xa8, 0x76, 0x0f, 0x34, 0xb4, 0xf0, 0xf0, 0xd3, 0x13,
-  0x38, 0xbe, 0x7f, 0x5a, 0xb0, 0x9f, 0x58, 0x8c, 0x96, 0x0d, 0xf6, 0x03,
-  0x11, 0x00, 0xd1, 0x87, 0x19, 0xf8, 0x1d, 0x41, 0x76, 0xfd, 0x3f, 0xfb,
-  0x97, 0x11, 0x0c, 0x98, 0xd2, 0x0d, 0xb5, 0x54, 0x82, 0xfe, 0x04, 0x41,
-  0x10, 0x8e, 0xcd, 0x3a, 0x29, 0x5a, 0xde, 0x14, 0xa3, 0xc2, 0x7b, 0x8b,
-  0xa6, 0x90, 0x94, 0x60, 0x08, 0x85, 0x08, 0x28, 0x22, 0x04, 0xd5, 0x60,
-  0xc3, 0x48, 0x67, 0xc5, 0x04, 0x6b, 0x81, 0x2e, 0xc1, 0x5c, 0xfd, 0x5f,
-  0x70, 0x5a, 0x11, 0x0b, 0xdf, 0x9c, 0x06, 0x07, 0xad, 0xa8, 0x0e, 0x6f,
-  0xd0, 0x5a, 0x56, 0xd1, 0x29, 0xda, 0xbd, 0xf5, 0x3a, 0x30, 0xeb, 0xc0,
-  0xa0, 0x03, 0xa3, 0xa2, 0x05, 0x1a, 0xaa, 0xaa, 0xb6, 0x7f, 0x66, 0x38,
-  0x8a, 0xae, 0x53, 0x55, 0x70, 0x79, 0xc1, 0xad, 0x82, 0xc3, 0x03, 0x4e,
-  0x2f, 0x78, 0x55, 0xf0, 0xaa, 0x5a, 0x7d, 0x02, 0x41, 0x88, 0xc5, 0x45,
-  0xa7, 0xa2, 0x19, 0x9d, 0xef, 0xe6, 0x97, 0x5e, 0x9b, 0x63, 0x7a, 0x1d,
-  0xa0, 0x82, 0x47, 0x05, 0x87, 0x17, 0x5c, 0x1e, 0x70, 0xa9, 0xda, 0x3c,
-  0x92, 0x39, 0x13, 0x7c, 0x3c, 0x2a, 0x4a, 0x49, 0x1a, 0x1f, 0xff, 0x67,
-  0x27, 0x27, 0x9e, 0xf3, 0x49, 0xb0, 0x9f, 0x56, 0x86, 0x96, 0x24, 0x68,
-  0xa0, 0x08, 0x80, 0xe8, 0x60, 0x22, 0xf0, 0x44, 0x30, 0x57, 0xff, 0x7d,
-  0x8a, 0x93, 0xd8, 0xb6, 0x69, 0x0e, 0xa8, 0xa0, 0xd6, 0xb6, 0x05, 0x34,
-  0xe8, 0x4f, 0x31, 0xe9, 0xc0, 0x62, 0x80, 0x24, 0x23, 0x18, 0x0c, 0xe0,
-  0x76, 0x6b, 0x46, 0xbb, 0xc5, 0x4d, 0x5b, 0xbd, 0x83, 0x66, 0x9b, 0x0b,
-  0xab, 0xcd, 0x8d, 0xcb, 0xed, 0xc5, 0x60, 0xd0, 0xe1, 0x74, 0x7a, 0x68,
-  0xb6, 0xfd, 0x72, 0xb5, 0x4b, 0x83, 0x41, 0x21, 0x2d, 0xd9, 0x44, 0x62,
-  0x82, 0x81, 0x2e, 0xe9, 0x66, 0xf4, 0xe9, 0x66, 0x88, 0x37, 0x40, 0x9c,
-  0x5e, 0x1b, 0x12, 0x2d, 0x2e, 0x68, 0x73, 0x43, 0x9b, 0x07, 0xd5, 0xe5,
-  0x95, 0x9a, 0x05, 0x42, 0x74, 0xa1, 0x82, 0x62, 0x54, 0xc0, 0xa4, 0xd7,
-  0x8c, 0x7c, 0x82, 0x01, 0x8c, 0x7a, 0xed, 0x1f, 0xec, 0x1e, 0x4d, 0x1c,
-  0xb7, 0xb8, 0xb1, 0xd5, 0xd9, 0xa9, 0xad, 0x77, 0x60, 0x6b, 0x71, 0xa1,
-  0x28, 0x0a, 0x09, 0x16, 0x03, 0x19, 0x69, 0x66, 0x92, 0x53, 0x4d, 0xda,
-  0x7c, 0x34, 0xeb, 0x7d, 0x73, 0x46, 0x07, 0x76, 0x17, 0xb4, 0xfa, 0xe6,
-  0x8c, 0xd3, 0x03, 0x52, 0xe8, 0x2b, 0xb0, 0xfd, 0xa5, 0x57, 0xa0, 0x28,
-  0x8d, 0xbb, 0xae, 0x5a, 0xce, 0x1f, 0xff, 0xb9, 0x2d, 0x14, 0x22, 0xa0,
-  0x14, 0x38, 0x51, 0x04, 0x40, 0x64, 0xa3, 0x03, 0xb6, 0xa2, 0x9d, 0xf5,
-  0x0c, 0xda, 0xea, 0xbf, 0xf4, 0xb3, 0x59, 0x14, 0x8f, 0xce, 0x46, 0xdd,
-  0xdd, 0x7c, 0x6c, 0xae, 0x7f, 0xd5, 0xb7, 0x0a, 0x49, 0x32, 0x42, 0x9a,
-  0x59, 0x5b, 0x79, 0x34, 0xda, 0x69, 0x28, 0xb7, 0xf1, 0xd5, 0xf6, 0x26,
-  0x76, 0xee, 0x69, 0x66, 0x47, 0xa9, 0x95, 0x6d, 0xa5, 0xcd, 0xd4, 0x1e,
-  0x72, 0x50, 0x5b, 0x67, 0xc7, 0xda, 0xe2, 0xa6, 0xd9, 0xea, 0xc2, 0xe3,
-  0x55, 0xd1, 0xeb, 0x14, 0x3c, 0xde, 0xf6, 0x2d, 0x47, 0xf4, 0x7a, 0x85,
-  0xa4, 0x04, 0x03, 0x99, 0xe9, 0x66, 0xba, 0xa4, 0xc7, 0xd1, 0xbd, 0x30,
-  0x81, 0x01, 0xbd, 0x52, 0x29, 0x2a, 0x4c, 0x60, 0x68, 0xdf, 0x54, 0x0a,
-  0xba, 0x26, 0x92, 0x50, 0x60, 0x81, 0x78, 0x23, 0xb4, 0x38, 0xa1, 0xc1,
-  0x09, 0x2e, 0x2f, 0xb2, 0xd8, 0x11, 0x22, 0xee, 0x05, 0xa7, 0x53, 0x34,
-  0x43, 0x9d, 0x62, 0x02, 0x93, 0x0e, 0x74, 0x3a, 0x68, 0x73, 0xa1, 0x1e,
-  0xb2, 0x53, 0x5b, 0x63, 0x67, 0x47, 0xa9, 0x95, 0x5d, 0x65, 0x56, 0x0e,
-  0x56, 0xb7, 0x51, 0xba, 0xcf, 0x46, 0x79, 0x65, 0x2b, 0x8d, 0x8d, 0x4e,
-  0x6a, 0xea, 0xec, 0xd4, 0xd6, 0x39, 0x70, 0xba, 0xbc, 0x00, 0x98, 0x8c,
-  0x3a, 0x32, 0xd3, 0xcc, 0xa4, 0xa7, 0x9a, 0xc8, 0x48, 0x37, 0x53, 0x98,
-  0x67, 0xa1, 0x77, 0x71, 0x12, 0x79, 0xf9, 0x16, 0x06, 0xf5, 0x4c, 0xa1,
-  0x67, 0x71, 0x12, 0x49, 0x79, 0x16, 0x6d, 0xee, 0x82, 0x26, 0xa2, 0x1b,
-  0x9d, 0xe0, 0xf0, 0x88, 0x97, 0xe0, 0x58, 0xf1, 0xaa, 0x28, 0x29, 0x26,
-  0x48, 0x33, 0x31, 0x71, 0xe4, 0x62, 0x56, 0x7e, 0x79, 0x28, 0xd8, 0x4f,
-  0xdc, 0x01, 0x9c, 0x04, 0xec, 0x13, 0x01, 0x10, 0xb9, 0x7c, 0x06, 0xe4,
-  0x04, 0xd3, 0xf8, 0xbf, 0xf0, 0xf7, 0x91, 0x9c, 0x7b, 0xc3, 0x10, 0xd4,
-  0x3d, 0xf5, 0xfe, 0xaf, 0xfc, 0xbd, 0x2a, 0x8a, 0xc5, 0x00, 0x39, 0x16,
-  0xed, 0xbd, 0x51, 0x66, 0x65, 0xd5, 0xe7, 0x35, 0x7c, 0xf8, 0x69, 0x25,
-  0x6b, 0x36, 0xd4, 0xf1, 0xd5, 0x37, 0x0d, 0xb4, 0xb4, 0xba, 0x43, 0xda,
-  0x70, 0xe9, 0x19, 0x66, 0xc6, 0x0d, 0xcd, 0x64, 0xf6, 0xcc, 0x42, 0xc6,
-  0x0c, 0xcf, 0xa4, 0x57, 0xbf, 0x54, 0x48, 0x8d, 0xd7, 0x56, 0x3a, 0xb5,
-  0x76, 0x6d, 0x95, 0x23, 0xc7, 0x1b, 0x85, 0x30, 0x5c, 0x2d, 0xa2, 0x80,
-  0x12, 0x6f, 0x80, 0x64, 0x23, 0x58, 0x8c, 0xe0, 0x70, 0x43, 0x55, 0x2b,
-  0x5f, 0x6f, 0x6f, 0x62, 0x47, 0xa9, 0x95, 0xb5, 0x9b, 0xea, 0xd8, 0x53,
-  0x66, 0x65, 0xf3, 0xae, 0x66, 0x0e, 0x56, 0xb4, 0x62, 0x77, 0x78, 0x02,
-  0xf2, 0xe8, 0x94, 0x24, 0x23, 0x03, 0xfb, 0xa4, 0xd2, 0xa7, 0x47, 0x12,
-  0x63, 0x86, 0x77, 0x61, 0xc4, 0xc0, 0x74, 0x06, 0x0c, 0x4c, 0x83, 0xac,
-  0x78, 0x6d, 0x61, 0xd0, 0xe8, 0x84, 0x46, 0x07, 0xaa, 0x47, 0x95, 0xb9,
-  0xe3, 0x0f, 0x1e, 0x15, 0xa5, 0x30, 0x11, 0xeb, 0x01, 0x1b, 0x5d, 0x07,
-  0xbf, 0x41, 0x93, 0xd5, 0x15, 0x6c, 0x2f, 0x40, 0x33, 0x30, 0x58, 0x04,
-  0x40, 0x64, 0xd2, 0x1b, 0xed, 0x5c, 0x67, 0xd0, 0x5c, 0xff, 0x67, 0x9e,
-  0x5c, 0xc0, 0xcb, 0xef, 0xcd, 0x80, 0x83, 0xcd, 0x1d, 0xdf, 0xf7, 0x57,
-  0x41, 0x51, 0x55, 0x6d, 0xb5, 0x90, 0x1e, 0x0f, 0x75, 0xad, 0x2c, 0xfd,
-  0xb8, 0x82, 0xd7, 0xdf, 0x3f, 0xc0, 0x7b, 0x1f, 0x1d, 0x64, 0xdf, 0x81,
-  0x96, 0xf0, 0x19, 0x24, 0x7a, 0x85, 0xb1, 0x43, 0x33, 0x38, 0x79, 0x72,
-  0x3e, 0xb3, 0xa6, 0x17, 0x30, 0x70, 0x44, 0x17, 0x48, 0x30, 0x41, 0xa3,
-  0x1d, 0xea, 0x1d, 0x9a, 0x57, 0x40, 0xde, 0x67, 0x42, 0x27, 0x1a, 0x7d,
-  0x45, 0xaf, 0x68, 0x06, 0x3f, 0xd5, 0xac, 0x8d, 0xc5, 0x8a, 0x56, 0xb6,
-  0xef, 0x6e, 0xe2, 0x83, 0x8f, 0x2b, 0x58, 0xb6, 0xbe, 0x96, 0x1d, 0x3b,
-  0x34, 0xe3, 0x1f, 0x6a, 0x06, 0xf6, 0x49, 0x65, 0xd4, 0xf0, 0x4c, 0x4e,
-  0x1c, 0x9d, 0xc5, 0xe4, 0xb1, 0x39, 0x64, 0x1e, 0x97, 0xae, 0xb9, 0xf9,
-  0x6a, 0x5a, 0xc1, 0xe6, 0x96, 0xb9, 0xe3, 0x8f, 0x08, 0x28, 0x49, 0x63,
-  0xe9, 0x0b, 0xdb, 0x39, 0xe9, 0xfc, 0x15, 0xa1, 0xf0, 0x02, 0x6c, 0x03,
-  0x66, 0x8b, 0x00, 0x88, 0x3c, 0x36, 0xa3, 0x1d, 0xeb, 0x08, 0xca, 0xea,
-  0xbf, 0x20, 0x3b, 0x9e, 0xf2, 0x4d, 0x73, 0xd0, 0x25, 0x18, 0x51, 0xab,
-  0x5b, 0xdb, 0xaf, 0xe8, 0x55, 0x40, 0x55, 0x51, 0x7c, 0x86, 0xdf, 0xba,
-  0xa7, 0x91, 0x85, 0x8b, 0x4a, 0xf9, 0xf7, 0x4b, 0x7b, 0xd8, 0xf4, 0x4d,
-  0x43, 0x44, 0x34, 0xec, 0xf8, 0x31, 0xd9, 0x9c, 0x35, 0xa7, 0x1b, 0xf3,
-  0xa6, 0x17, 0x90, 0xd9, 0x3f, 0x43, 0xf3, 0x0a, 0x54, 0xb6, 0xa2, 0x7a,
-  0x65, 0x65, 0x23, 0x84, 0xd0, 0xe8, 0xeb, 0xd0, 0x0c, 0x7e, 0xaa, 0x19,
-  0x9c, 0x1e, 0x6a, 0x77, 0x34, 0xb1, 0x6a, 0x5d, 0x0d, 0x1f, 0x7e, 0x52,
-  0xc1, 0x27, 0xeb, 0x6a, 0xd9, 0xb1, 0x2b, 0xbc, 0x72, 0xba, 0x24, 0xc4,
-  0x1b, 0x38, 0x75, 0x5a, 0x01, 0xf3, 0x4e, 0x2f, 0x62, 0xd6, 0x89, 0x79,
-  0x18, 0xf2, 0x13, 0x35, 0xef, 0x44, 0x75, 0x9b, 0x16, 0x6b, 0x23, 0x73,
-  0xa7, 0x7d, 0x46, 0x4b, 0xa7, 0x40, 0x51, 0x2a, 0x37, 0x5f, 0xbc, 0x8c,
-  0xbf, 0x3e, 0xb3, 0x33, 0x14, 0x22, 0x60, 0x0c, 0x50, 0x2f, 0x02, 0x20,
-  0x72, 0x78, 0x1e, 0x38, 0x3e, 0x98, 0xab, 0xff, 0x2f, 0xde, 0x9e, 0xc6,
-  0xb0, 0x99, 0x45, 0xa8, 0xbb, 0x1b, 0xdb, 0xbf, 0xef, 0xef, 0xf1, 0xb9,
-  0xfa, 0xf3, 0x12, 0x71, 0x1d, 0xb4, 0xf2, 0xf7, 0x27, 0xb6, 0xf3, 0xc8,
-  0x53, 0xdb, 0xa9, 0xac, 0x6a, 0x8b, 0xc8, 0x46, 0xce, 0x48, 0x37, 0x73,
-  0xf1, 0x39, 0x25, 0x5c, 0x78, 0x66, 0x77, 0xfa, 0x8c, 0xc9, 0xd1, 0x5e,
-  0x66, 0x15, 0xad, 0xda, 0x7e, 0xa7, 0xbc, 0xcb, 0x84, 0x60, 0xbc, 0xb0,
-  0x54, 0x15, 0x12, 0x8c, 0x90, 0x1d, 0x0f, 0x40, 0xc3, 0x96, 0x06, 0x96,
-  0x2c, 0xab, 0xe0, 0xad, 0x65, 0x15, 0x2c, 0x5d, 0x51, 0x45, 0x7d, 0x83,
-  0x23, 0x22, 0xbe, 0x47, 0x8f, 0xe2, 0x24, 0xe6, 0xcc, 0xec, 0xca, 0xf9,
-  0xf3, 0xba, 0x33, 0x60, 0x74, 0x96, 0x76, 0x72, 0xa7, 0xa2, 0x15, 0xb5,
-  0x4d, 0x32, 0x87, 0x1e, 0x15, 0xaf, 0x6f, 0x01, 0x65, 0xd1, 0x33, 0x64,
-  0xf0, 0x1b, 0x7c, 0xb5, 0x23, 0xa8, 0x75, 0x7c, 0xca, 0x80, 0x3a, 0x60,
-  0x84, 0x08, 0x80, 0xc8, 0x20, 0x0d, 0x58, 0x13, 0x4c, 0xe3, 0xff, 0xa7,
-  0x6b, 0xfb, 0x73, 0xc7, 0xff, 0x8d, 0x47, 0x2d, 0xeb, 0xc0, 0x8a, 0xdd,
-  0xad, 0xa2, 0x74, 0xb5, 0x80, 0x41, 0xcf, 0xbf, 0x1f, 0xf9, 0x86, 0x3f,
-  0x3f, 0xf4, 0x0d, 0xa5, 0xfb, 0x5b, 0xa2, 0xa6, 0xd1, 0x2f, 0x3e, 0xb7,
-  0x84, 0x9b, 0xae, 0xe8, 0x4b, 0xaf, 0x31, 0xb9, 0xd0, 0x64, 0x97, 0x2c,
-  0x88, 0x42, 0x60, 0x57, 0xfb, 0x0a, 0x90, 0x19, 0x07, 0x49, 0x66, 0xd4,
-  0x4a, 0x1b, 0x8b, 0x3f, 0x3c, 0xc8, 0xff, 0xde, 0x29, 0xe7, 0x9d, 0x0f,
-  0x0e, 0xd2, 0x18, 0xdc, 0xbd, 0xe0, 0xa0, 0x33, 0xfd, 0xc4, 0x3c, 0x2e,
-  0x3b, 0xaf, 0x27, 0xa7, 0x9f, 0x5a, 0x04, 0xa9, 0x71, 0x50, 0xdd, 0x82,
-  0x6a, 0x73, 0x89, 0x10, 0x38, 0xda, 0x62, 0xaa, 0x47, 0x32, 0xe5, 0x5f,
-  0xd4, 0xd2, 0x63, 0xf4, 0x62, 0x3c, 0x9e, 0xa0, 0x46, 0x59, 0xee, 0x00,
-  0xfe, 0x01, 0x3c, 0x2e, 0x02, 0x20, 0xfc, 0x59, 0x87, 0x96, 0xdb, 0x39,
-  0x28, 0xae, 0xff, 0x21, 0x7d, 0x52, 0xd9, 0xb0, 0xf1, 0x74, 0x6d, 0xff,
-  0xae, 0xd9, 0x79, 0xf4, 0x42, 0x3f, 0x5e, 0x15, 0xc5, 0xa8, 0x83, 0xc2,
-  0x14, 0x9a, 0xf6, 0x35, 0x71, 0xf9, 0xb5, 0x6b, 0x78, 0xe5, 0xad, 0xf2,
-  0xa8, 0x9c, 0x93, 0x06, 0x05, 0xae, 0xba, 0xb4, 0x0f, 0xf7, 0xde, 0x36,
-  0x98, 0x84, 0xc2, 0x14, 0x2d, 0x36, 0xc2, 0x2e, 0xc1, 0x82, 0x82, 0xbf,
-  0x86, 0x5f, 0xd5, 0xdc, 0xbd, 0x39, 0x16, 0x88, 0x33, 0x50, 0xf9, 0x75,
-  0x1d, 0x0b, 0x17, 0x95, 0xf2, 0xdc, 0x2b, 0xa5, 0xec, 0xd8, 0x1d, 0x7d,
-  0x29, 0xdb, 0xc7, 0x8c, 0xe8, 0xc2, 0x75, 0x97, 0xf6, 0x66, 0xde, 0x9c,
-  0x62, 0x2d, 0x2e, 0xa8, 0xd2, 0x26, 0xb5, 0x44, 0x7e, 0xc9, 0x78, 0x79,
-  0x55, 0xe8, 0x91, 0xce, 0xc2, 0xfb, 0xbf, 0xe4, 0xc2, 0x5b, 0xd7, 0x07,
-  0xfb, 0x71, 0x3b, 0xd0, 0x72, 0x03, 0xb8, 0xa2, 0xaa, 0x0d, 0xa3, 0x6c,
-  0x4c, 0x4c, 0x00, 0x9e, 0x0c, 0xd6, 0xea, 0x5f, 0x51, 0xa0, 0x7c, 0xed,
-  0x69, 0x74, 0x1d, 0x96, 0x89, 0x5a, 0x6a, 0x3d, 0xfa, 0x0a, 0xd7, 0xed,
-  0x45, 0xc9, 0x8c, 0x83, 0xb4, 0x78, 0xde, 0x7a, 0x69, 0x17, 0x57, 0xff,
-  0xf6, 0x73, 0x0e, 0xd4, 0xb4, 0x45, 0xfd, 0xc4, 0x2c, 0xcc, 0xb5, 0x70,
-  0xef, 0x5d, 0x43, 0x38, 0xf7, 0xa2, 0xde, 0x5a, 0xa2, 0x94, 0x03, 0x2d,
-  0x5a, 0xe3, 0xc9, 0x7b, 0x4c, 0x68, 0xaf, 0xe1, 0x57, 0x14, 0xc8, 0x4f,
-  0x00, 0x93, 0x8e, 0xed, 0x9f, 0x56, 0xf1, 0xe8, 0xb3, 0x3b, 0x79, 0xe6,
-  0xe5, 0x3d, 0xb4, 0xd9, 0x3d, 0x51, 0xff, 0xf5, 0x87, 0xf4, 0x4f, 0xe3,
-  0xd6, 0x1b, 0x06, 0x32, 0x6f, 0x5e, 0x31, 0x24, 0x1a, 0x61, 0xaf, 0x0d,
-  0xd5, 0x23, 0x31, 0x02, 0x3f, 0x1d, 0x27, 0xa0, 0x98, 0x75, 0x90, 0x9f,
-  0xc4, 0x9c, 0x8a, 0x71, 0x0d, 0xe3, 0x00, 0x00, 0x20, 0x00, 0x49, 0x44,
-  0x41, 0x54, 0x13, 0xdf, 0xe1, 0x8d, 0x8f, 0x2b, 0x82, 0xf9, 0xb4, 0x32,
-  0xa0, 0x06, 0x18, 0x25, 0x02, 0x20, 0x7c, 0xbf, 0xcb, 0x66, 0xc0, 0x12,
-  0xac, 0xd5, 0xff, 0xa3, 0x77, 0x0c, 0xe1, 0xaa, 0x3f, 0x8d, 0x3c, 0xfa,
-  0x91, 0x3f, 0xd5, 0xa7, 0x4e, 0xbb, 0x27, 0x41, 0xab, 0x9b, 0x1b, 0x6f,
-  0x5c, 0xcb, 0x03, 0x4f, 0x6c, 0x8f, 0xb9, 0xf9, 0x79, 0xfa, 0xf4, 0x02,
-  0x1e, 0xfd, 0xfb, 0x48, 0xf2, 0xfb, 0x67, 0xc2, 0x81, 0x66, 0x54, 0x87,
-  0x78, 0x03, 0x84, 0xa3, 0xbc, 0xd0, 0x51, 0xb5, 0x15, 0xbf, 0xc5, 0xc8,
-  0xd6, 0xcf, 0xaa, 0x78, 0xf8, 0x89, 0x6d, 0x3c, 0xf5, 0xfc, 0x6e, 0xbc,
-  0x31, 0xd8, 0x1c, 0x93, 0xc6, 0x66, 0x73, 0xdf, 0x1d, 0x83, 0x19, 0x39,
-  0xbd, 0x48, 0xcb, 0xc5, 0x51, 0xd5, 0x8a, 0x2a, 0x42, 0xfa, 0x87, 0x78,
-  0x54, 0x94, 0x7c, 0x0b, 0x2d, 0x55, 0x6d, 0x14, 0x0c, 0x7e, 0x9d, 0xc6,
-  0xe6, 0xa0, 0x2e, 0xd0, 0x77, 0x00, 0x33, 0x80, 0x3d, 0x22, 0x00, 0xc2,
-  0x8f, 0xf7, 0x7d, 0x2b, 0xff, 0xa0, 0x18, 0xff, 0x13, 0x46, 0x74, 0xe1,
-  0x93, 0x35, 0xa7, 0x42, 0x6d, 0x1b, 0x6a, 0xab, 0xe7, 0xc8, 0x2d, 0xe7,
-  0x55, 0x51, 0x0c, 0x3a, 0x28, 0x4a, 0x61, 0xd7, 0x97, 0xd5, 0x9c, 0x77,
-  0xe1, 0x4a, 0xd6, 0x6e, 0xae, 0x8f, 0xd9, 0xf9, 0x99, 0x92, 0x60, 0xe0,
-  0x91, 0xfb, 0x47, 0x70, 0xde, 0xd5, 0x03, 0xa0, 0xc9, 0x81, 0x5a, 0x63,
-  0xd7, 0xf6, 0x0a, 0x04, 0xe1, 0xc7, 0x2f, 0xf2, 0x34, 0x33, 0x64, 0x58,
-  0xa8, 0xda, 0x54, 0xc3, 0x1f, 0x1e, 0xfa, 0x86, 0xc7, 0x9f, 0xdb, 0x25,
-  0xed, 0x02, 0x5c, 0x72, 0x7e, 0x09, 0x7f, 0xbe, 0x65, 0x10, 0x5d, 0xfa,
-  0x66, 0x42, 0x85, 0x55, 0xdb, 0x16, 0x90, 0xf8, 0x9a, 0x1f, 0x8e, 0x9d,
-  0x92, 0x54, 0x3e, 0x7a, 0x7e, 0x07, 0x53, 0x2f, 0x08, 0xea, 0xd1, 0xc0,
-  0x32, 0xa0, 0x09, 0x18, 0x12, 0x2d, 0x4d, 0x17, 0x2d, 0xe5, 0x80, 0x93,
-  0x80, 0x9b, 0x08, 0x52, 0x11, 0x07, 0x9d, 0x4e, 0xe1, 0xb3, 0xc5, 0x53,
-  0x49, 0xcc, 0xb6, 0x68, 0x06, 0xec, 0x48, 0xab, 0x58, 0x8f, 0x8a, 0x92,
-  0x68, 0x84, 0x82, 0x14, 0xde, 0x78, 0x61, 0x3b, 0xd3, 0x4e, 0x5d, 0x4a,
-  0x59, 0x65, 0x6b, 0x4c, 0xcf, 0x4d, 0x87, 0xcb, 0xcb, 0x1b, 0xef, 0x1f,
-  0xa0, 0xba, 0xb4, 0x99, 0x99, 0x33, 0x0a, 0x51, 0xb2, 0xe3, 0x51, 0xea,
-  0x1d, 0xb2, 0x25, 0x20, 0xfc, 0x40, 0x30, 0x2b, 0xc5, 0x29, 0xd0, 0xe2,
-  0xe2, 0xde, 0xfb, 0x37, 0x72, 0xd6, 0x25, 0xab, 0x58, 0xfd, 0xc5, 0x21,
-  0x69, 0x1b, 0x1f, 0x1b, 0x36, 0xd5, 0xf3, 0xef, 0x17, 0x76, 0x93, 0x93,
-  0x6c, 0x60, 0xf0, 0xa4, 0x5c, 0x94, 0x04, 0x23, 0x4a, 0x93, 0x53, 0xbc,
-  0x69, 0xdf, 0xbe, 0xa0, 0x15, 0x14, 0xab, 0x93, 0xee, 0x13, 0x0a, 0xd8,
-  0xf7, 0x75, 0x1d, 0x5f, 0x6d, 0x6f, 0x0c, 0xd6, 0x93, 0xd2, 0x7c, 0x02,
-  0x00, 0xb4, 0x58, 0x33, 0xf1, 0x00, 0x84, 0x09, 0x41, 0x0d, 0xfc, 0xfb,
-  0xe7, 0x5d, 0x43, 0xb9, 0xe2, 0xee, 0xe3, 0x7f, 0xd9, 0xf5, 0xef, 0x51,
-  0xb5, 0xfd, 0xfe, 0x54, 0x13, 0xf7, 0xdc, 0xb2, 0x9e, 0x3b, 0xff, 0xb2,
-  0x49, 0x26, 0xe6, 0x8f, 0x18, 0xd1, 0x3f, 0x8d, 0xd7, 0x5f, 0x9d, 0x4c,
-  0x41, 0xff, 0x74, 0xd4, 0xd2, 0xe6, 0xe8, 0x1a, 0x81, 0x82, 0x7f, 0x2b,
-  0xb7, 0x9c, 0x78, 0x48, 0x34, 0xb3, 0xf8, 0xa5, 0x9d, 0xdc, 0x7a, 0xf7,
-  0x06, 0xb6, 0x46, 0x61, 0x70, 0x5f, 0x20, 0x99, 0x3b, 0xb3, 0x2b, 0xff,
-  0x7a, 0x60, 0x14, 0x99, 0xbd, 0xd2, 0xa1, 0xbc, 0x09, 0xd5, 0x2d, 0xb1,
-  0x01, 0xdf, 0x0a, 0xc9, 0xac, 0x78, 0x3c, 0x36, 0x17, 0x05, 0xc7, 0xbd,
-  0x4e, 0xd5, 0x21, 0x7b, 0x30, 0x9f, 0xb6, 0x03, 0xe8, 0x0f, 0x44, 0x7c,
-  0x40, 0x4a, 0x34, 0x8c, 0x9c, 0xfe, 0xc0, 0x6b, 0x04, 0x29, 0xf0, 0x6f,
-  0xf4, 0xe0, 0x0c, 0x3e, 0x5b, 0x77, 0x9a, 0x96, 0xf1, 0xae, 0xc5, 0xfd,
-  0xf3, 0x2d, 0xe6, 0xf6, 0xa2, 0x14, 0x24, 0x80, 0x41, 0xc7, 0x65, 0xbf,
-  0x5a, 0xc1, 0x93, 0xff, 0xd9, 0x23, 0x13, 0xf2, 0x08, 0x64, 0xa5, 0x98,
-  0x58, 0xfc, 0xea, 0x14, 0x46, 0x4e, 0xeb, 0x06, 0xe5, 0x0d, 0xf2, 0x02,
-  0x8b, 0xe1, 0x55, 0x3f, 0x45, 0xc9, 0x58, 0xf7, 0x35, 0x73, 0xc3, 0xad,
-  0xeb, 0x79, 0x4a, 0xe6, 0x4c, 0xbb, 0xc9, 0x49, 0x33, 0xf1, 0xf4, 0x3f,
-  0xc7, 0x31, 0xe3, 0xcc, 0x12, 0x38, 0xd4, 0x8a, 0xda, 0xe8, 0x94, 0x2d,
-  0x81, 0xc3, 0x82, 0xb2, 0x24, 0x95, 0xd5, 0x8b, 0xf6, 0x30, 0x6e, 0xfe,
-  0xc7, 0xc1, 0x7c, 0x52, 0x99, 0x4f, 0x04, 0x9c, 0x2c, 0x02, 0xa0, 0xf3,
-  0xd9, 0x00, 0xa4, 0x06, 0x6b, 0xf5, 0x7f, 0x60, 0xfd, 0xe9, 0xe4, 0x0f,
-  0xcd, 0xd4, 0x56, 0xac, 0x3f, 0x37, 0xc9, 0xdc, 0x5e, 0x94, 0xa2, 0x24,
-  0x3c, 0x4d, 0x4e, 0x4e, 0x9f, 0xff, 0x31, 0xef, 0x2c, 0xaf, 0x0c, 0xe9,
-  0x97, 0xcf, 0xcc, 0xcc, 0xa4, 0xb8, 0xb8, 0x98, 0xec, 0xec, 0x6c, 0x0a,
-  0x0a, 0x0a, 0xe8, 0xd2, 0xa5, 0x0b, 0x66, 0xb3, 0x19, 0x8f, 0x47, 0x13,
-  0xa7, 0x8a, 0xa2, 0xe0, 0xf5, 0x7a, 0xa9, 0xab, 0xab, 0xa3, 0xa2, 0xa2,
-  0xe2, 0xdb, 0x5f, 0xe5, 0xe5, 0x9d, 0x77, 0x14, 0x51, 0x07, 0xfc, 0xef,
-  0x99, 0x09, 0xcc, 0xbe, 0xb0, 0xaf, 0x04, 0x07, 0xc6, 0xe2, 0x4b, 0x3a,
-  0x5d, 0xcb, 0x82, 0xf9, 0xf6, 0xcb, 0xbb, 0xb8, 0xea, 0xfa, 0xcf, 0xd9,
-  0x5f, 0xdd, 0xb9, 0x27, 0x63, 0xf2, 0xf2, 0xf2, 0xe8, 0xda, 0xb5, 0x2b,
-  0x99, 0x99, 0x99, 0xe4, 0xe7, 0xe7, 0x93, 0x9e, 0x9e, 0x4e, 0x4e, 0x4e,
-  0x0e, 0xf1, 0xf1, 0xf1, 0x24, 0x25, 0x25, 0x91, 0x9a, 0x9a, 0x4a, 0x7d,
-  0x7d, 0x3d, 0x2d, 0x2d, 0x5a, 0xde, 0x0e, 0x55, 0x55, 0xa9, 0xab, 0xab,
-  0xa3, 0xa6, 0xa6, 0x86, 0xd2, 0xd2, 0x52, 0xaa, 0xaa, 0xaa, 0xd8, 0xb3,
-  0x67, 0x0f, 0xf5, 0xf5, 0xa1, 0x8d, 0xf5, 0xb9, 0xf1, 0xca, 0x7e, 0xfc,
-  0xed, 0xc1, 0x91, 0xda, 0x67, 0xda, 0x67, 0x3b, 0x7a, 0x19, 0xf0, 0x58,
-  0x40, 0xa7, 0xa0, 0x14, 0xa5, 0x72, 0xd9, 0xfc, 0x0f, 0x78, 0x72, 0x51,
-  0x59, 0xb0, 0xbd, 0x00, 0x23, 0x00, 0x6b, 0x24, 0x37, 0x57, 0xa4, 0xbf,
-  0x75, 0x67, 0x00, 0x0f, 0x04, 0x6b, 0xf5, 0x7f, 0xff, 0x6f, 0x07, 0x70,
-  0xf3, 0x03, 0xe3, 0x51, 0x4b, 0xeb, 0x7e, 0xfe, 0xbc, 0xbf, 0x47, 0x45,
-  0xe9, 0x9e, 0x84, 0xb3, 0xce, 0xc1, 0x84, 0xc9, 0xef, 0xb2, 0x36, 0x04,
-  0xa9, 0x7c, 0xf3, 0xf2, 0xf2, 0x98, 0x38, 0x71, 0x22, 0xa3, 0x46, 0x8d,
-  0x62, 0xf4, 0xe8, 0xd1, 0x74, 0xef, 0xde, 0x9d, 0x8c, 0x8c, 0x8c, 0x0e,
-  0xdd, 0xc3, 0xe1, 0x70, 0xb0, 0x73, 0xe7, 0x4e, 0xb6, 0x6e, 0xdd, 0xca,
-  0x9a, 0x35, 0x6b, 0x58, 0xb5, 0x6a, 0x15, 0x5f, 0x7d, 0xf5, 0xd5, 0xb7,
-  0xa2, 0x21, 0x54, 0x2c, 0x7c, 0x68, 0x14, 0x17, 0x5c, 0x37, 0x04, 0x0e,
-  0x34, 0x8a, 0x08, 0x88, 0x15, 0xe3, 0x5f, 0x94, 0x08, 0x2e, 0x2f, 0xb7,
-  0xdd, 0xbc, 0x8e, 0xfb, 0x1e, 0xdd, 0x1a, 0xd2, 0xc7, 0x9b, 0xcd, 0x66,
-  0x06, 0x0d, 0x1a, 0xc4, 0xe0, 0xc1, 0x83, 0xe9, 0xdb, 0xb7, 0x2f, 0x03,
-  0x07, 0x0e, 0xfc, 0xd6, 0xf8, 0x27, 0x26, 0x26, 0x1e, 0xd3, 0xbd, 0x6b,
-  0x6b, 0x6b, 0xd9, 0xbd, 0x7b, 0x37, 0x9f, 0x7c, 0xf2, 0x09, 0xeb, 0xd6,
-  0xad, 0x63, 0xc9, 0x92, 0x25, 0x38, 0x1c, 0xc1, 0xcf, 0x4a, 0x38, 0x7d,
-  0x42, 0x2e, 0xff, 0x59, 0x38, 0x81, 0xb4, 0xe2, 0x14, 0xd8, 0xd3, 0x28,
-  0xa7, 0x04, 0xbc, 0x2a, 0x4a, 0x97, 0x78, 0x1c, 0x56, 0x27, 0x45, 0x83,
-  0x5f, 0xa7, 0xfa, 0x50, 0xd0, 0xfa, 0xa0, 0x0c, 0xa8, 0x05, 0x46, 0x8a,
-  0x00, 0xe8, 0x3c, 0xb6, 0x00, 0xfd, 0x82, 0x71, 0xe3, 0xe3, 0xfa, 0xa4,
-  0xb0, 0x69, 0xc3, 0x6c, 0xb0, 0xba, 0xb5, 0xac, 0x5c, 0x3f, 0x6e, 0x29,
-  0xb7, 0x8a, 0x52, 0x9c, 0x48, 0x73, 0x45, 0x1b, 0x53, 0x4f, 0x59, 0xc2,
-  0xba, 0x2d, 0xc1, 0x33, 0xfe, 0x3d, 0x7a, 0xf4, 0xe0, 0xd4, 0x53, 0x4f,
-  0x65, 0xe6, 0xcc, 0x99, 0x8c, 0x1f, 0x3f, 0x1e, 0xa3, 0xd1, 0x18, 0xf0,
-  0x67, 0xec, 0xdf, 0xbf, 0x9f, 0xf7, 0xdf, 0x7f, 0x9f, 0x37, 0xdf, 0x7c,
-  0x93, 0xe5, 0xcb, 0x97, 0xd3, 0xd6, 0x16, 0x9a, 0x55, 0xd9, 0xb3, 0x0f,
-  0x8d, 0xe2, 0x57, 0xd7, 0x0d, 0x86, 0x03, 0x4d, 0x22, 0x02, 0xa2, 0x95,
-  0xc3, 0xc7, 0xfb, 0xba, 0xa7, 0x52, 0xb9, 0xad, 0x9e, 0x33, 0xcf, 0x5f,
-  0xce, 0xca, 0x10, 0x04, 0xf9, 0xe9, 0xf5, 0x7a, 0x46, 0x8f, 0x1e, 0xcd,
-  0xa4, 0x49, 0x93, 0x18, 0x36, 0x6c, 0x18, 0xa3, 0x47, 0x8f, 0x26, 0x2b,
-  0x2b, 0x2b, 0x24, 0x5f, 0xb9, 0xba, 0xba, 0x9a, 0x25, 0x4b, 0x96, 0xf0,
-  0xd2, 0x4b, 0x2f, 0xb1, 0x74, 0xe9, 0xd2, 0xa0, 0x3e, 0xab, 0x28, 0x27,
-  0x9e, 0x37, 0xfe, 0x3b, 0x85, 0x21, 0xe3, 0xf3, 0x25, 0x2e, 0xe0, 0xb0,
-  0xd0, 0x2c, 0x49, 0x63, 0xf9, 0x4b, 0x3b, 0x98, 0x74, 0xee, 0xf2, 0x60,
-  0x7b, 0x01, 0xa6, 0x03, 0x7b, 0x45, 0x00, 0x84, 0x9e, 0x7b, 0x81, 0xb3,
-  0x08, 0x92, 0xeb, 0x7f, 0xe3, 0xdb, 0x27, 0x31, 0x78, 0x66, 0x11, 0xea,
-  0xee, 0xa6, 0x9f, 0xba, 0xfe, 0xdd, 0x2a, 0x4a, 0x71, 0x12, 0xf6, 0xea,
-  0x56, 0x86, 0x8c, 0x7d, 0x9b, 0xed, 0xe5, 0xb6, 0xa0, 0x7c, 0xc1, 0x93,
-  0x4f, 0x3e, 0x99, 0x0b, 0x2f, 0xbc, 0x90, 0xd9, 0xb3, 0x67, 0x63, 0x30,
-  0x18, 0x42, 0xd6, 0xb0, 0xfb, 0xf7, 0xef, 0xe7, 0xe5, 0x97, 0x5f, 0x66,
-  0xf1, 0xe2, 0xc5, 0x6c, 0xdb, 0xb6, 0x2d, 0xe8, 0xae, 0xcd, 0x85, 0x0f,
-  0x8e, 0xe2, 0x82, 0xeb, 0x07, 0xc3, 0xbe, 0x46, 0x54, 0xb7, 0x2a, 0x81,
-  0x81, 0xd1, 0xb6, 0x22, 0x33, 0xea, 0xa0, 0x30, 0x95, 0xf5, 0x1f, 0x95,
-  0x73, 0xfa, 0x82, 0x65, 0x54, 0xd4, 0x07, 0x6f, 0x65, 0xac, 0xd3, 0xe9,
-  0x98, 0x39, 0x73, 0x26, 0xa7, 0x9f, 0x7e, 0x3a, 0x13, 0x26, 0x4c, 0xa0,
-  0x47, 0x8f, 0x1e, 0x9d, 0xde, 0x04, 0xab, 0x57, 0xaf, 0xe6, 0xfe, 0xfb,
-  0xef, 0xe7, 0x9d, 0x77, 0xde, 0x09, 0xda, 0x33, 0x8c, 0xc0, 0xa2, 0xe7,
-  0x27, 0x72, 0xda, 0x79, 0x7d, 0x64, 0x5b, 0x0d, 0x5f, 0x75, 0xc8, 0xc2,
-  0x14, 0xce, 0x9e, 0xf1, 0x1e, 0x2f, 0xbf, 0xb7, 0x3f, 0x98, 0x5e, 0x80,
-  0x7a, 0x60, 0xb8, 0x08, 0x80, 0xd0, 0xa2, 0x03, 0xb6, 0x12, 0x24, 0xd7,
-  0xff, 0x25, 0x73, 0x8b, 0x79, 0x6a, 0xd1, 0x34, 0xd4, 0xbd, 0x0d, 0x5a,
-  0xf5, 0xbe, 0x1f, 0x1b, 0xff, 0xae, 0x09, 0x78, 0x5b, 0xdc, 0x8c, 0x9a,
-  0xf8, 0x0e, 0xeb, 0x83, 0xb0, 0xf2, 0xbf, 0xf4, 0xd2, 0x4b, 0xb9, 0xee,
-  0xba, 0xeb, 0xe8, 0xdb, 0xb7, 0x6f, 0xa7, 0x37, 0xf4, 0xa4, 0x49, 0x93,
-  0x58, 0xbe, 0x7c, 0x79, 0xd0, 0x9f, 0xf3, 0xbf, 0x27, 0xc7, 0x71, 0xc6,
-  0xaf, 0x07, 0x68, 0xf5, 0x15, 0xa4, 0x98, 0x50, 0xf4, 0x18, 0xff, 0x78,
-  0x03, 0xe4, 0x25, 0xf3, 0xf2, 0xe3, 0x9b, 0x39, 0xfb, 0x8a, 0xd5, 0x41,
-  0x7b, 0xd4, 0xf0, 0xe1, 0xc3, 0x39, 0xf3, 0xcc, 0x33, 0x99, 0x3b, 0x77,
-  0x2e, 0x45, 0x45, 0x45, 0x61, 0xd9, 0x1c, 0xbb, 0x76, 0xed, 0x62, 0xce,
-  0x9c, 0x39, 0x7c, 0xf3, 0xcd, 0x37, 0x41, 0x7b, 0xc6, 0x53, 0x7f, 0x1f,
-  0xc9, 0x25, 0x37, 0x0c, 0x81, 0x8a, 0xe6, 0xd8, 0x2e, 0x2c, 0xe4, 0x55,
-  0x51, 0x72, 0x2c, 0xb4, 0x55, 0xb7, 0x92, 0x33, 0xf8, 0x0d, 0x9a, 0x83,
-  0x57, 0x2f, 0x62, 0x07, 0x70, 0x1e, 0xb0, 0x3e, 0x12, 0x9b, 0x29, 0x52,
-  0xa3, 0x46, 0x16, 0x02, 0xa6, 0x60, 0xdc, 0x38, 0x29, 0xc1, 0xc0, 0x83,
-  0xf7, 0x0d, 0x07, 0x5b, 0x1b, 0xfc, 0xb8, 0xc0, 0x84, 0x47, 0x45, 0xc9,
-  0x8a, 0x03, 0x83, 0xc2, 0xc9, 0xb3, 0x3e, 0x08, 0xb8, 0xf1, 0xb7, 0x58,
-  0x2c, 0xbc, 0xf0, 0xc2, 0x0b, 0x3c, 0xf1, 0xc4, 0x13, 0x9d, 0x6e, 0xfc,
-  0xdb, 0xda, 0xda, 0x98, 0x3f, 0x7f, 0x7e, 0x48, 0x8c, 0x3f, 0xc0, 0xdc,
-  0x4b, 0x57, 0xf1, 0xe1, 0xab, 0x3b, 0x51, 0x8a, 0x53, 0xd1, 0xca, 0x09,
-  0x0a, 0x11, 0xff, 0x02, 0x4e, 0x30, 0x42, 0x5e, 0x12, 0x8f, 0xdc, 0xb3,
-  0x3e, 0x68, 0xc6, 0x7f, 0xd6, 0xac, 0x59, 0x2c, 0x59, 0xb2, 0x84, 0xf5,
-  0xeb, 0xd7, 0x73, 0xc3, 0x0d, 0x37, 0x84, 0xad, 0xf1, 0x07, 0x68, 0x6d,
-  0x6d, 0x0d, 0x7a, 0x5c, 0xc0, 0xaf, 0x6f, 0x5c, 0xcb, 0x83, 0xbf, 0x5f,
-  0x0b, 0x79, 0x49, 0x28, 0x09, 0x06, 0xf0, 0xc6, 0xe8, 0x5c, 0xd2, 0x29,
-  0x50, 0xd5, 0x4a, 0x7c, 0xf7, 0x34, 0x1e, 0xbf, 0x6b, 0x68, 0x30, 0x9f,
-  0x64, 0x02, 0x9e, 0x88, 0xd8, 0x66, 0x8a, 0xc0, 0xcf, 0x6c, 0x42, 0x2b,
-  0xf5, 0x1b, 0x14, 0xd7, 0xff, 0x23, 0x77, 0x0c, 0x21, 0xa9, 0x24, 0x03,
-  0xb5, 0xaa, 0xed, 0x87, 0xea, 0x59, 0x55, 0xb5, 0x09, 0x95, 0x62, 0xe6,
-  0xe2, 0x05, 0xcb, 0xf8, 0x70, 0x4d, 0x4d, 0x40, 0x9f, 0x3b, 0x7e, 0xfc,
-  0x78, 0x36, 0x6f, 0xde, 0xcc, 0xb9, 0xe7, 0x9e, 0xdb, 0xe9, 0x0d, 0x5c,
-  0x5b, 0x5b, 0xcb, 0xf0, 0xe1, 0xc3, 0x59, 0xb4, 0x68, 0x51, 0x48, 0x9f,
-  0x7b, 0xf2, 0x99, 0xcb, 0xd8, 0xf9, 0x59, 0x05, 0x4a, 0x8f, 0x94, 0x9f,
-  0x8a, 0x2f, 0x21, 0xc2, 0x8c, 0xbf, 0x01, 0x72, 0x12, 0xb9, 0xef, 0xe6,
-  0x35, 0x5c, 0x7b, 0xe7, 0x97, 0x81, 0x1f, 0x2b, 0x27, 0x9f, 0xcc, 0xea,
-  0xd5, 0xab, 0x59, 0xbc, 0x78, 0x31, 0xd3, 0xa6, 0x4d, 0x0b, 0xfb, 0x26,
-  0xb9, 0xff, 0xfe, 0xfb, 0x19, 0x3c, 0x78, 0x30, 0xbb, 0x76, 0x05, 0x3f,
-  0xbb, 0xe1, 0x0d, 0x7f, 0xda, 0xc8, 0x5f, 0x6e, 0xfb, 0x1c, 0x72, 0x92,
-  0x34, 0x11, 0x16, 0xa3, 0x22, 0x40, 0x55, 0x14, 0xa8, 0xb4, 0x72, 0xd6,
-  0xf5, 0x03, 0x18, 0x3b, 0x34, 0x33, 0x58, 0x8f, 0x29, 0x46, 0x4b, 0x3f,
-  0x3f, 0x43, 0x04, 0x40, 0x68, 0x78, 0x25, 0x58, 0xab, 0xff, 0xe3, 0x7a,
-  0xa7, 0x70, 0xc1, 0xf5, 0x03, 0xa0, 0xca, 0xfa, 0x53, 0xd7, 0x99, 0xa2,
-  0x40, 0x6e, 0x32, 0x0f, 0xdf, 0xb9, 0x9e, 0x67, 0x5e, 0xdf, 0x1b, 0xd0,
-  0xe7, 0xfe, 0xe6, 0x37, 0xbf, 0x61, 0xe5, 0xca, 0x95, 0x74, 0xef, 0xde,
-  0xbd, 0xd3, 0x1b, 0xb7, 0xae, 0xae, 0x8e, 0x71, 0xe3, 0xc6, 0xb1, 0x75,
-  0xeb, 0xd6, 0x90, 0x3f, 0xdb, 0x0b, 0x4c, 0x3d, 0xe3, 0x23, 0x5a, 0xf6,
-  0x59, 0x51, 0xba, 0x26, 0x8a, 0x08, 0x88, 0x54, 0xe3, 0x6f, 0x31, 0x40,
-  0x4e, 0x12, 0xf7, 0xdd, 0xbc, 0x86, 0xdb, 0xfe, 0xfa, 0x75, 0x40, 0x6f,
-  0x3f, 0x64, 0xc8, 0x10, 0xde, 0x7c, 0xf3, 0x4d, 0xde, 0x7b, 0xef, 0x3d,
-  0xc6, 0x8c, 0x19, 0x13, 0x11, 0x4d, 0x72, 0xeb, 0xad, 0xb7, 0x72, 0xeb,
-  0xad, 0xb7, 0x86, 0xf4, 0x99, 0xb7, 0xdc, 0xb7, 0x89, 0xbf, 0xde, 0xe2,
-  0x13, 0x01, 0x96, 0x18, 0xf5, 0x04, 0x28, 0x68, 0xb9, 0x5b, 0x80, 0x85,
-  0x0f, 0x04, 0x35, 0x58, 0xbf, 0x37, 0x5a, 0x4c, 0x5a, 0xc4, 0x11, 0x69,
-  0xa9, 0x80, 0x0d, 0xc0, 0x5d, 0x04, 0x29, 0xe5, 0xef, 0x92, 0x67, 0x26,
-  0x90, 0xd3, 0x3f, 0x1d, 0xb5, 0xaa, 0xf5, 0x87, 0x02, 0xc0, 0xa3, 0xa2,
-  0xf4, 0x48, 0x65, 0xcd, 0x9b, 0xa5, 0xcc, 0xbb, 0xea, 0xb3, 0x80, 0x3e,
-  0xf3, 0xe9, 0xa7, 0x9f, 0xe6, 0xb6, 0xdb, 0x6e, 0x0b, 0x8b, 0xc6, 0x6d,
-  0x6a, 0x6a, 0x62, 0xd8, 0xb0, 0x61, 0xec, 0xd9, 0xd3, 0x79, 0x49, 0x59,
-  0x9a, 0x6c, 0x6e, 0x56, 0x2e, 0xaf, 0xe4, 0xa2, 0x4b, 0xfb, 0xa0, 0xe8,
-  0x80, 0x36, 0xcf, 0xd1, 0x4b, 0x2e, 0x0b, 0x61, 0xb2, 0xe4, 0x52, 0x51,
-  0xe2, 0xf4, 0x90, 0x97, 0xcc, 0xfd, 0xb7, 0x7c, 0x1e, 0x50, 0xe3, 0x1f,
-  0x1f, 0x1f, 0xcf, 0x7d, 0xf7, 0xdd, 0xc7, 0x73, 0xcf, 0x3d, 0x47, 0x9f,
-  0x3e, 0x7d, 0x22, 0xa6, 0x49, 0xae, 0xbe, 0xfa, 0x6a, 0x1e, 0x7a, 0xe8,
-  0xa1, 0x4e, 0x79, 0xf6, 0x47, 0xab, 0xab, 0x49, 0x74, 0xb9, 0x19, 0x73,
-  0x5a, 0x77, 0x94, 0x56, 0x17, 0x78, 0xbc, 0xb1, 0x37, 0x97, 0x74, 0x0a,
-  0x4a, 0x93, 0x83, 0xf4, 0x21, 0x39, 0x38, 0x2b, 0x6d, 0xac, 0xfa, 0x32,
-  0x68, 0xa7, 0x4f, 0x9a, 0x7c, 0xf6, 0xe9, 0x73, 0x11, 0x00, 0xc1, 0xe3,
-  0x3f, 0x40, 0x21, 0x5a, 0x4e, 0xe6, 0x80, 0x72, 0xf6, 0xac, 0x42, 0xae,
-  0xba, 0x7b, 0x04, 0x94, 0x5b, 0x7f, 0x18, 0x80, 0xe6, 0x55, 0x51, 0x72,
-  0x2d, 0x38, 0xaa, 0x5b, 0x18, 0x79, 0xf2, 0x07, 0xb4, 0x04, 0xa8, 0x1c,
-  0x69, 0x52, 0x52, 0x12, 0xef, 0xbd, 0xf7, 0x1e, 0x67, 0x9c, 0x71, 0x46,
-  0xd8, 0x34, 0xee, 0x09, 0x27, 0x9c, 0x10, 0xd4, 0x00, 0xa5, 0xf6, 0xb2,
-  0xaf, 0xaa, 0x8d, 0xb6, 0x83, 0x2d, 0x4c, 0x3d, 0xb3, 0x17, 0x8a, 0xcd,
-  0xa9, 0xb9, 0x06, 0x44, 0x03, 0x84, 0xb9, 0xf1, 0x07, 0x45, 0xa7, 0x40,
-  0x61, 0x2a, 0xcf, 0x3d, 0xb0, 0x91, 0x6b, 0xee, 0xda, 0x10, 0xb0, 0x5b,
-  0x9f, 0x7c, 0xf2, 0xc9, 0xbc, 0xfd, 0xf6, 0xdb, 0xcc, 0x9c, 0x39, 0x33,
-  0xa2, 0x9a, 0xe4, 0x96, 0x5b, 0x6e, 0xe9, 0x34, 0xe3, 0x7f, 0x98, 0xa5,
-  0x9f, 0x56, 0x51, 0x94, 0xa8, 0x67, 0xc8, 0xf4, 0xee, 0x28, 0xcd, 0x8e,
-  0xd8, 0x9c, 0x4b, 0xaa, 0x82, 0xa2, 0x53, 0x99, 0x38, 0x36, 0x9b, 0x7f,
-  0x3d, 0xb3, 0x93, 0xd6, 0xe0, 0x94, 0x94, 0xce, 0xf4, 0xd9, 0xa6, 0x7f,
-  0x8a, 0x00, 0x08, 0x0e, 0x26, 0xe0, 0x0f, 0xc1, 0x58, 0xfd, 0x1b, 0xf4,
-  0x0a, 0x1f, 0xff, 0x77, 0x0a, 0x96, 0x14, 0x23, 0x6a, 0x93, 0xf3, 0x3b,
-  0x95, 0xac, 0x82, 0x62, 0xd6, 0x43, 0xa6, 0x85, 0xb3, 0xe6, 0x7f, 0x14,
-  0xb0, 0xa0, 0xbf, 0xbc, 0xbc, 0x3c, 0xd6, 0xac, 0x59, 0xc3, 0xf0, 0xe1,
-  0xe1, 0x73, 0x7a, 0xe4, 0xfc, 0xf3, 0xcf, 0xe7, 0xbd, 0xf7, 0xde, 0x0b,
-  0x9b, 0xcf, 0xb3, 0x7a, 0x63, 0x1d, 0x43, 0xf2, 0xe2, 0xe9, 0x33, 0xb9,
-  0x2b, 0xd4, 0xb5, 0x49, 0x7e, 0x80, 0x70, 0xc7, 0xab, 0xa2, 0x74, 0x4f,
-  0xe7, 0xfd, 0x17, 0xb6, 0x31, 0xef, 0x8a, 0xc0, 0x79, 0xc9, 0x1e, 0x7e,
-  0xf8, 0x61, 0x1e, 0x7e, 0xf8, 0x61, 0xd2, 0xd3, 0xd3, 0x23, 0xaa, 0x39,
-  0x1e, 0x7f, 0xfc, 0xf1, 0x90, 0xbb, 0xfd, 0x8f, 0xc4, 0x5b, 0x4b, 0x0f,
-  0x32, 0xb2, 0x47, 0x02, 0x3d, 0x27, 0x14, 0x40, 0xbd, 0x3d, 0xf6, 0x04,
-  0x80, 0x02, 0xd8, 0xdc, 0xe8, 0x8b, 0x52, 0xe8, 0x99, 0xa4, 0xe7, 0xd5,
-  0xe0, 0x1d, 0x0b, 0xb4, 0xf9, 0x9e, 0xf6, 0x79, 0x24, 0x35, 0x4d, 0xa4,
-  0xf0, 0x3a, 0x30, 0x98, 0x20, 0x04, 0xff, 0xfd, 0xfe, 0xaa, 0x7e, 0xfc,
-  0xe1, 0xd1, 0x09, 0x3f, 0x2d, 0xf6, 0xe3, 0xd5, 0x5c, 0xff, 0xef, 0x3c,
-  0xb5, 0x95, 0x59, 0x97, 0xae, 0x0a, 0xc8, 0xb3, 0xfa, 0xf4, 0xe9, 0xc3,
-  0xd2, 0xa5, 0x4b, 0x29, 0x28, 0x28, 0x08, 0x9b, 0x86, 0x7d, 0xe9, 0xa5,
-  0x97, 0xc2, 0x22, 0xf8, 0xf0, 0xc7, 0xc4, 0x9b, 0xf5, 0xec, 0xdb, 0x38,
-  0x9b, 0xcc, 0x92, 0x64, 0xd4, 0x72, 0x9b, 0xe4, 0x3b, 0x0f, 0x57, 0xdc,
-  0x2a, 0x4a, 0xcf, 0x64, 0x76, 0xaf, 0xad, 0xa1, 0xdf, 0xd8, 0xb7, 0x71,
-  0x05, 0x20, 0x76, 0xa3, 0x5b, 0xb7, 0x6e, 0xbc, 0xf4, 0xd2, 0x4b, 0x11,
-  0xb3, 0xcf, 0xff, 0x7d, 0x36, 0x6f, 0xde, 0xcc, 0x71, 0xc7, 0x1d, 0x17,
-  0x7e, 0x9f, 0x6b, 0xf9, 0x0c, 0x06, 0x4c, 0xcc, 0x47, 0xdd, 0xdd, 0x18,
-  0x93, 0x73, 0x49, 0x31, 0xeb, 0x21, 0x3b, 0x9e, 0x13, 0xc6, 0x2c, 0x66,
-  0xc5, 0xba, 0xda, 0x60, 0x3d, 0xe6, 0x1b, 0x60, 0xa0, 0x08, 0x80, 0x00,
-  0x2f, 0xd2, 0x7d, 0x0d, 0x1b, 0xf0, 0x73, 0xff, 0x5d, 0x32, 0xcc, 0x54,
-  0x6d, 0x9a, 0x83, 0xce, 0x62, 0x44, 0x6d, 0x70, 0x7c, 0xd7, 0x22, 0x2a,
-  0x28, 0x19, 0x66, 0x9c, 0xcd, 0x4e, 0x72, 0x07, 0xbe, 0x4e, 0x7d, 0x93,
-  0xf3, 0x98, 0x9f, 0xd5, 0xb3, 0x67, 0x4f, 0xbe, 0xfa, 0xea, 0x2b, 0x2c,
-  0x16, 0x4b, 0xd8, 0x34, 0x6c, 0x4d, 0x4d, 0x0d, 0x05, 0x05, 0x05, 0xb8,
-  0x5c, 0xae, 0xb0, 0xec, 0xf8, 0x09, 0x43, 0x33, 0x59, 0xb1, 0xee, 0x34,
-  0x38, 0x64, 0x3f, 0x72, 0x31, 0x26, 0xa1, 0xf3, 0xf0, 0x68, 0x5b, 0x64,
-  0x2e, 0x9b, 0x8b, 0x5e, 0x43, 0xde, 0x60, 0x6f, 0x00, 0xca, 0x5f, 0x4f,
-  0x98, 0x30, 0x81, 0xc5, 0x8b, 0x17, 0x93, 0x92, 0x92, 0x12, 0x71, 0xcd,
-  0xa1, 0xaa, 0x2a, 0xdd, 0xbb, 0x77, 0x67, 0xef, 0xde, 0xbd, 0x61, 0xf7,
-  0xd9, 0xb2, 0x52, 0x4d, 0xec, 0xdc, 0x38, 0x9b, 0x94, 0xfc, 0x04, 0xd4,
-  0xbd, 0x36, 0x30, 0xc4, 0xd8, 0x64, 0xf2, 0xaa, 0x28, 0xdd, 0x93, 0xd9,
-  0xbd, 0xbc, 0x92, 0x9e, 0x93, 0xdf, 0x0d, 0xd6, 0x53, 0xca, 0x80, 0xc7,
-  0xd0, 0x52, 0xd4, 0x87, 0x3d, 0x91, 0x72, 0x0a, 0xe0, 0x1f, 0x04, 0x29,
-  0xf2, 0xff, 0x1f, 0xb7, 0x0c, 0x42, 0x97, 0x9f, 0xfc, 0xf3, 0xae, 0xb1,
-  0x14, 0x0b, 0xb7, 0xdd, 0xbd, 0x21, 0x20, 0xc6, 0xbf, 0x47, 0x8f, 0x1e,
-  0x7c, 0xfa, 0xe9, 0xa7, 0x61, 0x65, 0xfc, 0x41, 0x0b, 0x52, 0x0a, 0x57,
-  0xe3, 0x0f, 0xb0, 0x72, 0xc3, 0x21, 0x1e, 0xbe, 0xeb, 0x4b, 0xc8, 0x4e,
-  0xfc, 0x69, 0x52, 0x26, 0xa1, 0x93, 0xad, 0x1d, 0x28, 0x89, 0x46, 0x48,
-  0x30, 0x72, 0xc6, 0x99, 0xcb, 0x02, 0x62, 0xfc, 0xcf, 0x3b, 0xef, 0x3c,
-  0x56, 0xac, 0x58, 0x11, 0x91, 0xc6, 0x1f, 0xe0, 0xf6, 0xdb, 0x6f, 0x0f,
-  0x4b, 0xe3, 0x0f, 0x50, 0xd3, 0xe8, 0x64, 0xd6, 0x9c, 0x8f, 0x7c, 0xa5,
-  0xcb, 0xcd, 0xb1, 0x77, 0x32, 0x40, 0xa7, 0xc0, 0x5e, 0x2b, 0x25, 0x93,
-  0x0a, 0xb8, 0x78, 0x6e, 0x71, 0xb0, 0x9e, 0x52, 0x0c, 0x5c, 0x24, 0x1e,
-  0x80, 0xc0, 0x8a, 0x94, 0xa0, 0x64, 0xfd, 0xeb, 0xd3, 0x23, 0x99, 0x6d,
-  0x9b, 0xe6, 0x80, 0xcd, 0xf5, 0xc3, 0xd5, 0xa5, 0xaa, 0xa2, 0x14, 0x24,
-  0xb0, 0x6f, 0xfd, 0x21, 0x8a, 0xc6, 0xbd, 0x7d, 0xcc, 0xcf, 0x29, 0x28,
-  0x28, 0x60, 0xd3, 0xa6, 0x4d, 0x61, 0xb7, 0x8f, 0xb9, 0x69, 0xd3, 0x26,
-  0x06, 0x0f, 0x1e, 0x1c, 0x11, 0x03, 0xb5, 0x7c, 0xcd, 0xa9, 0x14, 0x8e,
-  0xe8, 0x82, 0xba, 0xd7, 0x2a, 0xf1, 0x00, 0xe1, 0xf4, 0xf2, 0x28, 0x4e,
-  0xe3, 0xff, 0x6e, 0x5b, 0xc3, 0x75, 0xf7, 0x6d, 0x3a, 0xe6, 0xfb, 0x5d,
-  0x73, 0xcd, 0x35, 0x3c, 0xfc, 0xf0, 0xc3, 0x11, 0xdb, 0x1e, 0x95, 0x95,
-  0x95, 0xe4, 0xe5, 0xe5, 0x85, 0xfd, 0xe7, 0xbc, 0x7c, 0x41, 0x77, 0xfe,
-  0xf5, 0xca, 0x54, 0x38, 0xd8, 0x8c, 0xea, 0xf0, 0xc6, 0x96, 0x57, 0xcd,
-  0x97, 0x21, 0xd0, 0xba, 0xbf, 0x85, 0xbc, 0x61, 0x6f, 0x60, 0x6b, 0x75,
-  0x07, 0xcb, 0x0b, 0xf0, 0x67, 0xe0, 0x69, 0xf1, 0x00, 0x1c, 0x3b, 0x7f,
-  0x0f, 0xd6, 0xea, 0xff, 0xa1, 0x5b, 0x06, 0x41, 0x82, 0x09, 0xd5, 0xfa,
-  0xc3, 0x62, 0x3f, 0x8a, 0x4e, 0x07, 0x26, 0x03, 0x37, 0xdf, 0xff, 0xd5,
-  0x31, 0x3f, 0xc3, 0x62, 0xb1, 0xb0, 0x6c, 0xd9, 0xb2, 0xb0, 0x0c, 0x62,
-  0x0a, 0x97, 0xe3, 0x87, 0xed, 0xe1, 0x82, 0xdf, 0xac, 0xd1, 0xfa, 0x26,
-  0xde, 0x80, 0x10, 0x06, 0x78, 0x54, 0x28, 0x4e, 0x66, 0xc3, 0xfb, 0x65,
-  0x01, 0x31, 0xfe, 0x37, 0xde, 0x78, 0x63, 0x44, 0x1b, 0x7f, 0x80, 0xdf,
-  0xff, 0xfe, 0xf7, 0x11, 0xf1, 0x39, 0x1f, 0x7f, 0xb5, 0x94, 0x97, 0xff,
-  0xb1, 0x09, 0xf2, 0x53, 0x62, 0x2f, 0xeb, 0xa6, 0x2f, 0x43, 0x60, 0x52,
-  0x9f, 0x0c, 0xfe, 0x70, 0x6d, 0xff, 0x60, 0x7a, 0x01, 0xae, 0x12, 0x0f,
-  0x40, 0x60, 0xd8, 0x1e, 0x8c, 0xd5, 0xff, 0xe8, 0xa1, 0x19, 0x7c, 0xf6,
-  0xd9, 0xa9, 0xda, 0xde, 0xb2, 0xd3, 0xfb, 0xdd, 0x3f, 0xa8, 0xa0, 0x14,
-  0x24, 0x50, 0xba, 0xa6, 0x9a, 0x1e, 0x27, 0x1c, 0xfb, 0x3e, 0xd1, 0x9a,
-  0x35, 0x6b, 0x18, 0x35, 0x6a, 0x54, 0xd8, 0x35, 0xea, 0xae, 0x5d, 0xbb,
-  0xe8, 0xd5, 0xab, 0x57, 0x44, 0xcd, 0xdd, 0x57, 0x1e, 0x1c, 0xc9, 0x82,
-  0xeb, 0x07, 0xa3, 0xee, 0x6e, 0x90, 0x80, 0xc0, 0xce, 0x5e, 0x45, 0x65,
-  0xc5, 0xa3, 0x3a, 0x3c, 0x14, 0xf6, 0x7f, 0x8d, 0x03, 0x35, 0xc7, 0x56,
-  0x39, 0xf2, 0xea, 0xab, 0xaf, 0xe6, 0x91, 0x47, 0x1e, 0x89, 0xe8, 0x26,
-  0xa9, 0xa9, 0xa9, 0x21, 0x3b, 0x3b, 0x3b, 0xa2, 0x3e, 0xf3, 0xee, 0x55,
-  0x33, 0xe9, 0x31, 0x26, 0x07, 0x75, 0x4f, 0x73, 0x6c, 0xcd, 0x27, 0x15,
-  0x94, 0x14, 0x13, 0x78, 0x55, 0xf2, 0x07, 0xbe, 0x46, 0x45, 0x75, 0x50,
-  0x2a, 0x9f, 0xee, 0x00, 0x6e, 0x43, 0x0b, 0x5e, 0x17, 0x0f, 0x80, 0x9f,
-  0x5c, 0x1e, 0xac, 0xd5, 0xff, 0xdf, 0x7f, 0x37, 0x08, 0xcc, 0x06, 0xd4,
-  0x9f, 0x9c, 0x09, 0x55, 0xc1, 0x64, 0xe4, 0xde, 0xc7, 0x8e, 0x3d, 0x13,
-  0xde, 0xd3, 0x4f, 0x3f, 0x1d, 0x96, 0xc6, 0x1f, 0x60, 0xe1, 0xc2, 0x85,
-  0x11, 0x37, 0x6f, 0xaf, 0xf8, 0xc3, 0x46, 0x3c, 0x07, 0xad, 0x28, 0x5d,
-  0xe2, 0x24, 0x1e, 0xa0, 0x33, 0x57, 0x0d, 0x46, 0x1d, 0x24, 0xc5, 0x71,
-  0xd9, 0x15, 0xab, 0x8f, 0xd9, 0xf8, 0x2f, 0x58, 0xb0, 0x20, 0xe2, 0x8d,
-  0x3f, 0xc0, 0x73, 0xcf, 0x3d, 0x17, 0x71, 0x9f, 0x79, 0xe6, 0x79, 0x2b,
-  0xa0, 0xcd, 0x8d, 0x92, 0x19, 0x17, 0x5b, 0xf1, 0x00, 0x0a, 0x5a, 0xc0,
-  0x77, 0x97, 0x04, 0x1e, 0xb8, 0x39, 0x68, 0xa7, 0x35, 0x7a, 0xa3, 0x25,
-  0xad, 0x0b, 0x6f, 0x87, 0x48, 0x98, 0x7f, 0xbe, 0xab, 0x08, 0xc2, 0xb1,
-  0xbf, 0xd1, 0x43, 0x33, 0x18, 0x33, 0xb7, 0x1b, 0x1c, 0xb0, 0xfd, 0x64,
-  0x3f, 0x59, 0xc9, 0xb5, 0x50, 0xba, 0xe2, 0x00, 0x0b, 0xff, 0xb7, 0xf7,
-  0xd8, 0x3e, 0xf8, 0x55, 0x57, 0x71, 0xf1, 0xc5, 0x17, 0x87, 0x6d, 0xc3,
-  0xbe, 0xfa, 0xea, 0xab, 0x11, 0x37, 0x6f, 0x1b, 0x9a, 0x9c, 0xdc, 0x76,
-  0xf7, 0x97, 0x90, 0x12, 0x2f, 0x87, 0x01, 0x3a, 0x0b, 0x8f, 0x0a, 0x85,
-  0xc9, 0xbc, 0xf3, 0xf4, 0x16, 0x9e, 0xfa, 0x5f, 0xd9, 0x31, 0xdd, 0x6a,
-  0xd8, 0xb0, 0x61, 0xbc, 0xf2, 0xca, 0x2b, 0x51, 0xd1, 0x2c, 0x91, 0x28,
-  0x00, 0xb6, 0x97, 0x59, 0xf9, 0xed, 0x95, 0xab, 0x21, 0x35, 0x0e, 0xc5,
-  0xa0, 0x8b, 0xad, 0x71, 0xac, 0x57, 0xa0, 0xca, 0xc6, 0x99, 0x97, 0xf6,
-  0x65, 0x60, 0xef, 0xa0, 0x05, 0x9c, 0x9a, 0x81, 0x61, 0x22, 0x00, 0xfc,
-  0x63, 0x0a, 0x5a, 0x99, 0xeb, 0x80, 0xf3, 0x97, 0x1b, 0x8f, 0x03, 0x83,
-  0x5e, 0xab, 0x99, 0xfd, 0x43, 0x61, 0x08, 0xf1, 0x26, 0x1e, 0x79, 0x6e,
-  0x17, 0xde, 0x63, 0xd8, 0x1b, 0x2b, 0x29, 0x29, 0xe1, 0xd1, 0x47, 0x1f,
-  0x0d, 0xdb, 0x86, 0xdd, 0xba, 0x75, 0x6b, 0xa7, 0xa6, 0xfb, 0x3d, 0x16,
-  0xfe, 0xfa, 0xf4, 0x0e, 0xf6, 0x7d, 0x5e, 0x09, 0x05, 0x09, 0xb1, 0x5b,
-  0xe9, 0xac, 0xb3, 0xf0, 0xaa, 0x28, 0x39, 0xf1, 0xb8, 0xf6, 0x5b, 0x39,
-  0xff, 0x86, 0x75, 0xc7, 0x74, 0xab, 0xb4, 0xb4, 0x34, 0x3e, 0xf8, 0xe0,
-  0x83, 0xa8, 0x68, 0x96, 0xb2, 0xb2, 0x32, 0xb6, 0x6c, 0xd9, 0x12, 0x91,
-  0x9f, 0xfd, 0xa1, 0xe7, 0x76, 0xb1, 0xf2, 0xe5, 0x5d, 0x50, 0x94, 0x02,
-  0xee, 0xd8, 0x9a, 0x4f, 0x6a, 0x8b, 0x0b, 0x12, 0x4c, 0xfc, 0xe3, 0xb6,
-  0xa0, 0x05, 0x42, 0x9b, 0x80, 0xc7, 0x45, 0x00, 0xf8, 0xc7, 0xdf, 0x08,
-  0xc2, 0xde, 0xff, 0xd8, 0x61, 0x99, 0x8c, 0x9f, 0x5b, 0xfc, 0xb3, 0xab,
-  0x7f, 0x2c, 0x06, 0xa8, 0xb0, 0xf1, 0xe6, 0xd2, 0x03, 0xc7, 0xf4, 0x8c,
-  0xb7, 0xde, 0x7a, 0x2b, 0xac, 0x07, 0xfe, 0x8a, 0x15, 0x2b, 0x22, 0x7a,
-  0xe2, 0x5e, 0x7d, 0xdb, 0x7a, 0x30, 0xe9, 0x35, 0x57, 0xb4, 0x10, 0x32,
-  0x14, 0xa3, 0x0e, 0x12, 0xcd, 0x5c, 0x7a, 0xed, 0x1a, 0x1a, 0x9a, 0x8f,
-  0xed, 0x68, 0xec, 0x92, 0x25, 0x4b, 0xc8, 0xc8, 0xc8, 0x88, 0x8a, 0x76,
-  0x89, 0xf4, 0xf9, 0xb4, 0xe0, 0x37, 0x6b, 0x70, 0x55, 0xdb, 0x50, 0xb2,
-  0x63, 0x6c, 0x2b, 0x40, 0xa7, 0xc0, 0x01, 0x2b, 0x93, 0xcf, 0x2d, 0x61,
-  0xf4, 0xd0, 0xa0, 0x8c, 0xc5, 0x62, 0x20, 0x09, 0xe8, 0x26, 0x02, 0xa0,
-  0x63, 0xf4, 0x46, 0x2b, 0xb1, 0x18, 0xf8, 0x15, 0xe4, 0x8d, 0xc7, 0x81,
-  0xf1, 0xa7, 0xab, 0x7f, 0x54, 0x20, 0x33, 0x8e, 0xcf, 0x3f, 0xab, 0x66,
-  0xef, 0x01, 0xff, 0xcf, 0x33, 0xdf, 0x73, 0xcf, 0x3d, 0xf4, 0xeb, 0xd7,
-  0x2f, 0xac, 0xc7, 0xfd, 0x86, 0x0d, 0x1b, 0x22, 0x7a, 0xde, 0xbe, 0xfd,
-  0x49, 0x25, 0xeb, 0x5e, 0x2b, 0x83, 0xc2, 0x24, 0xf1, 0x02, 0x84, 0x0a,
-  0x8f, 0x0a, 0x85, 0x49, 0xac, 0x7d, 0x6d, 0x0f, 0x0b, 0xdf, 0xdc, 0x7b,
-  0x6c, 0xca, 0xfe, 0x6f, 0x7f, 0xe3, 0xf8, 0xe3, 0x8f, 0x8f, 0x9a, 0xa6,
-  0xd9, 0xb4, 0x69, 0x53, 0x44, 0x7f, 0xfe, 0xaa, 0x5a, 0x3b, 0x57, 0x5f,
-  0xf3, 0x19, 0x24, 0xc7, 0xc7, 0xdc, 0x56, 0x80, 0xea, 0xf0, 0x80, 0x4e,
-  0xa7, 0x79, 0x85, 0x83, 0xe7, 0x05, 0x08, 0xdb, 0xfd, 0xd6, 0x70, 0xed,
-  0xed, 0x17, 0x08, 0x42, 0xf0, 0xdf, 0x98, 0xa1, 0x99, 0x47, 0xdc, 0xfb,
-  0x47, 0x01, 0xf4, 0xc7, 0x96, 0x27, 0x7a, 0xc0, 0x80, 0x01, 0xdc, 0x7e,
-  0xfb, 0xed, 0x61, 0x3f, 0xe8, 0xb7, 0x6d, 0xdb, 0x16, 0xf1, 0x13, 0xf7,
-  0xea, 0x3f, 0x6e, 0x80, 0x36, 0x97, 0x1c, 0x0b, 0x0c, 0xc9, 0x5b, 0x12,
-  0x94, 0x64, 0x23, 0x58, 0x1d, 0x9c, 0x7b, 0xc3, 0xda, 0x63, 0xba, 0xd5,
-  0xc4, 0x89, 0x13, 0xb9, 0xf1, 0xc6, 0x1b, 0xa3, 0xaa, 0x79, 0x22, 0xd5,
-  0xfd, 0xff, 0x7d, 0x9e, 0x5c, 0x54, 0xc6, 0x67, 0xff, 0xdb, 0x0d, 0x45,
-  0x49, 0xb1, 0x55, 0x86, 0x5b, 0xa7, 0xc0, 0x01, 0x1b, 0xe3, 0xe7, 0x75,
-  0x67, 0xca, 0x98, 0xac, 0x60, 0x79, 0x01, 0x52, 0x7c, 0xbf, 0x44, 0x00,
-  0xb4, 0x83, 0x4c, 0x20, 0x99, 0x20, 0x04, 0xff, 0xfd, 0xe1, 0x9a, 0x7e,
-  0x3f, 0xbb, 0xf7, 0x0f, 0x68, 0x65, 0x4c, 0x6b, 0x5a, 0x78, 0xeb, 0xa3,
-  0x83, 0x7e, 0xdf, 0xff, 0xc5, 0x17, 0x5f, 0x0c, 0xfb, 0xf1, 0xee, 0xf5,
-  0x7a, 0xa9, 0xae, 0xae, 0x8e, 0xf8, 0x79, 0xbb, 0xfe, 0xeb, 0x7a, 0x96,
-  0xfc, 0x67, 0x0f, 0xe4, 0x25, 0x8a, 0x17, 0x20, 0xe8, 0x02, 0x40, 0x85,
-  0xac, 0x44, 0x9e, 0x78, 0xf0, 0x1b, 0x76, 0x97, 0xdb, 0xfc, 0xbe, 0x8d,
-  0xa2, 0x28, 0xfc, 0xf7, 0xbf, 0xff, 0x8d, 0xba, 0xe6, 0xa9, 0xac, 0xac,
-  0x8c, 0x8a, 0xef, 0x71, 0xee, 0xf5, 0x9f, 0x43, 0xb3, 0x13, 0x25, 0xcd,
-  0x1c, 0x53, 0xa7, 0x6c, 0x54, 0x87, 0x07, 0x0c, 0x3a, 0x1e, 0x0a, 0x6e,
-  0x2c, 0x40, 0x58, 0x0e, 0xfc, 0x70, 0x14, 0x00, 0x6f, 0x06, 0x63, 0xf5,
-  0x3f, 0xa4, 0x7f, 0x1a, 0x27, 0xce, 0xed, 0x0e, 0x15, 0x2d, 0x3f, 0x9f,
-  0x49, 0x2e, 0x33, 0x8e, 0xaf, 0xd6, 0xd6, 0x52, 0xb6, 0xbf, 0xc5, 0xaf,
-  0xfb, 0x5f, 0x76, 0xd9, 0x65, 0x0c, 0x1a, 0x34, 0x28, 0xec, 0x07, 0x7b,
-  0x73, 0x73, 0x33, 0x8d, 0x8d, 0x8d, 0x51, 0x31, 0x71, 0x7f, 0xf7, 0xd7,
-  0xaf, 0xa1, 0xcd, 0x29, 0x5e, 0x80, 0x60, 0xaf, 0xfe, 0xbb, 0xc4, 0xd3,
-  0xb2, 0xa7, 0x81, 0xdf, 0xfd, 0xed, 0xeb, 0x63, 0xba, 0xd5, 0x8b, 0x2f,
-  0xbe, 0x48, 0x56, 0x56, 0x56, 0x54, 0x35, 0x4f, 0x5b, 0x5b, 0x1b, 0x0d,
-  0x0d, 0x0d, 0x51, 0xf1, 0x5d, 0xca, 0x0e, 0xb4, 0x70, 0xcf, 0x9d, 0x5f,
-  0x40, 0x46, 0x42, 0x6c, 0x9d, 0xb2, 0xd1, 0x29, 0xb0, 0xcf, 0xca, 0xc0,
-  0x19, 0x85, 0x9c, 0x38, 0x36, 0x28, 0xb9, 0x1c, 0x8a, 0x81, 0xa2, 0x70,
-  0xb4, 0xb7, 0xe1, 0xf6, 0x81, 0x0c, 0x3e, 0x0f, 0x40, 0xc0, 0x57, 0xff,
-  0x77, 0x5d, 0xd5, 0x17, 0x12, 0x4d, 0xa8, 0x6d, 0x3f, 0x4d, 0xfd, 0xa8,
-  0x00, 0x18, 0x0d, 0xbc, 0xbd, 0xbc, 0xc2, 0xaf, 0x7b, 0x9b, 0xcd, 0x66,
-  0xfe, 0xfa, 0xd7, 0xbf, 0x46, 0xc4, 0x58, 0xb7, 0xdb, 0xed, 0x38, 0x9d,
-  0xce, 0xa8, 0x98, 0xb7, 0xdf, 0xec, 0x6c, 0xe2, 0x83, 0xc3, 0x5e, 0x00,
-  0x55, 0xbc, 0x00, 0x41, 0x53, 0x00, 0xc9, 0x71, 0xdc, 0x79, 0xcf, 0x57,
-  0x58, 0x5b, 0xfc, 0x4f, 0x9b, 0x3a, 0x63, 0xc6, 0x0c, 0xce, 0x3e, 0xfb,
-  0xec, 0xa8, 0x6b, 0x1d, 0x9b, 0xcd, 0x46, 0x6b, 0x6b, 0x6b, 0xd4, 0x7c,
-  0x9f, 0xbb, 0x1e, 0xdd, 0x42, 0xd5, 0x97, 0x55, 0x90, 0x6f, 0x89, 0x29,
-  0xcf, 0x9a, 0xea, 0xf2, 0x02, 0x0a, 0x77, 0x5f, 0x1d, 0xb4, 0xf8, 0x2d,
-  0x13, 0x61, 0x98, 0x1d, 0x30, 0xdc, 0x04, 0xc0, 0xed, 0xc1, 0x58, 0xfd,
-  0x17, 0xe5, 0x27, 0x70, 0xda, 0x82, 0x1e, 0x50, 0x7d, 0x84, 0xd5, 0xbf,
-  0x51, 0x07, 0x8d, 0x6d, 0xbc, 0xf3, 0xb1, 0x7f, 0x02, 0xe0, 0xde, 0x7b,
-  0xef, 0x25, 0x39, 0x39, 0x39, 0x22, 0x06, 0xba, 0xd5, 0x6a, 0xc5, 0x66,
-  0xb3, 0x45, 0xcd, 0xc4, 0xbd, 0xfd, 0xff, 0xbe, 0xd1, 0xbc, 0x00, 0x26,
-  0xf1, 0x02, 0x04, 0x65, 0xf5, 0x9f, 0x9f, 0x40, 0xc5, 0xda, 0x4a, 0x1e,
-  0x5a, 0xb8, 0xd3, 0x7f, 0x55, 0x6f, 0x30, 0xf0, 0xfc, 0xf3, 0xcf, 0x47,
-  0x65, 0x13, 0x29, 0x8a, 0x82, 0xa2, 0x44, 0xcf, 0x7a, 0xd9, 0xeb, 0x85,
-  0xcb, 0x6e, 0x5a, 0x07, 0x66, 0x43, 0x6c, 0x9d, 0xb2, 0xf1, 0xc5, 0x02,
-  0x8c, 0x9d, 0x5d, 0xcc, 0xb8, 0x11, 0x5d, 0x82, 0xe5, 0x05, 0x08, 0xbb,
-  0xc4, 0x30, 0xe1, 0xd6, 0xc3, 0xb3, 0x83, 0xb1, 0xfa, 0xbf, 0xf5, 0xb2,
-  0x3e, 0x90, 0x6e, 0x41, 0xb5, 0x1d, 0xa1, 0xea, 0x5d, 0x9a, 0x99, 0xfd,
-  0xdf, 0x34, 0xf0, 0xc5, 0xe6, 0x8e, 0xbb, 0xf2, 0x32, 0x32, 0x32, 0xb8,
-  0xf6, 0xda, 0x6b, 0x23, 0x66, 0x9c, 0x27, 0x27, 0x27, 0x93, 0x94, 0x94,
-  0x14, 0x35, 0xf3, 0xf6, 0xcb, 0xcd, 0x0d, 0xac, 0x7e, 0xab, 0x1c, 0x0a,
-  0x2c, 0x12, 0x0b, 0x10, 0x70, 0xe3, 0x06, 0x98, 0x4d, 0xfc, 0xfe, 0x81,
-  0xcd, 0xc7, 0x74, 0x9f, 0x07, 0x1f, 0x7c, 0x30, 0x2c, 0x6b, 0x61, 0x04,
-  0x4c, 0x27, 0x45, 0x99, 0xf7, 0x69, 0xf1, 0xb2, 0x0a, 0x3e, 0x5f, 0x54,
-  0x0a, 0x85, 0xb1, 0x15, 0x5f, 0xa3, 0x3a, 0x3c, 0x60, 0x36, 0xf0, 0xa7,
-  0x6b, 0x82, 0x56, 0x23, 0x20, 0x0e, 0xe8, 0x29, 0x02, 0xe0, 0xe7, 0x19,
-  0xe4, 0x6b, 0xa0, 0x80, 0x92, 0x9a, 0x6c, 0xe2, 0xe2, 0xf3, 0x4a, 0xa0,
-  0xbe, 0xf5, 0xe7, 0x57, 0xff, 0x2a, 0x90, 0x60, 0xe2, 0xfd, 0x4f, 0xab,
-  0xf0, 0xfa, 0x31, 0xd8, 0xef, 0xbc, 0xf3, 0x4e, 0x8c, 0x46, 0x63, 0xc4,
-  0x0c, 0x72, 0xb3, 0xd9, 0x1c, 0x51, 0x9f, 0xb7, 0x3d, 0xfc, 0xe1, 0xb1,
-  0xad, 0x5a, 0x05, 0x47, 0x83, 0xe4, 0x05, 0x08, 0xe4, 0xea, 0x9f, 0x5c,
-  0x0b, 0xfb, 0x56, 0x55, 0xf0, 0xef, 0x45, 0xfe, 0x67, 0xfc, 0x1b, 0x34,
-  0x68, 0x10, 0xd7, 0x5c, 0x73, 0x4d, 0xd4, 0x36, 0x53, 0x4a, 0x4a, 0x0a,
-  0x89, 0x89, 0x89, 0x51, 0xf7, 0xbd, 0xae, 0xfb, 0xf3, 0x57, 0xe0, 0xf0,
-  0xa0, 0x98, 0xf5, 0xb1, 0xe5, 0x05, 0xa8, 0xb0, 0x72, 0xc2, 0x9c, 0x6e,
-  0x1c, 0xd7, 0x37, 0x35, 0x18, 0x4f, 0x30, 0x01, 0x61, 0x15, 0x29, 0x1e,
-  0x4e, 0x6f, 0xcc, 0x27, 0x09, 0x82, 0xfb, 0xff, 0xea, 0xf3, 0x4a, 0x30,
-  0x74, 0x4b, 0x85, 0xc6, 0x9f, 0xdf, 0xf7, 0x56, 0xf4, 0x0a, 0x78, 0x3c,
-  0x7c, 0xb8, 0xb2, 0xe3, 0x91, 0xf1, 0xa9, 0xa9, 0xa9, 0x5c, 0x75, 0xd5,
-  0x55, 0x11, 0x35, 0xc6, 0x93, 0x93, 0x93, 0x49, 0x4b, 0x4b, 0x8b, 0xaa,
-  0x79, 0xbb, 0x74, 0x55, 0x35, 0x7b, 0x96, 0x55, 0x42, 0xae, 0x45, 0x6a,
-  0x04, 0x04, 0x6c, 0xf9, 0x0f, 0xc4, 0x19, 0xb9, 0xe7, 0xd1, 0x63, 0x3b,
-  0xe2, 0xf6, 0xcc, 0x33, 0xcf, 0x44, 0x75, 0x33, 0x19, 0x8d, 0x46, 0x8a,
-  0x8a, 0x8a, 0xa2, 0xee, 0x7b, 0xad, 0xfd, 0xaa, 0x8e, 0x2f, 0xde, 0xdb,
-  0x0f, 0xf9, 0xb1, 0x95, 0x71, 0x53, 0x6d, 0xf3, 0x40, 0x82, 0x89, 0x3b,
-  0x2e, 0xef, 0x1b, 0x8c, 0xdb, 0x1f, 0x3e, 0x12, 0x18, 0x17, 0x2e, 0xdf,
-  0x37, 0x5c, 0x04, 0x80, 0xc9, 0xd7, 0x30, 0x01, 0x75, 0xff, 0xeb, 0x14,
-  0x85, 0xeb, 0x2e, 0xea, 0x05, 0x2d, 0x8e, 0x23, 0xdb, 0x85, 0x04, 0x03,
-  0xee, 0x32, 0x2b, 0x9f, 0xac, 0xe9, 0xb8, 0x00, 0xb8, 0xf2, 0xca, 0x2b,
-  0x31, 0x18, 0x22, 0x6b, 0xef, 0x59, 0xa7, 0xd3, 0x45, 0x5d, 0x24, 0x36,
-  0xc0, 0x83, 0x0b, 0x77, 0x82, 0xc9, 0x80, 0x22, 0x45, 0x02, 0x02, 0xb2,
-  0xfa, 0x57, 0xba, 0xc4, 0xd1, 0xf4, 0xf5, 0x21, 0x9e, 0x39, 0x86, 0xd5,
-  0xff, 0xdc, 0xb9, 0x73, 0x19, 0x3a, 0x74, 0x68, 0xd4, 0x37, 0xd7, 0xf0,
-  0xe1, 0xc3, 0xa3, 0xf2, 0x7b, 0xdd, 0xfd, 0xc8, 0x56, 0x50, 0x88, 0x2d,
-  0xcf, 0x9a, 0x4e, 0x81, 0x9a, 0x16, 0xe6, 0x2d, 0xe8, 0x4e, 0x51, 0x7e,
-  0x50, 0x72, 0xd1, 0x99, 0x80, 0xb0, 0x89, 0x18, 0x0f, 0x97, 0x9e, 0xbd,
-  0x36, 0x18, 0xab, 0xff, 0x33, 0x4f, 0x2d, 0x24, 0x63, 0x68, 0x16, 0xd4,
-  0xb4, 0x1d, 0xb9, 0xf0, 0x71, 0xaa, 0x99, 0xf5, 0x5f, 0xd5, 0x51, 0xdf,
-  0xd4, 0xf1, 0xc8, 0xf8, 0x48, 0xda, 0xfb, 0xff, 0x3e, 0xd1, 0x28, 0x00,
-  0x9e, 0x7f, 0x63, 0x2f, 0xb6, 0xed, 0xf5, 0x90, 0x66, 0x42, 0x38, 0xd6,
-  0xc5, 0xbf, 0x0a, 0x89, 0x71, 0xfc, 0xdf, 0xb3, 0x3b, 0xf0, 0xf8, 0xb9,
-  0xfa, 0x53, 0x14, 0x25, 0x2a, 0xaa, 0xfc, 0xb5, 0x87, 0x68, 0xca, 0x6a,
-  0xf8, 0x7d, 0xde, 0xfd, 0xa4, 0x82, 0x7d, 0x9f, 0x56, 0x41, 0x76, 0x8c,
-  0x79, 0xd6, 0xac, 0x2e, 0xc8, 0x4e, 0xe4, 0xba, 0x0b, 0x82, 0x52, 0x2e,
-  0xbd, 0x18, 0x98, 0x28, 0x02, 0xe0, 0x87, 0x9c, 0x45, 0x10, 0x82, 0xff,
-  0x7e, 0x77, 0x71, 0x2f, 0xf0, 0x78, 0x8e, 0x18, 0xa4, 0xa3, 0x28, 0x80,
-  0x41, 0xcf, 0xd2, 0xcf, 0x3a, 0xbe, 0xfa, 0x5f, 0xb0, 0x60, 0x41, 0xc4,
-  0xd5, 0xff, 0x3e, 0x4c, 0xaf, 0x5e, 0xbd, 0xa2, 0x6e, 0xce, 0xda, 0x5a,
-  0xdc, 0xbc, 0xb8, 0xa8, 0x0c, 0x52, 0xe3, 0xe5, 0x48, 0xe0, 0xb1, 0x92,
-  0x6c, 0xc2, 0xb3, 0xaf, 0x89, 0x47, 0x5f, 0xd8, 0xed, 0xf7, 0x2d, 0x6e,
-  0xba, 0xe9, 0x26, 0x72, 0x72, 0x72, 0x62, 0xa2, 0xb9, 0xa6, 0x4c, 0x99,
-  0x12, 0xb5, 0xdf, 0xed, 0x1f, 0x0b, 0x77, 0x42, 0x9c, 0x21, 0xa6, 0xf2,
-  0x02, 0xa8, 0x8a, 0x02, 0x4d, 0x6d, 0x5c, 0x7a, 0x5e, 0x4f, 0x2c, 0xf1,
-  0x41, 0x89, 0x81, 0x30, 0x03, 0x7d, 0x44, 0x00, 0x68, 0xe4, 0x03, 0x09,
-  0x01, 0x57, 0xe5, 0x83, 0xd2, 0x19, 0x3c, 0x25, 0x1f, 0x2a, 0x5b, 0x39,
-  0xa2, 0x5f, 0x58, 0xa7, 0x03, 0x9b, 0x83, 0x15, 0x6b, 0x6b, 0x3b, 0x7c,
-  0xff, 0x2b, 0xaf, 0xbc, 0x32, 0x62, 0x07, 0x78, 0xb8, 0xd7, 0x2a, 0xf0,
-  0x97, 0xa7, 0x5e, 0x2d, 0x85, 0x56, 0x27, 0x8a, 0x29, 0x86, 0x02, 0x97,
-  0x02, 0x8d, 0x57, 0x85, 0x4c, 0x0b, 0xaf, 0xbf, 0x55, 0x4e, 0x6d, 0x9d,
-  0xc3, 0xbf, 0xb7, 0x9b, 0xd9, 0xcc, 0x5d, 0x77, 0xdd, 0x15, 0x33, 0x4d,
-  0x96, 0x95, 0x95, 0xc5, 0xe8, 0xd1, 0xa3, 0xa3, 0xf2, 0xbb, 0x3d, 0xfd,
-  0xdf, 0x32, 0xda, 0x76, 0x36, 0xc4, 0x96, 0x67, 0x4d, 0x01, 0xea, 0x1c,
-  0x58, 0xfa, 0xa4, 0x73, 0xf1, 0xfc, 0xee, 0xc1, 0x78, 0x82, 0x09, 0x08,
-  0x8b, 0xe0, 0x98, 0x70, 0x10, 0x00, 0xcf, 0x10, 0x04, 0xf7, 0xff, 0x0d,
-  0x17, 0xf5, 0x06, 0x8b, 0x09, 0xd5, 0xe9, 0x39, 0xf2, 0x7f, 0x4a, 0x32,
-  0xd0, 0x5c, 0x6a, 0x65, 0xfd, 0xa6, 0xba, 0x0e, 0xdd, 0xbb, 0xb0, 0xb0,
-  0x90, 0x09, 0x13, 0x26, 0x44, 0xec, 0xf8, 0x1e, 0x33, 0x66, 0x4c, 0x54,
-  0xce, 0xdb, 0x0d, 0x5b, 0x1a, 0xd8, 0xf1, 0x69, 0x15, 0x64, 0xc5, 0x8b,
-  0x21, 0xf7, 0xf7, 0xdd, 0x67, 0xd2, 0x83, 0xdd, 0xc5, 0x83, 0xcf, 0xfa,
-  0x7f, 0xee, 0xff, 0xe6, 0x9b, 0x6f, 0x26, 0x3e, 0x3e, 0xb6, 0xfa, 0x60,
-  0xfe, 0xfc, 0xf9, 0x51, 0xf9, 0xbd, 0xac, 0x36, 0x17, 0xaf, 0xbc, 0xb1,
-  0x17, 0xd2, 0x62, 0x2c, 0x31, 0x10, 0x80, 0xc3, 0xc9, 0x0d, 0x17, 0xf6,
-  0x0e, 0xc6, 0xed, 0x8b, 0x81, 0xf4, 0x60, 0xd8, 0xbd, 0x48, 0x14, 0x00,
-  0x05, 0x04, 0xd8, 0xfd, 0x9f, 0x9e, 0x6a, 0xe2, 0x8c, 0xd3, 0xba, 0x41,
-  0x5d, 0x1b, 0xbf, 0x18, 0x15, 0x96, 0x6c, 0x62, 0xdd, 0xd7, 0x75, 0x1d,
-  0xce, 0x70, 0x76, 0xce, 0x39, 0xe7, 0x44, 0xf4, 0xe0, 0x2e, 0x29, 0x29,
-  0xa1, 0x7b, 0xf7, 0xee, 0x51, 0x39, 0x71, 0x5f, 0x7c, 0x77, 0xbf, 0x16,
-  0x0c, 0x28, 0xbb, 0x00, 0xfe, 0xbd, 0xf5, 0xb2, 0xe2, 0xd8, 0xb3, 0xba,
-  0x9a, 0xcf, 0x37, 0xd6, 0xf9, 0x75, 0x8b, 0x84, 0x84, 0x04, 0x7e, 0xf7,
-  0xbb, 0xdf, 0xc5, 0x5c, 0xd3, 0xcd, 0x9b, 0x37, 0x2f, 0xaa, 0x12, 0x02,
-  0x7d, 0x9f, 0xc7, 0x5e, 0xdc, 0x0d, 0xad, 0x8e, 0xd8, 0x3a, 0x12, 0xa8,
-  0x00, 0x55, 0x6d, 0x14, 0x8d, 0xcb, 0xe6, 0x94, 0x49, 0xb9, 0xc1, 0xf2,
-  0x02, 0x9c, 0x15, 0xeb, 0x02, 0x60, 0x30, 0x10, 0xf0, 0xa5, 0xc2, 0xc5,
-  0xf3, 0xbb, 0xa3, 0x2f, 0x4a, 0x46, 0xfd, 0xa5, 0xc0, 0x3e, 0x15, 0xd0,
-  0xeb, 0x59, 0xb9, 0xee, 0x50, 0x87, 0xef, 0xbf, 0x60, 0xc1, 0x82, 0x88,
-  0x1f, 0xdf, 0xa7, 0x9e, 0x7a, 0x6a, 0x54, 0xce, 0xdb, 0xff, 0xbc, 0xb5,
-  0x17, 0x2a, 0x6c, 0x60, 0x91, 0xcc, 0x80, 0xfe, 0xbc, 0xf3, 0x30, 0x1b,
-  0x59, 0xf8, 0x66, 0xb9, 0xdf, 0xf7, 0xb8, 0xfc, 0xf2, 0xcb, 0xa3, 0xf2,
-  0x5c, 0xfc, 0xd1, 0xc8, 0xcf, 0xcf, 0x67, 0xce, 0x9c, 0x39, 0x51, 0xf9,
-  0xdd, 0xbe, 0xfc, 0xa6, 0x81, 0x6d, 0x2b, 0x7d, 0x9e, 0xb5, 0x58, 0x2a,
-  0x12, 0xe4, 0x51, 0x41, 0xaf, 0xe3, 0x77, 0xc1, 0xf3, 0x02, 0x74, 0x7a,
-  0x82, 0x8c, 0xce, 0x16, 0x00, 0xff, 0x0c, 0xc6, 0x4d, 0xaf, 0x38, 0xab,
-  0x07, 0xd8, 0x7f, 0x39, 0xaa, 0x5f, 0x31, 0x2a, 0x60, 0x77, 0xb1, 0xb6,
-  0x83, 0xee, 0xff, 0x3e, 0x7d, 0xfa, 0x44, 0x44, 0xd1, 0x9f, 0xa3, 0x71,
-  0xde, 0x79, 0xe7, 0x45, 0xe5, 0xa4, 0x2d, 0xdd, 0xd7, 0xc2, 0x67, 0xab,
-  0xaa, 0xa0, 0x4b, 0x1c, 0x42, 0x07, 0xb1, 0xe8, 0xa1, 0xba, 0x85, 0x57,
-  0xde, 0xd9, 0xe7, 0xf7, 0x2d, 0xae, 0xbb, 0xee, 0xba, 0x98, 0x6d, 0xbe,
-  0x68, 0x2b, 0x73, 0xfc, 0x7d, 0x9e, 0x7b, 0x6b, 0xaf, 0xe6, 0x59, 0x8b,
-  0x35, 0x45, 0x5c, 0xd5, 0xc2, 0x09, 0xa7, 0x74, 0xa5, 0x5b, 0x41, 0x42,
-  0x30, 0x9e, 0x90, 0x08, 0x74, 0x6a, 0x52, 0x96, 0xce, 0x14, 0x00, 0x06,
-  0xb4, 0x7d, 0x90, 0x80, 0xba, 0xff, 0xa7, 0x8c, 0xcd, 0xa6, 0x78, 0x4c,
-  0xf6, 0x2f, 0x1f, 0xfd, 0x03, 0xb0, 0x18, 0x70, 0xec, 0xb5, 0xb2, 0x76,
-  0x43, 0xc7, 0x04, 0xc0, 0x8c, 0x19, 0x33, 0xa2, 0x62, 0x6c, 0x0f, 0x1d,
-  0x3a, 0x94, 0x11, 0x23, 0x46, 0x44, 0xe5, 0xbc, 0x7d, 0xe3, 0xa3, 0x0a,
-  0xd0, 0xeb, 0x25, 0x29, 0x50, 0x47, 0xe9, 0x12, 0xc7, 0x9a, 0x4f, 0xab,
-  0xd8, 0xbd, 0xd7, 0xea, 0xd7, 0xe5, 0xd3, 0xa7, 0x4f, 0xa7, 0xa0, 0xa0,
-  0x20, 0x66, 0x9b, 0x6f, 0xd4, 0xa8, 0x51, 0x51, 0x1b, 0x5f, 0xf3, 0xe2,
-  0x9b, 0xe5, 0x78, 0xf7, 0x5b, 0x21, 0x31, 0xb6, 0x3c, 0x6b, 0x6a, 0x8b,
-  0x1b, 0x32, 0x2c, 0x5c, 0x79, 0x4e, 0x49, 0x30, 0x6e, 0x6f, 0x02, 0xfe,
-  0x16, 0xab, 0x02, 0x60, 0x2a, 0x41, 0x08, 0x82, 0xb8, 0xfc, 0xcc, 0x1e,
-  0x60, 0x32, 0xa0, 0xba, 0x8f, 0xf2, 0xf6, 0x4f, 0x32, 0xf1, 0xf5, 0x8e,
-  0x26, 0x9a, 0x8e, 0x54, 0x1f, 0xe0, 0x08, 0x9c, 0x74, 0xd2, 0x49, 0x51,
-  0x33, 0xb8, 0xef, 0xbf, 0xff, 0xfe, 0xa8, 0x9c, 0xb4, 0x6f, 0x7f, 0x7c,
-  0x10, 0x0e, 0xb5, 0xa2, 0xc4, 0xc9, 0x69, 0x80, 0xf6, 0xbf, 0xe9, 0x54,
-  0xd0, 0x1b, 0x58, 0xbc, 0xac, 0xc2, 0xef, 0x5b, 0x5c, 0x7d, 0xf5, 0xd5,
-  0x31, 0xdf, 0x8c, 0xd1, 0x9a, 0xfb, 0xe0, 0x60, 0x55, 0x1b, 0x2b, 0x57,
-  0x54, 0x42, 0x56, 0x5c, 0x6c, 0x09, 0x6b, 0x9d, 0x02, 0x36, 0x3b, 0x17,
-  0x9c, 0xd1, 0x2d, 0x18, 0x31, 0x1e, 0xc5, 0xc0, 0xb0, 0x58, 0x15, 0x00,
-  0x77, 0x07, 0x7a, 0xf5, 0x9f, 0x96, 0x62, 0x62, 0xce, 0xac, 0x42, 0xa8,
-  0x6b, 0xe5, 0xa8, 0xbe, 0x2a, 0x93, 0x81, 0x2f, 0x36, 0xd7, 0x77, 0xe8,
-  0xfe, 0x49, 0x49, 0x49, 0x4c, 0x9c, 0x38, 0x31, 0x6a, 0xc6, 0xf6, 0xe4,
-  0xc9, 0x93, 0xa3, 0xea, 0xfb, 0x1c, 0x66, 0x47, 0xa9, 0x95, 0x2d, 0xeb,
-  0x6a, 0x21, 0x53, 0xb6, 0x01, 0xda, 0x8b, 0x12, 0x67, 0x80, 0xfa, 0x36,
-  0x16, 0x7f, 0x74, 0xd0, 0xaf, 0xeb, 0xbb, 0x76, 0xed, 0x1a, 0x35, 0xde,
-  0xb1, 0x63, 0x61, 0xe8, 0xd0, 0xa1, 0x11, 0x97, 0x1e, 0xbc, 0xbd, 0xbc,
-  0xba, 0xe4, 0x00, 0xa0, 0x8b, 0xbd, 0x6c, 0x9b, 0x75, 0x76, 0xb2, 0x86,
-  0x77, 0x61, 0xee, 0x29, 0x41, 0xf1, 0x6e, 0xc5, 0xa3, 0x05, 0xc2, 0xc7,
-  0x94, 0x00, 0x30, 0xa0, 0xa5, 0xfe, 0x0d, 0x28, 0x67, 0xcd, 0x2a, 0x44,
-  0x57, 0x94, 0x0c, 0xcd, 0xbf, 0xbc, 0xaa, 0x57, 0x74, 0x0a, 0xb8, 0xdc,
-  0xac, 0xfd, 0xaa, 0x63, 0x02, 0x60, 0xec, 0xd8, 0xb1, 0x98, 0xcd, 0xe6,
-  0xa8, 0x1a, 0xdb, 0xd1, 0x5a, 0xa6, 0xf5, 0xbd, 0x4f, 0xab, 0x40, 0x4a,
-  0x04, 0x77, 0x40, 0x3d, 0x9b, 0xd9, 0xb3, 0xb1, 0x8e, 0xad, 0xbb, 0x9a,
-  0xfd, 0xba, 0x3c, 0xd2, 0x4f, 0xc6, 0x04, 0x92, 0x87, 0x1f, 0x7e, 0x98,
-  0xae, 0x5d, 0xbb, 0x86, 0xe5, 0x67, 0xfb, 0xf5, 0xaf, 0x7f, 0xcd, 0xe9,
-  0xa7, 0x9f, 0xee, 0xd7, 0xb5, 0x6f, 0x7d, 0x78, 0x00, 0x0e, 0xc6, 0x5e,
-  0x80, 0xad, 0xea, 0x01, 0x14, 0x85, 0xcb, 0x82, 0x97, 0x13, 0xe0, 0xbe,
-  0x58, 0x13, 0x00, 0x27, 0x10, 0x04, 0xf7, 0xff, 0xaf, 0x66, 0x77, 0xf3,
-  0x65, 0xfe, 0x3b, 0x9a, 0xfc, 0x50, 0xa0, 0xd1, 0xc9, 0xd7, 0xdb, 0x1b,
-  0x3b, 0x74, 0xff, 0xf1, 0xe3, 0xc7, 0x47, 0xdd, 0xe0, 0x2e, 0x2c, 0x2c,
-  0xe4, 0xd5, 0x57, 0x5f, 0x0d, 0xcb, 0xcf, 0xd6, 0xb3, 0xa7, 0xff, 0x95,
-  0x33, 0x3f, 0x5a, 0x5d, 0x05, 0x2d, 0x0e, 0x14, 0xbd, 0x54, 0x08, 0x3c,
-  0xea, 0xea, 0x1f, 0x20, 0xde, 0xc8, 0xfb, 0xab, 0xaa, 0xfc, 0xbe, 0xc7,
-  0xf9, 0xe7, 0x9f, 0x2f, 0x0d, 0x79, 0xf8, 0xa5, 0xaa, 0xd3, 0xb1, 0x64,
-  0xc9, 0x92, 0xb0, 0x3b, 0x16, 0x38, 0x68, 0xd0, 0x20, 0x9e, 0x7c, 0xf2,
-  0x49, 0xfe, 0xfd, 0xef, 0x7f, 0xfb, 0x75, 0x7d, 0x65, 0xad, 0x9d, 0xcf,
-  0xd7, 0xd4, 0xc4, 0x9e, 0x67, 0x4d, 0x01, 0xaa, 0x5b, 0x99, 0x32, 0x35,
-  0x9f, 0xfc, 0xec, 0x80, 0x1f, 0x5a, 0x2b, 0x06, 0x06, 0xc6, 0x9a, 0x00,
-  0xb8, 0x97, 0x00, 0xbb, 0xff, 0x7b, 0x15, 0x27, 0x31, 0x62, 0x7c, 0xce,
-  0xd1, 0x83, 0xff, 0x00, 0x12, 0x8c, 0x34, 0xec, 0xb7, 0x75, 0x38, 0xd8,
-  0x69, 0xd4, 0xa8, 0x51, 0x51, 0x39, 0xbe, 0xe7, 0xcf, 0x9f, 0xcf, 0x3d,
-  0xf7, 0xdc, 0x13, 0x56, 0x9f, 0xe9, 0xa1, 0x87, 0x1e, 0x62, 0xed, 0xda,
-  0xb5, 0x7e, 0x5f, 0xbf, 0x66, 0x43, 0x1d, 0xd6, 0x52, 0x2b, 0x24, 0x89,
-  0x17, 0xe0, 0xe8, 0x6f, 0x01, 0x05, 0x9c, 0x6e, 0x56, 0xac, 0xab, 0xf5,
-  0xeb, 0xf2, 0x01, 0x03, 0x06, 0xd0, 0xb7, 0x6f, 0x5f, 0x69, 0xc7, 0xef,
-  0xd1, 0xaf, 0x5f, 0x3f, 0xde, 0x7f, 0xff, 0xfd, 0xb0, 0xf9, 0x3c, 0x25,
-  0x25, 0x25, 0x7c, 0xf2, 0xc9, 0x27, 0x00, 0xa4, 0xa7, 0xa7, 0x33, 0x6f,
-  0xde, 0x3c, 0xbf, 0xee, 0xf3, 0xee, 0xca, 0x4a, 0xd0, 0xeb, 0x88, 0xb5,
-  0x5d, 0x00, 0xb5, 0xc5, 0x0d, 0xb9, 0x89, 0x9c, 0x37, 0xbb, 0x5b, 0x30,
-  0x6e, 0x1f, 0x07, 0xe4, 0xc5, 0x8a, 0x00, 0x30, 0x12, 0x0c, 0xf7, 0xff,
-  0x69, 0x45, 0xd0, 0xc5, 0x02, 0x76, 0xcf, 0xd1, 0xff, 0x73, 0x82, 0x81,
-  0x6d, 0x65, 0xd6, 0x0e, 0x25, 0x00, 0x4a, 0x4c, 0x4c, 0x64, 0xd8, 0xb0,
-  0x61, 0x51, 0x3b, 0xc0, 0x6f, 0xbf, 0xfd, 0xf6, 0xb0, 0x49, 0xdf, 0xfa,
-  0xab, 0x5f, 0xfd, 0x8a, 0xeb, 0xae, 0xbb, 0x8e, 0xb4, 0xb4, 0x34, 0x2e,
-  0xba, 0xe8, 0x22, 0xbf, 0xee, 0x61, 0x6d, 0x71, 0xb3, 0xea, 0xcb, 0x43,
-  0x90, 0x22, 0xc5, 0x81, 0x8e, 0x8a, 0xc5, 0x80, 0xfb, 0x40, 0x0b, 0x9f,
-  0x7d, 0x79, 0xc8, 0xaf, 0xcb, 0xa3, 0xf5, 0xfc, 0xfb, 0xb1, 0x32, 0x6d,
-  0xda, 0x34, 0x5e, 0x7b, 0xed, 0xb5, 0x4e, 0xff, 0x1c, 0xc3, 0x86, 0x0d,
-  0x63, 0xfd, 0xfa, 0xf5, 0x3f, 0x28, 0x03, 0xfe, 0xd7, 0xbf, 0xfa, 0x57,
-  0x90, 0x6e, 0xc9, 0xf2, 0x2a, 0xa8, 0xb7, 0x43, 0x2c, 0xa6, 0xdb, 0x76,
-  0xba, 0x39, 0xff, 0xf4, 0xa0, 0x94, 0x7e, 0x36, 0x01, 0x7f, 0x89, 0x15,
-  0x01, 0x30, 0x81, 0x20, 0xb8, 0xff, 0xcf, 0x39, 0xa5, 0x2b, 0x38, 0xdd,
-  0xed, 0x0b, 0x50, 0x35, 0xea, 0x3a, 0xbc, 0xd7, 0xd9, 0xbf, 0x7f, 0x7f,
-  0x52, 0x52, 0x52, 0xa2, 0x7a, 0x7c, 0xdf, 0x7d, 0xf7, 0xdd, 0x9d, 0x5e,
-  0xbf, 0xfd, 0xfa, 0xeb, 0xaf, 0xe7, 0xd9, 0x67, 0x9f, 0xfd, 0xf6, 0xef,
-  0x77, 0xdc, 0x71, 0x87, 0xdf, 0xf7, 0xfa, 0x74, 0x7d, 0x2d, 0xe8, 0xe4,
-  0x38, 0xe0, 0x51, 0x49, 0x31, 0xf2, 0xd5, 0xe6, 0x7a, 0x2a, 0xaa, 0xdb,
-  0xfc, 0xba, 0x7c, 0xd6, 0xac, 0x59, 0xd2, 0x86, 0xbf, 0x20, 0x8e, 0x56,
-  0xac, 0x58, 0x41, 0x66, 0x66, 0x66, 0xa7, 0x3c, 0xff, 0xcc, 0x33, 0xcf,
-  0x64, 0xed, 0xda, 0xb5, 0xa4, 0xa6, 0xa6, 0xfe, 0xe0, 0xe7, 0xdd, 0xba,
-  0x75, 0x63, 0xf6, 0xec, 0xd9, 0x1d, 0xbe, 0xdf, 0xc6, 0x2d, 0x0d, 0x1c,
-  0xdc, 0xde, 0x08, 0x29, 0xc6, 0xd8, 0xea, 0x48, 0x05, 0xa8, 0x6d, 0xa3,
-  0xef, 0xa8, 0x2c, 0x86, 0x0d, 0x48, 0x0f, 0xf4, 0xdd, 0x8b, 0x81, 0x01,
-  0xb1, 0x22, 0x00, 0x02, 0xee, 0xfe, 0x1f, 0xd8, 0x3b, 0x85, 0x9e, 0xc7,
-  0x67, 0x41, 0xad, 0xbd, 0xdd, 0xbd, 0xb9, 0x65, 0x57, 0x53, 0xc7, 0x9e,
-  0x31, 0x70, 0x60, 0x4c, 0x8c, 0xf3, 0x0b, 0x2f, 0xbc, 0x90, 0xcd, 0x9b,
-  0x37, 0x87, 0xbc, 0xd6, 0x41, 0x6a, 0x6a, 0x2a, 0x2f, 0xbe, 0xf8, 0x22,
-  0x0f, 0x3e, 0xf8, 0xe0, 0x0f, 0x67, 0x46, 0x71, 0x31, 0xa7, 0x9d, 0x76,
-  0x9a, 0x5f, 0xf7, 0x5c, 0xb7, 0xa9, 0x1e, 0x5a, 0x9c, 0x28, 0x26, 0x89,
-  0x03, 0x38, 0x22, 0x2a, 0x60, 0x32, 0xb0, 0xf6, 0xeb, 0x7a, 0xbf, 0x2e,
-  0x2f, 0x2a, 0x2a, 0x62, 0xf8, 0xf0, 0xe1, 0xd2, 0x8e, 0xbf, 0xb4, 0xe2,
-  0x99, 0x30, 0x81, 0x2d, 0x5b, 0xb6, 0x84, 0xb4, 0x5e, 0x40, 0x5c, 0x5c,
-  0x1c, 0x0f, 0x3f, 0xfc, 0x30, 0x2f, 0xbf, 0xfc, 0x32, 0x7a, 0xfd, 0xcf,
-  0xaf, 0xd6, 0xfd, 0x11, 0xd7, 0x1e, 0xaf, 0xca, 0xca, 0x2f, 0x0f, 0x41,
-  0xa2, 0x31, 0xe6, 0x84, 0xb5, 0xea, 0xf0, 0x42, 0x4a, 0x3c, 0xe7, 0x9c,
-  0x16, 0x14, 0x2f, 0x40, 0xa7, 0x9c, 0x06, 0x08, 0xf5, 0x9b, 0x51, 0x01,
-  0x52, 0x03, 0x7d, 0xd3, 0x79, 0xa7, 0x14, 0x42, 0x8a, 0x19, 0xd5, 0x71,
-  0x74, 0xf7, 0xbf, 0x62, 0x50, 0xa0, 0xd5, 0xc5, 0xf6, 0x3d, 0x1d, 0xdb,
-  0xff, 0x8f, 0x15, 0x01, 0x00, 0xda, 0x9e, 0xee, 0x8a, 0x15, 0x2b, 0x78,
-  0xea, 0xa9, 0xa7, 0xe8, 0xd3, 0x27, 0xf8, 0x55, 0x2b, 0xaf, 0xbc, 0xf2,
-  0x4a, 0xb6, 0x6f, 0xdf, 0x7e, 0xc4, 0x48, 0xf2, 0xdf, 0xfc, 0xe6, 0x37,
-  0x7e, 0xdd, 0xf7, 0xcb, 0xcd, 0xf5, 0xb8, 0x0e, 0xd8, 0x40, 0xf2, 0x01,
-  0xfc, 0xf2, 0x1b, 0x40, 0x55, 0xf9, 0xc2, 0x4f, 0x01, 0x30, 0x75, 0xea,
-  0x54, 0x69, 0xc3, 0x76, 0x90, 0x95, 0x95, 0xc5, 0xab, 0xaf, 0xbe, 0xca,
-  0x6b, 0xaf, 0xbd, 0x16, 0xf4, 0x64, 0x41, 0x73, 0xe7, 0xce, 0x65, 0xf3,
-  0xe6, 0xcd, 0x5c, 0x73, 0xcd, 0x2f, 0x67, 0x9a, 0x1d, 0x3a, 0x74, 0x28,
-  0x03, 0x06, 0x74, 0x7c, 0xe1, 0xf9, 0xc9, 0x67, 0xd5, 0xda, 0xab, 0x3c,
-  0xd6, 0x02, 0x01, 0x14, 0xa0, 0xcd, 0xc1, 0xec, 0x13, 0x83, 0xb2, 0x5d,
-  0x6f, 0x02, 0x6e, 0x8d, 0x76, 0x01, 0x30, 0x90, 0x20, 0xb8, 0xff, 0xe7,
-  0x4e, 0xcf, 0x07, 0x87, 0xab, 0x7d, 0x03, 0xd2, 0xa4, 0x87, 0x43, 0x76,
-  0x76, 0x95, 0x75, 0x4c, 0x00, 0xf4, 0xee, 0xdd, 0x9b, 0x58, 0xe3, 0x92,
-  0x4b, 0x2e, 0x61, 0xdb, 0xb6, 0x6d, 0xbc, 0xf4, 0xd2, 0x4b, 0x01, 0xaf,
-  0x79, 0xde, 0xb5, 0x6b, 0x57, 0xae, 0xbf, 0xfe, 0x7a, 0xb6, 0x6d, 0xdb,
-  0xc6, 0x63, 0x8f, 0x3d, 0x46, 0x76, 0x76, 0xf6, 0x11, 0xff, 0xef, 0xa4,
-  0x49, 0x93, 0xfc, 0xca, 0x30, 0xd7, 0xd8, 0xec, 0x62, 0xf3, 0xce, 0x66,
-  0x48, 0x32, 0x22, 0x1c, 0xe1, 0x9d, 0x66, 0xd6, 0x43, 0x6d, 0x1b, 0x1b,
-  0xbe, 0x69, 0xf0, 0xeb, 0xfa, 0xc9, 0x93, 0x27, 0x4b, 0x23, 0x76, 0x80,
-  0x39, 0x73, 0xe6, 0xb0, 0x7a, 0xf5, 0x6a, 0xde, 0x7d, 0xf7, 0x5d, 0xe6,
-  0xcf, 0x9f, 0x4f, 0x52, 0x52, 0x52, 0x40, 0xee, 0x9b, 0x9c, 0x9c, 0xcc,
-  0x25, 0x97, 0x5c, 0xc2, 0x9a, 0x35, 0x6b, 0x58, 0xb4, 0x68, 0x11, 0x25,
-  0x25, 0xed, 0xcb, 0x5c, 0x77, 0xe9, 0xa5, 0x97, 0x76, 0xf8, 0x59, 0x6b,
-  0x36, 0xd4, 0x41, 0x6d, 0x5b, 0x6c, 0x26, 0xda, 0xaa, 0x73, 0xd0, 0x6d,
-  0x44, 0x17, 0x8e, 0x3f, 0x2e, 0x28, 0xdb, 0x00, 0x23, 0x3b, 0x43, 0xd3,
-  0x84, 0x92, 0xb7, 0x81, 0xfe, 0x04, 0x70, 0x0b, 0x60, 0x70, 0xbf, 0x54,
-  0x36, 0x7e, 0x3a, 0x0b, 0xec, 0x9e, 0xf6, 0x79, 0x00, 0xd2, 0xcd, 0xd4,
-  0xee, 0x6c, 0x22, 0x77, 0xf4, 0x62, 0x3c, 0x9e, 0xf6, 0xfb, 0xb0, 0x76,
-  0xef, 0xde, 0x4d, 0x8f, 0x1e, 0x3d, 0x62, 0xfa, 0xe5, 0xb5, 0x75, 0xeb,
-  0x56, 0xde, 0x79, 0xe7, 0x1d, 0x96, 0x2f, 0x5f, 0xce, 0xa7, 0x9f, 0x7e,
-  0x8a, 0xcd, 0x66, 0x6b, 0xf7, 0xb5, 0x46, 0xa3, 0x91, 0xe2, 0xe2, 0x62,
-  0x26, 0x4e, 0x9c, 0xc8, 0x29, 0xa7, 0x9c, 0xc2, 0x49, 0x27, 0x9d, 0x84,
-  0xc5, 0x62, 0x69, 0xf7, 0xf5, 0x37, 0xdc, 0x70, 0xc3, 0x4f, 0xb6, 0x07,
-  0xda, 0xc3, 0x33, 0x7f, 0x1b, 0xc9, 0x85, 0x37, 0x0e, 0x42, 0x2d, 0x6b,
-  0x42, 0xf8, 0x99, 0xf9, 0x90, 0x6a, 0xa2, 0xa9, 0xdc, 0x46, 0xf6, 0xc8,
-  0xb7, 0x70, 0x38, 0xbd, 0x1d, 0xbe, 0xbe, 0xbc, 0xbc, 0x9c, 0xc2, 0xc2,
-  0x42, 0x69, 0x48, 0x3f, 0xa9, 0xa8, 0xa8, 0x60, 0xcd, 0x9a, 0x35, 0x2c,
-  0x5b, 0xb6, 0x8c, 0x5d, 0xbb, 0x76, 0xf1, 0xf5, 0xd7, 0x5f, 0x53, 0x57,
-  0x57, 0x87, 0xdb, 0xed, 0x46, 0x51, 0x14, 0xd4, 0x23, 0x9c, 0x69, 0xb6,
-  0x58, 0x2c, 0x14, 0x16, 0x16, 0x32, 0x7a, 0xf4, 0x68, 0x4e, 0x3c, 0xf1,
-  0x44, 0x26, 0x4f, 0x9e, 0x4c, 0x4e, 0x4e, 0x4e, 0x87, 0x9f, 0x5f, 0x59,
-  0x59, 0x49, 0x41, 0x41, 0x01, 0x5e, 0x6f, 0xfb, 0xfb, 0x5e, 0xa7, 0x28,
-  0x1c, 0x58, 0x3d, 0x8b, 0xdc, 0x01, 0xa9, 0xa8, 0x87, 0x1c, 0xb1, 0xd5,
-  0x61, 0xaa, 0x8a, 0xd2, 0x3d, 0x95, 0xbf, 0xdd, 0xba, 0x96, 0x9b, 0xee,
-  0xdf, 0x14, 0xe8, 0xbb, 0xef, 0x00, 0x46, 0x00, 0xd6, 0x50, 0x7d, 0x9d,
-  0x50, 0x9f, 0x91, 0x0a, 0x78, 0xe9, 0xdf, 0x39, 0xd3, 0x0b, 0x20, 0xdd,
-  0x02, 0x65, 0xed, 0x3c, 0xd3, 0x1f, 0xaf, 0x67, 0xcf, 0xfe, 0x96, 0x0e,
-  0x19, 0xff, 0x8c, 0x8c, 0x0c, 0x8a, 0x8a, 0x8a, 0x88, 0x75, 0xfa, 0xf5,
-  0xeb, 0x47, 0xbf, 0x7e, 0xfd, 0xb8, 0xe9, 0xa6, 0x9b, 0x68, 0x6c, 0x6c,
-  0xe4, 0xeb, 0xaf, 0xbf, 0x66, 0xeb, 0xd6, 0xad, 0xec, 0xd8, 0xb1, 0x83,
-  0x1d, 0x3b, 0x76, 0xd0, 0xd8, 0xf8, 0x5d, 0x1f, 0x64, 0x67, 0x67, 0x53,
-  0x50, 0x50, 0x40, 0x49, 0x49, 0x09, 0xdd, 0xba, 0x75, 0x63, 0xf8, 0xf0,
-  0xe1, 0xe4, 0xe7, 0xe7, 0xfb, 0xef, 0xe5, 0x99, 0x3b, 0xd7, 0x2f, 0x01,
-  0xf0, 0xcd, 0x8e, 0x46, 0xf0, 0x78, 0x50, 0x14, 0x8e, 0x9e, 0x1f, 0x22,
-  0x16, 0x49, 0x30, 0xb2, 0x65, 0x4f, 0xb3, 0x5f, 0xc6, 0xbf, 0x67, 0xcf,
-  0x9e, 0x62, 0xfc, 0x8f, 0x91, 0xbc, 0xbc, 0x3c, 0xce, 0x38, 0xe3, 0x0c,
-  0xce, 0x38, 0xe3, 0x0c, 0x00, 0x1c, 0x0e, 0x07, 0xb5, 0xb5, 0xb5, 0xb4,
-  0xb6, 0xb6, 0x62, 0x32, 0x99, 0x68, 0x6d, 0x6d, 0xa5, 0xbe, 0xbe, 0x1e,
-  0x9d, 0x4e, 0x73, 0xd6, 0xba, 0xdd, 0x6e, 0x2c, 0x16, 0x0b, 0xdd, 0xbb,
-  0x77, 0x27, 0x3d, 0xfd, 0xd8, 0x57, 0xa1, 0xb9, 0xb9, 0xb9, 0x8c, 0x19,
-  0x33, 0x86, 0x55, 0xab, 0x56, 0xb5, 0xfb, 0x1a, 0xaf, 0xaa, 0xb2, 0xfe,
-  0x9b, 0x06, 0x4e, 0x1d, 0x9d, 0x0d, 0xb1, 0x26, 0x00, 0x14, 0x05, 0xda,
-  0x9c, 0xcc, 0x9d, 0x56, 0x10, 0x0c, 0x01, 0x60, 0x02, 0xce, 0x01, 0x1e,
-  0x8f, 0x46, 0x01, 0x90, 0x43, 0x10, 0x4a, 0xff, 0xce, 0x3a, 0x21, 0x0f,
-  0x5c, 0xae, 0xf6, 0xc7, 0xa3, 0x98, 0x0c, 0xec, 0x3d, 0xd8, 0xd2, 0xa1,
-  0x67, 0x14, 0x16, 0x16, 0x62, 0x30, 0xc8, 0x79, 0xf2, 0xef, 0x93, 0x9a,
-  0x9a, 0xca, 0x84, 0x09, 0x13, 0x42, 0x16, 0x2c, 0x38, 0x72, 0xe4, 0x48,
-  0x72, 0x73, 0x73, 0xa9, 0xac, 0xac, 0xec, 0xd0, 0x75, 0x5b, 0x76, 0x36,
-  0x81, 0xdd, 0xad, 0x9d, 0x75, 0xf7, 0x88, 0x02, 0xf8, 0xb9, 0xf9, 0xb0,
-  0x6b, 0xaf, 0xcd, 0xef, 0x3e, 0x11, 0x02, 0x8b, 0xd9, 0x6c, 0x0e, 0x79,
-  0x41, 0xa5, 0x53, 0x4e, 0x39, 0xa5, 0x43, 0x02, 0x00, 0xe0, 0x8b, 0xcd,
-  0xf5, 0x9c, 0xea, 0xb3, 0x87, 0x31, 0x27, 0xac, 0xeb, 0x1c, 0x14, 0x0f,
-  0xc9, 0x60, 0xf8, 0xc0, 0xf4, 0x0e, 0xa7, 0x93, 0x3f, 0x0a, 0xc5, 0xc0,
-  0x85, 0xa1, 0x14, 0x00, 0xa1, 0x8c, 0x01, 0x38, 0x8b, 0x00, 0xef, 0xff,
-  0x77, 0x2f, 0x4c, 0x64, 0xf0, 0xc8, 0x2e, 0x70, 0xa8, 0x7d, 0xd1, 0xff,
-  0x87, 0x13, 0x73, 0xed, 0x29, 0xef, 0xd8, 0x0b, 0x2f, 0x5c, 0xd3, 0x7a,
-  0xc6, 0x12, 0x3a, 0x9d, 0x8e, 0x13, 0x4e, 0x38, 0xa1, 0xc3, 0xd7, 0xed,
-  0xdd, 0xdf, 0x02, 0xf5, 0x8e, 0xd8, 0x3c, 0xb7, 0x7c, 0xd4, 0xf9, 0xa0,
-  0x80, 0xea, 0x65, 0x77, 0xb9, 0x7f, 0x02, 0x20, 0x9a, 0xf3, 0x62, 0xc4,
-  0x12, 0xfe, 0x88, 0xf8, 0x4d, 0xdb, 0x1a, 0xa0, 0xcd, 0xa5, 0x09, 0xeb,
-  0x58, 0xc3, 0xe5, 0x85, 0x94, 0x38, 0x4e, 0x9d, 0x1a, 0x94, 0x60, 0xc0,
-  0x14, 0x82, 0x10, 0x27, 0x17, 0x0e, 0x02, 0xe0, 0x4c, 0x02, 0xec, 0xfe,
-  0x9f, 0x39, 0x39, 0x0f, 0xb2, 0x2c, 0xa8, 0xed, 0x49, 0xfe, 0x03, 0xdf,
-  0x66, 0x3c, 0x2b, 0xef, 0xa0, 0x07, 0xc0, 0x9f, 0xbd, 0x35, 0x21, 0xf0,
-  0x8c, 0x1d, 0x3b, 0xb6, 0xc3, 0xd7, 0xec, 0xab, 0x6c, 0xa5, 0xf2, 0x60,
-  0x6b, 0xcc, 0xe5, 0x2f, 0x6f, 0xf7, 0xec, 0x77, 0xb8, 0x29, 0xdb, 0xef,
-  0x9f, 0x00, 0xe8, 0xdf, 0xbf, 0xbf, 0xb4, 0x61, 0x14, 0x30, 0x74, 0xe8,
-  0x50, 0x12, 0x12, 0x3a, 0x56, 0xef, 0x7e, 0xdb, 0x1e, 0xab, 0x76, 0xec,
-  0x3a, 0x06, 0x85, 0xb5, 0x0a, 0xe0, 0xf2, 0x30, 0x63, 0x62, 0x6e, 0x30,
-  0x6e, 0x6f, 0x22, 0x84, 0x15, 0x02, 0x43, 0x25, 0x00, 0xf4, 0x04, 0x21,
-  0xfb, 0xdf, 0xcc, 0x49, 0xb9, 0x5a, 0x77, 0xb4, 0xd7, 0x05, 0xa5, 0x00,
-  0x0e, 0x6f, 0x87, 0x05, 0x40, 0x6e, 0x6e, 0xae, 0xbc, 0x25, 0xc2, 0x00,
-  0x7f, 0x56, 0x9c, 0x6d, 0x76, 0x0f, 0x07, 0xaa, 0xdb, 0xe4, 0x28, 0xe0,
-  0xcf, 0xbb, 0x00, 0xc0, 0xe1, 0x65, 0xdf, 0xc1, 0xd6, 0x8e, 0xbf, 0x38,
-  0x74, 0x3a, 0x7a, 0xf5, 0xea, 0x25, 0x6d, 0x18, 0x05, 0xc4, 0xc7, 0xc7,
-  0x33, 0x78, 0xf0, 0xe0, 0x0e, 0x5d, 0x53, 0xb6, 0xcf, 0xc6, 0xbe, 0x72,
-  0x9b, 0x96, 0x0f, 0x20, 0x16, 0xa9, 0xb7, 0x33, 0x74, 0x68, 0x26, 0x05,
-  0x39, 0xf1, 0xc1, 0xb8, 0xfb, 0xef, 0xa3, 0x4d, 0x00, 0x74, 0x0f, 0xb4,
-  0x5b, 0x23, 0x2d, 0xc5, 0xc8, 0xb8, 0xe3, 0xbb, 0x40, 0x9d, 0xa3, 0xfd,
-  0x67, 0x19, 0x0c, 0x3a, 0xb0, 0xba, 0xa8, 0xa8, 0xb6, 0x77, 0xe8, 0x59,
-  0x59, 0x59, 0x59, 0xf2, 0x96, 0x08, 0x03, 0xfa, 0xf5, 0xeb, 0xe7, 0x57,
-  0x35, 0xc6, 0x03, 0x55, 0xad, 0x5a, 0x01, 0x28, 0xe1, 0x47, 0x40, 0x58,
-  0xdb, 0x4f, 0x00, 0x00, 0x20, 0x00, 0x49, 0x44, 0x41, 0x54, 0x6b, 0x0d,
-  0x1d, 0xde, 0x06, 0x07, 0x55, 0xb5, 0xf6, 0x0e, 0x5f, 0x5a, 0x54, 0x54,
-  0x24, 0x5b, 0x63, 0x51, 0x44, 0x47, 0x6b, 0x39, 0xb8, 0x3d, 0x2a, 0x65,
-  0x15, 0xad, 0xb1, 0x2b, 0xac, 0xdb, 0x3c, 0x50, 0x90, 0xc0, 0xa4, 0x31,
-  0xd9, 0x81, 0xbe, 0x73, 0x31, 0x10, 0x32, 0x83, 0x13, 0x2a, 0x01, 0x70,
-  0x5d, 0xa0, 0x6f, 0x78, 0xe2, 0xb8, 0x1c, 0xe2, 0x4b, 0x52, 0xc0, 0xea,
-  0xea, 0xc0, 0x0b, 0x4f, 0x8f, 0xed, 0x90, 0x9d, 0xda, 0x86, 0x8e, 0x45,
-  0xae, 0x06, 0x22, 0xda, 0x56, 0x38, 0x76, 0x92, 0x93, 0x93, 0xfd, 0x3a,
-  0x8a, 0xb9, 0xbf, 0xb2, 0x35, 0xf6, 0x92, 0x96, 0xb4, 0x73, 0x3e, 0x34,
-  0xd4, 0x3b, 0xa8, 0x6b, 0xec, 0x78, 0x24, 0x77, 0x71, 0x71, 0xf1, 0xb7,
-  0x91, 0xe9, 0x42, 0xe4, 0xd3, 0xde, 0xbc, 0x01, 0xdf, 0x67, 0x67, 0x59,
-  0xb3, 0xe6, 0xdb, 0x8d, 0x41, 0x54, 0xaf, 0x0a, 0x28, 0x4c, 0x1f, 0x1f,
-  0x94, 0xed, 0xe1, 0x04, 0xc0, 0x12, 0x8a, 0xef, 0x11, 0xaa, 0x19, 0x3c,
-  0x82, 0x00, 0xef, 0xff, 0xcf, 0x38, 0x21, 0x0f, 0x0c, 0xfa, 0x23, 0x9e,
-  0x93, 0xfd, 0x59, 0xcc, 0x7a, 0xaa, 0xea, 0x1d, 0xd4, 0x1c, 0xea, 0xd8,
-  0x8a, 0xe7, 0xfb, 0x45, 0x34, 0x84, 0xce, 0xa5, 0xb8, 0xb8, 0xe3, 0xc3,
-  0xe8, 0x60, 0xb5, 0xfd, 0xbb, 0x08, 0x50, 0xe1, 0x3b, 0x8c, 0x3a, 0x1a,
-  0x9a, 0x5d, 0x34, 0x36, 0xbb, 0x42, 0xd2, 0x0f, 0x42, 0xf8, 0xe2, 0xcf,
-  0x71, 0xce, 0xb2, 0xfd, 0xad, 0xa0, 0xe8, 0x62, 0xb3, 0xd6, 0x86, 0x02,
-  0x58, 0x9d, 0x4c, 0x19, 0x93, 0x8d, 0xc9, 0x18, 0x70, 0x33, 0x6a, 0x02,
-  0x42, 0x52, 0x5e, 0x33, 0x14, 0x02, 0xc0, 0x00, 0x24, 0x07, 0xb4, 0xed,
-  0x15, 0x38, 0x79, 0x5c, 0x36, 0xd8, 0x3a, 0xb8, 0x72, 0x31, 0xeb, 0x38,
-  0xd4, 0xe0, 0xe8, 0xf0, 0xb1, 0x95, 0x40, 0x65, 0xeb, 0x12, 0x8e, 0x1d,
-  0x7f, 0x02, 0x32, 0x0f, 0xd5, 0x3b, 0x10, 0x17, 0xc0, 0xcf, 0xbd, 0x66,
-  0x74, 0x34, 0xd9, 0x5c, 0x78, 0xbd, 0x1d, 0x7f, 0x83, 0x4b, 0x5e, 0x8c,
-  0xe8, 0xc2, 0x9f, 0x38, 0xa7, 0xfd, 0x95, 0xad, 0xe0, 0x55, 0x51, 0x62,
-  0xd5, 0x11, 0xd4, 0xe8, 0x24, 0xbb, 0x4f, 0x0a, 0x23, 0x06, 0x05, 0xc5,
-  0x43, 0xfc, 0xdb, 0x68, 0x11, 0x00, 0x5d, 0x09, 0xf0, 0xfe, 0xff, 0x88,
-  0xe3, 0x32, 0xc8, 0xea, 0x97, 0x06, 0x8d, 0xce, 0x0e, 0x7e, 0x5b, 0x85,
-  0x9a, 0xba, 0x8e, 0xef, 0x77, 0xc6, 0xc7, 0xc7, 0xcb, 0x1b, 0x22, 0x4c,
-  0xf0, 0x27, 0x1e, 0xa3, 0xc9, 0xea, 0x02, 0xa7, 0x1b, 0x45, 0x2f, 0x22,
-  0xe0, 0x07, 0xe8, 0x15, 0xea, 0x3b, 0x3a, 0x87, 0x7c, 0xfc, 0x52, 0xea,
-  0x66, 0x21, 0xf2, 0xf8, 0x71, 0xb5, 0xc0, 0xf6, 0x50, 0x55, 0xdb, 0x06,
-  0x36, 0xa7, 0x16, 0x5b, 0x15, 0x8b, 0xb8, 0xbd, 0x90, 0x6c, 0x66, 0xd2,
-  0xe8, 0x80, 0x6f, 0xd9, 0x17, 0x03, 0x3d, 0xa3, 0x45, 0x00, 0x04, 0xbc,
-  0x58, 0xf8, 0xf4, 0x13, 0x72, 0x20, 0xd9, 0x8c, 0xea, 0xf4, 0x74, 0xf8,
-  0xdb, 0xd6, 0xd6, 0x75, 0x7c, 0xbf, 0x33, 0x39, 0x39, 0x59, 0xde, 0x10,
-  0x61, 0x42, 0x62, 0x62, 0x62, 0x87, 0xaf, 0xa9, 0x6b, 0x70, 0x40, 0x8b,
-  0x1b, 0x44, 0x00, 0xfc, 0x84, 0xe6, 0x16, 0x97, 0x5f, 0xd7, 0x65, 0x64,
-  0x64, 0x48, 0xe3, 0xc5, 0xf8, 0xbc, 0xaa, 0xac, 0xb1, 0x43, 0x93, 0x2b,
-  0x66, 0x05, 0x80, 0x0a, 0xa0, 0xaa, 0x4c, 0x1e, 0x15, 0x14, 0x31, 0x9c,
-  0x4c, 0x08, 0x12, 0xf5, 0x85, 0x4a, 0x00, 0x04, 0x74, 0xc3, 0x70, 0xd2,
-  0xc8, 0x2c, 0xf0, 0x78, 0x3a, 0xbe, 0xaf, 0xab, 0x28, 0x1c, 0x6a, 0xe8,
-  0xb8, 0x00, 0xf0, 0x78, 0x3c, 0xf2, 0x86, 0x08, 0x13, 0xfc, 0x89, 0xc7,
-  0xb0, 0x3b, 0x3c, 0xe0, 0x52, 0x25, 0x0e, 0xe0, 0x27, 0xf3, 0x01, 0x5a,
-  0x5b, 0xdc, 0x21, 0xeb, 0x07, 0x21, 0x7c, 0xe9, 0x48, 0x2d, 0x80, 0xc3,
-  0xd4, 0xd6, 0xd9, 0x71, 0xb5, 0xb9, 0x63, 0xfb, 0x84, 0x4d, 0x83, 0x83,
-  0xe3, 0x07, 0xa6, 0x61, 0x89, 0x0f, 0x78, 0x34, 0xa4, 0x09, 0x08, 0x7a,
-  0x9e, 0xed, 0x50, 0x08, 0x80, 0x84, 0x40, 0xde, 0x2c, 0x33, 0xcd, 0xcc,
-  0xe8, 0x61, 0x99, 0xd0, 0xe0, 0x9f, 0xeb, 0xb2, 0xb6, 0xbe, 0xe3, 0xd7,
-  0x89, 0x00, 0x08, 0x1f, 0xfc, 0x89, 0x3c, 0x6f, 0xb6, 0xba, 0xb4, 0x42,
-  0x51, 0xe2, 0x01, 0xf8, 0x89, 0x00, 0x68, 0xb2, 0xfa, 0xe7, 0x01, 0xf0,
-  0xc7, 0x65, 0x2c, 0x44, 0x17, 0x4d, 0x56, 0x17, 0x8d, 0x36, 0x77, 0xec,
-  0x6e, 0x01, 0x00, 0xd8, 0x5c, 0x24, 0xf4, 0x4a, 0x61, 0xc2, 0xf1, 0x5d,
-  0x82, 0x71, 0xf7, 0x73, 0x22, 0x5d, 0x00, 0x24, 0x00, 0x71, 0x81, 0xbc,
-  0xe1, 0xd8, 0xe1, 0x99, 0x98, 0x8b, 0x12, 0xc1, 0x2f, 0xd7, 0xa5, 0x42,
-  0x73, 0x07, 0x5f, 0x78, 0x09, 0x09, 0x09, 0xb2, 0x05, 0x10, 0xe1, 0x58,
-  0x6d, 0x6e, 0x70, 0x78, 0x42, 0x5f, 0xfc, 0x3a, 0x02, 0xd0, 0xfb, 0x29,
-  0x8a, 0xc4, 0x03, 0x10, 0x6d, 0xe3, 0xa0, 0xe3, 0x2b, 0x58, 0x87, 0xd3,
-  0x4b, 0xb3, 0xd5, 0x19, 0xd3, 0x1e, 0x00, 0xd5, 0xed, 0x05, 0xb3, 0x91,
-  0xe3, 0x07, 0x05, 0x7c, 0x4b, 0xac, 0x18, 0x38, 0x39, 0xd2, 0x05, 0x40,
-  0x31, 0x01, 0x0e, 0x00, 0x9c, 0x32, 0x36, 0x1b, 0xcc, 0x46, 0xdf, 0x39,
-  0xcc, 0x0e, 0x98, 0x7e, 0xbd, 0x02, 0x0e, 0x37, 0x0d, 0x4d, 0x4e, 0x99,
-  0xed, 0x11, 0x4c, 0x6d, 0x6d, 0x6d, 0x87, 0xaf, 0x49, 0x4c, 0x34, 0xa0,
-  0x98, 0x74, 0xe0, 0x95, 0xf6, 0x0b, 0x14, 0x6e, 0xb7, 0x5b, 0x1a, 0x21,
-  0x8a, 0x70, 0x3a, 0x9d, 0x7e, 0x5e, 0xe7, 0x8d, 0xed, 0x03, 0x36, 0x8a,
-  0x02, 0x5e, 0x0f, 0x23, 0x07, 0x07, 0x25, 0x26, 0x26, 0xe8, 0xb9, 0x00,
-  0x82, 0x2d, 0x00, 0x66, 0x07, 0xfa, 0x86, 0xe3, 0x87, 0x65, 0x82, 0xd3,
-  0x8f, 0x97, 0x8f, 0x02, 0x78, 0x55, 0x9c, 0xae, 0x8e, 0x59, 0x81, 0x96,
-  0x96, 0x16, 0x9a, 0x9b, 0x9b, 0xe5, 0x0d, 0x11, 0x26, 0x98, 0x4c, 0x1d,
-  0xd7, 0x93, 0x69, 0x29, 0x46, 0xad, 0x16, 0x80, 0x54, 0x03, 0x0c, 0xd8,
-  0x6a, 0xd1, 0x9f, 0x8c, 0x8c, 0x42, 0xf8, 0x72, 0xf0, 0xe0, 0x41, 0xbf,
-  0xae, 0xab, 0x6b, 0x72, 0xc4, 0xf6, 0x16, 0x00, 0x40, 0x8b, 0x9b, 0x61,
-  0xfd, 0xd2, 0x82, 0x91, 0x0f, 0x20, 0x0e, 0x08, 0xea, 0x19, 0xf4, 0x60,
-  0xf7, 0xdc, 0x74, 0x02, 0x18, 0x00, 0x98, 0x9d, 0x19, 0xc7, 0xe0, 0x01,
-  0x69, 0xd0, 0xe8, 0x67, 0x0d, 0x6a, 0x95, 0x8e, 0x25, 0x0e, 0xfa, 0xde,
-  0x0b, 0x4f, 0x08, 0x0f, 0xfc, 0x89, 0x56, 0x4e, 0xb4, 0x18, 0xc1, 0xac,
-  0x03, 0xaf, 0x08, 0x80, 0x40, 0xf5, 0x41, 0x97, 0x2e, 0x5d, 0xa4, 0x21,
-  0xa2, 0x88, 0xba, 0xba, 0x3a, 0xff, 0x0c, 0x88, 0x04, 0xd6, 0x42, 0xb3,
-  0x93, 0xec, 0x1e, 0x49, 0x0c, 0xec, 0x13, 0xf0, 0x72, 0x37, 0x26, 0x02,
-  0x1c, 0x40, 0x1f, 0x6a, 0x01, 0x10, 0xd0, 0x03, 0xf4, 0xe3, 0x8f, 0xef,
-  0x02, 0x05, 0x89, 0x5a, 0x1e, 0xe6, 0x0e, 0x5b, 0x71, 0x1d, 0xb4, 0xb8,
-  0xb5, 0x23, 0x61, 0x22, 0x00, 0x22, 0x96, 0x8e, 0x56, 0x2d, 0x03, 0xc8,
-  0x48, 0x35, 0x41, 0xbc, 0x11, 0x3c, 0xb2, 0x07, 0x10, 0x08, 0x5c, 0x2e,
-  0x17, 0x76, 0xbb, 0x5d, 0x1a, 0x22, 0x8a, 0x68, 0x68, 0x68, 0x90, 0x46,
-  0xf0, 0x17, 0xb7, 0x17, 0xd2, 0xcc, 0x0c, 0x1f, 0x18, 0x94, 0x84, 0x40,
-  0x17, 0x44, 0xaa, 0x00, 0x88, 0x27, 0xc0, 0x7b, 0x18, 0x63, 0x86, 0x66,
-  0x68, 0xe9, 0x7f, 0xfd, 0x75, 0xe5, 0xaa, 0xe0, 0xf5, 0xc3, 0x03, 0x60,
-  0xb3, 0xd9, 0x64, 0x90, 0x87, 0x09, 0xfe, 0xd4, 0x65, 0x48, 0x4f, 0x33,
-  0xfb, 0xc6, 0x8d, 0xb4, 0xdf, 0x4f, 0x5e, 0x00, 0x7e, 0xd4, 0x73, 0x6f,
-  0x6d, 0x6d, 0xf5, 0x7b, 0xc5, 0x28, 0x84, 0x27, 0x87, 0x0e, 0x1d, 0x92,
-  0x46, 0xf0, 0x13, 0xd5, 0x0b, 0xe8, 0xf5, 0x0c, 0x1d, 0x10, 0x70, 0x01,
-  0x50, 0x0c, 0x8c, 0x8b, 0x54, 0x01, 0x90, 0x47, 0xc0, 0x33, 0x00, 0xa6,
-  0x83, 0xdb, 0xed, 0x5f, 0xd0, 0x89, 0xd7, 0x0b, 0x09, 0x7a, 0x32, 0xd3,
-  0x3a, 0x7e, 0x28, 0xa1, 0xad, 0xad, 0x4d, 0x46, 0x79, 0xb8, 0x88, 0x6d,
-  0x3f, 0x82, 0xcf, 0xd2, 0x53, 0x4d, 0x80, 0x57, 0xb2, 0x01, 0xff, 0x18,
-  0x45, 0xa1, 0xce, 0xcf, 0x4c, 0x80, 0x06, 0x83, 0x41, 0xda, 0x2f, 0x8a,
-  0xa8, 0xaa, 0xaa, 0x92, 0x46, 0x38, 0x16, 0x9c, 0x6e, 0x86, 0xf4, 0x0b,
-  0xca, 0xd1, 0x58, 0x53, 0x30, 0x3f, 0x76, 0x30, 0x05, 0xc0, 0x84, 0x40,
-  0xde, 0x2c, 0xc1, 0x62, 0x60, 0x40, 0x49, 0x0a, 0xd8, 0xfc, 0x8c, 0x3e,
-  0x56, 0x01, 0x9d, 0xe2, 0xd7, 0xb1, 0xa7, 0x96, 0x96, 0x16, 0x19, 0xe0,
-  0x61, 0xb3, 0x62, 0xed, 0xf8, 0x90, 0xcd, 0xce, 0x8c, 0x03, 0x55, 0xf6,
-  0xff, 0x7f, 0x76, 0x6c, 0xb7, 0xfa, 0x37, 0x9f, 0x9a, 0x9a, 0x9a, 0xa4,
-  0xf1, 0xa2, 0x88, 0xea, 0xea, 0x6a, 0xff, 0x5e, 0xab, 0x32, 0xad, 0x34,
-  0x6c, 0x2e, 0xfa, 0xf5, 0x48, 0xc6, 0x12, 0xf8, 0xf2, 0xc8, 0x29, 0x04,
-  0x31, 0x10, 0x30, 0x98, 0x02, 0x60, 0x16, 0x01, 0x0c, 0x60, 0x38, 0xae,
-  0x4f, 0x0a, 0xa9, 0x45, 0x89, 0x60, 0xf3, 0x2f, 0x71, 0x09, 0xaa, 0xb6,
-  0xe2, 0xf1, 0x47, 0x00, 0x88, 0x7b, 0x2c, 0x7c, 0xa8, 0xaf, 0xaf, 0xef,
-  0xf0, 0x35, 0x59, 0x19, 0x66, 0x39, 0x02, 0x78, 0x04, 0xfc, 0xcd, 0x03,
-  0x20, 0x7b, 0xc6, 0xd1, 0x45, 0x45, 0x45, 0x85, 0x34, 0xc2, 0xb1, 0x60,
-  0x77, 0x93, 0x90, 0x13, 0x4f, 0xff, 0x5e, 0x29, 0xc1, 0xb8, 0x7b, 0xd0,
-  0x2a, 0x6f, 0x05, 0x53, 0x00, 0xe4, 0x07, 0xf2, 0x66, 0x83, 0xfa, 0xa6,
-  0x41, 0x8a, 0x49, 0x0b, 0xb8, 0xf0, 0xc7, 0xfe, 0x7b, 0x54, 0xf8, 0x7f,
-  0xf6, 0xce, 0x3b, 0x4a, 0xae, 0xa3, 0xce, 0xf7, 0x9f, 0xea, 0x1c, 0xa6,
-  0x27, 0x69, 0x92, 0x66, 0x94, 0xb3, 0x64, 0x4b, 0xb6, 0xe5, 0x9c, 0x73,
-  0x8e, 0xd8, 0x18, 0x1b, 0x27, 0xec, 0xc5, 0xc4, 0xf5, 0xb2, 0xac, 0x1f,
-  0xec, 0x5b, 0x60, 0x61, 0x17, 0xde, 0x12, 0x1e, 0xd9, 0x2c, 0x0b, 0x2c,
-  0xac, 0x81, 0x05, 0x8c, 0x79, 0x06, 0x63, 0x70, 0xc0, 0x41, 0xb6, 0x91,
-  0x6d, 0x59, 0x72, 0x94, 0xac, 0x68, 0x8d, 0xd2, 0x68, 0x34, 0xa3, 0xc9,
-  0xb1, 0x73, 0xb8, 0xf7, 0xd6, 0xfb, 0xa3, 0xc7, 0xec, 0xb2, 0x38, 0xa8,
-  0x7b, 0xee, 0x1d, 0x75, 0xf7, 0xfc, 0x3e, 0xe7, 0xe8, 0x1c, 0xfb, 0x9c,
-  0xb9, 0x55, 0xdd, 0xd5, 0x55, 0xb7, 0xbe, 0xf5, 0xab, 0x5f, 0x08, 0x78,
-  0xa8, 0xab, 0x2e, 0xdc, 0xa2, 0x32, 0x36, 0x36, 0x26, 0x13, 0xbc, 0x54,
-  0xd6, 0x59, 0x11, 0xce, 0x67, 0xad, 0x4d, 0x41, 0x39, 0xaa, 0xd8, 0x8c,
-  0x58, 0x00, 0x2a, 0x8b, 0x03, 0x07, 0x0e, 0x14, 0xf5, 0x5c, 0x6d, 0xb5,
-  0x57, 0xc2, 0x6b, 0x01, 0x9d, 0xb5, 0xa0, 0x21, 0xc0, 0xca, 0xa5, 0x8e,
-  0x5c, 0x03, 0xbc, 0xcb, 0xa9, 0xcf, 0xed, 0xa4, 0x00, 0xb0, 0xd5, 0x01,
-  0x70, 0xd5, 0xb2, 0x5a, 0x70, 0xbb, 0x27, 0xfd, 0x1e, 0xaf, 0x8e, 0x78,
-  0x0b, 0x7e, 0x46, 0x1c, 0x9e, 0x4a, 0x87, 0x62, 0xae, 0x63, 0x66, 0xd4,
-  0xf9, 0x21, 0x2b, 0x26, 0x00, 0x3b, 0x11, 0xab, 0x58, 0xe5, 0x30, 0x30,
-  0x30, 0x40, 0x6f, 0x6f, 0x6f, 0xc1, 0xcf, 0x29, 0x05, 0x55, 0x61, 0x2f,
-  0x18, 0x22, 0x00, 0xf2, 0x16, 0x46, 0xc5, 0x91, 0x4b, 0x6d, 0xb7, 0x00,
-  0xcc, 0x07, 0xce, 0x2b, 0x37, 0x01, 0x50, 0x8b, 0xcd, 0x35, 0x00, 0x8e,
-  0x5c, 0x5a, 0x93, 0x77, 0x00, 0x9c, 0x9c, 0x4e, 0xcb, 0x9b, 0x83, 0x0b,
-  0x44, 0x1c, 0x64, 0x4a, 0x87, 0x42, 0x33, 0x01, 0xd6, 0xd7, 0xfa, 0x68,
-  0xae, 0xf7, 0x43, 0x46, 0x04, 0x80, 0x9d, 0x14, 0x9b, 0x38, 0x46, 0x28,
-  0x3d, 0x3a, 0x3a, 0x3a, 0x8a, 0xaa, 0x77, 0x12, 0x0a, 0xb8, 0xa9, 0xad,
-  0x2e, 0xde, 0x2a, 0x5b, 0x51, 0x28, 0xc0, 0x34, 0x9d, 0xc8, 0x05, 0x60,
-  0xfb, 0x61, 0x7a, 0x2a, 0x04, 0x80, 0xad, 0xe6, 0x7f, 0x8f, 0x5b, 0xb1,
-  0x62, 0x41, 0xa4, 0x78, 0x07, 0xc0, 0x3f, 0xed, 0xff, 0x3a, 0xef, 0x10,
-  0x56, 0x20, 0xc5, 0x3a, 0xc8, 0x08, 0xce, 0x9c, 0x56, 0x0a, 0xa1, 0xb9,
-  0x21, 0x40, 0x5d, 0x63, 0x20, 0x5f, 0x0b, 0x40, 0xb0, 0x0d, 0xb9, 0x33,
-  0xae, 0x1c, 0xf6, 0xed, 0xdb, 0x57, 0xd4, 0x73, 0xd5, 0x11, 0x2f, 0x61,
-  0x49, 0xb0, 0xf5, 0x5f, 0xa4, 0x2d, 0x16, 0xce, 0x0a, 0x17, 0x15, 0x5a,
-  0xfb, 0x0e, 0x44, 0x9c, 0xda, 0xab, 0x9d, 0x12, 0x00, 0x17, 0xd9, 0xd9,
-  0xd8, 0xb2, 0x85, 0xd5, 0xcc, 0x68, 0x0d, 0x41, 0x7a, 0x92, 0x02, 0xc0,
-  0x82, 0xd9, 0xad, 0x85, 0x8b, 0xa9, 0x42, 0x37, 0x1d, 0xc1, 0x39, 0x0a,
-  0xb5, 0xc6, 0xb4, 0x36, 0x07, 0xf3, 0xbe, 0x23, 0x39, 0x39, 0xa5, 0xd8,
-  0x7d, 0x6a, 0x14, 0x2a, 0x83, 0xdd, 0xbb, 0x77, 0x17, 0xf5, 0x5c, 0x73,
-  0x43, 0x00, 0x4f, 0x95, 0x57, 0x2c, 0x00, 0x6f, 0x90, 0xc8, 0x31, 0x67,
-  0x76, 0x15, 0x73, 0x5a, 0x6d, 0x3f, 0xb0, 0xfb, 0x00, 0x47, 0x8a, 0x0d,
-  0x38, 0x25, 0x00, 0xae, 0xc0, 0xc6, 0x08, 0x80, 0x25, 0x0b, 0x22, 0xd0,
-  0x10, 0x98, 0xfc, 0x3d, 0x6e, 0xd6, 0xa2, 0xad, 0xb9, 0xf0, 0xe4, 0x84,
-  0x72, 0xda, 0x29, 0x1d, 0xba, 0xba, 0xba, 0x0a, 0xfa, 0xfb, 0xb9, 0x6d,
-  0x61, 0xf0, 0xb9, 0xc4, 0x09, 0xf0, 0x2d, 0x30, 0x8b, 0x74, 0xe0, 0xea,
-  0xee, 0xee, 0x96, 0xc1, 0xab, 0x10, 0xb6, 0x6d, 0xdb, 0x56, 0xb4, 0x00,
-  0xa0, 0x5a, 0x7c, 0x00, 0xfe, 0x44, 0xc6, 0xc4, 0xdd, 0x18, 0x60, 0xe1,
-  0xdc, 0x2a, 0x27, 0x5a, 0x6f, 0x73, 0xa2, 0x51, 0xa7, 0x04, 0x80, 0xad,
-  0x29, 0x80, 0x97, 0x2e, 0xa8, 0x06, 0xaf, 0x07, 0x3d, 0xd9, 0x89, 0x96,
-  0x34, 0x98, 0xd3, 0x12, 0x2a, 0xd8, 0x0f, 0xe0, 0xe0, 0xc1, 0x83, 0x92,
-  0x0b, 0xa0, 0x04, 0x88, 0x46, 0xa3, 0xec, 0xdd, 0xbb, 0xb7, 0x30, 0xf1,
-  0x38, 0x3f, 0x02, 0x7e, 0x8f, 0x98, 0x29, 0xdf, 0x6a, 0xa1, 0x16, 0x19,
-  0xb7, 0xbc, 0x7f, 0xff, 0x7e, 0xb1, 0x8c, 0x4d, 0x73, 0x01, 0xd0, 0xd6,
-  0x12, 0x82, 0x2a, 0x2f, 0x5a, 0xac, 0x6b, 0x79, 0x2c, 0x0d, 0x41, 0x37,
-  0x2b, 0x16, 0x39, 0x52, 0x3e, 0xde, 0x11, 0x47, 0x40, 0x97, 0x43, 0x6d,
-  0xda, 0xea, 0x00, 0xb8, 0x7c, 0x51, 0x04, 0xb4, 0x39, 0xf9, 0x4c, 0x6e,
-  0x13, 0xb1, 0x9a, 0x73, 0x5a, 0x0b, 0xfb, 0x78, 0x89, 0x44, 0xa2, 0xe0,
-  0x93, 0xa7, 0x60, 0x3f, 0xed, 0xed, 0xed, 0x05, 0x87, 0x01, 0xce, 0x6d,
-  0xcb, 0x9b, 0xe3, 0xc4, 0x00, 0xf0, 0x26, 0x68, 0x4d, 0x7d, 0x8d, 0xb7,
-  0xa8, 0x47, 0x93, 0xc9, 0x64, 0xc1, 0x62, 0x4c, 0x28, 0x3d, 0x7a, 0x7a,
-  0x7a, 0x8a, 0xbe, 0x02, 0x98, 0x3d, 0x33, 0x24, 0x03, 0xf8, 0x67, 0x02,
-  0x00, 0xf0, 0x78, 0x9c, 0xb0, 0x00, 0xcc, 0xc7, 0xe6, 0x6b, 0x75, 0x27,
-  0x05, 0x40, 0x8d, 0xdd, 0x16, 0x80, 0x65, 0x0b, 0xaa, 0xed, 0xb9, 0xc3,
-  0x35, 0x35, 0x44, 0xbc, 0x2c, 0x5b, 0x58, 0x78, 0x62, 0x25, 0x11, 0x00,
-  0x87, 0x9f, 0x1d, 0x3b, 0x76, 0x14, 0xfc, 0xcc, 0x92, 0xf9, 0x11, 0x48,
-  0xe7, 0x64, 0xf0, 0xde, 0x54, 0x00, 0x40, 0x30, 0x58, 0x7c, 0x4a, 0xdf,
-  0xed, 0xdb, 0xb7, 0xcb, 0x18, 0x96, 0x39, 0x9b, 0x37, 0x6f, 0x2e, 0x2a,
-  0xbd, 0x36, 0xc0, 0xc2, 0xb9, 0x61, 0x51, 0xd6, 0x7f, 0xbe, 0x9c, 0x40,
-  0x5b, 0xcc, 0x9b, 0x15, 0x76, 0xa2, 0x79, 0x47, 0xcc, 0x0a, 0x4e, 0x08,
-  0x80, 0x59, 0x76, 0x36, 0x16, 0x0c, 0xb8, 0x99, 0xdd, 0x12, 0x84, 0x94,
-  0x0d, 0x02, 0xc0, 0xd2, 0xe0, 0xf7, 0xb2, 0x6a, 0x79, 0x5d, 0xc1, 0x8f,
-  0x76, 0x76, 0x76, 0xca, 0x0c, 0x3f, 0xcc, 0x6c, 0xda, 0xb4, 0xa9, 0xa0,
-  0xbf, 0x0f, 0x05, 0xdc, 0x2c, 0x99, 0x5b, 0x05, 0x49, 0x89, 0x00, 0x78,
-  0xab, 0x37, 0x56, 0x7d, 0x4d, 0xf1, 0xa9, 0xc6, 0xb7, 0x6e, 0xdd, 0x2a,
-  0x63, 0x58, 0xe6, 0x6c, 0xd8, 0xb0, 0xa1, 0xe8, 0x67, 0x17, 0xcf, 0x8f,
-  0x40, 0x4e, 0x04, 0xc0, 0x9f, 0x91, 0x36, 0x98, 0xef, 0x8c, 0x00, 0x70,
-  0xa4, 0x26, 0x80, 0x13, 0x02, 0xe0, 0x54, 0x3b, 0x1b, 0x9b, 0xd3, 0x1a,
-  0xa2, 0xa5, 0x35, 0x04, 0x29, 0x63, 0xd2, 0x6d, 0x69, 0x0d, 0x98, 0x26,
-  0xc7, 0x1e, 0x59, 0xb8, 0x00, 0x10, 0x73, 0xe7, 0xe1, 0xe7, 0x85, 0x17,
-  0x5e, 0x28, 0xf8, 0xf4, 0x5f, 0xd5, 0x14, 0x94, 0x10, 0xc0, 0xb7, 0x11,
-  0xc4, 0x8d, 0xf5, 0x81, 0xa2, 0x1f, 0xdf, 0xbc, 0x79, 0xb3, 0x8c, 0xe1,
-  0x34, 0x15, 0x00, 0xc1, 0x80, 0x9b, 0x05, 0xad, 0xe1, 0xc9, 0x47, 0x66,
-  0x55, 0x9c, 0x00, 0x30, 0x99, 0xd7, 0x16, 0x26, 0xe0, 0xb7, 0xbd, 0x26,
-  0x40, 0x35, 0x36, 0x5b, 0xd6, 0x9d, 0x12, 0x00, 0x17, 0x62, 0x63, 0x04,
-  0xc0, 0xec, 0x99, 0x21, 0xa8, 0xf3, 0x43, 0xce, 0xa6, 0x97, 0x78, 0x2c,
-  0xc7, 0x31, 0xcb, 0x6a, 0xf0, 0x14, 0x98, 0x03, 0xbd, 0xd8, 0x58, 0x59,
-  0xc1, 0x1e, 0x86, 0x86, 0x86, 0x0a, 0xb6, 0x00, 0xac, 0x58, 0x5c, 0x63,
-  0x4f, 0xf4, 0x48, 0xa5, 0x92, 0xb3, 0x26, 0x2a, 0x25, 0x16, 0xc7, 0xa6,
-  0x4d, 0x9b, 0xc8, 0x66, 0xb3, 0x32, 0x8e, 0xe5, 0xba, 0x57, 0xa5, 0xd3,
-  0xbc, 0xf4, 0xd2, 0x4b, 0x45, 0x3d, 0x3b, 0x7f, 0x76, 0x98, 0xa6, 0xb6,
-  0x30, 0x24, 0x44, 0x00, 0xfc, 0x19, 0x59, 0x8b, 0xea, 0x5a, 0x3f, 0x73,
-  0x5b, 0x1d, 0xf1, 0x8f, 0xa8, 0xb3, 0xbb, 0x41, 0x27, 0x04, 0x40, 0xab,
-  0x9d, 0x8d, 0x2d, 0x9c, 0x5b, 0x95, 0x0f, 0xe3, 0xb2, 0xeb, 0x1d, 0x9e,
-  0x30, 0xa8, 0x9b, 0x1f, 0xe1, 0x98, 0x23, 0x0a, 0x1b, 0xcb, 0x3d, 0x7b,
-  0xf6, 0xc8, 0xe4, 0x3e, 0x8c, 0x3c, 0xfb, 0xec, 0xb3, 0x05, 0x6f, 0x36,
-  0x47, 0x2e, 0xad, 0x01, 0xb7, 0x2b, 0x5f, 0x07, 0x42, 0xf8, 0x4b, 0x32,
-  0x16, 0x2d, 0xf5, 0x7e, 0x66, 0xd4, 0x15, 0x27, 0x02, 0xa2, 0xd1, 0xa8,
-  0x58, 0x01, 0xca, 0x98, 0xf5, 0xeb, 0xd7, 0x13, 0x8d, 0x46, 0x8b, 0x7a,
-  0x76, 0xe9, 0x82, 0x6a, 0x98, 0xe1, 0x13, 0x71, 0xfd, 0x3f, 0x31, 0x2c,
-  0xa8, 0xf1, 0x32, 0xcb, 0x19, 0x07, 0xc9, 0x59, 0x76, 0x37, 0xe8, 0x84,
-  0x00, 0xb0, 0xb5, 0x50, 0xf8, 0xdc, 0x59, 0x61, 0xf0, 0x79, 0x6c, 0x73,
-  0x36, 0xd1, 0x59, 0x13, 0xea, 0x02, 0x9c, 0x76, 0x7c, 0x63, 0x41, 0xcf,
-  0xed, 0xdd, 0xbb, 0x57, 0x4e, 0x3b, 0x87, 0x91, 0xc7, 0x1e, 0x7b, 0xac,
-  0xe0, 0x67, 0x56, 0x2d, 0xaf, 0x05, 0xcb, 0x9a, 0x7c, 0xf4, 0x48, 0xa5,
-  0x92, 0x32, 0xa8, 0x6d, 0x09, 0xe6, 0x8b, 0x25, 0x15, 0x49, 0xa1, 0xd7,
-  0x32, 0x42, 0xe9, 0xf0, 0xc4, 0x13, 0x4f, 0x14, 0xfd, 0xec, 0x91, 0x4b,
-  0x6b, 0x20, 0xe0, 0x11, 0x27, 0xc0, 0xff, 0x49, 0xce, 0x82, 0x88, 0x8f,
-  0xd6, 0x96, 0xa0, 0x13, 0xad, 0x9f, 0x58, 0xd2, 0x9b, 0xf5, 0x44, 0x7b,
-  0xb6, 0x7a, 0x40, 0xcc, 0x6b, 0xcb, 0x37, 0x67, 0xef, 0x3c, 0xd3, 0x9c,
-  0x71, 0x42, 0x03, 0xdf, 0xba, 0xbb, 0xfd, 0x90, 0x9f, 0x18, 0x1f, 0x1f,
-  0x67, 0xd3, 0xa6, 0x4d, 0x9c, 0x78, 0xe2, 0x89, 0x68, 0x99, 0xf4, 0x53,
-  0x86, 0x52, 0x8a, 0x54, 0x2a, 0xc5, 0x83, 0x0f, 0x3e, 0x58, 0xd8, 0x44,
-  0x74, 0x2b, 0x8e, 0x5a, 0x52, 0x03, 0x49, 0x31, 0x51, 0xbe, 0xed, 0x69,
-  0xa5, 0x21, 0xc0, 0xfc, 0xd9, 0x55, 0x6c, 0x6d, 0x2f, 0xae, 0xba, 0xdf,
-  0x57, 0xbe, 0xf2, 0x15, 0xd6, 0xaf, 0x5f, 0x5f, 0x54, 0x95, 0x46, 0xe1,
-  0xf0, 0xad, 0x29, 0xaf, 0xd7, 0x3b, 0x29, 0x01, 0x70, 0xcc, 0x8a, 0x3a,
-  0x40, 0xc9, 0xfe, 0xff, 0x3f, 0x77, 0x16, 0x0b, 0x94, 0x4b, 0xd1, 0x66,
-  0xbf, 0x00, 0x98, 0x0f, 0x9c, 0x0d, 0xfc, 0x6b, 0x29, 0x0b, 0x80, 0x30,
-  0x36, 0x7b, 0x2b, 0xce, 0x9e, 0x19, 0xb2, 0xef, 0xfe, 0xff, 0x4f, 0xbb,
-  0x79, 0x96, 0xd3, 0x8e, 0x6d, 0x24, 0xe0, 0x77, 0x93, 0x2e, 0xc0, 0x41,
-  0xec, 0xaa, 0xab, 0xae, 0xa2, 0xb1, 0xb1, 0x91, 0x4c, 0x26, 0x23, 0x33,
-  0x7d, 0x8a, 0xf0, 0x7a, 0xbd, 0xc4, 0xe3, 0xf1, 0x82, 0xeb, 0x31, 0x2c,
-  0x9a, 0x57, 0xc5, 0xac, 0xf9, 0x11, 0x88, 0x49, 0x08, 0xe0, 0x5b, 0x62,
-  0x69, 0x08, 0x7a, 0x58, 0xb1, 0xb8, 0x9a, 0x07, 0x9f, 0x2c, 0xae, 0xb8,
-  0x4f, 0x4f, 0x4f, 0x0f, 0xbf, 0xfa, 0xd5, 0xaf, 0x64, 0x2c, 0xa7, 0x19,
-  0xc7, 0x1f, 0x59, 0x0b, 0x31, 0xb1, 0x88, 0xfe, 0xa5, 0xba, 0xca, 0xab,
-  0x80, 0xc9, 0x58, 0xd5, 0xde, 0x86, 0xe6, 0x52, 0xb7, 0x00, 0xd8, 0x1e,
-  0xab, 0xd8, 0xd6, 0x12, 0x84, 0xb4, 0xdd, 0x02, 0x20, 0x47, 0xc3, 0xf2,
-  0x5a, 0x4e, 0x39, 0xb6, 0x81, 0xa7, 0xd7, 0x1f, 0xfa, 0xc6, 0xd2, 0xd7,
-  0xd7, 0x27, 0x95, 0x01, 0xcb, 0x84, 0x93, 0x57, 0x37, 0x40, 0x73, 0x10,
-  0xba, 0xe2, 0x32, 0x18, 0x6f, 0x75, 0x5a, 0xd1, 0xf9, 0xd3, 0xe0, 0xaa,
-  0xe5, 0xb5, 0x32, 0x18, 0xc2, 0x21, 0xb3, 0x64, 0x7e, 0x84, 0x59, 0x0b,
-  0xaa, 0xc5, 0x01, 0xf0, 0x2d, 0x85, 0xf5, 0x44, 0x0d, 0x12, 0x07, 0xce,
-  0x43, 0x76, 0x37, 0x68, 0xb7, 0x0f, 0x40, 0x93, 0x9d, 0x8d, 0xd5, 0x56,
-  0x7b, 0x99, 0xd9, 0x10, 0x80, 0xac, 0xcd, 0x02, 0xc0, 0xb4, 0x20, 0xe4,
-  0xe3, 0x92, 0xb3, 0x67, 0xca, 0x64, 0xad, 0x50, 0x4e, 0x3a, 0xa6, 0x01,
-  0xdc, 0x6e, 0x31, 0x51, 0xbe, 0x13, 0x89, 0x2c, 0xa7, 0xac, 0xaa, 0x97,
-  0x71, 0x10, 0x0a, 0x58, 0x5b, 0x33, 0xa0, 0x25, 0x24, 0x21, 0x80, 0x6f,
-  0x29, 0x00, 0x8a, 0xab, 0x3a, 0x7b, 0x08, 0xf8, 0xed, 0x6e, 0xd0, 0x6e,
-  0x01, 0xb0, 0xdc, 0xce, 0xc6, 0x66, 0xb5, 0x84, 0x08, 0x44, 0xbc, 0xb6,
-  0x27, 0x9b, 0xd0, 0x00, 0xe9, 0x1c, 0x57, 0x9c, 0x25, 0x02, 0xa0, 0x52,
-  0x39, 0x6d, 0xf5, 0x0c, 0xc9, 0x00, 0x78, 0x28, 0x8c, 0xe7, 0x98, 0xbb,
-  0xa2, 0x8e, 0x65, 0x0b, 0xab, 0x65, 0x2c, 0x84, 0x43, 0xe2, 0xcc, 0x13,
-  0x9b, 0x40, 0x29, 0xb4, 0x04, 0x00, 0xbc, 0x39, 0x86, 0x35, 0xa9, 0x04,
-  0x5b, 0xef, 0x20, 0x00, 0x6c, 0xb5, 0x02, 0xd8, 0x2d, 0x00, 0x8e, 0xc1,
-  0xc6, 0x1c, 0x00, 0xcd, 0x8d, 0x01, 0x88, 0x78, 0xf3, 0x27, 0x76, 0xbb,
-  0x19, 0xce, 0xb0, 0xf8, 0xb8, 0x46, 0x8e, 0x58, 0x5c, 0x23, 0x13, 0xb6,
-  0xc2, 0x68, 0x6b, 0x0e, 0xb2, 0x62, 0x45, 0x2d, 0x8c, 0xcb, 0x1d, 0xe5,
-  0x3b, 0x8a, 0xe1, 0x8c, 0x09, 0x8d, 0x21, 0x2e, 0x3c, 0xa3, 0x45, 0x06,
-  0x43, 0x38, 0x74, 0x71, 0x9d, 0x32, 0x24, 0xba, 0xe6, 0xad, 0xc8, 0x6a,
-  0x6a, 0x22, 0x5e, 0x42, 0x41, 0xdb, 0x93, 0x01, 0xf9, 0x00, 0x5b, 0x0b,
-  0x0d, 0xd8, 0x2d, 0x00, 0x56, 0xd8, 0xfa, 0x22, 0x6f, 0x0a, 0x42, 0xc4,
-  0xe7, 0x48, 0xb5, 0x29, 0x9d, 0x31, 0xa0, 0x36, 0xc8, 0xcd, 0xef, 0x9a,
-  0x2b, 0x13, 0xb6, 0xc2, 0x38, 0xef, 0xb4, 0x66, 0x98, 0x55, 0x85, 0x4e,
-  0x89, 0x89, 0xf2, 0x9d, 0x17, 0x02, 0x60, 0x9a, 0x5c, 0x7b, 0xe1, 0x2c,
-  0x19, 0x0b, 0xe1, 0x1d, 0x39, 0x62, 0x71, 0x35, 0x4b, 0x56, 0xd6, 0xc3,
-  0xa8, 0x38, 0x42, 0xbf, 0x25, 0x39, 0x93, 0x19, 0x35, 0x3e, 0x66, 0xd4,
-  0xf9, 0x9d, 0x68, 0xbd, 0xa4, 0x05, 0x80, 0xad, 0xde, 0x44, 0x8d, 0x0d,
-  0x01, 0x70, 0x29, 0xfb, 0x92, 0x00, 0xfd, 0x77, 0x94, 0x82, 0x64, 0x96,
-  0xeb, 0x2f, 0x9d, 0x2d, 0x13, 0xb6, 0xe2, 0x04, 0x40, 0x4b, 0xfe, 0xf7,
-  0x15, 0x13, 0xe5, 0x21, 0xac, 0x03, 0x60, 0x20, 0xcd, 0xa9, 0xe7, 0xb4,
-  0xb2, 0x78, 0x7e, 0x95, 0x8c, 0x87, 0xf0, 0xb6, 0x5c, 0x70, 0xc6, 0x4c,
-  0x68, 0x0e, 0x49, 0x7a, 0xed, 0xb7, 0xc3, 0xb0, 0x08, 0x54, 0x79, 0xa9,
-  0x0e, 0x7b, 0x9d, 0x68, 0x7d, 0x46, 0x29, 0x0b, 0x00, 0x5b, 0x6d, 0x1e,
-  0x33, 0x9b, 0x02, 0x80, 0x83, 0x89, 0x5c, 0x86, 0x53, 0xcc, 0x3d, 0xa1,
-  0x89, 0xb3, 0x4f, 0x6e, 0x92, 0x49, 0x5b, 0x21, 0x78, 0x3d, 0x8a, 0xf3,
-  0x4e, 0x6a, 0xca, 0x87, 0x28, 0x89, 0x89, 0xf2, 0xd0, 0x8c, 0x00, 0x29,
-  0x03, 0x1a, 0xc3, 0xfc, 0xfd, 0x5f, 0x2d, 0x93, 0xc1, 0x10, 0xde, 0x96,
-  0x4b, 0xce, 0x9c, 0x09, 0x5a, 0x23, 0xbe, 0xb5, 0x6f, 0x27, 0x00, 0x34,
-  0x54, 0x79, 0x08, 0x87, 0xdc, 0x4e, 0xb4, 0x6e, 0xab, 0xc9, 0xda, 0x6e,
-  0x01, 0x60, 0xeb, 0x2b, 0xb7, 0x69, 0x86, 0xdf, 0xd1, 0x53, 0x9c, 0xce,
-  0x69, 0x08, 0x78, 0xb9, 0xfd, 0xdd, 0xf3, 0x65, 0xd2, 0x56, 0x08, 0x27,
-  0x1d, 0xd3, 0x40, 0xcb, 0x91, 0x75, 0x30, 0x26, 0xf7, 0xff, 0x05, 0xad,
-  0xda, 0xe1, 0x24, 0xb7, 0xdd, 0xbe, 0x34, 0xbf, 0xe6, 0x04, 0xe1, 0x4d,
-  0xa8, 0xaf, 0xf5, 0x71, 0xe6, 0xc9, 0x4d, 0x30, 0x2c, 0xe6, 0xff, 0xb7,
-  0xdf, 0x58, 0x34, 0x78, 0x5c, 0x93, 0xaa, 0xb3, 0xf1, 0x16, 0xcc, 0x07,
-  0x56, 0x95, 0xaa, 0x00, 0x70, 0x63, 0x73, 0x12, 0xa0, 0xe6, 0x86, 0xa0,
-  0xb3, 0x66, 0x5c, 0x05, 0x8c, 0xa4, 0xb8, 0xf6, 0xaa, 0x79, 0xd4, 0x44,
-  0xbc, 0x32, 0x71, 0x2b, 0x80, 0x2b, 0xcf, 0x6f, 0x83, 0x2a, 0x3f, 0xda,
-  0x10, 0xfb, 0x7f, 0x41, 0xef, 0xac, 0xd1, 0x0c, 0xee, 0x96, 0x30, 0x3f,
-  0xfb, 0xfa, 0x89, 0x32, 0x18, 0xc2, 0x9b, 0x72, 0xd1, 0x99, 0x33, 0xf1,
-  0x2e, 0xaa, 0x81, 0xb8, 0x88, 0xeb, 0x43, 0xd9, 0x59, 0x23, 0x55, 0x8e,
-  0xec, 0x29, 0xcb, 0x6c, 0xfe, 0x98, 0xb6, 0xb6, 0x15, 0xb1, 0x5b, 0x71,
-  0x62, 0x39, 0xfc, 0x22, 0x1f, 0xcb, 0xe0, 0x5d, 0x50, 0xc3, 0xad, 0xd7,
-  0x88, 0x15, 0xa0, 0x12, 0xb8, 0xe6, 0xfc, 0x56, 0x48, 0xc9, 0x0b, 0xaa,
-  0x70, 0xf9, 0xae, 0xe0, 0x40, 0x94, 0x0b, 0x6f, 0x5d, 0xc6, 0x3f, 0x7c,
-  0x50, 0xae, 0x02, 0x84, 0x37, 0x59, 0x5b, 0x17, 0xb6, 0xe5, 0xc5, 0xa2,
-  0x68, 0xeb, 0xb7, 0xc7, 0x02, 0x3c, 0x2e, 0x6a, 0x9c, 0x11, 0x00, 0xb6,
-  0x7a, 0xeb, 0xda, 0x29, 0x00, 0x6c, 0xff, 0xb6, 0xa1, 0xa0, 0x3b, 0x7f,
-  0x9f, 0xe2, 0xe4, 0xc9, 0x07, 0x05, 0xe9, 0x1c, 0x1f, 0xff, 0xc0, 0x52,
-  0x99, 0xb8, 0x65, 0xce, 0x31, 0x2b, 0xea, 0x98, 0x77, 0x6a, 0x0b, 0x0c,
-  0x89, 0x89, 0xb2, 0xa8, 0xb5, 0x90, 0xb3, 0x60, 0x30, 0xc9, 0x97, 0x7f,
-  0x70, 0x1a, 0x77, 0x8a, 0x08, 0x10, 0xfe, 0x1b, 0x1e, 0x8f, 0xe2, 0xb2,
-  0x4b, 0xe7, 0xc0, 0x50, 0x5a, 0x7c, 0x6b, 0x0e, 0x69, 0x67, 0x55, 0x04,
-  0x83, 0x1e, 0x27, 0x5a, 0xb6, 0xf5, 0x8e, 0xce, 0xce, 0x4f, 0x68, 0x6b,
-  0xea, 0xa3, 0x60, 0xc0, 0x4d, 0x24, 0xec, 0x71, 0x5c, 0x00, 0xa0, 0x80,
-  0xbe, 0x24, 0xf3, 0x56, 0xd5, 0xf3, 0x8d, 0xcf, 0x1c, 0xcd, 0xda, 0x17,
-  0x06, 0x70, 0xb9, 0x64, 0x86, 0x97, 0xd5, 0xc6, 0xa5, 0x35, 0x6e, 0xb7,
-  0x8b, 0x3b, 0xdf, 0xbf, 0x14, 0xac, 0x89, 0x8a, 0x8f, 0xf2, 0x1b, 0x16,
-  0xf5, 0xd2, 0xd2, 0xe3, 0x59, 0x94, 0x82, 0x6f, 0x7c, 0xff, 0x54, 0x8e,
-  0x3b, 0xb2, 0x8e, 0xdf, 0xfc, 0xa1, 0x8b, 0x9c, 0x61, 0xe1, 0x52, 0x32,
-  0x9e, 0xd3, 0x73, 0x6d, 0xe5, 0x03, 0x6a, 0xae, 0xbf, 0x7c, 0x0e, 0xbe,
-  0xc6, 0x00, 0xf4, 0xa5, 0x64, 0x50, 0x0e, 0x65, 0xd0, 0x3c, 0x2e, 0x66,
-  0xd4, 0x3a, 0x92, 0x0c, 0xc8, 0x56, 0xbf, 0x3d, 0x3b, 0x05, 0x80, 0xad,
-  0x55, 0x00, 0xc3, 0x21, 0x37, 0x21, 0xbf, 0x1b, 0xa6, 0xa0, 0x96, 0xbb,
-  0x36, 0x35, 0x6a, 0x38, 0xc3, 0x9d, 0xff, 0x78, 0x0c, 0x77, 0x9a, 0x3a,
-  0x2f, 0x0a, 0xe4, 0x7d, 0x57, 0x46, 0x0b, 0x8e, 0xfc, 0x5b, 0x2a, 0x67,
-  0xa2, 0x0f, 0xc4, 0xc0, 0xe3, 0x92, 0x31, 0x29, 0x16, 0xf7, 0x84, 0x08,
-  0x48, 0x19, 0xbc, 0xf7, 0x23, 0xcb, 0x79, 0xef, 0x07, 0x96, 0xe5, 0xd7,
-  0xa0, 0x0c, 0xe9, 0x34, 0x5e, 0x5b, 0x13, 0xff, 0xd9, 0x93, 0xcc, 0xaf,
-  0x33, 0x79, 0x37, 0x1e, 0x12, 0x96, 0x33, 0x79, 0xc8, 0xd5, 0x84, 0x08,
-  0xb0, 0xe5, 0x22, 0xc6, 0x4e, 0x01, 0x60, 0x6b, 0x10, 0x71, 0x28, 0xe0,
-  0x21, 0x14, 0xf4, 0x38, 0x93, 0x05, 0xf0, 0xcd, 0x4e, 0x3e, 0xa6, 0x46,
-  0xf5, 0x25, 0xc1, 0xed, 0x9a, 0x98, 0xf5, 0x42, 0xf9, 0xa0, 0x00, 0x8d,
-  0x36, 0xb4, 0x6c, 0xfe, 0x76, 0xad, 0x07, 0x43, 0x43, 0x57, 0x02, 0xe5,
-  0x56, 0xf9, 0x97, 0xbe, 0xac, 0x89, 0x69, 0xbd, 0xb6, 0xf2, 0x22, 0x50,
-  0x76, 0xfe, 0x43, 0x1f, 0x36, 0x45, 0x6d, 0xb5, 0x23, 0x16, 0x80, 0x2a,
-  0xf2, 0x0e, 0xf7, 0x25, 0x27, 0x00, 0x6c, 0x4d, 0x02, 0x14, 0xf0, 0xbb,
-  0x09, 0xfa, 0xdd, 0xf9, 0x92, 0xa5, 0x53, 0x34, 0xcf, 0xb5, 0x26, 0x5f,
-  0x23, 0x5d, 0x28, 0xc3, 0x63, 0x8a, 0xe0, 0xc8, 0xc8, 0x9a, 0x5a, 0xc6,
-  0x57, 0xd6, 0x96, 0x50, 0xc8, 0x88, 0x69, 0x50, 0xa8, 0xfc, 0x15, 0xb6,
-  0xfd, 0x78, 0xc9, 0x47, 0xdb, 0xd9, 0x52, 0xe8, 0xc4, 0xce, 0xe3, 0x92,
-  0xad, 0xd9, 0x74, 0x7c, 0x5e, 0x17, 0xda, 0xeb, 0x92, 0x6c, 0x6e, 0x82,
-  0x20, 0x08, 0x42, 0xd9, 0x61, 0x3a, 0x73, 0x7d, 0xed, 0xb2, 0x73, 0xdf,
-  0xb6, 0x53, 0x00, 0xcc, 0xc7, 0xc6, 0x42, 0x40, 0xd5, 0x11, 0x2f, 0xaa,
-  0xda, 0x0b, 0x39, 0x51, 0x00, 0x82, 0x20, 0x08, 0x82, 0x30, 0x41, 0xb0,
-  0x14, 0x05, 0x40, 0x9b, 0x9d, 0xdf, 0xd0, 0x30, 0xad, 0xbc, 0xf9, 0x5f,
-  0xae, 0x9d, 0x04, 0x41, 0x10, 0x84, 0x32, 0xc3, 0x72, 0xee, 0xfa, 0xda,
-  0xb6, 0xbb, 0x05, 0x3b, 0x05, 0x80, 0xad, 0x49, 0x80, 0x3c, 0x6e, 0x71,
-  0xe6, 0x12, 0x04, 0x41, 0x10, 0xca, 0x10, 0x6d, 0x51, 0x57, 0xe3, 0x58,
-  0x5a, 0x6d, 0xdb, 0x1a, 0xb6, 0x73, 0x97, 0x9d, 0x63, 0xe7, 0x37, 0x6c,
-  0xa8, 0xf7, 0xe5, 0x3d, 0xba, 0xb5, 0x38, 0xa1, 0x08, 0x82, 0x20, 0x08,
-  0xe5, 0x45, 0x28, 0xe8, 0x76, 0xaa, 0x69, 0xdb, 0x1c, 0xee, 0xed, 0x14,
-  0x00, 0xb6, 0xe6, 0x5f, 0xf5, 0xb8, 0x5d, 0x62, 0xfe, 0x17, 0x04, 0x41,
-  0x10, 0xca, 0xd3, 0x08, 0xe0, 0xdc, 0xd9, 0x35, 0x67, 0x57, 0x43, 0x76,
-  0x0a, 0x00, 0x5b, 0xed, 0x1d, 0x96, 0x25, 0x27, 0x7f, 0x41, 0x10, 0x04,
-  0xa1, 0x3c, 0xc9, 0x39, 0x17, 0x52, 0x6e, 0xdb, 0xd1, 0xd8, 0x4e, 0x01,
-  0x50, 0x23, 0x3f, 0xb9, 0x20, 0x08, 0x82, 0x30, 0xed, 0x51, 0x2e, 0x86,
-  0x47, 0x1d, 0xab, 0x49, 0xd2, 0x5c, 0x8a, 0x02, 0x40, 0x10, 0x04, 0x41,
-  0x10, 0x04, 0x1c, 0xbb, 0x02, 0x98, 0x4f, 0x89, 0xfa, 0x00, 0x94, 0xc3,
-  0xe0, 0x09, 0x82, 0x20, 0x08, 0x82, 0xf3, 0x46, 0x00, 0xe7, 0x7c, 0xd8,
-  0xd2, 0xd3, 0xc0, 0x02, 0x20, 0x0a, 0x40, 0x10, 0x04, 0x41, 0x28, 0x4f,
-  0xdc, 0xee, 0xd2, 0xf7, 0x62, 0x2f, 0x59, 0x01, 0xd0, 0x50, 0x17, 0x00,
-  0x49, 0x05, 0x2c, 0x08, 0x82, 0x20, 0x94, 0x21, 0xe9, 0xb4, 0x29, 0x02,
-  0xa0, 0x58, 0x02, 0x7e, 0xb7, 0x78, 0x28, 0x08, 0x82, 0x20, 0x08, 0x65,
-  0x45, 0xbe, 0x78, 0xa6, 0xc5, 0xd0, 0x68, 0xb6, 0xe4, 0x3f, 0x6b, 0xc9,
-  0x6e, 0xb1, 0xa6, 0xa5, 0xe5, 0x16, 0x40, 0x10, 0x04, 0x41, 0x28, 0x4b,
-  0xdc, 0xee, 0xd2, 0xff, 0x8c, 0x25, 0x2b, 0x00, 0x94, 0x24, 0x01, 0x12,
-  0x04, 0x41, 0x10, 0xca, 0xd1, 0x04, 0x60, 0x5a, 0x8c, 0x8c, 0x4d, 0x2f,
-  0x0b, 0x80, 0xad, 0x62, 0x42, 0xa2, 0x00, 0x04, 0x41, 0x10, 0x84, 0xb2,
-  0xc4, 0xd2, 0xa4, 0x33, 0x8e, 0x39, 0xb0, 0xf9, 0x4a, 0x71, 0xd3, 0x4e,
-  0xda, 0xf9, 0x0d, 0x87, 0x46, 0xd2, 0xf9, 0x52, 0xc0, 0xe2, 0x07, 0x20,
-  0x08, 0x82, 0x20, 0x94, 0x8d, 0x05, 0x00, 0x30, 0x35, 0xd1, 0x78, 0xce,
-  0x89, 0xd6, 0x3b, 0xec, 0xdc, 0x6b, 0xed, 0xdc, 0x5e, 0xc7, 0xed, 0xfc,
-  0x96, 0xd9, 0x9c, 0x25, 0x11, 0x00, 0x82, 0x20, 0x08, 0x42, 0x59, 0x0a,
-  0x80, 0x78, 0x22, 0xe7, 0x54, 0x0f, 0x3d, 0xa5, 0x28, 0x00, 0x3c, 0x76,
-  0x7e, 0x43, 0x97, 0x4b, 0x49, 0x31, 0x20, 0x41, 0x10, 0x04, 0xa1, 0xfc,
-  0x14, 0x80, 0xa5, 0x19, 0x8f, 0x39, 0x26, 0x00, 0x6c, 0x3b, 0x1a, 0xdb,
-  0x29, 0x00, 0x6c, 0xbd, 0xb5, 0x77, 0xb9, 0x64, 0xf7, 0x17, 0x04, 0x41,
-  0x10, 0xca, 0x0c, 0x97, 0x82, 0xac, 0x45, 0x2c, 0x61, 0x38, 0xd5, 0x83,
-  0x6d, 0x87, 0x6d, 0x3b, 0x05, 0xc0, 0x6e, 0x3b, 0xbf, 0xe1, 0xc8, 0x58,
-  0x16, 0x4c, 0x2d, 0xe1, 0x00, 0x82, 0x20, 0x08, 0x42, 0xf9, 0xe0, 0x51,
-  0x10, 0x37, 0x48, 0xa5, 0x1c, 0x4b, 0x04, 0x64, 0xdb, 0x75, 0xbb, 0x9d,
-  0x02, 0xc0, 0xd6, 0x1b, 0xfb, 0x54, 0xda, 0xcc, 0x87, 0x02, 0x48, 0x34,
-  0x80, 0x20, 0x08, 0x82, 0x50, 0x2e, 0xb8, 0x15, 0xa9, 0x94, 0x41, 0x22,
-  0xe5, 0x98, 0x05, 0xc0, 0xb6, 0x32, 0x83, 0x76, 0x0a, 0x80, 0x21, 0x3b,
-  0xbf, 0xa1, 0x69, 0x6a, 0xc8, 0x69, 0x89, 0x02, 0x10, 0x04, 0x41, 0x10,
-  0xca, 0x48, 0x00, 0xb8, 0x88, 0x27, 0x0d, 0xe2, 0x49, 0xc7, 0x04, 0x40,
-  0x49, 0xfa, 0x00, 0xec, 0x25, 0x1f, 0xa2, 0x60, 0x0b, 0xf1, 0x84, 0x01,
-  0x09, 0x23, 0x5f, 0x0f, 0x40, 0x10, 0x04, 0x41, 0x10, 0xca, 0x01, 0x8f,
-  0x22, 0x91, 0x32, 0x9c, 0x0a, 0x03, 0x04, 0x48, 0x95, 0xa2, 0x00, 0x18,
-  0xb4, 0xf3, 0x1b, 0xa6, 0xb3, 0x26, 0xe9, 0x8c, 0x99, 0x77, 0xa8, 0x10,
-  0x04, 0x41, 0x10, 0x84, 0x72, 0xc0, 0xeb, 0x22, 0x1a, 0x33, 0x30, 0x0c,
-  0x47, 0xee, 0xaf, 0x2d, 0xc0, 0x36, 0x65, 0x61, 0xa7, 0x00, 0x88, 0xda,
-  0xf9, 0x2d, 0x63, 0x89, 0x5c, 0x3e, 0x8e, 0xd2, 0x2d, 0x16, 0x00, 0x41,
-  0x10, 0x04, 0xa1, 0x7c, 0x2c, 0x00, 0x0e, 0x86, 0x00, 0xe6, 0x4a, 0x55,
-  0x00, 0x24, 0x6c, 0x15, 0x00, 0x71, 0x83, 0x44, 0xca, 0xcc, 0x7b, 0x54,
-  0x0a, 0x82, 0x20, 0x08, 0x42, 0x39, 0xa0, 0x14, 0xa3, 0x31, 0xc7, 0xea,
-  0x00, 0xc4, 0x01, 0xdb, 0x9c, 0x0b, 0xec, 0x14, 0x00, 0x63, 0x76, 0x7e,
-  0xcb, 0x6c, 0xce, 0x22, 0x16, 0xcf, 0x81, 0x47, 0x2c, 0x00, 0x82, 0x20,
-  0x08, 0x42, 0xb9, 0x08, 0x00, 0x18, 0x1d, 0xcd, 0x38, 0xd5, 0xba, 0xc6,
-  0xc6, 0xd8, 0x38, 0x3b, 0x77, 0xd7, 0xb4, 0xdd, 0xdf, 0x34, 0x1a, 0x37,
-  0xc4, 0x02, 0x20, 0x08, 0x82, 0x20, 0x94, 0x0f, 0x2e, 0x18, 0x1a, 0x75,
-  0xcc, 0x02, 0x60, 0xd9, 0xfc, 0x51, 0xed, 0x3b, 0xb4, 0xdb, 0xfd, 0x4d,
-  0x87, 0xc7, 0x32, 0x92, 0x08, 0x48, 0x10, 0x04, 0x41, 0x28, 0x2b, 0x05,
-  0xd0, 0x37, 0x94, 0x76, 0xaa, 0xf1, 0x8c, 0xbd, 0x9f, 0xd4, 0x5e, 0x01,
-  0x60, 0xab, 0x3a, 0x19, 0x1e, 0xcd, 0x48, 0x1e, 0x00, 0x41, 0x10, 0x04,
-  0xa1, 0xac, 0x18, 0x19, 0x73, 0xcc, 0x02, 0xd0, 0x5d, 0xaa, 0x02, 0xc0,
-  0xc2, 0xe6, 0x8a, 0x80, 0x7d, 0x83, 0x69, 0x11, 0x00, 0x82, 0x20, 0x08,
-  0x42, 0x59, 0xa0, 0x3c, 0x0a, 0x52, 0x39, 0x86, 0x46, 0x1c, 0xf3, 0x01,
-  0xd8, 0x59, 0xaa, 0x02, 0x00, 0xc0, 0xd6, 0xe4, 0xc7, 0x7d, 0x83, 0xe9,
-  0xfc, 0x47, 0x94, 0x74, 0xc0, 0x82, 0x20, 0x08, 0x42, 0xa9, 0xe3, 0x76,
-  0x41, 0xc2, 0xc8, 0x5b, 0xaf, 0xed, 0xa7, 0x03, 0xd8, 0x5a, 0xca, 0x02,
-  0xc0, 0xd6, 0x2b, 0x80, 0xfe, 0xa1, 0x34, 0x18, 0x16, 0xca, 0x2d, 0xf3,
-  0x4a, 0x10, 0x04, 0x41, 0x28, 0x75, 0x01, 0xa0, 0x20, 0x61, 0x30, 0x30,
-  0xec, 0x98, 0x05, 0x60, 0xbf, 0x9d, 0x8d, 0x79, 0x6c, 0xfe, 0x70, 0xb6,
-  0x7a, 0x3e, 0xf4, 0x0f, 0xa5, 0x21, 0x9e, 0xcd, 0x87, 0x02, 0x66, 0xad,
-  0xc3, 0xfe, 0xdb, 0x2a, 0x8f, 0x0b, 0xc4, 0x27, 0x51, 0x10, 0x84, 0x4a,
-  0xc3, 0xb0, 0xd0, 0x62, 0x69, 0xb5, 0x61, 0x47, 0x75, 0x91, 0x48, 0x64,
-  0xf2, 0x7b, 0x97, 0x33, 0x8c, 0x94, 0xb2, 0x00, 0xd8, 0x0e, 0x9c, 0x69,
-  0x57, 0x63, 0x7d, 0x83, 0x69, 0x88, 0xbd, 0x51, 0x0f, 0xe0, 0x30, 0x0a,
-  0x00, 0x43, 0xa3, 0x6a, 0x7d, 0xe0, 0x73, 0x81, 0x25, 0xab, 0x44, 0x10,
-  0x84, 0x0a, 0x42, 0x4d, 0xbc, 0x5e, 0x47, 0x32, 0xf9, 0x13, 0xac, 0x50,
-  0x3c, 0x7e, 0x17, 0x7d, 0x83, 0x69, 0x27, 0xeb, 0x00, 0xd8, 0x9a, 0x71,
-  0xd7, 0x6e, 0x01, 0xb0, 0x91, 0xfc, 0x3d, 0xc5, 0x7c, 0x3b, 0x1a, 0x3b,
-  0xd8, 0x97, 0x24, 0x19, 0xcb, 0x11, 0x6a, 0x0e, 0xda, 0x58, 0xfe, 0xa0,
-  0x88, 0xf5, 0xd1, 0x1c, 0x60, 0xeb, 0x86, 0x01, 0x3e, 0xfe, 0x85, 0x4d,
-  0x24, 0x9d, 0x2b, 0xf1, 0x28, 0x08, 0x82, 0x30, 0xf5, 0x87, 0x56, 0xb7,
-  0xe2, 0x3b, 0xff, 0xbc, 0x9a, 0x63, 0xce, 0x6d, 0x43, 0xf7, 0x24, 0xc5,
-  0xca, 0x39, 0x19, 0x7c, 0x2e, 0x06, 0x86, 0x1d, 0x3b, 0xfd, 0x67, 0xb1,
-  0x39, 0xe3, 0xae, 0xdd, 0x02, 0x60, 0x8b, 0xad, 0x52, 0x27, 0x6e, 0x70,
-  0xb0, 0x3f, 0xc9, 0xe2, 0x39, 0xe1, 0xc3, 0xfb, 0xa3, 0x56, 0xfb, 0x79,
-  0x6c, 0x6d, 0x2f, 0x4f, 0xaf, 0xef, 0x97, 0x09, 0x2e, 0x08, 0x42, 0xc5,
-  0xf1, 0xf7, 0x5f, 0xde, 0xcc, 0x9a, 0x8b, 0x67, 0xa3, 0x3c, 0x0a, 0x6d,
-  0x8a, 0x95, 0xb3, 0x68, 0xbc, 0x1e, 0x7a, 0x06, 0x1c, 0x3b, 0xad, 0x66,
-  0xb0, 0xb1, 0x0e, 0x00, 0xd8, 0xef, 0x04, 0x38, 0x64, 0xf7, 0x37, 0x3e,
-  0xd0, 0x93, 0x84, 0xc0, 0x61, 0xf6, 0x02, 0xd4, 0x16, 0xe1, 0x90, 0x47,
-  0x26, 0xb7, 0x20, 0x08, 0x15, 0xc9, 0x53, 0xeb, 0xfb, 0x39, 0xb8, 0x61,
-  0x00, 0x66, 0x04, 0x64, 0x30, 0x26, 0x83, 0x52, 0x1c, 0xec, 0x73, 0x54,
-  0x00, 0xd8, 0x8a, 0xdd, 0x02, 0x60, 0xd4, 0x11, 0x01, 0xe0, 0xf1, 0x94,
-  0xc2, 0xef, 0x2a, 0x08, 0x82, 0x50, 0x91, 0x68, 0x0d, 0xf7, 0x3c, 0x7c,
-  0x00, 0xc2, 0x7e, 0x09, 0xbb, 0x2e, 0x76, 0x8f, 0x70, 0x29, 0x30, 0x4d,
-  0xba, 0x7b, 0x93, 0x4e, 0x75, 0x61, 0xbb, 0x63, 0x81, 0xdd, 0x02, 0x20,
-  0x86, 0xcd, 0x29, 0x81, 0x0f, 0xf4, 0x24, 0x41, 0x5b, 0xb2, 0x01, 0x0b,
-  0x82, 0x20, 0x38, 0xc8, 0x4f, 0x7e, 0xdd, 0x01, 0xa3, 0x29, 0x54, 0x40,
-  0xe2, 0xae, 0x8b, 0x53, 0x00, 0x40, 0xce, 0xa4, 0xbb, 0xcf, 0x31, 0x01,
-  0x60, 0xfb, 0x1d, 0xb4, 0x13, 0x89, 0x80, 0x6c, 0xf5, 0x80, 0xd8, 0xd5,
-  0x11, 0x83, 0xac, 0x29, 0x47, 0x70, 0x41, 0x10, 0x04, 0x07, 0xd9, 0xb9,
-  0x37, 0xca, 0x96, 0x75, 0x7d, 0xd0, 0x14, 0x14, 0x2b, 0x40, 0x51, 0xbb,
-  0xa9, 0x82, 0x94, 0x49, 0xe7, 0xc1, 0x84, 0x13, 0xad, 0x77, 0x00, 0x7f,
-  0x2c, 0x75, 0x01, 0x80, 0xdd, 0x16, 0x80, 0xbd, 0x9d, 0x71, 0x48, 0x1a,
-  0x12, 0x9e, 0x22, 0x08, 0x82, 0xe0, 0x30, 0xf7, 0xfc, 0xe1, 0x00, 0x78,
-  0xdc, 0x72, 0xde, 0x2a, 0x06, 0xbf, 0x1b, 0x63, 0x28, 0x43, 0x4f, 0xbf,
-  0x63, 0x51, 0x00, 0x2f, 0x96, 0x83, 0x00, 0xb0, 0xd5, 0xfe, 0xb1, 0xbf,
-  0x3b, 0x41, 0xb2, 0x37, 0x09, 0x41, 0x71, 0xc2, 0x13, 0x04, 0x41, 0x70,
-  0x92, 0xff, 0xf7, 0xd0, 0x01, 0xe8, 0x89, 0x83, 0x38, 0x3d, 0x17, 0x4e,
-  0xc0, 0x4d, 0xef, 0x60, 0x8a, 0x83, 0xce, 0x5d, 0x01, 0x74, 0xdb, 0xdd,
-  0xa0, 0x13, 0x02, 0x60, 0xbb, 0x9d, 0x8d, 0xf5, 0x0f, 0xa5, 0xf3, 0x7e,
-  0x00, 0x21, 0xb9, 0x97, 0x12, 0x04, 0x41, 0x70, 0x92, 0xce, 0x83, 0x49,
-  0xd6, 0xaf, 0xeb, 0x83, 0x06, 0x89, 0x06, 0x28, 0x46, 0x00, 0x74, 0xf5,
-  0xa6, 0xc8, 0x19, 0x8e, 0xdd, 0x9f, 0xd8, 0xee, 0x64, 0xef, 0x84, 0x00,
-  0xf8, 0x03, 0xf9, 0xfb, 0x0a, 0xdb, 0xd8, 0xd3, 0x19, 0x07, 0xbf, 0x08,
-  0x00, 0x41, 0x10, 0x04, 0xa7, 0xf9, 0xfd, 0xd3, 0x3d, 0xe0, 0x76, 0x8b,
-  0x1f, 0x40, 0xa1, 0x78, 0x14, 0x1d, 0x5d, 0x71, 0xa7, 0x5a, 0x8f, 0xe2,
-  0x40, 0x3a, 0x3c, 0x27, 0x04, 0x40, 0xbb, 0xdd, 0x0d, 0xee, 0xd8, 0x13,
-  0x05, 0x97, 0x54, 0x05, 0x14, 0x04, 0x41, 0x70, 0x5c, 0x00, 0xac, 0xe9,
-  0x81, 0xa1, 0xa4, 0x44, 0x03, 0x14, 0x82, 0x06, 0x94, 0x8b, 0xdd, 0x9d,
-  0x8e, 0x09, 0x80, 0xac, 0x13, 0x8d, 0x3a, 0x21, 0x00, 0x6c, 0x0f, 0x55,
-  0xd8, 0xd6, 0x3e, 0x0e, 0x5a, 0xe7, 0xe3, 0x2c, 0x05, 0x41, 0x10, 0x04,
-  0xc7, 0x68, 0xdf, 0x17, 0x65, 0xeb, 0x8b, 0x83, 0x72, 0x0d, 0x50, 0x00,
-  0xca, 0x05, 0x68, 0xcd, 0xbe, 0x4e, 0x47, 0x2d, 0x00, 0x65, 0x21, 0x00,
-  0x12, 0xd8, 0x6c, 0xaa, 0x78, 0x7d, 0x4f, 0x14, 0x86, 0xd3, 0xf9, 0x62,
-  0x3c, 0x87, 0xe5, 0xd7, 0x55, 0xc4, 0x9c, 0x2b, 0xee, 0x20, 0x08, 0x82,
-  0x50, 0x52, 0x3c, 0xb4, 0xb6, 0x07, 0x7c, 0x1e, 0x29, 0x0b, 0x70, 0xa8,
-  0xf8, 0xdc, 0x30, 0x92, 0x66, 0x4f, 0x67, 0xcc, 0x89, 0xd6, 0x3b, 0x80,
-  0xc7, 0x9d, 0x68, 0xd8, 0x09, 0x57, 0x4f, 0x0b, 0x9b, 0x0b, 0x16, 0x6c,
-  0xdf, 0x3d, 0x4e, 0xac, 0x27, 0x49, 0x64, 0x56, 0x18, 0x32, 0xe6, 0xd4,
-  0xff, 0xb8, 0x19, 0x93, 0x23, 0x96, 0xd6, 0xd0, 0xdc, 0x10, 0x20, 0x93,
-  0x35, 0x71, 0x17, 0x18, 0x92, 0xe8, 0x73, 0xb9, 0x18, 0x8d, 0xe7, 0x48,
-  0x1f, 0x8e, 0xcf, 0x2e, 0x08, 0x82, 0x50, 0x20, 0x8f, 0x3e, 0xd3, 0xc7,
-  0xa7, 0x63, 0x99, 0x7c, 0x29, 0x76, 0xc3, 0x92, 0x01, 0x79, 0xe7, 0x97,
-  0x3c, 0xc6, 0x70, 0x86, 0xdd, 0x1d, 0x8e, 0x59, 0x00, 0x9e, 0x2c, 0x17,
-  0x01, 0x00, 0x36, 0x27, 0x03, 0x4a, 0xa5, 0x4d, 0x5e, 0xdf, 0x17, 0xe5,
-  0x84, 0x65, 0xb5, 0x30, 0x9e, 0x9d, 0xf2, 0xdf, 0x56, 0xf7, 0x24, 0xb9,
-  0xf4, 0xc2, 0xd9, 0xec, 0x3c, 0xb6, 0x91, 0x4c, 0xa6, 0x08, 0x01, 0x30,
-  0x37, 0xc2, 0x67, 0x3f, 0xf9, 0x22, 0xdf, 0xf9, 0xc9, 0x2e, 0x59, 0x28,
-  0x82, 0x20, 0x94, 0x3c, 0x2f, 0xbd, 0x36, 0xcc, 0xc0, 0xce, 0x31, 0x9a,
-  0x96, 0xd6, 0xc0, 0x70, 0x46, 0x06, 0xe4, 0x9d, 0x08, 0xba, 0xe9, 0xe8,
-  0x4e, 0x30, 0x34, 0xea, 0xd8, 0x58, 0x75, 0x3b, 0xd1, 0xa8, 0x53, 0x02,
-  0xe0, 0x79, 0x60, 0x16, 0x36, 0x95, 0x05, 0x06, 0xd8, 0xd2, 0x3e, 0xce,
-  0x09, 0x57, 0x1d, 0xa6, 0xd8, 0x54, 0xad, 0x21, 0x67, 0x51, 0x3b, 0x2b,
-  0x9c, 0x4f, 0x48, 0x54, 0xa8, 0x20, 0xae, 0x8b, 0xb0, 0x60, 0x76, 0x58,
-  0x16, 0x89, 0x20, 0x08, 0x65, 0x41, 0x36, 0x67, 0xf1, 0xc7, 0x17, 0x07,
-  0xb9, 0xee, 0xf8, 0x46, 0x18, 0xca, 0x48, 0x89, 0xe0, 0x77, 0x22, 0xec,
-  0x63, 0xfb, 0x9e, 0xa8, 0x63, 0x3f, 0x07, 0x30, 0x5c, 0x4e, 0x02, 0xe0,
-  0x41, 0xe0, 0x3a, 0x7b, 0x15, 0xe9, 0x08, 0xb7, 0x9b, 0x26, 0x4a, 0xe5,
-  0xf7, 0xe3, 0x29, 0x45, 0x29, 0xb4, 0xa5, 0x8b, 0xb6, 0x3e, 0xa8, 0x1a,
-  0x2f, 0xd5, 0x55, 0xde, 0xa2, 0xbb, 0x6f, 0xf5, 0x46, 0xf0, 0x2b, 0x0f,
-  0xa6, 0x16, 0x53, 0x9c, 0x20, 0x08, 0x87, 0xf8, 0x72, 0x57, 0x2e, 0x92,
-  0x56, 0x8e, 0x3e, 0xa3, 0x38, 0xb3, 0xf4, 0xda, 0x17, 0x06, 0xb8, 0xee,
-  0x8e, 0x23, 0x64, 0xf3, 0x7f, 0xe7, 0xed, 0x01, 0xc8, 0xa7, 0x52, 0x76,
-  0x88, 0x18, 0x85, 0x1f, 0x3b, 0x0f, 0xab, 0x00, 0xd8, 0x67, 0x77, 0x83,
-  0xaf, 0xed, 0x18, 0x85, 0xb1, 0x0c, 0x78, 0xdc, 0x90, 0x2b, 0xb3, 0xbb,
-  0x74, 0x0d, 0x8d, 0x33, 0xfc, 0x45, 0x3f, 0xfe, 0xbe, 0xda, 0xa3, 0x59,
-  0xe8, 0xab, 0x67, 0xdc, 0x12, 0x53, 0x9c, 0x20, 0x08, 0x87, 0x86, 0x5f,
-  0xb9, 0xc9, 0x69, 0x93, 0x2f, 0x0d, 0x3e, 0xcb, 0xa0, 0x51, 0x78, 0x76,
-  0xba, 0x35, 0xeb, 0xfa, 0xa0, 0x2f, 0x89, 0x0a, 0xba, 0xd1, 0x29, 0xf1,
-  0x5f, 0x7a, 0x5b, 0x05, 0x90, 0x33, 0xd8, 0xbe, 0xcb, 0x31, 0x01, 0xe0,
-  0x58, 0x6a, 0x41, 0xa7, 0x04, 0xc0, 0x30, 0x36, 0xc7, 0x2d, 0x6e, 0xdb,
-  0x35, 0xce, 0xf0, 0xfe, 0x38, 0x33, 0x16, 0x55, 0xc3, 0x48, 0x99, 0x4d,
-  0x46, 0x4b, 0xd3, 0x58, 0x5f, 0x7c, 0x48, 0x4d, 0x4a, 0x1b, 0x68, 0x05,
-  0x16, 0x62, 0x01, 0x10, 0x04, 0xe1, 0x50, 0xdf, 0x1b, 0x16, 0x4d, 0x9e,
-  0x2a, 0x56, 0x07, 0x5a, 0x79, 0x3c, 0xbe, 0xa7, 0xe0, 0xe7, 0xf7, 0x76,
-  0xc6, 0xd9, 0xbb, 0x63, 0x94, 0x85, 0x27, 0x35, 0x41, 0x2a, 0x25, 0x03,
-  0xfa, 0x96, 0xbb, 0xa8, 0x82, 0xb1, 0x1c, 0x3b, 0xf6, 0x8c, 0x3b, 0xd1,
-  0x7a, 0x07, 0x0e, 0x39, 0x00, 0x3a, 0x29, 0x00, 0x0c, 0x6c, 0x8e, 0x04,
-  0x48, 0xa5, 0x4d, 0x36, 0xbd, 0x3e, 0xc6, 0x79, 0x47, 0xcf, 0x80, 0x91,
-  0x32, 0x3b, 0x09, 0x67, 0x2c, 0xea, 0x6b, 0xbd, 0x45, 0x5f, 0x5f, 0x8c,
-  0x9b, 0x69, 0x4c, 0x6d, 0x91, 0x93, 0x2b, 0x00, 0x41, 0x10, 0x0a, 0x20,
-  0x6e, 0x65, 0x59, 0x19, 0x6c, 0x2e, 0x4a, 0x00, 0x00, 0x3c, 0xf3, 0xca,
-  0x10, 0x0b, 0xcf, 0x99, 0x85, 0x03, 0x49, 0xe8, 0x2a, 0x87, 0x2a, 0x2f,
-  0x43, 0xbb, 0xc6, 0xf3, 0xe1, 0xea, 0xce, 0xf0, 0x5b, 0xa7, 0x1a, 0x76,
-  0x32, 0xb0, 0xde, 0xf6, 0x19, 0xb3, 0x69, 0xfb, 0x68, 0x79, 0xa6, 0xa8,
-  0xcc, 0x98, 0xcc, 0xac, 0x0f, 0xd0, 0x54, 0x64, 0x62, 0x8d, 0xb8, 0x95,
-  0x95, 0x45, 0x26, 0x08, 0x42, 0xe1, 0xef, 0x0e, 0x33, 0xcb, 0x5c, 0x6f,
-  0x2d, 0xb3, 0xbc, 0xd5, 0x45, 0x3d, 0xbf, 0xee, 0x95, 0x41, 0x98, 0xf0,
-  0xbd, 0x12, 0xde, 0x82, 0x90, 0x87, 0x9d, 0x9d, 0x71, 0x52, 0x69, 0xc7,
-  0x2c, 0xd3, 0x07, 0xca, 0x51, 0x00, 0xac, 0xc1, 0xe6, 0x9a, 0x00, 0x2f,
-  0x6e, 0x1e, 0x06, 0xc3, 0x44, 0x95, 0x5b, 0x69, 0xe0, 0xac, 0x49, 0x55,
-  0x43, 0x80, 0xc6, 0xba, 0xe2, 0xfc, 0x00, 0x12, 0x56, 0x0e, 0x97, 0xac,
-  0x40, 0x41, 0x10, 0x0a, 0xc4, 0xc0, 0x22, 0xec, 0xf6, 0x72, 0x44, 0xa0,
-  0xa9, 0xa8, 0xe7, 0x5f, 0xda, 0x3c, 0x02, 0x83, 0xe9, 0x7c, 0xa2, 0x1b,
-  0xe1, 0x2f, 0xd1, 0x80, 0xd7, 0xcd, 0xe6, 0x1d, 0xa3, 0x4e, 0xf5, 0x30,
-  0x4e, 0xde, 0x09, 0xb0, 0xec, 0x04, 0xc0, 0xc3, 0x76, 0x37, 0xb8, 0x61,
-  0xe3, 0x30, 0x1c, 0x4c, 0x40, 0xb0, 0xcc, 0x26, 0xa3, 0x61, 0x41, 0xc4,
-  0x4b, 0x6b, 0x4b, 0xb0, 0xa8, 0xc7, 0x63, 0x56, 0x06, 0x97, 0xb8, 0xe2,
-  0x0a, 0x82, 0x50, 0x20, 0x0a, 0x48, 0x5b, 0x06, 0x4b, 0xfc, 0x33, 0x8a,
-  0x7a, 0xbe, 0x7d, 0x5f, 0x94, 0x83, 0xfb, 0xa2, 0x50, 0xed, 0x95, 0xc1,
-  0x7c, 0xab, 0x01, 0x46, 0xf3, 0xda, 0x8e, 0x31, 0xc7, 0x8e, 0x8f, 0x4e,
-  0x7e, 0x7c, 0x27, 0x05, 0xc0, 0x1e, 0xbb, 0x1b, 0xec, 0xe9, 0x4f, 0xb1,
-  0xfd, 0xf5, 0x31, 0xa8, 0xf6, 0x95, 0x9f, 0x4a, 0x0c, 0xb8, 0x98, 0x3f,
-  0xbb, 0xaa, 0xa8, 0xc7, 0xa3, 0x56, 0x1a, 0x03, 0x4b, 0x24, 0x80, 0x20,
-  0x08, 0x05, 0x13, 0xb7, 0xb2, 0xcc, 0xf3, 0xd6, 0xd2, 0xe4, 0x29, 0xfc,
-  0xfd, 0x63, 0x18, 0x9a, 0x8d, 0x3b, 0x46, 0x21, 0xec, 0x91, 0x81, 0x7c,
-  0xb3, 0xfd, 0xdf, 0xef, 0x86, 0xa1, 0x34, 0xaf, 0x6e, 0x73, 0xc4, 0x02,
-  0xd0, 0x01, 0xbc, 0x52, 0xae, 0x02, 0xc0, 0x11, 0xd3, 0xc5, 0x8b, 0x5b,
-  0x46, 0x20, 0x50, 0x66, 0x6a, 0xd4, 0xd2, 0xe0, 0xf5, 0x30, 0xaf, 0x2d,
-  0x54, 0x9c, 0x00, 0x30, 0xb3, 0xa4, 0x2c, 0x03, 0xb7, 0x72, 0xc9, 0x8a,
-  0x13, 0x04, 0xa1, 0xb0, 0x4d, 0x5c, 0x5b, 0x54, 0xbb, 0x03, 0x2c, 0xf4,
-  0xd5, 0x15, 0xf5, 0xfc, 0x86, 0xd7, 0x46, 0xf2, 0xd5, 0x6e, 0xa4, 0x1a,
-  0xeb, 0x5f, 0x12, 0xf2, 0x30, 0x7a, 0x20, 0xc1, 0xb6, 0x5d, 0xe3, 0x4e,
-  0xf5, 0xf0, 0xe3, 0x72, 0x15, 0x00, 0x60, 0x73, 0x4a, 0x60, 0xf8, 0xef,
-  0x4e, 0x29, 0xe5, 0x73, 0x1e, 0x7e, 0xc3, 0xf3, 0x7f, 0xd1, 0xbc, 0x48,
-  0x51, 0xcf, 0x8f, 0x99, 0x29, 0xd2, 0x96, 0x81, 0x5b, 0x6c, 0x00, 0x82,
-  0x20, 0x14, 0x73, 0x52, 0x05, 0x16, 0xfa, 0xea, 0x8b, 0x7a, 0x76, 0x7b,
-  0xfb, 0x38, 0x64, 0x4d, 0x94, 0x47, 0xde, 0x3f, 0x7f, 0x41, 0xb5, 0x97,
-  0x97, 0xb7, 0x8f, 0x90, 0xcb, 0x39, 0x12, 0xa1, 0x95, 0x05, 0x1c, 0xcd,
-  0x1f, 0xef, 0xb4, 0x00, 0xd8, 0x85, 0xcd, 0x8e, 0x80, 0xeb, 0x5e, 0x19,
-  0x82, 0xfe, 0x14, 0x04, 0xca, 0xec, 0x34, 0x9c, 0xca, 0xb1, 0x64, 0x5e,
-  0x71, 0x57, 0x00, 0xe3, 0x66, 0x86, 0xb8, 0x95, 0x15, 0x0b, 0x80, 0x20,
-  0x08, 0x45, 0x91, 0xb0, 0xb2, 0xcc, 0xf5, 0xd5, 0x14, 0xe5, 0x4b, 0xb4,
-  0xad, 0x7d, 0x0c, 0xfa, 0x93, 0xe0, 0x17, 0x47, 0xc0, 0x3f, 0x13, 0x55,
-  0x0a, 0x70, 0xb9, 0xd8, 0xfc, 0xba, 0x63, 0xa7, 0xff, 0x1c, 0x0e, 0x3a,
-  0x00, 0x4e, 0x85, 0x00, 0xf8, 0x57, 0xbb, 0x1b, 0xdc, 0xdd, 0x11, 0x63,
-  0xe7, 0xb6, 0x51, 0xa8, 0xf1, 0x97, 0xd7, 0x6c, 0x49, 0x1a, 0x2c, 0x9d,
-  0x17, 0xa1, 0x26, 0x52, 0xf8, 0xf5, 0x85, 0x85, 0x66, 0xcc, 0x4c, 0xe1,
-  0x45, 0x16, 0xa0, 0x20, 0x08, 0x85, 0x93, 0xd1, 0x26, 0x0d, 0x9e, 0x30,
-  0x33, 0xbd, 0x85, 0x5b, 0x21, 0xf7, 0x75, 0x25, 0xe8, 0xea, 0x8c, 0x43,
-  0x48, 0xde, 0x3f, 0x7f, 0xa1, 0x00, 0xb2, 0x06, 0x2f, 0x6f, 0x19, 0x76,
-  0xaa, 0x87, 0x84, 0xd3, 0x5f, 0xc1, 0x69, 0x01, 0xb0, 0x1b, 0x07, 0xbc,
-  0x18, 0xd7, 0xbe, 0x32, 0x08, 0x41, 0x6f, 0x79, 0xdd, 0x49, 0xa5, 0x2d,
-  0xfc, 0xcd, 0x41, 0x56, 0x2c, 0x2e, 0x2e, 0x1e, 0x77, 0xc4, 0x4c, 0xe3,
-  0x77, 0xc9, 0x02, 0x14, 0x04, 0xa1, 0x70, 0x0c, 0x6d, 0x51, 0xe5, 0xf2,
-  0x15, 0x9d, 0x0f, 0x60, 0xfb, 0x9e, 0x28, 0x84, 0x7d, 0x32, 0x90, 0xff,
-  0x1d, 0xbf, 0x1b, 0xfa, 0xd3, 0x6c, 0x74, 0xce, 0x01, 0xf0, 0xd1, 0x72,
-  0x17, 0x00, 0xa3, 0xe4, 0xcd, 0x18, 0xb6, 0xf2, 0xf4, 0xfa, 0xfe, 0xbc,
-  0x1f, 0x40, 0x19, 0xe5, 0x03, 0xd0, 0x59, 0x13, 0xea, 0xfd, 0x1c, 0xb1,
-  0xa4, 0xa6, 0xa8, 0xe7, 0x87, 0x8c, 0x84, 0xf8, 0xe0, 0x08, 0x82, 0x30,
-  0x99, 0xb7, 0x10, 0x6d, 0x45, 0x0a, 0x80, 0xf6, 0x8e, 0x18, 0xb8, 0x24,
-  0x18, 0xf9, 0xcf, 0xa8, 0xf1, 0xb2, 0xab, 0x7d, 0x8c, 0xbd, 0x9d, 0x71,
-  0xa7, 0x7a, 0xb8, 0xb7, 0xdc, 0x05, 0x00, 0x38, 0x60, 0xc6, 0x78, 0x7a,
-  0x7d, 0x3f, 0x56, 0x67, 0x0c, 0x42, 0x9e, 0x72, 0x5a, 0x7b, 0x80, 0x62,
-  0xd5, 0xb2, 0xda, 0xa2, 0x1e, 0x1f, 0x34, 0x93, 0x64, 0xb5, 0x29, 0xf9,
-  0x00, 0x04, 0x41, 0x28, 0xda, 0x0a, 0x30, 0xd3, 0x53, 0x9c, 0x1f, 0xd2,
-  0xce, 0xbd, 0x31, 0xc8, 0x19, 0x53, 0xb3, 0x63, 0x94, 0xcb, 0xfb, 0x3c,
-  0xe8, 0xe1, 0xe5, 0x6d, 0x8e, 0x25, 0x00, 0xca, 0x02, 0x9d, 0x95, 0x20,
-  0x00, 0x9e, 0xc3, 0x66, 0x47, 0xc0, 0xe1, 0xd1, 0x2c, 0x2f, 0x6e, 0x1c,
-  0x86, 0xba, 0x32, 0xf2, 0x03, 0x50, 0x80, 0x61, 0xb2, 0x72, 0x59, 0xf1,
-  0x16, 0x80, 0x8c, 0x65, 0x48, 0x4a, 0x4e, 0x41, 0x10, 0x8a, 0x22, 0xad,
-  0x4d, 0x1a, 0xdc, 0x21, 0x82, 0xae, 0xc2, 0x0f, 0x4e, 0xbb, 0xf6, 0x45,
-  0x21, 0x65, 0x80, 0x4b, 0x14, 0xc0, 0x9f, 0xde, 0xe7, 0x28, 0x36, 0x6c,
-  0x72, 0xec, 0xfe, 0x3f, 0x06, 0x38, 0x5e, 0xf4, 0x66, 0x2a, 0x7e, 0x4d,
-  0x47, 0xe2, 0x18, 0xd7, 0xac, 0xef, 0x07, 0x4f, 0x99, 0x05, 0xc6, 0x25,
-  0x0c, 0x8e, 0x5a, 0x5c, 0x4b, 0x55, 0x11, 0x49, 0x35, 0x86, 0xcc, 0x24,
-  0x63, 0x66, 0x0a, 0xbf, 0x92, 0x84, 0x1c, 0x82, 0x20, 0x14, 0x71, 0xa4,
-  0xd4, 0x06, 0x75, 0x9e, 0x20, 0x8d, 0xee, 0x70, 0xc1, 0xcf, 0x76, 0xf6,
-  0x24, 0xb1, 0x86, 0x33, 0xe0, 0x13, 0x01, 0x00, 0x13, 0x09, 0x80, 0x46,
-  0xd2, 0xac, 0x7f, 0x75, 0xc8, 0x89, 0xe6, 0x3b, 0x80, 0xee, 0xa9, 0xf8,
-  0x1e, 0x53, 0xf1, 0x6b, 0xee, 0xc1, 0x01, 0x47, 0xc0, 0x47, 0xd7, 0xf6,
-  0xc2, 0x78, 0x0a, 0xbc, 0x65, 0x34, 0x21, 0x63, 0x39, 0xea, 0xe6, 0x86,
-  0x59, 0xbe, 0xa8, 0xf0, 0x7b, 0xb8, 0xb4, 0x65, 0x30, 0x68, 0x26, 0x45,
-  0x00, 0x08, 0x82, 0x50, 0x14, 0x96, 0x06, 0x9f, 0x72, 0xd3, 0xe0, 0x29,
-  0x5c, 0x00, 0x74, 0xf5, 0x26, 0xe9, 0xe9, 0x4d, 0x96, 0xd7, 0xb5, 0xab,
-  0x93, 0x44, 0xbc, 0xf4, 0xed, 0x1a, 0xcf, 0x17, 0xa8, 0x73, 0x86, 0xaf,
-  0x55, 0x8a, 0x00, 0xc8, 0x01, 0xb6, 0xd7, 0x49, 0x7c, 0x79, 0xcb, 0x08,
-  0x3d, 0x3b, 0xc6, 0xa0, 0xb6, 0x8c, 0xae, 0x01, 0x0c, 0x0b, 0xea, 0xfc,
-  0x1c, 0xb7, 0xb2, 0xb8, 0x84, 0x1c, 0xbd, 0xb9, 0x38, 0x1e, 0xc9, 0x05,
-  0x20, 0x08, 0x42, 0x11, 0x68, 0x34, 0x3e, 0xe5, 0xa6, 0xc9, 0x53, 0x78,
-  0x46, 0xd2, 0x6c, 0xd6, 0xa2, 0x6f, 0x38, 0x23, 0xb9, 0x00, 0xfe, 0x24,
-  0x00, 0x7c, 0xbc, 0xb4, 0xd5, 0xd1, 0xfb, 0xff, 0x6d, 0x95, 0x22, 0x00,
-  0x00, 0xb6, 0x62, 0xb3, 0x1f, 0x80, 0x69, 0x6a, 0x1e, 0x7d, 0xb6, 0x0f,
-  0xaa, 0x7c, 0xff, 0x95, 0x6a, 0xaf, 0xd4, 0x17, 0xa0, 0x06, 0x5c, 0x6e,
-  0x8e, 0x3f, 0xaa, 0x38, 0x01, 0xd0, 0x67, 0xc4, 0x64, 0xe1, 0x09, 0x82,
-  0x30, 0x09, 0x11, 0x00, 0xf5, 0xee, 0xe2, 0x52, 0x92, 0x77, 0x1e, 0x4c,
-  0x80, 0x64, 0x03, 0xfc, 0xd3, 0xb5, 0xf3, 0x33, 0x2f, 0x0d, 0x38, 0xd5,
-  0x45, 0xda, 0x89, 0x43, 0xf3, 0xe1, 0x14, 0x00, 0xff, 0xe6, 0x44, 0xa3,
-  0x0f, 0x3d, 0xd5, 0x33, 0x11, 0x0e, 0x58, 0x46, 0xa7, 0xe2, 0x54, 0x8e,
-  0x13, 0x8b, 0xb4, 0x00, 0x74, 0xe5, 0xa2, 0xc4, 0xcd, 0xac, 0x58, 0x01,
-  0x04, 0x41, 0x28, 0xee, 0x68, 0x69, 0x99, 0xd4, 0xb9, 0x03, 0xc5, 0x0b,
-  0x00, 0x79, 0xf5, 0xe4, 0xfd, 0x20, 0x86, 0x52, 0x3c, 0xfd, 0x7c, 0xbf,
-  0x53, 0x3d, 0x44, 0xa7, 0xea, 0xab, 0x4c, 0xd5, 0xcf, 0xb9, 0x03, 0x07,
-  0xfc, 0x00, 0x9e, 0x78, 0xb6, 0x8f, 0xd4, 0xce, 0xb1, 0xf2, 0x2a, 0x55,
-  0x19, 0xcb, 0xb2, 0x62, 0x69, 0x2d, 0xad, 0x4d, 0x85, 0x97, 0x06, 0xee,
-  0x35, 0xe2, 0x0c, 0x99, 0x09, 0x7c, 0x4a, 0xcc, 0x70, 0x82, 0x20, 0x14,
-  0x8e, 0x81, 0x49, 0x8d, 0x3b, 0x50, 0x54, 0x38, 0x71, 0xef, 0x40, 0x3a,
-  0xbf, 0x65, 0x4c, 0xf7, 0x84, 0x24, 0x75, 0x7e, 0x3a, 0x77, 0x8c, 0xb2,
-  0xf9, 0x75, 0x47, 0x4a, 0x00, 0x77, 0x00, 0xdf, 0xae, 0x34, 0x01, 0x90,
-  0xc6, 0x81, 0x9c, 0xc6, 0xa9, 0x8c, 0xc9, 0xe3, 0xeb, 0xfa, 0xa1, 0x2e,
-  0x50, 0x3e, 0x93, 0x27, 0x65, 0xc2, 0xac, 0x30, 0x27, 0xaf, 0x2e, 0xbc,
-  0x3e, 0xb7, 0xa5, 0x2d, 0x7a, 0x8c, 0x18, 0x21, 0x97, 0xd4, 0xe6, 0x16,
-  0x04, 0xa1, 0x08, 0x01, 0xa0, 0x35, 0x21, 0x97, 0x97, 0x70, 0x11, 0xef,
-  0x90, 0xfe, 0xc1, 0x74, 0xde, 0x93, 0x70, 0x3a, 0x5b, 0x01, 0x34, 0x10,
-  0xf2, 0xb2, 0xf6, 0xe5, 0x21, 0xa7, 0x74, 0x50, 0x16, 0xf8, 0x63, 0xa5,
-  0x09, 0x00, 0x80, 0xed, 0xd8, 0xec, 0x07, 0x00, 0xf0, 0xeb, 0x3f, 0x74,
-  0x81, 0xd6, 0x65, 0x13, 0x1f, 0xaf, 0x4d, 0x0d, 0x1e, 0x17, 0x67, 0x9c,
-  0xd8, 0x54, 0xd4, 0xf3, 0x5d, 0xd9, 0x71, 0x49, 0x06, 0x24, 0x08, 0x42,
-  0x51, 0x58, 0x58, 0xf8, 0x95, 0x87, 0xea, 0x22, 0xae, 0x01, 0xfa, 0x86,
-  0x52, 0x10, 0xcf, 0xa2, 0x3c, 0xd3, 0x57, 0x01, 0x28, 0x97, 0x02, 0xad,
-  0x79, 0xfc, 0xd9, 0x5e, 0xa7, 0xba, 0x48, 0x90, 0xcf, 0xa0, 0x5b, 0x71,
-  0x02, 0xe0, 0x5b, 0x4e, 0x34, 0xfa, 0xf8, 0x73, 0xbd, 0xe4, 0xf6, 0x45,
-  0xa1, 0xaa, 0x4c, 0x4e, 0xc5, 0x0a, 0xc8, 0x9a, 0x9c, 0x56, 0x84, 0x05,
-  0x00, 0xa0, 0x23, 0x3b, 0x46, 0xca, 0xca, 0x89, 0x08, 0x10, 0x04, 0xa1,
-  0x08, 0x01, 0xa0, 0xf1, 0x2b, 0x77, 0x51, 0x16, 0x80, 0xe1, 0x91, 0x2c,
-  0x24, 0x0c, 0x70, 0x4f, 0xe3, 0x77, 0x4f, 0xd8, 0x83, 0xd9, 0x11, 0xe3,
-  0xc9, 0x75, 0x8e, 0xdc, 0xff, 0x77, 0x00, 0xfd, 0x53, 0xf9, 0x75, 0xa6,
-  0xda, 0x02, 0x60, 0xbb, 0x1f, 0xc0, 0xf0, 0x68, 0x96, 0x35, 0x6b, 0x7b,
-  0xa1, 0x21, 0x58, 0x3e, 0x77, 0x53, 0xa3, 0x59, 0x8e, 0x5e, 0x55, 0xcf,
-  0xac, 0x99, 0x85, 0xfb, 0x01, 0x74, 0xe5, 0xa2, 0x0c, 0x9a, 0x09, 0x02,
-  0x72, 0x0d, 0x20, 0x08, 0x42, 0xa1, 0x02, 0x40, 0x6b, 0x7c, 0x2e, 0x4f,
-  0x51, 0xd7, 0x88, 0x83, 0x23, 0x19, 0xcc, 0x84, 0x01, 0xd3, 0xd8, 0x02,
-  0xc0, 0x0c, 0x3f, 0xeb, 0x5f, 0x1a, 0x64, 0x70, 0xc4, 0xb1, 0x24, 0x7d,
-  0x9f, 0xaa, 0x54, 0x01, 0x60, 0xe0, 0x90, 0x77, 0xe3, 0x2f, 0x1e, 0xec,
-  0x04, 0x34, 0x65, 0xe3, 0x1c, 0x9f, 0xca, 0xe1, 0x9a, 0x5d, 0xc5, 0x99,
-  0x45, 0x5c, 0x03, 0x64, 0xb5, 0x41, 0x67, 0x76, 0x9c, 0x90, 0x24, 0x04,
-  0x12, 0x04, 0xa1, 0x40, 0x34, 0xe0, 0xc1, 0x45, 0x50, 0x15, 0x2e, 0x00,
-  0xc6, 0x63, 0x59, 0x52, 0x59, 0x0b, 0x5c, 0xd3, 0xd3, 0x02, 0xa0, 0x00,
-  0x5c, 0x2e, 0x1e, 0xfc, 0x63, 0x8f, 0x53, 0x5d, 0x64, 0x27, 0x0e, 0xca,
-  0x15, 0x29, 0x00, 0x00, 0x1e, 0xc2, 0x01, 0x3f, 0x80, 0x07, 0xd7, 0xf4,
-  0x90, 0xde, 0x39, 0x06, 0x35, 0xe5, 0x51, 0xae, 0x52, 0x6b, 0xc0, 0xed,
-  0xe6, 0xdc, 0x53, 0x9a, 0x8b, 0x7a, 0x7e, 0x6f, 0x66, 0x14, 0xb7, 0x14,
-  0x05, 0x10, 0x04, 0xa1, 0x18, 0x2b, 0x00, 0x56, 0x51, 0x16, 0xc4, 0x44,
-  0xd2, 0x64, 0x6c, 0x3c, 0x0b, 0xde, 0x69, 0xfa, 0xee, 0x09, 0xb8, 0xa1,
-  0x2f, 0xc1, 0x43, 0x4f, 0x1e, 0x74, 0xaa, 0x87, 0xf1, 0x89, 0x83, 0x72,
-  0xc5, 0x0a, 0x80, 0x1f, 0xe3, 0xc0, 0x35, 0x40, 0x22, 0x65, 0xf0, 0xf8,
-  0xb3, 0x7d, 0xf9, 0x68, 0x80, 0x72, 0xb9, 0x06, 0x48, 0x64, 0x39, 0xf7,
-  0x84, 0xc6, 0xe2, 0x04, 0x40, 0x76, 0x98, 0x98, 0x25, 0xf9, 0x00, 0x04,
-  0x41, 0x28, 0x8e, 0x62, 0xaa, 0xa8, 0x98, 0x96, 0x26, 0x3e, 0x9d, 0x7d,
-  0x00, 0x66, 0x04, 0xd8, 0xba, 0x71, 0x98, 0xf6, 0x7d, 0x8e, 0x24, 0x64,
-  0xeb, 0x00, 0x7e, 0x31, 0xd5, 0x5f, 0x69, 0xaa, 0x77, 0x90, 0x83, 0xe4,
-  0x53, 0x03, 0xdb, 0xce, 0xcf, 0x1f, 0xd8, 0x0f, 0xa6, 0x85, 0x2a, 0x97,
-  0xc9, 0x39, 0x96, 0x61, 0xce, 0xd1, 0x33, 0x58, 0x7d, 0x44, 0x5d, 0xc1,
-  0x8f, 0xf6, 0x1a, 0x71, 0xba, 0x72, 0xe3, 0x12, 0x0e, 0x28, 0x08, 0x42,
-  0xc1, 0x68, 0x4d, 0x51, 0x4e, 0x80, 0x00, 0x63, 0xb1, 0x2c, 0xb8, 0xa7,
-  0xe1, 0xc1, 0x43, 0x03, 0x3e, 0x0f, 0xbf, 0x7f, 0xda, 0x51, 0xf3, 0xff,
-  0x3d, 0x95, 0x2e, 0x00, 0x20, 0x1f, 0xe2, 0x60, 0xfb, 0x35, 0xc0, 0x23,
-  0x7f, 0xec, 0x65, 0x6c, 0xdb, 0x08, 0xd4, 0x96, 0xc9, 0x35, 0x40, 0xc6,
-  0x82, 0x9a, 0x00, 0x17, 0x9e, 0xd9, 0x52, 0xd4, 0xf3, 0xfb, 0xb2, 0xa3,
-  0x45, 0xdd, 0xe3, 0x09, 0x82, 0x20, 0x14, 0x7b, 0x4c, 0x32, 0x4d, 0xcd,
-  0x74, 0x0c, 0x40, 0x52, 0x7e, 0x37, 0x8c, 0x67, 0xb8, 0xef, 0xe1, 0x03,
-  0x4e, 0x75, 0x11, 0x07, 0x46, 0xa6, 0x83, 0x00, 0xf8, 0xac, 0x13, 0x8d,
-  0xa6, 0x33, 0x66, 0x3e, 0x27, 0x40, 0x4d, 0x30, 0x9f, 0xac, 0xa2, 0x1c,
-  0x56, 0xa0, 0x61, 0x70, 0xd9, 0x59, 0x33, 0x8b, 0x7a, 0x7c, 0x47, 0x7a,
-  0x80, 0xb4, 0x36, 0x24, 0x1c, 0x50, 0x10, 0x84, 0xa2, 0x0e, 0xb4, 0xc5,
-  0x30, 0x3c, 0x96, 0x05, 0xef, 0x34, 0xcc, 0x44, 0xda, 0x18, 0xa0, 0xfd,
-  0x85, 0x7e, 0xb6, 0xb6, 0x8f, 0x3b, 0xd1, 0x7a, 0x07, 0xf0, 0xca, 0xe1,
-  0xf8, 0x5a, 0x87, 0x43, 0x00, 0xbc, 0x88, 0x03, 0x7e, 0x00, 0x00, 0x3f,
-  0xfd, 0xcd, 0x7e, 0x48, 0x67, 0x51, 0xe5, 0x52, 0xb3, 0x7a, 0x24, 0xc3,
-  0x49, 0x27, 0x36, 0xd1, 0xd6, 0x52, 0x78, 0x38, 0xe0, 0xde, 0xec, 0x28,
-  0x7d, 0xb9, 0x18, 0x41, 0xb9, 0x06, 0x10, 0x04, 0x61, 0x8a, 0x2c, 0x00,
-  0x99, 0xcc, 0xf4, 0x8b, 0x02, 0x50, 0x1a, 0xf0, 0x79, 0xb9, 0xdf, 0x39,
-  0xe7, 0xbf, 0x2c, 0xf0, 0xc5, 0xe9, 0x22, 0x00, 0x1c, 0xab, 0x74, 0xb4,
-  0x7e, 0xe3, 0x10, 0xfb, 0x37, 0xf4, 0x43, 0x53, 0x99, 0xe4, 0x04, 0x48,
-  0x18, 0xb8, 0xe6, 0x44, 0xb8, 0xea, 0xfc, 0x59, 0x05, 0x3f, 0x6a, 0x68,
-  0x8b, 0x3d, 0xd9, 0x11, 0xc2, 0x2e, 0xcc, 0x7f, 0xdf, 0xf8, 0x00, 0x00,
-  0x20, 0x00, 0x49, 0x44, 0x41, 0x54, 0xef, 0xb4, 0x4f, 0xcd, 0x2d, 0x08,
-  0x42, 0x61, 0x58, 0x45, 0x3e, 0xe7, 0xf7, 0xb9, 0xca, 0xc3, 0xc2, 0x6a,
-  0x27, 0x01, 0x37, 0x0c, 0x27, 0xb9, 0xf7, 0x21, 0xc7, 0xcc, 0xff, 0x19,
-  0xa0, 0x6b, 0xba, 0x08, 0x00, 0x80, 0x7b, 0x71, 0xc0, 0x0f, 0x00, 0xe0,
-  0xc7, 0x0f, 0x74, 0x82, 0xdf, 0x5b, 0x16, 0x86, 0xf1, 0x37, 0x96, 0xd1,
-  0x95, 0xe7, 0xb6, 0x16, 0xf5, 0xfc, 0xf6, 0xf4, 0x00, 0x1a, 0x2d, 0x97,
-  0x00, 0x82, 0x20, 0x1c, 0xfa, 0x89, 0x56, 0x41, 0xd2, 0x2a, 0xce, 0x17,
-  0xbb, 0xbe, 0xce, 0x0b, 0x86, 0x39, 0x7d, 0x06, 0x4b, 0x03, 0x8d, 0x01,
-  0xb6, 0xbc, 0xd0, 0xcf, 0x36, 0xe7, 0xcc, 0xff, 0x83, 0x87, 0xeb, 0xeb,
-  0x1d, 0x2e, 0x01, 0xf0, 0x13, 0x1c, 0xba, 0x06, 0xf8, 0xcf, 0xfb, 0x3b,
-  0xa0, 0x27, 0x0e, 0xe1, 0x32, 0x49, 0x94, 0x33, 0x94, 0xe2, 0xec, 0xd3,
-  0x5b, 0xa8, 0x2b, 0x22, 0x87, 0xc1, 0xeb, 0x99, 0x21, 0x0e, 0xe6, 0xa4,
-  0x38, 0x90, 0x20, 0x08, 0x85, 0x61, 0xe8, 0xe2, 0x6c, 0x00, 0xf5, 0xd5,
-  0x7e, 0x30, 0xa6, 0x93, 0x05, 0x40, 0x83, 0xd7, 0xcb, 0xaf, 0x1e, 0x71,
-  0xf4, 0x80, 0xfe, 0xb1, 0xe9, 0x26, 0x00, 0xc6, 0xc8, 0x7b, 0x3d, 0xda,
-  0xce, 0x81, 0x9e, 0x24, 0x4f, 0x3c, 0xde, 0x0d, 0xcd, 0xc1, 0x89, 0x8c,
-  0x3b, 0x25, 0x4e, 0x2c, 0x87, 0x67, 0x41, 0x35, 0xef, 0xbe, 0x64, 0x76,
-  0xc1, 0x8f, 0xe6, 0xb4, 0xc9, 0xce, 0xcc, 0x20, 0x11, 0x97, 0x5f, 0xae,
-  0x01, 0x04, 0x41, 0x38, 0xc4, 0x97, 0xbe, 0x22, 0xa5, 0x0b, 0xb7, 0x00,
-  0x78, 0xdc, 0x8a, 0x19, 0xf5, 0x7e, 0xc8, 0x59, 0xd3, 0x66, 0xac, 0x54,
-  0xd8, 0x0b, 0x7d, 0x31, 0x7e, 0xfe, 0xbb, 0x4e, 0xa7, 0xba, 0x48, 0x02,
-  0x3b, 0xa6, 0x9b, 0x00, 0x00, 0x87, 0xb2, 0x02, 0x02, 0x7c, 0xef, 0xde,
-  0xbd, 0xf9, 0x1f, 0xcf, 0x55, 0xfa, 0xce, 0x80, 0x5a, 0x03, 0x96, 0xe6,
-  0x96, 0x2b, 0xe6, 0x14, 0xf5, 0xfc, 0x6b, 0xa9, 0x3e, 0xb2, 0xda, 0x94,
-  0x68, 0x00, 0x41, 0x10, 0xde, 0x79, 0x43, 0x43, 0x91, 0xd3, 0x66, 0x51,
-  0x02, 0xa0, 0xb1, 0xde, 0x4f, 0x43, 0xad, 0x0f, 0xb2, 0xd3, 0x44, 0x00,
-  0x68, 0xa0, 0x39, 0xc8, 0xd3, 0x6b, 0x7a, 0xe8, 0xee, 0x4d, 0x3a, 0xd1,
-  0x43, 0x07, 0xd0, 0x77, 0x78, 0xc5, 0xe0, 0xe1, 0xe3, 0x3b, 0x38, 0x74,
-  0x0d, 0xf0, 0xf0, 0x53, 0x3d, 0x8c, 0x6c, 0x1c, 0x82, 0x86, 0x32, 0xc8,
-  0x0c, 0xa8, 0x80, 0x81, 0x14, 0xa7, 0x9d, 0xd5, 0xca, 0x82, 0x39, 0x55,
-  0x05, 0x3f, 0xbe, 0x2b, 0x33, 0x4c, 0x57, 0x6e, 0x9c, 0x2a, 0xb9, 0x06,
-  0x10, 0x04, 0xe1, 0x1d, 0x70, 0x2b, 0x45, 0x5a, 0x9b, 0xc4, 0xcd, 0xc2,
-  0x5f, 0xbd, 0x2d, 0x4d, 0x41, 0xdc, 0x21, 0x0f, 0x98, 0xd3, 0xc3, 0xde,
-  0xf8, 0x46, 0xa2, 0xd5, 0x9f, 0x3c, 0xb0, 0xdf, 0xc9, 0x6e, 0xee, 0x98,
-  0xae, 0x02, 0x60, 0x14, 0x70, 0x24, 0xa7, 0xa2, 0x69, 0x69, 0x7e, 0x70,
-  0xef, 0x3e, 0xa8, 0xf2, 0x97, 0xc7, 0xb9, 0x38, 0x69, 0x40, 0x4b, 0x15,
-  0xef, 0xbb, 0x66, 0x5e, 0xc1, 0x8f, 0x5a, 0x68, 0x5e, 0x4b, 0xf5, 0x11,
-  0x76, 0xf9, 0xd0, 0x72, 0x11, 0x20, 0x08, 0xc2, 0xdb, 0x09, 0x00, 0x14,
-  0x19, 0xcb, 0x60, 0xdc, 0x4c, 0x17, 0xfc, 0x6c, 0x73, 0x83, 0x1f, 0xaa,
-  0xbd, 0x60, 0x4c, 0x13, 0x0b, 0x40, 0x9d, 0x9f, 0xd8, 0xd6, 0x11, 0xee,
-  0x7f, 0xd4, 0xb1, 0xfb, 0xff, 0x34, 0xb0, 0x73, 0xba, 0x0a, 0x00, 0x80,
-  0x07, 0x71, 0xe8, 0x1a, 0xe0, 0x87, 0xf7, 0xee, 0x85, 0x81, 0xf2, 0x70,
-  0x06, 0xd4, 0x0a, 0x48, 0x67, 0xb9, 0xf5, 0xaa, 0x79, 0x45, 0x3d, 0xbf,
-  0x31, 0xd5, 0x43, 0xdc, 0xca, 0xe1, 0x55, 0xd3, 0x30, 0x41, 0x87, 0x20,
-  0x08, 0x87, 0xfe, 0xc2, 0x57, 0x2e, 0x92, 0x3a, 0x47, 0xd4, 0x2a, 0xbc,
-  0x9c, 0x6d, 0x6b, 0x73, 0x08, 0xaa, 0x7c, 0xe8, 0xe9, 0xe0, 0x03, 0x60,
-  0x69, 0xa8, 0x09, 0xf0, 0xab, 0x87, 0x0e, 0x90, 0x4a, 0x3b, 0x12, 0xf5,
-  0xd0, 0x01, 0xf4, 0x1c, 0xf6, 0xf9, 0x70, 0x98, 0xfb, 0xff, 0x26, 0x0e,
-  0x5d, 0x03, 0x74, 0x1e, 0x4c, 0xf0, 0xe8, 0x43, 0x07, 0xa0, 0x39, 0x54,
-  0x1e, 0x71, 0xab, 0x03, 0x29, 0xe6, 0x9c, 0xd2, 0x54, 0x54, 0x85, 0xc0,
-  0x3e, 0x23, 0xce, 0xce, 0xcc, 0x20, 0x35, 0xae, 0x80, 0xd8, 0x00, 0x04,
-  0x41, 0x78, 0x4b, 0xbc, 0xca, 0xc5, 0xb8, 0x99, 0x26, 0x57, 0x44, 0x14,
-  0xc0, 0x9c, 0xd6, 0x10, 0x4c, 0x93, 0x37, 0x8c, 0xf2, 0xbb, 0x21, 0x91,
-  0xe5, 0x7b, 0xf7, 0xec, 0x75, 0xaa, 0x8b, 0x2c, 0xf0, 0xc1, 0xe9, 0x2e,
-  0x00, 0x12, 0x38, 0x94, 0x14, 0x08, 0xe0, 0x5b, 0x3f, 0xdd, 0x0d, 0xda,
-  0x42, 0x79, 0xca, 0xc0, 0x19, 0x30, 0x67, 0x81, 0xc7, 0xc3, 0x87, 0xae,
-  0x5f, 0x50, 0xd4, 0xf3, 0x2f, 0xa7, 0x0e, 0xe2, 0x51, 0x4a, 0x5c, 0x01,
-  0x05, 0x41, 0x78, 0x4b, 0xfc, 0xca, 0xc3, 0x88, 0x91, 0x2e, 0xea, 0xd9,
-  0x39, 0xad, 0xa1, 0xf2, 0x88, 0xac, 0x9a, 0xf4, 0xcb, 0x18, 0x68, 0x0d,
-  0xb1, 0xe5, 0xe9, 0x1e, 0x5e, 0xdb, 0x31, 0xea, 0x54, 0x2f, 0x29, 0x60,
-  0xdf, 0x74, 0x17, 0x00, 0x00, 0x5f, 0xc2, 0xa1, 0x6b, 0x80, 0x35, 0xeb,
-  0xfa, 0xd8, 0xb7, 0xb6, 0x17, 0x66, 0x86, 0x4a, 0x5f, 0xb8, 0xba, 0x14,
-  0x0c, 0x26, 0xb9, 0xe6, 0xca, 0xb9, 0xb4, 0x34, 0x05, 0x0a, 0x7e, 0xfc,
-  0xb5, 0x54, 0x1f, 0x5d, 0xb9, 0x68, 0xd1, 0x55, 0xbe, 0x04, 0x41, 0x98,
-  0x1e, 0x0c, 0x18, 0xc5, 0x45, 0x60, 0x2f, 0x9c, 0x5b, 0x35, 0x2d, 0x1c,
-  0x00, 0x95, 0x02, 0x5c, 0x2e, 0xee, 0xfa, 0xf9, 0x6e, 0xa7, 0xba, 0xe8,
-  0x00, 0xd6, 0x97, 0xc4, 0xb6, 0x53, 0x02, 0x9f, 0xe1, 0x61, 0x1c, 0xba,
-  0x06, 0x00, 0xb8, 0xeb, 0x67, 0xbb, 0xc1, 0xe7, 0xc9, 0xff, 0xa8, 0xa5,
-  0x4e, 0x2c, 0x87, 0x6b, 0x4e, 0x0d, 0xb7, 0x5d, 0x33, 0xbf, 0xe0, 0x47,
-  0x73, 0xda, 0xe4, 0xd5, 0x54, 0x0f, 0x11, 0x57, 0x40, 0x9c, 0x01, 0x05,
-  0x41, 0xf8, 0xcb, 0x8d, 0x0d, 0x45, 0x4e, 0x5b, 0xf4, 0x17, 0x21, 0x00,
-  0x3c, 0x1e, 0xc5, 0xfc, 0xb6, 0x30, 0xa4, 0xa7, 0x41, 0x16, 0xc0, 0x7a,
-  0x3f, 0xb1, 0x6d, 0x23, 0xfc, 0xca, 0xb9, 0xca, 0x7f, 0x59, 0xe0, 0x1f,
-  0x45, 0x00, 0xe4, 0x31, 0x80, 0x21, 0xa7, 0xac, 0x00, 0x3f, 0xbe, 0xaf,
-  0x83, 0xf8, 0xeb, 0x23, 0x50, 0xe7, 0x2f, 0xf9, 0x79, 0xa7, 0x01, 0x52,
-  0x59, 0xfe, 0xfa, 0x86, 0x45, 0x45, 0x3d, 0xff, 0x7c, 0xe2, 0x00, 0xe3,
-  0x56, 0x1a, 0x9f, 0x38, 0x03, 0x0a, 0x82, 0xf0, 0x3f, 0x70, 0x2b, 0x45,
-  0xd2, 0xca, 0xd2, 0x57, 0x84, 0x00, 0x98, 0xd3, 0x1a, 0xa6, 0xad, 0x35,
-  0x04, 0x09, 0xa3, 0xb2, 0x07, 0xc9, 0xd2, 0x50, 0x13, 0xe4, 0xdf, 0xef,
-  0xd9, 0x43, 0x32, 0xe5, 0x98, 0xd8, 0x89, 0x91, 0x8f, 0x82, 0x13, 0x01,
-  0x30, 0xc1, 0xad, 0x4e, 0x59, 0x01, 0xe2, 0x49, 0x83, 0x9f, 0xdc, 0xbb,
-  0x17, 0x6a, 0xcb, 0xa0, 0x4c, 0xb0, 0x02, 0x06, 0x92, 0xb4, 0x9d, 0xd6,
-  0xcc, 0xa5, 0x67, 0x17, 0x5e, 0x1f, 0x60, 0xc4, 0x4c, 0xb1, 0x35, 0xdd,
-  0x47, 0x9d, 0x3b, 0x28, 0x36, 0x00, 0x41, 0x10, 0xfe, 0x8c, 0x80, 0xf2,
-  0x30, 0x6c, 0x26, 0x19, 0x32, 0x0b, 0x4f, 0x6a, 0x33, 0x7f, 0x56, 0x18,
-  0x57, 0x83, 0xbf, 0xe2, 0x93, 0x00, 0xa9, 0xb0, 0x17, 0x46, 0x53, 0x7c,
-  0xef, 0x17, 0x7b, 0x9c, 0xea, 0xa2, 0x03, 0xf8, 0x6e, 0xa9, 0x7c, 0xdf,
-  0x52, 0x11, 0x00, 0x7b, 0xc8, 0xc7, 0x44, 0x3a, 0xc2, 0x57, 0xff, 0xa3,
-  0x1d, 0x06, 0x13, 0xa8, 0x48, 0xe9, 0xdf, 0x8f, 0xeb, 0x89, 0x3c, 0xdb,
-  0xff, 0xfb, 0x03, 0x4b, 0x8b, 0x7a, 0xfe, 0xd9, 0x78, 0x27, 0x86, 0xb6,
-  0x70, 0x8b, 0x3b, 0xa0, 0x20, 0x08, 0xff, 0x0d, 0xbf, 0xf2, 0xd0, 0x93,
-  0x8b, 0x15, 0x55, 0x07, 0x60, 0xd5, 0xf2, 0x5a, 0x08, 0x7b, 0xc1, 0xaa,
-  0x60, 0x01, 0x60, 0x69, 0x68, 0x09, 0xf3, 0xe8, 0xfd, 0x1d, 0x74, 0x74,
-  0x27, 0x9c, 0xea, 0x25, 0x0b, 0xfc, 0x42, 0x04, 0xc0, 0x5f, 0xf2, 0x00,
-  0x0e, 0x5d, 0x03, 0x74, 0xf7, 0x26, 0x79, 0xe8, 0xb7, 0xfb, 0xa1, 0x29,
-  0x5c, 0xfa, 0x5e, 0xac, 0x2e, 0x05, 0x3d, 0x49, 0x4e, 0xbf, 0x64, 0x36,
-  0x2b, 0x97, 0xd5, 0x16, 0xae, 0xa4, 0xb2, 0x23, 0x6c, 0xcf, 0x0c, 0x50,
-  0xeb, 0x96, 0x90, 0x40, 0x41, 0x10, 0x26, 0x0e, 0x16, 0x80, 0x47, 0xb9,
-  0xe8, 0xcc, 0x8d, 0x15, 0xf5, 0xfc, 0x8a, 0xc5, 0xd5, 0xe0, 0x72, 0xa3,
-  0x2b, 0x78, 0xff, 0x57, 0x7e, 0x37, 0xa4, 0x73, 0xfc, 0x9f, 0xef, 0xbf,
-  0xee, 0xe4, 0xe9, 0x7f, 0x08, 0x28, 0x19, 0x47, 0x8a, 0x52, 0x12, 0x00,
-  0x5f, 0xc6, 0x41, 0x67, 0xc0, 0x2f, 0x7c, 0x6f, 0x07, 0x24, 0xb2, 0x28,
-  0x5f, 0xe9, 0xdf, 0x8f, 0xeb, 0xb4, 0x01, 0x35, 0x41, 0x3e, 0x7e, 0xeb,
-  0xe2, 0xa2, 0x9e, 0x7f, 0x26, 0xde, 0x89, 0x47, 0x49, 0x75, 0x00, 0x41,
-  0x10, 0xf2, 0x78, 0x50, 0x24, 0xac, 0x2c, 0xfb, 0xb2, 0xc5, 0x5d, 0x3d,
-  0xaf, 0x5c, 0x52, 0x03, 0xd9, 0x0a, 0xbe, 0xff, 0xb7, 0x34, 0xcc, 0x0a,
-  0xf3, 0xca, 0x1f, 0xba, 0xd8, 0xb0, 0x71, 0xc8, 0xc9, 0xd3, 0xff, 0x8d,
-  0x25, 0x75, 0xde, 0x2c, 0xa1, 0xcf, 0x92, 0x25, 0x5f, 0x25, 0xd0, 0x11,
-  0x2b, 0xc0, 0x2b, 0x5b, 0x46, 0x78, 0xe9, 0xf1, 0x2e, 0x68, 0x2d, 0x83,
-  0x90, 0x40, 0xa5, 0x60, 0x3c, 0xc5, 0x75, 0x97, 0xcd, 0xc1, 0xef, 0x2b,
-  0xfc, 0x27, 0xda, 0x92, 0xee, 0x63, 0x5f, 0x76, 0x94, 0x1a, 0xb1, 0x02,
-  0x08, 0x82, 0x00, 0x04, 0x5c, 0x5e, 0xfa, 0x8c, 0x38, 0xdd, 0xd9, 0xc2,
-  0xd3, 0xae, 0x44, 0xc2, 0x1e, 0x56, 0x2e, 0xa9, 0x85, 0x58, 0xae, 0x62,
-  0xc7, 0x47, 0xb9, 0x15, 0xe0, 0x72, 0xf2, 0xf4, 0x0f, 0xf9, 0xca, 0x7f,
-  0x9d, 0xa5, 0xf4, 0xbd, 0x4b, 0x2d, 0x43, 0xce, 0x0d, 0x4e, 0x5a, 0x01,
-  0xbe, 0x7f, 0xef, 0x3e, 0x70, 0xb9, 0xcb, 0x22, 0x24, 0x50, 0x8f, 0x64,
-  0x08, 0x1f, 0x51, 0xcf, 0xb5, 0x45, 0x94, 0x09, 0x06, 0x58, 0x1b, 0xef,
-  0x20, 0xa8, 0x3c, 0x62, 0x05, 0x10, 0x04, 0x81, 0xb0, 0xcb, 0xcb, 0xfe,
-  0xec, 0x18, 0x56, 0x11, 0x47, 0x82, 0x63, 0x8e, 0xa8, 0x23, 0x34, 0x3b,
-  0x0c, 0xa9, 0x0a, 0xb5, 0x00, 0x68, 0xa0, 0x2d, 0xcc, 0xae, 0x27, 0xbb,
-  0x78, 0xf0, 0xc9, 0x83, 0x4e, 0xf5, 0xd2, 0x01, 0xdc, 0x55, 0x6a, 0x5f,
-  0xbd, 0xd4, 0x04, 0xc0, 0x3e, 0x20, 0xee, 0x94, 0x15, 0xe0, 0xbe, 0x47,
-  0x0e, 0x90, 0x6a, 0x1f, 0x2d, 0x8b, 0x90, 0xc0, 0xfc, 0x3a, 0xd5, 0x7c,
-  0xe0, 0xda, 0xf9, 0x45, 0x3d, 0xfe, 0x62, 0xea, 0x20, 0x1d, 0xd9, 0x51,
-  0x22, 0x6e, 0xbf, 0x58, 0x01, 0x04, 0x61, 0x9a, 0x63, 0xa1, 0xd9, 0x95,
-  0x29, 0xce, 0xb4, 0x7d, 0xf4, 0x8a, 0x3a, 0xa8, 0xae, 0xdc, 0x1a, 0x00,
-  0x4a, 0x01, 0x5e, 0x0f, 0x5f, 0xf8, 0xee, 0x0e, 0x27, 0xbb, 0xc9, 0x02,
-  0x3f, 0x13, 0x01, 0xf0, 0xce, 0xfc, 0x2f, 0xa7, 0xac, 0x00, 0xc9, 0x94,
-  0xc9, 0xcf, 0x7e, 0xbd, 0x0f, 0x6a, 0x83, 0x28, 0x5d, 0x06, 0x21, 0x81,
-  0xbd, 0x49, 0xce, 0xb8, 0x70, 0x16, 0x4b, 0x17, 0x44, 0x0a, 0x7e, 0xdc,
-  0xd4, 0x16, 0x4f, 0xc6, 0xf7, 0x11, 0x56, 0x3e, 0xb1, 0x02, 0x08, 0xc2,
-  0x34, 0x26, 0xa0, 0x3c, 0x0c, 0x1a, 0x09, 0x5e, 0xcf, 0x0c, 0x16, 0xf5,
-  0xfc, 0xc9, 0xab, 0x67, 0x50, 0xb1, 0x35, 0x00, 0xb4, 0x86, 0xd6, 0x10,
-  0x5d, 0xeb, 0x7b, 0xb9, 0xe7, 0x41, 0xc7, 0xac, 0xf3, 0x1d, 0xc0, 0x96,
-  0x52, 0x1c, 0xc4, 0x52, 0x14, 0x00, 0xcf, 0x00, 0x8e, 0x5d, 0x36, 0xdd,
-  0xf5, 0x9f, 0xbb, 0x61, 0x2c, 0x05, 0xc1, 0xd2, 0xaf, 0x12, 0x48, 0xca,
-  0x80, 0x19, 0x61, 0xee, 0xb8, 0xb9, 0x38, 0x67, 0xc0, 0x17, 0x93, 0xdd,
-  0x74, 0xe6, 0xc6, 0xa8, 0x16, 0x2b, 0x80, 0x20, 0x4c, 0x4b, 0x34, 0x50,
-  0xe5, 0xf2, 0xb1, 0x2f, 0x3b, 0x4a, 0xc2, 0x2a, 0xfc, 0xb5, 0xaa, 0x14,
-  0x9c, 0xb0, 0xb2, 0x3e, 0x5f, 0xb2, 0xbc, 0x52, 0x8f, 0xff, 0x7e, 0x1f,
-  0xff, 0xf4, 0xad, 0x6d, 0x4e, 0x6e, 0xcf, 0x59, 0xe0, 0x7d, 0xa5, 0xf8,
-  0xf5, 0x4b, 0xb5, 0x4a, 0x8e, 0x63, 0x65, 0x82, 0x5f, 0xdf, 0x13, 0x65,
-  0xed, 0x23, 0x07, 0xf2, 0xf5, 0x01, 0x4a, 0x3c, 0x31, 0x90, 0x56, 0x0a,
-  0xa2, 0x69, 0x6e, 0xbd, 0x76, 0x41, 0x51, 0xce, 0x80, 0x16, 0x9a, 0xc7,
-  0x62, 0xbb, 0x08, 0x29, 0xaf, 0x58, 0x01, 0x04, 0x61, 0x1a, 0xa2, 0x00,
-  0x97, 0x52, 0x6c, 0x4e, 0xf7, 0x15, 0xf5, 0xfc, 0xb2, 0x85, 0xd5, 0x2c,
-  0x58, 0x56, 0x03, 0x63, 0xd9, 0xca, 0x1b, 0x1c, 0x0d, 0xaa, 0x35, 0x44,
-  0xcf, 0x86, 0x5e, 0x7e, 0xf2, 0x9b, 0x0e, 0xa7, 0x7a, 0xe9, 0x20, 0xef,
-  0xdc, 0x9e, 0x12, 0x01, 0x70, 0xe8, 0xfc, 0x13, 0x0e, 0x3a, 0x03, 0x7e,
-  0xf5, 0x3f, 0xda, 0x01, 0x55, 0x16, 0x55, 0x02, 0x19, 0x4e, 0x53, 0x75,
-  0x44, 0x3d, 0x37, 0x5d, 0x35, 0xaf, 0x48, 0x2b, 0xc0, 0x41, 0xda, 0x33,
-  0x43, 0xd4, 0x49, 0x44, 0x80, 0x20, 0x4c, 0x3b, 0x82, 0x2e, 0x2f, 0xfd,
-  0x46, 0x82, 0x6d, 0xe9, 0x81, 0xa2, 0x9e, 0x3f, 0xe5, 0xd8, 0x06, 0x68,
-  0x0a, 0x56, 0x64, 0x06, 0x40, 0xa5, 0x00, 0xbf, 0x8f, 0xcf, 0x7d, 0x7b,
-  0x9b, 0x93, 0xdd, 0x64, 0x81, 0xf7, 0x94, 0xea, 0x18, 0x94, 0xea, 0x0e,
-  0x68, 0x90, 0x0f, 0x97, 0x70, 0x44, 0x96, 0x3d, 0xba, 0xb6, 0x97, 0x7d,
-  0x7f, 0x3c, 0x58, 0x16, 0x55, 0x02, 0xb5, 0x06, 0x0c, 0x83, 0x3b, 0x6f,
-  0x5b, 0x52, 0x74, 0x1b, 0x8f, 0xc4, 0x76, 0xe3, 0x57, 0x1e, 0x5c, 0x08,
-  0x82, 0x30, 0x5d, 0xd0, 0x40, 0xb5, 0xcb, 0xcf, 0xb6, 0x74, 0x3f, 0x69,
-  0xab, 0x38, 0x13, 0xfe, 0xd9, 0x27, 0x37, 0x81, 0xcb, 0x85, 0xae, 0xb4,
-  0x32, 0xc0, 0x96, 0x86, 0x59, 0x21, 0xf6, 0x3d, 0xd3, 0xcd, 0xdd, 0xf7,
-  0x39, 0x56, 0x95, 0xb7, 0x83, 0x7c, 0xb9, 0xfb, 0x03, 0xa5, 0x3a, 0x0c,
-  0xa5, 0xbc, 0x27, 0x5c, 0xe5, 0xa4, 0x15, 0xe0, 0x2b, 0x3f, 0xdc, 0x09,
-  0x3e, 0x6f, 0xe9, 0x87, 0x04, 0x4e, 0x38, 0x03, 0xae, 0x38, 0x7b, 0x26,
-  0xa7, 0x1d, 0xdf, 0x58, 0x54, 0x13, 0xdb, 0xd2, 0xfd, 0x6c, 0x4d, 0x0f,
-  0x50, 0xef, 0x0e, 0x4a, 0xa5, 0x40, 0x41, 0x98, 0x26, 0xb8, 0x51, 0x64,
-  0xb5, 0xc1, 0x2b, 0xc9, 0xe2, 0x43, 0xdb, 0xce, 0x5c, 0xdd, 0x00, 0xf1,
-  0xca, 0x33, 0xff, 0x2b, 0xb7, 0x02, 0xaf, 0x97, 0xbf, 0xff, 0xca, 0x66,
-  0xa7, 0x4f, 0xff, 0x1f, 0x2e, 0xe5, 0x71, 0x28, 0x65, 0x01, 0x90, 0xc2,
-  0xc1, 0x2a, 0x81, 0x77, 0xdf, 0xd7, 0xc1, 0xe0, 0xab, 0xfd, 0x79, 0xf3,
-  0x56, 0xa9, 0x5b, 0x01, 0x72, 0x16, 0xf8, 0x3d, 0x7c, 0xf6, 0xc3, 0xcb,
-  0x8b, 0x6e, 0xe3, 0xf7, 0xd1, 0xd7, 0x27, 0xd2, 0x81, 0x4a, 0xa5, 0x40,
-  0x41, 0x98, 0x0e, 0x44, 0xdc, 0x7e, 0xf6, 0x64, 0x47, 0xd9, 0x9d, 0x1d,
-  0x29, 0xea, 0xf9, 0xd5, 0x47, 0xd4, 0x31, 0x6b, 0x55, 0x3d, 0x8c, 0x57,
-  0x98, 0x00, 0xb0, 0x34, 0xcc, 0x8d, 0xb0, 0xe3, 0xf1, 0x03, 0xdc, 0xff,
-  0x58, 0xb7, 0xd3, 0x7b, 0xd8, 0x46, 0x11, 0x00, 0xc5, 0x73, 0xb1, 0x53,
-  0x56, 0x00, 0xcb, 0xd2, 0xfc, 0xdf, 0x1f, 0xbc, 0x0e, 0x61, 0x3f, 0x25,
-  0xaf, 0x00, 0x94, 0x82, 0xbe, 0x04, 0x17, 0x5c, 0x33, 0x8f, 0x85, 0x73,
-  0xab, 0x8a, 0x6a, 0x62, 0x5f, 0x76, 0x94, 0x17, 0x92, 0xdd, 0x34, 0xb8,
-  0x43, 0x45, 0x25, 0x03, 0x11, 0x04, 0xa1, 0x7c, 0xd0, 0x40, 0x50, 0x79,
-  0x78, 0x29, 0x59, 0xfc, 0x06, 0x77, 0xd1, 0x59, 0x33, 0xa1, 0x26, 0x80,
-  0xce, 0x54, 0xd6, 0xfd, 0xbf, 0xf2, 0xbb, 0x41, 0xc3, 0xdf, 0x7c, 0xde,
-  0xd1, 0xbd, 0xb9, 0x03, 0xf8, 0x3f, 0xa5, 0x3e, 0x16, 0xa5, 0x2e, 0x00,
-  0x62, 0xc0, 0xb0, 0x53, 0x56, 0x80, 0xef, 0xfd, 0x62, 0x0f, 0xc9, 0xf6,
-  0x11, 0x54, 0x43, 0x19, 0x58, 0x01, 0x12, 0x06, 0xd4, 0x04, 0xf8, 0xc7,
-  0x8f, 0x4c, 0xc6, 0x0a, 0xb0, 0x93, 0x98, 0x95, 0x21, 0xa4, 0xbc, 0x08,
-  0x82, 0x50, 0xb9, 0x84, 0x5d, 0x5e, 0xfa, 0x8d, 0x38, 0x2f, 0x4f, 0xc2,
-  0xfc, 0x7f, 0xc5, 0xd9, 0x33, 0xc1, 0x30, 0xa8, 0xa8, 0x10, 0x22, 0x53,
-  0xc3, 0xac, 0x08, 0x6b, 0xef, 0xd9, 0xcd, 0xd3, 0x1b, 0x06, 0x9c, 0xec,
-  0x29, 0x01, 0xfc, 0x56, 0x04, 0xc0, 0xe4, 0xb9, 0xd4, 0x29, 0x2b, 0x40,
-  0x2a, 0x6d, 0xf2, 0xb5, 0xef, 0xed, 0x80, 0xea, 0x00, 0x8a, 0x32, 0xa8,
-  0x12, 0x38, 0x94, 0xe4, 0x96, 0x1b, 0x17, 0xd1, 0x34, 0x23, 0x50, 0x54,
-  0x13, 0xa3, 0x66, 0x8a, 0x27, 0x62, 0x7b, 0xa8, 0xf7, 0x88, 0x2f, 0x80,
-  0x20, 0x54, 0xf2, 0xe9, 0xbf, 0xda, 0x1d, 0xe0, 0xc5, 0xe4, 0x41, 0xd2,
-  0xba, 0x38, 0xe7, 0xbf, 0x59, 0x2d, 0x21, 0x4e, 0x3c, 0xa1, 0x11, 0x86,
-  0x33, 0x15, 0x35, 0x30, 0xaa, 0xda, 0x0b, 0xf1, 0x2c, 0x1f, 0xfa, 0x27,
-  0xc7, 0x4f, 0xff, 0x3f, 0x2d, 0x87, 0x21, 0x29, 0x07, 0x01, 0x30, 0x06,
-  0x8c, 0x38, 0x65, 0x05, 0xf8, 0xea, 0x8f, 0x76, 0x92, 0x68, 0x1f, 0x81,
-  0xc6, 0x32, 0xb0, 0x02, 0x8c, 0x67, 0x71, 0xcd, 0xaa, 0xe6, 0x53, 0x1f,
-  0x5c, 0x5a, 0x74, 0x1b, 0x8f, 0xc7, 0xf6, 0xb2, 0x3f, 0x3b, 0x46, 0xad,
-  0x2b, 0x20, 0x22, 0x40, 0x10, 0x2a, 0x10, 0xbf, 0x72, 0x33, 0x66, 0xa4,
-  0x58, 0x9b, 0x28, 0xfe, 0x95, 0x79, 0xe5, 0xf9, 0x6d, 0x30, 0x3b, 0x52,
-  0x51, 0x09, 0x80, 0x94, 0xd6, 0xd0, 0x14, 0xe1, 0xee, 0xbb, 0xb6, 0xb2,
-  0xab, 0x23, 0xe6, 0x64, 0x57, 0x59, 0xe0, 0x9b, 0x22, 0x00, 0xec, 0xe3,
-  0x02, 0x1c, 0x4c, 0x0f, 0xfc, 0x85, 0x6f, 0x6c, 0x85, 0x48, 0x80, 0xb2,
-  0xf0, 0x05, 0x18, 0x4d, 0xf2, 0xd1, 0x0f, 0x2e, 0xa3, 0xba, 0xaa, 0x38,
-  0x33, 0xbe, 0x89, 0xc5, 0xfd, 0xe3, 0x3b, 0x08, 0xba, 0xbc, 0xb8, 0x25,
-  0x3d, 0x90, 0x20, 0x54, 0x14, 0x16, 0x9a, 0x7a, 0x77, 0x90, 0x17, 0x53,
-  0xdd, 0x8c, 0x99, 0xe9, 0xa2, 0xdb, 0xb9, 0xe9, 0xf2, 0x39, 0x60, 0x56,
-  0xd0, 0x11, 0xc1, 0xd2, 0xd0, 0x1c, 0x24, 0xbd, 0x6f, 0x94, 0x3b, 0xbf,
-  0xb2, 0xc5, 0xe9, 0xd3, 0xff, 0x53, 0x94, 0x49, 0xee, 0xe4, 0x72, 0x11,
-  0x00, 0x71, 0xa7, 0xad, 0x00, 0x63, 0x5b, 0x06, 0x51, 0xa5, 0x9e, 0x17,
-  0x40, 0xe5, 0xab, 0x04, 0xfa, 0xe6, 0xd5, 0xf1, 0x0f, 0x1f, 0x5c, 0x56,
-  0x74, 0x33, 0x5b, 0xd3, 0xfd, 0xbc, 0x98, 0xec, 0xa6, 0xd1, 0x13, 0x16,
-  0x87, 0x40, 0x41, 0xa8, 0x20, 0x02, 0xca, 0x43, 0xd4, 0xca, 0xb0, 0x26,
-  0xb6, 0xb7, 0xe8, 0x36, 0xe6, 0xb4, 0x86, 0x38, 0xe9, 0x8c, 0x16, 0x18,
-  0x4c, 0x55, 0xcc, 0xb8, 0x28, 0xb7, 0x82, 0xaa, 0x00, 0x7f, 0xfb, 0xa9,
-  0x97, 0x89, 0xc6, 0x1d, 0x2d, 0x6b, 0x9c, 0x05, 0xee, 0x28, 0x97, 0x71,
-  0x29, 0xa7, 0xdc, 0x30, 0x17, 0xe2, 0x60, 0x5e, 0x80, 0x4f, 0x7f, 0x75,
-  0x0b, 0x04, 0xfd, 0x65, 0x90, 0x17, 0x40, 0xc1, 0x78, 0x92, 0x3b, 0x3e,
-  0xb0, 0x94, 0x60, 0xa0, 0xf8, 0x90, 0xbe, 0x5f, 0x8f, 0x6f, 0x27, 0x6e,
-  0x66, 0x09, 0xbb, 0xbc, 0x22, 0x01, 0x04, 0xa1, 0x02, 0xd0, 0x13, 0xa7,
-  0xff, 0x17, 0x92, 0xdd, 0x8c, 0x98, 0xc5, 0x6f, 0xde, 0xd7, 0x5d, 0x36,
-  0x07, 0x9a, 0xc3, 0xe8, 0x4a, 0x31, 0xff, 0x9b, 0x1a, 0xe6, 0x45, 0x68,
-  0x7f, 0xaa, 0x8b, 0x1f, 0x3a, 0x97, 0xf4, 0xe7, 0x8d, 0xd3, 0xff, 0x23,
-  0x94, 0x51, 0xe5, 0xa4, 0x72, 0x12, 0x00, 0x31, 0xa0, 0xc7, 0x29, 0x2b,
-  0xc0, 0xf7, 0xef, 0xd9, 0xc3, 0xfe, 0x67, 0x0f, 0xc2, 0xec, 0x70, 0x69,
-  0xd7, 0x08, 0x50, 0xa0, 0x87, 0xd2, 0x44, 0x96, 0xcd, 0xe0, 0x9f, 0xef,
-  0x58, 0x51, 0x74, 0x33, 0x23, 0x66, 0x8a, 0x07, 0xa2, 0xaf, 0x53, 0xef,
-  0x0e, 0xc9, 0x45, 0x80, 0x20, 0x54, 0x00, 0x7e, 0xe5, 0x21, 0x6a, 0x66,
-  0x58, 0x13, 0xdf, 0x33, 0xa9, 0x76, 0xfe, 0xea, 0x9a, 0x79, 0x90, 0xa9,
-  0x90, 0xcd, 0x5f, 0x83, 0xaa, 0xf2, 0x42, 0xd6, 0xe4, 0xc6, 0x8f, 0x6f,
-  0x70, 0xba, 0xb7, 0x2c, 0xf0, 0xc9, 0x72, 0x1a, 0x9e, 0x72, 0xcb, 0x0e,
-  0xeb, 0xa8, 0x15, 0xe0, 0x8e, 0x7f, 0x7a, 0x15, 0x3c, 0x6e, 0x94, 0xb7,
-  0xc4, 0x93, 0xe5, 0x28, 0x05, 0xa3, 0x29, 0x3e, 0xf1, 0xb7, 0x47, 0x52,
-  0x5b, 0x5d, 0x7c, 0x48, 0xdf, 0xda, 0xc4, 0x7e, 0xb6, 0xa5, 0x07, 0x68,
-  0xf0, 0x48, 0x6e, 0x00, 0x41, 0x28, 0x67, 0x2c, 0x34, 0x0d, 0xee, 0x10,
-  0xcf, 0x24, 0xf6, 0x33, 0x6c, 0x14, 0x7f, 0xfa, 0x3f, 0x69, 0xf5, 0x0c,
-  0x96, 0x9d, 0xd6, 0x02, 0x83, 0xc9, 0xca, 0x08, 0xff, 0xb3, 0x34, 0xb4,
-  0x54, 0xf3, 0xe3, 0xaf, 0x6f, 0xe5, 0xd5, 0x6d, 0xa3, 0x4e, 0x9f, 0xfe,
-  0xd7, 0x02, 0x65, 0x95, 0x34, 0xc1, 0x5d, 0x76, 0xf3, 0x1c, 0x4e, 0x06,
-  0xaa, 0x80, 0x3a, 0xbb, 0x1b, 0xdf, 0xbd, 0x3f, 0xce, 0x05, 0x2b, 0xea,
-  0x98, 0x7d, 0x4a, 0x0b, 0x0c, 0xa7, 0xf3, 0xa1, 0x77, 0x25, 0x6a, 0x05,
-  0x20, 0x69, 0xe0, 0x9a, 0x57, 0x8b, 0x2f, 0x9a, 0xe1, 0x89, 0x75, 0xfd,
-  0x45, 0x37, 0xb5, 0x2f, 0x3b, 0xc2, 0xa9, 0xe1, 0x39, 0x28, 0x14, 0x06,
-  0x96, 0x58, 0x03, 0x84, 0xc9, 0x2d, 0x50, 0xd3, 0xc4, 0x34, 0x0c, 0x8c,
-  0x5c, 0x0e, 0xd3, 0x30, 0xfe, 0xeb, 0x5f, 0xce, 0xc0, 0x32, 0x4d, 0xb4,
-  0xa5, 0xd1, 0x5a, 0xa3, 0x00, 0xa5, 0x64, 0xb6, 0xd9, 0x74, 0xc8, 0xa5,
-  0xca, 0xe5, 0x23, 0x6a, 0x65, 0xb9, 0x7b, 0xf4, 0x55, 0x72, 0xba, 0xf8,
-  0x3d, 0xe8, 0x2b, 0x9f, 0x58, 0xc5, 0xaa, 0x33, 0xda, 0xd0, 0x43, 0x29,
-  0x28, 0xf7, 0xdf, 0xc7, 0xd2, 0xa8, 0x59, 0x61, 0x86, 0xdb, 0x47, 0x38,
-  0xe7, 0xbd, 0x7f, 0xc4, 0x74, 0xd6, 0xb2, 0x3b, 0x40, 0x3e, 0x64, 0xbd,
-  0xac, 0x4e, 0x52, 0xe5, 0xf8, 0x0b, 0x2b, 0xe0, 0x75, 0x60, 0xa9, 0x13,
-  0x8d, 0xaf, 0x5c, 0x56, 0xc3, 0x96, 0x57, 0xde, 0x05, 0xf1, 0x5c, 0x3e,
-  0xf9, 0x8e, 0x2a, 0xdd, 0x55, 0xaf, 0x6a, 0x7d, 0x64, 0x13, 0x39, 0x66,
-  0x1d, 0xf3, 0x00, 0x83, 0x93, 0x88, 0xd7, 0xbd, 0x38, 0xb2, 0x98, 0xeb,
-  0x6b, 0x57, 0xd2, 0x9d, 0x8b, 0x8a, 0x00, 0x10, 0xde, 0x7a, 0xca, 0x69,
-  0x0d, 0x5a, 0x63, 0x59, 0x16, 0xb9, 0x74, 0x86, 0x5c, 0x26, 0x8b, 0x69,
-  0x18, 0x80, 0xc6, 0xd2, 0x1a, 0x8d, 0x85, 0xdf, 0x17, 0xc4, 0x1f, 0x0e,
-  0xe2, 0xf5, 0xf9, 0xfe, 0x6c, 0x03, 0x51, 0x4a, 0x61, 0x9a, 0x26, 0x46,
-  0x36, 0x8b, 0x69, 0x98, 0x64, 0x53, 0x69, 0x4c, 0x33, 0x8b, 0xc2, 0x85,
-  0x52, 0x2e, 0x94, 0x4b, 0xe1, 0xf6, 0x78, 0xf1, 0x07, 0x03, 0x78, 0x7c,
-  0x5e, 0x50, 0x4a, 0x04, 0xc2, 0x21, 0xbf, 0x0a, 0x34, 0x6d, 0xde, 0x6a,
-  0x7e, 0x36, 0xfa, 0x1a, 0x4f, 0xc7, 0x8b, 0xbf, 0x21, 0xad, 0xad, 0xf6,
-  0x32, 0xb8, 0xf9, 0x1a, 0x3c, 0x11, 0x2f, 0x3a, 0x5a, 0xfe, 0xe9, 0x7f,
-  0x95, 0xd7, 0x05, 0xb3, 0xaa, 0xb8, 0xfc, 0xec, 0x87, 0x79, 0x78, 0x6d,
-  0xaf, 0xd3, 0xa7, 0xff, 0xfb, 0x29, 0x33, 0xf3, 0x3f, 0x80, 0xa7, 0x4c,
-  0x05, 0xef, 0xd7, 0x81, 0x4f, 0x38, 0x21, 0x02, 0xb6, 0xee, 0x1c, 0xe7,
-  0x87, 0xdf, 0xd8, 0xca, 0x07, 0x3f, 0x77, 0x3c, 0xec, 0x1d, 0x29, 0x5d,
-  0x15, 0xac, 0x40, 0x8f, 0x66, 0xf0, 0x2d, 0xac, 0xe3, 0x5b, 0xff, 0x70,
-  0x14, 0x37, 0x7d, 0xf2, 0xa5, 0xa2, 0x9b, 0x7a, 0x34, 0xb6, 0x9b, 0xa3,
-  0x83, 0x2d, 0xcc, 0xf3, 0xd5, 0x31, 0x68, 0x24, 0x70, 0x89, 0x0c, 0x98,
-  0xf6, 0x28, 0xa5, 0xb0, 0x4c, 0x8b, 0x5c, 0x36, 0x4b, 0x2e, 0x95, 0x26,
-  0x9d, 0x49, 0xa2, 0x50, 0x78, 0x7d, 0x01, 0x7c, 0x01, 0x3f, 0xb5, 0xcd,
-  0x8d, 0x54, 0xd5, 0xd7, 0x52, 0xdd, 0xd0, 0x40, 0xb8, 0xb6, 0x9a, 0x48,
-  0x7d, 0x1d, 0xe1, 0xda, 0x1a, 0xc2, 0x35, 0xd5, 0x84, 0xeb, 0x6a, 0x08,
-  0x84, 0x43, 0x28, 0xf5, 0x5f, 0x55, 0xe4, 0x94, 0x4b, 0x61, 0xe6, 0x0c,
-  0x32, 0xc9, 0x24, 0xb9, 0x4c, 0x96, 0x74, 0x22, 0x49, 0x7c, 0x64, 0x8c,
-  0x54, 0x2c, 0xc6, 0xf8, 0xe0, 0x30, 0xd1, 0xc1, 0x21, 0x92, 0xd1, 0x18,
-  0xa3, 0x7d, 0x03, 0xc4, 0x47, 0xc7, 0xc8, 0x65, 0x32, 0x58, 0x58, 0xf8,
-  0xfd, 0x41, 0x82, 0x91, 0x2a, 0x3c, 0x5e, 0x6f, 0xe5, 0x55, 0xa4, 0xb3,
-  0x69, 0xf3, 0xaf, 0x73, 0x07, 0xd9, 0x9d, 0x19, 0x9e, 0xd4, 0xe6, 0x0f,
-  0xf0, 0xe1, 0x1b, 0x16, 0xe1, 0x99, 0x57, 0x83, 0xde, 0x37, 0x56, 0xfe,
-  0xe6, 0x7f, 0x53, 0xc3, 0xfc, 0x6a, 0x7e, 0xfb, 0xdd, 0x2d, 0x4e, 0x6f,
-  0xfe, 0x90, 0xcf, 0xf9, 0xff, 0xc9, 0xb2, 0x5c, 0xe7, 0x65, 0xfc, 0x13,
-  0x6f, 0x02, 0x6a, 0x80, 0xf9, 0x76, 0x37, 0x5c, 0x15, 0xf6, 0x30, 0xb8,
-  0xe5, 0x1a, 0x02, 0xcd, 0x41, 0x74, 0x5f, 0xb2, 0x74, 0xaf, 0x02, 0x00,
-  0x15, 0xf2, 0x40, 0xc8, 0xc3, 0x92, 0x95, 0xf7, 0xb3, 0xbb, 0x33, 0x5e,
-  0x74, 0x3b, 0x6d, 0xde, 0x6a, 0x3e, 0xd3, 0x74, 0x06, 0x29, 0xcb, 0x20,
-  0xad, 0x0d, 0x91, 0x00, 0xd3, 0xf4, 0x84, 0x9f, 0x4b, 0x67, 0x48, 0x27,
-  0x12, 0xe4, 0x8c, 0x0c, 0x1e, 0x97, 0x8f, 0xea, 0xc6, 0x7a, 0x66, 0xcc,
-  0x6a, 0xa5, 0x61, 0x56, 0x1b, 0x0d, 0xb3, 0xdb, 0x98, 0xd1, 0x3a, 0x93,
-  0x48, 0x43, 0x1d, 0xb5, 0xcd, 0x4d, 0x44, 0xea, 0x6a, 0x71, 0x55, 0x85,
-  0xc1, 0xe5, 0x02, 0xaf, 0x17, 0xbc, 0x1e, 0xc8, 0xe5, 0xf2, 0xff, 0x4c,
-  0xf3, 0x2f, 0x8d, 0xa1, 0x4a, 0x81, 0xdb, 0x3d, 0xf1, 0xf7, 0x9e, 0xfc,
-  0xff, 0x1b, 0x66, 0xfe, 0xef, 0xb3, 0x39, 0xb2, 0xf1, 0x38, 0x63, 0x03,
-  0x83, 0x8c, 0xf4, 0xf4, 0x33, 0xd4, 0x75, 0x90, 0xb1, 0xbe, 0x01, 0xba,
-  0xda, 0x77, 0xd3, 0xd3, 0xbe, 0x87, 0x44, 0x32, 0x8a, 0x57, 0x79, 0x09,
-  0x84, 0xc3, 0xf8, 0x43, 0x41, 0x94, 0x4b, 0x8a, 0x5b, 0x43, 0xbe, 0xe2,
-  0x5f, 0x83, 0x27, 0xcc, 0xd7, 0x06, 0xd7, 0xb1, 0x33, 0x33, 0x34, 0xa9,
-  0x9d, 0xa0, 0xeb, 0xf9, 0xcb, 0x99, 0x75, 0xf4, 0x0c, 0x74, 0x6f, 0xaa,
-  0xbc, 0x77, 0x06, 0x4b, 0xa3, 0x5a, 0x42, 0x64, 0x87, 0x33, 0x34, 0x1f,
-  0xf9, 0x1b, 0xc6, 0x62, 0x8e, 0x86, 0xfd, 0xb5, 0x03, 0xdf, 0x9d, 0xf8,
-  0x27, 0x02, 0x60, 0x0a, 0x59, 0x09, 0xfc, 0x1a, 0x87, 0xae, 0x02, 0x3e,
-  0x70, 0xed, 0x7c, 0x7e, 0x78, 0xdf, 0x05, 0xd0, 0x39, 0x8e, 0x2e, 0xe5,
-  0xa8, 0x00, 0x53, 0xa3, 0x16, 0xd5, 0xf2, 0xcc, 0x2f, 0x76, 0x71, 0xd6,
-  0xcd, 0x6b, 0x27, 0xd5, 0xd4, 0x59, 0xe1, 0x79, 0xdc, 0x56, 0xbf, 0x9a,
-  0x83, 0xb9, 0xa8, 0xbc, 0x59, 0xa7, 0xc9, 0x29, 0xdf, 0xcc, 0x19, 0xa4,
-  0xe2, 0x09, 0xd2, 0xe9, 0x38, 0x5e, 0xb7, 0x9f, 0x9a, 0xe6, 0x06, 0x9a,
-  0xe7, 0xcd, 0x65, 0xd6, 0xb2, 0xc5, 0xb4, 0x2e, 0x59, 0x48, 0xd3, 0xbc,
-  0xd9, 0xd4, 0xb7, 0xb6, 0xe0, 0xae, 0xaf, 0x03, 0x8f, 0x27, 0x9f, 0x1b,
-  0xde, 0xb4, 0x20, 0x93, 0xc1, 0xca, 0x64, 0xb0, 0x0c, 0x33, 0xbf, 0xcf,
-  0x6b, 0x5d, 0xd4, 0x09, 0x5d, 0x29, 0xf5, 0x27, 0x73, 0xbf, 0xdb, 0xeb,
-  0x41, 0x05, 0x83, 0xe0, 0xf3, 0xe6, 0xfb, 0xb2, 0x2c, 0xcc, 0x91, 0x51,
-  0xba, 0xb6, 0xb7, 0xd3, 0xb5, 0x63, 0x27, 0x07, 0x77, 0xed, 0xa5, 0x7b,
-  0xc7, 0x2e, 0x86, 0x0f, 0xf6, 0x92, 0x33, 0xd2, 0x04, 0x82, 0x55, 0x84,
-  0x22, 0x55, 0xb8, 0xdc, 0xee, 0x69, 0x69, 0x1d, 0xb0, 0xd0, 0xb4, 0x7a,
-  0x22, 0xac, 0x4b, 0x1e, 0xe0, 0xc7, 0x23, 0x93, 0x4b, 0x6d, 0x7b, 0xe3,
-  0x95, 0x73, 0xf9, 0xc5, 0xef, 0x2e, 0x80, 0x8e, 0x68, 0xd9, 0xbb, 0x03,
-  0x2b, 0x8f, 0x82, 0xd9, 0x11, 0x6e, 0xbc, 0xec, 0x31, 0x7e, 0xf9, 0x48,
-  0x97, 0x93, 0x5d, 0x75, 0x00, 0xe3, 0xc0, 0x31, 0x65, 0x3b, 0x56, 0x65,
-  0xfe, 0x5b, 0xbf, 0x04, 0x34, 0x38, 0x61, 0x05, 0x00, 0xd8, 0xf8, 0xfb,
-  0xf3, 0x39, 0xe6, 0x8a, 0x79, 0xe8, 0x3d, 0xe3, 0xe0, 0x2e, 0x61, 0x2b,
-  0x80, 0xc7, 0x05, 0xb3, 0xc3, 0x5c, 0x72, 0xe6, 0xc3, 0x3c, 0xfa, 0x6c,
-  0xdf, 0xa4, 0xda, 0xfa, 0x58, 0xc3, 0x49, 0x1c, 0x15, 0x68, 0xa1, 0xd7,
-  0x88, 0xc9, 0x55, 0x40, 0x45, 0xee, 0xfa, 0x60, 0x19, 0x26, 0xc9, 0x68,
-  0x8c, 0x74, 0x26, 0x41, 0x30, 0x50, 0x45, 0xcb, 0x82, 0x79, 0xcc, 0x5d,
-  0xb9, 0x82, 0x79, 0x47, 0x1d, 0xc1, 0xcc, 0x25, 0x0b, 0x69, 0x68, 0x9b,
-  0x09, 0xb5, 0x35, 0xf9, 0x13, 0x7a, 0x3c, 0x81, 0x4e, 0xa7, 0x31, 0xb2,
-  0x39, 0xb4, 0x65, 0x4d, 0xdd, 0x95, 0x98, 0xd6, 0xa0, 0x14, 0x5e, 0x9f,
-  0x0f, 0x55, 0x5b, 0x0d, 0x7e, 0x3f, 0x24, 0x92, 0x44, 0xbb, 0x7b, 0xe8,
-  0x7e, 0x7d, 0x17, 0xfb, 0x36, 0x6e, 0x66, 0xdf, 0x6b, 0x5b, 0xe9, 0xdd,
-  0xdd, 0x41, 0xce, 0xcc, 0x50, 0x15, 0xa9, 0xc5, 0x1f, 0x0e, 0x4d, 0x1f,
-  0x6b, 0x0d, 0xf9, 0x82, 0x3f, 0x16, 0x9a, 0x2f, 0xf4, 0xaf, 0x9d, 0x54,
-  0xd6, 0x3f, 0x80, 0xf6, 0x35, 0x17, 0xb3, 0xe4, 0xcc, 0x99, 0xe8, 0xae,
-  0x44, 0x79, 0xef, 0x0a, 0xa6, 0x46, 0x2d, 0xaa, 0xe3, 0xc9, 0xff, 0xdc,
-  0xc9, 0xf9, 0xb7, 0x3e, 0xe3, 0x74, 0x6f, 0xed, 0xc0, 0xfb, 0x80, 0x17,
-  0x45, 0x00, 0x1c, 0x1e, 0xea, 0x80, 0x0d, 0x4e, 0x59, 0x01, 0x96, 0x2e,
-  0x88, 0xb0, 0x73, 0xcb, 0xd5, 0x90, 0x34, 0xd1, 0xb1, 0x5c, 0xe9, 0x8e,
-  0x96, 0xa5, 0x51, 0x73, 0x23, 0x74, 0xbf, 0x3a, 0xc4, 0xec, 0x93, 0x7e,
-  0x3f, 0xa9, 0xa6, 0xaa, 0xdd, 0x7e, 0x3e, 0xdb, 0x74, 0xd6, 0x44, 0x46,
-  0xb1, 0x34, 0x4a, 0x44, 0x40, 0x45, 0x9c, 0xf4, 0xb5, 0xd6, 0xa4, 0xe2,
-  0x09, 0x92, 0xf1, 0x71, 0xfc, 0xbe, 0x20, 0x6d, 0xcb, 0x16, 0xb3, 0xe8,
-  0xf8, 0xd5, 0x2c, 0x3a, 0xe1, 0x18, 0x66, 0x2f, 0x59, 0x88, 0xb7, 0xa5,
-  0x39, 0xff, 0xc7, 0x89, 0x24, 0x66, 0x22, 0x39, 0xe1, 0xdc, 0x57, 0x5a,
-  0xb8, 0x5c, 0x2e, 0x3c, 0xe1, 0x10, 0x44, 0xf2, 0x25, 0xb1, 0x73, 0x7d,
-  0x03, 0x74, 0x6c, 0xde, 0xc6, 0xf6, 0xe7, 0x36, 0xb0, 0xeb, 0xc5, 0x8d,
-  0x0c, 0x76, 0x77, 0xe1, 0x71, 0x7b, 0x89, 0xd4, 0xd7, 0xe1, 0xf6, 0x78,
-  0x2a, 0xde, 0x2a, 0xd0, 0xea, 0x8d, 0x70, 0xf7, 0xc8, 0x46, 0x9e, 0x4b,
-  0x74, 0x4e, 0xaa, 0x9d, 0x4b, 0xcf, 0x9e, 0xc9, 0xc3, 0x4f, 0x5f, 0x0e,
-  0xfb, 0xa3, 0xe5, 0x3d, 0x66, 0x96, 0x46, 0x35, 0x05, 0x31, 0x12, 0x06,
-  0x6d, 0x47, 0xfe, 0x86, 0x01, 0x67, 0x0b, 0x19, 0x75, 0x90, 0xcf, 0x4e,
-  0x7b, 0x5c, 0x39, 0xcf, 0x21, 0x77, 0x99, 0xaf, 0x81, 0x34, 0x70, 0xcd,
-  0x84, 0x20, 0xb6, 0x3d, 0x2c, 0x70, 0x78, 0x34, 0x4b, 0x9d, 0xa5, 0x38,
-  0xe9, 0x8a, 0x05, 0x30, 0x5a, 0xc2, 0x61, 0x31, 0x4a, 0xc1, 0x58, 0x86,
-  0x9a, 0x95, 0xcd, 0x64, 0x7b, 0xe3, 0xac, 0x7b, 0xb5, 0xf8, 0xbb, 0xc0,
-  0x8c, 0x36, 0xe9, 0x31, 0x62, 0x9c, 0x11, 0x9e, 0x4b, 0x46, 0x9b, 0x92,
-  0x1f, 0xa0, 0xcc, 0x37, 0x7e, 0x33, 0x67, 0x30, 0x3e, 0x34, 0x4c, 0x32,
-  0x16, 0xa5, 0xae, 0xb9, 0x99, 0xe3, 0x2f, 0xbd, 0x90, 0xf3, 0x6e, 0xbf,
-  0x99, 0x73, 0x6f, 0xbb, 0x81, 0x25, 0x17, 0x9e, 0x43, 0x5d, 0x5b, 0x2b,
-  0x6e, 0xc3, 0x24, 0x3b, 0x3a, 0x86, 0x19, 0x8d, 0x61, 0x66, 0xb2, 0xf9,
-  0x93, 0x7e, 0x29, 0x9e, 0x7a, 0xb5, 0xc6, 0xcc, 0x66, 0xf3, 0x9f, 0x33,
-  0x9e, 0xc0, 0x17, 0xf0, 0x33, 0xe3, 0xc8, 0xe5, 0x2c, 0x3f, 0xfb, 0x74,
-  0x56, 0x9e, 0x72, 0x3c, 0xcd, 0xf3, 0xe6, 0x91, 0x4b, 0xa5, 0xe9, 0xef,
-  0x38, 0x40, 0x3c, 0x3a, 0x86, 0xd7, 0xeb, 0xc3, 0xe3, 0xad, 0xbc, 0xd2,
-  0xd7, 0x16, 0x9a, 0x26, 0x4f, 0x15, 0xdb, 0xd2, 0x03, 0xfc, 0xbf, 0xf1,
-  0x6d, 0x93, 0x6e, 0xef, 0xbe, 0xef, 0x9c, 0x42, 0xcb, 0xa2, 0x08, 0x7a,
-  0x34, 0x53, 0xd6, 0xa1, 0x7f, 0xca, 0xe3, 0x82, 0xa6, 0x2a, 0x3e, 0x74,
-  0xeb, 0x5a, 0x9e, 0x9b, 0xc4, 0x3b, 0xf0, 0x10, 0x19, 0x00, 0x2e, 0x26,
-  0x9f, 0xa0, 0xae, 0x7c, 0xc7, 0xac, 0x02, 0xd6, 0x83, 0x1b, 0xd8, 0xee,
-  0x94, 0x15, 0x40, 0x29, 0x38, 0xb0, 0xfe, 0x0a, 0x66, 0x1d, 0xdf, 0x80,
-  0xee, 0x88, 0x97, 0xee, 0x55, 0x80, 0x06, 0x55, 0xe7, 0x43, 0xe7, 0x2c,
-  0x66, 0xaf, 0xfa, 0x2d, 0x07, 0xfb, 0x27, 0x97, 0xc7, 0xfb, 0xdd, 0x35,
-  0x47, 0x70, 0x59, 0xf5, 0x12, 0x0e, 0xe6, 0xa2, 0x62, 0x05, 0x28, 0xb7,
-  0x45, 0xed, 0x72, 0x91, 0x49, 0x24, 0x88, 0x8e, 0x8f, 0x10, 0x0a, 0x46,
-  0x58, 0x70, 0xcc, 0x2a, 0x8e, 0x3a, 0xff, 0x4c, 0x96, 0x9e, 0x78, 0x1c,
-  0xe1, 0x05, 0x73, 0xc1, 0xb2, 0x60, 0x74, 0x8c, 0x6c, 0xba, 0x02, 0x4a,
-  0xbd, 0x6a, 0x8d, 0x72, 0xb9, 0xf0, 0x46, 0xaa, 0xa0, 0xa6, 0x1a, 0xc6,
-  0xa3, 0xec, 0x7b, 0x79, 0x13, 0x1b, 0x1f, 0x7d, 0x92, 0xed, 0xcf, 0x6e,
-  0x20, 0x3a, 0x3e, 0x44, 0xa4, 0x7a, 0x06, 0x81, 0xaa, 0x70, 0xc9, 0x0a,
-  0x9b, 0x02, 0x97, 0x39, 0x21, 0xe5, 0xc1, 0xad, 0x5c, 0xfc, 0xcb, 0xc0,
-  0x33, 0x0c, 0x18, 0x89, 0x49, 0xb5, 0x77, 0xd5, 0x79, 0x6d, 0x3c, 0xb0,
-  0xe6, 0x12, 0xe8, 0x8c, 0x95, 0xb6, 0xaf, 0xd3, 0x3b, 0x61, 0x5a, 0xa8,
-  0x45, 0xf5, 0x3c, 0xf9, 0xf3, 0x9d, 0x9c, 0x7f, 0x8b, 0xe3, 0xa6, 0xff,
-  0x0e, 0xa0, 0x0f, 0x38, 0xa5, 0x12, 0x36, 0xcf, 0x4a, 0x58, 0x13, 0xa9,
-  0x09, 0x01, 0xd0, 0xe0, 0x44, 0x07, 0x1b, 0xb7, 0x8c, 0x70, 0xeb, 0x87,
-  0x96, 0xa3, 0x32, 0x26, 0xe4, 0x74, 0x69, 0xca, 0x26, 0x05, 0x24, 0x0c,
-  0xd4, 0xec, 0x6a, 0x96, 0xd7, 0xfa, 0xb8, 0xe7, 0xa1, 0x03, 0x93, 0x6a,
-  0x6e, 0x67, 0x66, 0x88, 0xa5, 0x81, 0x06, 0x66, 0x79, 0xaa, 0x89, 0xeb,
-  0xac, 0x88, 0x80, 0x32, 0x90, 0xf2, 0x4a, 0x29, 0x52, 0xb1, 0x38, 0xa3,
-  0x23, 0x7d, 0x84, 0xc3, 0xd5, 0x1c, 0x77, 0xc9, 0x85, 0x5c, 0x72, 0xc7,
-  0xed, 0x9c, 0x7d, 0xdb, 0x8d, 0xcc, 0x3c, 0xfe, 0x18, 0x7c, 0x2e, 0x17,
-  0xd9, 0xa1, 0x11, 0xcc, 0x58, 0x1c, 0xd3, 0x34, 0x2b, 0xc5, 0xcc, 0x91,
-  0x7f, 0xff, 0x67, 0xb2, 0x18, 0xe3, 0x51, 0x5c, 0x5a, 0x53, 0x7f, 0xc4,
-  0x32, 0x56, 0x9c, 0x7b, 0x3a, 0xcb, 0x8e, 0x3b, 0x1a, 0xaf, 0x37, 0xc0,
-  0xc0, 0xbe, 0x4e, 0x86, 0x07, 0x7b, 0xf0, 0x79, 0xfc, 0x78, 0x7c, 0xbe,
-  0xbc, 0x7f, 0x41, 0x19, 0x9f, 0xd8, 0x9a, 0xbc, 0x55, 0xdc, 0x3b, 0xb6,
-  0x85, 0xed, 0x99, 0xc1, 0x49, 0xb7, 0xf7, 0xd0, 0x7f, 0x9c, 0x41, 0xfd,
-  0xec, 0x70, 0x79, 0x9f, 0xfe, 0x2d, 0x8d, 0x9a, 0x19, 0x22, 0x3b, 0x98,
-  0xe4, 0xb4, 0x2b, 0xd7, 0x90, 0x48, 0x39, 0x3e, 0xb7, 0x07, 0xc8, 0x27,
-  0xa4, 0x2b, 0xfb, 0x7c, 0xc9, 0xee, 0xca, 0x78, 0x0b, 0xb0, 0x09, 0xb8,
-  0x8d, 0xfc, 0x95, 0x80, 0xed, 0x57, 0x01, 0x9d, 0x3d, 0x49, 0x66, 0x79,
-  0x14, 0xab, 0x2f, 0x5d, 0x80, 0x1a, 0x29, 0xe1, 0xab, 0x00, 0x97, 0x42,
-  0xc5, 0x73, 0x2c, 0x3e, 0xbb, 0x95, 0x57, 0x9f, 0xed, 0x65, 0xd7, 0xfe,
-  0xe2, 0xc3, 0x02, 0xf5, 0x84, 0x08, 0x38, 0x25, 0x3c, 0x07, 0xbf, 0xf2,
-  0x90, 0xd5, 0x86, 0x88, 0x80, 0x12, 0x3e, 0xf1, 0xa7, 0xa2, 0x31, 0xc6,
-  0x46, 0x06, 0xa8, 0x6b, 0x6a, 0xe6, 0xd4, 0x77, 0xbf, 0x8b, 0x2b, 0x3e,
-  0x79, 0x07, 0xc7, 0xbe, 0xf7, 0x6a, 0x6a, 0xdb, 0x66, 0x62, 0xc6, 0x62,
-  0x18, 0x23, 0x63, 0x98, 0xd9, 0xdc, 0x9f, 0x6d, 0x9a, 0x15, 0x37, 0x0e,
-  0x4a, 0x61, 0x59, 0x16, 0x46, 0x34, 0x86, 0x4e, 0xa5, 0xa9, 0x99, 0x3b,
-  0x9b, 0xa5, 0x17, 0x9e, 0xc3, 0x91, 0x27, 0x1e, 0x07, 0x86, 0x45, 0xcf,
-  0xae, 0x3d, 0x8c, 0x8f, 0x0c, 0xe1, 0x0f, 0x04, 0x71, 0x7b, 0x3c, 0x65,
-  0x27, 0x04, 0x2c, 0x34, 0x2d, 0x9e, 0x2a, 0x36, 0xa5, 0x7b, 0xb9, 0x6f,
-  0x7c, 0xfb, 0xa4, 0xdb, 0xbb, 0xf5, 0x9a, 0x79, 0xfc, 0xd5, 0xff, 0x5e,
-  0x8d, 0xee, 0x8c, 0x96, 0xef, 0x9c, 0xd0, 0xa0, 0xfc, 0x6e, 0x68, 0x08,
-  0x71, 0xcb, 0x0d, 0x4f, 0xf3, 0xc2, 0x96, 0x11, 0xa7, 0x7b, 0x6c, 0x07,
-  0xd6, 0x00, 0x0f, 0x55, 0xc8, 0xb9, 0xa1, 0x62, 0x68, 0x23, 0x5f, 0x87,
-  0xd9, 0x91, 0xab, 0x00, 0xaf, 0x57, 0x71, 0xe0, 0xa5, 0xab, 0x68, 0x39,
-  0xa2, 0x1e, 0xdd, 0x19, 0x2b, 0xdd, 0xab, 0x00, 0x4b, 0xa3, 0x66, 0x55,
-  0x31, 0xd4, 0x3e, 0x4a, 0xcb, 0xea, 0xdf, 0x61, 0x9a, 0x93, 0x7b, 0xc9,
-  0x1d, 0x1d, 0x6c, 0xe1, 0x63, 0x33, 0x4e, 0x62, 0xc8, 0x4c, 0x92, 0xd3,
-  0x92, 0x2a, 0xb8, 0xd4, 0x36, 0xfe, 0x74, 0x22, 0x41, 0x74, 0x7c, 0x98,
-  0xc6, 0xe6, 0x36, 0x8e, 0xbb, 0xfc, 0x22, 0x4e, 0x7e, 0xd7, 0xa5, 0x54,
-  0x2d, 0x59, 0x08, 0x89, 0x04, 0xb9, 0xe1, 0xd1, 0xbc, 0x53, 0xd7, 0x74,
-  0xcd, 0xa8, 0xa7, 0x35, 0x4a, 0x29, 0xbc, 0x33, 0xea, 0x21, 0xe0, 0xa7,
-  0xfb, 0xa5, 0x8d, 0x3c, 0xf3, 0xf3, 0xfb, 0xd8, 0xfa, 0xe4, 0x33, 0x68,
-  0xa0, 0xb6, 0xb9, 0xf1, 0x4f, 0x0e, 0x92, 0xa5, 0xbf, 0xcf, 0x69, 0x22,
-  0x2e, 0x3f, 0x86, 0xb6, 0xf8, 0xc2, 0xc0, 0xe4, 0xbd, 0xfe, 0x01, 0xfa,
-  0x5f, 0xbd, 0x8a, 0xa6, 0x15, 0xb5, 0xe8, 0x83, 0xa5, 0x9d, 0xeb, 0xe4,
-  0x6d, 0x99, 0xf0, 0xfa, 0x7f, 0xe0, 0x7b, 0xdb, 0xb8, 0xfa, 0xaf, 0x9f,
-  0x77, 0xba, 0xb7, 0x0e, 0xf2, 0x77, 0xfe, 0x47, 0x55, 0xca, 0x12, 0x71,
-  0x57, 0xd0, 0x72, 0x8f, 0x01, 0xef, 0x21, 0x5f, 0x2f, 0xc0, 0x76, 0x2b,
-  0x80, 0x65, 0xc1, 0xcb, 0xaf, 0x0c, 0x71, 0xdb, 0x87, 0x97, 0xa3, 0x72,
-  0x16, 0xe4, 0xac, 0x12, 0xbd, 0x0a, 0x50, 0x30, 0x9e, 0x25, 0xbc, 0xbc,
-  0x81, 0x26, 0xcb, 0xe2, 0x91, 0x67, 0x26, 0x97, 0x05, 0xab, 0xcf, 0x88,
-  0xe3, 0x42, 0x71, 0x5c, 0xa8, 0x8d, 0xa8, 0x95, 0x11, 0x01, 0x50, 0x22,
-  0x1b, 0xbf, 0x99, 0xcb, 0x31, 0xdc, 0xdf, 0x4b, 0xc0, 0x1f, 0xe4, 0xf4,
-  0x6b, 0xaf, 0xe6, 0xdd, 0x9f, 0xfb, 0x04, 0x2b, 0xae, 0xbc, 0x08, 0x9f,
-  0xc7, 0x43, 0x76, 0x60, 0x10, 0x33, 0x39, 0x61, 0xa9, 0x9a, 0xce, 0xe9,
-  0x74, 0x27, 0xbe, 0xbb, 0x91, 0x4c, 0xa2, 0xe3, 0x09, 0xea, 0x16, 0x2d,
-  0x60, 0xd5, 0x25, 0xe7, 0x31, 0x67, 0xd9, 0x62, 0x46, 0x7b, 0xfa, 0xe8,
-  0xde, 0xd3, 0x8e, 0xd2, 0x2e, 0xfc, 0xc1, 0x40, 0xc9, 0x8b, 0x00, 0x8f,
-  0x72, 0x53, 0xe7, 0x0e, 0xf0, 0xc3, 0x91, 0x57, 0xd8, 0x9f, 0x1b, 0x9b,
-  0x74, 0x7b, 0x5f, 0xfa, 0xf8, 0x91, 0x5c, 0x74, 0xdb, 0x72, 0xf4, 0x81,
-  0x58, 0x79, 0x6f, 0xfe, 0x73, 0xaa, 0x18, 0xd9, 0x35, 0xc6, 0x49, 0x57,
-  0xae, 0xc1, 0x72, 0xde, 0x87, 0x61, 0x00, 0xb8, 0x01, 0xe8, 0xaf, 0x94,
-  0x25, 0xe2, 0xae, 0xb0, 0x25, 0xff, 0x33, 0xe0, 0xc3, 0x38, 0xe4, 0x0b,
-  0xd0, 0xd9, 0x9b, 0xa4, 0x45, 0x29, 0x8e, 0xbb, 0x6c, 0x7e, 0x69, 0x47,
-  0x05, 0xa0, 0x50, 0x59, 0x83, 0xe3, 0x2e, 0x9c, 0xc5, 0xa3, 0xbf, 0xdb,
-  0xcf, 0xc1, 0x81, 0xc9, 0x9d, 0x16, 0x76, 0x66, 0x86, 0x58, 0xe8, 0xaf,
-  0x63, 0xbe, 0xaf, 0x8e, 0x98, 0x95, 0x91, 0xab, 0x80, 0xc3, 0xb6, 0x9f,
-  0xe5, 0x13, 0xe6, 0x8c, 0xf5, 0x0f, 0x92, 0x4e, 0x24, 0x38, 0xe1, 0xd2,
-  0x8b, 0x79, 0xf7, 0x67, 0x3f, 0xc1, 0x31, 0xd7, 0xbf, 0x0b, 0xbf, 0xcf,
-  0x47, 0xb6, 0xb7, 0x1f, 0x33, 0x9d, 0x91, 0x8d, 0xff, 0x4d, 0xc6, 0x0d,
-  0xc0, 0x88, 0xc5, 0x50, 0xe9, 0x0c, 0x8d, 0xc7, 0x1c, 0xc9, 0xf1, 0x17,
-  0x9c, 0x43, 0x55, 0x4d, 0x2d, 0x07, 0xb6, 0xec, 0x60, 0x78, 0xb0, 0x97,
-  0x40, 0x30, 0x8c, 0xcb, 0x5d, 0x9a, 0xaf, 0x43, 0x0d, 0xcc, 0xf4, 0x54,
-  0xf1, 0x44, 0x7c, 0x2f, 0x4f, 0xc6, 0x27, 0x5f, 0xcf, 0xbe, 0xad, 0x39,
-  0xc8, 0x03, 0xf7, 0x9d, 0x03, 0x29, 0x03, 0xd2, 0x56, 0x79, 0xda, 0x81,
-  0x35, 0xa8, 0xb0, 0x17, 0x6a, 0x7c, 0x5c, 0x73, 0xcd, 0x93, 0xb4, 0xef,
-  0x77, 0xdc, 0x19, 0xff, 0x8d, 0xb0, 0xbf, 0x2f, 0x56, 0xd2, 0xda, 0xa8,
-  0x34, 0x01, 0xa0, 0x81, 0x3d, 0xc0, 0xf1, 0x4e, 0x89, 0x80, 0x47, 0xd6,
-  0xf6, 0x72, 0xd3, 0xb9, 0x2d, 0xcc, 0x38, 0x7a, 0x06, 0x0c, 0x67, 0x4a,
-  0x53, 0x3d, 0x2b, 0x20, 0x6d, 0xa2, 0xea, 0xfd, 0x5c, 0x78, 0x5c, 0x03,
-  0x77, 0xdd, 0xdd, 0x3e, 0xe9, 0x26, 0xb7, 0xa5, 0x07, 0x38, 0x36, 0xd8,
-  0x4a, 0xad, 0x3b, 0x40, 0x52, 0xe7, 0x44, 0x04, 0x4c, 0x31, 0x2e, 0x97,
-  0x8b, 0x4c, 0x2a, 0xc5, 0xc8, 0x50, 0x2f, 0xb3, 0x17, 0x2f, 0xe1, 0xea,
-  0x4f, 0xdf, 0xc9, 0x59, 0x77, 0xdc, 0x4e, 0xd5, 0x8c, 0x3a, 0xb2, 0xbd,
-  0xfd, 0x18, 0xa9, 0xd4, 0x9f, 0xb2, 0xea, 0x09, 0x6f, 0x2d, 0x04, 0xb4,
-  0xd6, 0x18, 0x63, 0xe3, 0x78, 0x3c, 0x1e, 0xe6, 0x9c, 0x75, 0x1a, 0x47,
-  0x9d, 0x76, 0x12, 0xa9, 0xb1, 0x38, 0xfb, 0x36, 0x6f, 0xc6, 0x32, 0x2c,
-  0x02, 0xa1, 0x50, 0x49, 0x59, 0x03, 0x2c, 0x34, 0x8d, 0x9e, 0x30, 0xfb,
-  0xb2, 0xa3, 0xfc, 0xfb, 0xf0, 0x2b, 0xb6, 0x04, 0xe5, 0xde, 0xfb, 0xad,
-  0x93, 0x58, 0x72, 0x5a, 0x1b, 0xfa, 0x60, 0xbc, 0x7c, 0x4f, 0xff, 0x80,
-  0x9a, 0x5d, 0xc3, 0x5d, 0x9f, 0x7e, 0x91, 0xef, 0xde, 0xb3, 0x77, 0x2a,
-  0xba, 0x1b, 0x00, 0x4e, 0x00, 0xcc, 0x4a, 0x5a, 0x13, 0xee, 0x0a, 0x5c,
-  0xe7, 0x7b, 0x80, 0x5b, 0x80, 0x2c, 0x0e, 0x5c, 0x05, 0x00, 0xfc, 0x71,
-  0x5d, 0x1f, 0x1f, 0xfd, 0xc0, 0xb2, 0x7c, 0xdc, 0x69, 0xca, 0x28, 0xcd,
-  0x97, 0xae, 0x4b, 0xa1, 0xc6, 0x32, 0xd4, 0xac, 0x6c, 0xa2, 0x2e, 0x6b,
-  0xf0, 0xd8, 0x73, 0x93, 0xcb, 0x10, 0x98, 0xd5, 0x26, 0x7b, 0x32, 0x23,
-  0x9c, 0x11, 0x9e, 0x8b, 0x52, 0x8a, 0x9c, 0x36, 0x45, 0x04, 0x4c, 0xe1,
-  0xa9, 0x7f, 0xb4, 0xb7, 0x1f, 0xcb, 0x30, 0x39, 0xf7, 0xd6, 0x9b, 0xb8,
-  0xfe, 0xf3, 0xff, 0x40, 0xf3, 0xea, 0x55, 0x18, 0xbd, 0xfd, 0xe4, 0xa2,
-  0xb1, 0x3f, 0xfd, 0x8d, 0x70, 0xe8, 0x63, 0x6a, 0x66, 0x73, 0x98, 0x63,
-  0xe3, 0x84, 0xdb, 0x5a, 0x38, 0xf2, 0xe2, 0x73, 0x69, 0x68, 0x6c, 0xa2,
-  0x73, 0xf3, 0x76, 0x86, 0xfa, 0x0f, 0x12, 0x0c, 0x55, 0xe1, 0x2a, 0x81,
-  0x5a, 0x03, 0x16, 0x9a, 0x6a, 0x97, 0x1f, 0x0b, 0xcd, 0xb7, 0x86, 0x36,
-  0x90, 0xb0, 0x26, 0x5f, 0xa1, 0xef, 0x92, 0x33, 0x5a, 0xf8, 0xe7, 0xef,
-  0x9c, 0x02, 0x07, 0xe3, 0x94, 0x6d, 0x8a, 0x0f, 0x53, 0xa3, 0x16, 0x56,
-  0xd3, 0xfe, 0x6c, 0x0f, 0x97, 0xbd, 0xff, 0xb9, 0xa9, 0xe8, 0xb1, 0x9d,
-  0x7c, 0xb5, 0xbf, 0x35, 0x95, 0xb6, 0x16, 0xdc, 0x15, 0xba, 0xc6, 0xef,
-  0x01, 0x6e, 0x77, 0xca, 0x0a, 0x30, 0x30, 0x92, 0x21, 0xd5, 0x97, 0xe2,
-  0xfc, 0xeb, 0x96, 0xa0, 0x62, 0x99, 0x12, 0x5e, 0x48, 0x0a, 0x95, 0x33,
-  0x38, 0xf1, 0xd2, 0x39, 0x3c, 0xf1, 0xfb, 0x03, 0x74, 0x4f, 0x32, 0x37,
-  0xc0, 0x98, 0x95, 0x66, 0xc8, 0x4c, 0x72, 0x6a, 0x78, 0x0e, 0x19, 0x6d,
-  0x62, 0xa2, 0x45, 0x02, 0x38, 0xf9, 0xeb, 0xb9, 0x5c, 0xe4, 0x32, 0x19,
-  0x86, 0x06, 0x7b, 0x98, 0xb7, 0xe2, 0x08, 0x6e, 0xf8, 0xf2, 0x67, 0x39,
-  0xf6, 0x96, 0xeb, 0x71, 0x65, 0x32, 0x64, 0xfb, 0x07, 0xd1, 0x20, 0x1b,
-  0x7f, 0xf1, 0x2a, 0x00, 0x94, 0xc2, 0x88, 0x27, 0x70, 0x65, 0x73, 0xb4,
-  0x9e, 0x76, 0x22, 0x47, 0x9f, 0x79, 0x0a, 0xe3, 0x3d, 0x83, 0xec, 0xdd,
-  0xb6, 0x05, 0x85, 0xfb, 0xb0, 0xfa, 0x06, 0x68, 0xc0, 0xa7, 0xdc, 0xd4,
-  0xb8, 0x03, 0xfc, 0x60, 0xe4, 0x15, 0xf6, 0x65, 0x27, 0xef, 0xdd, 0xee,
-  0x76, 0x2b, 0xd6, 0x3f, 0x7c, 0x21, 0xa1, 0x1a, 0x5f, 0xf9, 0x86, 0xfd,
-  0x59, 0x1a, 0xd5, 0x18, 0x80, 0x8c, 0xc9, 0x69, 0x17, 0x3d, 0xca, 0xf0,
-  0x98, 0xe3, 0x65, 0x8b, 0x3b, 0x80, 0x28, 0x70, 0x5d, 0x25, 0x2e, 0x83,
-  0x4a, 0x15, 0x00, 0x39, 0x60, 0x2e, 0x30, 0xc3, 0x29, 0x11, 0xf0, 0xfc,
-  0xa6, 0x61, 0x4e, 0x5b, 0x18, 0x66, 0xc1, 0x19, 0xb3, 0x60, 0x38, 0x55,
-  0xda, 0x57, 0x01, 0xb5, 0x7e, 0x2e, 0x39, 0xa9, 0x91, 0x6f, 0xfe, 0x68,
-  0xe7, 0xa4, 0x9b, 0xec, 0xce, 0x45, 0x51, 0xc0, 0x71, 0xa1, 0x36, 0x62,
-  0x56, 0x06, 0xc1, 0x21, 0x03, 0x8e, 0xdb, 0x45, 0x7c, 0x64, 0x94, 0x54,
-  0x2c, 0xc6, 0xd9, 0xef, 0xbd, 0x8e, 0x1b, 0xbf, 0xf2, 0x39, 0x6a, 0x97,
-  0x2c, 0x24, 0x77, 0xa0, 0x1b, 0x33, 0x93, 0xc9, 0x57, 0xd4, 0x13, 0x6c,
-  0xb1, 0x06, 0x58, 0xa6, 0x85, 0x39, 0x3a, 0x46, 0x68, 0x66, 0x33, 0xab,
-  0x2e, 0xbd, 0x80, 0xaa, 0x60, 0x15, 0xbb, 0x5f, 0x78, 0x99, 0xc4, 0x78,
-  0x94, 0x60, 0x24, 0x72, 0x58, 0xc2, 0x05, 0x15, 0x30, 0xd3, 0x1b, 0xe1,
-  0xb7, 0xd1, 0x1d, 0x3c, 0x9b, 0xd8, 0x6f, 0x4b, 0x9b, 0xff, 0xfe, 0xf9,
-  0x63, 0x39, 0xed, 0xdd, 0x8b, 0xf3, 0x61, 0x7f, 0xe5, 0x68, 0xfa, 0xd7,
-  0xa0, 0xbc, 0x2e, 0x68, 0xae, 0xe2, 0xaf, 0x6f, 0x5b, 0xcb, 0x63, 0xeb,
-  0xa6, 0xc4, 0x17, 0x6f, 0x00, 0xb8, 0x10, 0x88, 0x57, 0xe2, 0xfc, 0x77,
-  0x57, 0xf0, 0xda, 0x5e, 0x03, 0xdc, 0x0a, 0x64, 0x70, 0xe8, 0x2a, 0xe0,
-  0xb7, 0x8f, 0x75, 0xf3, 0xd1, 0xf7, 0xcc, 0x27, 0x38, 0xb7, 0x0a, 0xc6,
-  0xb2, 0xa5, 0xb9, 0xa8, 0x5c, 0xf9, 0x34, 0xc1, 0x91, 0x23, 0x1a, 0x58,
-  0x5a, 0xe3, 0xe5, 0xfe, 0xc7, 0xbb, 0x27, 0xdd, 0xe4, 0xce, 0xcc, 0x10,
-  0xcd, 0x9e, 0x30, 0xcb, 0x03, 0x8d, 0x13, 0x91, 0x01, 0x72, 0x0a, 0xb5,
-  0xf3, 0x64, 0xaa, 0x5c, 0x8a, 0xe1, 0x9e, 0x5e, 0x42, 0xe1, 0x2a, 0xde,
-  0xfb, 0xc5, 0xcf, 0x70, 0xda, 0x47, 0xff, 0x0a, 0x95, 0xc9, 0x92, 0xe9,
-  0x1f, 0x14, 0x07, 0x3f, 0xa7, 0x76, 0xdb, 0x09, 0x6b, 0x80, 0xdb, 0x30,
-  0x99, 0x73, 0xee, 0x19, 0x2c, 0x5b, 0xbd, 0x8a, 0x03, 0x9b, 0xb7, 0x73,
-  0xb0, 0x73, 0x2f, 0xa1, 0x50, 0x64, 0x4a, 0xaf, 0x04, 0x2c, 0x34, 0x33,
-  0x3d, 0x11, 0x5e, 0x4a, 0x75, 0x73, 0xcf, 0xd8, 0x16, 0x5b, 0xda, 0x3c,
-  0xff, 0xe4, 0x66, 0xbe, 0xfd, 0xb3, 0x33, 0xa1, 0x37, 0x0e, 0x86, 0x2e,
-  0x4f, 0xc7, 0x3f, 0x4b, 0xa3, 0xe6, 0xd7, 0xf2, 0xf0, 0x8f, 0xb6, 0x73,
-  0xe7, 0x97, 0x37, 0x4f, 0x45, 0x8f, 0xed, 0xc0, 0x0e, 0xe0, 0xee, 0x4a,
-  0x9d, 0xfa, 0xee, 0x0a, 0x5f, 0xda, 0xbf, 0x99, 0x10, 0x01, 0x8e, 0x58,
-  0x01, 0x72, 0x86, 0xe6, 0xe5, 0x17, 0x07, 0x78, 0xdf, 0x07, 0x97, 0xa1,
-  0x74, 0xfe, 0xb4, 0x5d, 0x9a, 0x2f, 0x67, 0x85, 0x4a, 0xe6, 0x38, 0xf2,
-  0x82, 0x39, 0x6c, 0x7b, 0xbe, 0x8f, 0xd7, 0xf7, 0x4d, 0xde, 0x63, 0x76,
-  0x73, 0xba, 0x8f, 0xe5, 0xfe, 0x46, 0x66, 0x79, 0x6b, 0x88, 0x5b, 0x92,
-  0x29, 0xd0, 0xae, 0xd3, 0xa8, 0x36, 0x2d, 0x06, 0xfb, 0xba, 0x99, 0xbf,
-  0x7c, 0x05, 0xb7, 0x7d, 0xe7, 0xcb, 0xcc, 0x3b, 0xeb, 0x34, 0x8c, 0xee,
-  0x1e, 0x72, 0xc9, 0x14, 0x4a, 0x4e, 0xfd, 0xce, 0x5b, 0x03, 0x0c, 0x03,
-  0x6b, 0x6c, 0x9c, 0xda, 0xe5, 0x8b, 0x59, 0x7d, 0xde, 0x59, 0x8c, 0x75,
-  0xf5, 0xb3, 0x67, 0xeb, 0x6b, 0xf8, 0x3c, 0x3e, 0xbc, 0x3e, 0x9f, 0xe3,
-  0x57, 0x02, 0x16, 0x9a, 0x26, 0x77, 0x98, 0x2e, 0x23, 0xca, 0xbf, 0x0e,
-  0xbd, 0x80, 0x69, 0xc3, 0xfd, 0xa2, 0xcf, 0xeb, 0xe2, 0xf9, 0x87, 0x2f,
-  0x24, 0x5c, 0xe3, 0x43, 0x0f, 0x65, 0xca, 0xf3, 0xf4, 0x6f, 0x6a, 0xd4,
-  0xdc, 0x2a, 0x86, 0x77, 0x8d, 0x71, 0xc6, 0x35, 0x4f, 0x92, 0xcd, 0x39,
-  0x9e, 0xd6, 0xb9, 0x83, 0x7c, 0x62, 0xb9, 0xb3, 0x2a, 0x79, 0xce, 0x57,
-  0xba, 0x00, 0x48, 0x91, 0xf7, 0xdc, 0x0c, 0x38, 0x25, 0x02, 0x3a, 0x0e,
-  0x26, 0xc9, 0xf6, 0xa6, 0x38, 0xf7, 0x0d, 0x7f, 0x00, 0x8b, 0xd2, 0x53,
-  0xd7, 0x0a, 0xc8, 0x59, 0x28, 0x9f, 0x8b, 0x77, 0x5d, 0x32, 0x9b, 0xbb,
-  0x7f, 0xbe, 0x9b, 0x58, 0x72, 0x72, 0x59, 0x2c, 0x2d, 0x34, 0x5b, 0x52,
-  0x7d, 0x9c, 0x10, 0x6a, 0xa3, 0x46, 0x22, 0x03, 0x26, 0xff, 0x13, 0xb9,
-  0x5c, 0xe4, 0xb2, 0x59, 0x86, 0x86, 0xba, 0x39, 0xfe, 0xdc, 0x0b, 0xb8,
-  0xed, 0xdf, 0xbe, 0x4a, 0xb8, 0xb5, 0x85, 0xec, 0x81, 0x83, 0x68, 0xb4,
-  0xdc, 0xf5, 0x4f, 0xa1, 0x05, 0x06, 0xc0, 0x18, 0x8d, 0xe2, 0xaf, 0xab,
-  0x65, 0xd5, 0x15, 0x17, 0x11, 0xd0, 0x2e, 0xb6, 0x3d, 0xf7, 0x3c, 0x66,
-  0xce, 0x24, 0x10, 0x0e, 0x3b, 0x26, 0x02, 0x2c, 0x34, 0xb5, 0xee, 0x00,
-  0x69, 0x6d, 0xf0, 0x8d, 0xc1, 0xf5, 0xc4, 0x2c, 0x7b, 0xee, 0xb7, 0x7f,
-  0xf9, 0xad, 0x93, 0x38, 0xe1, 0xf2, 0x05, 0xe8, 0xfd, 0xd1, 0x92, 0x2e,
-  0x6b, 0xfe, 0xb6, 0x27, 0xff, 0x1a, 0x1f, 0x84, 0x3c, 0x5c, 0x78, 0xd1,
-  0x63, 0xec, 0x39, 0x90, 0x98, 0x8a, 0x5e, 0x07, 0x80, 0x2b, 0x80, 0x51,
-  0x11, 0x00, 0xe5, 0xcd, 0x03, 0x38, 0x98, 0x26, 0x18, 0x60, 0xdd, 0xc6,
-  0x21, 0x4e, 0x9e, 0x1f, 0x66, 0xd1, 0x99, 0xb3, 0xa0, 0x54, 0x53, 0x05,
-  0x2b, 0x05, 0xb1, 0x1c, 0xee, 0xb9, 0xd5, 0x9c, 0xb9, 0xbc, 0x86, 0x1f,
-  0xdd, 0x3b, 0xf9, 0xd0, 0x99, 0x8c, 0x36, 0x69, 0xcf, 0x0c, 0x71, 0x6a,
-  0x78, 0x2e, 0x7e, 0xe5, 0x26, 0x2d, 0xe9, 0x82, 0x8b, 0xc2, 0xe5, 0x72,
-  0x91, 0x8e, 0x27, 0x18, 0x1f, 0x1b, 0xe4, 0xbc, 0x1b, 0x6e, 0xe4, 0x9a,
-  0x7f, 0xf9, 0x0c, 0x4a, 0x29, 0x32, 0x7d, 0xfd, 0x28, 0xb7, 0x9c, 0xfa,
-  0x0f, 0x8f, 0x20, 0x53, 0x18, 0x89, 0x24, 0x6e, 0xd3, 0x64, 0xfe, 0xf9,
-  0x67, 0xd3, 0xdc, 0xdc, 0xc4, 0xce, 0xe7, 0x36, 0x90, 0x18, 0x8b, 0x12,
-  0xaa, 0xae, 0xb2, 0x5d, 0x04, 0x58, 0x68, 0xc2, 0xca, 0x47, 0xc0, 0xe5,
-  0xe6, 0x5f, 0x87, 0x5e, 0xa4, 0x2b, 0x17, 0xb5, 0xa5, 0xdd, 0x1b, 0x2f,
-  0x9d, 0xcd, 0x67, 0xef, 0x3a, 0x05, 0x0e, 0xc6, 0x4a, 0xf3, 0x70, 0xf2,
-  0x4e, 0xe8, 0x89, 0x2a, 0x7f, 0xad, 0x35, 0x7c, 0xfe, 0x6f, 0xd7, 0xf1,
-  0xb3, 0x07, 0x0f, 0x4c, 0x45, 0xaf, 0x1d, 0x40, 0x27, 0x70, 0x57, 0xa5,
-  0xcf, 0x73, 0xf7, 0x34, 0x59, 0xcf, 0xbf, 0x9e, 0x10, 0x01, 0x0d, 0x4e,
-  0x75, 0x70, 0xdf, 0xc3, 0x5d, 0xdc, 0x7a, 0xd9, 0x2c, 0x6a, 0x56, 0xd4,
-  0xc1, 0x50, 0xba, 0xa4, 0xfd, 0x01, 0xda, 0x4e, 0x6c, 0xa5, 0x2a, 0x95,
-  0x65, 0xcd, 0xf3, 0x93, 0x77, 0xa2, 0x19, 0xb7, 0x32, 0xec, 0xcf, 0x8d,
-  0x72, 0x6a, 0x78, 0x2e, 0x0a, 0x09, 0x0f, 0x2c, 0xf8, 0x27, 0x71, 0xbb,
-  0x48, 0x44, 0x63, 0x24, 0x63, 0x51, 0xde, 0xf5, 0x77, 0x7f, 0xc3, 0x79,
-  0xff, 0xf0, 0x31, 0x88, 0xc6, 0xc9, 0x8c, 0x8c, 0xa1, 0xdc, 0x6e, 0x19,
-  0xa0, 0xc3, 0xaa, 0x99, 0x15, 0x66, 0x2e, 0x07, 0xf1, 0x04, 0xad, 0xa7,
-  0x9f, 0xc4, 0x92, 0xa3, 0x8f, 0x64, 0xe7, 0xb3, 0x1b, 0x18, 0xe9, 0xeb,
-  0x27, 0x54, 0x5d, 0x6d, 0x9b, 0x73, 0xa0, 0x46, 0xe3, 0x57, 0x1e, 0xea,
-  0xdc, 0x01, 0x7e, 0x34, 0xfc, 0x2a, 0x5b, 0xd2, 0xf6, 0x38, 0xb7, 0xcd,
-  0x6e, 0x09, 0xf2, 0xcc, 0x13, 0x17, 0xa3, 0x4c, 0x8d, 0x1e, 0xcf, 0x96,
-  0xa7, 0xe9, 0xdf, 0xd2, 0xa8, 0x05, 0xb5, 0xac, 0xf9, 0xc5, 0x4e, 0xde,
-  0xff, 0xa9, 0x97, 0xa7, 0x6a, 0xf3, 0x4f, 0x90, 0x2f, 0xf6, 0x53, 0xf1,
-  0x4c, 0x97, 0x37, 0x4c, 0x1a, 0x58, 0x02, 0xd4, 0x3a, 0x25, 0x02, 0x4c,
-  0x4b, 0xb3, 0xe6, 0xa9, 0x1e, 0x3e, 0x7a, 0xfb, 0xd2, 0x7c, 0x86, 0xaa,
-  0x58, 0xae, 0x34, 0x17, 0x9c, 0xd6, 0xa8, 0xac, 0xc1, 0x29, 0x57, 0xcd,
-  0xe3, 0x95, 0xa7, 0x7b, 0xd8, 0x7d, 0x60, 0xf2, 0xce, 0xad, 0x83, 0x46,
-  0x92, 0x21, 0x23, 0xc9, 0xa9, 0xe1, 0xd9, 0xe4, 0xb4, 0x85, 0x81, 0x25,
-  0x22, 0xe0, 0x10, 0x37, 0xff, 0xf8, 0xe8, 0x38, 0x99, 0x44, 0x82, 0x1b,
-  0x3e, 0xff, 0x29, 0x4e, 0xbc, 0xfd, 0x66, 0xac, 0xde, 0x01, 0xb2, 0x89,
-  0x84, 0x9c, 0xfc, 0x4b, 0x48, 0x04, 0x68, 0xcb, 0xc2, 0x1a, 0x1d, 0xa7,
-  0x76, 0xc5, 0x12, 0x56, 0x9d, 0x71, 0x0a, 0xfb, 0x5e, 0xde, 0x44, 0x4f,
-  0xe7, 0x5e, 0xc2, 0x55, 0xd5, 0x93, 0xb6, 0xf6, 0x69, 0xc0, 0x8d, 0x8b,
-  0x16, 0x6f, 0x15, 0xf7, 0x8d, 0x6f, 0xe3, 0x19, 0x9b, 0x3c, 0xfe, 0x01,
-  0xd6, 0xfd, 0xf6, 0x7c, 0x5a, 0x56, 0xce, 0x40, 0x77, 0xc5, 0xcb, 0xd3,
-  0xf4, 0x6f, 0x6a, 0xd4, 0xbc, 0x2a, 0x46, 0x77, 0x8f, 0x73, 0xd2, 0x65,
-  0x4f, 0x90, 0x35, 0xa6, 0xa4, 0x9c, 0xf3, 0x00, 0x70, 0x31, 0x30, 0x3e,
-  0x2d, 0xde, 0x41, 0xd3, 0x68, 0x2d, 0x7f, 0x8c, 0x7c, 0xbd, 0x80, 0x0e,
-  0xa7, 0x3a, 0xd8, 0xb6, 0x37, 0xca, 0x8d, 0xd7, 0x3d, 0x05, 0x11, 0x3f,
-  0xaa, 0xca, 0x5b, 0x9a, 0xd5, 0xc6, 0x94, 0x42, 0xc7, 0x72, 0x90, 0x34,
-  0xf8, 0xdd, 0xaf, 0xcf, 0xa5, 0xb5, 0x31, 0x60, 0x4b, 0xb3, 0x2f, 0x24,
-  0xbb, 0xf8, 0xe5, 0xc8, 0x16, 0x1a, 0x3c, 0x21, 0xbc, 0xca, 0x8d, 0x46,
-  0x23, 0xbc, 0xf3, 0xe6, 0x9f, 0x4b, 0x67, 0xb8, 0xe9, 0x4b, 0xff, 0xc8,
-  0x31, 0x37, 0x5f, 0x87, 0xd9, 0xdd, 0x43, 0x2e, 0x9d, 0x16, 0x67, 0xbf,
-  0x52, 0x5c, 0x33, 0x0a, 0xb2, 0x9d, 0xdd, 0xd4, 0x2c, 0x98, 0xcb, 0x47,
-  0x7e, 0xfc, 0x1d, 0x96, 0x1f, 0x7b, 0x02, 0x03, 0x7d, 0x5d, 0x68, 0xd3,
-  0x9a, 0x94, 0x7f, 0x86, 0x8b, 0x7c, 0xb8, 0xdf, 0x23, 0xd1, 0x5d, 0x3c,
-  0x1a, 0xdb, 0x6d, 0xdb, 0x47, 0xbe, 0xfb, 0x2b, 0xc7, 0xb3, 0xf2, 0xfc,
-  0xb9, 0xe8, 0x7d, 0x65, 0x7c, 0xef, 0x5f, 0xef, 0x07, 0xa5, 0xb8, 0xf2,
-  0x86, 0x3f, 0x12, 0x4f, 0x4d, 0x49, 0xe5, 0xdd, 0x76, 0x60, 0x1d, 0x70,
-  0x60, 0xba, 0x4c, 0xed, 0xe9, 0x66, 0x63, 0xfc, 0x25, 0x0e, 0x26, 0x08,
-  0x02, 0xd8, 0xba, 0x3b, 0x4a, 0x75, 0xd6, 0xe0, 0xe4, 0x2b, 0x17, 0xa1,
-  0xc6, 0x27, 0x92, 0x04, 0x95, 0xda, 0xfa, 0x73, 0x29, 0x88, 0xe6, 0x70,
-  0xcf, 0x89, 0x70, 0xd1, 0xb1, 0x0d, 0x7c, 0xef, 0x67, 0xf6, 0xbc, 0x78,
-  0xf6, 0xe5, 0x46, 0x71, 0x2b, 0x17, 0xab, 0x83, 0x33, 0x49, 0x5a, 0xb9,
-  0xb2, 0xbc, 0x72, 0x9c, 0xaa, 0xcd, 0x3f, 0x31, 0x3a, 0x4e, 0x26, 0x99,
-  0xe0, 0xe6, 0x2f, 0x7f, 0x8e, 0x95, 0xd7, 0x5d, 0x8d, 0x71, 0xa0, 0x1b,
-  0xcb, 0x30, 0xc4, 0xd9, 0xaf, 0xc4, 0x85, 0x80, 0x31, 0x36, 0x8e, 0xbf,
-  0x71, 0x06, 0xc7, 0x5e, 0x7c, 0x1e, 0xc3, 0x7b, 0x3a, 0xd9, 0xbd, 0x6d,
-  0x13, 0xc1, 0x60, 0x55, 0xd1, 0x75, 0x04, 0x5a, 0xbd, 0x11, 0xd6, 0x25,
-  0x0e, 0xf0, 0xf3, 0x31, 0xfb, 0xc2, 0xda, 0x6e, 0xbf, 0x66, 0x1e, 0xff,
-  0xf4, 0x9d, 0xd3, 0xa1, 0x27, 0x56, 0x9e, 0x21, 0x7f, 0x1a, 0x94, 0xcf,
-  0x0d, 0x2d, 0x11, 0x3e, 0x71, 0xfb, 0x33, 0xfc, 0xea, 0xd1, 0xae, 0xa9,
-  0xe8, 0xf5, 0x8d, 0x84, 0x3f, 0x97, 0x4d, 0xa7, 0x29, 0x3d, 0xdd, 0x04,
-  0x40, 0x8e, 0x7c, 0x41, 0x87, 0x23, 0x9d, 0x14, 0x01, 0x4f, 0xac, 0xeb,
-  0xe7, 0x94, 0xc5, 0x55, 0x2c, 0x3c, 0xa3, 0x84, 0x9d, 0x02, 0x5d, 0x0a,
-  0x46, 0x32, 0x34, 0x1d, 0xdb, 0xc2, 0xaa, 0x66, 0x1f, 0xf7, 0x3d, 0x62,
-  0xcf, 0x22, 0x7b, 0x3d, 0x33, 0x48, 0xc0, 0xe5, 0x61, 0x75, 0xb0, 0x55,
-  0x12, 0x05, 0xbd, 0xd9, 0x1e, 0xe2, 0x72, 0x91, 0x8a, 0xc5, 0xc8, 0x24,
-  0x92, 0xdc, 0xf4, 0x2f, 0x9f, 0x61, 0xe5, 0xf5, 0xf9, 0xcd, 0xdf, 0x94,
-  0xcd, 0xbf, 0x6c, 0x7e, 0x3f, 0x23, 0x1a, 0xc7, 0x13, 0x0e, 0xb1, 0xea,
-  0xb2, 0x0b, 0x49, 0x76, 0x0f, 0xb2, 0x73, 0xd3, 0xcb, 0x04, 0x03, 0x85,
-  0x89, 0x00, 0x0d, 0xb4, 0x78, 0xaa, 0xd8, 0x98, 0xea, 0xe5, 0x07, 0x23,
-  0xf6, 0xdd, 0x6d, 0x9f, 0xbe, 0xba, 0x81, 0x07, 0x1e, 0xbd, 0x08, 0xa2,
-  0x99, 0xbc, 0xa5, 0xaf, 0x2c, 0x13, 0xfe, 0x68, 0xd4, 0xbc, 0x3a, 0xee,
-  0xff, 0xde, 0x56, 0xfe, 0xee, 0x8b, 0xaf, 0x4d, 0x55, 0xaf, 0x03, 0xc0,
-  0xa9, 0xe4, 0x53, 0xc8, 0x8b, 0x00, 0xa8, 0x60, 0xb6, 0x02, 0x37, 0x4d,
-  0x88, 0x81, 0x3a, 0xa7, 0x3a, 0xb9, 0xff, 0x91, 0x03, 0x5c, 0x7f, 0xfe,
-  0x4c, 0xea, 0x57, 0xce, 0x80, 0xa1, 0x54, 0xc9, 0x2e, 0x44, 0x15, 0xcf,
-  0xb0, 0xfc, 0xdc, 0xb9, 0xe4, 0xfa, 0xe2, 0x3c, 0xf7, 0xea, 0x90, 0x2d,
-  0x6d, 0x6e, 0x4b, 0x0f, 0xd0, 0xe0, 0x09, 0xb1, 0x3c, 0xd0, 0x44, 0xcc,
-  0xca, 0x8a, 0x15, 0xe0, 0x4f, 0x9b, 0x87, 0x22, 0x9b, 0x4c, 0x13, 0x8d,
-  0x0e, 0x73, 0xfd, 0xa7, 0x3f, 0xc1, 0x31, 0xb7, 0xde, 0x80, 0xd9, 0x25,
-  0x27, 0xff, 0x72, 0xfc, 0x1d, 0x8d, 0x44, 0x12, 0x8f, 0xd7, 0xcb, 0xf2,
-  0x8b, 0xce, 0x23, 0xd5, 0x33, 0xc8, 0x8e, 0x8d, 0x2f, 0x1e, 0xb2, 0x25,
-  0xc0, 0x42, 0xd3, 0xea, 0xa9, 0x66, 0x57, 0x66, 0x88, 0x6f, 0x0f, 0x6d,
-  0xb0, 0xed, 0x73, 0x35, 0xd6, 0xf8, 0x58, 0xff, 0xd4, 0x25, 0x04, 0x6a,
-  0x7c, 0xe8, 0x9e, 0x54, 0xf9, 0xde, 0xfb, 0x2f, 0xaa, 0x66, 0xef, 0x0b,
-  0x7d, 0x9c, 0x7d, 0xed, 0x53, 0x58, 0x53, 0x73, 0x93, 0xd8, 0x0e, 0x7c,
-  0x0e, 0xd8, 0x34, 0xdd, 0xe6, 0xf2, 0x74, 0x75, 0x33, 0xbe, 0x1b, 0xf8,
-  0x20, 0xf9, 0xf4, 0x8e, 0x8e, 0x88, 0x00, 0xc3, 0xd4, 0xfc, 0xfe, 0xe1,
-  0x03, 0x7c, 0xf8, 0xc6, 0x85, 0x78, 0x5b, 0x42, 0x30, 0x5a, 0x82, 0x5e,
-  0xb8, 0x0a, 0x30, 0x34, 0xca, 0x32, 0x39, 0xf7, 0xda, 0x05, 0x6c, 0x7e,
-  0xae, 0x97, 0x9d, 0x1d, 0xf6, 0x64, 0xbc, 0xdc, 0x98, 0xea, 0x65, 0x81,
-  0xaf, 0x8e, 0x85, 0xbe, 0x7a, 0xc9, 0x16, 0x48, 0xde, 0x99, 0xcc, 0xc8,
-  0x19, 0x8c, 0x8c, 0xf4, 0x71, 0xc5, 0x87, 0x3e, 0xc4, 0xa9, 0x7f, 0x73,
-  0x3b, 0x66, 0x77, 0x2f, 0x46, 0x2e, 0x27, 0x9b, 0x7f, 0xb9, 0x8a, 0x80,
-  0x64, 0x0a, 0x8f, 0xc7, 0xcd, 0xf2, 0x8b, 0xcf, 0x23, 0x75, 0x70, 0x90,
-  0x1d, 0x1b, 0x5f, 0x7a, 0x47, 0x4b, 0x80, 0x9e, 0xc8, 0xf2, 0xb7, 0x3b,
-  0x33, 0xcc, 0x5d, 0x43, 0x2f, 0x60, 0x60, 0x8f, 0x63, 0x5b, 0xd0, 0xe7,
-  0xe2, 0xc5, 0x35, 0x17, 0x33, 0x6b, 0xd5, 0x0c, 0x74, 0x47, 0x0c, 0x3c,
-  0x65, 0xba, 0xf9, 0xcf, 0x0c, 0x41, 0x3c, 0xc7, 0x49, 0xe7, 0xfe, 0x81,
-  0xc1, 0xb1, 0x29, 0x39, 0x8c, 0x77, 0x00, 0xc3, 0xc0, 0xdf, 0x4d, 0xc7,
-  0x79, 0x3c, 0x5d, 0xbd, 0x8d, 0x34, 0x70, 0x39, 0x0e, 0x9b, 0x7b, 0x3a,
-  0xfb, 0x52, 0x5c, 0x7a, 0xe5, 0x9a, 0x7c, 0x7a, 0xd7, 0xc6, 0x00, 0x98,
-  0x25, 0xe8, 0x18, 0xe7, 0x52, 0xe8, 0xb1, 0x2c, 0x24, 0x0d, 0x1e, 0xf8,
-  0xf5, 0x79, 0x2c, 0x9b, 0x57, 0x65, 0x5b, 0xd3, 0xdf, 0x1f, 0x7e, 0x99,
-  0x8e, 0xec, 0x28, 0x2d, 0x9e, 0x2a, 0x2c, 0x3d, 0xbd, 0x9d, 0x02, 0xb5,
-  0xd6, 0x0c, 0x0f, 0xf5, 0x70, 0xd6, 0xd5, 0xef, 0xe6, 0xec, 0x3b, 0x3f,
-  0x82, 0xd5, 0x3f, 0x88, 0x91, 0xc9, 0xc8, 0xe6, 0x5f, 0xce, 0x22, 0xc0,
-  0xed, 0x22, 0x33, 0x3a, 0x0e, 0x89, 0x04, 0xef, 0xfa, 0xe2, 0x67, 0x38,
-  0xf3, 0xaa, 0xab, 0x19, 0x1a, 0xea, 0xc1, 0x32, 0xcd, 0x37, 0xfd, 0x5d,
-  0x2d, 0x34, 0x4d, 0x9e, 0x2a, 0xf6, 0x65, 0x47, 0xb8, 0x6b, 0x68, 0x03,
-  0x69, 0x6d, 0x9f, 0x63, 0xdb, 0x63, 0xbf, 0x3a, 0x87, 0xa5, 0xa7, 0xb4,
-  0xa2, 0xf7, 0x8e, 0x97, 0x77, 0xb2, 0x9f, 0xb0, 0x87, 0x6b, 0xaf, 0x7f,
-  0x9a, 0xdd, 0x5d, 0x53, 0x92, 0xec, 0xa7, 0x83, 0x7c, 0xb2, 0xb8, 0x93,
-  0xa7, 0xeb, 0x2a, 0xed, 0xbf, 0xda, 0x00, 0x00, 0x20, 0x00, 0x49, 0x44,
-  0x41, 0x54, 0x1c, 0x9e, 0xce, 0x81, 0xc6, 0xa3, 0xc0, 0x7c, 0xa0, 0x1e,
-  0x07, 0xfd, 0x01, 0x3a, 0x7a, 0x92, 0x74, 0x6e, 0x1b, 0xe1, 0xaa, 0x5b,
-  0x97, 0xa1, 0x72, 0x26, 0x64, 0x4a, 0x30, 0x5d, 0xf0, 0x84, 0x53, 0xa0,
-  0x9a, 0x19, 0xe2, 0xdd, 0xe7, 0xcf, 0xe2, 0x3f, 0x7e, 0xb6, 0x9b, 0x8c,
-  0x0d, 0xa9, 0x36, 0x0d, 0x2c, 0x36, 0xa5, 0xfa, 0x38, 0x2a, 0xd0, 0x42,
-  0xb3, 0x37, 0x3c, 0x6d, 0x53, 0x06, 0xbb, 0x5c, 0x2e, 0x06, 0x7a, 0xbb,
-  0x59, 0x79, 0xc2, 0xc9, 0xbc, 0xf7, 0x9b, 0x5f, 0x80, 0x64, 0x8a, 0x6c,
-  0x2c, 0x2e, 0xde, 0xfe, 0x15, 0x63, 0x09, 0x48, 0xe7, 0x2d, 0x01, 0x97,
-  0x9c, 0x4f, 0xac, 0xa3, 0x9b, 0x9d, 0xaf, 0xbd, 0x4c, 0x28, 0x5c, 0xfd,
-  0x67, 0xbf, 0xef, 0x1b, 0xf9, 0xfd, 0xbb, 0x72, 0x51, 0xbe, 0x36, 0xb8,
-  0x8e, 0xb4, 0xb6, 0xaf, 0xac, 0xfc, 0xbd, 0xdf, 0x3d, 0x85, 0x4b, 0x6f,
-  0x59, 0x0e, 0x1d, 0x63, 0x80, 0x2a, 0x4f, 0xa7, 0x3f, 0xaf, 0x0b, 0x5a,
-  0xab, 0xf9, 0xfc, 0x1d, 0xeb, 0xf8, 0xde, 0xaf, 0xf6, 0x4d, 0x55, 0xcf,
-  0x03, 0xc0, 0x39, 0x54, 0x68, 0xa1, 0x1f, 0x11, 0x00, 0xef, 0xcc, 0x13,
-  0xc0, 0x2d, 0x13, 0x96, 0x00, 0xc7, 0xfc, 0x01, 0x5e, 0xdb, 0x39, 0x8e,
-  0x2f, 0x96, 0xe5, 0xf4, 0xab, 0x17, 0xa1, 0x12, 0x59, 0x30, 0xad, 0xd2,
-  0x14, 0x01, 0xa3, 0x19, 0x22, 0xcb, 0xea, 0x39, 0xf7, 0xe8, 0x7a, 0x7e,
-  0xf4, 0xcb, 0xbd, 0xb6, 0x34, 0x9b, 0xd5, 0x26, 0x9b, 0xd3, 0x7d, 0x1c,
-  0x13, 0x6c, 0xa5, 0xc1, 0x1d, 0x22, 0xa1, 0xa7, 0x97, 0x08, 0x70, 0xb9,
-  0x5d, 0x8c, 0xf5, 0x0f, 0xd0, 0xd0, 0xda, 0xc6, 0xfb, 0xbf, 0xf3, 0x65,
-  0xbc, 0x91, 0x2a, 0x32, 0x83, 0xc3, 0x92, 0xe4, 0xa7, 0x12, 0x45, 0x80,
-  0xd7, 0xc3, 0x11, 0xe7, 0x9f, 0xc9, 0xe8, 0x9e, 0x2e, 0x76, 0x6f, 0x7d,
-  0x2d, 0x9f, 0x27, 0x60, 0x62, 0xf3, 0x6f, 0xf1, 0x54, 0xd1, 0x6b, 0xc4,
-  0xf9, 0xf6, 0xd0, 0x7a, 0xe2, 0x56, 0xce, 0xb6, 0xbe, 0x7f, 0xf0, 0xa5,
-  0xe3, 0xb9, 0xf5, 0xce, 0x63, 0xe0, 0xc0, 0x18, 0xba, 0x5c, 0xc3, 0x6e,
-  0x34, 0xa8, 0xf9, 0xf5, 0x3c, 0xf4, 0x1f, 0xdb, 0xf9, 0xd0, 0x67, 0x5f,
-  0x9d, 0xaa, 0x5e, 0xdb, 0x81, 0x7b, 0x81, 0x47, 0xa6, 0xf3, 0xdc, 0x95,
-  0xb7, 0x10, 0xfc, 0x14, 0xf8, 0x10, 0xf9, 0x1c, 0x01, 0x8e, 0x89, 0x80,
-  0xa7, 0x37, 0x0c, 0xb0, 0x20, 0xe2, 0xe6, 0xa8, 0x8b, 0xe6, 0xc3, 0x78,
-  0xba, 0x34, 0xc3, 0x03, 0x51, 0xa8, 0xb1, 0x0c, 0x6d, 0x27, 0xcc, 0x64,
-  0xf5, 0xec, 0x20, 0xbf, 0xb2, 0x29, 0xed, 0x66, 0x4a, 0x1b, 0x6c, 0x4d,
-  0xf7, 0x73, 0x7c, 0xa8, 0x8d, 0x5a, 0x77, 0x80, 0xc4, 0x34, 0xa9, 0x1b,
-  0xa0, 0x94, 0x22, 0x15, 0x4b, 0x60, 0x1a, 0x26, 0xef, 0xff, 0xf6, 0xbf,
-  0x30, 0xe3, 0xa8, 0x23, 0xc9, 0x76, 0xf5, 0xc8, 0xe6, 0x5f, 0xa9, 0x22,
-  0x20, 0x91, 0xc2, 0x13, 0x0c, 0xb2, 0xf2, 0xa2, 0x73, 0x19, 0xd8, 0xb6,
-  0x9b, 0xbd, 0x3b, 0xb6, 0x10, 0x8a, 0xd4, 0x30, 0xd3, 0x1b, 0x61, 0x4f,
-  0x66, 0x84, 0x6f, 0x0e, 0x3d, 0x4f, 0xd4, 0xb2, 0xef, 0xd6, 0xf1, 0xab,
-  0x9f, 0x3a, 0x8a, 0x8f, 0xfd, 0xf3, 0xf1, 0xd0, 0x13, 0x45, 0x67, 0xac,
-  0xf2, 0x2d, 0xf2, 0xb3, 0xa8, 0x96, 0x1d, 0x6b, 0xbb, 0x39, 0xeb, 0xda,
-  0xa7, 0xa6, 0x2a, 0x75, 0xca, 0x1b, 0xf7, 0xfe, 0x37, 0x4f, 0xf7, 0x79,
-  0x2b, 0x6f, 0xa2, 0x7c, 0x86, 0xec, 0xc7, 0x81, 0xeb, 0x70, 0xf0, 0x2a,
-  0x00, 0xe0, 0x77, 0x4f, 0x1c, 0xe4, 0xcc, 0x23, 0x6b, 0x98, 0x7f, 0x4a,
-  0x1b, 0xaa, 0x14, 0xc3, 0x03, 0xd5, 0x84, 0x1a, 0x8f, 0x65, 0x58, 0x7a,
-  0xf6, 0x1c, 0xda, 0xfc, 0x8a, 0x87, 0x9e, 0xea, 0xb1, 0xa5, 0xe9, 0x84,
-  0x95, 0x63, 0x5b, 0x7a, 0x80, 0xe3, 0x42, 0xad, 0xd3, 0xa6, 0x78, 0x90,
-  0xb6, 0x2c, 0x46, 0x47, 0x07, 0xb8, 0xfa, 0x6f, 0x3f, 0xca, 0x11, 0xef,
-  0xb9, 0x8a, 0x5c, 0x67, 0x57, 0x79, 0xbe, 0xa4, 0x85, 0x02, 0x44, 0x40,
-  0x02, 0x4f, 0x55, 0x98, 0x23, 0xcf, 0x39, 0x9d, 0xce, 0x17, 0x37, 0x63,
-  0x76, 0x0c, 0xd0, 0xe3, 0xcb, 0xf0, 0xed, 0xa1, 0x0d, 0x24, 0x6d, 0xbc,
-  0xf3, 0xff, 0xea, 0xa7, 0x8e, 0xe6, 0x93, 0x5f, 0x3a, 0x09, 0xfa, 0x62,
-  0xe8, 0xa4, 0x59, 0x9e, 0xf3, 0xca, 0xc8, 0x67, 0xfa, 0x4b, 0x74, 0xc7,
-  0x39, 0xf6, 0x9c, 0x3f, 0x10, 0x9b, 0x9a, 0x64, 0x3f, 0x6f, 0xa4, 0xfa,
-  0x3d, 0x4e, 0x66, 0xac, 0x08, 0x80, 0x37, 0x78, 0x23, 0x37, 0x40, 0xc4,
-  0x69, 0x11, 0xf0, 0xcb, 0xfb, 0xf7, 0x73, 0xd5, 0x19, 0xcd, 0x34, 0xaf,
-  0x6e, 0x82, 0xe1, 0x74, 0x69, 0x46, 0x06, 0x98, 0x1a, 0x95, 0xce, 0x71,
-  0xec, 0x25, 0xf3, 0xc9, 0xf4, 0xc5, 0x59, 0x67, 0x53, 0x78, 0x60, 0xcc,
-  0xca, 0xb2, 0x2d, 0x33, 0xc0, 0x71, 0xc1, 0xd6, 0x8a, 0xb7, 0x04, 0xb8,
-  0x5c, 0x2e, 0x06, 0xfb, 0xba, 0x39, 0xe1, 0xfc, 0x0b, 0xb8, 0xf8, 0x33,
-  0x77, 0x62, 0x0d, 0x0c, 0x4b, 0xac, 0xff, 0xb4, 0x10, 0x01, 0x2e, 0x8c,
-  0x68, 0x0c, 0x6f, 0x43, 0x3d, 0xc7, 0x5d, 0x7b, 0x3d, 0xeb, 0x9f, 0x7b,
-  0x82, 0x7f, 0xe9, 0x78, 0x82, 0x0c, 0xf6, 0xdd, 0xf9, 0xff, 0xd9, 0xe6,
-  0x9f, 0x30, 0xca, 0xf7, 0xe4, 0xdf, 0x12, 0x04, 0x13, 0xce, 0x3c, 0xef,
-  0x0f, 0xb4, 0x77, 0x4e, 0xd9, 0x35, 0xfc, 0x00, 0x70, 0x3a, 0x79, 0xe7,
-  0xbf, 0x69, 0x8f, 0x78, 0x21, 0xfd, 0x17, 0x1f, 0x26, 0x9f, 0xff, 0xb9,
-  0xc3, 0xc9, 0x4e, 0x72, 0x96, 0xe6, 0xec, 0xab, 0x9e, 0xa0, 0x6f, 0xc7,
-  0x30, 0x6a, 0x51, 0x75, 0x3e, 0x53, 0x57, 0xc9, 0xcd, 0x0a, 0x85, 0x4e,
-  0x19, 0x30, 0x18, 0xe3, 0xcb, 0x3f, 0x38, 0x9d, 0xbf, 0xb9, 0x69, 0xa1,
-  0x6d, 0x4d, 0xf7, 0xe4, 0x62, 0x7c, 0x73, 0x70, 0x3d, 0x09, 0x2b, 0x4b,
-  0x83, 0x27, 0x84, 0x55, 0x81, 0x29, 0x83, 0x95, 0xcb, 0x45, 0x74, 0x68,
-  0x98, 0xc6, 0x96, 0xd9, 0x5c, 0xf1, 0xc9, 0x3b, 0x20, 0x9b, 0x23, 0x97,
-  0x4a, 0xc9, 0xe6, 0x3f, 0x0d, 0xd0, 0x96, 0x85, 0x3f, 0x54, 0x05, 0xe1,
-  0x08, 0x2f, 0xbd, 0xf6, 0x2c, 0xff, 0x16, 0xdf, 0x48, 0x16, 0xfb, 0x72,
-  0xd8, 0x7f, 0xeb, 0xf3, 0xab, 0xf3, 0x9b, 0x7f, 0x6f, 0xb4, 0x7c, 0x37,
-  0xff, 0x37, 0x3c, 0xfe, 0x23, 0x3e, 0x6e, 0xba, 0xfe, 0x29, 0x5e, 0xd8,
-  0x3a, 0x32, 0x55, 0x3d, 0xb7, 0x03, 0x77, 0x4c, 0x1c, 0xf8, 0x04, 0x11,
-  0x00, 0x7f, 0xc1, 0xc9, 0x40, 0xd2, 0x69, 0x11, 0x30, 0x1c, 0xcd, 0x71,
-  0xca, 0xf9, 0x8f, 0x12, 0x3d, 0x10, 0x47, 0x2d, 0x88, 0xc0, 0xd4, 0x14,
-  0xb9, 0x28, 0x5c, 0x04, 0x8c, 0xe7, 0x60, 0x34, 0xcd, 0x77, 0x7e, 0x7e,
-  0x0e, 0xb7, 0x5c, 0x39, 0xd7, 0x3e, 0x11, 0x60, 0xc4, 0xf8, 0xc6, 0xd0,
-  0x7a, 0xc6, 0x8d, 0x34, 0x8d, 0xee, 0x70, 0xc5, 0x89, 0x00, 0x23, 0x9b,
-  0x25, 0x9b, 0xcd, 0x70, 0xd5, 0x9d, 0x1f, 0x21, 0xbc, 0x70, 0x1e, 0xd9,
-  0xc1, 0x21, 0xf1, 0xf8, 0x9f, 0x0e, 0x9b, 0xbf, 0x69, 0xe0, 0x9f, 0xd1,
-  0x04, 0xad, 0xad, 0x7c, 0xe7, 0x5f, 0xbf, 0xc4, 0x89, 0x37, 0x9e, 0xcd,
-  0xfe, 0x7d, 0xf6, 0x79, 0xb4, 0xff, 0xf8, 0x1b, 0x27, 0xf2, 0xf1, 0xcf,
-  0x9d, 0x90, 0xdf, 0xfc, 0x93, 0x46, 0xf9, 0x66, 0xf9, 0x0b, 0xb8, 0xa1,
-  0xb1, 0x8a, 0xcf, 0x7c, 0xf8, 0x39, 0xee, 0x79, 0xa4, 0x6b, 0xaa, 0x7a,
-  0x6e, 0x07, 0x76, 0x03, 0x4f, 0xca, 0x4c, 0x15, 0x01, 0xf0, 0x96, 0xda,
-  0x14, 0xb8, 0x90, 0x29, 0x48, 0x07, 0xd9, 0xd1, 0x93, 0xe4, 0xdc, 0x8b,
-  0x1e, 0x83, 0x78, 0x0e, 0x35, 0xa7, 0xaa, 0x34, 0x45, 0x80, 0x5b, 0xa1,
-  0x87, 0x33, 0x30, 0x9e, 0xe1, 0x3f, 0x7f, 0x7b, 0x1e, 0x57, 0x9e, 0xd3,
-  0x6a, 0xab, 0x25, 0xe0, 0xeb, 0x83, 0xcf, 0x33, 0x6c, 0x26, 0x69, 0xf6,
-  0x54, 0x55, 0x8c, 0x08, 0x70, 0xb9, 0x5c, 0x8c, 0x0c, 0xf5, 0x72, 0xca,
-  0x55, 0x97, 0xb1, 0xfc, 0xca, 0x8b, 0x31, 0xba, 0x7a, 0x40, 0x36, 0xff,
-  0xca, 0xde, 0xf8, 0xb5, 0x46, 0x69, 0x8d, 0x7f, 0xfe, 0x12, 0x72, 0xb9,
-  0x0c, 0xb7, 0xfc, 0xf5, 0xb5, 0xfc, 0xed, 0x37, 0x3f, 0x63, 0x6b, 0x1f,
-  0xbf, 0xf8, 0xee, 0x29, 0xdc, 0x76, 0xe7, 0x31, 0x70, 0x70, 0xbc, 0x8c,
-  0x37, 0xff, 0x7c, 0xee, 0x04, 0xda, 0x6a, 0xf8, 0xe9, 0xd7, 0x36, 0xf2,
-  0xa5, 0x7f, 0xdf, 0x39, 0x55, 0x3d, 0xbf, 0x91, 0xe7, 0xff, 0x72, 0x99,
-  0xad, 0xff, 0xe3, 0x15, 0x2f, 0x43, 0xf0, 0x17, 0xc4, 0xc8, 0x7b, 0x88,
-  0x3a, 0x5a, 0x2f, 0x00, 0xa0, 0x67, 0x28, 0xcd, 0x0b, 0xcf, 0xf6, 0x71,
-  0xd3, 0x8d, 0x8b, 0xf2, 0xd5, 0x03, 0x4b, 0x31, 0x77, 0xb7, 0x4b, 0x41,
-  0xdc, 0x40, 0xf9, 0xdd, 0x5c, 0x7f, 0xe3, 0x22, 0x5e, 0x7a, 0xb6, 0x97,
-  0x3d, 0x07, 0xec, 0x49, 0xd2, 0x91, 0xd4, 0x39, 0x5e, 0x4d, 0xf5, 0x70,
-  0x44, 0xa0, 0x89, 0x56, 0x6f, 0xa4, 0xec, 0xf3, 0x04, 0x28, 0xa5, 0x88,
-  0x8f, 0x8e, 0x51, 0xdb, 0xd0, 0xc4, 0x4d, 0x5f, 0xfe, 0x2c, 0x5e, 0x9f,
-  0x97, 0x5c, 0x2c, 0x2e, 0xa6, 0xff, 0x4a, 0xde, 0xfc, 0x2d, 0x13, 0x7f,
-  0x20, 0x88, 0x7b, 0xfe, 0x5c, 0x36, 0x6e, 0x78, 0x86, 0xf3, 0x3f, 0x74,
-  0x39, 0x4f, 0x6f, 0x7c, 0xde, 0xd6, 0x3e, 0x7e, 0xf7, 0x9f, 0x67, 0x72,
-  0xed, 0x07, 0x56, 0x42, 0xd7, 0x38, 0x3a, 0x63, 0x96, 0xb1, 0x23, 0xa9,
-  0x46, 0xcd, 0xaf, 0xe3, 0xf1, 0x5f, 0xec, 0xe4, 0xda, 0x8f, 0x3e, 0x3f,
-  0x55, 0x9d, 0x76, 0x90, 0xb7, 0xea, 0x1e, 0x3f, 0x71, 0xc0, 0x13, 0xc4,
-  0x02, 0xf0, 0x8e, 0xdc, 0x4b, 0xde, 0x59, 0xa4, 0xdd, 0xe9, 0x8e, 0x1e,
-  0x5f, 0xdf, 0xcf, 0x75, 0xd7, 0xac, 0x81, 0x2a, 0x1f, 0xaa, 0xa1, 0x44,
-  0xb3, 0x05, 0xba, 0x15, 0xba, 0x37, 0x05, 0x0a, 0xfe, 0xf0, 0xd8, 0xc5,
-  0x5c, 0x72, 0x7a, 0x8b, 0x6d, 0x4d, 0x8f, 0x99, 0x69, 0xbe, 0x36, 0xb8,
-  0x8e, 0x3d, 0x99, 0x11, 0x66, 0x7a, 0x22, 0x6f, 0x1c, 0x14, 0xca, 0x12,
-  0xcb, 0xb4, 0x48, 0xa5, 0x13, 0x5c, 0xfc, 0xc1, 0xf7, 0x11, 0x9c, 0x3f,
-  0x97, 0xec, 0xe0, 0xb0, 0x98, 0xfe, 0x2b, 0x79, 0xf3, 0x37, 0x4d, 0xfc,
-  0x8d, 0x33, 0xa1, 0xa5, 0x8d, 0xef, 0x7f, 0xff, 0xeb, 0x1c, 0x77, 0xd3,
-  0x59, 0xec, 0xec, 0xb2, 0xcf, 0xe4, 0x1f, 0xf2, 0xba, 0x78, 0xee, 0xf7,
-  0xe7, 0x73, 0xe5, 0x2d, 0xcb, 0xa1, 0x73, 0x14, 0x9d, 0x2b, 0xe3, 0xcd,
-  0xdf, 0xd4, 0xa8, 0x05, 0x75, 0x6c, 0x7a, 0xb2, 0x93, 0x8b, 0x6f, 0x5e,
-  0x3b, 0x95, 0x9b, 0x7f, 0x96, 0x7c, 0xb2, 0x1f, 0x43, 0x66, 0xac, 0x08,
-  0x80, 0x42, 0x38, 0x63, 0xc2, 0x1a, 0xd0, 0xe1, 0x74, 0x47, 0xf7, 0x3d,
-  0x7e, 0x90, 0xf7, 0x5d, 0xf9, 0x04, 0xd4, 0xfa, 0xf2, 0x35, 0xb0, 0x4b,
-  0x51, 0x04, 0x78, 0x14, 0xba, 0x3b, 0x09, 0x0a, 0x1e, 0x79, 0xfc, 0x22,
-  0x2e, 0x3e, 0xad, 0xd9, 0xb6, 0xa6, 0x13, 0x56, 0x8e, 0xaf, 0x0f, 0x3e,
-  0xcf, 0xab, 0xa9, 0x1e, 0x5a, 0xbd, 0x11, 0xdc, 0x28, 0x74, 0x99, 0xc9,
-  0x00, 0xe5, 0x72, 0x31, 0x3a, 0xd0, 0xcf, 0x11, 0x27, 0x9f, 0xcc, 0xd1,
-  0xd7, 0x5c, 0x8e, 0xd5, 0xd7, 0x0f, 0x4a, 0x96, 0x57, 0x45, 0x6e, 0xfc,
-  0xda, 0xc2, 0xa5, 0x14, 0xfe, 0x45, 0x8b, 0x89, 0x8f, 0x0d, 0x73, 0xc3,
-  0x47, 0xde, 0xc5, 0x47, 0xff, 0xef, 0x27, 0x6d, 0x9d, 0xb1, 0xcd, 0xb5,
-  0x3e, 0x5e, 0x7d, 0xe6, 0x32, 0x4e, 0xbb, 0x62, 0x01, 0x74, 0x8c, 0xa2,
-  0x4d, 0x5d, 0x9a, 0x55, 0x45, 0x0f, 0x75, 0xf3, 0x5f, 0x54, 0xc3, 0x81,
-  0xcd, 0x83, 0x9c, 0x75, 0xc5, 0x9a, 0xa9, 0x5c, 0xd9, 0x59, 0xe0, 0xc6,
-  0x89, 0xc3, 0x9c, 0x20, 0x02, 0xa0, 0x60, 0xde, 0x28, 0x0f, 0xe9, 0xb8,
-  0x08, 0xf8, 0xd9, 0x83, 0x9d, 0xdc, 0x79, 0xdb, 0xb3, 0x50, 0x1f, 0x42,
-  0xd5, 0x96, 0xb0, 0x08, 0x38, 0x98, 0x04, 0xec, 0xb7, 0x04, 0x18, 0x58,
-  0xfc, 0xdb, 0xf0, 0x4b, 0x3c, 0x13, 0xdf, 0x4f, 0x8b, 0xb7, 0x0a, 0xaf,
-  0x72, 0x97, 0x95, 0x08, 0xc8, 0xa5, 0xd3, 0x78, 0xbd, 0x3e, 0x2e, 0xf8,
-  0xab, 0x1b, 0xc0, 0xe7, 0x25, 0x97, 0x4a, 0x23, 0x65, 0x10, 0x2b, 0xf4,
-  0xd4, 0x1f, 0xa9, 0xc5, 0xb3, 0x60, 0x3e, 0x4f, 0x3f, 0xf6, 0x7b, 0x8e,
-  0xbe, 0xfe, 0x74, 0xee, 0x7d, 0xf2, 0x77, 0xb6, 0xf6, 0xb1, 0x7c, 0x5e,
-  0x15, 0xeb, 0xff, 0x78, 0x29, 0xcb, 0x4e, 0x6e, 0x41, 0xef, 0x1d, 0xcd,
-  0x27, 0xc7, 0x29, 0xd7, 0xb9, 0x64, 0x68, 0xd4, 0x82, 0x08, 0xe3, 0xfb,
-  0xa3, 0x9c, 0x73, 0xc9, 0x63, 0x44, 0x53, 0x53, 0x76, 0x10, 0x6f, 0x07,
-  0x1e, 0x02, 0x5e, 0x95, 0x59, 0xfb, 0xd6, 0x88, 0x0f, 0xc0, 0x3b, 0x68,
-  0x57, 0xe0, 0x77, 0x13, 0x2a, 0xb2, 0xc1, 0xe9, 0xce, 0x5e, 0x78, 0x6d,
-  0x98, 0x44, 0x77, 0x8c, 0x0b, 0xae, 0x5f, 0x84, 0x32, 0xac, 0xd2, 0xad,
-  0x1b, 0x30, 0x96, 0x43, 0x55, 0x7b, 0xb9, 0xf1, 0xe6, 0xc5, 0x6c, 0x79,
-  0x71, 0x90, 0x9d, 0xfb, 0x62, 0xb6, 0x35, 0xff, 0x5a, 0xba, 0x0f, 0x37,
-  0x2e, 0x56, 0x87, 0x66, 0x92, 0xd3, 0x16, 0x39, 0xcc, 0x92, 0xf7, 0x0b,
-  0x50, 0x2e, 0x17, 0xc3, 0x03, 0x3d, 0x9c, 0x72, 0xd5, 0xe5, 0x9c, 0x70,
-  0xfb, 0xcd, 0x18, 0xbd, 0x7d, 0xc8, 0xee, 0x5f, 0x71, 0xc7, 0x7e, 0x14,
-  0xe0, 0x9b, 0xb3, 0x10, 0x0c, 0x83, 0xcf, 0x7c, 0xed, 0xd3, 0x7c, 0xe0,
-  0x8b, 0x1f, 0x67, 0x34, 0x1e, 0xb5, 0xb5, 0x9b, 0x0b, 0x4e, 0x6d, 0x66,
-  0xed, 0x9a, 0x4b, 0x68, 0x5c, 0x54, 0x83, 0xde, 0x33, 0x9e, 0x5f, 0x6f,
-  0xe5, 0xbc, 0xf9, 0xcf, 0xad, 0x22, 0x3b, 0x94, 0xe1, 0xe4, 0xb3, 0x1f,
-  0x61, 0xe7, 0xd4, 0xc5, 0xfa, 0xb7, 0x4f, 0x9c, 0xfa, 0x6f, 0x90, 0x89,
-  0x2b, 0x02, 0x60, 0xb2, 0x44, 0x81, 0x1e, 0xe0, 0xe8, 0xa9, 0x10, 0x01,
-  0xeb, 0x37, 0x0d, 0x63, 0x0e, 0xa5, 0x39, 0xe7, 0xda, 0xa5, 0xa8, 0x6c,
-  0x0e, 0xb2, 0x25, 0x5a, 0x37, 0x60, 0x3c, 0x87, 0x8a, 0x78, 0xb9, 0xee,
-  0xe6, 0xc5, 0xec, 0xdd, 0x32, 0xcc, 0x96, 0xf6, 0x71, 0xdb, 0x9a, 0x7f,
-  0x3d, 0x33, 0x48, 0xc2, 0xca, 0xb1, 0x3a, 0x34, 0x13, 0x17, 0x2e, 0x32,
-  0xda, 0x28, 0x69, 0x11, 0x90, 0x49, 0x24, 0x09, 0x04, 0xc3, 0xbc, 0xe7,
-  0xd3, 0x7f, 0x47, 0xb0, 0xa6, 0x9a, 0x5c, 0x3c, 0x21, 0x8e, 0x7f, 0x95,
-  0xb4, 0xf7, 0x5b, 0x26, 0xfe, 0x70, 0x04, 0xf7, 0xbc, 0xd9, 0x6c, 0xd9,
-  0xf0, 0x2c, 0x57, 0x7f, 0xe2, 0x46, 0x7e, 0xf9, 0xc4, 0x6f, 0x6d, 0xef,
-  0xe7, 0xe6, 0xab, 0xe6, 0xf2, 0xdb, 0xdf, 0x9f, 0x8f, 0x27, 0xe8, 0x45,
-  0x77, 0x44, 0xc1, 0xe3, 0x2a, 0xef, 0xcd, 0x7f, 0x56, 0x18, 0x4c, 0xcd,
-  0x59, 0xe7, 0xfe, 0x81, 0x57, 0x76, 0x8c, 0x4d, 0x55, 0xcf, 0x1d, 0xc0,
-  0x18, 0x70, 0x8a, 0xcc, 0x5c, 0x11, 0x00, 0xb6, 0xed, 0x49, 0xc0, 0x05,
-  0x13, 0xff, 0xed, 0xb8, 0x08, 0x78, 0xf6, 0xe5, 0x41, 0xc2, 0xd9, 0x1c,
-  0xa7, 0x5e, 0xb9, 0x10, 0x95, 0x35, 0x4a, 0x5b, 0x04, 0x04, 0xdd, 0x5c,
-  0x7d, 0xcb, 0x12, 0x46, 0xf6, 0xc7, 0x78, 0x69, 0xb3, 0x7d, 0xf9, 0x35,
-  0xf6, 0x65, 0x47, 0x39, 0x90, 0x1d, 0x67, 0x75, 0x70, 0x26, 0x11, 0x97,
-  0xbf, 0x64, 0xb3, 0x06, 0x2a, 0xa5, 0x18, 0x19, 0xee, 0xe5, 0xec, 0xeb,
-  0xdf, 0xc3, 0x91, 0xef, 0xb9, 0x8a, 0x5c, 0x6f, 0x7f, 0xf9, 0xde, 0xd5,
-  0x0a, 0x6f, 0x7e, 0xea, 0x9f, 0x3d, 0x1f, 0xdc, 0x6e, 0xbe, 0xf4, 0xed,
-  0xcf, 0x73, 0xed, 0xa7, 0xdf, 0x4f, 0xd7, 0x40, 0xaf, 0xed, 0x5d, 0x7d,
-  0xf9, 0x1f, 0x8e, 0xe2, 0x1b, 0x3f, 0x3a, 0x03, 0x52, 0x06, 0xba, 0x27,
-  0x91, 0xdf, 0xfc, 0xcb, 0x15, 0x53, 0xa3, 0x66, 0x06, 0xc1, 0x05, 0x17,
-  0x5f, 0xf0, 0x28, 0x4f, 0xbf, 0x3c, 0x38, 0xd5, 0x9b, 0xff, 0x89, 0x80,
-  0x96, 0x09, 0x2c, 0x02, 0xc0, 0x4e, 0xee, 0x25, 0x5f, 0x3c, 0xc2, 0xd1,
-  0xca, 0x81, 0x6f, 0xb0, 0x66, 0x5d, 0x3f, 0xe1, 0xac, 0xc1, 0xa9, 0x57,
-  0x2e, 0x2a, 0x6d, 0x4b, 0x40, 0x34, 0x87, 0x72, 0xc1, 0xc5, 0xef, 0x5d,
-  0x4c, 0x6e, 0x38, 0xc5, 0x73, 0x2f, 0xd9, 0xb7, 0xd8, 0xfb, 0x8d, 0x38,
-  0x3b, 0x33, 0x43, 0x2c, 0x0b, 0x34, 0x30, 0xd3, 0x13, 0x21, 0x61, 0x65,
-  0x4b, 0xab, 0x86, 0x92, 0x52, 0xa4, 0x62, 0x31, 0x22, 0x35, 0xf5, 0xbc,
-  0xfb, 0xd3, 0x7f, 0x87, 0xdf, 0xef, 0xc3, 0x4c, 0xa5, 0x44, 0x00, 0x54,
-  0xca, 0xa9, 0x3f, 0x52, 0x83, 0x7b, 0xee, 0x2c, 0x76, 0xbc, 0xfa, 0x22,
-  0xd7, 0xff, 0xfd, 0xfb, 0xb8, 0xfb, 0xc1, 0x7b, 0x1c, 0xe9, 0xeb, 0xa7,
-  0x77, 0x9d, 0xcc, 0x1d, 0x9f, 0x39, 0x16, 0x06, 0x93, 0xe8, 0x91, 0x4c,
-  0xf9, 0x6f, 0xfe, 0x4d, 0x01, 0x08, 0x7b, 0xb9, 0xee, 0x8a, 0x35, 0xfc,
-  0xfe, 0x8f, 0xbd, 0x53, 0xd5, 0xf3, 0x1b, 0x1e, 0xff, 0x27, 0x30, 0x05,
-  0x79, 0x5c, 0x44, 0x00, 0x4c, 0x4f, 0xee, 0x06, 0x6e, 0x25, 0x9f, 0x47,
-  0x7a, 0x0a, 0x45, 0xc0, 0x82, 0xd2, 0xb6, 0x04, 0x24, 0x0c, 0x94, 0x69,
-  0x72, 0xee, 0xbb, 0x17, 0x53, 0x8b, 0xc5, 0xe3, 0xcf, 0xf4, 0xd9, 0xd6,
-  0xfc, 0x98, 0x99, 0xe6, 0x85, 0x64, 0x37, 0xad, 0xde, 0x08, 0x4b, 0xfd,
-  0x0d, 0xa4, 0xb4, 0x81, 0x85, 0x55, 0x12, 0xd6, 0x00, 0xa5, 0x14, 0xa3,
-  0x23, 0x83, 0x9c, 0x7f, 0xeb, 0x8d, 0x2c, 0xfd, 0xff, 0xed, 0x9d, 0x77,
-  0x7c, 0x55, 0xf5, 0xf9, 0xc7, 0xdf, 0xe7, 0xee, 0xe4, 0xe6, 0x66, 0x4f,
-  0x20, 0x40, 0x42, 0x64, 0xc8, 0x94, 0x25, 0x43, 0x41, 0x14, 0xb7, 0xa0,
-  0xe2, 0xaa, 0xd2, 0x5a, 0x77, 0x87, 0xd5, 0x9f, 0xad, 0xb5, 0x56, 0x6d,
-  0x6d, 0xed, 0xb2, 0xd2, 0x61, 0xd5, 0xd6, 0xfe, 0x6a, 0x6b, 0x5b, 0x67,
-  0xd5, 0xaa, 0x38, 0x0a, 0xa8, 0x55, 0x51, 0x14, 0x50, 0x96, 0x20, 0x43,
-  0xc2, 0x0a, 0x09, 0x49, 0x48, 0x42, 0xe6, 0xdd, 0xf3, 0x9c, 0xdf, 0x1f,
-  0xdf, 0x7b, 0x0b, 0x3f, 0x5b, 0x5b, 0xac, 0xc9, 0x1d, 0xc9, 0xf3, 0x7e,
-  0xbd, 0xf0, 0xbe, 0x0c, 0xd1, 0x73, 0xee, 0x39, 0xdf, 0x73, 0x9e, 0xcf,
-  0xf3, 0x7c, 0x9f, 0xb1, 0xf0, 0x0c, 0xf1, 0xfe, 0xfb, 0x89, 0xd7, 0x6f,
-  0xd2, 0x34, 0x6c, 0x43, 0x6b, 0x20, 0x1a, 0xe5, 0xc7, 0xf7, 0xfd, 0x90,
-  0x0b, 0xbf, 0x7d, 0x05, 0x75, 0x07, 0x1b, 0x7a, 0xfd, 0x50, 0x83, 0x8b,
-  0x1c, 0xbc, 0xf1, 0xd2, 0xa9, 0x9c, 0x75, 0xe9, 0x28, 0x68, 0x8c, 0x77,
-  0xf7, 0x33, 0x67, 0xf0, 0xfa, 0x49, 0x18, 0x7f, 0x97, 0x95, 0x2f, 0x9c,
-  0xfb, 0x77, 0xfe, 0xb2, 0x22, 0x69, 0x5d, 0xfe, 0x12, 0xc6, 0x7f, 0x6e,
-  0x3c, 0x02, 0x20, 0x88, 0x00, 0xe8, 0x33, 0x1e, 0x07, 0xae, 0xa1, 0x8f,
-  0xc7, 0x07, 0x1f, 0x16, 0x01, 0x2d, 0x71, 0x11, 0x70, 0x0c, 0x5a, 0x34,
-  0x0a, 0xc1, 0x58, 0x7a, 0x36, 0x0b, 0x0a, 0xc6, 0xd0, 0x42, 0x51, 0x66,
-  0x2c, 0xa8, 0x66, 0x64, 0x99, 0x9d, 0xe7, 0x7b, 0xb1, 0xc5, 0x67, 0xc4,
-  0xd0, 0x59, 0xe7, 0x6f, 0xc2, 0xae, 0x59, 0x98, 0x90, 0x55, 0x8e, 0x81,
-  0x41, 0xc8, 0x48, 0x7d, 0x72, 0x60, 0xc0, 0xeb, 0x25, 0xbf, 0xa8, 0x94,
-  0xf3, 0xbf, 0x79, 0x3d, 0x36, 0x8b, 0x99, 0x58, 0x30, 0x24, 0x02, 0x20,
-  0x73, 0x2d, 0x3f, 0xe8, 0x3a, 0xb6, 0xc2, 0x12, 0x4c, 0x83, 0x2b, 0x78,
-  0x7f, 0xe5, 0x2b, 0x5c, 0x74, 0xeb, 0x17, 0x79, 0x74, 0xc5, 0x33, 0x7d,
-  0x72, 0xb4, 0x39, 0x53, 0x8b, 0x79, 0x7d, 0xd9, 0xe9, 0x8c, 0x9c, 0x5e,
-  0x06, 0xfb, 0xba, 0x30, 0x62, 0x64, 0xf6, 0xa4, 0xc8, 0x98, 0x81, 0x56,
-  0xe2, 0x80, 0x5c, 0x1b, 0x57, 0x5e, 0xf8, 0x06, 0x8f, 0xbe, 0x58, 0x9f,
-  0xcc, 0xa3, 0xb7, 0x01, 0x97, 0x02, 0x7b, 0x64, 0x1d, 0x8b, 0x00, 0xe8,
-  0x6b, 0x22, 0xc0, 0x1b, 0xc0, 0x45, 0x24, 0x21, 0x1f, 0x20, 0x11, 0x09,
-  0xd0, 0xdc, 0x41, 0x4e, 0x5a, 0x54, 0x8d, 0xa6, 0x1b, 0x10, 0x48, 0x43,
-  0x11, 0xa0, 0x69, 0x10, 0xd6, 0xd1, 0x7c, 0x11, 0xc6, 0x9f, 0x32, 0x8c,
-  0x19, 0x63, 0x73, 0x59, 0xfa, 0x42, 0x3d, 0x11, 0xbd, 0xf7, 0xb6, 0xe2,
-  0xb6, 0x87, 0xda, 0xe8, 0x8c, 0x05, 0x18, 0x9f, 0x55, 0x9a, 0xf2, 0xbc,
-  0x00, 0xe5, 0xfd, 0xb7, 0x31, 0xe7, 0x92, 0x45, 0x8c, 0x5e, 0x78, 0x26,
-  0x91, 0xb6, 0x76, 0x31, 0xfe, 0x99, 0x6a, 0xfa, 0xf5, 0x18, 0x76, 0x9b,
-  0x03, 0xf3, 0xf0, 0x2a, 0x3c, 0xad, 0x07, 0xf9, 0xf6, 0x92, 0x3b, 0xb8,
-  0xe6, 0x27, 0x37, 0xd1, 0x78, 0xa8, 0x6f, 0xc2, 0xd7, 0x5f, 0xfa, 0xfc,
-  0x08, 0x9e, 0x7b, 0xf6, 0x54, 0x72, 0x4a, 0x1c, 0x18, 0xfb, 0xdc, 0x99,
-  0x9d, 0xe9, 0x9f, 0x30, 0xfe, 0x85, 0x76, 0x28, 0xb0, 0x73, 0xf9, 0xb9,
-  0xaf, 0x25, 0xdb, 0xf8, 0xd7, 0x02, 0x3f, 0x02, 0x5e, 0x93, 0x95, 0x2c,
-  0x02, 0x20, 0x59, 0xb4, 0x93, 0xa4, 0x76, 0xc1, 0x09, 0xde, 0x7a, 0xaf,
-  0x0d, 0x5f, 0xb3, 0x9f, 0xd3, 0x2e, 0x39, 0x06, 0xcd, 0x30, 0x20, 0x1d,
-  0xfb, 0x81, 0x6b, 0x9a, 0x7a, 0x19, 0x74, 0x07, 0xa9, 0x99, 0x3d, 0x84,
-  0x85, 0xf3, 0xca, 0x79, 0xf1, 0xa5, 0x7a, 0x3c, 0x81, 0xde, 0x1b, 0x85,
-  0xda, 0x10, 0xe9, 0xe1, 0xa3, 0xd0, 0x21, 0x6a, 0xec, 0x45, 0x54, 0xda,
-  0xf2, 0xf0, 0xeb, 0x11, 0x74, 0x8c, 0xa4, 0x0b, 0x81, 0xb0, 0x3f, 0x40,
-  0xb6, 0x33, 0x97, 0x45, 0xdf, 0xbc, 0x1e, 0x87, 0xd3, 0x49, 0xcc, 0x2f,
-  0x7b, 0xff, 0x19, 0x67, 0xf8, 0x0d, 0x03, 0xb3, 0xa6, 0x61, 0x1b, 0x5c,
-  0x05, 0xd9, 0x4e, 0x9e, 0x79, 0xf6, 0x11, 0xce, 0xbb, 0x79, 0x31, 0xaf,
-  0xbd, 0xff, 0x56, 0x9f, 0x1d, 0xf3, 0xc1, 0x25, 0xd3, 0xb9, 0xeb, 0xe7,
-  0xb3, 0x20, 0x10, 0xc1, 0x68, 0xca, 0xf0, 0x64, 0xbf, 0x84, 0xf1, 0xcf,
-  0xb7, 0x41, 0x91, 0x93, 0x9b, 0xaf, 0x7a, 0x9b, 0xdf, 0x3d, 0xbd, 0x2f,
-  0x99, 0x47, 0xaf, 0x05, 0x9e, 0x02, 0xee, 0x97, 0xd5, 0x2c, 0x02, 0x20,
-  0xd9, 0x6c, 0x43, 0x4d, 0x0f, 0xb4, 0x25, 0x4b, 0x04, 0xac, 0xd9, 0xd4,
-  0x1e, 0xef, 0x13, 0x70, 0x0c, 0x9a, 0x66, 0x40, 0x3a, 0x8e, 0x03, 0xd5,
-  0x50, 0x43, 0x3f, 0x3a, 0x03, 0x94, 0x4d, 0x2a, 0xe6, 0xf2, 0x45, 0xc3,
-  0x79, 0x6f, 0x4d, 0x2b, 0x0d, 0x07, 0xfd, 0xbd, 0x76, 0x88, 0xee, 0x58,
-  0x90, 0x35, 0xfe, 0x03, 0xe4, 0x98, 0x6c, 0x8c, 0x75, 0x94, 0x02, 0x24,
-  0x75, 0x4b, 0x40, 0x65, 0xfe, 0xb7, 0x32, 0x63, 0xc1, 0x99, 0x4c, 0xfc,
-  0xdc, 0x22, 0x22, 0xad, 0x6d, 0x62, 0xfc, 0x33, 0xcb, 0xf2, 0x63, 0x18,
-  0x06, 0xf6, 0xa2, 0x52, 0x4c, 0x15, 0xe5, 0x7c, 0xb0, 0xfe, 0x5d, 0x2e,
-  0xbf, 0xed, 0x2a, 0x96, 0x3c, 0x7a, 0x3f, 0x6e, 0x7f, 0xdf, 0xd4, 0xaa,
-  0x57, 0x0d, 0xca, 0x66, 0xf9, 0x33, 0xa7, 0x70, 0xfe, 0x17, 0x8f, 0x85,
-  0x26, 0x0f, 0x86, 0x3b, 0x0c, 0xe6, 0x7e, 0x60, 0xfc, 0x8b, 0xec, 0x71,
-  0xe3, 0xbf, 0x92, 0x5f, 0xfe, 0x69, 0x57, 0xb2, 0x8d, 0xff, 0x0e, 0xe0,
-  0x2b, 0xb2, 0xa0, 0x45, 0x00, 0xa4, 0x8a, 0xe7, 0x51, 0x7b, 0x4f, 0xfe,
-  0xa4, 0x89, 0x80, 0x0f, 0x3a, 0x38, 0x58, 0xdb, 0xc5, 0x82, 0xcb, 0x6a,
-  0xd0, 0x6c, 0x26, 0xf0, 0xa4, 0xa9, 0x08, 0xd0, 0x34, 0x68, 0x0f, 0xe2,
-  0xac, 0xca, 0xe1, 0xca, 0xc5, 0x35, 0x34, 0xec, 0xea, 0x61, 0xf3, 0x47,
-  0xbd, 0x97, 0x9f, 0x13, 0xc3, 0x60, 0x4b, 0xb0, 0x85, 0xce, 0x58, 0x80,
-  0x31, 0xf6, 0x12, 0x0a, 0x2c, 0x0e, 0xfc, 0x7a, 0x24, 0x29, 0x55, 0x02,
-  0xb1, 0x48, 0x04, 0x93, 0x66, 0x66, 0xe1, 0x0d, 0xd7, 0x91, 0x5b, 0x51,
-  0x4a, 0x54, 0xea, 0xfe, 0x33, 0x07, 0x3d, 0x86, 0x2d, 0x27, 0x17, 0xcb,
-  0xb0, 0x4a, 0xba, 0x9a, 0x9a, 0xb8, 0xfd, 0x67, 0xb7, 0x71, 0xe5, 0x0f,
-  0xbe, 0xc6, 0xbe, 0xa6, 0xbe, 0x0b, 0x5b, 0x5f, 0x74, 0x56, 0x25, 0x2b,
-  0x9e, 0x9b, 0xcf, 0x88, 0xa9, 0x65, 0xb0, 0xaf, 0x5b, 0xb5, 0xf5, 0x35,
-  0x65, 0xf8, 0x7a, 0x49, 0x84, 0xfd, 0xf3, 0x6c, 0x7c, 0xe3, 0xda, 0x55,
-  0xdc, 0x9b, 0x7c, 0xe3, 0xdf, 0x04, 0x9c, 0x2d, 0x0b, 0x5a, 0x04, 0x40,
-  0xaa, 0xf9, 0x23, 0x70, 0x39, 0x49, 0x2a, 0x0f, 0x04, 0xd8, 0xb8, 0xad,
-  0x8b, 0xba, 0x2d, 0x9d, 0x9c, 0xbf, 0xb8, 0x06, 0x2d, 0xcb, 0x02, 0x3d,
-  0xe1, 0xf4, 0x7c, 0xa1, 0x98, 0x34, 0xe8, 0x0a, 0xa3, 0x39, 0xad, 0x9c,
-  0xfb, 0x85, 0x91, 0x58, 0xfd, 0x51, 0xde, 0x5c, 0xd3, 0xda, 0xab, 0x87,
-  0x68, 0x88, 0xf4, 0xb0, 0x29, 0x78, 0x90, 0x0a, 0x4b, 0x2e, 0xc7, 0xd8,
-  0x0b, 0xfb, 0xbc, 0x7b, 0xa0, 0xa6, 0x69, 0x74, 0xb7, 0x1d, 0x62, 0xdc,
-  0x9c, 0x59, 0xcc, 0xbe, 0xf2, 0x52, 0x62, 0x9d, 0xdd, 0x18, 0x86, 0x94,
-  0x1c, 0xa7, 0xbd, 0xd3, 0xaf, 0xc7, 0xb0, 0xdb, 0xb3, 0x30, 0x0f, 0x1b,
-  0x8e, 0xe1, 0x0f, 0x70, 0xdf, 0xef, 0x7f, 0xc1, 0xa5, 0x77, 0x5c, 0xc3,
-  0x1b, 0x1b, 0xde, 0xe9, 0xd3, 0xe3, 0xfe, 0xe2, 0xae, 0xc9, 0xfc, 0xf2,
-  0xa1, 0x39, 0xd8, 0x6d, 0x26, 0x8c, 0x7a, 0x4f, 0xe6, 0xef, 0xf7, 0x1f,
-  0xe9, 0xf9, 0x17, 0x66, 0xf3, 0x95, 0xc5, 0x6f, 0xf0, 0xeb, 0xc7, 0x92,
-  0x9a, 0x7b, 0x57, 0x8b, 0xca, 0xf4, 0x9f, 0x23, 0xab, 0x5a, 0x04, 0x40,
-  0xba, 0xf0, 0x87, 0xb8, 0x08, 0x08, 0x26, 0x4b, 0x04, 0x6c, 0xa9, 0xed,
-  0x61, 0xe3, 0x3b, 0x2d, 0x5c, 0x76, 0x71, 0x35, 0x5a, 0x69, 0x36, 0x74,
-  0x85, 0xd2, 0x57, 0x04, 0x78, 0x23, 0x68, 0x51, 0x9d, 0x39, 0xe7, 0x8d,
-  0x60, 0x62, 0x55, 0x0e, 0x2f, 0x2f, 0x3f, 0x40, 0xa4, 0x17, 0x67, 0x1d,
-  0xf8, 0xf4, 0x08, 0xef, 0xf9, 0x0f, 0x10, 0x31, 0x74, 0x46, 0x3b, 0x8a,
-  0x71, 0x99, 0xec, 0x04, 0x8c, 0x3e, 0x8a, 0x06, 0x18, 0x06, 0x01, 0x9f,
-  0x8f, 0x53, 0xaf, 0x5a, 0x4c, 0xd9, 0xc4, 0x71, 0x44, 0xbb, 0x7b, 0x24,
-  0xfc, 0x9f, 0xd6, 0x86, 0x5f, 0xc7, 0x6e, 0xb5, 0x62, 0x19, 0x5a, 0x0d,
-  0x66, 0x2b, 0xcf, 0xbd, 0xf0, 0x04, 0x97, 0x7e, 0xe7, 0x3a, 0x1e, 0x5d,
-  0xf1, 0x0c, 0xbe, 0x60, 0xa0, 0xcf, 0x8e, 0x3b, 0xba, 0xca, 0xc5, 0xb3,
-  0x8f, 0x9f, 0xc4, 0xa5, 0xd7, 0x1e, 0x0b, 0x2d, 0x7e, 0x8c, 0x8e, 0x50,
-  0x66, 0x97, 0xf8, 0x1d, 0x69, 0xfc, 0xe3, 0xd9, 0xfe, 0x37, 0x5c, 0xf1,
-  0x16, 0x0f, 0x3e, 0xb1, 0x37, 0xd9, 0xc6, 0xbf, 0x07, 0x98, 0x21, 0x2b,
-  0xbb, 0x97, 0x1c, 0x1a, 0xb9, 0x04, 0xbd, 0x86, 0x15, 0xd8, 0x00, 0xb8,
-  0x80, 0xaa, 0x64, 0x1d, 0x74, 0xc6, 0x84, 0x42, 0x96, 0x2d, 0x3d, 0x95,
-  0xc2, 0xea, 0x5c, 0x8c, 0xbd, 0x71, 0x63, 0x94, 0x8e, 0x77, 0x55, 0x37,
-  0xd0, 0xac, 0x26, 0x18, 0x9a, 0xcf, 0xde, 0x8d, 0x2d, 0x2c, 0xba, 0x74,
-  0x25, 0x1f, 0xee, 0xee, 0xe9, 0xf5, 0xc3, 0x0c, 0xb7, 0xe5, 0x73, 0x71,
-  0xde, 0x38, 0xc6, 0xd8, 0x4b, 0xe8, 0xd2, 0x03, 0xf8, 0xf5, 0x08, 0xa6,
-  0x5e, 0xbc, 0x20, 0x7e, 0xb7, 0x87, 0x82, 0xf2, 0x52, 0xae, 0x7f, 0xe8,
-  0x5e, 0xec, 0x39, 0x4e, 0xc2, 0x3e, 0xbf, 0xac, 0xfc, 0x34, 0x35, 0xfc,
-  0x36, 0x8b, 0x15, 0xad, 0xa2, 0x12, 0xa2, 0x51, 0x5e, 0x5d, 0xf9, 0x32,
-  0x3f, 0x7e, 0xf8, 0xe7, 0xbc, 0xb3, 0xf9, 0xbd, 0x3e, 0x3f, 0xf6, 0xb5,
-  0x97, 0x8d, 0xe0, 0xc1, 0xfb, 0x66, 0x62, 0x29, 0xce, 0x86, 0xba, 0x1e,
-  0x15, 0x21, 0xea, 0x0f, 0x22, 0x31, 0xaa, 0xa3, 0x0d, 0xca, 0x06, 0xa7,
-  0x95, 0xcb, 0xcf, 0xfd, 0x3b, 0x8f, 0xbd, 0x94, 0xd4, 0x6c, 0xff, 0x3a,
-  0x54, 0xf2, 0xf5, 0x74, 0x59, 0xdd, 0xbd, 0xe8, 0x9f, 0xc9, 0x25, 0xe8,
-  0x35, 0x22, 0xc0, 0x09, 0x24, 0x69, 0x7a, 0x60, 0x82, 0xf7, 0x3e, 0xec,
-  0xe4, 0xf8, 0x39, 0x7f, 0xa3, 0x6e, 0xe3, 0x21, 0xb4, 0x11, 0x05, 0xea,
-  0x3d, 0x93, 0x8e, 0x11, 0x69, 0x93, 0x86, 0x11, 0x35, 0x30, 0xf6, 0x74,
-  0x32, 0x62, 0x4a, 0x31, 0x1b, 0xde, 0x3d, 0x87, 0xcf, 0x2d, 0x1c, 0xda,
-  0xeb, 0x87, 0xd9, 0x1f, 0xee, 0x66, 0xc9, 0xa1, 0x77, 0xf9, 0x6b, 0xcf,
-  0x76, 0xcc, 0x68, 0x94, 0x5b, 0x72, 0xd0, 0x7a, 0x6b, 0xbc, 0xb0, 0xa6,
-  0xe1, 0xf7, 0xbb, 0x19, 0x35, 0x73, 0x1a, 0xf6, 0xca, 0xc1, 0x44, 0xc4,
-  0xf8, 0xa7, 0x9f, 0xe1, 0x37, 0x74, 0x2c, 0x66, 0x33, 0xf6, 0xca, 0x2a,
-  0xb4, 0x8a, 0x21, 0xac, 0x5d, 0xfd, 0x1a, 0x8b, 0xae, 0x3f, 0x9f, 0x33,
-  0x6e, 0xb8, 0xb0, 0xcf, 0x8d, 0x7f, 0xa1, 0xcb, 0xca, 0x93, 0xbf, 0x9b,
-  0xcd, 0x43, 0x4f, 0x9c, 0x8c, 0xc5, 0x6e, 0xc6, 0xd8, 0xdd, 0xad, 0x56,
-  0x5d, 0x7f, 0x31, 0xfe, 0x95, 0x39, 0x00, 0x5c, 0x7a, 0xf6, 0xab, 0xa9,
-  0x32, 0xfe, 0xc7, 0xcb, 0x0a, 0x97, 0x08, 0x40, 0xba, 0x53, 0x0a, 0xac,
-  0x42, 0x55, 0x07, 0x24, 0x2d, 0x12, 0x90, 0xeb, 0x30, 0xf3, 0xd2, 0x5f,
-  0xe6, 0x31, 0xf7, 0xbc, 0x1a, 0x68, 0xec, 0xc1, 0x08, 0xc5, 0xd2, 0x37,
-  0xd1, 0x28, 0x6a, 0xa0, 0x55, 0x64, 0x43, 0x8e, 0x95, 0xfb, 0x7e, 0xb4,
-  0x89, 0x9b, 0xbe, 0xdb, 0x37, 0x13, 0x3b, 0x2b, 0xac, 0x2e, 0x2e, 0xca,
-  0x1b, 0xcb, 0x44, 0x47, 0x39, 0x7e, 0x3d, 0x42, 0x8f, 0x1e, 0xfc, 0x4c,
-  0xd1, 0x80, 0x58, 0x34, 0x46, 0xd0, 0xeb, 0xe3, 0xda, 0x7b, 0x7f, 0xc4,
-  0xb0, 0x39, 0x33, 0x08, 0x1f, 0x94, 0xec, 0xff, 0xb4, 0xf4, 0xf8, 0x63,
-  0x51, 0xd6, 0xbe, 0xf7, 0x26, 0x4b, 0x1e, 0xfb, 0x35, 0x2f, 0xbc, 0xb5,
-  0x2c, 0x29, 0xc7, 0xbf, 0xe0, 0xec, 0x4a, 0x1e, 0x58, 0x32, 0x9d, 0x8a,
-  0x63, 0x8b, 0x55, 0x57, 0xbf, 0x74, 0x7e, 0xfe, 0xfe, 0x9b, 0xe7, 0x75,
-  0x78, 0x0e, 0xf8, 0xa3, 0x9c, 0x79, 0xce, 0xab, 0xbc, 0xf2, 0x6e, 0x6b,
-  0x32, 0x8f, 0x5e, 0x87, 0x2a, 0xb9, 0x9e, 0x26, 0xab, 0x5c, 0x04, 0x40,
-  0xa6, 0x30, 0x04, 0x78, 0x3d, 0xd9, 0x22, 0x00, 0xe0, 0xb1, 0x07, 0x67,
-  0xf1, 0xf9, 0xaf, 0x8c, 0x87, 0x36, 0x2f, 0x86, 0x3b, 0x92, 0xbe, 0xfb,
-  0x8e, 0x31, 0x03, 0x2d, 0xc7, 0x0a, 0xe5, 0x39, 0xac, 0x5a, 0xb1, 0x9f,
-  0xcb, 0xaf, 0x5a, 0x45, 0x7d, 0x4b, 0xdf, 0xec, 0xc9, 0xce, 0xcc, 0xae,
-  0xe4, 0xec, 0xdc, 0x91, 0x0c, 0xb6, 0xb8, 0xe8, 0x88, 0x05, 0x08, 0x1a,
-  0xd1, 0xff, 0x4a, 0x08, 0x78, 0x3a, 0xbb, 0x18, 0x36, 0x76, 0x0c, 0xd7,
-  0x3e, 0x70, 0x37, 0x1a, 0x10, 0x09, 0x49, 0xcb, 0xf1, 0x34, 0xb0, 0xfc,
-  0xd8, 0xec, 0x59, 0x50, 0x3e, 0x18, 0x62, 0x3a, 0xef, 0xbe, 0xbd, 0x9c,
-  0xfb, 0x9f, 0x7a, 0x88, 0xbf, 0xae, 0x7c, 0x39, 0x29, 0x87, 0xcf, 0x73,
-  0x5a, 0xf8, 0xc5, 0x0f, 0xa7, 0x70, 0xf5, 0x4d, 0xe3, 0x21, 0x14, 0xc3,
-  0x68, 0xf4, 0xf5, 0x8f, 0x44, 0xbf, 0x23, 0x9f, 0xd3, 0x6a, 0x17, 0xfe,
-  0x96, 0x00, 0xf3, 0xcf, 0x7c, 0x85, 0xb5, 0x1f, 0x76, 0x26, 0xf3, 0xe8,
-  0x75, 0x40, 0x67, 0xdc, 0xf3, 0x8f, 0xc9, 0x62, 0xef, 0x7d, 0x24, 0x09,
-  0xb0, 0x6f, 0x70, 0x03, 0xaf, 0x02, 0x97, 0x90, 0xa4, 0x96, 0xc1, 0x09,
-  0x96, 0x2e, 0x3b, 0x40, 0xb4, 0x2b, 0xc8, 0xc9, 0x17, 0x56, 0xab, 0x32,
-  0x41, 0x77, 0x1a, 0x57, 0x08, 0x44, 0x62, 0x68, 0xdd, 0x21, 0x86, 0x4d,
-  0x2b, 0xe3, 0xca, 0x4b, 0xaa, 0xa9, 0xdf, 0xe7, 0x61, 0x5b, 0x6d, 0xef,
-  0xe7, 0x05, 0x34, 0x46, 0xdc, 0xac, 0xf5, 0x37, 0xa2, 0x03, 0x35, 0xb6,
-  0x42, 0x0a, 0xcc, 0x59, 0x04, 0xf4, 0xe8, 0xa7, 0x6a, 0x20, 0xa4, 0x69,
-  0x1a, 0xee, 0x9e, 0x0e, 0x66, 0x9e, 0xbf, 0x80, 0xea, 0xf9, 0x73, 0x89,
-  0x74, 0x74, 0x8b, 0x7c, 0x4e, 0x99, 0xd1, 0x57, 0x1b, 0x3a, 0x76, 0x67,
-  0x0e, 0xe6, 0xc1, 0x43, 0x21, 0xa6, 0xb3, 0xfc, 0x8d, 0x17, 0xb9, 0xe9,
-  0xa7, 0xb7, 0x70, 0xfb, 0x83, 0x3f, 0x64, 0xc7, 0xfe, 0xe4, 0x94, 0xa4,
-  0x5d, 0xbc, 0x60, 0x28, 0x2f, 0x3d, 0x75, 0x32, 0x73, 0x17, 0x56, 0x43,
-  0xb3, 0x0f, 0xa3, 0x2b, 0x9e, 0xe8, 0xd7, 0x1f, 0xd6, 0x85, 0x11, 0xaf,
-  0xe6, 0x1d, 0x51, 0x40, 0xeb, 0xee, 0x6e, 0x66, 0xce, 0x5d, 0xc6, 0xe6,
-  0x5d, 0x3d, 0xc9, 0x3c, 0x83, 0x84, 0xf1, 0x9f, 0x0e, 0xe8, 0xb2, 0xe8,
-  0x25, 0x02, 0x90, 0x89, 0x1c, 0x03, 0xbc, 0x9c, 0x8a, 0x48, 0xc0, 0xe2,
-  0xf3, 0x86, 0xf1, 0xe8, 0xc3, 0x73, 0x30, 0x15, 0xd8, 0x61, 0xaf, 0x1b,
-  0x23, 0x9d, 0xbd, 0x92, 0xa8, 0xae, 0x66, 0x87, 0x67, 0x59, 0xf8, 0xf5,
-  0xdd, 0x5b, 0xb8, 0xf1, 0xf6, 0xf5, 0x7d, 0x96, 0xc6, 0x50, 0x65, 0x2b,
-  0xe0, 0x0c, 0x57, 0x0d, 0x93, 0x1c, 0x15, 0xe8, 0x18, 0x74, 0xc5, 0x02,
-  0x47, 0x55, 0x2d, 0x10, 0x8b, 0x46, 0x09, 0x07, 0x82, 0x5c, 0x77, 0xff,
-  0xdd, 0x0c, 0x99, 0x3e, 0x99, 0x70, 0x5b, 0xbb, 0xac, 0xee, 0xa4, 0xdb,
-  0x7d, 0xd5, 0xb9, 0xcf, 0x52, 0x50, 0x0c, 0x79, 0xb9, 0xd0, 0xda, 0xca,
-  0xe3, 0xaf, 0x3e, 0xc7, 0x83, 0xcf, 0xff, 0x89, 0xb5, 0x5b, 0x37, 0x24,
-  0xed, 0x3c, 0x86, 0x94, 0x65, 0xf1, 0xb3, 0x1f, 0x4e, 0xe1, 0x73, 0xd7,
-  0x8c, 0x82, 0xb0, 0xae, 0xbc, 0x7e, 0xad, 0x9f, 0x79, 0xfd, 0xd9, 0x16,
-  0x18, 0x94, 0xcb, 0xda, 0x57, 0xf7, 0xb3, 0xf8, 0xca, 0x55, 0xd4, 0x1d,
-  0x4c, 0x6a, 0xbe, 0x4b, 0xc2, 0xf8, 0xcf, 0x44, 0xe5, 0x56, 0x09, 0x22,
-  0x00, 0x32, 0x96, 0xb1, 0xc0, 0x73, 0xa9, 0x10, 0x01, 0x53, 0xc6, 0xe4,
-  0xb3, 0xf4, 0xaf, 0xa7, 0x50, 0x39, 0xb6, 0x08, 0xf6, 0xf7, 0x60, 0xe8,
-  0x69, 0x7c, 0xc7, 0x63, 0x06, 0x9a, 0xd3, 0x02, 0x15, 0xb9, 0x6c, 0x7f,
-  0xa7, 0x91, 0x1b, 0x6e, 0x5d, 0xc7, 0xca, 0xb5, 0x6d, 0x7d, 0x76, 0xb8,
-  0x09, 0x8e, 0x32, 0x4e, 0x77, 0xd5, 0x30, 0xda, 0x5e, 0x42, 0xc0, 0x88,
-  0xd0, 0x13, 0x0b, 0xfd, 0xdb, 0x07, 0xc2, 0xdd, 0xd1, 0x49, 0xd5, 0x84,
-  0xb1, 0x5c, 0xf7, 0xeb, 0x7b, 0x30, 0xa2, 0x51, 0x22, 0x61, 0x79, 0x2f,
-  0x25, 0xcd, 0xf0, 0xeb, 0x3a, 0x76, 0xbb, 0x03, 0x8a, 0xcb, 0xc0, 0x62,
-  0xa5, 0xa9, 0xf6, 0x43, 0xfe, 0xf2, 0xca, 0xb3, 0xfc, 0xe1, 0xa5, 0x27,
-  0xa9, 0x3d, 0x90, 0xd4, 0x32, 0x34, 0xbe, 0x76, 0xd5, 0x48, 0x7e, 0xf2,
-  0xbd, 0xc9, 0xb8, 0x86, 0xe6, 0x41, 0x93, 0x1b, 0x23, 0xd8, 0x8f, 0xf6,
-  0xfa, 0x13, 0x62, 0xbc, 0x22, 0x1b, 0x72, 0xec, 0x3c, 0x78, 0xcf, 0x07,
-  0x5c, 0xff, 0xed, 0xf5, 0xc9, 0x3e, 0x83, 0xc4, 0x9e, 0xff, 0xf1, 0xe2,
-  0xf9, 0x8b, 0x00, 0xe8, 0x2f, 0x8c, 0x06, 0x5e, 0x48, 0x85, 0x08, 0x28,
-  0xc9, 0xb5, 0xf2, 0xe4, 0x9f, 0xe6, 0x32, 0x7f, 0x51, 0x0d, 0xb4, 0xb8,
-  0x31, 0xbc, 0x69, 0x3c, 0x72, 0xd4, 0x40, 0xcd, 0x39, 0x18, 0xee, 0x82,
-  0x98, 0xce, 0x8f, 0xbf, 0xff, 0x01, 0xdf, 0xb9, 0x7b, 0x73, 0x9f, 0x1e,
-  0xf2, 0x04, 0xe7, 0x50, 0xe6, 0xe5, 0x54, 0x33, 0xdc, 0x9a, 0x87, 0x57,
-  0x0f, 0xe3, 0xd5, 0x23, 0xff, 0xfc, 0x50, 0x68, 0xd0, 0x7e, 0xb0, 0x89,
-  0x33, 0xae, 0xba, 0x82, 0x53, 0x6f, 0xbd, 0x91, 0x70, 0x63, 0xb3, 0xac,
-  0xe8, 0xa4, 0x78, 0xfb, 0x26, 0x2c, 0xb9, 0xf9, 0x50, 0x54, 0x00, 0x3d,
-  0x1e, 0x56, 0xaf, 0x5f, 0xc5, 0x9f, 0x97, 0x3d, 0xcd, 0xd3, 0x7f, 0x5f,
-  0x8a, 0xa7, 0x8f, 0x5a, 0xf6, 0x7e, 0x12, 0x33, 0x26, 0x17, 0x71, 0xef,
-  0x4f, 0xa6, 0x31, 0xe3, 0xf4, 0xa1, 0xe0, 0x09, 0x61, 0xb4, 0x06, 0xfa,
-  0x47, 0x5d, 0xff, 0xc7, 0x9f, 0xbd, 0x11, 0x79, 0xc4, 0x3a, 0x02, 0x5c,
-  0xfd, 0x95, 0xd5, 0x3c, 0xf2, 0xd7, 0xba, 0x64, 0x9f, 0x45, 0x22, 0xdb,
-  0x7f, 0x16, 0x10, 0x95, 0xa7, 0x40, 0x04, 0x40, 0x7f, 0x22, 0x65, 0xdb,
-  0x01, 0x00, 0x4b, 0xbe, 0x37, 0x99, 0x5b, 0xbe, 0x3f, 0x19, 0xbc, 0x11,
-  0x8c, 0x83, 0x01, 0xb0, 0xa4, 0xf1, 0xad, 0xd7, 0x0d, 0x34, 0x97, 0x15,
-  0x4a, 0x5d, 0xac, 0x59, 0x5e, 0xc7, 0xb5, 0x37, 0xae, 0x65, 0xc7, 0x5e,
-  0x77, 0x9f, 0x1d, 0xce, 0x8c, 0xc6, 0x49, 0x39, 0x55, 0x9c, 0x92, 0x53,
-  0x4d, 0x85, 0xd5, 0x85, 0x37, 0x16, 0xc6, 0xad, 0x1f, 0x8e, 0x08, 0xe8,
-  0xb1, 0x18, 0x41, 0x9f, 0x9f, 0xab, 0x7e, 0xf6, 0x03, 0xaa, 0xe6, 0xce,
-  0x24, 0xdc, 0x7a, 0x48, 0x56, 0x73, 0xdf, 0x58, 0x7d, 0xb5, 0xb7, 0x9f,
-  0x9d, 0x03, 0x45, 0xa5, 0x80, 0x41, 0xcb, 0x9e, 0x1d, 0x2c, 0x7d, 0xe7,
-  0x55, 0x1e, 0x5b, 0xfe, 0x0c, 0x6b, 0x3f, 0x5c, 0x97, 0xf4, 0x53, 0x2a,
-  0x2b, 0xb2, 0xf3, 0x83, 0x3b, 0x8e, 0xe3, 0xba, 0xeb, 0x46, 0x81, 0xd3,
-  0x0a, 0xfb, 0xbd, 0x18, 0x31, 0xbd, 0x7f, 0x79, 0xfd, 0xba, 0x81, 0xe6,
-  0x30, 0xc3, 0xe0, 0x5c, 0xb6, 0xac, 0x6e, 0xe2, 0x0b, 0x57, 0xac, 0x62,
-  0xeb, 0x1e, 0x77, 0xb2, 0xcf, 0x42, 0xea, 0xfc, 0x45, 0x00, 0x88, 0x08,
-  0xe8, 0x4b, 0x2e, 0x3d, 0x77, 0x18, 0x8f, 0xfd, 0x71, 0x0e, 0xe6, 0x42,
-  0x07, 0xec, 0x73, 0xc7, 0x6b, 0x94, 0xd3, 0xd8, 0x23, 0xd1, 0x80, 0xaa,
-  0x3c, 0xc2, 0x2d, 0x5e, 0x6e, 0xb8, 0x75, 0x3d, 0x0f, 0x3d, 0xba, 0xbb,
-  0x4f, 0x0f, 0xe9, 0x32, 0xd9, 0x98, 0xe5, 0x1c, 0xca, 0xd4, 0xac, 0xc1,
-  0x8c, 0xb0, 0x15, 0x10, 0x30, 0xa2, 0xb8, 0x63, 0x41, 0xbc, 0x3d, 0x6e,
-  0x4a, 0x87, 0x57, 0xf2, 0xe5, 0x07, 0xee, 0xc1, 0x9a, 0x9d, 0x45, 0x24,
-  0x10, 0x94, 0x95, 0xdc, 0xcb, 0x2f, 0x21, 0xab, 0xdd, 0x01, 0x85, 0x25,
-  0x60, 0xb7, 0x62, 0x34, 0x35, 0xf2, 0xea, 0xc6, 0x77, 0x79, 0xf6, 0xad,
-  0x65, 0x3c, 0xbf, 0x72, 0x19, 0x5d, 0xee, 0xae, 0x94, 0x9c, 0xd7, 0x2d,
-  0x5f, 0x3b, 0x96, 0xdb, 0x6f, 0x1a, 0x47, 0xfe, 0x88, 0x02, 0x68, 0xf5,
-  0x62, 0x78, 0x22, 0xfd, 0xcb, 0xeb, 0x07, 0xb5, 0xf5, 0x56, 0x96, 0x05,
-  0x2e, 0x1b, 0x8f, 0xfc, 0x66, 0x3b, 0x57, 0x7f, 0x6d, 0x4d, 0x2a, 0xd2,
-  0xed, 0x6b, 0x51, 0x89, 0xd3, 0xc7, 0x93, 0x9e, 0x5d, 0x4c, 0x44, 0x00,
-  0x08, 0xbd, 0xc6, 0x30, 0x54, 0x85, 0x40, 0x4a, 0x44, 0xc0, 0xd8, 0x11,
-  0xb9, 0x3c, 0xf2, 0x87, 0x13, 0x99, 0x72, 0xd2, 0x10, 0x68, 0xf6, 0x60,
-  0x04, 0xa2, 0xe9, 0xed, 0xcd, 0xc4, 0x0c, 0xb4, 0x52, 0x07, 0xe4, 0x3a,
-  0x78, 0xf1, 0x89, 0x5d, 0xdc, 0xf8, 0xcd, 0xf7, 0x69, 0x68, 0x09, 0xf4,
-  0xe9, 0x21, 0xcd, 0x9a, 0x89, 0x13, 0xb2, 0x87, 0x32, 0x23, 0x7b, 0x08,
-  0x23, 0x6c, 0x85, 0xb4, 0x37, 0x35, 0x33, 0xe9, 0xb2, 0x85, 0x9c, 0x79,
-  0xfb, 0x4d, 0x44, 0xda, 0xda, 0xa5, 0xf7, 0x7f, 0x2f, 0x78, 0xfa, 0x68,
-  0x1a, 0x36, 0x9b, 0x03, 0x0a, 0x8b, 0xc1, 0x66, 0x83, 0xf6, 0x56, 0x56,
-  0x7f, 0xf0, 0x1e, 0x2f, 0xac, 0x5a, 0xc1, 0xd2, 0x77, 0x5f, 0x63, 0x6f,
-  0x63, 0x5d, 0xca, 0x4e, 0xef, 0xb2, 0xf3, 0x87, 0xf3, 0xed, 0xaf, 0x8f,
-  0x63, 0xfc, 0x89, 0x83, 0xc1, 0x1d, 0x80, 0x43, 0x41, 0x8c, 0xfe, 0x94,
-  0xe4, 0xf7, 0xff, 0x04, 0x76, 0x2e, 0x91, 0x36, 0x3f, 0x5f, 0xfe, 0x9f,
-  0xb5, 0xfc, 0xf1, 0xa9, 0x7d, 0xa9, 0x38, 0x93, 0x44, 0x6f, 0x7f, 0x69,
-  0xef, 0x2b, 0x02, 0x60, 0xc0, 0x90, 0x92, 0x66, 0x41, 0x47, 0xde, 0xf4,
-  0x87, 0xef, 0x9b, 0xc9, 0x95, 0x37, 0x8e, 0x57, 0xfb, 0x99, 0x2d, 0x19,
-  0xb0, 0x25, 0x60, 0x35, 0xc1, 0xd0, 0x5c, 0xbc, 0x8d, 0x1e, 0x6e, 0xbf,
-  0x6b, 0x13, 0x0f, 0xfc, 0xa1, 0x36, 0x29, 0xd7, 0x69, 0x6a, 0xd6, 0x60,
-  0xc6, 0x04, 0xb2, 0x58, 0xf2, 0xc0, 0x6f, 0x29, 0xbb, 0x7a, 0x3e, 0x6c,
-  0xeb, 0x20, 0xea, 0xe9, 0x41, 0xef, 0x2f, 0xed, 0x5d, 0x93, 0x88, 0x59,
-  0xd3, 0x30, 0x67, 0xe7, 0x40, 0x7e, 0x21, 0x98, 0xcd, 0xd0, 0x71, 0x88,
-  0xd5, 0x1f, 0xae, 0xe3, 0x85, 0xb7, 0x57, 0xf0, 0xea, 0x7b, 0x6f, 0xb2,
-  0x75, 0xef, 0x47, 0x29, 0x3d, 0xbf, 0xb9, 0xb3, 0xca, 0xf8, 0xfe, 0xad,
-  0x13, 0x38, 0x69, 0xe1, 0x30, 0x88, 0xe8, 0x70, 0xc0, 0x97, 0xde, 0x51,
-  0xb2, 0xcf, 0x22, 0xaa, 0x5d, 0x56, 0x28, 0x73, 0xb1, 0xe1, 0xf5, 0x7a,
-  0xae, 0xfc, 0xea, 0x6a, 0xb6, 0xed, 0x76, 0xa7, 0xe2, 0x4c, 0x6a, 0x51,
-  0xd9, 0xfe, 0xb3, 0xe4, 0xe9, 0x10, 0x01, 0x30, 0xd0, 0x28, 0x04, 0xde,
-  0x06, 0x9c, 0xa9, 0x10, 0x01, 0x00, 0x57, 0x5c, 0x5c, 0xcd, 0x43, 0xf7,
-  0xcf, 0xc4, 0x5a, 0xe6, 0x84, 0x7d, 0x3d, 0x69, 0xff, 0xb2, 0xd3, 0x62,
-  0x06, 0x94, 0x65, 0x81, 0xcb, 0xce, 0xdf, 0xff, 0xba, 0x97, 0xdb, 0x7e,
-  0xf4, 0x01, 0x1b, 0x93, 0xd4, 0x98, 0x64, 0xce, 0x84, 0xe9, 0x5c, 0x74,
-  0xfa, 0x05, 0x7c, 0xee, 0x94, 0x73, 0x29, 0x1e, 0x31, 0x0a, 0xa2, 0x31,
-  0xe8, 0x6c, 0x23, 0x14, 0xf0, 0xab, 0x4b, 0x26, 0x62, 0xe0, 0x5f, 0x7b,
-  0xf9, 0x76, 0x07, 0xe4, 0xe4, 0x82, 0x2b, 0x07, 0x82, 0x61, 0xdc, 0xcd,
-  0x0d, 0xbc, 0xbd, 0x69, 0x35, 0xaf, 0xbe, 0xbf, 0x92, 0xb7, 0xb7, 0x6e,
-  0x60, 0xdb, 0xee, 0xed, 0x29, 0x3f, 0xd5, 0x19, 0x53, 0x8a, 0xb9, 0xf3,
-  0x1b, 0xe3, 0x39, 0xf3, 0x82, 0x2a, 0xb0, 0x9b, 0xa0, 0xc1, 0x8b, 0x11,
-  0xe9, 0x67, 0xfb, 0xfc, 0x71, 0xaf, 0x1f, 0xdd, 0x40, 0xab, 0x74, 0x82,
-  0x59, 0xe3, 0xe7, 0x3f, 0xde, 0xcc, 0x2d, 0xdf, 0xdf, 0x94, 0xaa, 0xb3,
-  0xa9, 0x05, 0xea, 0x81, 0xd3, 0xe5, 0x61, 0x11, 0x01, 0x30, 0x50, 0x71,
-  0x00, 0xab, 0x51, 0x8d, 0x82, 0x52, 0x22, 0x02, 0xc6, 0xd5, 0xe4, 0xf2,
-  0xf0, 0x83, 0xb3, 0x99, 0x7e, 0xea, 0x30, 0x68, 0xf3, 0xa4, 0x77, 0xf7,
-  0xc0, 0x44, 0x34, 0xc0, 0x62, 0x82, 0x61, 0x2e, 0xe8, 0x09, 0x71, 0xef,
-  0x7d, 0xdb, 0xb8, 0xf3, 0xa7, 0x5b, 0xf0, 0x06, 0x92, 0xb3, 0x73, 0x59,
-  0x52, 0x50, 0xc2, 0xf9, 0x27, 0x9f, 0xcd, 0x25, 0xf3, 0x16, 0x70, 0xf2,
-  0x71, 0xb3, 0xa0, 0xac, 0x1c, 0x42, 0x61, 0xe8, 0x6a, 0x27, 0x12, 0x0a,
-  0xc6, 0x67, 0x0e, 0x0c, 0xcc, 0xc7, 0xca, 0xa4, 0x69, 0x58, 0x6c, 0x76,
-  0x65, 0xf0, 0xb3, 0x9c, 0xca, 0x80, 0xb6, 0xb5, 0xb0, 0x73, 0xff, 0x2e,
-  0xde, 0xda, 0xb4, 0x9a, 0x37, 0x36, 0xbf, 0xcf, 0x7b, 0xdb, 0xd6, 0xd3,
-  0xd8, 0x9a, 0x1e, 0x55, 0x14, 0x53, 0x26, 0x14, 0x72, 0xe3, 0x97, 0x47,
-  0x73, 0xf9, 0x65, 0x35, 0x90, 0x67, 0x87, 0x26, 0x6f, 0xff, 0x2b, 0xeb,
-  0x3b, 0xf2, 0xb9, 0xb1, 0x99, 0xa1, 0x32, 0x97, 0xb6, 0xdd, 0x9d, 0x5c,
-  0xf3, 0xd5, 0xd5, 0xbc, 0xfc, 0x7a, 0xca, 0xee, 0x43, 0x2d, 0xf0, 0x06,
-  0x70, 0xbd, 0x98, 0x00, 0x11, 0x00, 0x03, 0x1d, 0x33, 0xb0, 0x06, 0xc8,
-  0x03, 0x46, 0xa5, 0xea, 0x24, 0xee, 0xb9, 0xf3, 0x38, 0xbe, 0xf5, 0x9d,
-  0xe3, 0x94, 0xa3, 0x50, 0xef, 0x4d, 0xff, 0x76, 0xa6, 0xba, 0x81, 0x96,
-  0x6b, 0x83, 0x92, 0x6c, 0x9a, 0xb6, 0x77, 0xf0, 0x83, 0x7b, 0xb6, 0xf0,
-  0x50, 0x72, 0xe7, 0x92, 0x33, 0xa6, 0x6a, 0x14, 0x8b, 0x4e, 0x38, 0x8d,
-  0x05, 0x27, 0x9c, 0xc6, 0xf1, 0xe3, 0xa6, 0x40, 0x69, 0x05, 0xe8, 0x3a,
-  0x74, 0x75, 0x10, 0xf5, 0x7b, 0xd1, 0x75, 0xbd, 0xff, 0x46, 0x06, 0x0c,
-  0x03, 0x8b, 0xc5, 0x8a, 0xc9, 0x91, 0x05, 0x59, 0xd9, 0xe0, 0x74, 0x42,
-  0x24, 0x0a, 0x1d, 0x6d, 0xec, 0x68, 0xd8, 0xcb, 0xc6, 0x1d, 0x9b, 0x59,
-  0xb5, 0x79, 0x2d, 0xab, 0xb7, 0x6f, 0xe2, 0xa3, 0xba, 0xda, 0xb4, 0x3a,
-  0xf5, 0xe3, 0xc6, 0x17, 0x70, 0xdb, 0x8d, 0x63, 0xb9, 0xe8, 0xa2, 0x6a,
-  0xc8, 0x73, 0x40, 0x8b, 0x17, 0xc3, 0x17, 0xed, 0x9f, 0x86, 0x1f, 0xe2,
-  0xb3, 0x37, 0xb2, 0x20, 0xc7, 0xce, 0x53, 0x0f, 0x6d, 0xe7, 0x86, 0x5b,
-  0xd6, 0xd1, 0xee, 0x4e, 0x59, 0x1f, 0x8b, 0x5a, 0xe0, 0x37, 0xc0, 0x03,
-  0xf2, 0xea, 0x17, 0x01, 0x20, 0x1c, 0x66, 0x35, 0x50, 0x94, 0x4a, 0x11,
-  0x70, 0xe6, 0xbc, 0x0a, 0x7e, 0x77, 0xff, 0x2c, 0x2a, 0xc7, 0x95, 0x40,
-  0x53, 0x4f, 0xfa, 0x7b, 0x43, 0x89, 0xda, 0xe5, 0x41, 0xd9, 0x90, 0x65,
-  0x65, 0xdd, 0xdf, 0x1b, 0xf9, 0xee, 0xdd, 0x9b, 0x79, 0x6d, 0xe5, 0xc1,
-  0xe4, 0x47, 0x52, 0xaa, 0x47, 0x73, 0xd6, 0xac, 0x53, 0x98, 0x3b, 0x79,
-  0x36, 0xf3, 0xc6, 0x4f, 0x25, 0xab, 0xb2, 0x5a, 0xed, 0x73, 0x07, 0x83,
-  0xe0, 0xe9, 0x26, 0x16, 0x0a, 0x12, 0xd3, 0x33, 0xaf, 0xaf, 0x89, 0xa6,
-  0x69, 0x98, 0x34, 0x0d, 0xb3, 0xc5, 0x0a, 0x76, 0x87, 0xf2, 0xec, 0x2d,
-  0x56, 0xb0, 0x99, 0xc1, 0xeb, 0xc7, 0x73, 0xb0, 0x81, 0xfd, 0x2d, 0x8d,
-  0x6c, 0xdc, 0xb5, 0x8d, 0x35, 0xdb, 0x37, 0xf2, 0xfe, 0xb6, 0x8d, 0x7c,
-  0xb8, 0x6f, 0xa7, 0xda, 0x02, 0x48, 0x33, 0x8e, 0x9f, 0x52, 0xcc, 0x57,
-  0xaf, 0x1e, 0xc9, 0xe5, 0x97, 0x8c, 0x80, 0xc2, 0x2c, 0x68, 0xf1, 0x61,
-  0xf8, 0x22, 0xfd, 0xd7, 0xf0, 0xff, 0x23, 0x5a, 0xa6, 0x72, 0x67, 0x6e,
-  0xfa, 0xd6, 0x3a, 0x1e, 0xfe, 0xcb, 0xde, 0x54, 0x9d, 0x4d, 0x1d, 0x6a,
-  0x52, 0xea, 0xd7, 0x81, 0x15, 0xf2, 0xba, 0x17, 0x01, 0x20, 0xfc, 0x33,
-  0xcf, 0x03, 0xc7, 0xa6, 0x52, 0x04, 0xe4, 0x66, 0x5b, 0x78, 0xe0, 0xa7,
-  0xd3, 0xb8, 0xfc, 0x86, 0x71, 0x10, 0x8c, 0x66, 0xc6, 0x70, 0x13, 0xdd,
-  0x40, 0x33, 0x9b, 0x60, 0xa8, 0x13, 0x74, 0x83, 0x95, 0x2f, 0xd6, 0x73,
-  0xd7, 0x2f, 0xb7, 0xf2, 0xf6, 0x9a, 0xb6, 0x94, 0x9c, 0x4e, 0x45, 0x51,
-  0x29, 0x73, 0x26, 0xcd, 0xe0, 0x84, 0x49, 0x33, 0x38, 0x7e, 0xe4, 0x78,
-  0x8e, 0x1b, 0x39, 0x1e, 0x4b, 0x71, 0x29, 0x64, 0x65, 0x41, 0x24, 0x06,
-  0x5e, 0x37, 0x84, 0x43, 0xc4, 0xc2, 0x21, 0x62, 0xb1, 0x68, 0x5a, 0x44,
-  0x09, 0x2c, 0x66, 0x0b, 0x26, 0xb3, 0x45, 0x89, 0x16, 0xab, 0x55, 0x19,
-  0xfa, 0x2c, 0xbb, 0x1a, 0xc1, 0x12, 0x0a, 0x82, 0xbb, 0x9b, 0x43, 0x1d,
-  0xad, 0xec, 0x6f, 0x6b, 0x66, 0xef, 0x81, 0x7d, 0xac, 0xab, 0xdd, 0xca,
-  0xee, 0xfa, 0x3d, 0xbc, 0xb7, 0xe3, 0x03, 0xda, 0x7b, 0x3a, 0xd3, 0xfa,
-  0xa1, 0x3a, 0x69, 0x56, 0x19, 0xdf, 0xfa, 0xea, 0x18, 0xce, 0x3c, 0x77,
-  0x38, 0xe4, 0xd8, 0xfa, 0xbf, 0xe1, 0x07, 0x95, 0xe8, 0x57, 0xe2, 0x80,
-  0x3c, 0x07, 0xaf, 0x3c, 0xbb, 0x97, 0x2f, 0xdf, 0xb8, 0x96, 0xfa, 0x83,
-  0x29, 0x1b, 0x5f, 0x9d, 0x30, 0xfe, 0xe7, 0xc6, 0x23, 0x00, 0x82, 0x08,
-  0x00, 0xe1, 0x13, 0xb8, 0x09, 0xf8, 0x32, 0x29, 0xaa, 0x10, 0x48, 0x70,
-  0xe9, 0x79, 0xc3, 0xf8, 0xe5, 0x3d, 0xd3, 0x29, 0x1f, 0x59, 0x98, 0x39,
-  0x2d, 0x4f, 0x75, 0x03, 0xcd, 0x6e, 0x86, 0x21, 0x4e, 0xf0, 0x46, 0x58,
-  0xfa, 0xfc, 0x7e, 0x7e, 0xf1, 0x9b, 0x1d, 0xac, 0x5e, 0x97, 0xda, 0xc6,
-  0x3d, 0x23, 0x2b, 0xab, 0x19, 0x37, 0x62, 0x0c, 0xb3, 0x8e, 0x3d, 0x8e,
-  0x71, 0x35, 0x63, 0x19, 0x3f, 0xbc, 0x86, 0xb2, 0xe2, 0x32, 0xcc, 0x85,
-  0xa5, 0xe0, 0xb0, 0x2b, 0x51, 0xa0, 0xc7, 0x73, 0x18, 0x0c, 0x03, 0x22,
-  0x61, 0x88, 0x46, 0x20, 0x1a, 0x85, 0x48, 0x18, 0x43, 0xd7, 0x41, 0x23,
-  0x5e, 0x7e, 0x78, 0xb4, 0xc3, 0x8b, 0xe2, 0x11, 0x12, 0xb3, 0x09, 0xac,
-  0x76, 0xe5, 0xb5, 0x5b, 0xac, 0xca, 0xb8, 0x27, 0x7e, 0x41, 0x33, 0x29,
-  0x83, 0x6f, 0x02, 0xfc, 0x7e, 0xf0, 0x79, 0x09, 0x07, 0x7c, 0x74, 0x7b,
-  0x7a, 0xd8, 0xd9, 0xb0, 0x87, 0x3d, 0x4d, 0xf5, 0xb4, 0x74, 0xb4, 0xb1,
-  0x6d, 0xff, 0x2e, 0x76, 0xee, 0xdf, 0x4d, 0x53, 0x7b, 0x2b, 0x6d, 0x5d,
-  0x99, 0x33, 0x03, 0xe1, 0xbc, 0xb3, 0x2a, 0xf9, 0xda, 0x55, 0x23, 0x39,
-  0xe5, 0xf4, 0x21, 0xca, 0xf0, 0x37, 0xfb, 0xd2, 0xbf, 0xec, 0xb5, 0x17,
-  0xbd, 0xfe, 0x68, 0x9b, 0x8f, 0x9b, 0x6f, 0x5b, 0xcf, 0xfd, 0x7f, 0xdc,
-  0x95, 0xca, 0x33, 0xaa, 0x03, 0xfc, 0xc0, 0x3c, 0x40, 0x3a, 0x68, 0x89,
-  0x00, 0x10, 0x8e, 0x82, 0x09, 0xc0, 0x33, 0xa9, 0x16, 0x01, 0x85, 0x2e,
-  0x2b, 0xf7, 0x2f, 0x99, 0xce, 0xe2, 0xeb, 0x46, 0xab, 0xa1, 0x27, 0x4d,
-  0x19, 0x32, 0xf4, 0x44, 0x37, 0xd0, 0xb2, 0x2c, 0x30, 0xc8, 0x09, 0xbe,
-  0x08, 0x2b, 0x5e, 0xd8, 0xcf, 0x92, 0x07, 0x77, 0xf0, 0x56, 0x8a, 0x22,
-  0x02, 0x1f, 0xc7, 0x61, 0xb3, 0x53, 0x59, 0x36, 0x98, 0x89, 0x23, 0xc6,
-  0x30, 0xa2, 0xb2, 0x8a, 0xd1, 0x43, 0xaa, 0x18, 0x5e, 0x36, 0x04, 0xab,
-  0xcd, 0x86, 0x09, 0x28, 0x70, 0xe5, 0x93, 0x97, 0xe3, 0x22, 0x37, 0xdb,
-  0x85, 0x33, 0x37, 0x1f, 0xac, 0xb6, 0xb8, 0x9b, 0x6e, 0x39, 0xba, 0xd0,
-  0xba, 0xa6, 0x29, 0x01, 0x81, 0x06, 0x91, 0x10, 0x9e, 0x9e, 0x2e, 0x7a,
-  0xbc, 0x6e, 0xba, 0xbd, 0x6e, 0xba, 0x3c, 0x3d, 0x98, 0x4c, 0x26, 0xdc,
-  0x3e, 0x0f, 0xcd, 0x1d, 0x6d, 0x34, 0xb5, 0x1d, 0xa4, 0xdd, 0xdd, 0x45,
-  0x43, 0x6b, 0x13, 0xad, 0x9d, 0x87, 0x38, 0xd8, 0x79, 0x88, 0xf6, 0xee,
-  0x0e, 0x7c, 0xc1, 0x40, 0x46, 0x3e, 0x38, 0x45, 0x85, 0x76, 0x2e, 0x5b,
-  0x34, 0x9c, 0x6b, 0xbe, 0x50, 0xc3, 0x84, 0x13, 0xcb, 0xd5, 0xb5, 0x68,
-  0xf2, 0xf5, 0xdf, 0xe4, 0xbe, 0x8f, 0x7b, 0xfd, 0x65, 0x59, 0xe0, 0x72,
-  0xb0, 0xec, 0xe9, 0x5d, 0x7c, 0xf3, 0xb6, 0x0d, 0xec, 0xac, 0xf3, 0xa4,
-  0xda, 0xf8, 0xb7, 0x03, 0x27, 0x02, 0x21, 0x79, 0xad, 0x8b, 0x00, 0x10,
-  0x8e, 0x9e, 0x52, 0xe0, 0xef, 0x80, 0x2b, 0x95, 0x22, 0x00, 0xe0, 0x82,
-  0xb3, 0x2b, 0x79, 0xe0, 0x67, 0xc7, 0x53, 0x31, 0xa6, 0x18, 0x5a, 0x3c,
-  0x18, 0xde, 0x0c, 0xe9, 0x88, 0x76, 0xa4, 0x10, 0xf0, 0x84, 0x79, 0x65,
-  0xf9, 0x01, 0x7e, 0xf5, 0xfb, 0x9d, 0xbc, 0xfa, 0x46, 0x7a, 0xf7, 0xf2,
-  0xb7, 0x98, 0xcd, 0xe4, 0x39, 0x73, 0xc9, 0x75, 0xe6, 0x50, 0x94, 0x5b,
-  0x80, 0xd5, 0x6a, 0xc5, 0x61, 0xb5, 0x91, 0xef, 0xca, 0x47, 0xd7, 0xff,
-  0x73, 0xb5, 0x83, 0xc9, 0x64, 0xa2, 0xc3, 0xdd, 0x4d, 0x24, 0x1a, 0x21,
-  0x14, 0x0e, 0xd3, 0xd1, 0xd3, 0x49, 0xb7, 0xcf, 0x4d, 0x8f, 0xd7, 0xd3,
-  0x6f, 0x1f, 0x96, 0xc9, 0x13, 0x0b, 0xb9, 0xe2, 0x92, 0x6a, 0x2e, 0x3b,
-  0x7f, 0x38, 0x45, 0xa3, 0xf3, 0x21, 0x1c, 0x83, 0x83, 0x01, 0x8c, 0xa8,
-  0xde, 0xff, 0x0d, 0xff, 0x3f, 0x22, 0x5f, 0x2e, 0x7c, 0x8d, 0x1e, 0xbe,
-  0x7d, 0xe7, 0x46, 0x7e, 0xfd, 0xa7, 0x5d, 0xa9, 0x3e, 0x2b, 0x69, 0xf0,
-  0x23, 0x02, 0x40, 0xf8, 0x8c, 0x58, 0x51, 0xc9, 0x81, 0xb9, 0xa4, 0x30,
-  0x2f, 0x00, 0xa0, 0x20, 0xc7, 0xca, 0x8f, 0xbf, 0x33, 0x89, 0xaf, 0xdc,
-  0x30, 0x16, 0xb2, 0x2d, 0x50, 0xe7, 0x51, 0x21, 0x69, 0x2d, 0x93, 0x84,
-  0x40, 0x36, 0x44, 0x74, 0xb6, 0xac, 0x69, 0xe5, 0xe1, 0xc7, 0xf7, 0xf0,
-  0xe7, 0xa7, 0xf6, 0xe1, 0xf1, 0xca, 0x54, 0xbf, 0x4c, 0x25, 0x27, 0xc7,
-  0xca, 0x85, 0x0b, 0x87, 0xb2, 0x78, 0xd1, 0x70, 0xe6, 0x9f, 0x3c, 0x08,
-  0x0a, 0xb2, 0xa0, 0x3b, 0x08, 0x5d, 0x21, 0x8c, 0x81, 0x50, 0x8d, 0x69,
-  0x00, 0x86, 0xa1, 0x46, 0x69, 0xdb, 0xcd, 0x3c, 0xff, 0xe8, 0x6e, 0xbe,
-  0x7e, 0xeb, 0xba, 0x3e, 0xef, 0x94, 0x79, 0x94, 0xc6, 0x7f, 0x0d, 0x70,
-  0x95, 0xac, 0x52, 0x11, 0x00, 0xc2, 0x67, 0x67, 0x29, 0x30, 0x26, 0xd5,
-  0x22, 0x00, 0x60, 0xde, 0xec, 0x32, 0xee, 0xf9, 0xde, 0x64, 0xa6, 0x9d,
-  0x5a, 0x09, 0xee, 0x60, 0x66, 0xb5, 0x49, 0x4d, 0x74, 0x14, 0xac, 0xc8,
-  0x06, 0xab, 0x89, 0xe6, 0xcd, 0x1d, 0x3c, 0xfe, 0x42, 0x3d, 0xcf, 0xfd,
-  0xad, 0x81, 0x75, 0x1b, 0xdb, 0x65, 0x95, 0x65, 0x08, 0x27, 0xce, 0x2a,
-  0xe5, 0xa2, 0x05, 0xc3, 0xb8, 0xe0, 0xf4, 0x21, 0x0c, 0x9a, 0x54, 0xa4,
-  0xd6, 0x5e, 0xb3, 0xbf, 0xff, 0xef, 0xef, 0x1f, 0xc9, 0x3f, 0xba, 0xf9,
-  0xe5, 0xd0, 0xbc, 0xb3, 0x83, 0x5b, 0xbf, 0xb3, 0x81, 0xc7, 0x9f, 0xdb,
-  0x9f, 0xea, 0xb3, 0x4a, 0x24, 0xfb, 0xdd, 0x0d, 0x3c, 0x22, 0x2b, 0x55,
-  0x04, 0x80, 0xd0, 0x7b, 0x5c, 0x04, 0xfc, 0x90, 0x14, 0xe7, 0x05, 0x24,
-  0xb8, 0xf9, 0xfa, 0x63, 0xb9, 0xf3, 0xe6, 0xf1, 0xe4, 0x56, 0xe5, 0x67,
-  0xde, 0xa0, 0x94, 0x44, 0xe0, 0xa2, 0xc8, 0x0e, 0xb9, 0x0e, 0x70, 0x07,
-  0x79, 0xeb, 0xf5, 0x66, 0x9e, 0x7c, 0xb1, 0x9e, 0xa5, 0xcb, 0x0f, 0xd0,
-  0xde, 0x2e, 0xc3, 0x7e, 0xd2, 0x8d, 0x69, 0x13, 0x0b, 0x39, 0xef, 0xac,
-  0x4a, 0x16, 0x9c, 0x36, 0x84, 0xf1, 0xd3, 0x8a, 0xc1, 0x69, 0x03, 0x77,
-  0x08, 0x3a, 0x43, 0x18, 0xfa, 0x00, 0x7a, 0x93, 0xe9, 0x06, 0x9a, 0x49,
-  0x83, 0xaa, 0x5c, 0xf0, 0x45, 0xb8, 0xef, 0xde, 0xad, 0x7c, 0xef, 0xa7,
-  0x5b, 0xe8, 0xf1, 0xa5, 0x7c, 0x7a, 0x6e, 0xc2, 0xf8, 0x9f, 0x03, 0xec,
-  0x91, 0x15, 0x2b, 0x02, 0x40, 0xe8, 0x7d, 0xaa, 0x80, 0x65, 0xa8, 0x0e,
-  0x82, 0x29, 0x17, 0x01, 0xe5, 0xc5, 0x0e, 0xee, 0xba, 0x63, 0x12, 0xd7,
-  0x5d, 0x37, 0x1a, 0xb2, 0xad, 0xd0, 0xe0, 0xc9, 0xbc, 0x16, 0xaa, 0xba,
-  0x81, 0xe6, 0xb0, 0x40, 0x45, 0x16, 0x98, 0x34, 0x3a, 0x3e, 0xea, 0xe6,
-  0x6f, 0x6f, 0x34, 0xb3, 0x74, 0x59, 0x03, 0xaf, 0xbc, 0xd1, 0x4c, 0x28,
-  0xa2, 0xcb, 0xaa, 0x4b, 0x11, 0x33, 0xa7, 0x97, 0x70, 0xe6, 0xbc, 0x0a,
-  0xce, 0x99, 0x5b, 0xc1, 0x71, 0x53, 0x8b, 0xa1, 0xc4, 0x09, 0xc1, 0x08,
-  0xb4, 0x07, 0x31, 0xc2, 0xb1, 0x81, 0xd5, 0x7e, 0xd9, 0x00, 0x4d, 0x37,
-  0xa0, 0x5c, 0x35, 0xf4, 0xd9, 0xb8, 0xb2, 0x91, 0x5b, 0xbe, 0xbb, 0x91,
-  0x95, 0xab, 0x5b, 0xd3, 0xe1, 0xec, 0xea, 0x50, 0x3d, 0xfd, 0xe7, 0x01,
-  0x1e, 0x59, 0xb9, 0x22, 0x00, 0x84, 0xbe, 0xc3, 0x86, 0x1a, 0x24, 0x94,
-  0x4f, 0x1a, 0x6c, 0x09, 0x00, 0xcc, 0x9e, 0x52, 0xcc, 0x0f, 0xee, 0x3c,
-  0x8e, 0x93, 0x17, 0x0e, 0x83, 0xb0, 0x0e, 0x8d, 0x19, 0x38, 0x44, 0x25,
-  0x11, 0x15, 0xc8, 0xb7, 0x41, 0x81, 0x03, 0xa2, 0x31, 0x5a, 0xb6, 0x76,
-  0xb1, 0xfc, 0xf5, 0x26, 0x56, 0xac, 0x6e, 0x65, 0xd5, 0x9a, 0x56, 0xda,
-  0x0e, 0x49, 0x64, 0xa0, 0x2f, 0x29, 0x28, 0xb0, 0x33, 0x63, 0x72, 0x11,
-  0xa7, 0xce, 0x2a, 0xe3, 0xac, 0x53, 0x07, 0x33, 0x6a, 0x62, 0x11, 0xe4,
-  0xda, 0x20, 0x1c, 0x85, 0x8e, 0x10, 0x04, 0x62, 0x18, 0x03, 0xf1, 0x8d,
-  0x15, 0x33, 0xd0, 0x72, 0xac, 0x50, 0x9e, 0x43, 0xe7, 0xce, 0x0e, 0xbe,
-  0xff, 0xcb, 0xad, 0x3c, 0xf0, 0xfb, 0xb4, 0x29, 0xa7, 0xaf, 0x05, 0x3a,
-  0x80, 0xd9, 0xb2, 0x82, 0x45, 0x00, 0x08, 0xc9, 0xe3, 0xb7, 0x71, 0xc5,
-  0x9d, 0x16, 0x5b, 0x02, 0x00, 0x5f, 0xbc, 0xa8, 0x8a, 0xdb, 0xbf, 0x39,
-  0x81, 0x91, 0xd3, 0xcb, 0xa0, 0x27, 0xa8, 0x3c, 0xb5, 0x4c, 0x1c, 0xa3,
-  0x6a, 0xc4, 0x1b, 0x0b, 0x15, 0xd8, 0x20, 0xd7, 0x0e, 0xe1, 0x18, 0x5d,
-  0xfb, 0xdc, 0xbc, 0xb3, 0xb6, 0x8d, 0x15, 0x6f, 0x36, 0xb3, 0xf2, 0xfd,
-  0x36, 0x6a, 0x53, 0x33, 0x3d, 0xad, 0xdf, 0x31, 0x7e, 0x5c, 0x01, 0x27,
-  0x4d, 0x29, 0xe6, 0xb4, 0x93, 0x2a, 0x98, 0x3e, 0xb5, 0x98, 0xd2, 0xea,
-  0x5c, 0xc8, 0xb6, 0x81, 0x3f, 0xac, 0xc2, 0xfb, 0x61, 0x7d, 0xe0, 0xbe,
-  0xa5, 0xfe, 0x51, 0xd3, 0x9f, 0x03, 0xc1, 0x18, 0x7f, 0x78, 0x68, 0x27,
-  0xb7, 0x7f, 0x6f, 0x23, 0x87, 0xba, 0xc3, 0xe9, 0xe2, 0xf5, 0x87, 0x51,
-  0x11, 0xc9, 0x9b, 0x65, 0x25, 0x8b, 0x00, 0x10, 0x92, 0xcf, 0x44, 0xe0,
-  0x49, 0x20, 0x2b, 0x5d, 0x44, 0x80, 0x06, 0xdc, 0xf1, 0xf5, 0x71, 0xdc,
-  0x72, 0xe3, 0x58, 0x72, 0x87, 0xe7, 0x41, 0xbb, 0x1f, 0xa3, 0x27, 0x9c,
-  0xd1, 0xc9, 0x59, 0x9a, 0x49, 0x03, 0x97, 0x15, 0x0a, 0xec, 0x2a, 0x4c,
-  0xd0, 0xec, 0x63, 0xe3, 0x87, 0x9d, 0xac, 0x5d, 0x77, 0x88, 0xe5, 0xab,
-  0x0e, 0xb2, 0x79, 0x5b, 0x17, 0x07, 0x5b, 0x03, 0xb2, 0x1a, 0x8f, 0x82,
-  0x91, 0xd5, 0x2e, 0x26, 0x4f, 0x2a, 0x62, 0xde, 0xd4, 0x62, 0x4e, 0x99,
-  0x53, 0xc1, 0x88, 0x51, 0x79, 0x50, 0x9c, 0x05, 0x86, 0x0e, 0xdd, 0x61,
-  0xf0, 0x44, 0x20, 0xa6, 0x46, 0x2a, 0x0d, 0x58, 0x8c, 0xf8, 0x8b, 0x79,
-  0x70, 0x36, 0xd8, 0x2d, 0xbc, 0xf9, 0x42, 0x1d, 0x77, 0xfe, 0x64, 0x33,
-  0xab, 0xd7, 0xa7, 0x4d, 0xa2, 0x6a, 0xc2, 0xf8, 0x5f, 0x06, 0x6c, 0x92,
-  0x55, 0x2d, 0x02, 0x40, 0x48, 0x1d, 0x0e, 0xd4, 0x58, 0xe1, 0x94, 0x0e,
-  0x13, 0xfa, 0x38, 0xe5, 0x25, 0x0e, 0x6e, 0xbd, 0x69, 0x1c, 0x37, 0x5d,
-  0x3b, 0x1a, 0x4a, 0xb2, 0xe1, 0xa0, 0x17, 0xc3, 0x9f, 0xe1, 0x59, 0xda,
-  0xf1, 0xd2, 0x32, 0x2d, 0xcb, 0xa2, 0xa2, 0x03, 0x76, 0x2b, 0xf8, 0xc3,
-  0xb8, 0x1b, 0xbc, 0x7c, 0xb0, 0xa5, 0x83, 0xb7, 0x37, 0x75, 0xf0, 0xe1,
-  0xd6, 0x2e, 0xde, 0x59, 0x7f, 0x88, 0x36, 0x49, 0x24, 0x04, 0xa0, 0xa6,
-  0xda, 0xc5, 0x8c, 0x89, 0x45, 0xcc, 0x98, 0x56, 0xcc, 0xb4, 0xb1, 0x05,
-  0x4c, 0x9b, 0x54, 0x84, 0x36, 0x28, 0x1b, 0x2c, 0x66, 0xf0, 0x45, 0xa0,
-  0x27, 0x8c, 0x11, 0x8a, 0x31, 0x80, 0x87, 0x28, 0xfe, 0x7f, 0xc3, 0x6f,
-  0x18, 0x50, 0xac, 0x5a, 0xf8, 0xee, 0x5d, 0xdf, 0xca, 0x5d, 0x4b, 0x3e,
-  0xe4, 0xb1, 0x67, 0xeb, 0xd2, 0xe9, 0x2c, 0xeb, 0x50, 0x21, 0xff, 0xd3,
-  0x80, 0x2e, 0x59, 0xe1, 0x22, 0x00, 0x84, 0xf4, 0xe0, 0x6e, 0xe0, 0x7c,
-  0xd2, 0x68, 0x4b, 0x00, 0x60, 0xcc, 0x08, 0x17, 0xb7, 0x7d, 0x63, 0x3c,
-  0x5f, 0xb8, 0x62, 0xa4, 0x4a, 0x14, 0xec, 0x67, 0xed, 0x58, 0x35, 0xb3,
-  0x06, 0x4e, 0x2b, 0xe4, 0x59, 0x95, 0x51, 0x0b, 0xc7, 0x08, 0xee, 0xf7,
-  0xb0, 0x6b, 0xbf, 0x87, 0x4d, 0x5b, 0xbb, 0xf8, 0x60, 0x47, 0x17, 0xeb,
-  0xb7, 0x74, 0x52, 0xdf, 0xe8, 0xa3, 0xb9, 0x9f, 0x47, 0x09, 0x46, 0x0c,
-  0xcb, 0xa1, 0xa6, 0xca, 0xc5, 0xcc, 0x49, 0x45, 0x8c, 0xac, 0xc9, 0x65,
-  0xea, 0xb8, 0x02, 0x8e, 0xa9, 0xc9, 0x55, 0x65, 0x97, 0x26, 0x93, 0x6a,
-  0xce, 0xd3, 0x15, 0xdf, 0xcb, 0x37, 0x0c, 0x79, 0x62, 0x8f, 0x24, 0x66,
-  0xa0, 0xe5, 0xdb, 0xa0, 0x38, 0x1b, 0x77, 0x5d, 0x0f, 0x4b, 0x1e, 0xd8,
-  0xce, 0x3d, 0xbf, 0xda, 0x46, 0x34, 0xbd, 0x2e, 0x53, 0x2d, 0xd0, 0x02,
-  0x9c, 0x24, 0x37, 0x4c, 0x04, 0x80, 0x90, 0x7e, 0x0c, 0x43, 0xf5, 0x0c,
-  0xc8, 0x4f, 0x27, 0x11, 0x00, 0x70, 0xc2, 0xf1, 0x25, 0x7c, 0xeb, 0xfa,
-  0x63, 0x59, 0x70, 0x41, 0x95, 0x12, 0x02, 0x8d, 0x5e, 0xe5, 0xf9, 0xf5,
-  0xa7, 0xba, 0x6d, 0x03, 0x34, 0x8b, 0xa6, 0x1a, 0x25, 0x39, 0xad, 0x90,
-  0x65, 0x81, 0x98, 0x0e, 0x9e, 0x08, 0x9e, 0x26, 0x1f, 0xb5, 0xf5, 0x5e,
-  0x3e, 0xda, 0xd9, 0xcd, 0xce, 0x06, 0x1f, 0x75, 0x75, 0x1e, 0xf6, 0xd4,
-  0x7b, 0xd8, 0xd7, 0xe8, 0xa7, 0xb3, 0x33, 0x48, 0xa6, 0xd8, 0x43, 0x4d,
-  0x83, 0x8a, 0xb2, 0x2c, 0x8e, 0x19, 0xee, 0x62, 0xc4, 0x50, 0x27, 0x63,
-  0x46, 0xe6, 0x33, 0x71, 0x54, 0x1e, 0x83, 0x06, 0x3b, 0x19, 0x55, 0xe9,
-  0xc4, 0x52, 0x9e, 0x05, 0x39, 0x56, 0xf5, 0x6a, 0xf1, 0x86, 0xc1, 0x17,
-  0x55, 0x06, 0x5f, 0x37, 0xe4, 0x6d, 0xf3, 0xaf, 0xd0, 0x0d, 0x34, 0xa7,
-  0x05, 0xca, 0x5d, 0xd0, 0xe1, 0xe3, 0x57, 0xbf, 0xdb, 0xc9, 0x3d, 0xbf,
-  0xda, 0x46, 0x4b, 0x7a, 0x25, 0x9c, 0x26, 0x42, 0xfe, 0x77, 0x01, 0x7f,
-  0x91, 0x9b, 0x26, 0x02, 0x40, 0x48, 0x5f, 0x4c, 0xa8, 0x71, 0x9b, 0xc3,
-  0xd2, 0x2d, 0x1a, 0x00, 0x30, 0x73, 0x5a, 0x09, 0xdf, 0xf9, 0x1c, 0xbb,
-  0xf8, 0x57, 0x00, 0x00, 0x0c, 0xeb, 0x49, 0x44, 0x41, 0x54, 0xe6, 0x78,
-  0xce, 0x5a, 0x38, 0x0c, 0x1c, 0x66, 0x55, 0x31, 0x10, 0xea, 0xbf, 0x7d,
-  0xda, 0x35, 0x93, 0xa6, 0xfa, 0x23, 0x64, 0x59, 0x20, 0xc7, 0x02, 0x56,
-  0x93, 0xf2, 0x86, 0xa3, 0x31, 0xe8, 0x08, 0xe1, 0x77, 0x47, 0x68, 0x39,
-  0xe8, 0x67, 0xd7, 0x7e, 0x0f, 0x0d, 0xcd, 0x7e, 0xf6, 0x1f, 0xf0, 0xd2,
-  0xd0, 0xec, 0xe7, 0x40, 0x6b, 0x00, 0x77, 0x4f, 0x98, 0xd6, 0x43, 0x41,
-  0xda, 0xbb, 0x42, 0x44, 0x92, 0xe4, 0x0a, 0x9a, 0xcd, 0x1a, 0x05, 0x79,
-  0x36, 0x06, 0x95, 0x66, 0x91, 0x5f, 0x60, 0xa3, 0xa6, 0xd2, 0xc9, 0x88,
-  0x61, 0x2e, 0x4a, 0x8a, 0x1d, 0x0c, 0x2d, 0x57, 0x86, 0x7f, 0xc8, 0xe0,
-  0x6c, 0x6c, 0x85, 0x76, 0x55, 0x31, 0xa1, 0xc5, 0xbf, 0x4b, 0x58, 0x8f,
-  0x1b, 0xfb, 0x28, 0xe8, 0x06, 0xe2, 0xe0, 0x1f, 0x85, 0xe1, 0x4f, 0xb4,
-  0xa9, 0xee, 0x09, 0xf1, 0xe7, 0x27, 0xf6, 0xf0, 0xcb, 0xfb, 0xb6, 0xb3,
-  0x75, 0x57, 0x4f, 0xba, 0x9d, 0x69, 0x1d, 0xaa, 0xa5, 0xef, 0xe9, 0xc8,
-  0x30, 0x1f, 0x11, 0x00, 0x42, 0xc6, 0x30, 0x13, 0xf8, 0x03, 0x69, 0x94,
-  0x20, 0x78, 0x24, 0x67, 0xcc, 0xab, 0xe0, 0x96, 0xaf, 0x8c, 0xe1, 0xe4,
-  0xf3, 0x86, 0x83, 0xd5, 0x0c, 0x07, 0x7d, 0x99, 0x9f, 0x23, 0xf0, 0x69,
-  0x22, 0x05, 0x66, 0x0d, 0x6c, 0x26, 0x25, 0x08, 0xec, 0x66, 0x15, 0x35,
-  0x30, 0x9b, 0xd5, 0x54, 0xc0, 0x50, 0x0c, 0x22, 0x06, 0xf8, 0x22, 0xf4,
-  0xb4, 0x07, 0xe9, 0xe8, 0x0a, 0xd1, 0xd6, 0x15, 0xa6, 0xab, 0x2b, 0x44,
-  0x8f, 0x27, 0x42, 0xe3, 0x41, 0x3f, 0x9d, 0x3d, 0x61, 0xba, 0x7d, 0x51,
-  0xbc, 0xee, 0x08, 0x5d, 0xee, 0x30, 0xe6, 0xff, 0x70, 0xdd, 0x62, 0xba,
-  0x81, 0xc3, 0x6e, 0xa6, 0x30, 0xdf, 0x86, 0xd5, 0x62, 0xa2, 0x20, 0xd7,
-  0x8a, 0xd5, 0x6a, 0xa2, 0xbc, 0xc4, 0xc1, 0x90, 0xf2, 0x6c, 0x4a, 0x8a,
-  0x1d, 0xb8, 0x9c, 0x16, 0x2c, 0x26, 0x25, 0x00, 0x8a, 0x4a, 0x1d, 0xaa,
-  0x04, 0xcf, 0x6a, 0x52, 0x42, 0x0d, 0x13, 0xc4, 0x62, 0xe0, 0x8f, 0x42,
-  0x30, 0xa6, 0xc2, 0xf9, 0x11, 0x7d, 0x60, 0x35, 0xe1, 0xe9, 0x55, 0xc3,
-  0x9f, 0x03, 0x81, 0x08, 0x7f, 0x7d, 0x7c, 0x37, 0x4b, 0x7e, 0xf3, 0x11,
-  0x1b, 0xb6, 0x74, 0xa4, 0xa3, 0xe1, 0x0f, 0x03, 0xf5, 0xc0, 0x59, 0xa8,
-  0xc1, 0xd0, 0x82, 0x08, 0x00, 0x21, 0x83, 0xb0, 0x02, 0xaf, 0x03, 0x65,
-  0xe9, 0x18, 0x0d, 0x00, 0x98, 0x77, 0x62, 0x39, 0x37, 0x5c, 0x33, 0x8a,
-  0xf3, 0x17, 0x0c, 0x55, 0xbd, 0xdc, 0xdb, 0x7c, 0xaa, 0xab, 0xa0, 0x69,
-  0x60, 0x2e, 0x4d, 0xcd, 0x14, 0x2f, 0x9b, 0xd4, 0x00, 0x4b, 0x5c, 0x1c,
-  0xd8, 0x4c, 0x60, 0x8b, 0x8f, 0xed, 0xd5, 0x34, 0x75, 0x6d, 0xb4, 0xf8,
-  0xe3, 0x1b, 0xd3, 0x95, 0x41, 0xd6, 0xfe, 0xc3, 0xd3, 0xac, 0x03, 0x16,
-  0x0d, 0xec, 0x96, 0xc3, 0x2a, 0x24, 0x6e, 0x90, 0xfe, 0xf1, 0x27, 0x1a,
-  0xff, 0x8c, 0xc4, 0xff, 0x9f, 0x51, 0x5d, 0xfd, 0x9a, 0x78, 0xf4, 0xbd,
-  0xeb, 0xf1, 0x7b, 0xc3, 0x3c, 0xfd, 0xcc, 0x3e, 0xee, 0xfb, 0xdf, 0x9d,
-  0xac, 0x5d, 0x9f, 0x96, 0x4e, 0x75, 0xc2, 0xf8, 0x5f, 0x0b, 0xbc, 0x23,
-  0x37, 0x4f, 0x04, 0x80, 0x90, 0xd9, 0x4c, 0x02, 0x9e, 0x48, 0xd7, 0x68,
-  0x00, 0xc0, 0xf4, 0xc9, 0x45, 0xdc, 0xfc, 0xa5, 0x31, 0x5c, 0x7c, 0xde,
-  0x30, 0x28, 0x75, 0xaa, 0x3e, 0x02, 0x1d, 0xa1, 0xcc, 0x6b, 0x28, 0x94,
-  0x8a, 0x48, 0x82, 0x49, 0x3b, 0x6c, 0xd0, 0xff, 0xdd, 0xa3, 0x6e, 0x18,
-  0x18, 0x31, 0xb1, 0xe4, 0x49, 0x37, 0xfc, 0x39, 0x56, 0x28, 0x73, 0x82,
-  0x37, 0xc4, 0x6b, 0xcb, 0x0e, 0xf0, 0x93, 0xfb, 0xb7, 0xf3, 0xf6, 0x9a,
-  0xd6, 0x74, 0x3d, 0xe3, 0x5a, 0xc0, 0x0d, 0xcc, 0x8f, 0x7f, 0x0a, 0x22,
-  0x00, 0x84, 0x7e, 0x12, 0x0d, 0x78, 0x11, 0xa8, 0x4e, 0xd7, 0x68, 0x00,
-  0xc0, 0xe8, 0x9a, 0x5c, 0xae, 0x5e, 0x5c, 0xc3, 0x17, 0x2f, 0xa9, 0xa2,
-  0x64, 0x4c, 0x91, 0x6a, 0xfd, 0xda, 0x3a, 0x40, 0xc6, 0xba, 0x0a, 0xfd,
-  0x46, 0x98, 0x61, 0x18, 0x68, 0xf9, 0x76, 0x28, 0xca, 0x82, 0x76, 0x3f,
-  0x7f, 0x7a, 0x6a, 0x2f, 0x0f, 0x3d, 0xb2, 0x9b, 0xf7, 0x36, 0xa4, 0xed,
-  0xd0, 0xa9, 0x84, 0xd7, 0xff, 0x17, 0x54, 0xb2, 0x9f, 0x20, 0x02, 0x40,
-  0xe8, 0x87, 0x8c, 0x06, 0x1e, 0x07, 0x0a, 0xd3, 0x55, 0x04, 0x00, 0x14,
-  0x16, 0xd8, 0xb8, 0xfa, 0xf3, 0xc7, 0x70, 0xcd, 0xe2, 0x11, 0x8c, 0x9c,
-  0x5a, 0x02, 0x66, 0x13, 0x1c, 0xf4, 0x81, 0x3f, 0x8a, 0x21, 0x42, 0x40,
-  0x48, 0x53, 0xc3, 0xaf, 0x81, 0x1a, 0x32, 0x95, 0xe7, 0x20, 0xd2, 0xe0,
-  0xe6, 0x89, 0x17, 0xeb, 0xb9, 0xef, 0xa1, 0x9d, 0x6c, 0xde, 0x96, 0xd6,
-  0x25, 0xf3, 0x89, 0x5e, 0xfe, 0xe7, 0x01, 0x8d, 0x72, 0x23, 0x45, 0x00,
-  0x08, 0xfd, 0x9f, 0xfb, 0x51, 0xcd, 0x3c, 0xd2, 0x36, 0x1a, 0x90, 0xe0,
-  0x9c, 0xd3, 0x87, 0x70, 0xed, 0xe7, 0x6b, 0x58, 0x78, 0xe6, 0x10, 0x28,
-  0xca, 0x56, 0x53, 0xe0, 0x3a, 0x82, 0xaa, 0x96, 0x5c, 0x93, 0x25, 0x2c,
-  0xa4, 0x98, 0xc4, 0x98, 0xe9, 0xf2, 0x6c, 0xb0, 0x59, 0xe8, 0xd8, 0xd9,
-  0xc9, 0xc3, 0x4f, 0xec, 0xe1, 0xb7, 0x7f, 0xda, 0xcd, 0xfe, 0x26, 0x5f,
-  0xba, 0x1b, 0xfe, 0x30, 0xf0, 0x16, 0xf0, 0x65, 0xb9, 0x91, 0x22, 0x00,
-  0x84, 0x81, 0x45, 0x29, 0xf0, 0x37, 0x20, 0x97, 0x34, 0xea, 0x22, 0xf8,
-  0x49, 0x4c, 0x1a, 0x5f, 0xc0, 0xb5, 0x8b, 0x6b, 0xb8, 0xf0, 0xec, 0x4a,
-  0x4a, 0xc7, 0x15, 0xaa, 0x84, 0xb5, 0x96, 0x00, 0x04, 0x07, 0xe8, 0x90,
-  0x18, 0x21, 0xb5, 0x2f, 0x4f, 0xc3, 0x50, 0xfd, 0x1e, 0xca, 0xb2, 0x21,
-  0xaa, 0xb3, 0xe5, 0xdd, 0x16, 0x1e, 0x7a, 0x72, 0x2f, 0x4f, 0x3f, 0x5b,
-  0x47, 0x47, 0x57, 0x28, 0xdd, 0x4f, 0x3f, 0xe1, 0xf5, 0x5f, 0x0c, 0xec,
-  0x93, 0xbb, 0x29, 0x02, 0x40, 0x18, 0xb8, 0xcc, 0x07, 0xee, 0x05, 0x9c,
-  0xe9, 0x1e, 0x0d, 0x00, 0x70, 0x66, 0x99, 0xb9, 0x6c, 0xd1, 0x70, 0xbe,
-  0x70, 0x51, 0x35, 0x27, 0x9e, 0x50, 0xa6, 0xa2, 0x02, 0x9e, 0x90, 0x4a,
-  0x1a, 0xd4, 0x75, 0x89, 0x0a, 0x08, 0x7d, 0x87, 0x61, 0xa0, 0x99, 0x4c,
-  0x50, 0x6c, 0x87, 0x1c, 0x07, 0xb4, 0x78, 0x78, 0xfe, 0x95, 0x46, 0x7e,
-  0xff, 0xc4, 0x5e, 0x5e, 0x79, 0xbd, 0x29, 0x13, 0xbe, 0x41, 0xc2, 0xeb,
-  0x7f, 0x19, 0xb8, 0x45, 0x6e, 0xa8, 0x08, 0x00, 0x41, 0x00, 0xb0, 0xa0,
-  0xba, 0x08, 0x1e, 0x43, 0x06, 0x6c, 0x0b, 0x24, 0x98, 0x3c, 0xbe, 0x80,
-  0xc5, 0x17, 0x54, 0x71, 0xc9, 0xb9, 0xc3, 0x18, 0x3c, 0xa1, 0x50, 0x35,
-  0xd9, 0x39, 0x14, 0x00, 0x4f, 0x44, 0xa2, 0x02, 0x42, 0x2f, 0x7a, 0xfb,
-  0x40, 0xb6, 0x59, 0x85, 0xf9, 0x0d, 0x83, 0x86, 0x4d, 0x1d, 0x3c, 0xbe,
-  0x74, 0x3f, 0x8f, 0x3e, 0xbd, 0x8f, 0xda, 0x3d, 0x19, 0x93, 0x2c, 0x5f,
-  0x0b, 0xf4, 0x00, 0x0b, 0x81, 0x56, 0xb9, 0xab, 0x82, 0xbc, 0x22, 0x85,
-  0x8f, 0x53, 0x8e, 0xaa, 0x16, 0xc8, 0xcb, 0x24, 0x21, 0x60, 0xb5, 0x68,
-  0x9c, 0x73, 0xfa, 0x10, 0x2e, 0x39, 0x6f, 0x38, 0x0b, 0x4f, 0x1d, 0x44,
-  0xd6, 0xb0, 0x3c, 0x88, 0x46, 0xe1, 0x50, 0x10, 0x23, 0x10, 0x93, 0x95,
-  0x2e, 0x7c, 0x7a, 0x12, 0x7b, 0xfb, 0x25, 0x0e, 0xc8, 0xb2, 0xc1, 0x21,
-  0x3f, 0xcb, 0x5e, 0x6b, 0xe4, 0x8f, 0x4f, 0xed, 0xe3, 0xc5, 0xe5, 0x07,
-  0x88, 0xe9, 0x19, 0x53, 0x52, 0x59, 0x07, 0x04, 0x80, 0x1f, 0x21, 0xad,
-  0x7c, 0x05, 0x11, 0x00, 0xc2, 0x51, 0x70, 0x22, 0x2a, 0x51, 0x30, 0x2f,
-  0x53, 0x44, 0x40, 0x82, 0xa1, 0x95, 0x4e, 0x2e, 0xbd, 0xa0, 0x8a, 0x05,
-  0xf3, 0x07, 0x31, 0x7b, 0x5a, 0x89, 0xea, 0x2b, 0x10, 0x8a, 0x40, 0x7b,
-  0x10, 0x42, 0xba, 0x44, 0x06, 0x84, 0x4f, 0xc6, 0x50, 0xdd, 0x8d, 0xc9,
-  0xb3, 0x41, 0x81, 0x03, 0x22, 0x31, 0x6a, 0xd7, 0x1f, 0xe2, 0xe9, 0x17,
-  0xeb, 0x79, 0xfa, 0xc5, 0x7a, 0x76, 0xd4, 0xf6, 0x64, 0xd2, 0xb7, 0x49,
-  0x84, 0xfb, 0xdb, 0x50, 0xdb, 0x7c, 0x61, 0xb9, 0xc1, 0x82, 0x08, 0x00,
-  0xe1, 0x68, 0x31, 0x01, 0x77, 0x02, 0x9f, 0xcb, 0xa4, 0x68, 0xc0, 0x91,
-  0x8c, 0x3f, 0x36, 0x9f, 0xf3, 0xcf, 0xa8, 0xe4, 0xc2, 0x33, 0x86, 0x30,
-  0x7e, 0x5a, 0x09, 0xe4, 0x3b, 0x20, 0x10, 0x51, 0x55, 0x04, 0x61, 0x5d,
-  0x9e, 0x00, 0x41, 0x19, 0x7d, 0x0d, 0x35, 0xc4, 0xa8, 0xc4, 0x01, 0x31,
-  0x83, 0x8e, 0xdd, 0x3d, 0x2c, 0x7b, 0xb3, 0x99, 0xa7, 0x96, 0xd6, 0xb3,
-  0x22, 0x33, 0xf6, 0xf6, 0x3f, 0x4e, 0x2d, 0xe0, 0x89, 0x3f, 0xbb, 0x7b,
-  0xe5, 0x26, 0x0b, 0x22, 0x00, 0x84, 0xff, 0x96, 0x2c, 0xe0, 0x15, 0xd2,
-  0xb8, 0xa5, 0xf0, 0xd1, 0x30, 0x7b, 0x6a, 0x31, 0xe7, 0x9c, 0x36, 0x84,
-  0x05, 0xa7, 0x0d, 0x66, 0xec, 0x94, 0x62, 0xc8, 0xb1, 0x41, 0x38, 0x0a,
-  0x9d, 0x89, 0x11, 0xb5, 0xf2, 0x44, 0x0c, 0xa8, 0x97, 0x9f, 0x86, 0xca,
-  0xe2, 0x2f, 0x76, 0x80, 0xa6, 0x11, 0xad, 0xf7, 0xf0, 0xda, 0xbb, 0x2d,
-  0x3c, 0xf3, 0xb7, 0x06, 0x96, 0xbd, 0xde, 0x4c, 0x7b, 0x7b, 0x30, 0x13,
-  0xbf, 0x56, 0xc2, 0xeb, 0xff, 0x01, 0xf0, 0xa4, 0xdc, 0x65, 0x41, 0x04,
-  0x80, 0xd0, 0x5b, 0x14, 0x01, 0x2f, 0xc5, 0x3f, 0x33, 0x56, 0x08, 0x00,
-  0xcc, 0x3a, 0xbe, 0x94, 0xf9, 0xb3, 0x4b, 0x39, 0x6f, 0xfe, 0x60, 0x8e,
-  0x9b, 0x54, 0x04, 0x15, 0x4e, 0xd0, 0x75, 0xe8, 0x08, 0x81, 0x2f, 0x2a,
-  0xe3, 0x6b, 0xfb, 0xa1, 0x97, 0x8f, 0x06, 0x9a, 0xc3, 0xac, 0x86, 0x1c,
-  0x39, 0xad, 0x10, 0xd3, 0x09, 0x1d, 0xf0, 0xf1, 0xe6, 0xbb, 0x2d, 0xbc,
-  0xb0, 0xe2, 0x00, 0xcb, 0xdf, 0x3a, 0x48, 0x63, 0xb3, 0x3f, 0x53, 0xbf,
-  0x61, 0xc2, 0xf0, 0x6f, 0x04, 0xae, 0x02, 0x42, 0x72, 0xd3, 0x05, 0x11,
-  0x00, 0x42, 0x5f, 0x30, 0x0a, 0x78, 0x94, 0x0c, 0x4b, 0x14, 0xfc, 0x24,
-  0xc6, 0x8d, 0xca, 0xe3, 0xcc, 0xf9, 0x83, 0x39, 0x6d, 0xde, 0x20, 0xe6,
-  0x4c, 0x2a, 0xc4, 0x56, 0xed, 0x52, 0x1b, 0xc1, 0xbe, 0x08, 0x74, 0x85,
-  0xd4, 0xd4, 0x3b, 0xb9, 0xe7, 0x99, 0xe9, 0xe1, 0x5b, 0xcd, 0x50, 0x60,
-  0x53, 0xd3, 0x16, 0xd1, 0xa0, 0xcd, 0xcf, 0xee, 0xda, 0x1e, 0xde, 0x7c,
-  0xa7, 0x85, 0x55, 0x9b, 0x3b, 0x58, 0xf3, 0xfe, 0x21, 0xf6, 0x37, 0x78,
-  0x33, 0xf9, 0x6b, 0x26, 0x0c, 0x7f, 0x37, 0xb0, 0x08, 0x68, 0x96, 0x3b,
-  0x2f, 0x88, 0x00, 0x10, 0x92, 0xc1, 0x44, 0xe0, 0xf7, 0xa8, 0x46, 0x42,
-  0x19, 0x2f, 0x04, 0x00, 0xca, 0xcb, 0xb2, 0x38, 0x79, 0x66, 0x29, 0xf3,
-  0x4f, 0xaa, 0x60, 0xf6, 0x94, 0x62, 0x46, 0x8e, 0x2b, 0x50, 0x79, 0x03,
-  0x86, 0xa1, 0xc4, 0x80, 0x2f, 0x8a, 0x11, 0x91, 0xdc, 0x81, 0x74, 0xf4,
-  0xf0, 0x35, 0xb3, 0x06, 0x59, 0x66, 0xb5, 0x97, 0x9f, 0x6d, 0x03, 0x43,
-  0x87, 0xf6, 0x20, 0x1f, 0xed, 0xe8, 0x62, 0xd3, 0xd6, 0x4e, 0xde, 0x59,
-  0xdb, 0xc6, 0xea, 0xcd, 0x1d, 0x6c, 0xdb, 0xd1, 0xdd, 0x1f, 0xbe, 0x71,
-  0xc2, 0xf0, 0xbb, 0x81, 0xcb, 0x81, 0x9d, 0xb2, 0x08, 0x04, 0x11, 0x00,
-  0x42, 0x2a, 0x38, 0x1e, 0xf8, 0x35, 0xe0, 0xea, 0x2f, 0x42, 0x00, 0x94,
-  0x41, 0x99, 0x75, 0x5c, 0x11, 0x73, 0x67, 0x95, 0x31, 0x6b, 0x6a, 0x31,
-  0x27, 0x1e, 0x57, 0x4c, 0x6e, 0xb5, 0x0b, 0xb2, 0xad, 0x10, 0x8d, 0x81,
-  0x3b, 0x02, 0xde, 0x88, 0x8c, 0xcb, 0x4d, 0xc5, 0xbd, 0x31, 0x69, 0x6a,
-  0xbc, 0x71, 0x8e, 0x15, 0x9c, 0x16, 0xb0, 0x98, 0x21, 0x16, 0x23, 0xd6,
-  0xe4, 0xe7, 0xa3, 0xda, 0x1e, 0xd6, 0x6e, 0xee, 0x60, 0xc7, 0x6e, 0x37,
-  0xef, 0xbe, 0xd7, 0xc6, 0x86, 0xad, 0x9d, 0xfd, 0xed, 0xeb, 0xd7, 0x01,
-  0x5d, 0xc0, 0x0d, 0xc0, 0x1a, 0x59, 0x0d, 0x82, 0x08, 0x00, 0x21, 0x1d,
-  0x98, 0x0e, 0xfc, 0xa6, 0xbf, 0x09, 0x81, 0x04, 0xb9, 0x39, 0x56, 0x66,
-  0x4c, 0x2d, 0x62, 0xd6, 0xb4, 0x52, 0x4e, 0x9a, 0x52, 0xcc, 0x84, 0x71,
-  0x05, 0x14, 0x54, 0xb9, 0x54, 0x78, 0x39, 0x66, 0x40, 0x4f, 0x58, 0x0d,
-  0x2b, 0x92, 0xea, 0x82, 0xde, 0xf7, 0xec, 0xed, 0x26, 0xc8, 0xb2, 0x28,
-  0x83, 0x6f, 0x36, 0x41, 0x38, 0x06, 0xee, 0x30, 0x4d, 0xfb, 0xbd, 0xec,
-  0xdd, 0xe7, 0x66, 0xd5, 0xa6, 0x0e, 0x76, 0x7c, 0xd4, 0xc5, 0x9a, 0xcd,
-  0x1d, 0xd4, 0x37, 0xf8, 0xfa, 0xeb, 0xd5, 0xa8, 0x43, 0x35, 0xf2, 0x59,
-  0x82, 0xd4, 0xf3, 0x0b, 0x22, 0x00, 0x84, 0x34, 0x8e, 0x08, 0x3c, 0x40,
-  0x3f, 0xda, 0x1a, 0xf8, 0x57, 0x94, 0x16, 0x3b, 0x98, 0x38, 0xbe, 0x80,
-  0x93, 0xa6, 0x16, 0x33, 0xf3, 0xf8, 0x52, 0xa6, 0x8e, 0xca, 0xc7, 0x35,
-  0xd4, 0x09, 0xb9, 0x76, 0x95, 0x50, 0x18, 0x8c, 0x29, 0x51, 0x10, 0xd6,
-  0xc1, 0x90, 0x28, 0xc1, 0xbf, 0x7d, 0x11, 0x69, 0xf1, 0x7f, 0x1c, 0x19,
-  0xc6, 0xb7, 0x98, 0x94, 0xb1, 0x8f, 0xe9, 0xd0, 0x16, 0xa0, 0xa5, 0xd1,
-  0xc7, 0xd6, 0xbd, 0x6e, 0x76, 0xed, 0x72, 0xf3, 0xfe, 0xb6, 0x4e, 0x6a,
-  0x77, 0xf5, 0xb0, 0x63, 0x8f, 0x1b, 0xaf, 0x2f, 0xda, 0xdf, 0x2f, 0x4f,
-  0x1d, 0xaa, 0xa4, 0xef, 0x7e, 0xe0, 0x8f, 0x4a, 0x16, 0x09, 0x82, 0x08,
-  0x00, 0x21, 0xbd, 0xe9, 0x77, 0x39, 0x02, 0xff, 0x0e, 0x57, 0x8e, 0x95,
-  0x69, 0x13, 0x0b, 0x19, 0x37, 0x26, 0x9f, 0xb9, 0xd3, 0x4a, 0x18, 0x33,
-  0x3a, 0x8f, 0x31, 0xc7, 0xe4, 0x41, 0xa1, 0x1d, 0xec, 0x16, 0x95, 0x47,
-  0xd0, 0x13, 0x86, 0x60, 0x54, 0x35, 0x24, 0xd2, 0x07, 0xd8, 0x7b, 0x3c,
-  0x91, 0x89, 0x6f, 0x33, 0x29, 0xe3, 0x6e, 0x8b, 0x7b, 0xf5, 0x0e, 0x8b,
-  0xfa, 0xcb, 0x70, 0x0c, 0x7c, 0x51, 0xbc, 0x07, 0x03, 0xec, 0xaa, 0xf7,
-  0xd0, 0x70, 0xc0, 0xc7, 0x86, 0x1d, 0x5d, 0xd4, 0xd7, 0x7b, 0xd9, 0xbc,
-  0xb3, 0x87, 0xdd, 0xfb, 0xdc, 0x84, 0xc2, 0xfa, 0x40, 0xba, 0x62, 0x09,
-  0x8f, 0xff, 0x91, 0xb8, 0xf1, 0xd7, 0xe5, 0x95, 0x22, 0x88, 0x00, 0x10,
-  0x32, 0x8d, 0x31, 0xc0, 0x9f, 0xe9, 0x27, 0x55, 0x03, 0x9f, 0x4a, 0x01,
-  0x1d, 0x9b, 0xcf, 0xa8, 0x9a, 0x3c, 0xa6, 0x8e, 0xcd, 0xe7, 0xd8, 0x31,
-  0x05, 0x4c, 0x1b, 0x93, 0x47, 0xe9, 0x60, 0xa7, 0xaa, 0x3d, 0xb7, 0x9a,
-  0x95, 0xe1, 0x8b, 0x19, 0x6a, 0xb2, 0x61, 0x58, 0x87, 0x40, 0x14, 0x42,
-  0x31, 0xf5, 0xb3, 0x84, 0xd1, 0xcc, 0x80, 0xe8, 0xc1, 0x3f, 0x3c, 0x78,
-  0x2d, 0xfe, 0x56, 0xb1, 0x98, 0xc0, 0x66, 0x56, 0xfd, 0xf3, 0xad, 0x26,
-  0x30, 0x69, 0x6a, 0x4e, 0x03, 0x87, 0x93, 0x29, 0x3b, 0xdb, 0x83, 0xec,
-  0x3b, 0xe0, 0x63, 0x6f, 0xa3, 0x8f, 0x3d, 0x7b, 0xdd, 0xec, 0x6e, 0xf0,
-  0xb2, 0x77, 0xbf, 0x97, 0xba, 0x03, 0x5e, 0x9a, 0x5a, 0x02, 0x03, 0xf9,
-  0x79, 0x49, 0xec, 0xf1, 0xdf, 0x0d, 0x3c, 0x27, 0x1e, 0xbf, 0x20, 0x02,
-  0x40, 0xe8, 0x0f, 0x0c, 0x42, 0xed, 0x5d, 0x66, 0x74, 0x43, 0xa1, 0xcf,
-  0x82, 0xc3, 0x6e, 0xa6, 0xa6, 0xca, 0xc5, 0xf8, 0x63, 0x72, 0x29, 0x2b,
-  0x75, 0x30, 0xb8, 0x2c, 0x9b, 0xe1, 0x83, 0x9d, 0x0c, 0x19, 0x92, 0x4d,
-  0x41, 0x8e, 0x95, 0x21, 0x15, 0xd9, 0x38, 0x4b, 0x1c, 0xe0, 0x30, 0xc7,
-  0x43, 0xe0, 0x9a, 0x32, 0xa0, 0x98, 0x94, 0x03, 0x18, 0xd5, 0x21, 0x6a,
-  0xa8, 0x4f, 0x50, 0x42, 0x21, 0xaa, 0x43, 0x0c, 0x25, 0x22, 0xa2, 0xba,
-  0xfa, 0xd4, 0x34, 0x88, 0xe9, 0x18, 0xfa, 0xa7, 0x7b, 0xca, 0x35, 0x0d,
-  0x75, 0x4c, 0x03, 0x65, 0xb4, 0xcd, 0xda, 0xe1, 0xcf, 0xc4, 0xb9, 0x18,
-  0xf1, 0xdf, 0x49, 0x78, 0xf1, 0x89, 0x73, 0x0b, 0xc7, 0x20, 0xa2, 0x2b,
-  0x3f, 0xd5, 0x13, 0xc1, 0xd3, 0x19, 0xa2, 0xbe, 0xc5, 0x4f, 0x47, 0x47,
-  0x88, 0x86, 0x66, 0x3f, 0x75, 0x4d, 0x3e, 0x0e, 0x34, 0xfa, 0xd8, 0xdb,
-  0xe0, 0xa5, 0xb1, 0x35, 0x40, 0xf3, 0xc1, 0x00, 0xbe, 0x40, 0x54, 0x9e,
-  0x8a, 0xc3, 0x46, 0x3f, 0x8c, 0x0a, 0xf5, 0xdf, 0x09, 0xac, 0x90, 0x4b,
-  0x22, 0x88, 0x00, 0x10, 0xfa, 0x23, 0xb9, 0xc0, 0x13, 0x64, 0xd8, 0xe4,
-  0xc1, 0x64, 0x50, 0x59, 0x91, 0x4d, 0x79, 0x89, 0x83, 0xbc, 0x3c, 0x1b,
-  0x43, 0xca, 0xb2, 0x70, 0x39, 0x2d, 0x94, 0x15, 0x3b, 0x28, 0x2f, 0xcd,
-  0x22, 0xcf, 0x65, 0x25, 0xdf, 0x65, 0x25, 0x3f, 0xcf, 0x46, 0xbe, 0xcb,
-  0x8a, 0xae, 0x1b, 0x38, 0xb3, 0x2d, 0xe4, 0xe5, 0xd9, 0xc8, 0x76, 0x98,
-  0x31, 0xd9, 0xcd, 0x2a, 0x23, 0xde, 0x6e, 0x56, 0xc2, 0x20, 0xcb, 0x1c,
-  0xf7, 0xba, 0x3f, 0x0d, 0x86, 0x8a, 0x42, 0x68, 0x9a, 0x12, 0x13, 0x3e,
-  0x15, 0x91, 0x08, 0x04, 0x63, 0xf8, 0x7d, 0x51, 0x3a, 0xbb, 0xc3, 0x98,
-  0xcd, 0x1a, 0x3e, 0x7f, 0x94, 0x2e, 0x77, 0x98, 0xd6, 0xf6, 0x20, 0x5d,
-  0xee, 0x08, 0x9d, 0x5d, 0x21, 0xea, 0x9b, 0xfc, 0xb4, 0x75, 0x04, 0xe9,
-  0xf2, 0x44, 0xe8, 0xe8, 0x08, 0xd1, 0xde, 0x15, 0xa2, 0xb9, 0x35, 0x20,
-  0x37, 0xf5, 0xe8, 0x0c, 0x7f, 0x37, 0x70, 0x25, 0xf0, 0x91, 0x5c, 0x12,
-  0x41, 0x04, 0x80, 0x30, 0x10, 0xb0, 0x01, 0xd7, 0x01, 0x57, 0x00, 0x39,
-  0x22, 0x06, 0x3e, 0x3d, 0x56, 0x8b, 0x09, 0xa7, 0xd3, 0x42, 0x41, 0xae,
-  0x95, 0x3c, 0x97, 0x95, 0x92, 0x22, 0x07, 0xae, 0x6c, 0x0b, 0xd1, 0x98,
-  0x4e, 0x41, 0x9e, 0x0d, 0x7b, 0x96, 0xe5, 0xf0, 0x76, 0xc2, 0x7f, 0xc2,
-  0xa4, 0x11, 0x8d, 0xe8, 0x74, 0x74, 0x85, 0x30, 0x99, 0x34, 0x42, 0xe1,
-  0x18, 0x87, 0x3a, 0x43, 0x78, 0xbc, 0x51, 0xda, 0xbb, 0x43, 0xf8, 0xfd,
-  0x51, 0xfc, 0x81, 0x18, 0x9a, 0x86, 0x24, 0x34, 0xf6, 0x9e, 0xe1, 0xff,
-  0x10, 0xf8, 0x12, 0x2a, 0xe4, 0x2f, 0x08, 0x22, 0x00, 0x84, 0x01, 0xc9,
-  0x64, 0xe0, 0xb7, 0x0c, 0xc0, 0x3c, 0x01, 0x61, 0xc0, 0x19, 0x7d, 0x0f,
-  0xf0, 0x2b, 0xe0, 0x19, 0x20, 0x22, 0x97, 0x45, 0x10, 0x01, 0x20, 0x08,
-  0x8a, 0x62, 0xe0, 0xa7, 0xa8, 0x52, 0x42, 0x67, 0xfc, 0x67, 0x22, 0x06,
-  0x84, 0xfe, 0x60, 0xf8, 0xdb, 0x50, 0x7d, 0xfa, 0xf7, 0xc8, 0x25, 0x11,
-  0x44, 0x00, 0x08, 0xc2, 0x27, 0x63, 0x02, 0x4e, 0x04, 0x7e, 0xc6, 0x00,
-  0x29, 0x23, 0x14, 0xfa, 0xa5, 0xd1, 0x77, 0xc7, 0xbd, 0xfd, 0xe7, 0x90,
-  0x01, 0x3d, 0x82, 0x08, 0x00, 0x41, 0xf8, 0xd4, 0x94, 0xa1, 0xb6, 0x07,
-  0x8e, 0x91, 0xa8, 0x80, 0x90, 0xe6, 0x46, 0x1f, 0x54, 0x42, 0xdf, 0x4a,
-  0x54, 0xc7, 0xbe, 0x56, 0xb9, 0x2c, 0x82, 0x08, 0x00, 0x41, 0xe8, 0x9d,
-  0xa8, 0xc0, 0x2c, 0xe0, 0x17, 0x48, 0xae, 0x80, 0x90, 0x5e, 0x46, 0x3f,
-  0x0c, 0xd4, 0x03, 0xff, 0x03, 0xd4, 0x22, 0xb5, 0xfb, 0x82, 0x08, 0x00,
-  0x41, 0xe8, 0x33, 0x06, 0xc7, 0x85, 0xc0, 0x68, 0xd4, 0x16, 0x81, 0x44,
-  0x05, 0x84, 0x64, 0x1b, 0xfd, 0x00, 0xd0, 0x01, 0x7c, 0x1b, 0x58, 0x07,
-  0x48, 0x53, 0x03, 0x41, 0x04, 0x80, 0x20, 0x24, 0x39, 0x2a, 0x70, 0x2c,
-  0xaa, 0x55, 0x6a, 0x19, 0x90, 0x25, 0x62, 0x40, 0xe8, 0x43, 0xa3, 0xef,
-  0x8b, 0x1b, 0xfd, 0x6f, 0xa0, 0x4a, 0xf8, 0xc4, 0xe8, 0x0b, 0x22, 0x00,
-  0x04, 0x21, 0x4d, 0xd6, 0xf3, 0xd8, 0xb8, 0x18, 0x28, 0x41, 0xf2, 0x05,
-  0x84, 0xde, 0x31, 0xfa, 0x9d, 0x40, 0x03, 0x70, 0x07, 0xb0, 0x13, 0x09,
-  0xef, 0x0b, 0x22, 0x00, 0x04, 0x21, 0xad, 0x31, 0xa3, 0x66, 0x10, 0xfc,
-  0x30, 0x2e, 0x00, 0x64, 0x9b, 0x40, 0x38, 0x5a, 0x83, 0x1f, 0x46, 0x0d,
-  0xe1, 0x59, 0x0e, 0xfc, 0x2f, 0x92, 0xc8, 0x27, 0x88, 0x00, 0x10, 0x84,
-  0x8c, 0xa6, 0x12, 0xb5, 0x57, 0x3b, 0x0d, 0x29, 0x2b, 0x14, 0xfe, 0xd9,
-  0xe8, 0xbb, 0xe3, 0x9e, 0xfe, 0x1d, 0xc0, 0x56, 0xc0, 0x2b, 0x97, 0x46,
-  0x10, 0x01, 0x20, 0x08, 0xfd, 0x8f, 0x3c, 0xe0, 0x34, 0xe0, 0xa6, 0xb8,
-  0x18, 0x90, 0xad, 0x82, 0x81, 0x67, 0xf0, 0x83, 0xa8, 0x8e, 0x7c, 0x6f,
-  0xc6, 0xbd, 0xfc, 0x06, 0x24, 0xb4, 0x2f, 0x88, 0x00, 0x10, 0x84, 0x01,
-  0xf7, 0x0c, 0x54, 0x03, 0x5f, 0x05, 0x4e, 0xe0, 0x70, 0x79, 0xa1, 0x08,
-  0x82, 0xfe, 0x65, 0xf0, 0x13, 0x61, 0xfd, 0x0d, 0xc0, 0x7d, 0xc0, 0x5e,
-  0xd4, 0x0c, 0x45, 0x41, 0x10, 0x01, 0x20, 0x08, 0x02, 0x00, 0x76, 0x54,
-  0xc3, 0xa1, 0x9b, 0x80, 0x09, 0x1c, 0xde, 0x2e, 0x10, 0x41, 0x90, 0x59,
-  0x06, 0xdf, 0x07, 0xf8, 0x81, 0xb7, 0x80, 0xdf, 0x03, 0x07, 0x90, 0x4e,
-  0x7c, 0x82, 0x20, 0x02, 0x40, 0x10, 0x3e, 0x05, 0x96, 0xb8, 0x20, 0xb8,
-  0x18, 0x38, 0x13, 0xb5, 0x5d, 0x20, 0x5b, 0x06, 0xe9, 0x65, 0xec, 0x41,
-  0xed, 0xdf, 0xfb, 0x80, 0x7b, 0xe3, 0x5e, 0x7e, 0x33, 0xa0, 0xcb, 0x25,
-  0x12, 0x04, 0x11, 0x00, 0x82, 0xd0, 0x5b, 0x98, 0x50, 0xdb, 0x04, 0x73,
-  0x80, 0xc5, 0xc0, 0x70, 0xd4, 0x28, 0x63, 0xc7, 0x11, 0xbf, 0x23, 0xc2,
-  0xa0, 0x6f, 0x8d, 0xbd, 0x07, 0xb5, 0x87, 0xff, 0x2e, 0xf0, 0x67, 0x60,
-  0x5f, 0xdc, 0xf8, 0x0b, 0x82, 0x20, 0x02, 0x40, 0x10, 0x92, 0x2e, 0x0a,
-  0x06, 0xc7, 0xc5, 0xc0, 0x0d, 0xc0, 0xb0, 0xb8, 0x20, 0x70, 0x89, 0x28,
-  0xf8, 0x4c, 0x86, 0x3e, 0x31, 0x4c, 0x27, 0x02, 0xbc, 0x02, 0x3c, 0x8f,
-  0x4a, 0xd6, 0xf3, 0xc8, 0x65, 0x12, 0x04, 0x11, 0x00, 0x82, 0x90, 0xae,
-  0x98, 0x51, 0x5d, 0x09, 0xcb, 0x80, 0x05, 0xc0, 0x8c, 0xb8, 0x08, 0xb0,
-  0xc5, 0x7f, 0x6e, 0x1b, 0xc0, 0xe2, 0xa0, 0xee, 0x63, 0xff, 0xee, 0x43,
-  0xb5, 0xd5, 0x6d, 0x07, 0xb6, 0x03, 0x2f, 0xa3, 0x1a, 0xee, 0xb8, 0xe3,
-  0x9e, 0xbe, 0x20, 0x08, 0x22, 0x00, 0x04, 0xa1, 0x5f, 0x90, 0x05, 0x54,
-  0x00, 0xc5, 0xc0, 0xe9, 0xc0, 0xdc, 0x78, 0xb4, 0xc0, 0x0c, 0x14, 0xfe,
-  0x8b, 0xdf, 0xcf, 0x34, 0x81, 0xf0, 0x71, 0x03, 0x1f, 0x42, 0xd5, 0xd5,
-  0xc7, 0xe2, 0x9f, 0xef, 0xa3, 0x9a, 0xec, 0xd4, 0x03, 0x5d, 0xa8, 0x64,
-  0x3d, 0x29, 0xc1, 0x13, 0x04, 0x11, 0x00, 0x82, 0x30, 0xa0, 0xb1, 0xa2,
-  0x2a, 0x11, 0x4a, 0x81, 0x22, 0x60, 0x36, 0x30, 0x02, 0xd5, 0xd5, 0x30,
-  0x3b, 0xfe, 0x3b, 0x96, 0xf8, 0x1f, 0x2b, 0x87, 0x13, 0x12, 0x3f, 0x89,
-  0xcf, 0x22, 0x1e, 0xea, 0xfe, 0xcd, 0xdf, 0xf9, 0x50, 0x7d, 0xf0, 0x8d,
-  0xf8, 0xa7, 0x8e, 0x4a, 0xc4, 0xdb, 0x0e, 0xec, 0x02, 0x36, 0x01, 0x87,
-  0xe2, 0x3f, 0x0b, 0xa1, 0xc2, 0xf8, 0x82, 0x20, 0x88, 0x00, 0x10, 0x04,
-  0xa1, 0x97, 0x9e, 0x5f, 0x1b, 0x87, 0x93, 0x10, 0x35, 0xa0, 0x20, 0xfe,
-  0x77, 0x85, 0x71, 0xc1, 0x30, 0x02, 0x95, 0x93, 0xe0, 0xfd, 0xd8, 0x7f,
-  0x67, 0x7c, 0xec, 0x1d, 0x70, 0xa4, 0x07, 0x9e, 0x03, 0x7c, 0x80, 0xaa,
-  0x9b, 0xef, 0x42, 0xed, 0xb9, 0xeb, 0xa8, 0x90, 0x7c, 0x4f, 0xdc, 0xa0,
-  0x4b, 0x49, 0x9d, 0x20, 0x08, 0x82, 0x20, 0x08, 0x82, 0x20, 0x08, 0x82,
-  0x20, 0x08, 0x82, 0x20, 0x08, 0x82, 0x20, 0x08, 0x82, 0x20, 0x08, 0x82,
-  0x20, 0x08, 0x82, 0x20, 0x08, 0x82, 0x20, 0x08, 0x82, 0x20, 0x08, 0x82,
-  0x20, 0x08, 0x82, 0x20, 0x08, 0x82, 0x20, 0x08, 0x82, 0x20, 0x08, 0x82,
-  0x20, 0x08, 0x82, 0x20, 0x08, 0x82, 0x20, 0x08, 0x82, 0x20, 0x08, 0x82,
-  0x20, 0x08, 0x82, 0x20, 0x08, 0x82, 0x20, 0x08, 0x82, 0x20, 0x08, 0x82,
-  0x20, 0x08, 0x82, 0x20, 0x08, 0x82, 0x20, 0x08, 0x82, 0x20, 0x08, 0x82,
-  0x20, 0x08, 0x82, 0x20, 0x08, 0x82, 0x20, 0x08, 0x82, 0x20, 0x08, 0x82,
-  0x20, 0x08, 0x82, 0x20, 0x08, 0x82, 0x20, 0x08, 0x82, 0x20, 0x08, 0x82,
-  0x20, 0x08, 0x82, 0x20, 0x08, 0x82, 0x20, 0x08, 0x82, 0x20, 0x08, 0x82,
-  0x20, 0x08, 0x82, 0x20, 0x08, 0x82, 0x20, 0x08, 0x82, 0x20, 0x08, 0x82,
-  0x20, 0x08, 0x82, 0x20, 0x08, 0x82, 0x20, 0x08, 0x82, 0x90, 0x2c, 0xfe,
-  0x0f, 0x57, 0xe2, 0x2e, 0xaa, 0x01, 0x55, 0xc1, 0x2b, 0x00, 0x00, 0x00,
-  0x00, 0x49, 0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82
-};
-unsigned int awesome_face_png_len = 59277;
@@ -1,3 +1,5 @@
+#include <cmath>
+#include <map>
 #include <memory>
 #include <vector>
 
@@ -8,23 +10,20 @@
 #include <GLES3/gl3.h>
 #include <EGL/egl.h>
 
-#include "images/tiles/dark_grass.h"
-#include "images/tiles/dry_grass.h"
-
-#include "images/awesome_face.h"
-#include "images/brick_wall.h"
-#include "images/incredulous_face.h"
-#include "images/shocked_face.h"
-
+#include "asset_pack.hpp"
 #include "box.hpp"
-#include "box_data.hpp"
 #include "camera.hpp"
-#include "draw_instanced_no_texture.hpp"
-#include "draw_instanced_with_texture.hpp"
+#include "draw_instanced.hpp"
+#include "gl_state.hpp"
 #include "grid_square.hpp"
+#include "particle_system.hpp"
 #include "square.hpp"
 #include "texture.hpp"
 
+#include "sim/cage.hpp"
+#include "sim/job_system.hpp"
+#include "sim/simulation.hpp"
+
 namespace {
 
     /*! Helper
@@ -42,155 +41,122 @@ namespace {
 namespace{
 
     /*! Helper
-     *! Builds the vertices for the map grid
+     *! Replaces the instances of drawable with mats, uploading only the
+     *! span of instances that differ from the ones it holds
+     *! @param current [in, out] model matrices drawable holds
      */
-    std::vector<calc::mat4f> build_grid(int width, int length)
+    void update_instances(render::Drawable& drawable, std::vector<float>& current, const std::vector<calc::mat4f>& mats)
     {
-        static const float xdim = 1.0;
-        static const float ydim = 1.0;
-
-        calc::mat4f model = calc::mat4f::identity();
-        float& x = model[3][0];
-        float& y = model[3][1];
+        static const unsigned nbytes = 16 * sizeof(float);
+        const std::vector<float> coords = copy_matrix_data(mats);
 
-        const int xinst = std::ceil(width / 2.0 / xdim);
-        const int yinst = std::ceil(length / 2.0 / ydim);
+        const unsigned size = coords.size() / 16;
+        const unsigned common = std::min(current.size() / 16, (::size_t)size);
 
-        const int size = xinst * yinst * 4;
+        // Instances past the ones held are new; within them, trim the equal ends
+        unsigned first = 0;
+        while (first != common && ::memcmp(&current[16 * first], &coords[16 * first], nbytes) == 0)
+            ++first;
 
-        std::vector<calc::mat4f> grid;
-        grid.resize(size);
-        calc::mat4f* ptr = &grid[0];
-
-        for (int i = -xinst; i != xinst; ++i)
+        unsigned last = size;
+        if (size <= common)
         {
-            for (int j = -yinst; j != yinst; ++j)
-            {
-                x = i * xdim + 0.5;
-                y = j * ydim + 0.5;
-                *ptr++ = model;
-            }
+            while (last != first && ::memcmp(&current[16 * (last - 1)], &coords[16 * (last - 1)], nbytes) == 0)
+                --last;
         }
 
-        return grid;
+        if (first != last) {
+            drawable.modify_range(&coords[16 * first], first, last - first);
+        }
+
+        drawable.resize(size);
+        current = coords;
     }
+}
+
+namespace{
 
     /*! Helper
-     *! Loads grid vertices and the grid render target
+     *! @return the # of grid squares along a dimension; unit squares,
+     *! centered on integer coordinates + 0.5, covering [-size / 2, size / 2]
      */
-    std::shared_ptr<render::GridSquare> load_grid(unsigned  gridWidth, unsigned  gridLength)
-    {
-        // Load grid tiles
-        const std::vector<float> gridCoords = copy_matrix_data(build_grid(gridWidth, gridLength));
-
-        unsigned size = gridCoords.size() / 16;
+    inline unsigned grid_squares(unsigned gridSize) {
+        return 2 * std::ceil(gridSize / 2.0);
+    }
 
-        std::shared_ptr<render::GridSquare> tile = std::make_shared<render::GridSquare>(gridWidth * gridLength);
-        tile->reset(gridCoords.data(), size);
-        return tile;
+    /*! Helper
+     *! Loads the grid render target
+     */
+    std::shared_ptr<render::GridSquare> load_grid(unsigned gridWidth, unsigned gridLength) {
+        return std::make_shared<render::GridSquare>(grid_squares(gridWidth), grid_squares(gridLength));
     }
 
     /*! Helper
-     *! Build the vertices for the map wall
+     *! Loads the wall render target, with room for wallSizeMax boxes;
+     *! filled by update_instances() (see sim::build_wall())
      */
-    std::vector<calc::mat4f> build_wall(int width, int length)
+    std::shared_ptr<render::Box> load_wall(unsigned* wallTAO,
+                                           unsigned  wallTAOCount,
+                                           unsigned  wallSizeMax)
     {
-        std::vector<calc::mat4f> wall;
-
-        // West wall
-        for (int i = 1 - length / 2 / 3; i != length / 2 / 3; ++i)
-        {
-            calc::mat4f mat = calc::mat4f::identity();
-            mat[0][0] = 3;
-            mat[1][1] = 3;
-
-            mat[0][3] = width / 2 - 1;
-            mat[1][3] = i * 3;
-            mat[2][3] = -1.0;
-            wall.push_back(calc::transpose(mat));
-        }
-
-        // East wall
-        for (int i = 1 - length / 2 / 3; i != length / 2 / 3; ++i)
-        {
-            calc::mat4f mat = calc::mat4f::identity();
-            mat[0][0] = 3;
-            mat[1][1] = 3;
-
-            mat[0][3] = 1 - width / 2;
-            mat[1][3] = i * 3;
-            mat[2][3] = -1.0;
-            wall.push_back(calc::transpose(mat));
-        }
-
-        // North wall
-        for (int i = 1 - width / 2 / 3; i != width / 2 / 3; ++i)
-        {
-            calc::mat4f mat = calc::mat4f::identity();
-            mat[0][0] = 3;
-            mat[1][1] = 3;
-
-            mat[0][3] = i * 3;
-            mat[1][3] = length / 2 - 1;
-            mat[2][3] = -1.0;
-            wall.push_back(calc::transpose(mat));
-        }
-
-        // South wall
-        for (int i = 1 - width / 2 / 3; i != width / 2 / 3; ++i)
-        {
-            calc::mat4f mat = calc::mat4f::identity();
-            mat[0][0] = 3;
-            mat[1][1] = 3;
-
-            mat[0][3] = i * 3;
-            mat[1][3] = 1 - length / 2;
-            mat[2][3] = -1.0;
-            wall.push_back(calc::transpose(mat));
-        }
-
-        return wall;
+        return std::make_shared<render::Box>(wallTAO, wallTAOCount, wallSizeMax);
     }
+}
+
+namespace {
 
     /*! Helper
-     *! Loads wall vertices and the wall render target
+     *! Builds the model matrix of a field quad spanning [x0, x1] x [y0, y1]
      */
-    std::shared_ptr<render::Box> load_wall(unsigned  cageWidth,
-                                           unsigned  cageLength,
-                                           unsigned* wallTAO,
-                                           unsigned  wallTAOCount)
+    inline calc::mat4f build_field(float x0, float y0, float x1, float y1)
     {
-        const std::vector<float> wallCoords = copy_matrix_data(build_wall(cageWidth, cageLength));
+        calc::mat4f mat = calc::mat4f::identity();
+        mat[0][0] = x1 - x0;
+        mat[1][1] = y1 - y0;
 
-        unsigned size = wallCoords.size() / 16;
+        mat[0][3] = (x0 + x1) / 2;
+        mat[1][3] = (y0 + y1) / 2;
+        mat[2][3] = 0;
+        return calc::transpose(mat);
+    }
 
-        std::shared_ptr<render::Box> object
-            = std::make_shared<render::Box>(wallTAO, wallTAOCount, cageWidth * cageLength);
-        object->reset(wallCoords.data(), size);
-        return object;
+    /*! Helper
+     *! Sampler for ground textures; repeated across field quads
+     */
+    inline render::sampler ground_sampler() {
+        return render::sampler(render::sampler::REPEAT,
+                               render::sampler::LINEAR,
+                               render::sampler::LINEAR,
+                               true,
+                               8.0);
     }
-}
 
-namespace {
     /*! Helper
-     *! Loads dry grass coordinates and the grass render target
+     *! Loads the dry grass render target; filled by update_instances()
+     *! (see build_dry_grass())
      */
-    inline std::shared_ptr<render::Square> load_dry_grass(int gridWidth,
-                                                          int gridLength,
-                                                          int cageWidth,
-                                                          int cageLength)
+    inline std::shared_ptr<render::Square> load_dry_grass()
     {
         // Load dry grass textures and shape
-        unsigned textureTAO = render::load_texture_from_data(dry_grass_png, dry_grass_png_len, false);
+        unsigned textureTAO = render::register_texture("tiles/dry-grass.png", false, true, ground_sampler());
+        render::request_texture(textureTAO);
         unsigned tileTAO[] = {
             textureTAO,
             textureTAO
         };
 
         unsigned TAOCount = sizeof(tileTAO) / sizeof(unsigned);
-        unsigned size = gridWidth * gridLength;
+        unsigned size = 4;
+
+        return std::make_shared<render::Square>(tileTAO, TAOCount, size);
+    }
 
-        std::shared_ptr<render::Square> tile = std::make_shared<render::Square>(tileTAO, TAOCount, size);
+    /*! Helper
+     *! Builds dry grass coordinates; the fields of the grid around the cage
+     */
+    std::vector<calc::mat4f> build_dry_grass(int gridWidth, int gridLength, int cageWidth, int cageLength)
+    {
+        std::vector<calc::mat4f> tile;
 
         // Calculate minimum and maximum coordinates
         int gridMaxLength = gridLength / 2;
@@ -205,74 +171,47 @@ namespace {
         int cageMaxWidth = cageWidth / 2;
         int cageMinWidth = -cageMaxWidth;
 
-        // Load dry grass coordinates...
-        calc::mat4f mat = calc::mat4f::identity();
+        // Load dry grass fields; one quad per field, unit tiles centered on integer coordinates...
 
         // Top field
-        for (int i = cageMaxLength; i <= gridMaxLength; ++i)
-        {
-            for (int j = gridMinWidth; j <= gridMaxWidth; ++j)
-            {
-                mat[3][0] = j;
-                mat[3][1] = i;
-                tile->push_back(mat);
-            }
-        }
-
+        tile.push_back(build_field(gridMinWidth - 0.5, cageMaxLength - 0.5, gridMaxWidth + 0.5, gridMaxLength + 0.5));
         // Right field
-        for (int i = cageMinLength; i <= cageMaxLength; ++i)
-        {
-            for (int j = gridMinWidth; j <= cageMinWidth + 1; ++j)
-            {
-                mat[3][0] = j;
-                mat[3][1] = i;
-                tile->push_back(mat);
-            }
-        }
-
+        tile.push_back(build_field(gridMinWidth - 0.5, cageMinLength + 0.5, cageMinWidth + 1.5, cageMaxLength - 0.5));
         // Left field
-        for (int i = cageMinLength; i <= cageMaxLength; ++i)
-        {
-            for (int j = cageMaxWidth - 1; j <= gridMaxWidth; ++j)
-            {
-                mat[3][0] = j;
-                mat[3][1] = i;
-                tile->push_back(mat);
-            }
-        }
-
+        tile.push_back(build_field(cageMaxWidth - 1.5, cageMinLength + 0.5, gridMaxWidth + 0.5, cageMaxLength - 0.5));
         // Bottom field
-        for (int i = gridMinLength; i <= cageMinLength; ++i)
-        {
-            for (int j = gridMinWidth; j <= gridMaxWidth; ++j)
-            {
-                mat[3][0] = j;
-                mat[3][1] = i;
-                tile->push_back(mat);
-            }
-        }
+        tile.push_back(build_field(gridMinWidth - 0.5, gridMinLength - 0.5, gridMaxWidth + 0.5, cageMinLength + 0.5));
 
         return tile;
     }
 
     /*! Helper
-     *! Loads fresh grass coordinates and the grass render target
+     *! Loads the fresh grass render target; filled by update_instances()
+     *! (see build_fresh_grass())
      */
-    std::shared_ptr<render::Square> load_fresh_grass(int cageWidth, int cageLength)
+    std::shared_ptr<render::Square> load_fresh_grass()
     {
 
         // Load fresh grass tiles...
-        unsigned textureTAO = render::load_texture_from_data(dark_grass_png, dark_grass_png_len, false);
+        unsigned textureTAO = render::register_texture("tiles/dark-grass.png", false, true, ground_sampler());
+        render::request_texture(textureTAO);
         unsigned tileTAO[] = {
             textureTAO,
             textureTAO
         };
 
         unsigned TAOCount = sizeof(tileTAO) / sizeof(unsigned);
-        unsigned size = cageWidth * cageLength;
+        unsigned size = 1;
 
-        std::shared_ptr<render::Square> tile = std::make_shared<render::Square>(tileTAO, TAOCount, size);
+        return std::make_shared<render::Square>(tileTAO, TAOCount, size);
+    }
 
+    /*! Helper
+     *! Builds fresh grass coordinates; the floor inside the cage walls, or
+     *! the rectangle around it for polygon cages
+     */
+    std::vector<calc::mat4f> build_fresh_grass(int cageWidth, int cageLength)
+    {
         int cageMaxLength = cageLength / 2;
         int cageMinLength = -cageMaxLength;
 
@@ -281,28 +220,44 @@ namespace {
 
         int wallThickness = 2;
 
-        // Load fresh grass coordinates
-        for (int i = cageMinLength + wallThickness; i <= cageMaxLength - wallThickness; ++i)
-        {
-            for (int j = cageMinWidth + wallThickness; j <= cageMaxWidth - wallThickness; ++j)
-            {
-                tile->push_back(calc::transpose([i, j]() {
-
-                    calc::mat4f mat = calc::mat4f::identity();
-                    mat[0][3] = j;
-                    mat[1][3] = i;
-                    mat[2][3] = 0;
-                    return mat;
-                }()));
-            }
-        }
-
-        return tile;
+        // Load fresh grass coordinates; one quad, unit tiles centered on integer coordinates
+        return std::vector<calc::mat4f>(1, build_field(cageMinWidth + wallThickness - 0.5,
+                                                       cageMinLength + wallThickness - 0.5,
+                                                       cageMaxWidth - wallThickness + 0.5,
+                                                       cageMaxLength - wallThickness + 0.5));
     }
 }
 
 namespace {
 
+    // Program variants drawn by the scene; blending is added per drawable
+    // (see blend_feature()) and fog at draw time
+    const unsigned GRID_DRAW   = render::GRID_INSTANCES;
+    const unsigned OBJECT_DRAW = render::TEXTURED;
+    const unsigned GROUND_DRAW = render::TEXTURED | render::TILED;
+
+    // Ticks run per frame at most; past it, the simulation slows down
+    // instead of spending ever longer frames catching up
+    const unsigned MAX_TICKS_PER_FRAME = 8;
+    // Particles per bounce, at most
+    const unsigned MAX_PARTICLE_BURST = 4096;
+    // Particles per bounce until set otherwise
+    const unsigned DEFAULT_PARTICLE_BURST = 64;
+    // Frame time the particles step at most; they pause with the tab
+    const float MAX_PARTICLE_STEP = 0.1;
+    // Wall boxes drawn at most; a cage of sim::MAX_CAGE_SIZE needs well under
+    const unsigned MAX_WALL_BOXES = 4 * sim::MAX_CAGE_SIZE;
+    // Seed of ball placement; fixed, so runs can be replayed
+    const unsigned BALL_SEED = 0x9e3779b9;
+
+    /*! Helper
+     *! Samples a second texture only if the drawable binds two distinct ones;
+     *! the wall and grass bind theirs twice
+     */
+    inline unsigned blend_feature(const render::Drawable& drawable) {
+        return drawable.get_texture_count() > 1 ? render::BLENDED : 0;
+    }
+
     /*! Class Runner
      *! Encapsulates the main loop
      */
@@ -343,12 +298,65 @@ namespace {
             return gridColor_;
         }
 
-        BallData& get_ball() {
-            return ballData_;
+        void enable_fog(bool state);
+
+        bool get_fog_state() const {
+            return fogEnabled_;
         }
 
-        const BallData& get_ball() const {
-            return ballData_;
+        /*! Enables wall bounce particles; disabling drops the live ones
+         *! and frees their buffers
+         */
+        void enable_particles(bool state);
+
+        /*! Sets the # of particles per bounce, [1, MAX_PARTICLE_BURST]
+         */
+        void set_particle_burst(unsigned size);
+
+        /*! @return the # of particle slots in use; live particles are among them
+         */
+        unsigned get_particle_slots() const {
+            return particles_ ? particles_->size() : 0;
+        }
+
+        /*! Applies a simulation control (see control_command) before the
+         *! next tick; recorded while recording, ignored while replaying
+         */
+        void set_control(unsigned command, unsigned axis, float value);
+
+        /*! Restarts the simulation with the current controls and records
+         *! them, and every control after, by tick
+         */
+        void start_recording();
+
+        /*! Stops recording
+         *! @return false if the log could not be saved
+         */
+        bool stop_recording(const char* path);
+
+        /*! Restarts the simulation and drives it from a recorded log;
+         *! live controls resume after its last tick
+         *! @return false if the log could not be loaded
+         */
+        bool start_replay(const char* path);
+
+        bool is_replaying() const {
+            return sim_->is_playing();
+        }
+
+        const sim::BallSystem& get_balls() const {
+            return sim_->get_balls();
+        }
+
+        const sim::JobSystem& get_jobs() const {
+            return *jobs_;
+        }
+
+        /*! @return the update time per ball and tick, in nanoseconds,
+         *! over the last frame that ran ticks
+         */
+        double get_ball_update_time() const {
+            return ballUpdateTime_;
         }
 
         Camera& get_camera() {
@@ -371,6 +379,55 @@ namespace {
          */
         void on_text_input(const SDL_Event&) {}
 
+        /*! Helper
+         *! Submits the program variants drawn by the scene for building,
+         *! with extra features; each is checked against the vertex arrays drawn with it
+         */
+        void submit_programs(unsigned features);
+
+        /*! Helper
+         *! Draws drawable with the variant for features and its textures
+         */
+        void draw(const render::Drawable& drawable, unsigned features);
+
+        /*! Helper
+         *! Uses the program variant with features (plus fog, if enabled
+         *! and compiled)
+         */
+        DrawInstanced& use_program(unsigned features);
+
+        /*! Helper
+         *! Runs the simulation ticks due since the last frame
+         */
+        void step();
+
+        /*! Helper
+         *! Advances the simulation by one tick
+         */
+        void update();
+
+        /*! Helper
+         *! Queues particle bursts at the wall bounces of this frame's ticks
+         */
+        void emit_particles();
+
+        /*! Helper
+         *! Allocates the particle system on first use, and grows it to fit
+         *! a full frame of bursts of the current size
+         */
+        void reserve_particles();
+
+        /*! Helper
+         *! Rebuilds the wall and grass instances that differ from the
+         *! last frame's cage, if the simulation's cage has changed
+         */
+        void update_cage();
+
+        /*! Helper
+         *! Restarts the simulation from no balls, at tick 0
+         */
+        void reset_simulation(unsigned seed);
+
         /*! Helper
          *! Renders the scene
          */
@@ -381,15 +438,31 @@ namespace {
 
         // Camera / viewer
         std::shared_ptr<Camera> camera_;
-        // Contains ball position and rotation information
-        BallData ballData_;
-
-        // Program, uses instancing;
-        // called to draw grid squares
-        DrawInstancedNoTexture gridDraw_;
-        // Program, uses instancing;
-        // called to draw all textured objects
-        DrawInstancedWithTexture mainDraw_;
+        // Worker threads for the ball updates and matrices
+        std::shared_ptr<sim::JobSystem> jobs_;
+        // Balls and their controls
+        std::shared_ptr<sim::Simulation> sim_;
+        // Ball model matrices, grouped by skin; rebuilt every frame by the
+        // job threads, uploaded from this one
+        std::vector<float> ballMatrices_;
+        // Nanoseconds per ball and tick
+        double ballUpdateTime_;
+        // Time spent in simulation steps this frame, in seconds
+        double stepTime_;
+        // Wall bounce particles; null while disabled
+        std::shared_ptr<render::ParticleSystem> particles_;
+        // Particle status
+        bool particlesEnabled_;
+        // Particles per bounce
+        unsigned particleBurst_;
+        // Wall bounces of this frame's ticks, emitted once per frame
+        std::vector<sim::wall_hit> frameHits_;
+        // Time since the last frame, in seconds
+        double frameTime_;
+
+        // Programs, use instancing;
+        // one variant per feature set drawn
+        DrawInstancedVariants draws_;
 
         // Map item
         std::shared_ptr<render::Square>     grassTile_;
@@ -402,13 +475,18 @@ namespace {
         // Map item
         std::shared_ptr<render::Box>        wallObject_;
 
-        // Box skins
-        std::vector<unsigned> textureHandles_;
-
         // Dimension
         float cageWidth_;
         // Dimension
         float cageLength_;
+        // Cage drawn; follows the simulation's (see update_cage())
+        sim::cage_shape cage_;
+        // Instances held by wallObject_
+        std::vector<float> wallCoords_;
+        // Instances held by grassTile_
+        std::vector<float> grassCoords_;
+        // Instances held by dryGrassTile_
+        std::vector<float> dryGrassCoords_;
 
         // Color of background
         calc::vec4f backgroundColor_;
@@ -416,14 +494,36 @@ namespace {
         bool gridEnabled_;
         // Color of grid lines
         calc::vec4f gridColor_;
+        // Fog status
+        bool fogEnabled_;
+
+        // Time not yet simulated, in seconds
+        double accumulator_;
+        // Performance counter at the last frame
+        Uint64 lastTime_;
+
+        // Controls recorded or replayed
+        sim::ControlLog log_;
+        // Recording status
+        bool recording_;
+        // Last control of each command and axis; reapplied at the start of recordings
+        std::map<unsigned, sim::control> settings_;
     };
 
     /*! ctor.
      */
     Runner::Runner(SDL_Window* window, int screenWidth, int screenHeight) : window_(window)
+                                                                          , ballUpdateTime_(0.0)
+                                                                          , stepTime_(0.0)
+                                                                          , particlesEnabled_(true)
+                                                                          , particleBurst_(DEFAULT_PARTICLE_BURST)
+                                                                          , frameTime_(0.0)
                                                                           , backgroundColor_(0.0, 0.0, 0.0, 1.0)
                                                                           , gridEnabled_(true)
                                                                           , gridColor_(0.0, 0.0, 0.0, 1.0)
+                                                                          , fogEnabled_(false)
+                                                                          , accumulator_(0.0)
+                                                                          , recording_(false)
     {
         // Init camera defaults
         static float xPos = 0;
@@ -443,18 +543,18 @@ namespace {
 
         // Load boxes
         unsigned boxTAO1[] = {
-            render::load_texture_from_data(brick_wall_png, brick_wall_png_len, false),
-            render::load_texture_from_data(awesome_face_png, awesome_face_png_len, true)
+            render::register_texture("brick-wall.png", false),
+            render::register_texture("awesome-face.png", true)
         };
 
         unsigned boxTAO2[] = {
             boxTAO1[0],
-            render::load_texture_from_data(shocked_face_png, shocked_face_png_len, true)
+            render::register_texture("shocked-face.png", true)
         };
 
         unsigned boxTAO3[] = {
             boxTAO1[0],
-            render::load_texture_from_data(incredulous_face_png, incredulous_face_png_len, true)
+            render::register_texture("incredulous-face.png", true)
         };
 
         unsigned wallTAO[] = {
@@ -462,27 +562,21 @@ namespace {
             boxTAO1[0],
         };
 
-        textureHandles_.push_back(render::load_texture_from_data(awesome_face_png,
-                                                                 awesome_face_png_len,
-                                                                 true,
-                                                                 false));
-        textureHandles_.push_back(render::load_texture_from_data(shocked_face_png,
-                                                                 shocked_face_png_len,
-                                                                 true,
-                                                                 false));
-        textureHandles_.push_back(render::load_texture_from_data(incredulous_face_png,
-                                                                 incredulous_face_png_len,
-                                                                 true,
-                                                                 false));
+        ballObject_[0] = std::make_shared<render::Box>(boxTAO1, (sizeof(boxTAO1) / sizeof(unsigned)), sim::MAX_BALLS);
+
+        ballObject_[1] = std::make_shared<render::Box>(boxTAO2, (sizeof(boxTAO2) / sizeof(unsigned)), sim::MAX_BALLS);
 
-        ballObject_[0] = std::make_shared<render::Box>(boxTAO1, (sizeof(boxTAO1) / sizeof(unsigned)), 1);
-        ballObject_[0]->push_back(calc::mat4f::identity());
+        ballObject_[2] = std::make_shared<render::Box>(boxTAO3, (sizeof(boxTAO3) / sizeof(unsigned)), sim::MAX_BALLS);
 
-        ballObject_[1] = std::make_shared<render::Box>(boxTAO2, (sizeof(boxTAO2) / sizeof(unsigned)), 1);
-        ballObject_[1]->push_back(calc::mat4f::identity());
+        if (particlesEnabled_) {
+            reserve_particles();
+        }
 
-        ballObject_[2] = std::make_shared<render::Box>(boxTAO3, (sizeof(boxTAO3) / sizeof(unsigned)), 1);
-        ballObject_[2]->push_back(calc::mat4f::identity());
+        // Decode box skins while the programs compile
+        render::request_texture(boxTAO1[0]);
+        render::request_texture(boxTAO1[1]);
+        render::request_texture(boxTAO2[1]);
+        render::request_texture(boxTAO3[1]);
 
         // Load map...
         static float cageWidth = 30;
@@ -494,14 +588,32 @@ namespace {
         float gridWidth = 2 * cageWidth;
         float gridLength = 2 * cageLength;
 
+        // No cage drawn yet; the first frame builds it
+        const sim::cage_shape none = { 0, 0, 0 };
+        cage_ = none;
+
+        // Load balls; one to start with
+        jobs_ = std::make_shared<sim::JobSystem>();
+        reset_simulation(BALL_SEED);
+        set_control(sim::BALL_COUNT, 0, 1);
+        set_control(sim::TICK_RATE, 0, sim::Simulation::DEFAULT_TICK_RATE);
+
         // Load wall map objects
-        wallObject_ = load_wall(cageWidth, cageLength, wallTAO, sizeof(wallTAO) / sizeof(unsigned));
+        wallObject_ = load_wall(wallTAO, sizeof(wallTAO) / sizeof(unsigned), MAX_WALL_BOXES);
         // Load grid tiles
         gridTile_ = load_grid(gridWidth, gridLength);
         // Load fresh grass tiles (inside-cage tiles)
-        grassTile_ = load_fresh_grass(cageWidth, cageLength);
+        grassTile_ = load_fresh_grass();
         // Load dry grass tiles (outside-cage tiles)
-        dryGrassTile_ = load_dry_grass(gridWidth, gridLength, cageWidth, cageLength);
+        dryGrassTile_ = load_dry_grass();
+        update_cage();
+
+        // Submit the program variants drawn every frame;
+        // they compile while textures decode
+        submit_programs(0);
+
+        // Simulation starts now
+        lastTime_ = SDL_GetPerformanceCounter();
     }
 
     /*! Run loop
@@ -533,6 +645,7 @@ namespace {
             }
         }
 
+        step();
         render();
     }
 
@@ -555,11 +668,304 @@ namespace {
         }
     }
 
+    /*! @set
+     */
+    void Runner::enable_fog(bool state)
+    {
+        fogEnabled_ = state;
+
+        // Submit the fog variants; drawn once compiled
+        if (fogEnabled_) {
+            submit_programs(render::FOG);
+        }
+    }
+
+    /*! Enables wall bounce particles
+     */
+    void Runner::enable_particles(bool state)
+    {
+        particlesEnabled_ = state;
+
+        // Nothing left to update or draw; the buffers go with them
+        if (particlesEnabled_) {
+            reserve_particles();
+        } else {
+            particles_.reset();
+            frameHits_.clear();
+        }
+    }
+
+    /*! Sets the # of particles per bounce
+     */
+    void Runner::set_particle_burst(unsigned size)
+    {
+        particleBurst_ = size;
+
+        if (particles_) {
+            reserve_particles();
+        }
+    }
+
+    /*! Helper
+     *! Allocates or grows the particle system
+     */
+    void Runner::reserve_particles()
+    {
+        // Room for MAX_BURSTS bursts per frame; grown in powers of two, so
+        // dragging the burst size up rebuilds the buffers a few times only
+        const unsigned needed = particleBurst_ * render::ParticleSystem::MAX_BURSTS;
+        unsigned capacity = DEFAULT_PARTICLE_BURST * render::ParticleSystem::MAX_BURSTS;
+        while (capacity < needed)
+            capacity *= 2;
+
+        // Growing drops the live particles
+        if (!particles_ || particles_->get_capacity() < capacity) {
+            particles_ = std::make_shared<render::ParticleSystem>(capacity);
+        }
+
+        particles_->set_burst_size(particleBurst_);
+    }
+
+    /*! Helper
+     *! Submits the program variants drawn by the scene, with extra features
+     */
+    void Runner::submit_programs(unsigned features)
+    {
+        // Vertex arrays drawn with each variant, checked once it has linked
+        draws_.get(GRID_DRAW | features).expect_vertex_array(gridTile_->get_vertex_array());
+
+        const render::Drawable* objects[] = {
+            wallObject_.get(),
+            ballObject_[0].get(),
+            ballObject_[1].get(),
+            ballObject_[2].get()
+        };
+        for (unsigned i = 0; i != sizeof(objects) / sizeof(objects[0]); ++i)
+        {
+            const unsigned key = OBJECT_DRAW | blend_feature(*objects[i]) | features;
+            draws_.get(key).expect_vertex_array(objects[i]->get_vertex_array());
+        }
+
+        const render::Drawable* ground[] = { grassTile_.get(), dryGrassTile_.get() };
+        for (unsigned i = 0; i != sizeof(ground) / sizeof(ground[0]); ++i)
+        {
+            const unsigned key = GROUND_DRAW | blend_feature(*ground[i]) | features;
+            draws_.get(key).expect_vertex_array(ground[i]->get_vertex_array());
+        }
+    }
+
+    /*! Helper
+     *! Draws drawable with the variant for features and its textures
+     */
+    void Runner::draw(const render::Drawable& drawable, unsigned features)
+    {
+        use_program(features | blend_feature(drawable));
+        drawable.draw();
+    }
+
+    /*! Helper
+     *! Uses the program variant with features (plus fog, if enabled)
+     */
+    DrawInstanced& Runner::use_program(unsigned features)
+    {
+        DrawInstanced* program = &draws_.get(features);
+
+        // Draw without fog until its variant has compiled
+        if (fogEnabled_)
+        {
+            DrawInstanced& fogged = draws_.get(features | render::FOG);
+            if (fogged.is_ready()) {
+                program = &fogged;
+            }
+        }
+
+        program->use();
+
+        if (program->get_features() & render::FOG)
+        {
+            // Fog the far side of the cage, faded to the background
+            const float distance = std::abs(camera_->get_position()[2]);
+            program->set_fog(backgroundColor_, distance - 15, distance + 30);
+        }
+
+        return *program;
+    }
+
+    /*! Helper
+     *! Runs the simulation ticks due since the last frame
+     */
+    void Runner::step()
+    {
+        const Uint64 now = SDL_GetPerformanceCounter();
+        frameTime_ = (double)(now - lastTime_) / SDL_GetPerformanceFrequency();
+        accumulator_ += frameTime_;
+        lastTime_ = now;
+
+        stepTime_ = 0.0;
+        unsigned ticks = 0;
+        while (accumulator_ >= sim_->get_tick_duration())
+        {
+            // Fell behind (slow frames, hidden tab); drop the backlog
+            if (ticks == MAX_TICKS_PER_FRAME) {
+                accumulator_ = std::fmod(accumulator_, sim_->get_tick_duration());
+                break;
+            }
+
+            accumulator_ -= sim_->get_tick_duration();
+            update();
+            ++ticks;
+        }
+
+        if (particles_) {
+            emit_particles();
+        }
+
+        // Simulation steps alone; collecting and emitting particles is not ball update time
+        if (ticks != 0) {
+            ballUpdateTime_ = stepTime_ * 1e9 / ((double)ticks * std::max(get_balls().size(), 1u));
+        }
+    }
+
+    /*! Helper
+     *! Advances the simulation by one tick
+     */
+    void Runner::update()
+    {
+        const bool replaying = sim_->is_playing();
+
+        const Uint64 start = SDL_GetPerformanceCounter();
+        sim_->step();
+        stepTime_ += (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+        // Emitted once the frame's ticks are done (see emit_particles())
+        if (particlesEnabled_)
+        {
+            const std::vector<sim::wall_hit>& hits = get_balls().get_wall_hits();
+            frameHits_.insert(frameHits_.end(), hits.begin(), hits.end());
+        }
+
+        if (replaying && !sim_->is_playing())
+        {
+            // Compare against headless runs of the same log (see tools/replay.cpp)
+            ::printf("Replay done after %u ticks, checksum %016llx\n", sim_->get_tick(), get_balls().get_checksum());
+        }
+    }
+
+    /*! Helper
+     *! Queues particle bursts at the wall bounces of this frame's ticks
+     */
+    void Runner::emit_particles()
+    {
+        const std::vector<sim::wall_hit>& hits = frameHits_;
+        const unsigned bursts = particles_->get_free_bursts();
+
+        // More bounces than bursts this frame; spread them over all ticks and balls
+        if (!hits.empty() && bursts != 0)
+        {
+            const ::size_t stride = (hits.size() + bursts - 1) / bursts;
+            for (::size_t i = 0; i < hits.size(); i += stride)
+                particles_->emit(hits[i].x, hits[i].y, hits[i].z, hits[i].nx, hits[i].ny, hits[i].speed);
+        }
+
+        frameHits_.clear();
+    }
+
+    /*! Applies a simulation control
+     */
+    void Runner::set_control(unsigned command, unsigned axis, float value)
+    {
+        if (sim_->is_playing()) {
+            return;
+        }
+
+        sim_->apply(command, axis, value);
+
+        const sim::control c = { 0, command, axis, value };
+        settings_[command << 4 | axis] = c;
+    }
+
+    /*! Starts recording
+     */
+    void Runner::start_recording()
+    {
+        reset_simulation(BALL_SEED);
+        log_.clear(BALL_SEED);
+        sim_->record(&log_);
+        recording_ = true;
+
+        // Bring the new run to where the controls are
+        const std::map<unsigned, sim::control> settings = settings_;
+        for (std::map<unsigned, sim::control>::const_iterator it = settings.begin(); it != settings.end(); ++it)
+            set_control(it->second.command, it->second.axis, it->second.value);
+    }
+
+    /*! Stops recording
+     */
+    bool Runner::stop_recording(const char* path)
+    {
+        if (!recording_) {
+            return false;
+        }
+
+        recording_ = false;
+        sim_->record(nullptr);
+        log_.set_length(sim_->get_tick());
+        return log_.save(path);
+    }
+
+    /*! Starts replaying
+     */
+    bool Runner::start_replay(const char* path)
+    {
+        if (!log_.load(path)) {
+            return false;
+        }
+
+        reset_simulation(log_.get_seed());
+        sim_->play(log_);
+        recording_ = false;
+        return true;
+    }
+
+    /*! Helper
+     *! Rebuilds the cage instances
+     */
+    void Runner::update_cage()
+    {
+        const sim::cage_shape& cage = get_balls().get_cage();
+        if (cage.width == cage_.width && cage.length == cage_.length && cage.sides == cage_.sides) {
+            return;
+        }
+
+        cage_ = cage;
+
+        // A few hundred matrices at most, and only the changed ones uploaded;
+        // the grid is sized by uniforms
+        const int width = cage.width;
+        const int length = cage.length;
+        update_instances(*wallObject_, wallCoords_, sim::build_wall(cage));
+        update_instances(*grassTile_, grassCoords_, build_fresh_grass(width, length));
+        update_instances(*dryGrassTile_, dryGrassCoords_, build_dry_grass(2 * width, 2 * length, width, length));
+        gridTile_->resize(grid_squares(2 * width), grid_squares(2 * length));
+    }
+
+    /*! Helper
+     *! Restarts the simulation
+     */
+    void Runner::reset_simulation(unsigned seed)
+    {
+        sim_ = std::make_shared<sim::Simulation>(cageWidth_, cageLength_, seed, jobs_.get());
+        accumulator_ = 0;
+    }
+
     /*! Helper
      *! Renders the scene
      */
     void Runner::render()
     {
+        // Upload textures decoded since the last frame, evict unused ones
+        render::update_textures();
+
         // Clear it
         glClearColor(backgroundColor_[0],
                      backgroundColor_[1],
@@ -567,59 +973,68 @@ namespace {
                      1.0);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        const calc::mat4f& lookAt     = camera_->get_device_look_at();
-        const calc::mat4f& projection = camera_->get_device_projection();
+        // Follow cage changes of the last ticks (controls, replays)
+        update_cage();
+
+        // Camera matrices are in the scene uniform block, updated by Camera::update()
+
         // Maybe draw the grid
         if (gridEnabled_)
         {
-            gridDraw_.use();
-            gridDraw_.set_color(gridColor_);
-            gridDraw_.set_scene(lookAt, projection);
+            DrawInstanced& gridDraw = use_program(GRID_DRAW);
+            gridDraw.set_color(gridColor_);
+            gridDraw.set_grid(gridTile_->get_columns(), gridTile_->get_rows());
             gridTile_->draw();
         }
 
         // Draw the wall
-        mainDraw_.use();
-        mainDraw_.set_scene(lookAt, projection);
-        wallObject_->draw();
+        draw(*wallObject_, OBJECT_DRAW);
 
         // Draw the grass inside the cage
-        grassTile_->draw();
+        draw(*grassTile_, GROUND_DRAW);
         // Draw the grass outside the cage
-        dryGrassTile_->draw();
-
-        // Draw the box
-        calc::vec3f& direction = ballData_.direction;
-        calc::vec3f& speed = ballData_.speed;
-        calc::mat4f& translation = ballData_.translation;
-
-        translation[2][3] = -1.0;
-        float x = (translation[0][3] += speed[0] * direction[0]);
-        float y = (translation[1][3] += speed[1] * direction[1]);
-
-        // Bounce back on wall hit
-        float hitOffset = 3.0;
-        if (x < +hitOffset - (cageWidth_ / 2) ||
-            x > -hitOffset + (cageWidth_ / 2)) {
-            direction[0] *= -1;
-        }
-
-        if (y < +hitOffset - (cageLength_ / 2) ||
-            y > -hitOffset + (cageLength_ / 2)) {
-            direction[1] *= -1;
-        }
-
-        const calc::vec3f turnRate = ballData_.turnRate * calc::radians(SDL_GetTicks() / 10.0);
-        const calc::mat4f boxMat = calc::transpose(translation
-                                                   * calc::rotate_4x(turnRate[0])
-                                                   * calc::rotate_4y(turnRate[1])
-                                                   * calc::rotate_4z(turnRate[2]));
-        // Do the draw call
-        render::Box& refobject = *ballObject_[ballData_.selectedSkin];
-        refobject.modify(calc::data(boxMat), 0);
-        refobject.draw();
+        draw(*dryGrassTile_, GROUND_DRAW);
+
+        // Draw the balls, in between the last two ticks; one instanced draw per skin.
+        // The accumulator may hold more than a tick (a TICK_RATE control shortens
+        // it before update() drains it); never draw past the last tick
+        const float alpha = std::min(1.0f, (float)(accumulator_ / sim_->get_tick_duration()));
+
+        unsigned counts[sim::BallSystem::SKIN_COUNT];
+        unsigned changed[2 * sim::BallSystem::SKIN_COUNT];
+        ballMatrices_.resize(get_balls().size() * 16);
+        get_balls().build_matrices(alpha, ballMatrices_.data(), counts, changed);
+
+        // Only matrices of balls awake since the last frame are uploaded
+        const float* mats = ballMatrices_.data();
+        for (unsigned i = 0; i != sim::BallSystem::SKIN_COUNT; mats += 16 * counts[i++])
+        {
+            if (counts[i] == 0) {
+                continue;
+            }
+
+            const unsigned first = changed[2 * i];
+            const unsigned last = changed[2 * i + 1];
+
+            render::Box& refobject = *ballObject_[i];
+            if (first == 0 && last == counts[i])
+                refobject.reset(mats, counts[i]);
+            else if (first != last)
+                refobject.modify_range(mats + 16 * first, first, last - first);
+
+            draw(refobject, OBJECT_DRAW);
+        }
+
+        // Particles last; they blend over everything else
+        if (particles_)
+        {
+            particles_->update(std::min(frameTime_, (double)MAX_PARTICLE_STEP));
+            particles_->draw();
+        }
+
         // Update screen & return
         SDL_GL_SwapWindow(window_);
+        render::state::end_frame();
     }
 }
 
@@ -638,13 +1053,157 @@ namespace {
 
 extern "C"
 {
+    EMSCRIPTEN_KEEPALIVE
+    int get_issued_gl_calls()
+    {
+        // Binds and uniform writes issued during the last frame
+        return render::state::get_frame_counters().issued;
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    int get_elided_gl_calls()
+    {
+        // Binds and uniform writes skipped by the state cache during the last frame
+        return render::state::get_frame_counters().elided;
+    }
+
+#ifdef BOUNCEGL_DEV
+    EMSCRIPTEN_KEEPALIVE
+    int reload_shaders()
+    {
+        // Development builds; shader files are re-read from the virtual
+        // file system (see tools/dev_reload.js)
+        return Program::reload_all();
+    }
+#endif
+
+    EMSCRIPTEN_KEEPALIVE
+    int get_ball_count() {
+        return (runner->get_balls()).size();
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    double get_ball_update_time()
+    {
+        // Nanoseconds per ball and tick, over the last frame that ran ticks
+        return runner->get_ball_update_time();
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    int get_job_threads()
+    {
+        // Threads sharing the ball updates, including the main one
+        return (runner->get_jobs()).get_thread_count();
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    int get_ball_contacts()
+    {
+        // Ball pairs that bounced off each other in the last tick
+        return (runner->get_balls()).get_contacts();
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    int get_particle_slots()
+    {
+        // Particle slots in use; live particles are among them
+        return runner->get_particle_slots();
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    int get_active_balls()
+    {
+        // Balls that moved or turned in the last tick
+        return (runner->get_balls()).get_active();
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    int get_sleeping_balls()
+    {
+        // Balls at rest; their matrices are neither rebuilt nor uploaded
+        const sim::BallSystem& balls = runner->get_balls();
+        return balls.size() - balls.get_active();
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    void set_ball_count(int value)
+    {
+        // Just in case
+        // Clamp value
+        value = std::min(value, (int)sim::MAX_BALLS);
+        value = std::max(value, 1);
+
+        runner->set_control(sim::BALL_COUNT, 0, value);
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    void set_cage_size(int width, int length)
+    {
+        // Just in case
+        // Clamp value
+        width = std::min(std::max(width, (int)sim::MIN_CAGE_SIZE), (int)sim::MAX_CAGE_SIZE);
+        length = std::min(std::max(length, (int)sim::MIN_CAGE_SIZE), (int)sim::MAX_CAGE_SIZE);
+
+        // Whole wall boxes either side of the center (see sim::build_wall())
+        width -= width % 6;
+        length -= length % 6;
+
+        runner->set_control(sim::CAGE, 0, width);
+        runner->set_control(sim::CAGE, 1, length);
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    void set_cage_sides(int value)
+    {
+        // Just in case
+        // Clamp value
+        value = std::min(value, (int)sim::MAX_CAGE_SIDES);
+        value = std::max(value, (int)sim::MIN_CAGE_SIDES);
+
+        runner->set_control(sim::CAGE, 2, value);
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    void start_recording()
+    {
+        // Restarts the simulation; see stop_recording()
+        runner->start_recording();
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    int stop_recording(const char* path)
+    {
+        // Saved to the virtual file system; read it back with Module.FS.readFile(path)
+        return runner->stop_recording(path);
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    int start_replay(const char* path)
+    {
+        // Controls are ignored until the replay is done
+        return runner->start_replay(path);
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    int get_replay_state() {
+        return runner->is_replaying();
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    void set_texture_budget(int value)
+    {
+        // Kilobytes, 0 for no budget
+        value = std::max(value, 0);
+        render::set_texture_budget((unsigned long)value * 1024);
+    }
+
     EMSCRIPTEN_KEEPALIVE
     void set_box_skin(int value)
     {
         // Validate before setting value
         if (value <= 3 &&
             value >= 1) {
-            (runner->get_ball()).selectedSkin = value - 1;
+            runner->set_control(sim::SKIN, 0, value - 1);
         }
     }
 }
@@ -659,7 +1218,8 @@ extern "C"
         value = std::min(value, 20);
         value = std::max(value, 0);
 
-        (runner->get_ball()).speed[0] = (float)value / 100.0;
+        // Units per second; the scale of the former per-frame steps at 60 Hz
+        runner->set_control(sim::SPEED, 0, (float)value * 60 / 100.0);
     }
 
     EMSCRIPTEN_KEEPALIVE
@@ -670,7 +1230,19 @@ extern "C"
         value = std::min(value, 20);
         value = std::max(value, 0);
 
-        (runner->get_ball()).speed[1] = (float)value / 100.0;
+        // Units per second; the scale of the former per-frame steps at 60 Hz
+        runner->set_control(sim::SPEED, 1, (float)value * 60 / 100.0);
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    void set_tick_rate(int value)
+    {
+        // Just in case
+        // Clamp value
+        value = std::min(value, (int)sim::MAX_TICK_RATE);
+        value = std::max(value, (int)sim::MIN_TICK_RATE);
+
+        runner->set_control(sim::TICK_RATE, 0, value);
     }
 
     EMSCRIPTEN_KEEPALIVE
@@ -681,7 +1253,8 @@ extern "C"
         value = std::min(value, 25);
         value = std::max(value, 0);
 
-        (runner->get_ball()).turnRate[0] = (float)value / 10.0;
+        // 1 turns 100 degrees per second
+        runner->set_control(sim::TURN_RATE, 0, (float)value / 10.0 * calc::radians(100.0));
     }
 
     EMSCRIPTEN_KEEPALIVE
@@ -692,7 +1265,8 @@ extern "C"
         value = std::min(value, 25);
         value = std::max(value, 0);
 
-        (runner->get_ball()).turnRate[1] = (float)value / 10.0;
+        // 1 turns 100 degrees per second
+        runner->set_control(sim::TURN_RATE, 1, (float)value / 10.0 * calc::radians(100.0));
     }
 
     EMSCRIPTEN_KEEPALIVE
@@ -703,7 +1277,8 @@ extern "C"
         value = std::min(value, 25);
         value = std::max(value, 0);
 
-        (runner->get_ball()).turnRate[2] = (float)value / 10.0;
+        // 1 turns 100 degrees per second
+        runner->set_control(sim::TURN_RATE, 2, (float)value / 10.0 * calc::radians(100.0));
     }
 
     EMSCRIPTEN_KEEPALIVE
@@ -841,6 +1416,36 @@ extern "C"
     {
         runner->enable_grid(state);
     }
+
+    EMSCRIPTEN_KEEPALIVE
+    void set_fog_state(bool state)
+    {
+        // The fog variants compile in the background on first enable
+        runner->enable_fog(state);
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    void set_collision_state(bool state)
+    {
+        runner->set_control(sim::COLLISIONS, 0, state);
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    void set_particle_state(bool state)
+    {
+        runner->enable_particles(state);
+    }
+
+    EMSCRIPTEN_KEEPALIVE
+    void set_particle_burst(int value)
+    {
+        // Just in case
+        // Clamp value
+        value = std::min(value, (int)MAX_PARTICLE_BURST);
+        value = std::max(value, 1);
+
+        runner->set_particle_burst(value);
+    }
 }
 
 extern "C"
@@ -848,16 +1453,16 @@ extern "C"
     EMSCRIPTEN_KEEPALIVE
     void reset_speed()
     {
-        (runner->get_ball()).speed[0] = 0;
-        (runner->get_ball()).speed[1] = 0;
+        runner->set_control(sim::SPEED, 0, 0);
+        runner->set_control(sim::SPEED, 1, 0);
     }
 
     EMSCRIPTEN_KEEPALIVE
     void reset_turn_rate()
     {
-        (runner->get_ball()).turnRate[0] = 0;
-        (runner->get_ball()).turnRate[1] = 0;
-        (runner->get_ball()).turnRate[2] = 0;
+        runner->set_control(sim::TURN_RATE, 0, 0);
+        runner->set_control(sim::TURN_RATE, 1, 0);
+        runner->set_control(sim::TURN_RATE, 2, 0);
     }
 
     EMSCRIPTEN_KEEPALIVE
@@ -896,6 +1501,10 @@ int main(void)
     glEnable(GL_DEPTH_TEST);
     glViewport(0, 0, screenWidth, screenHeight);
 
+    // Textures are decoded from the asset pack once it arrives;
+    // placeholders are drawn until then
+    render::fetch_asset_pack("assets.pack");
+
     // Enter run loop
     runner = std::make_shared<Runner>(window, screenWidth, screenHeight);
 
@@ -0,0 +1,90 @@
+#include "particle_program.hpp"
+#include "uniform_buffer.hpp"
+
+UpdateParticles::UpdateParticles(unsigned capacity, unsigned maxBursts)
+{
+    // Uniforms are resolved by on_link()
+    const uniform unresolved = { -1, -1 };
+    emitFirst_ = emitCount_ = burstSize_ = seed_ = dt_ = unresolved;
+
+    Program::define("POSITION_ATTRIB", render::PARTICLE_POSITION_ATTRIB);
+    Program::define("VELOCITY_ATTRIB", render::PARTICLE_VELOCITY_ATTRIB);
+    Program::define("CAPACITY", capacity);
+    Program::define("MAX_BURSTS", maxBursts);
+
+    const vertex_shader sh1 = {
+#include "shaders/update_particles.vs"
+        , "shaders/update_particles.vs"
+    };
+
+    const fragment_shader sh2 = {
+#include "shaders/update_particles.fs"
+        , "shaders/update_particles.fs"
+    };
+
+    Program::add_shader(sh1, sh2);
+
+    // Same layout as the particle buffers read
+    const char* varyings[] = { "v_position", "v_velocity" };
+    Program::capture_varyings(varyings, sizeof(varyings) / sizeof(varyings[0]));
+
+    // Submit for linking; finished on first use
+    Program::link();
+}
+
+void UpdateParticles::on_link()
+{
+    Program::bind_uniform_block("Bursts", render::PARTICLE_BLOCK);
+
+    emitFirst_ = Program::get_uniform("emitFirst");
+    emitCount_ = Program::get_uniform("emitCount");
+    burstSize_ = Program::get_uniform("burstSize");
+    seed_ = Program::get_uniform("seed");
+    dt_ = Program::get_uniform("dt");
+}
+
+void UpdateParticles::set_emission(unsigned first, unsigned count, unsigned burstSize)
+{
+    Program::set_value(emitFirst_, int(first));
+    Program::set_value(emitCount_, int(count));
+    Program::set_value(burstSize_, int(burstSize));
+}
+
+void UpdateParticles::set_step(float dt, unsigned seed)
+{
+    Program::set_value(dt_, dt);
+    Program::set_value(seed_, int(seed));
+}
+
+DrawParticles::DrawParticles()
+{
+    Program::define("CORNER_ATTRIB", render::PARTICLE_CORNER_ATTRIB);
+    Program::define("POSITION_ATTRIB", render::PARTICLE_POSITION_ATTRIB);
+    Program::define("VELOCITY_ATTRIB", render::PARTICLE_VELOCITY_ATTRIB);
+
+    const vertex_shader sh1 = {
+#include "shaders/draw_particles.vs"
+        , "shaders/draw_particles.vs"
+    };
+
+    const fragment_shader sh2 = {
+#include "shaders/draw_particles.fs"
+        , "shaders/draw_particles.fs"
+    };
+
+    Program::add_shader(sh1, sh2);
+
+    // Submit for linking; finished on first use
+    Program::link();
+}
+
+void DrawParticles::on_link()
+{
+    // Camera matrices come from the shared scene block
+    Program::bind_uniform_block("Scene", render::SCENE_BLOCK);
+
+    // Sparks; alpha fades with age
+    const float color[] = { 1.0f, 0.75f, 0.3f, 1.0f };
+    Program::set_value_vec4("color", color);
+    Program::set_value("size", 0.08f);
+}
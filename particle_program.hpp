@@ -0,0 +1,66 @@
+#pragma once
+
+#ifndef PARTICLE_PROGRAM_HPP
+#define PARTICLE_PROGRAM_HPP
+
+#include "program.hpp"
+
+namespace render {
+
+    /// Vertex attribute locations of the particle buffers and quad
+    /// (see ParticleSystem)
+    enum particle_attrib {
+        PARTICLE_CORNER_ATTRIB   = 0, ///> vec2 quad corner, in [-1, 1]
+        PARTICLE_POSITION_ATTRIB = 1, ///> vec4 position (xyz), age
+        PARTICLE_VELOCITY_ATTRIB = 2  ///> vec4 velocity (xyz), lifetime
+    };
+}
+
+//! class UpdateParticles
+/*! Program advancing every particle by one step; vertex shader only, its
+ *! outputs captured by transform feedback into the other particle buffer
+ */
+class UpdateParticles : public Program {
+public:
+    /// ctor.
+    /// @param capacity the # of particle slots
+    /// @param maxBursts the # of bursts emitted per step at most
+    UpdateParticles(unsigned capacity, unsigned maxBursts);
+    /// @param first first slot emitted into
+    /// @param count the # of slots emitted into, wrapping around
+    /// @param burstSize the # of slots per burst
+    void set_emission(unsigned first, unsigned count, unsigned burstSize);
+    /// @param dt step duration, in seconds
+    /// @param seed randomizes emitted particles
+    void set_step(float dt, unsigned seed);
+
+protected:
+
+    /// @override
+    void on_link();
+
+private:
+
+    // Uniform handles
+    uniform emitFirst_;
+    uniform emitCount_;
+    uniform burstSize_;
+    uniform seed_;
+    uniform dt_;
+};
+
+//! class DrawParticles
+/*! Program drawing particles as camera-facing quads, one instance each
+ */
+class DrawParticles : public Program {
+public:
+    /// ctor.
+    DrawParticles();
+
+protected:
+
+    /// @override
+    void on_link();
+};
+
+#endif
@@ -0,0 +1,218 @@
+#include <algorithm>
+
+#include <GLES3/gl3.h>
+#include <EGL/egl.h>
+
+#include "gl_state.hpp"
+#include "particle_system.hpp"
+
+namespace {
+
+    // Particle state; position and age, then velocity and lifetime
+    const unsigned PARTICLE_FLOATS = 8;
+    // Burst state; origin and speed, then normal
+    const unsigned BURST_FLOATS = 8;
+
+    // Quad corners, drawn as a triangle strip
+    static const float CORNERS__[] = {
+        -1.0f, -1.0f,
+        +1.0f, -1.0f,
+        -1.0f, +1.0f,
+        +1.0f, +1.0f
+    };
+
+    // Helper
+    // Sets up the particle attributes, sourced from the array buffer
+    // currently bound; the vertex array must be bound
+    void enable_particle_attribs(unsigned divisor)
+    {
+        static const unsigned nbytes = PARTICLE_FLOATS * sizeof(float);
+
+        glEnableVertexAttribArray(render::PARTICLE_POSITION_ATTRIB);
+        glVertexAttribPointer(render::PARTICLE_POSITION_ATTRIB, 4, GL_FLOAT, GL_FALSE, nbytes, (void*)(0));
+        glVertexAttribDivisor(render::PARTICLE_POSITION_ATTRIB, divisor);
+
+        glEnableVertexAttribArray(render::PARTICLE_VELOCITY_ATTRIB);
+        glVertexAttribPointer(render::PARTICLE_VELOCITY_ATTRIB, 4, GL_FLOAT, GL_FALSE, nbytes, (void*)(4 * sizeof(float)));
+        glVertexAttribDivisor(render::PARTICLE_VELOCITY_ATTRIB, divisor);
+    }
+}
+
+const unsigned render::ParticleSystem::MAX_BURSTS;
+
+render::ParticleSystem::~ParticleSystem()
+{
+    // The names may be reused by the next system created
+    for (unsigned i = 0; i != 2; ++i)
+    {
+        render::state::forget_vertex_array(drawArrays_[i]);
+        render::state::forget_vertex_array(updateArrays_[i]);
+        render::state::forget_buffer(buffers_[i]);
+    }
+    render::state::forget_buffer(quad_);
+
+    glDeleteVertexArrays(2, drawArrays_);
+    glDeleteVertexArrays(2, updateArrays_);
+    glDeleteTransformFeedbacks(2, feedback_);
+    glDeleteBuffers(2, buffers_);
+    glDeleteBuffers(1, &quad_);
+}
+
+render::ParticleSystem::ParticleSystem(unsigned capacity) : updateProgram_(capacity, MAX_BURSTS)
+                                                          , burstBlock_(MAX_BURSTS * BURST_FLOATS * sizeof(float), PARTICLE_BLOCK)
+                                                          , current_(0)
+                                                          , capacity_(capacity)
+                                                          , size_(0)
+                                                          , next_(0)
+                                                          , burstSize_(64)
+                                                          , seed_(0)
+{
+    bursts_.reserve(MAX_BURSTS * BURST_FLOATS);
+
+    glGenBuffers(1, &quad_);
+    render::state::bind_array_buffer(quad_);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(CORNERS__), CORNERS__, GL_STATIC_DRAW);
+
+    // Slots are written by transform feedback before they are first read
+    glGenBuffers(2, buffers_);
+    for (unsigned i = 0; i != 2; ++i)
+    {
+        render::state::bind_array_buffer(buffers_[i]);
+        glBufferData(GL_ARRAY_BUFFER, capacity_ * PARTICLE_FLOATS * sizeof(float), nullptr, GL_DYNAMIC_COPY);
+    }
+
+    glGenVertexArrays(2, updateArrays_);
+    glGenVertexArrays(2, drawArrays_);
+    glGenTransformFeedbacks(2, feedback_);
+
+    for (unsigned i = 0; i != 2; ++i)
+    {
+        // Update pass; one vertex per particle
+        render::state::bind_vertex_array(updateArrays_[i]);
+        render::state::bind_array_buffer(buffers_[i]);
+        enable_particle_attribs(0);
+
+        // Draw pass; one quad per particle
+        render::state::bind_vertex_array(drawArrays_[i]);
+        render::state::bind_array_buffer(quad_);
+        glEnableVertexAttribArray(PARTICLE_CORNER_ATTRIB);
+        glVertexAttribPointer(PARTICLE_CORNER_ATTRIB, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)(0));
+
+        render::state::bind_array_buffer(buffers_[i]);
+        enable_particle_attribs(1);
+
+        glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, feedback_[i]);
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, buffers_[i]);
+        // Only the indexed binding is needed; a buffer bound for transform
+        // feedback may not be read at the same time
+        glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, 0);
+    }
+
+    glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+    render::state::bind_array_buffer(0);
+    render::state::bind_vertex_array(0);
+
+    // Checked once linked
+    for (unsigned i = 0; i != 2; ++i)
+    {
+        updateProgram_.expect_vertex_array(updateArrays_[i]);
+        drawProgram_.expect_vertex_array(drawArrays_[i]);
+    }
+}
+
+bool render::ParticleSystem::emit(float x, float y, float z, float nx, float ny, float speed)
+{
+    if (get_free_bursts() == 0) {
+        return false;
+    }
+
+    const float burst[BURST_FLOATS] = { x, y, z, speed, nx, ny, 0, 0 };
+    bursts_.insert(bursts_.end(), burst, burst + BURST_FLOATS);
+    return true;
+}
+
+unsigned render::ParticleSystem::get_free_bursts() const
+{
+    // Bursts in one update never overlap
+    const unsigned max = std::min(MAX_BURSTS, capacity_ / burstSize_);
+    return max - std::min<unsigned>(max, bursts_.size() / BURST_FLOATS);
+}
+
+void render::ParticleSystem::set_burst_size(unsigned size)
+{
+    burstSize_ = std::max(1u, std::min(size, capacity_));
+
+    // Drop what no longer fits
+    bursts_.resize(std::min<unsigned>(bursts_.size(), capacity_ / burstSize_ * BURST_FLOATS));
+}
+
+unsigned render::ParticleSystem::get_burst_size() const {
+    return burstSize_;
+}
+
+unsigned render::ParticleSystem::get_capacity() const {
+    return capacity_;
+}
+
+unsigned render::ParticleSystem::size() const {
+    return size_;
+}
+
+void render::ParticleSystem::clear()
+{
+    bursts_.clear();
+    size_ = next_ = 0;
+}
+
+void render::ParticleSystem::update(float dt)
+{
+    const unsigned emitted = bursts_.size() / BURST_FLOATS * burstSize_;
+    if (emitted != 0) {
+        burstBlock_.update(0, bursts_.data(), bursts_.size() * sizeof(float));
+    }
+
+    // Slots are emitted into in order, so the first size_ ever are in use
+    size_ = std::min(capacity_, size_ + emitted);
+    if (size_ == 0) {
+        return;
+    }
+
+    updateProgram_.use();
+    updateProgram_.set_emission(next_, emitted, burstSize_);
+    updateProgram_.set_step(dt, seed_++);
+
+    render::state::bind_vertex_array(updateArrays_[current_]);
+    glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, feedback_[1 - current_]);
+
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, size_);
+    glEndTransformFeedback();
+    glDisable(GL_RASTERIZER_DISCARD);
+
+    glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+
+    current_ = 1 - current_;
+    next_ = (next_ + emitted) % capacity_;
+    bursts_.clear();
+}
+
+void render::ParticleSystem::draw()
+{
+    if (size_ == 0) {
+        return;
+    }
+
+    drawProgram_.use();
+    render::state::bind_vertex_array(drawArrays_[current_]);
+
+    // Sparks add up; they neither hide nor are hidden by each other
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+    glDepthMask(GL_FALSE);
+
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, size_);
+
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#ifndef PARTICLE_SYSTEM_HPP
+#define PARTICLE_SYSTEM_HPP
+
+#include <vector>
+
+#include "particle_program.hpp"
+#include "uniform_buffer.hpp"
+
+namespace render {
+
+    //! class ParticleSystem
+    /*! Particles simulated and drawn on the GPU; bursts are queued from the
+     *! CPU, then one transform feedback pass per frame advances every
+     *! particle from one buffer into the other (ping-pong), and the result
+     *! is drawn as instanced quads. Slots are reused oldest first
+     */
+    class ParticleSystem {
+    public:
+
+        /// # of bursts emitted per update() at most
+        static const unsigned MAX_BURSTS = 256;
+
+        /// dtor.
+        ~ParticleSystem();
+        /// ctor.
+        /// @param capacity the # of particle slots
+        explicit ParticleSystem(unsigned capacity);
+        /// Queues a burst of particles, emitted by the next update()
+        /// @param x, y, z origin
+        /// @param nx, ny direction particles spray away from; unit length, in the xy plane
+        /// @param speed scales particle speeds, in units per second
+        /// @return false if MAX_BURSTS are queued already (the burst is dropped)
+        bool emit(float x, float y, float z, float nx, float ny, float speed);
+        /// @return the # of bursts that can still be queued before the next update()
+        unsigned get_free_bursts() const;
+        /// @param size the # of particles per burst, [1, capacity]
+        void set_burst_size(unsigned size);
+        /// @return the # of particles per burst
+        unsigned get_burst_size() const;
+        /// @return the # of particle slots
+        unsigned get_capacity() const;
+        /// @return the # of slots emitted into so far; live particles are
+        /// among them, and only they are updated and drawn
+        unsigned size() const;
+        /// Drops every particle and queued burst
+        void clear();
+        /// Emits the queued bursts and advances every particle
+        /// @param dt step duration, in seconds
+        void update(float dt);
+        /// Draws the particles; additive, without depth writes
+        void draw();
+
+    private:
+
+        ParticleSystem(const ParticleSystem&);
+        ParticleSystem& operator=(const ParticleSystem&);
+
+        // Programs
+        UpdateParticles updateProgram_;
+        DrawParticles drawProgram_;
+
+        // Bursts queued; origin and speed, then normal, per burst (see UpdateParticles)
+        std::vector<float> bursts_;
+        // Bursts uniform block
+        UniformBuffer burstBlock_;
+
+        // Particle buffers, read and written in turn
+        unsigned buffers_[2];
+        // Transform feedback objects, writing to buffers_
+        unsigned feedback_[2];
+        // Vertex arrays of the update pass, reading buffers_
+        unsigned updateArrays_[2];
+        // Vertex arrays of the draw pass, reading buffers_ per instance
+        unsigned drawArrays_[2];
+        // Quad corners
+        unsigned quad_;
+        // Buffer holding the current state
+        unsigned current_;
+
+        // Slot count
+        unsigned capacity_;
+        // Slots emitted into so far
+        unsigned size_;
+        // Next slot emitted into
+        unsigned next_;
+        // Particles per burst
+        unsigned burstSize_;
+        // Randomizes each update's bursts
+        unsigned seed_;
+    };
+}
+
+#endif
@@ -1,7 +1,138 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
 #include <GLES3/gl3.h>
 #include <EGL/egl.h>
 
+#include "gl_state.hpp"
 #include "program.hpp"
+#include "program_cache.hpp"
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace {
+
+    // Helper
+    // @return true if program completion can be polled (KHR_parallel_shader_compile)
+    bool has_parallel_compile()
+    {
+        static int supported = -1;
+        if (supported < 0)
+        {
+            const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+            supported = (extensions != nullptr && ::strstr(extensions, "parallel_shader_compile") != nullptr);
+        }
+
+        return supported != 0;
+    }
+
+    // Helper
+    // Submits shader for compiling and attaches it; status is checked by Program::use()
+    // @return shader handle
+    inline int create_shader(const int programHandle, const std::string& text, const int type)
+    {
+        // Build and compile shader program
+        const int shaderHandle = glCreateShader(type);
+
+        const char* src = text.c_str();
+        glShaderSource(shaderHandle, 1, &src, NULL);
+        glCompileShader(shaderHandle);
+
+        glAttachShader(programHandle, shaderHandle);
+        return shaderHandle;
+    }
+
+    // Helper
+    // Writes a uniform value of the given type (see glGetActiveUniform())
+    void write_uniform(int location, unsigned type, const float* value)
+    {
+        const int* ivalue = reinterpret_cast<const int*>(value);
+        switch (type)
+        {
+            case GL_FLOAT:      glUniform1fv(location, 1, value); break;
+            case GL_FLOAT_VEC2: glUniform2fv(location, 1, value); break;
+            case GL_FLOAT_VEC3: glUniform3fv(location, 1, value); break;
+            case GL_FLOAT_VEC4: glUniform4fv(location, 1, value); break;
+            case GL_INT_VEC2:   glUniform2iv(location, 1, ivalue); break;
+            case GL_INT_VEC3:   glUniform3iv(location, 1, ivalue); break;
+            case GL_INT_VEC4:   glUniform4iv(location, 1, ivalue); break;
+            case GL_FLOAT_MAT3: glUniformMatrix3fv(location, 1, GL_FALSE, value); break;
+            case GL_FLOAT_MAT4: glUniformMatrix4fv(location, 1, GL_FALSE, value); break;
+            // int, bool and samplers
+            default:            glUniform1iv(location, 1, ivalue); break;
+        }
+    }
+
+#ifdef BOUNCEGL_DEV
+
+    // Helper
+    // Live programs, reloaded by Program::reload_all()
+    std::vector<Program*>& programs()
+    {
+        static std::vector<Program*> instance;
+        return instance;
+    }
+
+    // Helper
+    // Reads shader file; sources are raw string literals, the R"( ... )" wrapping is dropped
+    bool read_shader_file(const char* path, std::string& body /* [out] */)
+    {
+        FILE* file = ::fopen(path, "rb");
+        if (file == nullptr) {
+            return false;
+        }
+
+        body.clear();
+        char buff[4096];
+        for (::size_t n; (n = ::fread(buff, 1, sizeof(buff), file)) != 0; )
+            body.append(buff, n);
+        ::fclose(file);
+
+        const std::string::size_type begin = body.find("R\"(");
+        const std::string::size_type end = body.rfind(")\"");
+        if (begin == std::string::npos || end == std::string::npos || end < begin + 3) {
+            return false;
+        }
+
+        body = body.substr(begin + 3, end - begin - 3);
+        return true;
+    }
+
+#endif
+
+    // Helper
+    // Shape of an attribute type: the # of locations it spans, and components per location
+    void attrib_shape(unsigned type, int& columns /* [out] */, int& components /* [out] */)
+    {
+        switch (type)
+        {
+            case GL_FLOAT_VEC2: case GL_INT_VEC2: case GL_UNSIGNED_INT_VEC2:
+                columns = 1, components = 2;
+                break;
+            case GL_FLOAT_VEC3: case GL_INT_VEC3: case GL_UNSIGNED_INT_VEC3:
+                columns = 1, components = 3;
+                break;
+            case GL_FLOAT_VEC4: case GL_INT_VEC4: case GL_UNSIGNED_INT_VEC4:
+                columns = 1, components = 4;
+                break;
+            case GL_FLOAT_MAT2:   columns = 2, components = 2; break;
+            case GL_FLOAT_MAT2x3: columns = 2, components = 3; break;
+            case GL_FLOAT_MAT2x4: columns = 2, components = 4; break;
+            case GL_FLOAT_MAT3:   columns = 3, components = 3; break;
+            case GL_FLOAT_MAT3x2: columns = 3, components = 2; break;
+            case GL_FLOAT_MAT3x4: columns = 3, components = 4; break;
+            case GL_FLOAT_MAT4:   columns = 4, components = 4; break;
+            case GL_FLOAT_MAT4x2: columns = 4, components = 2; break;
+            case GL_FLOAT_MAT4x3: columns = 4, components = 3; break;
+            default:
+                columns = 1, components = 1;
+                break;
+        }
+    }
+}
 
 Program::ProgramBuildException::ProgramBuildException(int programHandle) {
     ::memset(message__, 0, (bufflen__ + 1));
@@ -29,82 +160,465 @@ const char* Program::ShaderBuildException::what(::size_t* len /* [out] */) const
     return (*len = this->len__), message__;
 }
 
-Program::Program() {
+Program::VertexLayoutException::VertexLayoutException(unsigned vao, const char* name, int location, int size) {
+    ::memset(message__, 0, (bufflen__ + 1));
+    len__ = ::snprintf(message__, bufflen__, "Vertex array %u does not feed attribute %s: "
+                       "location %d is disabled or not %d components wide", vao, name, location, size);
+}
+
+const char* Program::VertexLayoutException::what() const {
+    return message__;
+}
+
+const char* Program::VertexLayoutException::what(::size_t* len /* [out] */) const {
+    return (*len = this->len__), message__;
+}
+
+Program::~Program()
+{
+#ifdef BOUNCEGL_DEV
+    programs().erase(std::find(programs().begin(), programs().end(), this));
+#endif
+
+    render::state::forget_program(programHandle_);
+
+    for (::size_t i = 0; i != shaders_.size(); ++i)
+        glDeleteShader(shaders_[i]);
+
+    glDeleteProgram(programHandle_);
+}
+
+Program::Program() : cacheKey_(0)
+                     , cached_(false)
+                     , linked_(false)
+{
     programHandle_ = glCreateProgram();
+
+#ifdef BOUNCEGL_DEV
+    programs().push_back(this);
+#endif
 }
 
-void Program::use() {
-    glUseProgram(programHandle_);
+void Program::define(const char* name)
+{
+    defines_ += "#define ";
+    defines_ += name;
+    defines_ += "\n";
+}
+
+void Program::define(const char* name, int value)
+{
+    char buff[32];
+    ::snprintf(buff, sizeof(buff), " %d\n", value);
+
+    defines_ += "#define ";
+    defines_ += name;
+    defines_ += buff;
+}
+
+void Program::capture_varyings(const char* const* names, unsigned count) {
+    varyings_.assign(names, names + count);
+}
+
+void Program::use()
+{
+    if (!linked_) {
+        finish_link();
+    }
+
+    render::state::use_program(programHandle_);
 }
 
 void Program::link()
 {
-    // Link program
+    linked_ = false;
+
+#ifdef BOUNCEGL_DEV
+    // Pick up edits to the shader files
+    for (::size_t i = 0; i != sources_.size(); ++i)
+    {
+        std::string body;
+        if (sources_[i].path != nullptr && read_shader_file(sources_[i].path, body))
+            sources_[i].text = sources_[i].prefix + body;
+    }
+#endif
+
+    std::vector<std::string> texts;
+    for (::size_t i = 0; i != sources_.size(); ++i)
+        texts.push_back(sources_[i].text);
+
+    // Captured outputs are linked into the binary too
+    for (::size_t i = 0; i != varyings_.size(); ++i)
+        texts.push_back(varyings_[i]);
+
+    // Skip compiling if a binary of the same sources was cached
+    cacheKey_ = render::program_cache_key(texts);
+    if ((cached_ = render::load_program_binary(programHandle_, cacheKey_))) {
+        return;
+    }
+
+    for (::size_t i = 0; i != sources_.size(); ++i)
+        shaders_.push_back(::create_shader(programHandle_, sources_[i].text, sources_[i].type));
+
+    if (cacheKey_ != 0) {
+        glProgramParameteri(programHandle_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    if (!varyings_.empty())
+    {
+        std::vector<const char*> names;
+        for (::size_t i = 0; i != varyings_.size(); ++i)
+            names.push_back(varyings_[i].c_str());
+
+        glTransformFeedbackVaryings(programHandle_, names.size(), names.data(), GL_INTERLEAVED_ATTRIBS);
+    }
+
+    // Link program; status is checked on first use, so that the driver
+    // can compile and link in the background meanwhile
     glLinkProgram(programHandle_);
+}
+
+bool Program::is_ready() const
+{
+    if (linked_ || !has_parallel_compile()) {
+        return true;
+    }
+
+    int ret = 0;
+    glGetProgramiv(programHandle_, GL_COMPLETION_STATUS_KHR, &ret);
+    return ret != 0;
+}
 
-    // Check for compile errors
+void Program::finish_link()
+{
+    // Check for link errors; blocks until linking is done
     int ret;
     glGetProgramiv(programHandle_, GL_LINK_STATUS, &ret);
-    if (ret == GL_FALSE) {
+    if (ret == GL_FALSE)
+    {
+        // Compile errors are more to the point than the link log
+        for (::size_t i = 0; i != shaders_.size(); ++i)
+        {
+            glGetShaderiv(shaders_[i], GL_COMPILE_STATUS, &ret);
+            if (ret == GL_FALSE) {
+                throw Program::ShaderBuildException(shaders_[i]);
+            }
+        }
+
         throw Program::ProgramBuildException(programHandle_);
     }
+
+    // Check the vertex arrays drawn with this program
+    for (::size_t i = 0; i != vertexArrays_.size(); ++i)
+        check_vertex_array(vertexArrays_[i]);
+
+    // Shaders are no longer needed
+    for (::size_t i = 0; i != shaders_.size(); ++i)
+    {
+        glDetachShader(programHandle_, shaders_[i]);
+        glDeleteShader(shaders_[i]);
+    }
+
+    shaders_.clear();
+
+    // Store for the next launch
+    if (!cached_) {
+        render::store_program_binary(programHandle_, cacheKey_);
+    }
+
+    linked_ = true;
+
+    // Reflect uniforms and set up subclass state with the program in use
+    render::state::use_program(programHandle_);
+    reflect_uniforms();
+    on_link();
+}
+
+void Program::reflect_uniforms()
+{
+    int count = 0;
+    glGetProgramiv(programHandle_, GL_ACTIVE_UNIFORMS, &count);
+
+    std::vector<uniform_entry> entries;
+    for (int i = 0; i != count; ++i)
+    {
+        char name[256];
+        int len = 0, size = 0;
+        unsigned type = 0;
+        glGetActiveUniform(programHandle_, i, sizeof(name), &len, &size, &type, name);
+
+        uniform_entry entry;
+        entry.name.assign(name, len);
+        entry.location = glGetUniformLocation(programHandle_, name);
+        entry.type = type;
+        entry.size = 0;
+
+        // Arrays are reported as "name[0]"
+        const std::string::size_type pos = entry.name.find('[');
+        if (pos != std::string::npos) {
+            entry.name.erase(pos);
+        }
+
+        // Carry over the value from the previous link (see reload())
+        for (::size_t j = 0; j != uniforms_.size(); ++j)
+        {
+            const uniform_entry& previous = uniforms_[j];
+            if (previous.name == entry.name && previous.type == entry.type && previous.size != 0)
+            {
+                ::memcpy(entry.value, previous.value, entry.size = previous.size);
+                write_uniform(entry.location, entry.type, entry.value);
+                break;
+            }
+        }
+
+        entries.push_back(entry);
+    }
+
+    uniforms_.swap(entries);
+}
+
+bool Program::reload()
+{
+    // Keep the current program until the new one has linked
+    const int previous = programHandle_;
+    const bool previousLinked = linked_;
+    programHandle_ = glCreateProgram();
+
+    const char* error = nullptr;
+    try {
+        link();
+        finish_link();
+    }
+    catch (const Program::ShaderBuildException& e) {
+        error = e.what();
+        ::printf("Shader reload failed: %s\n", error);
+    }
+    catch (const Program::ProgramBuildException& e) {
+        error = e.what();
+        ::printf("Program reload failed: %s\n", error);
+    }
+    catch (const Program::VertexLayoutException& e) {
+        error = e.what();
+        ::printf("Program reload failed: %s\n", error);
+    }
+
+    if (error != nullptr)
+    {
+        for (::size_t i = 0; i != shaders_.size(); ++i)
+            glDeleteShader(shaders_[i]);
+        shaders_.clear();
+
+        glDeleteProgram(programHandle_);
+        programHandle_ = previous;
+        linked_ = previousLinked;
+        return false;
+    }
+
+    render::state::forget_program(previous);
+    glDeleteProgram(previous);
+    return true;
+}
+
+#ifdef BOUNCEGL_DEV
+
+unsigned Program::reload_all()
+{
+    unsigned failed = 0;
+    for (::size_t i = 0; i != programs().size(); ++i)
+        failed += programs()[i]->reload() ? 0 : 1;
+    return failed;
+}
+
+#endif
+
+void Program::expect_vertex_array(unsigned vao)
+{
+    if (std::find(vertexArrays_.begin(), vertexArrays_.end(), vao) != vertexArrays_.end()) {
+        return;
+    }
+
+    vertexArrays_.push_back(vao);
+    if (linked_) {
+        check_vertex_array(vao);
+    }
+}
+
+void Program::check_vertex_array(unsigned vao) const
+{
+    render::state::bind_vertex_array(vao);
+
+    int count = 0;
+    glGetProgramiv(programHandle_, GL_ACTIVE_ATTRIBUTES, &count);
+
+    for (int i = 0; i != count; ++i)
+    {
+        char name[256];
+        int len = 0, size = 0;
+        unsigned type = 0;
+        glGetActiveAttrib(programHandle_, i, sizeof(name), &len, &size, &type, name);
+
+        // Built-ins (gl_InstanceID...) are not fed by vertex arrays
+        if (::strncmp(name, "gl_", 3) == 0) {
+            continue;
+        }
+
+        int columns, components;
+        attrib_shape(type, columns, components);
+
+        // Matrices (and arrays) span consecutive locations
+        const int location = glGetAttribLocation(programHandle_, name);
+        for (int j = 0; j != columns * size; ++j)
+        {
+            int enabled = 0, n = 0;
+            glGetVertexAttribiv(location + j, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &enabled);
+            glGetVertexAttribiv(location + j, GL_VERTEX_ATTRIB_ARRAY_SIZE, &n);
+
+            if (!enabled || n != components) {
+                throw Program::VertexLayoutException(vao, name, location + j, components);
+            }
+        }
+    }
+
+    render::state::bind_vertex_array(0);
+}
+
+void Program::bind_uniform_block(const char* name, unsigned binding)
+{
+    const unsigned index = glGetUniformBlockIndex(programHandle_, name);
+    if (index != GL_INVALID_INDEX) {
+        glUniformBlockBinding(programHandle_, index, binding);
+    }
+}
+
+uniform Program::get_uniform(const char* name) const
+{
+    for (::size_t i = 0; i != uniforms_.size(); ++i)
+    {
+        if (uniforms_[i].name == name) {
+            uniform u = { uniforms_[i].location, int(i) };
+            return u;
+        }
+    }
+
+    uniform u = { -1, -1 };
+    return u;
+}
+
+bool Program::update_shadow(uniform u, const void* value, unsigned size)
+{
+    if (u.index < 0) {
+        return false;
+    }
+
+    // Program state outlives use(); values set earlier still hold
+    uniform_entry& entry = uniforms_[u.index];
+    if (entry.size == size && ::memcmp(entry.value, value, size) == 0) {
+        return (render::state::record(true), false);
+    }
+
+    ::memcpy(entry.value, value, entry.size = size);
+    return (render::state::record(false), true);
+}
+
+void Program::set_value(uniform u, const bool value) {
+    set_value(u, int(value));
+}
+
+void Program::set_value(uniform u, const int value)
+{
+    if (update_shadow(u, &value, sizeof(value)))
+        glUniform1i(u.location, value);
+}
+
+void Program::set_value(uniform u, const float value)
+{
+    if (update_shadow(u, &value, sizeof(value)))
+        glUniform1f(u.location, value);
+}
+
+void Program::set_value_ivec2(uniform u, const int* value)
+{
+    if (update_shadow(u, value, 2 * sizeof(int)))
+        glUniform2iv(u.location, 1, value);
+}
+
+void Program::set_value_vec2(uniform u, const float* value)
+{
+    if (update_shadow(u, value, 2 * sizeof(float)))
+        glUniform2fv(u.location, 1, value);
+}
+
+void Program::set_value_vec3(uniform u, const float* value)
+{
+    if (update_shadow(u, value, 3 * sizeof(float)))
+        glUniform3fv(u.location, 1, value);
+}
+
+void Program::set_value_mat3x3(uniform u, const float* value)
+{
+    if (update_shadow(u, value, 9 * sizeof(float)))
+        glUniformMatrix3fv(u.location, 1, GL_FALSE, value);
+}
+
+void Program::set_value_vec4(uniform u, const float* value)
+{
+    if (update_shadow(u, value, 4 * sizeof(float)))
+        glUniform4fv(u.location, 1, value);
+}
+
+void Program::set_value_mat4x4(uniform u, const float* value)
+{
+    if (update_shadow(u, value, 16 * sizeof(float)))
+        glUniformMatrix4fv(u.location, 1, GL_FALSE, value);
 }
 
 void Program::set_value(const char* name, const bool value) {
-    glUniform1i(glGetUniformLocation(programHandle_, name), value);
+    set_value(get_uniform(name), value);
 }
 
 void Program::set_value(const char* name, const int value) {
-    glUniform1i(glGetUniformLocation(programHandle_, name), value);
+    set_value(get_uniform(name), value);
 }
 
 void Program::set_value(const char* name, const float value) {
-    glUniform1f(glGetUniformLocation(programHandle_, name), value);
+    set_value(get_uniform(name), value);
+}
+
+void Program::set_value_ivec2(const char* name, const int* value) {
+    set_value_ivec2(get_uniform(name), value);
+}
+
+void Program::set_value_vec2(const char* name, const float* value) {
+    set_value_vec2(get_uniform(name), value);
 }
 
 void Program::set_value_vec3(const char* name, const float* value) {
-    glUniform3fv(glGetUniformLocation(programHandle_, name), 1, value);
+    set_value_vec3(get_uniform(name), value);
 }
 
 void Program::set_value_mat3x3(const char* name, const float* value) {
-    glUniformMatrix3fv(glGetUniformLocation(programHandle_, name), 1, GL_FALSE, value);
+    set_value_mat3x3(get_uniform(name), value);
 }
 
 void Program::set_value_vec4(const char* name, const float* value) {
-    glUniform4fv(glGetUniformLocation(programHandle_, name), 1, value);
+    set_value_vec4(get_uniform(name), value);
 }
 
 void Program::set_value_mat4x4(const char* name, const float* value) {
-    glUniformMatrix4fv(glGetUniformLocation(programHandle_, name), 1, GL_FALSE, value);
-}
-
-namespace {
-
-    // Helper
-    inline void create_shader(const int programHandle, const char* src, const int type)
-    {
-        // Build and compile shader program
-        const int shaderHandle = glCreateShader(type);
-
-        glShaderSource(shaderHandle, 1, &src, NULL);
-        glCompileShader(shaderHandle);
-
-        // Check status
-        int ret;
-        glGetShaderiv(shaderHandle, GL_COMPILE_STATUS, &ret);
-        if (ret == GL_FALSE) {
-            throw Program::ShaderBuildException(shaderHandle);
-        }
-
-        glAttachShader(programHandle, shaderHandle);
-        glDeleteShader(shaderHandle);
-    }
+    set_value_mat4x4(get_uniform(name), value);
 }
 
-void Program::create_shader(const fragment_shader& s) {
-    ::create_shader(programHandle_, s.src, GL_FRAGMENT_SHADER);
+void Program::create_shader(const fragment_shader& s)
+{
+    // Sources are written without a "#version" line; it must precede the defines
+    shader_source source = { GL_FRAGMENT_SHADER, "#version 300 es\n" + defines_, s.path, "" };
+    source.text = source.prefix + s.src;
+    sources_.push_back(source);
 }
 
-void Program::create_shader(const vertex_shader& s) {
-    ::create_shader(programHandle_, s.src, GL_VERTEX_SHADER);
+void Program::create_shader(const vertex_shader& s)
+{
+    shader_source source = { GL_VERTEX_SHADER, "#version 300 es\n" + defines_, s.path, "" };
+    source.text = source.prefix + s.src;
+    sources_.push_back(source);
 }
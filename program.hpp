@@ -3,17 +3,29 @@
 #ifndef PROGRAM_HPP
 #define PROGRAM_HPP
 
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "matrix.hpp"
 
+//! struct uniform
+/*! Uniform handle, resolved once after linking (see Program::get_uniform())
+ */
+struct uniform { int location, index; };
+
 //! struct vertex_shader
-/*! vertex shader source code 
+/*! vertex shader source code; path, if set, names the source file,
+ *! read in place of src by development builds (BOUNCEGL_DEV)
  */
-struct vertex_shader { const char* src; };
+struct vertex_shader { const char* src; const char* path; };
 
 //! struct fragment_shader
-/*! fragment shader source code 
+/*! fragment shader source code; path, if set, names the source file,
+ *! read in place of src by development builds (BOUNCEGL_DEV)
  */
-struct fragment_shader { const char* src; };
+struct fragment_shader { const char* src; const char* path; };
 
 //! class program
 /*! Encapsulates an opengl program
@@ -30,14 +42,69 @@ public:
      */
     struct ShaderBuildException;
 
+    //! struct VertexLayoutException
+    /*! Thrown on link when an expected vertex array does not feed an active attribute
+     */
+    struct VertexLayoutException;
+
     // dtor.
-    virtual ~Program() {}
+    virtual ~Program();
     // ctor.
     Program();
-    /// Sets program to be used by subsequent calls
+    /// Sets program to be used by subsequent calls;
+    /// on first use, waits for the link submitted by link() to finish,
+    /// reflects all active uniforms into the location table and calls on_link()
     void use();
-    /// Links program (use during creation phase)
+    /// Submits the added shaders for compiling and linking (use during creation
+    /// phase), or loads the program from the binary cache (see render::set_program_cache());
+    /// does not wait: compile and link errors are thrown by the first use()
     void link();
+    /// Non-blocking (with KHR_parallel_shader_compile)
+    /// @return true if use() would not wait for the driver; always true
+    /// once used, or if the extension is unavailable (completion can't be queried)
+    bool is_ready() const;
+    /// Recompiles and relinks in place (shader files are re-read in development
+    /// builds); uniform values are carried over and on_link() is called again;
+    /// blocks until linked
+    /// @return false on error, which is logged; the current program is then kept
+    bool reload();
+#ifdef BOUNCEGL_DEV
+    /// Reloads all programs (see reload())
+    /// @return the # of programs that failed to reload
+    static unsigned reload_all();
+#endif
+    /// Adds vertex array to those checked against the active attributes
+    /// once linking finishes (first use()); a mismatch throws VertexLayoutException;
+    /// vertex arrays already added are ignored
+    /// @param vao vertex array drawn with this program
+    void expect_vertex_array(unsigned vao);
+    /// Attaches uniform block to binding point (see render::block_binding)
+    /// @param name block name
+    /// @param binding binding point
+    void bind_uniform_block(const char* name, unsigned binding);
+    /// Looks up uniform in the location table; no GL call is made;
+    /// the table is filled by the first use()
+    /// @param name uniform name
+    /// @return handle; location is -1 if the uniform is not active
+    uniform get_uniform(const char* name) const;
+    /// @set
+    void set_value(uniform u, const bool value);
+    /// @set
+    void set_value(uniform u, const int  value);
+    /// @set
+    void set_value(uniform u, const float value);
+    /// @set
+    void set_value_ivec2(uniform u, const int* value);
+    /// @set
+    void set_value_vec2(uniform u, const float* value);
+    /// @set
+    void set_value_vec3(uniform u, const float* value);
+    /// @set
+    void set_value_mat3x3(uniform u, const float* value);
+    /// @set
+    void set_value_vec4(uniform u, const float* value);
+    /// @set
+    void set_value_mat4x4(uniform u, const float* value);
     /// @set
     void set_value(const char* name, const bool value);
     /// @set
@@ -45,6 +112,10 @@ public:
     /// @set
     void set_value(const char* name, const float value);
     /// @set
+    void set_value_ivec2(const char* name, const int* value);
+    /// @set
+    void set_value_vec2(const char* name, const float* value);
+    /// @set
     void set_value_vec3(const char* name, const float* value);
     /// @set
     void set_value_mat3x3(const char* name, const float* value);
@@ -52,14 +123,26 @@ public:
     void set_value_vec4(const char* name, const float* value);
     /// @set
     void set_value_mat4x4(const char* name, const float* value);
-    /// Adds shaders
+    /// Adds a preprocessor definition to the prefix injected into
+    /// shaders added after this call (the "#version" line comes first)
+    /// @param name macro name
+    void define(const char* name);
+    /// @param name macro name
+    /// @param value macro value
+    void define(const char* name, int value);
+    /// Captures vertex shader outputs into a transform feedback buffer,
+    /// interleaved in order (use before link())
+    /// @param names output names
+    /// @param count size of names
+    void capture_varyings(const char* const* names, unsigned count);
+    /// Adds shaders; compiled by link()
     /// @param first shader
     /// @param args... additional shaders
     template <typename T,
               typename ... Args>
     void add_shader(const T first, const Args ... args) {
         create_shader(first);
-        add(args ...);
+        add_shader(args ...);
     }
     /// Adds shader (add_shader() base case)
     /// @param first shader
@@ -68,10 +151,63 @@ public:
         create_shader(first);
     }
 
+protected:
+
+    /// Called once by the first use(), after linking succeeded and with the
+    /// program in use; resolve uniforms and set their initial values here
+    virtual void on_link() {}
+
 private:
 
+    Program(const Program&);
+    Program& operator=(const Program&);
+
     // Handle to shader program
     int programHandle_;
+    // Injected into shader sources, after the "#version" line
+    std::string defines_;
+    //! struct shader_source
+    /*! Complete shader source, "#version" line and defines included
+     */
+    struct shader_source { int type; std::string prefix; const char* path; std::string text; };
+
+    // Added shaders
+    std::vector<shader_source> sources_;
+    // Captured outputs, interleaved (see capture_varyings())
+    std::vector<std::string> varyings_;
+    // Attached shaders, kept until linking is checked
+    std::vector<int> shaders_;
+    // Binary cache key; 0 if not cached
+    unsigned long long cacheKey_;
+    // Set if linked from a cached binary
+    bool cached_;
+    // Vertex arrays checked once linked
+    std::vector<unsigned> vertexArrays_;
+    // Set once the link status is checked, by the first use()
+    bool linked_;
+
+    //! struct uniform_entry
+    /*! Reflected uniform and the last value written to it
+     */
+    struct uniform_entry { std::string name; int location; unsigned type, size; float value[16]; };
+
+    // Active uniforms, reflected by the first use()
+    std::vector<uniform_entry> uniforms_;
+
+    // Helper
+    // Waits for linking, checks its status and reflects uniforms
+    void finish_link();
+    // Helper
+    // Checks that vao enables every active attribute, with matching sizes
+    void check_vertex_array(unsigned vao) const;
+    // Helper
+    // Reflects active uniforms; values held by same-named uniforms of the
+    // previous link are kept and written to the new program
+    void reflect_uniforms();
+    // Helper
+    // Updates the shadow copy of u
+    // @return false if u already holds value (the write can be skipped)
+    bool update_shadow(uniform u, const void* value, unsigned size);
     // Helper
     // @param fragment shader source
     void create_shader(const fragment_shader& s);
@@ -80,6 +216,34 @@ private:
     void create_shader(const vertex_shader& s);
 };
 
+//! class ProgramVariants
+/*! Keyed cache of linked program variants; T is constructed from its key
+ *! the first time that key is requested, so only variants in use are built
+ */
+template <typename T>
+class ProgramVariants {
+public:
+    /// @param key variant key, passed to T's ctor.
+    /// @return the variant, built on first request
+    T& get(unsigned key) {
+        std::unique_ptr<T>& variant = variants_[key];
+        if (!variant) {
+            variant.reset(new T(key));
+        }
+
+        return *variant;
+    }
+    /// @return the # of variants built so far
+    unsigned size() const {
+        return variants_.size();
+    }
+
+private:
+
+    // Variants, by key
+    std::map<unsigned, std::unique_ptr<T> > variants_;
+};
+
 /// struct BuildException
 /*! Thrown on program creation failure
  */
@@ -124,4 +288,29 @@ struct Program::ShaderBuildException {
     const char* what(::size_t* len /* [out] */) const;
 };
 
+/// struct VertexLayoutException
+/*! Thrown on vertex array and program mismatch
+ */
+struct Program::VertexLayoutException {
+
+    static const int bufflen__ = 1024;
+
+    int len__;
+    char message__[bufflen__ + 1];
+
+    /// ctor.
+    /// @param vao mismatching vertex array
+    /// @param name attribute name
+    /// @param location attribute location (column location, for matrices)
+    /// @param size expected component count
+    VertexLayoutException(unsigned vao, const char* name, int location, int size);
+    /// @get
+    /// @return null-terminated error message
+    const char* what() const;
+    /// @get
+    /// @param len error message length
+    /// @return null-terminated error message
+    const char* what(::size_t* len /* [out] */) const;
+};
+
 #endif
@@ -0,0 +1,184 @@
+#include <cstdio>
+#include <cstring>
+
+#include <GLES3/gl3.h>
+#include <EGL/egl.h>
+
+#ifndef __EMSCRIPTEN__
+#include <sys/stat.h>
+#endif
+
+#include "program_cache.hpp"
+
+namespace {
+
+    // Cache directory; empty if disabled
+    std::string cacheDir;
+    // Activity counters
+    render::program_cache_stats stats = { 0, 0, 0 };
+
+#ifndef __EMSCRIPTEN__
+
+    /// struct binary_header
+    /*! Cache file header, followed by the program binary
+     */
+    struct binary_header { char magic[4]; unsigned long long key; unsigned format, size; };
+
+    // Helper
+    // FNV-1a, 64 bit
+    inline unsigned long long hash(unsigned long long h, const char* data, ::size_t len)
+    {
+        for (::size_t i = 0; i != len; ++i)
+            h = (h ^ (unsigned char)data[i]) * 0x100000001b3ull;
+        return h;
+    }
+
+    // Helper
+    inline unsigned long long hash(unsigned long long h, const char* str) {
+        return hash(h, str, ::strlen(str) + 1);
+    }
+
+    // Helper
+    // @return the cache file path for key
+    std::string cache_path(unsigned long long key)
+    {
+        char name[32];
+        ::snprintf(name, sizeof(name), "/%016llx.bin", key);
+        return cacheDir + name;
+    }
+
+#endif
+}
+
+void render::set_program_cache(const char* dir)
+{
+#ifndef __EMSCRIPTEN__
+    cacheDir = dir != nullptr ? dir : "";
+    if (!cacheDir.empty()) {
+        ::mkdir(cacheDir.c_str(), 0755);
+    }
+#else
+    (void)dir;
+#endif
+}
+
+render::program_cache_stats render::get_program_cache_stats() {
+    return stats;
+}
+
+unsigned long long render::program_cache_key(const std::vector<std::string>& sources)
+{
+#ifndef __EMSCRIPTEN__
+    if (cacheDir.empty()) {
+        return 0;
+    }
+
+    // Binaries are only usable if the driver can return them
+    int formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats == 0) {
+        return 0;
+    }
+
+    unsigned long long h = 0xcbf29ce484222325ull;
+    for (::size_t i = 0; i != sources.size(); ++i)
+        h = hash(h, sources[i].c_str());
+
+    const unsigned driver[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+    for (::size_t i = 0; i != sizeof(driver) / sizeof(unsigned); ++i)
+    {
+        const char* str = reinterpret_cast<const char*>(glGetString(driver[i]));
+        h = hash(h, str != nullptr ? str : "");
+    }
+
+    // 0 means "no key"
+    return h != 0 ? h : 1;
+#else
+    (void)sources;
+    return 0;
+#endif
+}
+
+bool render::load_program_binary(int program, unsigned long long key)
+{
+#ifndef __EMSCRIPTEN__
+    if (key == 0) {
+        return false;
+    }
+
+    std::vector<char> binary;
+    binary_header header;
+
+    if (FILE* file = ::fopen(cache_path(key).c_str(), "rb"))
+    {
+        if (::fread(&header, sizeof(header), 1, file) == 1 &&
+            ::memcmp(header.magic, "BGLB", 4) == 0 &&
+            header.key == key)
+        {
+            binary.resize(header.size);
+            if (header.size == 0 || ::fread(&binary[0], 1, header.size, file) != header.size)
+                binary.clear();
+        }
+
+        ::fclose(file);
+    }
+
+    if (binary.empty()) {
+        return (++stats.misses, false);
+    }
+
+    // The driver may still reject it, e.g. after an update that kept its version string
+    glProgramBinary(program, header.format, &binary[0], binary.size());
+
+    int ret;
+    glGetProgramiv(program, GL_LINK_STATUS, &ret);
+    if (ret == GL_FALSE) {
+        return (++stats.misses, false);
+    }
+
+    return (++stats.hits, true);
+#else
+    (void)program;
+    (void)key;
+    return false;
+#endif
+}
+
+void render::store_program_binary(int program, unsigned long long key)
+{
+#ifndef __EMSCRIPTEN__
+    if (key == 0) {
+        return;
+    }
+
+    int size = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+    if (size <= 0) {
+        return;
+    }
+
+    std::vector<char> binary(size);
+    binary_header header = { { 'B', 'G', 'L', 'B' }, key, 0, 0 };
+
+    int len = 0;
+    glGetProgramBinary(program, size, &len, &header.format, &binary[0]);
+    header.size = len;
+
+    // Written whole or not at all; a partial file fails the size check on load
+    const std::string path = cache_path(key);
+    if (FILE* file = ::fopen(path.c_str(), "wb"))
+    {
+        const bool ok = ::fwrite(&header, sizeof(header), 1, file) == 1 &&
+                        ::fwrite(&binary[0], 1, len, file) == (::size_t)len;
+        ::fclose(file);
+
+        if (ok)
+            ++stats.stores;
+        else
+            ::remove(path.c_str());
+    }
+#else
+    (void)program;
+    (void)key;
+#endif
+}
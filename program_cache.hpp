@@ -0,0 +1,37 @@
+#pragma once
+
+#ifndef PROGRAM_CACHE_HPP
+#define PROGRAM_CACHE_HPP
+
+#include <string>
+#include <vector>
+
+namespace render {
+
+    /// struct program_cache_stats
+    /*! Program binary cache activity since startup
+     */
+    struct program_cache_stats { unsigned hits, misses, stores; };
+
+    /// Enables the program binary cache; native builds only (see
+    /// tools/test_program_cache). WebGL has no program binaries, so this
+    /// is a no-op in wasm builds, and the browser build does not call it
+    /// @param dir cache directory, created if missing; null or empty disables the cache
+    void set_program_cache(const char* dir);
+    /// @return the cache activity
+    program_cache_stats get_program_cache_stats();
+    /// Keys binaries by their shader sources and the driver
+    /// (GL_VENDOR, GL_RENDERER, GL_VERSION); needs a current GL context
+    /// @param sources complete shader sources, in attachment order
+    /// @return the key; 0 if the cache is disabled or unsupported
+    unsigned long long program_cache_key(const std::vector<std::string>& sources);
+    /// Loads the binary stored under key into program and checks its link status
+    /// @return false on miss or if the driver rejects the binary;
+    /// program is then left unlinked, ready for compiling from source
+    bool load_program_binary(int program, unsigned long long key);
+    /// Stores the binary of a linked program under key; program must
+    /// have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+    void store_program_binary(int program, unsigned long long key);
+}
+
+#endif
@@ -0,0 +1,21 @@
+R"(
+precision mediump float;
+
+in vec2 v_corner;
+in float v_fade;
+
+out vec4 fragColor;
+
+uniform vec4 color;
+
+void main()
+{
+    // Round, soft-edged dots
+    float r = dot(v_corner, v_corner);
+    if (r > 1.0) {
+        discard;
+    }
+
+    fragColor = vec4(color.rgb, color.a * v_fade * (1.0 - r));
+}
+)"
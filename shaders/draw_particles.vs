@@ -0,0 +1,41 @@
+R"(
+// Attribute locations are injected by DrawParticles
+// (see render::particle_attrib)
+layout(location = CORNER_ATTRIB) in vec2 a_corner;     // quad corner, in [-1, 1]
+layout(location = POSITION_ATTRIB) in vec4 a_position; // per instance; xyz, age
+layout(location = VELOCITY_ATTRIB) in vec4 a_velocity; // per instance; xyz, lifetime
+
+out vec2 v_corner;
+out float v_fade;
+
+uniform float size;
+
+layout(std140) uniform Scene {
+    mat4 view;
+    mat4 projection;
+    mat4 scene; // projection * view
+};
+
+void main()
+{
+    v_corner = a_corner;
+
+    // Dead particles are clipped; every corner is outside the clip volume
+    if (a_position.w >= a_velocity.w)
+    {
+        v_fade = 0.0;
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        return;
+    }
+
+    float t = a_position.w / a_velocity.w;
+    v_fade = 1.0 - t;
+
+    // Facing the camera; the rows of the view matrix are its axes
+    vec3 right = vec3(view[0][0], view[1][0], view[2][0]);
+    vec3 up = vec3(view[0][1], view[1][1], view[2][1]);
+    vec3 world = a_position.xyz + (right * a_corner.x + up * a_corner.y) * size * (1.0 - 0.5 * t);
+
+    gl_Position = scene * vec4(world, 1.0);
+}
+)"
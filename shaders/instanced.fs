@@ -0,0 +1,41 @@
+R"(
+precision mediump float;
+
+#ifdef TEXTURED
+in vec2 v_texCoord;
+#else
+flat in vec4 v_color;
+#endif
+
+#ifdef FOG
+in float v_fogDepth;
+
+uniform vec4 fogColor;
+uniform vec2 fogRange; // start, end
+#endif
+
+out vec4 fragColor;
+
+#ifdef TEXTURED
+uniform sampler2D texture1;
+#endif
+#ifdef BLENDED
+uniform sampler2D texture2;
+#endif
+
+void main()
+{
+#if defined(BLENDED)
+    fragColor = mix(texture(texture1, v_texCoord), texture(texture2, v_texCoord), 0.4);
+#elif defined(TEXTURED)
+    fragColor = texture(texture1, v_texCoord);
+#else
+    fragColor = v_color;
+#endif
+
+#ifdef FOG
+    float fog = clamp((v_fogDepth - fogRange.x) / (fogRange.y - fogRange.x), 0.0, 1.0);
+    fragColor.rgb = mix(fragColor.rgb, fogColor.rgb, fog);
+#endif
+}
+)"
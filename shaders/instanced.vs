@@ -0,0 +1,64 @@
+R"(
+// Variant features and attribute locations are injected by DrawInstanced
+// (see render::draw_feature, render::vertex_attrib)
+layout(location = POSITION_ATTRIB) in vec3 a_pos;
+#ifdef TEXTURED
+layout(location = TEXCOORD_ATTRIB) in vec2 a_texCoord;
+#endif
+#ifndef GRID_INSTANCES
+layout(location = INSTANCE_ATTRIB) in mat4 a_inst;
+#endif
+
+#ifdef TEXTURED
+out vec2 v_texCoord;
+#else
+flat out vec4 v_color;
+
+uniform vec4 color;
+#endif
+
+#ifdef GRID_INSTANCES
+uniform ivec2 gridSize; // columns, rows
+#endif
+
+#ifdef FOG
+out float v_fogDepth;
+#endif
+
+layout(std140) uniform Scene {
+    mat4 view;
+    mat4 projection;
+    mat4 scene; // projection * view
+};
+
+void main()
+{
+#ifdef GRID_INSTANCES
+    // Unit squares, row by row, centered on the origin
+    ivec2 cell = ivec2(gl_InstanceID % gridSize.x, gl_InstanceID / gridSize.x);
+    mat4 inst = mat4(1.0);
+    inst[3].xy = vec2(cell - gridSize / 2) + 0.5;
+#else
+    mat4 inst = a_inst;
+#endif
+
+    vec4 world = inst * vec4(a_pos, 1.0);
+
+#ifdef TEXTURED
+#ifdef TILED
+    // Textures repeat once per world unit across scaled instances
+    v_texCoord = a_texCoord * vec2(length(inst[0].xyz), length(inst[1].xyz));
+#else
+    v_texCoord = a_texCoord;
+#endif
+#else
+    v_color = color;
+#endif
+
+#ifdef FOG
+    v_fogDepth = -(view * world).z;
+#endif
+
+    gl_Position = scene * world;
+}
+)"
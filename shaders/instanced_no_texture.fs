@@ -1,10 +0,0 @@
-R"(
-precision mediump float;
-
-varying vec4 v_color;
-
-void main()
-{
-    gl_FragColor = v_color;
-}
-)"
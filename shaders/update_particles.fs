@@ -0,0 +1,11 @@
+R"(
+precision mediump float;
+
+// Never run; the update pass discards rasterization
+out vec4 fragColor;
+
+void main()
+{
+    fragColor = vec4(0.0);
+}
+)"
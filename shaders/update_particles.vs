@@ -0,0 +1,94 @@
+R"(
+// Attribute locations and limits are injected by UpdateParticles
+// (see render::particle_attrib)
+layout(location = POSITION_ATTRIB) in vec4 a_position; // xyz, age
+layout(location = VELOCITY_ATTRIB) in vec4 a_velocity; // xyz, lifetime
+
+// Captured into the other particle buffer
+out vec4 v_position;
+out vec4 v_velocity;
+
+// Bursts queued since the last update; burst i fills the burstSize slots
+// from emitFirst + i * burstSize, wrapping around at CAPACITY
+layout(std140) uniform Bursts {
+    vec4 bursts[2 * MAX_BURSTS]; // origin (xyz), speed; normal (xyz), unused
+};
+
+uniform int emitFirst;
+uniform int emitCount;
+uniform int burstSize;
+uniform int seed;
+uniform float dt;
+
+// Particles fall toward the ground, at z = 0; the camera looks down +z
+const vec3 GRAVITY = vec3(0.0, 0.0, 9.8);
+const float GROUND = 0.0;
+const float LIFETIME = 1.5;
+
+// Helper
+// Integer hash (lowbias32)
+uint hash(uint x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// Helper
+// @return a random float in [0, 1)
+float random(inout uint state)
+{
+    state = hash(state);
+    return float(state >> 8) * (1.0 / 16777216.0);
+}
+
+void main()
+{
+    int slot = gl_VertexID - emitFirst;
+    if (slot < 0) {
+        slot += CAPACITY;
+    }
+
+    if (slot < emitCount)
+    {
+        vec4 origin = bursts[2 * (slot / burstSize)];
+        vec3 normal = bursts[2 * (slot / burstSize) + 1].xyz;
+        uint state = uint(gl_VertexID) ^ hash(uint(seed));
+
+        // Sprayed back into the cage and up, faster off harder hits
+        vec3 tangent = vec3(-normal.y, normal.x, 0.0);
+        vec3 direction = -normal * random(state)
+                       + tangent * (2.0 * random(state) - 1.0)
+                       - vec3(0.0, 0.0, 0.5 + random(state));
+        float speed = max(origin.w, 1.0) * (0.3 + 0.7 * random(state));
+
+        v_position = vec4(origin.xyz, 0.0);
+        v_velocity = vec4(normalize(direction) * speed, LIFETIME * (0.5 + 0.5 * random(state)));
+        return;
+    }
+
+    // Dead particles are left as they are
+    if (a_position.w >= a_velocity.w)
+    {
+        v_position = a_position;
+        v_velocity = a_velocity;
+        return;
+    }
+
+    vec3 velocity = a_velocity.xyz + GRAVITY * dt;
+    vec3 position = a_position.xyz + velocity * dt;
+
+    // Bounce off the ground, losing most of the speed
+    if (position.z > GROUND)
+    {
+        position.z = GROUND;
+        velocity *= vec3(0.8, 0.8, -0.4);
+    }
+
+    v_position = vec4(position, a_position.w + dt);
+    v_velocity = vec4(velocity, a_velocity.w);
+}
+)"
@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <cmath>
+
+#include "ball_grid.hpp"
+
+const unsigned sim::BallGrid::NONE;
+
+sim::BallGrid::BallGrid(float maxX, float maxY, float cellSize) : maxX_(maxX)
+                                                           , maxY_(maxY)
+                                                           , cellSize_(cellSize)
+{
+    columns_ = std::max(1, (int)std::ceil(2 * maxX / cellSize));
+    rows_ = std::max(1, (int)std::ceil(2 * maxY / cellSize));
+    head_.assign(columns_ * rows_, NONE);
+}
+
+void sim::BallGrid::push_back(float x, float y)
+{
+    const unsigned ball = cell_.size();
+    cell_.push_back(NONE);
+    next_.push_back(NONE);
+    prev_.push_back(NONE);
+    link(ball, find_cell(x, y));
+}
+
+void sim::BallGrid::pop_back()
+{
+    unlink(cell_.size() - 1);
+    cell_.pop_back();
+    next_.pop_back();
+    prev_.pop_back();
+}
+
+void sim::BallGrid::move(unsigned ball, float x, float y)
+{
+    const unsigned cell = find_cell(x, y);
+    if (cell != cell_[ball])
+    {
+        unlink(ball);
+        link(ball, cell);
+    }
+}
+
+void sim::BallGrid::resize(float maxX, float maxY, const float* x, const float* y)
+{
+    maxX_ = maxX;
+    maxY_ = maxY;
+    columns_ = std::max(1, (int)std::ceil(2 * maxX / cellSize_));
+    rows_ = std::max(1, (int)std::ceil(2 * maxY / cellSize_));
+    head_.assign(columns_ * rows_, NONE);
+
+    for (unsigned i = 0; i != cell_.size(); ++i)
+        link(i, find_cell(x[i], y[i]));
+}
+
+unsigned sim::BallGrid::find_cell(float x, float y) const
+{
+    const int c = std::min(std::max((int)((x + maxX_) / cellSize_), 0), (int)columns_ - 1);
+    const int r = std::min(std::max((int)((y + maxY_) / cellSize_), 0), (int)rows_ - 1);
+    return r * columns_ + c;
+}
+
+void sim::BallGrid::link(unsigned ball, unsigned cell)
+{
+    const unsigned first = head_[cell];
+    next_[ball] = first;
+    prev_[ball] = NONE;
+    if (first != NONE)
+        prev_[first] = ball;
+
+    head_[cell] = ball;
+    cell_[ball] = cell;
+}
+
+void sim::BallGrid::unlink(unsigned ball)
+{
+    const unsigned p = prev_[ball];
+    const unsigned n = next_[ball];
+
+    if (p != NONE)
+        next_[p] = n;
+    else
+        head_[cell_[ball]] = n;
+
+    if (n != NONE)
+        prev_[n] = p;
+}
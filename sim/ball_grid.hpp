@@ -0,0 +1,89 @@
+#pragma once
+
+#ifndef SIM_BALL_GRID_HPP
+#define SIM_BALL_GRID_HPP
+
+#include <vector>
+
+namespace sim {
+
+    //! class BallGrid
+    /*! Uniform grid over the cage, for finding balls that may touch; each
+     *! cell lists its balls, and a ball is relinked only when it changes cell
+     */
+    class BallGrid {
+    public:
+
+        /// ctor.
+        /// @param maxX bound of ball centers along x; the grid spans [-maxX, maxX]
+        /// @param maxY bound of ball centers along y
+        /// @param cellSize cell side, at least the ball diameter
+        BallGrid(float maxX, float maxY, float cellSize);
+        /// Adds a ball; balls are numbered in order of insertion
+        void push_back(float x, float y);
+        /// Removes the last ball
+        void pop_back();
+        /// Moves a ball to the cell of (x, y), if it changed
+        void move(unsigned ball, float x, float y);
+        /// Re-spans the grid and relinks every ball
+        /// @param x, y ball centers, in order of insertion
+        void resize(float maxX, float maxY, const float* x, const float* y);
+        /// Calls f(i, j) once for each pair of balls in the same or adjacent cells
+        template <typename F__>
+        void for_each_pair(F__& f) const;
+
+    private:
+
+        // Helper
+        // @return the cell of (x, y); points off the grid go to the nearest cell
+        unsigned find_cell(float x, float y) const;
+        // Helper
+        void link(unsigned ball, unsigned cell);
+        // Helper
+        void unlink(unsigned ball);
+
+        // End of a cell list
+        static const unsigned NONE = ~0u;
+
+        // Grid dimensions
+        unsigned columns_, rows_;
+        float maxX_, maxY_;
+        float cellSize_;
+
+        // First ball of each cell
+        std::vector<unsigned> head_;
+        // Per ball: cell, and neighbors in the cell list
+        std::vector<unsigned> cell_, next_, prev_;
+    };
+
+    template <typename F__>
+    void BallGrid::for_each_pair(F__& f) const
+    {
+        // Half the neighborhood, so each pair of cells is visited once
+        static const int offsets[][2] = { { 1, 0 }, { -1, 1 }, { 0, 1 }, { 1, 1 } };
+
+        // By ball rather than by cell; sparse grids cost nothing extra
+        for (unsigned i = 0; i != cell_.size(); ++i)
+        {
+            // Balls after i in its own cell
+            for (unsigned j = next_[i]; j != NONE; j = next_[j])
+                f(i, j);
+
+            const int column = cell_[i] % columns_;
+            const int row = cell_[i] / columns_;
+            for (unsigned k = 0; k != sizeof(offsets) / sizeof(offsets[0]); ++k)
+            {
+                const int c = column + offsets[k][0];
+                const int r = row + offsets[k][1];
+                if (c < 0 || c >= (int)columns_ || r >= (int)rows_) {
+                    continue;
+                }
+
+                for (unsigned j = head_[r * columns_ + c]; j != NONE; j = next_[j])
+                    f(i, j);
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,625 @@
+#include <algorithm>
+#include <cmath>
+
+#include "ball_system.hpp"
+#include "job_system.hpp"
+#include "matrix_transform.hpp"
+
+namespace {
+
+    // Height of ball centers
+    const float BALL_Z = -1.0;
+    // Full turn
+    const float TWO_PI = 2 * calc::PI;
+    // Balls collide as spheres inscribed in their boxes
+    const float BALL_RADIUS = 0.5;
+    // Balls per job chunk
+    const unsigned CHUNK = 4096;
+
+    // Helper
+    // Advances positions by one tick and reflects balls off each wall plane
+    // they cross at their exact contact time: mirroring the end position
+    // across the plane is the same as reflecting the velocity at
+    // t = dt - depth / vn. Branch-free, so the compiler can vectorize it.
+    // Faces that meet at other than right angles need a second pass: a
+    // reflection off one can leave the ball past the face before it
+    inline void sweep(float* x, float* y, float* prevX, float* prevY, float* vx, float* vy, unsigned char* hit,
+                      unsigned count, const sim::cage_plane* planes, unsigned planeCount, unsigned passes, float dt)
+    {
+        for (unsigned i = 0; i != count; ++i)
+        {
+            prevX[i] = x[i];
+            prevY[i] = y[i];
+            x[i] += vx[i] * dt;
+            y[i] += vy[i] * dt;
+            hit[i] = 0;
+        }
+
+        // Planes in turn; crossing two in one tick (corners) reflects off both
+        for (unsigned pass = 0; pass != passes; ++pass)
+        for (unsigned p = 0; p != planeCount; ++p)
+        {
+            const float nx = planes[p].nx;
+            const float ny = planes[p].ny;
+            const float bound = planes[p].d - BALL_RADIUS;
+
+            for (unsigned i = 0; i != count; ++i)
+            {
+                const float vn = vx[i] * nx + vy[i] * ny;
+                const float depth = x[i] * nx + y[i] * ny - bound;
+
+                // Past the plane and moving out of the cage: mirrored back
+                // in. Past it but already moving in (left there by a
+                // neighbouring polygon face): placed onto the plane
+                const float k = (depth > 0) & (vn > 0) ? 2.0f : 0.0f;
+                const float push = k != 0 ? k : (depth > 0 ? 1.0f : 0.0f);
+                x[i] -= push * depth * nx;
+                y[i] -= push * depth * ny;
+                vx[i] -= k * vn * nx;
+                vy[i] -= k * vn * ny;
+                hit[i] = k != 0 ? p + 1 : hit[i];
+            }
+        }
+    }
+
+    // Helper
+    // @return the bound of ball centers along an axis; the furthest corner
+    // of the region the wall faces leave them
+    inline float cage_extent(const std::vector<sim::cage_plane>& planes, unsigned axis)
+    {
+        float extent = 0;
+        for (::size_t i = 0; i != planes.size(); ++i)
+        {
+            for (::size_t j = i + 1; j != planes.size(); ++j)
+            {
+                const sim::cage_plane& p = planes[i];
+                const sim::cage_plane& q = planes[j];
+
+                // Parallel faces never meet
+                const float det = p.nx * q.ny - p.ny * q.nx;
+                if (std::abs(det) < 1e-6f) {
+                    continue;
+                }
+
+                const float dp = p.d - BALL_RADIUS;
+                const float dq = q.d - BALL_RADIUS;
+                const float x = (dp * q.ny - dq * p.ny) / det;
+                const float y = (p.nx * dq - q.nx * dp) / det;
+
+                // A corner only if no other face cuts it off
+                bool corner = true;
+                for (::size_t k = 0; k != planes.size() && corner; ++k)
+                    corner = x * planes[k].nx + y * planes[k].ny <= planes[k].d - BALL_RADIUS + 1e-3f;
+
+                if (corner)
+                    extent = std::max(extent, std::abs(axis == 0 ? x : y));
+            }
+        }
+
+        return extent;
+    }
+
+    // Helper
+    // Advances angles by one tick, wrapping the last and previous ones together
+    inline void spin(float* angle, float* prev, const float* rate, unsigned count, float dt)
+    {
+        for (unsigned i = 0; i != count; ++i)
+        {
+            const float a = angle[i] + rate[i] * dt;
+            const float wrap = a >= TWO_PI ? TWO_PI : 0;
+            prev[i] = angle[i] - wrap;
+            angle[i] = a - wrap;
+        }
+    }
+
+    // Helper
+    // Flags balls whose last tick changed a component; a ball with no
+    // speed or turn rate ends its tick where it started, bit for bit
+    inline void flag_changed(unsigned char* awake, const float* v, const float* prev, unsigned count)
+    {
+        for (unsigned i = 0; i != count; ++i)
+            awake[i] |= v[i] != prev[i];
+    }
+
+    /// struct elastic_contact
+    /*! Narrow phase; bounces a pair of touching, approaching balls of equal
+     *! mass by swapping their velocities along the line between them
+     */
+    struct elastic_contact {
+        const float* x;
+        const float* y;
+        float* vx;
+        float* vy;
+        unsigned count;
+
+        void operator()(unsigned i, unsigned j)
+        {
+            const float dx = x[j] - x[i];
+            const float dy = y[j] - y[i];
+            const float d2 = dx * dx + dy * dy;
+            if (d2 >= 4 * BALL_RADIUS * BALL_RADIUS || d2 == 0) {
+                return;
+            }
+
+            // Relative velocity along the contact normal; separating pairs are left alone
+            const float d = std::sqrt(d2);
+            const float nx = dx / d, ny = dy / d;
+            const float v = (vx[i] - vx[j]) * nx + (vy[i] - vy[j]) * ny;
+            if (v <= 0) {
+                return;
+            }
+
+            vx[i] -= v * nx;
+            vy[i] -= v * ny;
+            vx[j] += v * nx;
+            vy[j] += v * ny;
+            ++count;
+        }
+    };
+
+    // Helper
+    // FNV-1a, 64 bit
+    template <typename T__>
+    inline unsigned long long hash(unsigned long long h, const std::vector<T__>& v)
+    {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(v.data());
+        for (::size_t i = 0; i != v.size() * sizeof(T__); ++i)
+            h = (h ^ p[i]) * 0x100000001b3ull;
+        return h;
+    }
+
+    // Helper
+    inline float lerp(float a, float b, float t) {
+        return a + (b - a) * t;
+    }
+
+    // Helper
+    // Writes translation * rotate_x * rotate_y * rotate_z, column-major
+    inline void write_matrix(float* m, float x, float y, float ax, float ay, float az)
+    {
+        const float cx = std::cos(ax), sx = std::sin(ax);
+        const float cy = std::cos(ay), sy = std::sin(ay);
+        const float cz = std::cos(az), sz = std::sin(az);
+
+        m[0]  = cy * cz;
+        m[1]  = cx * sz + sx * sy * cz;
+        m[2]  = sx * sz - cx * sy * cz;
+        m[3]  = 0;
+
+        m[4]  = -cy * sz;
+        m[5]  = cx * cz - sx * sy * sz;
+        m[6]  = sx * cz + cx * sy * sz;
+        m[7]  = 0;
+
+        m[8]  = sy;
+        m[9]  = -sx * cy;
+        m[10] = cx * cy;
+        m[11] = 0;
+
+        m[12] = x;
+        m[13] = y;
+        m[14] = BALL_Z;
+        m[15] = 1;
+    }
+}
+
+const unsigned sim::BallSystem::SKIN_COUNT;
+
+/// struct sim::BallSystem::advance_job
+/*! Moves and turns a chunk of balls
+ */
+struct sim::BallSystem::advance_job {
+    BallSystem* self;
+    float dt;
+
+    void operator()(unsigned begin, unsigned end) {
+        self->advance(begin, end, dt);
+    }
+};
+
+/// struct sim::BallSystem::skin_job
+/*! Counts the skins of a chunk of balls
+ */
+struct sim::BallSystem::skin_job {
+    const BallSystem* self;
+
+    void operator()(unsigned begin, unsigned end) {
+        self->count_skins(begin, end, &self->chunkSkins_[begin / CHUNK * SKIN_COUNT]);
+    }
+};
+
+/// struct sim::BallSystem::matrix_job
+/*! Writes the matrices of a chunk of balls
+ */
+struct sim::BallSystem::matrix_job {
+    const BallSystem* self;
+    float alpha;
+    float* out;
+
+    void operator()(unsigned begin, unsigned end) {
+        self->write_matrices(begin, end, alpha, out,
+                             &self->chunkSkins_[begin / CHUNK * SKIN_COUNT],
+                             &self->chunkChanged_[begin / CHUNK * SKIN_COUNT * 2]);
+    }
+};
+
+sim::BallSystem::BallSystem(float cageWidth, float cageLength) : maxX_(0)
+                                                          , maxY_(0)
+                                                          , seed_(0x9e3779b9)
+                                                          , jobs_(nullptr)
+                                                          , grid_(maxX_, maxY_, 2 * BALL_RADIUS)
+                                                          , collisions_(true)
+                                                          , contacts_(0)
+                                                          , active_(0)
+{
+    speed_[0] = speed_[1] = 0;
+    turnRate_[0] = turnRate_[1] = turnRate_[2] = 0;
+
+    const cage_shape cage = { cageWidth, cageLength, 4 };
+    set_cage(cage);
+}
+
+void sim::BallSystem::set_seed(unsigned seed) {
+    // xorshift never leaves 0
+    seed_ = seed != 0 ? seed : 0x9e3779b9;
+}
+
+void sim::BallSystem::resize(unsigned count)
+{
+    const unsigned first = size();
+
+    for (unsigned i = first; i > count; --i)
+        grid_.pop_back();
+
+    x_.resize(count);
+    y_.resize(count);
+    prevX_.resize(count);
+    prevY_.resize(count);
+    vx_.resize(count);
+    vy_.resize(count);
+    angleX_.resize(count);
+    angleY_.resize(count);
+    angleZ_.resize(count);
+    prevAngleX_.resize(count);
+    prevAngleY_.resize(count);
+    prevAngleZ_.resize(count);
+    spinX_.resize(count);
+    spinY_.resize(count);
+    spinZ_.resize(count);
+    skin_.resize(count);
+    awake_.resize(count);
+    wallHit_.resize(count);
+
+    // Skin groups shift; every matrix moves
+    if (count != first)
+        dirty_.assign(count, 1);
+
+    for (unsigned i = first; i < count; ++i)
+    {
+        // The first ball starts in the middle, heading up and left (x-axis is flipped)
+        const bool centered = i == 0;
+
+        x_[i] = prevX_[i] = centered ? 0 : (2 * random() - 1) * maxX_;
+        y_[i] = prevY_[i] = centered ? 0 : (2 * random() - 1) * maxY_;
+
+        // Polygons leave the corners of their bounds out; draw again
+        for (unsigned tries = 0; !is_inside(x_[i], y_[i]) && tries != 64; ++tries)
+        {
+            x_[i] = prevX_[i] = (2 * random() - 1) * maxX_;
+            y_[i] = prevY_[i] = (2 * random() - 1) * maxY_;
+        }
+
+        vx_[i] = std::copysign(speed_[0], centered || random() < 0.5 ? -1.0f : 1.0f);
+        vy_[i] = std::copysign(speed_[1], centered || random() < 0.5 ? +1.0f : -1.0f);
+
+        angleX_[i] = angleY_[i] = angleZ_[i] = 0;
+        prevAngleX_[i] = prevAngleY_[i] = prevAngleZ_[i] = 0;
+
+        spinX_[i] = turnRate_[0];
+        spinY_[i] = turnRate_[1];
+        spinZ_[i] = turnRate_[2];
+
+        skin_[i] = i % SKIN_COUNT;
+        awake_[i] = 1;
+        wallHit_[i] = 0;
+
+        grid_.push_back(x_[i], y_[i]);
+    }
+}
+
+const std::vector<sim::cage_plane>& sim::BallSystem::get_planes() const {
+    return planes_;
+}
+
+void sim::BallSystem::set_cage(const cage_shape& cage)
+{
+    cage_ = cage;
+    planes_ = build_cage_planes(cage);
+    maxX_ = cage_extent(planes_, 0);
+    maxY_ = cage_extent(planes_, 1);
+
+    // Move balls left outside onto the wall; twice, for acute corners
+    for (unsigned pass = 0; pass != 2; ++pass)
+    {
+        for (::size_t p = 0; p != planes_.size(); ++p)
+        {
+            const cage_plane& plane = planes_[p];
+            for (unsigned i = 0; i != size(); ++i)
+            {
+                const float depth = x_[i] * plane.nx + y_[i] * plane.ny - (plane.d - BALL_RADIUS);
+                if (depth > 0)
+                {
+                    x_[i] = prevX_[i] = x_[i] - depth * plane.nx;
+                    y_[i] = prevY_[i] = y_[i] - depth * plane.ny;
+                    dirty_[i] = 1;
+                }
+            }
+        }
+    }
+
+    grid_.resize(maxX_, maxY_, x_.data(), y_.data());
+}
+
+const sim::cage_shape& sim::BallSystem::get_cage() const {
+    return cage_;
+}
+
+unsigned sim::BallSystem::size() const {
+    return x_.size();
+}
+
+void sim::BallSystem::set_speed(unsigned axis, float speed)
+{
+    speed_[axis] = speed;
+
+    // copysign() keeps the sign of a zero velocity
+    std::vector<float>& v = axis == 0 ? vx_ : vy_;
+    for (::size_t i = 0; i != v.size(); ++i)
+        v[i] = std::copysign(speed, v[i]);
+}
+
+void sim::BallSystem::set_turn_rate(unsigned axis, float rate)
+{
+    turnRate_[axis] = rate;
+
+    std::vector<float>& v = axis == 0 ? spinX_ : (axis == 1 ? spinY_ : spinZ_);
+    for (::size_t i = 0; i != v.size(); ++i)
+        v[i] = rate;
+}
+
+void sim::BallSystem::set_job_system(JobSystem* jobs) {
+    jobs_ = jobs;
+}
+
+void sim::BallSystem::set_collisions(bool state) {
+    collisions_ = state;
+}
+
+unsigned sim::BallSystem::get_contacts() const {
+    return contacts_;
+}
+
+const std::vector<sim::wall_hit>& sim::BallSystem::get_wall_hits() const {
+    return hits_;
+}
+
+unsigned sim::BallSystem::get_active() const {
+    return active_;
+}
+
+void sim::BallSystem::set_skin(unsigned skin)
+{
+    for (::size_t i = 0; i != skin_.size(); ++i)
+        skin_[i] = skin;
+
+    dirty_.assign(dirty_.size(), 1);
+}
+
+void sim::BallSystem::update(float dt)
+{
+    const unsigned count = size();
+    hits_.clear();
+    if (count == 0) {
+        return;
+    }
+
+    advance_job job = { this, dt };
+    if (jobs_ != nullptr)
+        jobs_->parallel_for(count, CHUNK, job);
+    else
+        job(0, count);
+
+    // The grid and contacts stay on this thread; contacts chain through
+    // shared balls, in order
+
+    // Most balls stay in their cell from one tick to the next; sleeping
+    // ones always do
+    active_ = 0;
+    for (unsigned i = 0; i != count; ++i)
+    {
+        if (awake_[i] != 0) {
+            grid_.move(i, x_[i], y_[i]);
+            ++active_;
+        }
+
+        if (wallHit_[i] != 0) {
+            add_wall_hit(i, planes_[wallHit_[i] - 1]);
+        }
+    }
+
+    contacts_ = 0;
+    if (collisions_) {
+        collide();
+    }
+}
+
+void sim::BallSystem::add_wall_hit(unsigned i, const cage_plane& plane)
+{
+    // Nearest point of the wall face; the ball touched it during the tick
+    const float depth = plane.d - (x_[i] * plane.nx + y_[i] * plane.ny);
+
+    wall_hit hit;
+    hit.x = x_[i] + depth * plane.nx;
+    hit.y = y_[i] + depth * plane.ny;
+    hit.z = BALL_Z;
+    hit.nx = plane.nx;
+    hit.ny = plane.ny;
+    hit.speed = -(vx_[i] * plane.nx + vy_[i] * plane.ny);
+    hits_.push_back(hit);
+}
+
+void sim::BallSystem::collide()
+{
+    elastic_contact contact = { &x_[0], &y_[0], &vx_[0], &vy_[0], 0 };
+    grid_.for_each_pair(contact);
+    contacts_ = contact.count;
+}
+
+unsigned long long sim::BallSystem::get_checksum() const
+{
+    unsigned long long h = 0xcbf29ce484222325ull;
+    h = hash(h, x_);
+    h = hash(h, y_);
+    h = hash(h, vx_);
+    h = hash(h, vy_);
+    h = hash(h, angleX_);
+    h = hash(h, angleY_);
+    h = hash(h, angleZ_);
+    h = hash(h, skin_);
+    return h;
+}
+
+void sim::BallSystem::build_matrices(float alpha, float* out, unsigned* counts, unsigned* changed) const
+{
+    const unsigned count = size();
+    const unsigned chunks = (count + CHUNK - 1) / CHUNK;
+    chunkSkins_.assign(chunks * SKIN_COUNT, 0);
+
+    skin_job skins = { this };
+    if (jobs_ != nullptr)
+        jobs_->parallel_for(count, CHUNK, skins);
+    else
+        skins(0, count);
+
+    for (unsigned s = 0; s != SKIN_COUNT; ++s)
+    {
+        counts[s] = 0;
+        for (unsigned c = 0; c != chunks; ++c)
+            counts[s] += chunkSkins_[c * SKIN_COUNT + s];
+    }
+
+    // First matrix of each skin group, in each chunk
+    for (unsigned s = 0, off = 0; s != SKIN_COUNT; off += counts[s++])
+    {
+        for (unsigned c = 0, chunkOff = off; c != chunks; ++c)
+        {
+            const unsigned n = chunkSkins_[c * SKIN_COUNT + s];
+            chunkSkins_[c * SKIN_COUNT + s] = chunkOff;
+            chunkOff += n;
+        }
+    }
+
+    // Empty ranges, [~0, 0), until a matrix is written
+    chunkChanged_.resize(chunks * SKIN_COUNT * 2);
+    for (unsigned c = 0; c != chunks * SKIN_COUNT; ++c)
+    {
+        chunkChanged_[2 * c] = ~0u;
+        chunkChanged_[2 * c + 1] = 0;
+    }
+
+    matrix_job matrices = { this, alpha, out };
+    if (jobs_ != nullptr)
+        jobs_->parallel_for(count, CHUNK, matrices);
+    else
+        matrices(0, count);
+
+    // Merge the ranges of each chunk, from the start of each skin group
+    for (unsigned s = 0, off = 0; s != SKIN_COUNT; off += counts[s++])
+    {
+        unsigned first = ~0u, last = 0;
+        for (unsigned c = 0; c != chunks; ++c)
+        {
+            first = std::min(first, chunkChanged_[2 * (c * SKIN_COUNT + s)]);
+            last = std::max(last, chunkChanged_[2 * (c * SKIN_COUNT + s) + 1]);
+        }
+
+        changed[2 * s] = first < last ? first - off : 0;
+        changed[2 * s + 1] = first < last ? last - off : 0;
+    }
+}
+
+void sim::BallSystem::advance(unsigned begin, unsigned end, float dt)
+{
+    const unsigned n = end - begin;
+
+    sweep(&x_[begin], &y_[begin], &prevX_[begin], &prevY_[begin], &vx_[begin], &vy_[begin], &wallHit_[begin], n,
+          planes_.data(), planes_.size(), cage_.sides == 4 ? 1 : 2, dt);
+
+    spin(&angleX_[begin], &prevAngleX_[begin], &spinX_[begin], n, dt);
+    spin(&angleY_[begin], &prevAngleY_[begin], &spinY_[begin], n, dt);
+    spin(&angleZ_[begin], &prevAngleZ_[begin], &spinZ_[begin], n, dt);
+
+    unsigned char* awake = &awake_[begin];
+    std::fill(awake, awake + n, 0);
+
+    flag_changed(awake, &x_[begin], &prevX_[begin], n);
+    flag_changed(awake, &y_[begin], &prevY_[begin], n);
+    flag_changed(awake, &angleX_[begin], &prevAngleX_[begin], n);
+    flag_changed(awake, &angleY_[begin], &prevAngleY_[begin], n);
+    flag_changed(awake, &angleZ_[begin], &prevAngleZ_[begin], n);
+
+    unsigned char* dirty = &dirty_[begin];
+    for (unsigned i = 0; i != n; ++i)
+        dirty[i] |= awake[i];
+}
+
+void sim::BallSystem::count_skins(unsigned begin, unsigned end, unsigned* counts) const
+{
+    for (unsigned i = begin; i != end; ++i)
+        ++counts[skin_[i]];
+}
+
+void sim::BallSystem::write_matrices(unsigned begin, unsigned end, float alpha, float* out, unsigned* offsets, unsigned* changed) const
+{
+    for (unsigned i = begin; i != end; ++i)
+    {
+        const unsigned skin = skin_[i];
+        const unsigned slot = offsets[skin]++;
+        if (dirty_[i] == 0) {
+            continue;
+        }
+
+        changed[2 * skin] = std::min(changed[2 * skin], slot);
+        changed[2 * skin + 1] = slot + 1;
+
+        // Up to date from now on if asleep; awake ones move on with alpha
+        dirty_[i] = awake_[i];
+
+        write_matrix(out + 16 * slot,
+                     lerp(prevX_[i], x_[i], alpha),
+                     lerp(prevY_[i], y_[i], alpha),
+                     lerp(prevAngleX_[i], angleX_[i], alpha),
+                     lerp(prevAngleY_[i], angleY_[i], alpha),
+                     lerp(prevAngleZ_[i], angleZ_[i], alpha));
+    }
+}
+
+bool sim::BallSystem::is_inside(float x, float y) const
+{
+    for (::size_t p = 0; p != planes_.size(); ++p)
+    {
+        if (x * planes_[p].nx + y * planes_[p].ny > planes_[p].d - BALL_RADIUS)
+            return false;
+    }
+
+    return true;
+}
+
+float sim::BallSystem::random()
+{
+    // xorshift32
+    seed_ ^= seed_ << 13;
+    seed_ ^= seed_ >> 17;
+    seed_ ^= seed_ << 5;
+    return (seed_ >> 8) * (1.0f / 16777216);
+}
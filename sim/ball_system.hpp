@@ -0,0 +1,174 @@
+#pragma once
+
+#ifndef SIM_BALL_SYSTEM_HPP
+#define SIM_BALL_SYSTEM_HPP
+
+#include <vector>
+
+#include "ball_grid.hpp"
+#include "cage.hpp"
+
+namespace sim {
+
+    class JobSystem;
+
+    /// struct wall_hit
+    /*! A ball bouncing off a wall face
+     */
+    struct wall_hit {
+        float x, y, z; ///> contact point, on the wall face
+        float nx, ny;  ///> wall face normal, pointing out of the cage
+        float speed;   ///> ball speed along the normal, units per second
+    };
+
+    //! class BallSystem
+    /*! Moving balls inside the cage, one array per component; stepped in
+     *! fixed ticks and drawn in between the last two
+     */
+    class BallSystem {
+    public:
+
+        /// # of ball skins
+        static const unsigned SKIN_COUNT = 3;
+
+        /// ctor.; balls bounce off the inner faces of a rectangular cage (see set_cage())
+        /// @param cageWidth cage dimension along x
+        /// @param cageLength cage dimension along y
+        BallSystem(float cageWidth, float cageLength);
+        /// @return the wall faces balls bounce off
+        const std::vector<cage_plane>& get_planes() const;
+        /// Reshapes the cage; balls left outside are moved in, onto the wall
+        void set_cage(const cage_shape& cage);
+        /// @return the cage shape
+        const cage_shape& get_cage() const;
+        /// Seeds the placement of balls added by resize()
+        void set_seed(unsigned seed);
+        /// Adds balls at random positions, or drops the last ones
+        /// @param count the new # of balls
+        void resize(unsigned count);
+        /// @return the # of balls
+        unsigned size() const;
+        /// Sets the speed of every ball along an axis; directions are kept,
+        /// also through a zero speed
+        /// @param axis 0 for x, 1 for y
+        /// @param speed units per second
+        void set_speed(unsigned axis, float speed);
+        /// Sets the turn rate of every ball about an axis
+        /// @param axis 0 for x, 1 for y, 2 for z
+        /// @param rate radians per second
+        void set_turn_rate(unsigned axis, float rate);
+        /// Splits updates and matrix building across threads
+        /// @param jobs must outlive this; null runs everything on the calling thread
+        void set_job_system(JobSystem* jobs);
+        /// Enables ball-vs-ball collisions
+        void set_collisions(bool state);
+        /// @return the # of ball pairs that bounced off each other in the last tick
+        unsigned get_contacts() const;
+        /// @return the balls that bounced off a wall in the last tick, in ball order
+        const std::vector<wall_hit>& get_wall_hits() const;
+        /// @return the # of balls that moved or turned in the last tick; the
+        /// others sleep, and build_matrices() skips them
+        unsigned get_active() const;
+        /// Sets the skin of every ball
+        /// @param skin [0, SKIN_COUNT)
+        void set_skin(unsigned skin);
+        /// Advances every ball by one tick
+        /// @param dt tick duration, in seconds
+        void update(float dt);
+        /// @return a hash of the simulation state; equal for bit-identical runs
+        unsigned long long get_checksum() const;
+        /// Writes model matrices (column-major, as uploaded), interpolated
+        /// between the last two ticks and grouped by skin; matrices of balls
+        /// asleep since the last call are left as they are
+        /// @param alpha interpolation factor, 0 for the previous tick, 1 for the last
+        /// @param out 16 floats per ball; holds the matrices of the last call
+        /// @param counts [out] the # of matrices per skin, in order
+        /// @param changed [out] per skin, the first and one past the last
+        /// matrix rewritten, from the start of the skin group; equal if none
+        void build_matrices(float alpha, float* out, unsigned* counts, unsigned* changed) const;
+
+    private:
+
+        struct advance_job;
+        struct skin_job;
+        struct matrix_job;
+
+        // Helper
+        // Moves and turns balls [begin, end) by one tick
+        void advance(unsigned begin, unsigned end, float dt);
+        // Helper
+        // Counts the skins of balls [begin, end)
+        void count_skins(unsigned begin, unsigned end, unsigned* counts) const;
+        // Helper
+        // Writes the matrices of balls [begin, end)
+        // @param offsets [in, out] next matrix of each skin group
+        // @param changed [in, out] first and one past the last matrix rewritten, per skin
+        void write_matrices(unsigned begin, unsigned end, float alpha, float* out, unsigned* offsets, unsigned* changed) const;
+        // Helper
+        // Records ball i bouncing off plane
+        void add_wall_hit(unsigned i, const cage_plane& plane);
+        // Helper
+        // Bounces touching balls off each other
+        void collide();
+
+        // Helper
+        // @return a random float in [0, 1)
+        float random();
+        // Helper
+        // @return true if a ball centered on (x, y) is clear of every wall face
+        bool is_inside(float x, float y) const;
+
+        // Cage shape
+        cage_shape cage_;
+        // Wall faces
+        std::vector<cage_plane> planes_;
+        // Bounds of ball centers
+        float maxX_, maxY_;
+
+        // Speed and turn rate given to new balls
+        float speed_[2];
+        float turnRate_[3];
+        // Random state
+        unsigned seed_;
+
+        // Runs chunks of updates; null if single-threaded
+        JobSystem* jobs_;
+        // Skin counts per chunk, then matrix offsets per chunk (see build_matrices())
+        mutable std::vector<unsigned> chunkSkins_;
+        // Matrices rewritten per chunk (see build_matrices())
+        mutable std::vector<unsigned> chunkChanged_;
+
+        // Broad phase
+        BallGrid grid_;
+        // Collision status
+        bool collisions_;
+        // Pairs that bounced in the last tick
+        unsigned contacts_;
+        // Balls that moved or turned in the last tick
+        unsigned active_;
+        // Wall bounces in the last tick
+        std::vector<wall_hit> hits_;
+
+        // Positions, at the last and previous ticks
+        std::vector<float> x_, y_;
+        std::vector<float> prevX_, prevY_;
+        // Velocities, units per second
+        std::vector<float> vx_, vy_;
+        // Rotation angles, at the last and previous ticks
+        std::vector<float> angleX_, angleY_, angleZ_;
+        std::vector<float> prevAngleX_, prevAngleY_, prevAngleZ_;
+        // Angular velocities, radians per second
+        std::vector<float> spinX_, spinY_, spinZ_;
+        // Skins
+        std::vector<unsigned char> skin_;
+        // Moved or turned in the last tick
+        std::vector<unsigned char> awake_;
+        // Last wall plane bounced off in the last tick, plus 1; 0 if none
+        std::vector<unsigned char> wallHit_;
+        // Matrix out of date with the last build_matrices(); cleared once
+        // written for a ball asleep
+        mutable std::vector<unsigned char> dirty_;
+    };
+}
+
+#endif
@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <cmath>
+
+#include "cage.hpp"
+#include "matrix_operation.hpp"
+#include "matrix_transform.hpp"
+
+namespace {
+
+    // Wall box side
+    const float BOX_SIZE = 3;
+    // Inner faces of a rectangle's wall, from the cage outline; polygons
+    // fit inside the same
+    const float WALL_INSET = 2.5;
+
+    // Helper
+    // Faces of a regular polygon around the unit circle, stretched to the
+    // inner half-extents a x b; face k faces 2 * PI * k / sides
+    inline sim::cage_plane polygon_plane(unsigned k, unsigned sides, float a, float b)
+    {
+        const float theta = 2 * calc::PI * k / sides;
+
+        // Stretching x by a scales the normal's x by 1 / a
+        const float nx = std::cos(theta) / a;
+        const float ny = std::sin(theta) / b;
+        const float n = std::sqrt(nx * nx + ny * ny);
+
+        sim::cage_plane plane = { nx / n, ny / n, 1 / n };
+        return plane;
+    }
+
+    // Helper
+    // Corner of a regular polygon, between faces k and k + 1, stretched
+    inline void polygon_corner(unsigned k, unsigned sides, float a, float b, float& x, float& y)
+    {
+        const float phi = 2 * calc::PI * (k + 0.5f) / sides;
+        const float r = 1 / std::cos(calc::PI / sides);
+        x = a * r * std::cos(phi);
+        y = b * r * std::sin(phi);
+    }
+
+    // Helper
+    // Stretches a regular polygon to fit the inner faces of a cage
+    // @param a, b [out] half-extents of the circle the polygon is around
+    inline void polygon_scale(const sim::cage_shape& cage, float& a, float& b)
+    {
+        float maxX = 0, maxY = 0;
+        for (unsigned k = 0; k != cage.sides; ++k)
+        {
+            float x, y;
+            polygon_corner(k, cage.sides, 1, 1, x, y);
+            maxX = std::max(maxX, std::abs(x));
+            maxY = std::max(maxY, std::abs(y));
+        }
+
+        a = (cage.width / 2 - WALL_INSET) / maxX;
+        b = (cage.length / 2 - WALL_INSET) / maxY;
+    }
+
+    // Helper
+    // @return the model matrix (column-major) of a wall box; (tx, ty) is
+    // the unit direction of its length, on the floor
+    inline calc::mat4f build_box(float x, float y, float tx, float ty, float length)
+    {
+        calc::mat4f mat = calc::mat4f::identity();
+        mat[0][0] = tx * length;
+        mat[1][0] = ty * length;
+        mat[0][1] = -ty * BOX_SIZE;
+        mat[1][1] = tx * BOX_SIZE;
+
+        mat[0][3] = x;
+        mat[1][3] = y;
+        mat[2][3] = -1.0;
+        return calc::transpose(mat);
+    }
+}
+
+std::vector<calc::mat4f> sim::build_wall(int width, int length)
+{
+    std::vector<calc::mat4f> wall;
+
+    // West wall
+    for (int i = 1 - length / 2 / 3; i != length / 2 / 3; ++i)
+    {
+        calc::mat4f mat = calc::mat4f::identity();
+        mat[0][0] = 3;
+        mat[1][1] = 3;
+
+        mat[0][3] = width / 2 - 1;
+        mat[1][3] = i * 3;
+        mat[2][3] = -1.0;
+        wall.push_back(calc::transpose(mat));
+    }
+
+    // East wall
+    for (int i = 1 - length / 2 / 3; i != length / 2 / 3; ++i)
+    {
+        calc::mat4f mat = calc::mat4f::identity();
+        mat[0][0] = 3;
+        mat[1][1] = 3;
+
+        mat[0][3] = 1 - width / 2;
+        mat[1][3] = i * 3;
+        mat[2][3] = -1.0;
+        wall.push_back(calc::transpose(mat));
+    }
+
+    // North wall
+    for (int i = 1 - width / 2 / 3; i != width / 2 / 3; ++i)
+    {
+        calc::mat4f mat = calc::mat4f::identity();
+        mat[0][0] = 3;
+        mat[1][1] = 3;
+
+        mat[0][3] = i * 3;
+        mat[1][3] = length / 2 - 1;
+        mat[2][3] = -1.0;
+        wall.push_back(calc::transpose(mat));
+    }
+
+    // South wall
+    for (int i = 1 - width / 2 / 3; i != width / 2 / 3; ++i)
+    {
+        calc::mat4f mat = calc::mat4f::identity();
+        mat[0][0] = 3;
+        mat[1][1] = 3;
+
+        mat[0][3] = i * 3;
+        mat[1][3] = 1 - length / 2;
+        mat[2][3] = -1.0;
+        wall.push_back(calc::transpose(mat));
+    }
+
+    return wall;
+}
+
+std::vector<calc::mat4f> sim::build_wall(const cage_shape& cage)
+{
+    if (cage.sides == 4) {
+        return build_wall(int(cage.width), int(cage.length));
+    }
+
+    std::vector<calc::mat4f> wall;
+
+    float a, b;
+    polygon_scale(cage, a, b);
+
+    for (unsigned k = 0; k != cage.sides; ++k)
+    {
+        const cage_plane plane = polygon_plane(k, cage.sides, a, b);
+
+        // Face k runs between the corners either side of it
+        float x0, y0, x1, y1;
+        polygon_corner(k + cage.sides - 1, cage.sides, a, b, x0, y0);
+        polygon_corner(k, cage.sides, a, b, x1, y1);
+
+        const float length = std::sqrt((x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0));
+        const float tx = (x1 - x0) / length;
+        const float ty = (y1 - y0) / length;
+
+        // Boxes of at most BOX_SIZE along the face, just outside it
+        const unsigned count = std::max(1, (int)std::ceil(length / BOX_SIZE));
+        const float step = length / count;
+        for (unsigned i = 0; i != count; ++i)
+        {
+            const float t = step * (i + 0.5f);
+            wall.push_back(build_box(x0 + tx * t + plane.nx * BOX_SIZE / 2,
+                                     y0 + ty * t + plane.ny * BOX_SIZE / 2,
+                                     tx, ty, step));
+        }
+
+        // Corner box, filling the gap between this face's boxes and the next's
+        const cage_plane next = polygon_plane((k + 1) % cage.sides, cage.sides, a, b);
+        const float cx = plane.nx + next.nx;
+        const float cy = plane.ny + next.ny;
+        const float c = std::sqrt(cx * cx + cy * cy);
+        wall.push_back(build_box(x1 + cx / c * BOX_SIZE / 2,
+                                 y1 + cy / c * BOX_SIZE / 2,
+                                 -cy / c, cx / c, BOX_SIZE));
+    }
+
+    return wall;
+}
+
+std::vector<sim::cage_plane> sim::build_cage_planes(const cage_shape& cage)
+{
+    if (cage.sides == 4)
+    {
+        // Inner faces of the boxes of build_wall(), west, east, north, south
+        const float dx = int(cage.width) / 2 - WALL_INSET;
+        const float dy = int(cage.length) / 2 - WALL_INSET;
+        const cage_plane rectangle[] = { { 1, 0, dx }, { -1, 0, dx }, { 0, 1, dy }, { 0, -1, dy } };
+        return std::vector<cage_plane>(rectangle, rectangle + 4);
+    }
+
+    std::vector<cage_plane> planes;
+
+    float a, b;
+    polygon_scale(cage, a, b);
+    for (unsigned k = 0; k != cage.sides; ++k)
+        planes.push_back(polygon_plane(k, cage.sides, a, b));
+
+    return planes;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#ifndef SIM_CAGE_HPP
+#define SIM_CAGE_HPP
+
+#include <vector>
+
+#include "matrix.hpp"
+
+namespace sim {
+
+    /// struct cage_plane
+    /*! Inner face of a cage wall; points p inside the cage satisfy
+     *! nx * p.x + ny * p.y <= d, with (nx, ny) of unit length
+     */
+    struct cage_plane { float nx, ny, d; };
+
+    /// struct cage_shape
+    /*! Cage outline, walls included; 4 sides make a rectangle of 3 x 3
+     *! wall boxes (see build_wall()), any other # a regular polygon
+     *! stretched to width x length
+     */
+    struct cage_shape { float width, length; unsigned sides; };
+
+    /// @return the model matrices (column-major) of the 3 x 3 wall boxes
+    /// around a width x length cage
+    std::vector<calc::mat4f> build_wall(int width, int length);
+
+    /// @return the model matrices (column-major) of the wall boxes around a cage
+    std::vector<calc::mat4f> build_wall(const cage_shape& cage);
+
+    /// @return the inner faces of the wall around a cage, one per side
+    std::vector<cage_plane> build_cage_planes(const cage_shape& cage);
+}
+
+#endif
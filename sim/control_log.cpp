@@ -0,0 +1,214 @@
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "ball_system.hpp"
+#include "control_log.hpp"
+
+namespace {
+
+    /// struct log_header
+    /*! Control log file header, followed by the controls
+     */
+    struct log_header { char magic[4]; unsigned version, seed, length, count; };
+
+    // Helper
+    // Appends n as a LEB128 varint
+    inline void put_varint(std::vector<unsigned char>& out, unsigned n)
+    {
+        for ( ; n >= 0x80; n >>= 7)
+            out.push_back((n & 0x7f) | 0x80);
+        out.push_back(n);
+    }
+
+    // Helper
+    // @return false past the end of the data
+    inline bool get_varint(const unsigned char*& p, const unsigned char* end, unsigned& n /* [out] */)
+    {
+        n = 0;
+        for (unsigned shift = 0; p != end && shift < 32; shift += 7)
+        {
+            const unsigned char b = *p++;
+            n |= (unsigned)(b & 0x7f) << shift;
+            if ((b & 0x80) == 0)
+                return true;
+        }
+
+        return false;
+    }
+}
+
+sim::ControlLog::ControlLog() : seed_(0)
+                         , length_(0) {}
+
+void sim::ControlLog::clear(unsigned seed)
+{
+    seed_ = seed;
+    length_ = 0;
+    controls_.clear();
+}
+
+void sim::ControlLog::push_back(const control& c) {
+    controls_.push_back(c);
+}
+
+void sim::ControlLog::set_length(unsigned ticks) {
+    length_ = ticks;
+}
+
+unsigned sim::ControlLog::get_length() const {
+    return length_;
+}
+
+unsigned sim::ControlLog::get_seed() const {
+    return seed_;
+}
+
+const std::vector<sim::control>& sim::ControlLog::get_controls() const {
+    return controls_;
+}
+
+bool sim::ControlLog::save(const char* path) const
+{
+    // Tick delta, command and axis in one byte, then the value's bits
+    std::vector<unsigned char> data;
+    for (::size_t i = 0, tick = 0; i != controls_.size(); tick = controls_[i++].tick)
+    {
+        put_varint(data, controls_[i].tick - tick);
+        data.push_back(controls_[i].command | controls_[i].axis << 4);
+
+        unsigned char value[sizeof(float)];
+        ::memcpy(value, &controls_[i].value, sizeof(float));
+        data.insert(data.end(), value, value + sizeof(float));
+    }
+
+    const log_header header = { { 'B', 'G', 'L', 'R' }, 1, seed_, length_, (unsigned)controls_.size() };
+
+    FILE* file = ::fopen(path, "wb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    const bool ok = ::fwrite(&header, sizeof(header), 1, file) == 1 &&
+                    (data.empty() || ::fwrite(&data[0], 1, data.size(), file) == data.size());
+    return ::fclose(file) == 0 && ok;
+}
+
+bool sim::ControlLog::load(const char* path)
+{
+    clear(0);
+
+    FILE* file = ::fopen(path, "rb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    log_header header;
+    std::vector<unsigned char> data;
+
+    bool ok = ::fread(&header, sizeof(header), 1, file) == 1 &&
+              ::memcmp(header.magic, "BGLR", 4) == 0 &&
+              header.version == 1;
+
+    // The rest of the file
+    unsigned char buf[4096];
+    for (::size_t n; ok && (n = ::fread(buf, 1, sizeof(buf), file)) != 0; )
+        data.insert(data.end(), buf, buf + n);
+
+    ::fclose(file);
+
+    const unsigned char* p = data.data();
+    const unsigned char* end = p + data.size();
+
+    for (unsigned i = 0, tick = 0; ok && i != header.count; ++i)
+    {
+        unsigned delta;
+        ok = get_varint(p, end, delta) && end - p >= 1 + (int)sizeof(float);
+        if (!ok) {
+            break;
+        }
+
+        control c;
+        c.tick = (tick += delta);
+        c.command = *p & 0x0f;
+        c.axis = *p++ >> 4;
+        ::memcpy(&c.value, p, sizeof(float));
+        p += sizeof(float);
+
+        // Corrupt or edited; would index past the balls' arrays or stall the tick
+        ok = is_valid(c);
+        controls_.push_back(c);
+    }
+
+    if (!ok) {
+        return (clear(0), false);
+    }
+
+    seed_ = header.seed;
+    length_ = header.length;
+    return true;
+}
+
+bool sim::is_valid(const control& c)
+{
+    // NaN fails every comparison; infinities are past every range
+    const float v = c.value;
+    const bool whole = v == std::floor(v);
+
+    switch (c.command)
+    {
+        case BALL_COUNT:
+            return c.axis == 0 && whole && v >= 0 && v <= MAX_BALLS;
+        case SPEED:
+            return c.axis < 2 && v >= 0 && v <= MAX_SPEED;
+        case TURN_RATE:
+            return c.axis < 3 && v >= 0 && v <= MAX_TURN_RATE;
+        case SKIN:
+            return c.axis == 0 && whole && v >= 0 && v < BallSystem::SKIN_COUNT;
+        case COLLISIONS:
+            return c.axis == 0 && (v == 0 || v == 1);
+        case TICK_RATE:
+            return c.axis == 0 && v >= MIN_TICK_RATE && v <= MAX_TICK_RATE;
+        case CAGE:
+            if (c.axis == 2)
+                return whole && v >= MIN_CAGE_SIDES && v <= MAX_CAGE_SIDES;
+            return c.axis < 2 && v >= MIN_CAGE_SIZE && v <= MAX_CAGE_SIZE;
+    }
+
+    return false;
+}
+
+void sim::apply_control(BallSystem& balls, const control& c)
+{
+    switch (c.command)
+    {
+        case BALL_COUNT:
+            balls.resize(c.value);
+            break;
+        case SPEED:
+            balls.set_speed(c.axis, c.value);
+            break;
+        case TURN_RATE:
+            balls.set_turn_rate(c.axis, c.value);
+            break;
+        case SKIN:
+            balls.set_skin(c.value);
+            break;
+        case COLLISIONS:
+            balls.set_collisions(c.value != 0);
+            break;
+        case CAGE:
+        {
+            cage_shape cage = balls.get_cage();
+            if (c.axis == 0)
+                cage.width = c.value;
+            else if (c.axis == 1)
+                cage.length = c.value;
+            else
+                cage.sides = c.value;
+
+            balls.set_cage(cage);
+            break;
+        }
+    }
+}
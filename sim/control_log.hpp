@@ -0,0 +1,84 @@
+#pragma once
+
+#ifndef SIM_CONTROL_LOG_HPP
+#define SIM_CONTROL_LOG_HPP
+
+#include <vector>
+
+namespace sim {
+
+    class BallSystem;
+
+    /// Simulation controls; everything that changes the simulation besides ticking it
+    enum control_command {
+        BALL_COUNT = 0, ///> value: # of balls
+        SPEED      = 1, ///> axis 0-1, value: units per second
+        TURN_RATE  = 2, ///> axis 0-2, value: radians per second
+        SKIN       = 3, ///> value: skin index
+        COLLISIONS = 4, ///> value: 0 or 1
+        TICK_RATE  = 5, ///> value: ticks per second
+        CAGE       = 6  ///> axis 0 width, 1 length, value: units;
+                        ///> axis 2 sides, value: 4 for a rectangle, or a polygon's
+    };
+
+    /// Control value ranges (see is_valid()); the app clamps its controls
+    /// to them, and logs past them are rejected
+    const unsigned MAX_BALLS      = 100000;
+    const float    MAX_SPEED      = 12;   ///> units per second
+    const float    MAX_TURN_RATE  = 4.5;  ///> radians per second; the controls go up to 250 degrees
+    const unsigned MIN_TICK_RATE  = 10;
+    const unsigned MAX_TICK_RATE  = 240;
+    const unsigned MIN_CAGE_SIZE  = 12;   ///> walls included
+    const unsigned MAX_CAGE_SIZE  = 120;
+    const unsigned MIN_CAGE_SIDES = 3;
+    const unsigned MAX_CAGE_SIDES = 12;
+
+    /// struct control
+    /*! Control applied before the given tick
+     */
+    struct control { unsigned tick, command, axis; float value; };
+
+    //! class ControlLog
+    /*! Controls by tick, for replaying a simulation exactly; saved as a
+     *! compact binary file (tick deltas as varints, then command and value)
+     */
+    class ControlLog {
+    public:
+        /// ctor.
+        ControlLog();
+        /// Empties the log
+        /// @param seed the simulation's random seed
+        void clear(unsigned seed);
+        /// @param c control; ticks must not decrease
+        void push_back(const control& c);
+        /// @param ticks the # of ticks the log covers
+        void set_length(unsigned ticks);
+        /// @return the # of ticks the log covers
+        unsigned get_length() const;
+        /// @return the simulation's random seed
+        unsigned get_seed() const;
+        /// @return the controls, by tick
+        const std::vector<control>& get_controls() const;
+        /// @return false on write error
+        bool save(const char* path) const;
+        /// @return false on read error, if the file is not a control log, or
+        /// if any of its controls is not valid (see is_valid()); the log is
+        /// then left empty
+        bool load(const char* path);
+
+    private:
+
+        unsigned seed_;
+        unsigned length_;
+        std::vector<control> controls_;
+    };
+
+    /// @return true for a known command, with an axis it has and a finite
+    /// value within its range
+    bool is_valid(const control& c);
+
+    /// Applies a valid control to balls; TICK_RATE is left to the caller
+    void apply_control(BallSystem& balls, const control& c);
+}
+
+#endif
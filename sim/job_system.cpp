@@ -0,0 +1,137 @@
+#include <algorithm>
+
+#include "job_system.hpp"
+
+sim::JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+
+    cond_.notify_all();
+    for (::size_t i = 0; i != workers_.size(); ++i)
+        workers_[i].join();
+}
+
+sim::JobSystem::JobSystem(unsigned workerCount) : pending_(0)
+                                           , generation_(0)
+                                           , stop_(false)
+{
+    if (workerCount == 0) {
+        // Together with the image decoders (up to 4), fits the wasm thread pool (see runemcc)
+        workerCount = std::min(3u, std::max(1u, std::thread::hardware_concurrency()) - 1);
+    }
+
+    for (unsigned i = 0; i != workerCount + 1; ++i)
+        queues_.push_back(std::unique_ptr<queue>(new queue()));
+
+    for (unsigned i = 1; i != workerCount + 1; ++i)
+        workers_.push_back(std::thread(&sim::JobSystem::run, this, i));
+}
+
+unsigned sim::JobSystem::get_thread_count() const {
+    return queues_.size();
+}
+
+void sim::JobSystem::run_all(void (*run)(void*, unsigned, unsigned), void* job, unsigned count, unsigned chunk)
+{
+    chunk = std::max(chunk, 1u);
+
+    // Not worth waking anyone
+    if (workers_.empty() || count <= chunk)
+    {
+        for (unsigned begin = 0; begin < count; begin += chunk)
+            run(job, begin, std::min(count, begin + chunk));
+        return;
+    }
+
+    const unsigned chunks = (count + chunk - 1) / chunk;
+    pending_ += chunks;
+
+    // Contiguous runs of chunks per thread; stealing evens out the rest
+    const unsigned threads = queues_.size();
+    for (unsigned t = 0; t != threads; ++t)
+    {
+        queue& q = *queues_[t];
+        std::lock_guard<std::mutex> lock(q.mutex);
+
+        for (unsigned c = chunks * t / threads; c != chunks * (t + 1) / threads; ++c)
+        {
+            const task tsk = { run, job, c * chunk, std::min(count, (c + 1) * chunk) };
+            q.tasks.push_back(tsk);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++generation_;
+    }
+    cond_.notify_all();
+
+    // Work along until the last chunk is done
+    while (pending_ != 0)
+    {
+        if (!run_one(0))
+            std::this_thread::yield();
+    }
+}
+
+bool sim::JobSystem::run_one(unsigned self)
+{
+    task tsk;
+    bool found = false;
+
+    // Own queue first, newest chunk
+    {
+        queue& q = *queues_[self];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (!q.tasks.empty())
+        {
+            tsk = q.tasks.back();
+            q.tasks.pop_back();
+            found = true;
+        }
+    }
+
+    // Then steal the oldest chunk of another thread
+    for (unsigned i = 1; !found && i != queues_.size(); ++i)
+    {
+        queue& q = *queues_[(self + i) % queues_.size()];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (!q.tasks.empty())
+        {
+            tsk = q.tasks.front();
+            q.tasks.pop_front();
+            found = true;
+        }
+    }
+
+    if (!found) {
+        return false;
+    }
+
+    tsk.run(tsk.job, tsk.begin, tsk.end);
+    --pending_;
+    return true;
+}
+
+void sim::JobSystem::run(unsigned self)
+{
+    unsigned seen = 0;
+
+    for (;;)
+    {
+        while (run_one(self)) {}
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stop_ && generation_ == seen)
+            cond_.wait(lock);
+
+        if (stop_) {
+            return;
+        }
+
+        seen = generation_;
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#ifndef SIM_JOB_SYSTEM_HPP
+#define SIM_JOB_SYSTEM_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sim {
+
+    //! class JobSystem
+    /*! Splits loops into chunks run across worker threads (pthreads in wasm
+     *! builds) and the calling thread; each thread has its own chunk queue and
+     *! steals from the others once it runs dry
+     */
+    class JobSystem {
+    public:
+
+        /// dtor.
+        ~JobSystem();
+        /// ctor.
+        /// @param workerCount the # of worker threads, besides the calling one;
+        /// 0 picks one per extra core (max. 3)
+        explicit JobSystem(unsigned workerCount = 0);
+        /// @return the # of threads running chunks, including the calling one
+        unsigned get_thread_count() const;
+        /// Calls job(begin, end) once per chunk of [0, count), and returns once
+        /// all have run; job must be safe to call concurrently on disjoint chunks
+        /// @param chunk the # of items per call; chunks begin at multiples of it
+        template <typename F__>
+        void parallel_for(unsigned count, unsigned chunk, F__& job);
+
+    private:
+
+        /// struct task
+        /*! One chunk of a parallel_for()
+         */
+        struct task { void (*run)(void*, unsigned, unsigned); void* job; unsigned begin, end; };
+
+        /// struct queue
+        /*! Chunks queued for a thread; the owner pops from the back,
+         *! thieves take from the front
+         */
+        struct queue { std::mutex mutex; std::deque<task> tasks; };
+
+        // Helper
+        template <typename F__>
+        static void invoke(void* job, unsigned begin, unsigned end) {
+            (*static_cast<F__*>(job))(begin, end);
+        }
+
+        // Helper
+        // Queues the chunks of a parallel_for() and works until all have run
+        void run_all(void (*run)(void*, unsigned, unsigned), void* job, unsigned count, unsigned chunk);
+        // Helper
+        // Runs one chunk, queued for thread self or stolen
+        // @return false if no chunk was left
+        bool run_one(unsigned self);
+        // Helper
+        // Worker thread entry point
+        void run(unsigned self);
+
+        JobSystem(const JobSystem&);
+        JobSystem& operator=(const JobSystem&);
+
+        // Chunk queues; the calling thread's first
+        std::vector<std::unique_ptr<queue> > queues_;
+        // Chunks queued or running
+        std::atomic<unsigned> pending_;
+
+        // Guards the fields below
+        std::mutex mutex_;
+        // Signalled when chunks are queued or on shutdown
+        std::condition_variable cond_;
+        // Incremented by each parallel_for()
+        unsigned generation_;
+        // Set on destruction
+        bool stop_;
+
+        std::vector<std::thread> workers_;
+    };
+
+    template <typename F__>
+    void JobSystem::parallel_for(unsigned count, unsigned chunk, F__& job) {
+        run_all(&JobSystem::invoke<F__>, &job, count, chunk);
+    }
+}
+
+#endif
@@ -0,0 +1,80 @@
+#include "simulation.hpp"
+
+const unsigned sim::Simulation::DEFAULT_TICK_RATE;
+
+sim::Simulation::Simulation(float cageWidth, float cageLength, unsigned seed, JobSystem* jobs) : balls_(cageWidth, cageLength)
+                                                                                               , tick_(0)
+                                                                                               , tickDuration_(1.0 / DEFAULT_TICK_RATE)
+                                                                                               , recording_(nullptr)
+                                                                                               , playing_(nullptr)
+                                                                                               , next_(0)
+{
+    balls_.set_seed(seed);
+    balls_.set_job_system(jobs);
+}
+
+void sim::Simulation::apply(unsigned command, unsigned axis, float value)
+{
+    const control c = { tick_, command, axis, value };
+    if (!is_valid(c)) {
+        return;
+    }
+
+    if (recording_ != nullptr) {
+        recording_->push_back(c);
+    }
+
+    apply(c);
+}
+
+void sim::Simulation::record(ControlLog* log) {
+    recording_ = log;
+}
+
+void sim::Simulation::play(const ControlLog& log)
+{
+    playing_ = &log;
+    next_ = 0;
+}
+
+bool sim::Simulation::is_playing() const {
+    return playing_ != nullptr && tick_ < playing_->get_length();
+}
+
+void sim::Simulation::step()
+{
+    // Controls replayed for this tick
+    if (playing_ != nullptr)
+    {
+        const std::vector<control>& controls = playing_->get_controls();
+        for ( ; next_ != controls.size() && controls[next_].tick <= tick_; ++next_)
+            apply(controls[next_]);
+    }
+
+    balls_.update(tickDuration_);
+    ++tick_;
+}
+
+unsigned sim::Simulation::get_tick() const {
+    return tick_;
+}
+
+double sim::Simulation::get_tick_duration() const {
+    return tickDuration_;
+}
+
+sim::BallSystem& sim::Simulation::get_balls() {
+    return balls_;
+}
+
+const sim::BallSystem& sim::Simulation::get_balls() const {
+    return balls_;
+}
+
+void sim::Simulation::apply(const control& c)
+{
+    if (c.command == TICK_RATE)
+        tickDuration_ = 1.0 / c.value;
+    else
+        apply_control(balls_, c);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#ifndef SIM_SIMULATION_HPP
+#define SIM_SIMULATION_HPP
+
+#include "ball_system.hpp"
+#include "control_log.hpp"
+
+namespace sim {
+
+    class JobSystem;
+
+    //! class Simulation
+    /*! Balls in a cage, stepped in fixed ticks and driven by controls;
+     *! no GL or SDL, so it runs headless as well as behind the renderer
+     */
+    class Simulation {
+    public:
+
+        /// Tick rate until a TICK_RATE control
+        static const unsigned DEFAULT_TICK_RATE = 60;
+
+        /// ctor.; starts at tick 0, with no balls
+        /// @param cageWidth cage dimension along x
+        /// @param cageLength cage dimension along y
+        /// @param seed seeds ball placement
+        /// @param jobs splits ticks across threads; must outlive this, may be null
+        Simulation(float cageWidth, float cageLength, unsigned seed, JobSystem* jobs = nullptr);
+        /// Applies a control before the next tick, and records it if recording;
+        /// controls that are not valid (see is_valid()) are dropped
+        void apply(unsigned command, unsigned axis, float value);
+        /// Records every control applied from now on
+        /// @param log must outlive recording; null stops recording
+        void record(ControlLog* log);
+        /// Applies the controls of log at their ticks, from tick 0; the
+        /// simulation must not have ticked yet
+        /// @param log must outlive the replay
+        void play(const ControlLog& log);
+        /// @return true while replaying a log; until its last tick
+        bool is_playing() const;
+        /// Advances the simulation by one tick
+        void step();
+        /// @return the # of ticks run
+        unsigned get_tick() const;
+        /// @return the tick duration, in seconds
+        double get_tick_duration() const;
+        /// @return the balls
+        BallSystem& get_balls();
+        /// @return the balls
+        const BallSystem& get_balls() const;
+
+    private:
+
+        // Helper
+        void apply(const control& c);
+
+        BallSystem balls_;
+        // Ticks run
+        unsigned tick_;
+        // Tick duration, in seconds
+        double tickDuration_;
+
+        // Log being recorded, if any
+        ControlLog* recording_;
+        // Log being replayed, if any, and its next control
+        const ControlLog* playing_;
+        ::size_t next_;
+    };
+}
+
+#endif
@@ -4,6 +4,7 @@
 #include <EGL/egl.h>
 
 #include "square.hpp"
+#include "gl_state.hpp"
 #include "texture.hpp"
 
 namespace {
@@ -28,46 +29,31 @@ render::Square::Square(const unsigned* taoSrc, unsigned taoCount, unsigned insta
 
     // Initialize OpenGL buffers
     glGenVertexArrays(1, &vbo_.mesh);
-    glBindVertexArray(vbo_.mesh);
+    render::state::bind_vertex_array(vbo_.mesh);
 
     glGenBuffers(1, &vbo_.vertex);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo_.vertex);
+    render::state::bind_array_buffer(vbo_.vertex);
 
     // Add vertices
     glBufferData(GL_ARRAY_BUFFER, sizeof(VERTICES__), VERTICES__, GL_STATIC_DRAW);
 
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(0));
+    glEnableVertexAttribArray(POSITION_ATTRIB);
+    glVertexAttribPointer(POSITION_ATTRIB, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(0));
 
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(TEXCOORD_ATTRIB);
+    glVertexAttribPointer(TEXCOORD_ATTRIB, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
 
     // Instancing
     glGenBuffers(1, &vbo_.instance);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo_.instance);
+    render::state::bind_array_buffer(vbo_.instance);
 
     // Null buffer
     glBufferData(GL_ARRAY_BUFFER, instanceSizeMax * 16 * sizeof(float), nullptr, GL_STREAM_DRAW);
 
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, 16 * sizeof(float), (void*)(0));
+    render::enable_instance_matrix();
 
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 16 * sizeof(float), (void*)(4  * sizeof(float)));
-
-    glEnableVertexAttribArray(4);
-    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, 16 * sizeof(float), (void*)(8  * sizeof(float)));
-
-    glEnableVertexAttribArray(5);
-    glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, 16 * sizeof(float), (void*)(12 * sizeof(float)));
-
-    glVertexAttribDivisor(2, 1);
-    glVertexAttribDivisor(3, 1);
-    glVertexAttribDivisor(4, 1);
-    glVertexAttribDivisor(5, 1);
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    render::state::bind_array_buffer(0);
+    render::state::bind_vertex_array(0);
 }
 
 void render::Square::draw() const
@@ -75,16 +61,10 @@ void render::Square::draw() const
     static const unsigned vertexSize = sizeof(VERTICES__) / sizeof(float) / 5;
 
     // Load textures...
-    glBindVertexArray(0);
-    glBindVertexArray(vbo_.mesh);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    render::state::bind_vertex_array(vbo_.mesh);
 
-    unsigned i = 0;
-    for ( ; i != tao_.size; ++i)
-    {
-        glActiveTexture(GL_TEXTURE0 + i);
-        glBindTexture(GL_TEXTURE_2D, tao_.tao[i]);
-    }
+    // Repeated textures are bound once and sampled by single-texture programs
+    render::bind_textures(tao_.tao, tao_.size);
 
     // glClear(GL_STENCIL_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     // glPolygonMode(GL_FRONT_AND_BACK, GL_TRIANGLES);
@@ -94,6 +74,14 @@ void render::Square::draw() const
     glDrawArraysInstanced(GL_TRIANGLES, 0, vertexSize, vbo_.instanceCount);
 }
 
+unsigned render::Square::get_vertex_array() const {
+    return vbo_.mesh;
+}
+
+unsigned render::Square::get_texture_count() const {
+    return render::count_textures(tao_.tao, tao_.size);
+}
+
 void render::Square::modify(const float* mat, unsigned instanceIndex)
 {
     render::modify(vbo_, mat, instanceIndex);
@@ -104,10 +92,19 @@ void render::Square::modify(const float* mat, unsigned* instanceIndices, unsigne
     render::modify(vbo_, mat, instanceIndices, count);
 }
 
+void render::Square::modify_range(const float* mat, unsigned first, unsigned count)
+{
+    render::modify_range(vbo_, mat, first, count);
+}
+
 void render::Square::reset(const float* mat, unsigned count) {
     render::reset(vbo_, mat, count);
 }
 
+void render::Square::resize(unsigned count) {
+    render::resize(vbo_, count);
+}
+
 void render::Square::push_back(const float* mat) {
     render::push_back(vbo_, mat);
 }
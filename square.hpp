@@ -14,19 +14,27 @@ namespace render {
         /// ctor.
         Square() {}
         /// ctor.
-        /// @param taoSrc texture handle array
+        /// @param taoSrc texture handle array (see render::register_texture())
         /// @param taoCount taoSrc size
         /// @param instanceSizeMax the maximum # of instances to allocate
         Square(const unsigned* taoSrc, unsigned taoCount, unsigned instanceSizeMax);
         /// @override
         void draw() const;
         /// @override
+        unsigned get_vertex_array() const;
+        /// @override
+        unsigned get_texture_count() const;
+        /// @override
         void modify(const float* mat, unsigned  instanceIndex);
         /// @override
         void modify(const float* mat, unsigned* instanceIndices, unsigned count);
         /// @override
+        void modify_range(const float* mat, unsigned first, unsigned count);
+        /// @override
         void reset(const float* mat, unsigned count);
         /// @override
+        void resize(unsigned count);
+        /// @override
         void push_back(const float* mat);
         /// @override
         void push_back(const float* mat, unsigned count);
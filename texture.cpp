@@ -1,107 +1,428 @@
-#include <cstdlib>
+#include <algorithm>
 #include <cstring>
-#include <new>
+#include <cstdio>
+#include <string>
+#include <vector>
 
 #include <GLES3/gl3.h>
 #include <EGL/egl.h>
 
-#include "stb/stb_image.h"
-
+#include "asset_pack.hpp"
+#include "gl_state.hpp"
+#include "image_decoder.hpp"
 #include "texture.hpp"
 
 namespace {
 
-    struct texture {
-
-        int width;
-        int height;
-        int nchannels;
+#ifndef GL_TEXTURE_MAX_ANISOTROPY_EXT
+#define GL_TEXTURE_MAX_ANISOTROPY_EXT 0x84FE
+#endif
 
-        ::size_t buffsize;
-        unsigned char* data;
+#ifndef GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT
+#define GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT 0x84FF
+#endif
 
-        // @dtor.
-        ~texture() {
-            ::free(data);
+    // Helper
+    inline int to_gl_wrap(render::sampler::wrap_mode mode)
+    {
+        switch (mode)
+        {
+            case render::sampler::REPEAT:
+                return GL_REPEAT;
+            case render::sampler::MIRRORED_REPEAT:
+                return GL_MIRRORED_REPEAT;
+            default:
+                return GL_CLAMP_TO_EDGE;
         }
+    }
 
-        // @ctor.
-        texture(int width, int height, int nchannels, const unsigned char* data) : width(width)
-                                                                                 , height(height)
-                                                                                 , nchannels(nchannels) {
-            unsigned datasize = width * height * nchannels;
-            // Copy data
-            buffsize = datasize;
-            if ((this->data = static_cast<unsigned char*>(::malloc(sizeof(unsigned char*) * buffsize))) == nullptr)
-                throw std::bad_alloc();
-            ::memset(this->data, 0, buffsize);
-            ::memcpy(this->data, data, datasize);
+    // Helper
+    inline int to_gl_min_filter(const render::sampler& s)
+    {
+        if (!s.mipmaps)
+            return s.minFilter == render::sampler::LINEAR ? GL_LINEAR : GL_NEAREST;
+        return s.minFilter == render::sampler::LINEAR ? GL_LINEAR_MIPMAP_LINEAR : GL_NEAREST_MIPMAP_NEAREST;
+    }
+
+    // Helper
+    inline int to_gl_mag_filter(const render::sampler& s) {
+        return s.magFilter == render::sampler::LINEAR ? GL_LINEAR : GL_NEAREST;
+    }
+
+    // Helper
+    // @return anisotropy clamped to the device limit, or 0 if EXT_texture_filter_anisotropic is unavailable
+    float clamp_anisotropy(float anisotropy)
+    {
+        static float maxAnisotropy = -1;
+        if (maxAnisotropy < 0)
+        {
+            const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+
+            maxAnisotropy = 0;
+            if (extensions != nullptr && ::strstr(extensions, "texture_filter_anisotropic") != nullptr)
+                glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxAnisotropy);
         }
-    };
 
-    unsigned generate_texture(const texture& t, int format)
+        return std::min(anisotropy, maxAnisotropy);
+    }
+
+    // Helper
+    // Generates texture handle and sets its sampling parameters
+    unsigned generate_texture(const render::sampler& s)
     {
         // Generate texture
         unsigned tao;
         glGenTextures(1, &tao);
-        glBindTexture(GL_TEXTURE_2D, tao);
-
-// GLES20.glBindTexture(GLES11Ext.GL_TEXTURE_EXTERNAL_OES, mTextureHandles[0]);
-// GLES20.glTexParameteri(GLES11Ext.GL_TEXTURE_EXTERNAL_OES, GLES20.GL_TEXTURE_WRAP_S, GLES20.GL_CLAMP_TO_EDGE);
-// GLES20.glTexParameteri(GLES11Ext.GL_TEXTURE_EXTERNAL_OES, GLES20.GL_TEXTURE_WRAP_T, GLES20.GL_CLAMP_TO_EDGE);
-// GLES20.glTexParameteri(GLES11Ext.GL_TEXTURE_EXTERNAL_OES, GLES20.GL_TEXTURE_MIN_FILTER, GLES20.GL_LINEAR);
-// GLES20.glTexParameteri(GLES11Ext.GL_TEXTURE_EXTERNAL_OES, GLES20.GL_TEXTURE_MAG_FILTER, GLES20.GL_LINEAR);
+        render::state::bind_texture(0, tao);
 
         // Set the texture wrapping parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, to_gl_wrap(s.wrap));
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, to_gl_wrap(s.wrap));
 
         // Set texture filtering parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, to_gl_min_filter(s));
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, to_gl_mag_filter(s));
+
+        const float anisotropy = clamp_anisotropy(s.anisotropy);
+        if (anisotropy > 1) {
+            glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, anisotropy);
+        }
+
+        return tao;
+    }
+
+    // Helper
+    // @return decode_image() flags
+    inline unsigned to_decode_flags(bool alpha, bool flipVertically, bool premultiplyAlpha)
+    {
+        return (flipVertically ? render::FLIP_VERTICALLY : 0)
+            | (alpha ? 0 : render::FORCE_OPAQUE)
+            | (premultiplyAlpha ? render::PREMULTIPLY_ALPHA : 0);
+    }
 
+    // Helper
+    // Uploads RGBA image to texture, generating mipmaps if requested
+    void upload_texture(unsigned tao, const render::image& img, bool mipmaps)
+    {
+        render::state::bind_texture(0, tao);
         glTexImage2D(GL_TEXTURE_2D,
                      0,
-                     format,
-                     t.width,
-                     t.height,
+                     GL_RGBA,
+                     img.width,
+                     img.height,
                      0,
-                     format,
+                     GL_RGBA,
                      GL_UNSIGNED_BYTE,
-                     t.data);
+                     img.pixels.data());
+
+        if (mipmaps) {
+            glGenerateMipmap(GL_TEXTURE_2D);
+        }
+    }
+
+    /// struct sampler_object
+    /*! Shared sampler object and the description it was created from
+     */
+    struct sampler_object { render::sampler desc; unsigned handle; };
+
+    // Sampler objects, shared by lazy textures
+    std::vector<sampler_object> samplers;
 
-        glGenerateMipmap(GL_TEXTURE_2D);
-        return (glBindTexture(GL_TEXTURE_2D, 0), tao);
+    // Helper
+    // @return sampler object matching s, created on first request
+    unsigned get_sampler(const render::sampler& s)
+    {
+        for (::size_t i = 0; i != samplers.size(); ++i)
+        {
+            const render::sampler& desc = samplers[i].desc;
+            if (desc.wrap == s.wrap &&
+                desc.minFilter == s.minFilter &&
+                desc.magFilter == s.magFilter &&
+                desc.mipmaps == s.mipmaps &&
+                desc.anisotropy == s.anisotropy)
+                return samplers[i].handle;
+        }
+
+        unsigned handle;
+        glGenSamplers(1, &handle);
+
+        glSamplerParameteri(handle, GL_TEXTURE_WRAP_S, to_gl_wrap(s.wrap));
+        glSamplerParameteri(handle, GL_TEXTURE_WRAP_T, to_gl_wrap(s.wrap));
+        glSamplerParameteri(handle, GL_TEXTURE_MIN_FILTER, to_gl_min_filter(s));
+        glSamplerParameteri(handle, GL_TEXTURE_MAG_FILTER, to_gl_mag_filter(s));
+
+        const float anisotropy = clamp_anisotropy(s.anisotropy);
+        if (anisotropy > 1) {
+            glSamplerParameterf(handle, GL_TEXTURE_MAX_ANISOTROPY_EXT, anisotropy);
+        }
+
+        sampler_object entry = { s, handle };
+        samplers.push_back(entry);
+        return handle;
+    }
+
+    // Helper
+    // Fills texture with a single grey texel
+    void upload_placeholder(unsigned tao)
+    {
+        static const unsigned char texel[] = { 0x80, 0x80, 0x80, 0xff };
+
+        render::state::bind_texture(0, tao);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, texel);
+    }
+
+    /// struct lazy_texture
+    /*! Registered texture and its residency state
+     */
+    struct lazy_texture {
+
+        enum state { UNLOADED, DECODING, RESIDENT, MISSING };
+
+        // Asset name
+        std::string name;
+        // Encoded image, set once available
+        const unsigned char* mem;
+        int memlen;
+        // decode_image() flags
+        unsigned flags;
+        // Shared sampler object
+        unsigned sampler;
+        bool mipmaps;
+
+        state status;
+        // Valid if resident
+        unsigned tao;
+        // Estimated GPU memory, including mipmaps
+        unsigned long size;
+        // Frame of last bind
+        unsigned long lastUsed;
+        // Set by request_texture() until decoding starts
+        bool requested;
+    };
+
+    // Decoder shared by all lazy textures
+    render::ImageDecoder& decoder()
+    {
+        static render::ImageDecoder instance;
+        return instance;
+    }
+
+    // Bound in place of textures that are not resident yet
+    unsigned placeholder()
+    {
+        static unsigned tao = 0;
+        if (tao == 0) {
+            upload_placeholder(tao = generate_texture(render::sampler()));
+        }
+
+        return tao;
+    }
+
+    // Registered textures, indexed by handle - 1
+    std::vector<lazy_texture> textures;
+    // The # of textures being decoded
+    unsigned decodingCount = 0;
+
+    // Residency budget in bytes (0 = none)
+    unsigned long budget = 0;
+    // Bytes held by resident textures
+    unsigned long residentSize = 0;
+    // Incremented by update_textures()
+    unsigned long frame = 0;
+
+    // Helper
+    // Evicts least-recently-used textures until under budget;
+    // textures bound during the last frame are kept
+    void evict()
+    {
+        std::vector<lazy_texture*> candidates;
+        for (::size_t i = 0; i != textures.size(); ++i)
+        {
+            lazy_texture& t = textures[i];
+            if (t.status == lazy_texture::RESIDENT && t.lastUsed + 1 < frame)
+                candidates.push_back(&t);
+        }
+
+        std::sort(candidates.begin(), candidates.end(), [](const lazy_texture* lhs, const lazy_texture* rhs) {
+            return lhs->lastUsed < rhs->lastUsed;
+        });
+
+        for (::size_t i = 0; i != candidates.size() && residentSize > budget; ++i)
+        {
+            lazy_texture& t = *candidates[i];
+            render::state::forget_texture(t.tao);
+            glDeleteTextures(1, &t.tao);
+
+            t.status = lazy_texture::UNLOADED;
+            t.tao = 0;
+            residentSize -= t.size;
+        }
+    }
+
+    // Helper
+    // Queues t for decoding if unloaded and its asset is available
+    void load(lazy_texture& t, unsigned handle)
+    {
+        // Resolve asset once the pack has arrived
+        if (t.status == lazy_texture::UNLOADED && t.mem == nullptr && render::get_asset_pack().loaded())
+        {
+            t.mem = render::get_asset_pack().find(t.name.c_str(), &t.memlen);
+            if (t.mem == nullptr) {
+                ::printf("Asset not found: %s\n", t.name.c_str());
+                t.status = lazy_texture::MISSING;
+            }
+        }
+
+        if (t.status == lazy_texture::UNLOADED && t.mem != nullptr)
+        {
+            render::ImageDecoder::job j = { handle, t.mem, t.memlen, t.flags };
+            decoder().push(j);
+
+            t.status = lazy_texture::DECODING;
+            ++decodingCount;
+        }
+
+        if (t.status != lazy_texture::UNLOADED) {
+            t.requested = false;
+        }
     }
 }
 
-unsigned render::load_texture_from_data(const unsigned char* mem, int memlen, bool alpha, bool flipVertically)
+unsigned render::load_texture_from_data(const unsigned char* mem,
+                                        int memlen,
+                                        bool alpha,
+                                        bool flipVertically,
+                                        const sampler& s,
+                                        bool premultiplyAlpha)
 {
-    int width = 0;
-    int height = 0;
-    int nchannels = 0;
+    // Corrupt or unsupported data; no texture is created
+    image img;
+    if (!decode_image(mem, memlen, to_decode_flags(alpha, flipVertically, premultiplyAlpha), img)) {
+        return 0;
+    }
+
+    unsigned tao = generate_texture(s);
+    return (upload_texture(tao, img, s.mipmaps), tao);
+}
+
+unsigned render::load_texture_from_file(const char* path,
+                                        bool alpha,
+                                        bool flipVertically,
+                                        const sampler& s,
+                                        bool premultiplyAlpha)
+{
+    // Read file into memory
+    std::vector<unsigned char> mem;
+
+    if (FILE* file = ::fopen(path, "rb"))
+    {
+        unsigned char buff[4096];
+        for (::size_t n; (n = ::fread(buff, 1, sizeof(buff), file)) != 0; )
+            mem.insert(mem.end(), buff, buff + n);
+        ::fclose(file);
+    }
+
+    if (mem.empty()) {
+        return (::printf("Cannot read texture: %s\n", path), 0);
+    }
 
-    stbi_set_flip_vertically_on_load(flipVertically);
-    unsigned char* data = stbi_load_from_memory(mem, memlen, &width, &height, &nchannels, 0);
+    const unsigned tao = load_texture_from_data(mem.data(), mem.size(), alpha, flipVertically, s, premultiplyAlpha);
+    if (tao == 0) {
+        ::printf("Cannot decode texture: %s\n", path);
+    }
 
-    texture t(width, height, nchannels, data);
-    return (stbi_image_free(data), generate_texture(t, alpha ? GL_RGBA : GL_RGB));
+    return tao;
 }
 
-unsigned render::load_texture_from_file(const char* path, bool alpha, bool flipVertically)
+unsigned render::register_texture(const char* name,
+                                  bool alpha,
+                                  bool flipVertically,
+                                  const sampler& s,
+                                  bool premultiplyAlpha)
 {
-    // Load image, create texture and generate mipmaps
-    int width = 0;
-    int height = 0;
-    int nchannels = 0;
+    const unsigned flags = to_decode_flags(alpha, flipVertically, premultiplyAlpha);
+    lazy_texture t = { name, nullptr, 0, flags, get_sampler(s), s.mipmaps, lazy_texture::UNLOADED, 0, 0, 0, false };
+    textures.push_back(t);
+    return textures.size();
+}
 
-    // Load image data
-    stbi_set_flip_vertically_on_load(flipVertically);
-    unsigned char* data = stbi_load(path, &width, &height, &nchannels, 0);
+void render::request_texture(unsigned handle)
+{
+    if (handle == 0 || handle > textures.size()) {
+        return;
+    }
+
+    // Retried by update_textures() until the pack has arrived
+    lazy_texture& t = textures[handle - 1];
+    t.requested = true;
+    load(t, handle);
+}
+
+void render::bind_texture(unsigned unit, unsigned handle)
+{
+    if (handle == 0 || handle > textures.size()) {
+        state::bind_texture(unit, 0);
+        state::bind_sampler(unit, 0);
+        return;
+    }
+
+    lazy_texture& t = textures[handle - 1];
+    t.lastUsed = frame;
+    state::bind_sampler(unit, t.sampler);
+
+    // Decode on first use (or first use since eviction)
+    load(t, handle);
+
+    state::bind_texture(unit, t.status == lazy_texture::RESIDENT ? t.tao : placeholder());
+}
+
+void render::set_texture_budget(unsigned long bytes) {
+    budget = bytes;
+}
+
+unsigned long render::get_texture_residency() {
+    return residentSize;
+}
+
+unsigned render::update_textures()
+{
+    ++frame;
+
+    // Start requested decodes whose asset was not available yet
+    for (::size_t i = 0; i != textures.size(); ++i)
+    {
+        if (textures[i].requested)
+            load(textures[i], i + 1);
+    }
+
+    ImageDecoder::result r;
+    while (decodingCount != 0 && decoder().pop(r))
+    {
+        lazy_texture& t = textures[r.tag - 1];
+        --decodingCount;
+
+        // Drawn with the placeholder, as if not found
+        if (!r.ok) {
+            ::printf("Cannot decode asset: %s\n", t.name.c_str());
+            t.status = lazy_texture::MISSING;
+            continue;
+        }
+
+        // Sampling state comes from the sampler object
+        t.tao = generate_texture(render::sampler());
+        upload_texture(t.tao, r.img, t.mipmaps);
+
+        t.status = lazy_texture::RESIDENT;
+        t.size = r.img.width * r.img.height * r.img.nchannels;
+        if (t.mipmaps) {
+            t.size += t.size / 3;
+        }
+        residentSize += t.size;
+    }
+
+    if (budget != 0 && residentSize > budget) {
+        evict();
+    }
 
-    texture t(width, height, nchannels, data);
-    return (stbi_image_free(data), generate_texture(t, alpha ? GL_RGBA : GL_RGB));
+    return decodingCount;
 }
@@ -1,8 +1,76 @@
 #pragma once
 
 namespace render {
-    /// @return TAO
-    unsigned load_texture_from_data(const unsigned char* data, int memlen, bool alpha, bool flipVertically = true);
-    /// @return TAO
-    unsigned load_texture_from_file(const char* path, bool alpha, bool flipVertically = true);
+
+    /// struct sampler
+    /*! Texture sampling state; lazy textures with equal samplers share one sampler object
+     */
+    struct sampler {
+
+        enum wrap_mode { CLAMP_TO_EDGE, REPEAT, MIRRORED_REPEAT };
+        enum filter_mode { NEAREST, LINEAR };
+
+        wrap_mode wrap;
+        filter_mode minFilter;
+        filter_mode magFilter;
+        // Generates mipmaps and samples them (trilinear if minFilter is LINEAR)
+        bool mipmaps;
+        // Max. anisotropy, clamped to the device limit; 1 disables anisotropic filtering
+        float anisotropy;
+
+        /// ctor.
+        sampler(wrap_mode wrap = CLAMP_TO_EDGE,
+                filter_mode minFilter = LINEAR,
+                filter_mode magFilter = LINEAR,
+                bool mipmaps = false,
+                float anisotropy = 1.0) : wrap(wrap)
+                                        , minFilter(minFilter)
+                                        , magFilter(magFilter)
+                                        , mipmaps(mipmaps)
+                                        , anisotropy(anisotropy) {}
+    };
+
+    /// Textures are always uploaded as RGBA
+    /// @param alpha if false, alpha is forced to 1
+    /// @param premultiplyAlpha if true, color channels are multiplied by alpha on decode
+    /// @return TAO; 0 if data cannot be decoded (no texture is created)
+    unsigned load_texture_from_data(const unsigned char* data,
+                                    int memlen,
+                                    bool alpha,
+                                    bool flipVertically = true,
+                                    const sampler& s = sampler(),
+                                    bool premultiplyAlpha = false);
+    /// @return TAO; 0 if the file cannot be read or decoded
+    unsigned load_texture_from_file(const char* path,
+                                    bool alpha,
+                                    bool flipVertically = true,
+                                    const sampler& s = sampler(),
+                                    bool premultiplyAlpha = false);
+    /// Registers a lazy texture loaded from the asset pack (see render::fetch_asset_pack());
+    /// nothing is decoded or uploaded until its first bind_texture()
+    /// @param name asset name
+    /// @return texture handle (not a TAO); 0 is never returned
+    unsigned register_texture(const char* name,
+                              bool alpha,
+                              bool flipVertically = true,
+                              const sampler& s = sampler(),
+                              bool premultiplyAlpha = false);
+    /// Queues texture for decoding ahead of its first bind_texture(),
+    /// e.g. to overlap decoding with startup work; retried each
+    /// update_textures() until the asset pack has arrived
+    /// @param handle texture handle returned by register_texture()
+    void request_texture(unsigned handle);
+    /// Binds texture and its sampler to texture unit;
+    /// binds a placeholder texel until the texture is resident
+    /// @param handle texture handle returned by register_texture()
+    void bind_texture(unsigned unit, unsigned handle);
+    /// Sets the residency budget; least-recently-used textures are evicted above it
+    /// @param bytes budget size, 0 for no budget
+    void set_texture_budget(unsigned long bytes);
+    /// @return bytes of GPU memory held by resident textures
+    unsigned long get_texture_residency();
+    /// Uploads images decoded since the last call and evicts over budget;
+    /// call once per frame from the GL thread
+    /// @return the # of textures still waiting for their image
+    unsigned update_textures();
 }
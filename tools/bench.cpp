@@ -0,0 +1,109 @@
+// Steps balls headless, without GL or a display, and prints the time per
+// tick and per ball: first on one thread for growing ball counts up to N
+// (the per-ball cost of the arrays), then for N balls at each thread count
+// from 1 to T (by default, the cores available); for scaling and profiling
+// runs on machines with no GPU.
+//
+// usage: bench [balls] [ticks] [collisions] [threads]
+//
+// build: ./runnative
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "sim/job_system.hpp"
+#include "sim/simulation.hpp"
+
+namespace {
+
+    // As in Runner
+    const float CAGE_WIDTH = 30;
+    const float CAGE_LENGTH = 30;
+    const unsigned BALL_SEED = 0x9e3779b9;
+
+    // Ticks run before timing, to settle the threads and caches
+    const unsigned WARMUP_TICKS = 10;
+
+    // Ball counts of the per-ball cost runs, below N
+    const unsigned BALL_COUNTS[] = { 100, 1000, 10000 };
+
+    /*! Helper
+     *! Runs a fixed scenario; the balls move and spin on every axis
+     *! @return the time per tick, in seconds
+     */
+    double run(unsigned balls, unsigned ticks, bool collisions, sim::JobSystem* jobs, unsigned long long* checksum)
+    {
+        sim::Simulation simulation(CAGE_WIDTH, CAGE_LENGTH, BALL_SEED, jobs);
+        simulation.apply(sim::BALL_COUNT, 0, balls);
+        simulation.apply(sim::SPEED, 0, 6);
+        simulation.apply(sim::SPEED, 1, 4);
+        simulation.apply(sim::TURN_RATE, 0, 1);
+        simulation.apply(sim::TURN_RATE, 1, 2);
+        simulation.apply(sim::TURN_RATE, 2, 3);
+        simulation.apply(sim::COLLISIONS, 0, collisions);
+
+        for (unsigned i = 0; i != WARMUP_TICKS; ++i)
+            simulation.step();
+
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        for (unsigned i = 0; i != ticks; ++i)
+            simulation.step();
+
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        *checksum = simulation.get_balls().get_checksum();
+        return elapsed / std::max(ticks, 1u);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const unsigned balls = argc > 1 ? ::atoi(argv[1]) : 100000;
+    const unsigned ticks = argc > 2 ? ::atoi(argv[2]) : 300;
+    const bool collisions = argc > 3 ? ::atoi(argv[3]) != 0 : true;
+
+    const unsigned cores = std::max(std::thread::hardware_concurrency(), 1u);
+    const unsigned maxThreads = argc > 4 ? std::max(::atoi(argv[4]), 1) : cores;
+
+    ::printf("%u ticks, collisions %s\n", ticks, collisions ? "on" : "off");
+
+    // Flat per-ball cost means the updates stay linear in the ball count
+    ::printf("%8s %12s %12s  %s\n", "balls", "ms/tick", "ns/ball", "checksum");
+    std::vector<unsigned> counts;
+    for (unsigned i = 0; i != sizeof(BALL_COUNTS) / sizeof(BALL_COUNTS[0]) && BALL_COUNTS[i] < balls; ++i)
+        counts.push_back(BALL_COUNTS[i]);
+    counts.push_back(balls);
+
+    for (::size_t i = 0; i != counts.size(); ++i)
+    {
+        unsigned long long checksum = 0;
+        const double t = run(counts[i], ticks, collisions, nullptr, &checksum);
+        ::printf("%8u %12.3f %12.2f  %016llx\n", counts[i], t * 1e3, t * 1e9 / std::max(counts[i], 1u), checksum);
+    }
+
+    // Past the cores, the workers only share them
+    ::printf("\n%u balls, %u cores\n", balls, cores);
+    ::printf("%8s %12s %12s %8s  %s\n", "threads", "ms/tick", "ns/ball", "speedup", "checksum");
+
+    double base = 0;
+    for (unsigned threads = 1; threads <= maxThreads; ++threads)
+    {
+        sim::JobSystem jobs(threads - 1);
+
+        unsigned long long checksum = 0;
+        const double t = run(balls, ticks, collisions, threads == 1 ? nullptr : &jobs, &checksum);
+        if (threads == 1) {
+            base = t;
+        }
+
+        ::printf("%8u %12.3f %12.2f %8.2f  %016llx\n",
+                 threads, t * 1e3, t * 1e9 / std::max(balls, 1u), base / t, checksum);
+    }
+
+    return 0;
+}
@@ -0,0 +1,138 @@
+// Times image decoding the way the texture workers do it (stb at the
+// image's own channel count, then one SIMD pass to flipped RGBA) against
+// stb's own flip and RGBA conversion, and the conversion pass alone
+// against its scalar reference.
+//
+// usage: bench_decode [iterations] [image]...   (defaults to the shipped textures)
+//
+// build: ./runnative; CXXFLAGS=-mssse3 ./runnative for the RGB kernel on x86
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "stb/stb_image.h"
+
+#include "image_decoder.hpp"
+
+namespace {
+
+    // Run from the repository root
+    const char* const IMAGES[] = {
+        "images/brick-wall.png",
+        "images/awesome-face.png",
+        "images/tiles/dark-grass.png",
+        "images/tiles/dry-grass.png"
+    };
+
+    /*! Helper
+     *! @return the contents of a file, empty if it cannot be read
+     */
+    std::vector<unsigned char> read_file(const char* path)
+    {
+        std::vector<unsigned char> mem;
+        if (FILE* file = ::fopen(path, "rb"))
+        {
+            unsigned char buf[4096];
+            for (::size_t n; (n = ::fread(buf, 1, sizeof(buf), file)) != 0; )
+                mem.insert(mem.end(), buf, buf + n);
+            ::fclose(file);
+        }
+
+        return mem;
+    }
+
+    /*! Helper
+     *! @return the time since start, in milliseconds
+     */
+    inline double elapsed_ms(const std::chrono::steady_clock::time_point& start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /// struct timings
+    /*! Best of the iterations, in milliseconds; the least disturbed run
+     */
+    struct timings { double stbDecode, decode, stbFlip, convert, scalar; };
+
+    /*! Helper
+     *! Times one image
+     */
+    timings run(const std::vector<unsigned char>& mem, unsigned iterations, int* width, int* height, int* nchannels)
+    {
+        timings t = { 1e9, 1e9, 1e9, 1e9, 1e9 };
+
+        // Decoded once at the image's own channel count, for the conversion runs
+        unsigned char* pixels = stbi_load_from_memory(mem.data(), mem.size(), width, height, nchannels, 0);
+        if (pixels == nullptr) {
+            return t;
+        }
+
+        std::vector<unsigned char> dst(*width * *height * 4);
+
+        for (unsigned i = 0; i != iterations; ++i)
+        {
+            // Decode only, no conversion
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            int w, h, n;
+            stbi_image_free(stbi_load_from_memory(mem.data(), mem.size(), &w, &h, &n, 0));
+            t.stbDecode = std::min(t.stbDecode, elapsed_ms(start));
+
+            // As the texture workers do
+            start = std::chrono::steady_clock::now();
+            render::image img;
+            render::decode_image(mem.data(), mem.size(), render::FLIP_VERTICALLY, img);
+            t.decode = std::min(t.decode, elapsed_ms(start));
+
+            // stb converting to RGBA and flipping on its own
+            start = std::chrono::steady_clock::now();
+            stbi_set_flip_vertically_on_load(1);
+            stbi_image_free(stbi_load_from_memory(mem.data(), mem.size(), &w, &h, &n, 4));
+            stbi_set_flip_vertically_on_load(0);
+            t.stbFlip = std::min(t.stbFlip, elapsed_ms(start));
+
+            start = std::chrono::steady_clock::now();
+            render::convert_pixels(pixels, *width, *height, *nchannels, render::FLIP_VERTICALLY, dst.data());
+            t.convert = std::min(t.convert, elapsed_ms(start));
+
+            start = std::chrono::steady_clock::now();
+            render::convert_pixels_scalar(pixels, *width, *height, *nchannels, render::FLIP_VERTICALLY, dst.data());
+            t.scalar = std::min(t.scalar, elapsed_ms(start));
+        }
+
+        stbi_image_free(pixels);
+        return t;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const unsigned iterations = std::max(argc > 1 ? ::atoi(argv[1]) : 20, 1);
+    const char* const* paths = argc > 2 ? argv + 2 : IMAGES;
+    const unsigned count = argc > 2 ? argc - 2 : sizeof(IMAGES) / sizeof(IMAGES[0]);
+
+    // Extra time over the bare decode; what flipping and converting costs each way
+    ::printf("best of %u, ms\n", iterations);
+    ::printf("%-30s %11s %8s %8s %11s %11s %8s %8s\n",
+             "image", "size", "decode", "+ours", "+stb flip", "convert", "scalar", "speedup");
+
+    for (unsigned i = 0; i != count; ++i)
+    {
+        const std::vector<unsigned char> mem = read_file(paths[i]);
+        int width = 0, height = 0, nchannels = 0;
+        const timings t = run(mem, iterations, &width, &height, &nchannels);
+        if (width == 0) {
+            ::fprintf(stderr, "%s: cannot decode\n", paths[i]);
+            continue;
+        }
+
+        char size[32];
+        ::snprintf(size, sizeof(size), "%dx%dx%d", width, height, nchannels);
+        ::printf("%-30s %11s %8.2f %8.2f %11.2f %11.3f %8.3f %8.2f\n", paths[i], size,
+                 t.stbDecode, t.decode - t.stbDecode, t.stbFlip - t.stbDecode, t.convert, t.scalar,
+                 t.scalar / t.convert);
+    }
+
+    return 0;
+}
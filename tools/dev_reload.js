@@ -0,0 +1,31 @@
+// Shader hot reload for development builds (BOUNCEGL_DEV=1 ./runemcc)
+//
+// Shader files are preloaded into the virtual file system under shaders/;
+// reloadShaders() re-fetches them from the server, and relinks all programs
+// if any has changed. watchShaders() polls, for reloads on save.
+
+Module['reloadShaders'] = function() {
+    var names = FS.readdir('shaders').filter(function(name) { return name[0] != '.'; });
+
+    return Promise.all(names.map(function(name) {
+        var path = 'shaders/' + name;
+        return fetch(path, { cache: 'no-store' })
+            .then(function(response) { return response.text(); })
+            .then(function(text) {
+                if (text == FS.readFile(path, { encoding: 'utf8' }))
+                    return false;
+                FS.writeFile(path, text);
+                return true;
+            });
+    })).then(function(changed) {
+        if (changed.indexOf(true) < 0)
+            return 0;
+        var failed = Module.ccall('reload_shaders', 'number', [], []);
+        console.log(failed ? 'Shader reload failed (' + failed + ' programs)' : 'Shaders reloaded');
+        return failed;
+    });
+};
+
+Module['watchShaders'] = function(interval) {
+    return setInterval(Module['reloadShaders'], interval || 500);
+};
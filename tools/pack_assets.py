@@ -0,0 +1,42 @@
+#!/usr/bin/env python3
+"""Packs images into an asset bundle read by render::AssetPack (see asset_pack.hpp).
+
+usage: pack_assets.py <root dir> <output> <asset>...
+Asset names are paths relative to <root dir>.
+"""
+
+import struct
+import sys
+
+MAGIC = b"BGLP"
+VERSION = 1
+NAMELEN = 56
+
+
+def main(argv):
+    if len(argv) < 4:
+        sys.exit(__doc__)
+
+    root, output, names = argv[1], argv[2], argv[3:]
+
+    blobs = []
+    for name in names:
+        if len(name.encode()) >= NAMELEN:
+            sys.exit("asset name too long: " + name)
+        with open(root + "/" + name, "rb") as f:
+            blobs.append(f.read())
+
+    header = struct.pack("<4sII", MAGIC, VERSION, len(names))
+    offset = len(header) + len(names) * (NAMELEN + 8)
+
+    index = b""
+    for name, blob in zip(names, blobs):
+        index += struct.pack("<%dsII" % NAMELEN, name.encode(), offset, len(blob))
+        offset += len(blob)
+
+    with open(output, "wb") as f:
+        f.write(header + index + b"".join(blobs))
+
+
+if __name__ == "__main__":
+    main(sys.argv)
@@ -0,0 +1,55 @@
+// Replays a control log headless, without GL or a display, and prints the
+// final simulation checksum; runs of the same log print the same checksum
+// as the browser (see start_replay() in main.cpp).
+//
+// usage: replay <log> [threads]
+//
+// build: ./runnative
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "sim/job_system.hpp"
+#include "sim/simulation.hpp"
+
+namespace {
+
+    // As in Runner
+    const float CAGE_WIDTH = 30;
+    const float CAGE_LENGTH = 30;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        ::fprintf(stderr, "usage: %s <log> [threads]\n", argv[0]);
+        return 2;
+    }
+
+    sim::ControlLog log;
+    if (!log.load(argv[1])) {
+        ::fprintf(stderr, "%s: not a control log\n", argv[1]);
+        return 1;
+    }
+
+    // 1 runs on this thread alone
+    const int threads = argc > 2 ? ::atoi(argv[2]) : 0;
+    sim::JobSystem jobs(threads > 0 ? threads - 1 : 0);
+
+    sim::Simulation simulation(CAGE_WIDTH, CAGE_LENGTH, log.get_seed(), threads == 1 ? nullptr : &jobs);
+    simulation.play(log);
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    while (simulation.is_playing())
+        simulation.step();
+
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    ::printf("Replay done after %u ticks, checksum %016llx\n", simulation.get_tick(), simulation.get_balls().get_checksum());
+    ::printf("%u balls, %u threads, %.3f ms per tick\n",
+             simulation.get_balls().size(), jobs.get_thread_count(), elapsed * 1e3 / std::max(simulation.get_tick(), 1u));
+    return 0;
+}
@@ -0,0 +1,217 @@
+// Checks that balls stay inside their cage: in rectangles, square or not,
+// no ball overlaps a wall box of sim::build_wall() or leaves the ring of
+// boxes, and balls reach all four walls (faces that cut the cage short
+// fail too); in polygons, no ball is past a wall face. Exits non-zero on
+// a failure.
+//
+// usage: test_cage
+//
+// build: ./runnative; run: ./runtests
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "matrix_operation.hpp"
+
+#include "sim/cage.hpp"
+#include "sim/simulation.hpp"
+
+namespace {
+
+    const unsigned BALL_SEED = 0x9e3779b9;
+    // Few enough that the smallest cage, the triangle, is not packed
+    const unsigned BALLS = 300;
+    const unsigned TICKS = 1200;
+    // Collision sphere of a ball (see BallSystem)
+    const float BALL_RADIUS = 0.5;
+    // Rounding slack
+    const float EPSILON = 1e-3f;
+    // Distance from a wall within which some ball must have come
+    const float REACH = 0.5;
+
+    /// struct box
+    /*! Axis-aligned wall box, on the floor
+     */
+    struct box { float x0, y0, x1, y1; };
+
+    /*! Helper
+     *! @return the floor extent of the unrotated wall boxes of a rectangle
+     */
+    std::vector<box> wall_boxes(int width, int length)
+    {
+        const std::vector<calc::mat4f> wall = sim::build_wall(width, length);
+
+        std::vector<box> boxes;
+        for (::size_t i = 0; i != wall.size(); ++i)
+        {
+            // Column-major: scale on the diagonal, translation in the last column
+            const float* m = calc::data(wall[i]);
+            const box b = { m[12] - m[0] / 2, m[13] - m[5] / 2, m[12] + m[0] / 2, m[13] + m[5] / 2 };
+            boxes.push_back(b);
+        }
+
+        return boxes;
+    }
+
+    /*! Helper
+     *! @return ball centers, from their model matrices
+     *! @param mats [in, out] the matrices of the last call; sleeping balls keep theirs
+     */
+    std::vector<float> centers(const sim::BallSystem& balls, std::vector<float>& mats)
+    {
+        mats.resize(16 * balls.size());
+        unsigned counts[sim::BallSystem::SKIN_COUNT];
+        unsigned changed[2 * sim::BallSystem::SKIN_COUNT];
+        balls.build_matrices(1, mats.data(), counts, changed);
+
+        std::vector<float> xy;
+        for (unsigned i = 0; i != balls.size(); ++i)
+        {
+            xy.push_back(mats[16 * i + 12]);
+            xy.push_back(mats[16 * i + 13]);
+        }
+
+        return xy;
+    }
+
+    /*! Helper
+     *! Runs balls in a cage, bouncing off each other
+     */
+    sim::Simulation* start(const sim::cage_shape& cage)
+    {
+        sim::Simulation* simulation = new sim::Simulation(cage.width, cage.length, BALL_SEED);
+        simulation->apply(sim::CAGE, 2, cage.sides);
+        simulation->apply(sim::BALL_COUNT, 0, BALLS);
+        simulation->apply(sim::SPEED, 0, 12);
+        simulation->apply(sim::SPEED, 1, 7);
+        simulation->apply(sim::COLLISIONS, 0, 1);
+        return simulation;
+    }
+
+    /*! Helper
+     *! @return the # of ball samples overlapping a wall box or outside the
+     *! ring, plus the # of walls no ball came near
+     */
+    unsigned test_rectangle(int width, int length)
+    {
+        const sim::cage_shape cage = { (float)width, (float)length, 4 };
+        const std::vector<box> boxes = wall_boxes(width, length);
+
+        box ring = boxes[0];
+        for (::size_t i = 0; i != boxes.size(); ++i)
+        {
+            ring.x0 = std::min(ring.x0, boxes[i].x0);
+            ring.y0 = std::min(ring.y0, boxes[i].y0);
+            ring.x1 = std::max(ring.x1, boxes[i].x1);
+            ring.y1 = std::max(ring.y1, boxes[i].y1);
+        }
+
+        sim::Simulation* simulation = start(cage);
+
+        // Ball centers touch the inner faces of the boxes at the sides' centers
+        float westX = ring.x1, eastX = ring.x0, northY = ring.y1, southY = ring.y0;
+        for (::size_t i = 0; i != boxes.size(); ++i)
+        {
+            if (boxes[i].y0 < 0 && boxes[i].y1 > 0) {
+                westX = std::min(westX, boxes[i].x1 > 0 ? boxes[i].x0 : westX);
+                eastX = std::max(eastX, boxes[i].x0 < 0 ? boxes[i].x1 : eastX);
+            }
+            if (boxes[i].x0 < 0 && boxes[i].x1 > 0) {
+                northY = std::min(northY, boxes[i].y1 > 0 ? boxes[i].y0 : northY);
+                southY = std::max(southY, boxes[i].y0 < 0 ? boxes[i].y1 : southY);
+            }
+        }
+
+        float minX = 0, maxX = 0, minY = 0, maxY = 0;
+
+        std::vector<float> mats;
+        unsigned outside = 0;
+        for (unsigned t = 0; t != TICKS; ++t)
+        {
+            simulation->step();
+
+            const std::vector<float> xy = centers(simulation->get_balls(), mats);
+            for (::size_t i = 0; i != xy.size(); i += 2)
+            {
+                const float x = xy[i], y = xy[i + 1];
+                minX = std::min(minX, x);
+                maxX = std::max(maxX, x);
+                minY = std::min(minY, y);
+                maxY = std::max(maxY, y);
+
+                bool out = x < ring.x0 || x > ring.x1 || y < ring.y0 || y > ring.y1;
+
+                // Distance from the center to the nearest point of each box
+                for (::size_t j = 0; j != boxes.size() && !out; ++j)
+                {
+                    const float dx = std::max(std::max(boxes[j].x0 - x, x - boxes[j].x1), 0.0f);
+                    const float dy = std::max(std::max(boxes[j].y0 - y, y - boxes[j].y1), 0.0f);
+                    out = dx * dx + dy * dy < (BALL_RADIUS - EPSILON) * (BALL_RADIUS - EPSILON);
+                }
+
+                outside += out;
+            }
+        }
+
+        delete simulation;
+
+        outside += maxX < westX - BALL_RADIUS - REACH;
+        outside += minX > eastX + BALL_RADIUS + REACH;
+        outside += maxY < northY - BALL_RADIUS - REACH;
+        outside += minY > southY + BALL_RADIUS + REACH;
+
+        ::printf("%s rectangle %dx%d; reached x [%.2f, %.2f], y [%.2f, %.2f]\n", outside == 0 ? "ok  " : "FAIL",
+                 width, length, minX, maxX, minY, maxY);
+        return outside;
+    }
+
+    /*! Helper
+     *! @return the # of ball samples past a wall face of a polygon
+     */
+    unsigned test_polygon(unsigned sides)
+    {
+        const sim::cage_shape cage = { 30, 30, sides };
+        sim::Simulation* simulation = start(cage);
+        const std::vector<sim::cage_plane>& planes = simulation->get_balls().get_planes();
+
+        std::vector<float> mats;
+        unsigned outside = 0;
+        for (unsigned t = 0; t != TICKS; ++t)
+        {
+            simulation->step();
+
+            const std::vector<float> xy = centers(simulation->get_balls(), mats);
+            for (::size_t i = 0; i != xy.size(); i += 2)
+            {
+                bool out = false;
+                for (::size_t p = 0; p != planes.size() && !out; ++p)
+                    out = xy[i] * planes[p].nx + xy[i + 1] * planes[p].ny > planes[p].d - BALL_RADIUS + EPSILON;
+
+                outside += out;
+            }
+        }
+
+        delete simulation;
+
+        ::printf("%s polygon, %u sides\n", outside == 0 ? "ok  " : "FAIL", sides);
+        return outside;
+    }
+}
+
+int main()
+{
+    // Non-square rectangles both ways, and sizes off the 6 unit box grid
+    const int rectangles[][2] = { { 30, 30 }, { 18, 60 }, { 60, 18 }, { 24, 48 }, { 120, 36 }, { 20, 44 } };
+    const unsigned polygons[] = { 3, 5, 6, 12 };
+
+    unsigned outside = 0;
+    for (unsigned i = 0; i != sizeof(rectangles) / sizeof(rectangles[0]); ++i)
+        outside += test_rectangle(rectangles[i][0], rectangles[i][1]);
+    for (unsigned i = 0; i != sizeof(polygons) / sizeof(polygons[0]); ++i)
+        outside += test_polygon(polygons[i]);
+
+    ::printf("%s: %u failure(s)\n", outside == 0 ? "ok" : "FAIL", outside);
+    return outside == 0 ? 0 : 1;
+}
@@ -0,0 +1,170 @@
+// Checks that control logs round-trip through save() and load(), and that
+// load() rejects, and leaves empty, logs with a control that is not valid:
+// unknown commands, axes out of range, non-finite or out of range values,
+// or a truncated file. Exits non-zero on a failure.
+//
+// usage: test_control_log [scratch file]
+//
+// build: ./runnative; run: ./runtests
+
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <vector>
+
+#include "sim/simulation.hpp"
+
+namespace {
+
+    const unsigned BALL_SEED = 0x9e3779b9;
+
+    /// struct bad_control
+    /*! A control load() must reject, and why
+     */
+    struct bad_control { const char* name; sim::control c; };
+
+    /*! Helper
+     *! A valid log, with bad appended after its controls unless null
+     */
+    sim::ControlLog build_log(const sim::control* bad)
+    {
+        sim::ControlLog log;
+        log.clear(BALL_SEED);
+
+        const sim::control valid[] = {
+            { 0, sim::BALL_COUNT, 0, 400 },
+            { 0, sim::TICK_RATE, 0, 60 },
+            { 5, sim::SPEED, 1, 4.8f },
+            { 9, sim::TURN_RATE, 2, 1.7f },
+            { 20, sim::SKIN, 0, 2 },
+            { 30, sim::COLLISIONS, 0, 1 },
+            { 40, sim::CAGE, 0, 48 },
+            { 40, sim::CAGE, 2, 6 }
+        };
+        for (unsigned i = 0; i != sizeof(valid) / sizeof(valid[0]); ++i)
+            log.push_back(valid[i]);
+
+        if (bad != nullptr) {
+            log.push_back(*bad);
+        }
+
+        log.set_length(100);
+        return log;
+    }
+
+    /*! Helper
+     *! @return 1 if a log with bad loads, 0 if it is rejected and left empty
+     */
+    unsigned test_rejected(const char* path, const bad_control& bad)
+    {
+        if (!build_log(&bad.c).save(path))
+        {
+            ::printf("FAIL %s: cannot save %s\n", bad.name, path);
+            return 1;
+        }
+
+        sim::ControlLog log;
+        const bool loaded = log.load(path);
+        const bool rejected = !loaded && log.get_controls().empty() && log.get_length() == 0;
+
+        ::printf("%s rejects %s\n", rejected ? "ok  " : "FAIL", bad.name);
+        return rejected ? 0 : 1;
+    }
+
+    /*! Helper
+     *! @return 1 if a truncated log loads
+     */
+    unsigned test_truncated(const char* path)
+    {
+        build_log(nullptr).save(path);
+
+        std::vector<unsigned char> data;
+        if (FILE* file = ::fopen(path, "rb"))
+        {
+            unsigned char buf[4096];
+            for (::size_t n; (n = ::fread(buf, 1, sizeof(buf), file)) != 0; )
+                data.insert(data.end(), buf, buf + n);
+            ::fclose(file);
+        }
+
+        // Cut into the last control's value
+        if (FILE* file = ::fopen(path, "wb"))
+        {
+            ::fwrite(data.data(), 1, data.size() - 2, file);
+            ::fclose(file);
+        }
+
+        sim::ControlLog log;
+        const bool rejected = !log.load(path) && log.get_controls().empty();
+        ::printf("%s rejects a truncated log\n", rejected ? "ok  " : "FAIL");
+        return rejected ? 0 : 1;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* path = argc > 1 ? argv[1] : "test_control_log.bglr";
+
+    unsigned failures = 0;
+
+    // A valid log loads as saved
+    {
+        const sim::ControlLog saved = build_log(nullptr);
+        sim::ControlLog log;
+        const bool ok = saved.save(path) && log.load(path) &&
+                        log.get_seed() == BALL_SEED && log.get_length() == 100 &&
+                        log.get_controls().size() == saved.get_controls().size();
+        ::printf("%s loads a valid log\n", ok ? "ok  " : "FAIL");
+        failures += !ok;
+    }
+
+    const float inf = std::numeric_limits<float>::infinity();
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const bad_control bad[] = {
+        { "an unknown command", { 50, 9, 0, 1 } },
+        { "SPEED on axis 2", { 50, sim::SPEED, 2, 1 } },
+        { "TURN_RATE on axis 3", { 50, sim::TURN_RATE, 3, 1 } },
+        { "BALL_COUNT on axis 1", { 50, sim::BALL_COUNT, 1, 10 } },
+        { "SKIN 3", { 50, sim::SKIN, 0, 3 } },
+        { "SKIN 0.5", { 50, sim::SKIN, 0, 0.5f } },
+        { "TICK_RATE 0", { 50, sim::TICK_RATE, 0, 0 } },
+        { "TICK_RATE -60", { 50, sim::TICK_RATE, 0, -60 } },
+        { "TICK_RATE NaN", { 50, sim::TICK_RATE, 0, nan } },
+        { "BALL_COUNT past MAX_BALLS", { 50, sim::BALL_COUNT, 0, sim::MAX_BALLS + 1.0f } },
+        { "BALL_COUNT 1e30", { 50, sim::BALL_COUNT, 0, 1e30f } },
+        { "BALL_COUNT infinity", { 50, sim::BALL_COUNT, 0, inf } },
+        { "SPEED NaN", { 50, sim::SPEED, 0, nan } },
+        { "SPEED -infinity", { 50, sim::SPEED, 0, -inf } },
+        { "COLLISIONS 2", { 50, sim::COLLISIONS, 0, 2 } },
+        { "CAGE on axis 3", { 50, sim::CAGE, 3, 30 } },
+        { "CAGE width 1e9", { 50, sim::CAGE, 0, 1e9f } },
+        { "CAGE with 2 sides", { 50, sim::CAGE, 2, 2 } }
+    };
+    for (unsigned i = 0; i != sizeof(bad) / sizeof(bad[0]); ++i)
+        failures += test_rejected(path, bad[i]);
+
+    failures += test_truncated(path);
+
+    // Simulations drop invalid controls instead of recording them
+    {
+        sim::ControlLog log;
+        log.clear(BALL_SEED);
+
+        sim::Simulation simulation(30, 30, BALL_SEED);
+        simulation.record(&log);
+        simulation.apply(sim::SPEED, 7, 1);
+        simulation.apply(sim::TICK_RATE, 0, 0);
+        simulation.apply(sim::BALL_COUNT, 0, 10);
+        simulation.step();
+
+        const bool ok = log.get_controls().size() == 1 && simulation.get_balls().size() == 10 &&
+                        simulation.get_tick_duration() == 1.0 / sim::Simulation::DEFAULT_TICK_RATE;
+        ::printf("%s drops invalid controls\n", ok ? "ok  " : "FAIL");
+        failures += !ok;
+    }
+
+    ::remove(path);
+
+    ::printf("%s: %u failure(s)\n", failures == 0 ? "ok" : "FAIL", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,168 @@
+// Checks that the SIMD pixel conversion matches the scalar reference byte
+// for byte, for every channel count and flag combination, and that flipped
+// RGBA decodes match stb's own flip and conversion, and that corrupt data
+// fails to decode, leaving the image empty (textures are then not
+// created); exits non-zero on a mismatch.
+//
+// usage: test_image_decoder [image]...   (defaults to the shipped textures)
+//
+// build: ./runnative; run: ./runtests
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "stb/stb_image.h"
+
+#include "image_decoder.hpp"
+
+namespace {
+
+    // Run from the repository root
+    const char* const IMAGES[] = {
+        "images/brick-wall.png",
+        "images/awesome-face.png",
+        "images/tiles/dark-grass.png",
+        "images/tiles/dry-grass.png"
+    };
+
+    // Row widths around the 4 and 6 pixel kernel steps, and past them
+    const int WIDTHS[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 13, 16, 31, 64, 67 };
+    const int HEIGHTS[] = { 1, 2, 5 };
+
+    /*! Helper
+     *! @return the contents of a file, empty if it cannot be read
+     */
+    std::vector<unsigned char> read_file(const char* path)
+    {
+        std::vector<unsigned char> mem;
+        if (FILE* file = ::fopen(path, "rb"))
+        {
+            unsigned char buf[4096];
+            for (::size_t n; (n = ::fread(buf, 1, sizeof(buf), file)) != 0; )
+                mem.insert(mem.end(), buf, buf + n);
+            ::fclose(file);
+        }
+
+        return mem;
+    }
+
+    /*! Helper
+     *! Random pixels, alpha included; fixed, so failures repeat
+     */
+    std::vector<unsigned char> random_pixels(::size_t size, unsigned seed)
+    {
+        std::vector<unsigned char> pixels(size);
+        for (::size_t i = 0; i != size; ++i)
+            pixels[i] = (seed = seed * 1664525u + 1013904223u) >> 24;
+        return pixels;
+    }
+
+    /*! Helper
+     *! @return the # of mismatching conversions of random pixels
+     */
+    unsigned test_conversion()
+    {
+        unsigned failures = 0;
+        for (int nchannels = 1; nchannels <= 4; ++nchannels)
+        for (unsigned flags = 0; flags != 8; ++flags)
+        for (unsigned w = 0; w != sizeof(WIDTHS) / sizeof(WIDTHS[0]); ++w)
+        for (unsigned h = 0; h != sizeof(HEIGHTS) / sizeof(HEIGHTS[0]); ++h)
+        {
+            const int width = WIDTHS[w];
+            const int height = HEIGHTS[h];
+            const std::vector<unsigned char> src = random_pixels(width * height * nchannels, width * 131 + height);
+
+            std::vector<unsigned char> simd(width * height * 4);
+            std::vector<unsigned char> scalar(width * height * 4);
+            render::convert_pixels(src.data(), width, height, nchannels, flags, simd.data());
+            render::convert_pixels_scalar(src.data(), width, height, nchannels, flags, scalar.data());
+
+            if (simd != scalar)
+            {
+                ::printf("FAIL conversion: %d channels, flags %u, %dx%d\n", nchannels, flags, width, height);
+                ++failures;
+            }
+        }
+
+        return failures;
+    }
+
+    /*! Helper
+     *! @return the # of images whose flipped decode differs from stb's
+     */
+    unsigned test_decode(const char* const* paths, unsigned count)
+    {
+        unsigned failures = 0;
+        for (unsigned i = 0; i != count; ++i)
+        {
+            const std::vector<unsigned char> mem = read_file(paths[i]);
+            if (mem.empty())
+            {
+                ::printf("FAIL decode: cannot read %s\n", paths[i]);
+                ++failures;
+                continue;
+            }
+
+            render::image img;
+            const bool ok = render::decode_image(mem.data(), mem.size(), render::FLIP_VERTICALLY, img);
+
+            // Single threaded; stb's process-wide flag is safe here
+            int width = 0, height = 0, nchannels = 0;
+            stbi_set_flip_vertically_on_load(1);
+            unsigned char* ref = stbi_load_from_memory(mem.data(), mem.size(), &width, &height, &nchannels, 4);
+            stbi_set_flip_vertically_on_load(0);
+
+            if (!ok || ref == nullptr || img.width != width || img.height != height ||
+                ::memcmp(img.pixels.data(), ref, width * height * 4) != 0)
+            {
+                ::printf("FAIL decode: %s differs from stb\n", paths[i]);
+                ++failures;
+            }
+
+            stbi_image_free(ref);
+        }
+
+        return failures;
+    }
+
+    /*! Helper
+     *! @return the # of corrupt inputs that decode, or leave pixels behind
+     */
+    unsigned test_corrupt(const char* path)
+    {
+        const std::vector<unsigned char> mem = read_file(path);
+
+        // Garbage, an empty buffer, and a PNG cut short in its header
+        const unsigned char garbage[] = { 'n', 'o', 't', ' ', 'a', 'n', ' ', 'i', 'm', 'a', 'g', 'e' };
+        const unsigned char* inputs[] = { garbage, garbage, mem.data() };
+        const int lengths[] = { sizeof(garbage), 0, (int)std::min<::size_t>(mem.size(), 24) };
+
+        unsigned failures = 0;
+        for (unsigned i = 0; i != sizeof(inputs) / sizeof(inputs[0]); ++i)
+        {
+            render::image img;
+            img.width = img.height = 1;
+            const bool ok = render::decode_image(inputs[i], lengths[i], render::FLIP_VERTICALLY, img);
+            if (ok || img.width != 0 || img.height != 0)
+            {
+                ::printf("FAIL corrupt input %u decodes\n", i);
+                ++failures;
+            }
+        }
+
+        return failures;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* const* paths = argc > 1 ? argv + 1 : IMAGES;
+    const unsigned count = argc > 1 ? argc - 1 : sizeof(IMAGES) / sizeof(IMAGES[0]);
+
+    const unsigned failures = test_conversion() + test_decode(paths, count) + test_corrupt(paths[0]);
+
+    ::printf("%s: %u failure(s)\n", failures == 0 ? "ok" : "FAIL", failures);
+    return failures == 0 ? 0 : 1;
+}
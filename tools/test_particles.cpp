@@ -0,0 +1,238 @@
+// Checks the particle shaders on a headless GLES 3 context (EGL, no
+// surface; e.g. Mesa's llvmpipe): UpdateParticles and DrawParticles compile
+// and link, transform feedback writes one record per particle slot,
+// emitted particles are drawn where they were emitted, they are gone once
+// past their lifetime, and a system recreated after one is destroyed draws
+// too. Exits non-zero on a failure, 77 (skipped) if
+// no GLES 3 context can be made.
+//
+// usage: test_particles
+//
+// build: ./runnative, if EGL and GLES 3 are installed; run: ./runtests
+
+#include <cstdio>
+#include <vector>
+
+#include <GLES3/gl3.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include "gl_state.hpp"
+#include "particle_system.hpp"
+#include "uniform_buffer.hpp"
+
+namespace {
+
+    // Framebuffer size, in pixels
+    const int SIZE = 64;
+    // Bursts emitted at the center of the frame
+    const unsigned BURSTS = 4;
+    const unsigned BURST_SIZE = 32;
+    const unsigned CAPACITY = 1024;
+    const float DT = 1.0f / 60;
+    // Past the longest lifetime (see shaders/update_particles.vs)
+    const float LIFETIME = 1.5f;
+
+    /*! Helper
+     *! Makes a GLES 3 context current, with no surface
+     *! @return false if there is none to be had
+     */
+    bool make_context()
+    {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        EGLDisplay display = getPlatformDisplay != nullptr ?
+            getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr) :
+            eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+            return false;
+        }
+
+        // Surfaceless displays may have no config; one isn't needed (KHR_no_config_context)
+        const EGLint configAttribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT, EGL_NONE };
+        EGLConfig config = EGL_NO_CONFIG_KHR;
+        EGLint count = 0;
+        if (!eglChooseConfig(display, configAttribs, &config, 1, &count) || count == 0) {
+            config = EGL_NO_CONFIG_KHR;
+        }
+
+        eglBindAPI(EGL_OPENGL_ES_API);
+        const EGLint contextAttribs[] = { EGL_CONTEXT_CLIENT_VERSION, 3, EGL_NONE };
+        EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+        return context != EGL_NO_CONTEXT && eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context);
+    }
+
+    /*! Helper
+     *! Draws the particles into the bound framebuffer
+     *! @return the # of lit pixels
+     */
+    unsigned draw(render::ParticleSystem& particles)
+    {
+        glClearColor(0, 0, 0, 0);
+        glClear(GL_COLOR_BUFFER_BIT);
+        particles.draw();
+
+        std::vector<unsigned char> pixels(SIZE * SIZE * 4);
+        glReadPixels(0, 0, SIZE, SIZE, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+        unsigned lit = 0;
+        for (unsigned i = 0; i != pixels.size(); i += 4)
+            lit += pixels[i] != 0;
+
+        return lit;
+    }
+
+    /*! Helper
+     *! @return the # of particle records the next update() writes
+     */
+    unsigned update(render::ParticleSystem& particles, float dt)
+    {
+        unsigned query;
+        glGenQueries(1, &query);
+        glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, query);
+        particles.update(dt);
+        glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
+
+        unsigned written = 0;
+        glGetQueryObjectuiv(query, GL_QUERY_RESULT, &written);
+        glDeleteQueries(1, &query);
+        return written;
+    }
+
+    /*! Helper
+     *! Prints and counts a check
+     */
+    unsigned check(bool ok, const char* what)
+    {
+        ::printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+        return ok ? 0 : 1;
+    }
+}
+
+int main()
+{
+    if (!make_context())
+    {
+        ::printf("skipped: no GLES 3 context\n");
+        return 77;
+    }
+
+    ::printf("%s, %s\n", (const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION));
+
+    unsigned failures = 0;
+
+    // Offscreen target
+    unsigned fbo, rbo;
+    glGenRenderbuffers(1, &rbo);
+    glBindRenderbuffer(GL_RENDERBUFFER, rbo);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, SIZE, SIZE);
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, rbo);
+    glViewport(0, 0, SIZE, SIZE);
+
+    // Identity camera; world xy is clip xy
+    const float identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+    render::UniformBuffer scene(3 * sizeof(identity), render::SCENE_BLOCK);
+    for (unsigned i = 0; i != 3; ++i)
+        scene.update(i * sizeof(identity), identity, sizeof(identity));
+
+    try
+    {
+        render::ParticleSystem particles(CAPACITY);
+        particles.set_burst_size(BURST_SIZE);
+
+        // Above the ground (z = 0), so the first steps fall freely
+        for (unsigned i = 0; i != BURSTS; ++i)
+            particles.emit(0, 0, -0.5f, 1, 0, 1);
+
+        // Links both programs on first use; errors throw
+        const unsigned written = update(particles, DT);
+        failures += check(written == BURSTS * BURST_SIZE && particles.size() == BURSTS * BURST_SIZE,
+                          "update writes one record per emitted slot");
+
+        const unsigned lit = draw(particles);
+        failures += check(lit != 0, "draw lights emitted particles");
+
+        // All lit pixels are about the emission point, at the center
+        std::vector<unsigned char> pixels(SIZE * SIZE * 4);
+        glReadPixels(0, 0, SIZE, SIZE, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        unsigned far = 0;
+        for (int y = 0; y != SIZE; ++y)
+            for (int x = 0; x != SIZE; ++x)
+                far += pixels[4 * (y * SIZE + x)] != 0 && (x - SIZE / 2) * (x - SIZE / 2) + (y - SIZE / 2) * (y - SIZE / 2) > SIZE * SIZE / 16;
+        failures += check(far == 0, "particles start at their burst's origin");
+
+        // Every slot in use is stepped, dead or alive
+        for (float t = 0; t < LIFETIME + 0.1f; t += 0.1f)
+            failures += update(particles, 0.1f) != particles.size();
+        failures += check(draw(particles) == 0, "particles die after their lifetime");
+
+        failures += check(glGetError() == GL_NO_ERROR, "no GL error");
+    }
+    catch (const Program::ShaderBuildException& e)
+    {
+        ::printf("FAIL shader: %s\n", e.what());
+        ++failures;
+    }
+    catch (const Program::ProgramBuildException& e)
+    {
+        ::printf("FAIL program: %s\n", e.what());
+        ++failures;
+    }
+    catch (const Program::VertexLayoutException& e)
+    {
+        ::printf("FAIL vertex layout: %s\n", e.what());
+        ++failures;
+    }
+
+    // A system replacing a destroyed one (particles toggled, or regrown by
+    // a larger burst size) may get its names back; the bind cache must not
+    // skip binding them
+    try
+    {
+        // Left with its first update vertex array bound, the first one the
+        // next system binds if the driver hands the names out again
+        {
+            render::ParticleSystem replaced(CAPACITY);
+            replaced.emit(0, 0, -0.5f, 1, 0, 1);
+            replaced.update(DT);
+        }
+
+        // GL has bound 0 in place of the deleted objects; so must the cache,
+        // or it would skip the first bind of a reused name
+        render::state::end_frame();
+        render::state::bind_vertex_array(0);
+        render::state::bind_array_buffer(0);
+        render::state::end_frame();
+        failures += check(render::state::get_frame_counters().issued == 0,
+                          "the bind cache forgets a destroyed system's objects");
+
+        render::ParticleSystem particles(CAPACITY);
+        particles.set_burst_size(BURST_SIZE);
+        for (unsigned i = 0; i != BURSTS; ++i)
+            particles.emit(0, 0, -0.5f, 1, 0, 1);
+
+        const unsigned written = update(particles, DT);
+        failures += check(written == BURSTS * BURST_SIZE && draw(particles) != 0 && glGetError() == GL_NO_ERROR,
+                          "a recreated system updates and draws");
+    }
+    catch (const Program::ShaderBuildException& e)
+    {
+        ::printf("FAIL shader: %s\n", e.what());
+        ++failures;
+    }
+    catch (const Program::ProgramBuildException& e)
+    {
+        ::printf("FAIL program: %s\n", e.what());
+        ++failures;
+    }
+    catch (const Program::VertexLayoutException& e)
+    {
+        ::printf("FAIL vertex layout: %s\n", e.what());
+        ++failures;
+    }
+
+    ::printf("%s: %u failure(s)\n", failures == 0 ? "ok" : "FAIL", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,299 @@
+// Checks the program binary cache (see program_cache.hpp) on a headless
+// GLES 3 context (EGL, no surface; e.g. Mesa's llvmpipe): the first link
+// into an empty directory misses and stores <key>.bin, a second program
+// of the same sources loads it without compiling, and a truncated file, a
+// corrupt header, a corrupt binary, another program's entry or changed
+// sources fall back to compiling and store the entry again. Every program
+// must draw the same. Exits non-zero on a failure, 77 (skipped) if no GLES
+// 3 context can be made or the driver has no program binaries.
+//
+// usage: test_program_cache [scratch directory]
+//
+// build: ./runnative, if EGL and GLES 3 are installed; run: ./runtests
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <GLES3/gl3.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include "program.hpp"
+#include "program_cache.hpp"
+
+namespace {
+
+    // Framebuffer size, in pixels
+    const int SIZE = 4;
+    // Red, as drawn by the programs; changed for the "changed sources" case
+    const int RED = 200;
+    const int OTHER_RED = 100;
+    // Green, written as a uniform; checks reflection of loaded programs
+    const float GREEN = 0.5f;
+
+    const vertex_shader VERTEX_SHADER = { R"(
+// Full screen triangle
+void main()
+{
+    vec2 corner = vec2(float((gl_VertexID & 1) << 2), float((gl_VertexID & 2) << 1)) - 1.0;
+    gl_Position = vec4(corner, 0.0, 1.0);
+}
+)", nullptr };
+
+    const fragment_shader FRAGMENT_SHADER = { R"(
+precision mediump float;
+
+out vec4 fragColor;
+
+uniform float green;
+
+void main()
+{
+    fragColor = vec4(float(RED) / 255.0, green, 0.0, 1.0);
+}
+)", nullptr };
+
+    /*! Helper
+     *! Makes a GLES 3 context current, with no surface
+     *! @return false if there is none to be had
+     */
+    bool make_context()
+    {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        EGLDisplay display = getPlatformDisplay != nullptr ?
+            getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr) :
+            eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+            return false;
+        }
+
+        // Surfaceless displays may have no config; one isn't needed (KHR_no_config_context)
+        const EGLint configAttribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT, EGL_NONE };
+        EGLConfig config = EGL_NO_CONFIG_KHR;
+        EGLint count = 0;
+        if (!eglChooseConfig(display, configAttribs, &config, 1, &count) || count == 0) {
+            config = EGL_NO_CONFIG_KHR;
+        }
+
+        eglBindAPI(EGL_OPENGL_ES_API);
+        const EGLint contextAttribs[] = { EGL_CONTEXT_CLIENT_VERSION, 3, EGL_NONE };
+        EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+        return context != EGL_NO_CONTEXT && eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context);
+    }
+
+    /*! Helper
+     *! @return the paths of the cache files in dir
+     */
+    std::vector<std::string> list_entries(const std::string& dir)
+    {
+        std::vector<std::string> paths;
+        if (DIR* d = ::opendir(dir.c_str()))
+        {
+            while (const dirent* entry = ::readdir(d))
+            {
+                const ::size_t len = ::strlen(entry->d_name);
+                if (len > 4 && ::strcmp(entry->d_name + len - 4, ".bin") == 0)
+                    paths.push_back(dir + "/" + entry->d_name);
+            }
+            ::closedir(d);
+        }
+
+        return paths;
+    }
+
+    /*! Helper
+     *! @return the contents of a file, empty if it cannot be read
+     */
+    std::vector<char> read_file(const std::string& path)
+    {
+        std::vector<char> data;
+        if (FILE* file = ::fopen(path.c_str(), "rb"))
+        {
+            char buf[4096];
+            for (::size_t n; (n = ::fread(buf, 1, sizeof(buf), file)) != 0; )
+                data.insert(data.end(), buf, buf + n);
+            ::fclose(file);
+        }
+
+        return data;
+    }
+
+    /*! Helper
+     *! Replaces the contents of a file
+     */
+    void write_file(const std::string& path, const std::vector<char>& data)
+    {
+        if (FILE* file = ::fopen(path.c_str(), "wb"))
+        {
+            ::fwrite(data.data(), 1, data.size(), file);
+            ::fclose(file);
+        }
+    }
+
+    /// struct outcome
+    /*! What linking one program did to the cache, and what it drew
+     */
+    struct outcome { unsigned hits, misses, stores; bool draws; };
+
+    /*! Helper
+     *! Links, uses and draws a program of the test sources
+     *! @param red red of the program, changes its sources
+     */
+    outcome run(int red)
+    {
+        const render::program_cache_stats before = render::get_program_cache_stats();
+
+        Program program;
+        program.define("RED", red);
+        program.add_shader(VERTEX_SHADER, FRAGMENT_SHADER);
+        program.link();
+        program.use();
+        program.set_value("green", GREEN);
+
+        glClear(GL_COLOR_BUFFER_BIT);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+
+        unsigned char pixel[4] = { 0, 0, 0, 0 };
+        glReadPixels(SIZE / 2, SIZE / 2, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+
+        const render::program_cache_stats after = render::get_program_cache_stats();
+        const outcome o = {
+            after.hits - before.hits, after.misses - before.misses, after.stores - before.stores,
+            pixel[0] == red && pixel[1] >= 127 && pixel[1] <= 128 && pixel[3] == 255
+        };
+
+        return o;
+    }
+
+    /*! Helper
+     *! Prints and counts a check
+     */
+    unsigned check(bool ok, const char* what)
+    {
+        ::printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+        return ok ? 0 : 1;
+    }
+
+    /*! Helper
+     *! @return true if a program was compiled and its binary stored again
+     */
+    inline bool recompiled(const outcome& o) {
+        return o.hits == 0 && o.misses == 1 && o.stores == 1 && o.draws;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const std::string dir = argc > 1 ? argv[1] : "test_program_cache.d";
+
+    if (!make_context())
+    {
+        ::printf("skipped: no GLES 3 context\n");
+        return 77;
+    }
+
+    int formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats == 0)
+    {
+        ::printf("skipped: no program binary formats\n");
+        return 77;
+    }
+
+    ::printf("%s, %s\n", (const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION));
+
+    // Offscreen target
+    unsigned fbo, rbo;
+    glGenRenderbuffers(1, &rbo);
+    glBindRenderbuffer(GL_RENDERBUFFER, rbo);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, SIZE, SIZE);
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, rbo);
+    glViewport(0, 0, SIZE, SIZE);
+
+    // Start empty
+    std::vector<std::string> entries = list_entries(dir);
+    for (::size_t i = 0; i != entries.size(); ++i)
+        ::remove(entries[i].c_str());
+
+    render::set_program_cache(dir.c_str());
+
+    unsigned failures = 0;
+    try
+    {
+        outcome o = run(RED);
+        entries = list_entries(dir);
+        failures += check(o.hits == 0 && o.misses == 1 && o.stores == 1 && o.draws && entries.size() == 1,
+                          "the first link misses and stores <key>.bin");
+
+        const std::string path = entries.empty() ? dir + "/missing.bin" : entries[0];
+        const std::vector<char> stored = read_file(path);
+
+        o = run(RED);
+        failures += check(o.hits == 1 && o.misses == 0 && o.stores == 0 && o.draws,
+                          "a program of the same sources loads the binary, without compiling");
+
+        std::vector<char> data(stored.begin(), stored.end() - std::min<::size_t>(stored.size(), 16));
+        write_file(path, data);
+        o = run(RED);
+        failures += check(recompiled(o) && read_file(path) == stored, "a truncated entry is compiled and stored again");
+
+        data = stored;
+        ::memcpy(data.data(), "XGLB", 4);
+        write_file(path, data);
+        o = run(RED);
+        failures += check(recompiled(o) && read_file(path) == stored, "a corrupt header is compiled and stored again");
+
+        // Past the header; the driver rejects it
+        data = stored;
+        for (::size_t i = data.size() / 2; i != data.size(); ++i)
+            data[i] = ~data[i];
+        write_file(path, data);
+        o = run(RED);
+        failures += check(recompiled(o) && read_file(path) == stored, "a corrupt binary is compiled and stored again");
+
+        o = run(OTHER_RED);
+        entries = list_entries(dir);
+        failures += check(recompiled(o) && entries.size() == 2, "changed sources are compiled and stored apart");
+
+        // Keyed by name and header; a file under the other key's name holding this binary
+        const std::string other = entries.size() == 2 ? entries[entries[0] == path ? 1 : 0] : path;
+        const std::vector<char> otherStored = read_file(other);
+        write_file(other, stored);
+        o = run(OTHER_RED);
+        failures += check(recompiled(o) && read_file(other) == otherStored,
+                          "another program's binary is compiled and stored again");
+
+        o = run(RED);
+        failures += check(o.hits == 1 && o.draws, "the first program still loads");
+
+        failures += check(glGetError() == GL_NO_ERROR, "no GL error");
+    }
+    catch (const Program::ShaderBuildException& e)
+    {
+        ::printf("FAIL shader: %s\n", e.what());
+        ++failures;
+    }
+    catch (const Program::ProgramBuildException& e)
+    {
+        ::printf("FAIL program: %s\n", e.what());
+        ++failures;
+    }
+
+    render::set_program_cache(nullptr);
+    entries = list_entries(dir);
+    for (::size_t i = 0; i != entries.size(); ++i)
+        ::remove(entries[i].c_str());
+    ::rmdir(dir.c_str());
+
+    ::printf("%s: %u failure(s)\n", failures == 0 ? "ok" : "FAIL", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,27 @@
+#include <GLES3/gl3.h>
+#include <EGL/egl.h>
+
+#include "gl_state.hpp"
+#include "uniform_buffer.hpp"
+
+render::UniformBuffer::~UniformBuffer()
+{
+    render::state::forget_buffer(ubo_);
+    glDeleteBuffers(1, &ubo_);
+}
+
+render::UniformBuffer::UniformBuffer(unsigned size, block_binding binding)
+{
+    glGenBuffers(1, &ubo_);
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo_);
+    glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+
+    // Binding stays attached; programs select it with Program::bind_uniform_block()
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, ubo_);
+}
+
+void render::UniformBuffer::update(unsigned offset, const void* data, unsigned size)
+{
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo_);
+    glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+}
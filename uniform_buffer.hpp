@@ -0,0 +1,41 @@
+#pragma once
+
+#ifndef UNIFORM_BUFFER_HPP
+#define UNIFORM_BUFFER_HPP
+
+namespace render {
+
+    /// Uniform block binding points shared by all programs
+    enum block_binding {
+        SCENE_BLOCK = 0,   // Camera matrices; see Camera
+        PARTICLE_BLOCK = 1 // Particle bursts; see ParticleSystem
+    };
+
+    //! class UniformBuffer
+    /*! Uniform buffer object attached to a fixed binding point
+     */
+    class UniformBuffer {
+    public:
+        /// dtor.
+        ~UniformBuffer();
+        /// ctor.
+        /// @param size buffer size in bytes
+        /// @param binding binding point
+        UniformBuffer(unsigned size, block_binding binding);
+        /// Writes data to buffer
+        /// @param offset byte offset
+        /// @param data source
+        /// @param size byte count
+        void update(unsigned offset, const void* data, unsigned size);
+
+    private:
+
+        UniformBuffer(const UniformBuffer&);
+        UniformBuffer& operator=(const UniformBuffer&);
+
+        // Buffer handle
+        unsigned ubo_;
+    };
+}
+
+#endif